@@ -35,12 +35,27 @@
 #ifndef _LIBC_CHECKSUM_H_
 #define _LIBC_CHECKSUM_H_
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
+/** Internet checksum (RFC 1071) computation state */
+typedef struct {
+	/** Unfolded one's complement sum of 16-bit words */
+	uint64_t sum;
+	/** An odd number of bytes has been added so far */
+	bool odd;
+} ocsum_t;
+
 extern uint32_t compute_crc32(uint8_t *, size_t);
 extern uint32_t compute_crc32_seed(uint8_t *, size_t, uint32_t);
 
+extern void ocsum_init(ocsum_t *);
+extern void ocsum_add(ocsum_t *, const void *, size_t);
+extern uint16_t ocsum_get(ocsum_t *);
+extern uint16_t compute_ocsum(const void *, size_t);
+extern uint16_t ocsum_update16(uint16_t, uint16_t, uint16_t);
+
 #endif
 
 /** @}
@@ -34,6 +34,7 @@
 
 #include <devman.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <io/table.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -379,6 +380,46 @@ static errno_t drv_unload(const char *drvname)
 	return EOK;
 }
 
+static errno_t boot_stats(void)
+{
+	devman_boot_stats_t stats;
+	errno_t rc;
+
+	static const char *phase_names[DEVMAN_BOOT_PHASES] = {
+		[DEVMAN_BOOT_DRIVERS_FOUND] = "drivers found",
+		[DEVMAN_BOOT_TREE_INIT] = "device tree initialized",
+		[DEVMAN_BOOT_ACCEPTING] = "accepting connections",
+		[DEVMAN_BOOT_TREE_STABLE] = "device tree stable"
+	};
+
+	rc = devman_get_boot_stats(&stats);
+	if (rc != EOK) {
+		printf("Failed getting start-up statistics: %s.\n",
+		    str_error(rc));
+		return rc;
+	}
+
+	printf("Device manager started at %" PRIu64 " us uptime.\n",
+	    stats.start_usec);
+
+	for (unsigned i = 0; i < DEVMAN_BOOT_PHASES; i++) {
+		if (stats.phase_usec[i] != 0) {
+			printf("\t%-24s +%" PRIu64 " us\n", phase_names[i],
+			    stats.phase_usec[i]);
+		} else {
+			printf("\t%-24s not reached\n", phase_names[i]);
+		}
+	}
+
+	printf("\t%-24s +%" PRIu64 " us\n", "last device added",
+	    stats.last_dev_usec);
+	printf("Drivers started: %" PRIu32 "\n", stats.drivers_started);
+	printf("Devices added: %" PRIu32 " (at most %" PRIu32 " at once)\n",
+	    stats.devices_added, stats.max_parallel_adds);
+
+	return EOK;
+}
+
 static void print_syntax(void)
 {
 	printf("syntax:\n");
@@ -389,6 +430,7 @@ static void print_syntax(void)
 	printf("\tdevctl show-drv <driver-name>\n");
 	printf("\tdevctl load-drv <driver-name>\n");
 	printf("\tdevctl unload-drv <driver-name>\n");
+	printf("\tdevctl boot-stats\n");
 }
 
 int main(int argc, char *argv[])
@@ -476,6 +518,10 @@ int main(int argc, char *argv[])
 		rc = drv_unload(argv[2]);
 		if (rc != EOK)
 			return 2;
+	} else if (str_cmp(argv[1], "boot-stats") == 0) {
+		rc = boot_stats();
+		if (rc != EOK)
+			return 2;
 	} else {
 		printf(NAME ": Invalid argument '%s'.\n", argv[1]);
 		print_syntax();
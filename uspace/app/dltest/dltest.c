@@ -36,11 +36,17 @@
  */
 
 #include <dlfcn.h>
+#include <inttypes.h>
 #include <libdltest.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <str.h>
+#include <time.h>
+
+#ifdef CONFIG_RTLD
+#include <rtld/rtld.h>
+#endif
 
 /** libdltest library handle */
 static void *handle;
@@ -1027,15 +1033,53 @@ static int test_lnk(void)
 
 #endif /* DLTEST_LINKED */
 
+/** Print statistics of the dynamic linking of this program.
+ *
+ * @param main_start Uptime at entry to main()
+ */
+static int print_rtld_stats(struct timespec *main_start)
+{
+#ifdef CONFIG_RTLD
+	rtld_stats_t *stats;
+
+	if (runtime_env == NULL) {
+		printf("No run-time linker environment.\n");
+		return 1;
+	}
+
+	stats = &runtime_env->stats;
+
+	printf("Relocations: %zu\n", stats->relocs);
+	printf("Symbol lookups: %zu (%zu from cache)\n", stats->lookups,
+	    stats->cache_hits);
+	printf("Relocation time: %" PRIu64 " us\n", stats->reloc_usec);
+	if (stats->reloc_usec > 0) {
+		printf("Relocations per ms: %" PRIu64 "\n",
+		    (uint64_t) stats->relocs * 1000 / stats->reloc_usec);
+	}
+
+	printf("Start of linking to main: %lld us\n",
+	    NSEC2USEC(ts_sub_diff(main_start, &stats->start)));
+	return 0;
+#else
+	printf("Dynamic linking is not supported.\n");
+	return 1;
+#endif
+}
+
 static void print_syntax(void)
 {
-	fprintf(stderr, "syntax: dltest [-n]\n");
+	fprintf(stderr, "syntax: dltest [-n | -s | -t]\n");
 	fprintf(stderr, "\t-n Do not run dlfcn tests\n");
+	fprintf(stderr, "\t-s Exit right after start-up (for benchmarking)\n");
+	fprintf(stderr, "\t-t Print dynamic linking statistics\n");
 }
 
 int main(int argc, char *argv[])
 {
-	printf("Dynamic linking test\n");
+	struct timespec main_start;
+
+	getuptime(&main_start);
 
 	if (argc > 1) {
 		if (argc > 2) {
@@ -1045,12 +1089,18 @@ int main(int argc, char *argv[])
 
 		if (str_cmp(argv[1], "-n") == 0) {
 			no_dlfcn = true;
+		} else if (str_cmp(argv[1], "-s") == 0) {
+			return 0;
+		} else if (str_cmp(argv[1], "-t") == 0) {
+			return print_rtld_stats(&main_start);
 		} else {
 			print_syntax();
 			return 1;
 		}
 	}
 
+	printf("Dynamic linking test\n");
+
 	if (!no_dlfcn) {
 		if (test_dlfcn() != 0)
 			return 1;
@@ -37,13 +37,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+/** Size of the input and output buffers */
+#define BUFFER_SIZE  65536
+
+static uint8_t ibuf[BUFFER_SIZE];
+static uint8_t obuf[BUFFER_SIZE];
+
 int main(int argc, char *argv[])
 {
 	errno_t rc;
-	void *data, *ddata;
-	size_t size, dsize;
-	size_t nread, nwr;
-	long len;
+	gzip_expand_t *gz = NULL;
+	size_t nread, nwr, produced;
 	FILE *f, *wf;
 
 	if (argc != 3) {
@@ -57,61 +61,49 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
-	if (fseek(f, 0, SEEK_END) < 0) {
-		printf("Error determining size of '%s'\n", argv[1]);
-		fclose(f);
-		return 1;
-	}
-
-	len = ftell(f);
-	if (len < 0) {
-		printf("Error determining size of '%s'\n", argv[1]);
-		fclose(f);
-		return 1;
-	}
-
-	if (fseek(f, 0, SEEK_SET) < 0) {
-		printf ("Error rewinding '%s'\n", argv[1]);
-		fclose(f);
-		return 1;
-	}
-
-	data = malloc(len);
-	if (data == NULL) {
-		printf("Error allocating %ld bytes.\n", len);
-		fclose(f);
-		return 1;
-	}
-
-	nread = fread(data, 1, len, f);
-	if (nread != (size_t)len) {
-		printf("Error reading '%s'\n", argv[1]);
+	wf = fopen(argv[2], "wb");
+	if (wf == NULL) {
+		printf("Error creating file '%s'\n", argv[2]);
 		fclose(f);
 		return 1;
 	}
 
-	fclose(f);
-
-	size = (size_t) len;
-
-	rc = gzip_expand(data, size, &ddata, &dsize);
+	rc = gzip_expand_create(&gz);
 	if (rc != EOK) {
-		printf("Error decompressing data.\n");
-		return 1;
+		printf("Out of memory.\n");
+		goto error;
 	}
 
-	wf = fopen(argv[2], "wb");
-	if (wf == NULL) {
-		printf("Error creating file '%s'\n", argv[2]);
-		return 1;
+	while (!gzip_expand_finished(gz)) {
+		rc = gzip_expand_output(gz, obuf, BUFFER_SIZE, &produced);
+		if (rc != EOK) {
+			printf("Error decompressing data.\n");
+			goto error;
+		}
+
+		nwr = fwrite(obuf, 1, produced, wf);
+		if (nwr != produced) {
+			printf("Error writing '%s'\n", argv[2]);
+			goto error;
+		}
+
+		if ((produced < BUFFER_SIZE) && (!gzip_expand_finished(gz))) {
+			/* All input consumed, read the next chunk */
+			nread = fread(ibuf, 1, BUFFER_SIZE, f);
+			if (nread == 0) {
+				if (ferror(f))
+					printf("Error reading '%s'\n", argv[1]);
+				else
+					printf("Unexpected end of '%s'\n", argv[1]);
+				goto error;
+			}
+
+			gzip_expand_input(gz, ibuf, nread);
+		}
 	}
 
-	nwr = fwrite(ddata, 1, dsize, wf);
-	if (nwr != dsize) {
-		printf("Error writing '%s'\n", argv[2]);
-		fclose(wf);
-		return 1;
-	}
+	gzip_expand_destroy(gz);
+	fclose(f);
 
 	if (fclose(wf) != 0) {
 		printf("Error writing '%s'\n", argv[2]);
@@ -119,6 +111,11 @@ int main(int argc, char *argv[])
 	}
 
 	return 0;
+error:
+	gzip_expand_destroy(gz);
+	fclose(f);
+	fclose(wf);
+	return 1;
 }
 
 /** @}
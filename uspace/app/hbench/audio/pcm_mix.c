@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <pcm/format.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include "../hbench.h"
+
+/*
+ * Benchmark of the PCM mixing kernels used by the sound server. Each
+ * operation mixes one 10 ms period of one stream into the sink buffer,
+ * thus the reported throughput divided by 1000 gives the number of
+ * streams mixed per millisecond of CPU time.
+ */
+
+/** Number of independent streams */
+#define STREAM_COUNT 8
+
+/** Period length in milliseconds */
+#define PERIOD_MSEC 10
+
+typedef struct {
+	const char *name;
+	pcm_sample_format_t format;
+} format_name_t;
+
+static const format_name_t formats[] = {
+	{ "s16le", PCM_SAMPLE_SINT16_LE },
+	{ "u8", PCM_SAMPLE_UINT8 },
+	{ "s32le", PCM_SAMPLE_SINT32_LE },
+	{ "float", PCM_SAMPLE_FLOAT32 },
+};
+
+/** Execute PCM mixing benchmark. */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	const char *fmtstr;
+	const char *ratestr;
+	pcm_format_t sf;
+	const pcm_format_t df = AUDIO_FORMAT_DEFAULT;
+	pcm_resampler_t resampler[STREAM_COUNT];
+	void *src = NULL;
+	void *dst = NULL;
+	size_t src_size;
+	size_t dst_size;
+	unsigned rate;
+	errno_t rc;
+
+	fmtstr = bench_env_param_get(env, "format", "s16le");
+	sf.sample_format = PCM_SAMPLE_FORMAT_LAST + 1;
+	for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+		if (str_cmp(fmtstr, formats[i].name) == 0)
+			sf.sample_format = formats[i].format;
+	}
+	if (sf.sample_format > PCM_SAMPLE_FORMAT_LAST) {
+		bench_run_fail(run, "'format' must be s16le, u8, s32le "
+		    "or float.");
+		goto error;
+	}
+
+	ratestr = bench_env_param_get(env, "rate", "44100");
+	if (sscanf(ratestr, "%u", &rate) < 1 || rate == 0) {
+		bench_run_fail(run, "'rate' must be a sampling rate in Hz.");
+		goto error;
+	}
+
+	sf.channels = df.channels;
+	sf.sampling_rate = rate;
+
+	src_size = pcm_format_frame_size(&sf) *
+	    (rate * PERIOD_MSEC / 1000);
+	dst_size = pcm_format_frame_size(&df) *
+	    (df.sampling_rate * PERIOD_MSEC / 1000);
+
+	src = calloc(STREAM_COUNT, src_size);
+	dst = malloc(dst_size);
+	if (src == NULL || dst == NULL) {
+		bench_run_fail(run, "failed to allocate buffers.");
+		goto error;
+	}
+
+	/* Fill the streams with something else than silence. */
+	for (size_t i = 0; i < STREAM_COUNT * src_size; i++)
+		((uint8_t *) src)[i] = (uint8_t) (i * 7);
+
+	for (size_t i = 0; i < STREAM_COUNT; i++)
+		pcm_resampler_init(&resampler[i]);
+
+	pcm_format_silence(dst, dst_size, &df);
+
+	bench_run_start(run);
+	for (uint64_t i = 0; i < size; i++) {
+		const size_t stream = i % STREAM_COUNT;
+		size_t ssize = src_size;
+		size_t dsize = dst_size;
+
+		if (stream == 0)
+			pcm_format_silence(dst, dst_size, &df);
+
+		rc = pcm_format_resample_and_mix(&resampler[stream], dst,
+		    &dsize, src + stream * src_size, &ssize, &sf, &df);
+		if (rc != EOK) {
+			bench_run_fail(run, "failed to mix stream: %s",
+			    str_error(rc));
+			goto error;
+		}
+	}
+	bench_run_stop(run);
+
+	free(src);
+	free(dst);
+	return true;
+error:
+	free(src);
+	free(dst);
+	return false;
+}
+
+benchmark_t benchmark_pcm_mix = {
+	.name = "pcm_mix",
+	.desc = "Mix 10 ms PCM periods into a 44.1 kHz S16LE sink "
+	    "(optional 'format' and 'rate' of streams).",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/** @}
+ */
@@ -38,17 +38,31 @@
 #include "hbench.h"
 
 benchmark_t *benchmarks[] = {
+	&benchmark_aes,
+	&benchmark_checksum,
 	&benchmark_dir_read,
+	&benchmark_dl_start,
+	&benchmark_ext4_alloc,
 	&benchmark_fibril_mutex,
 	&benchmark_file_read,
+	&benchmark_futex_contention,
+	&benchmark_gunzip,
+	&benchmark_hash,
+	&benchmark_loc_lookup,
 	&benchmark_rand_read,
 	&benchmark_seq_read,
+	&benchmark_seq_write,
 	&benchmark_malloc1,
 	&benchmark_malloc2,
 	&benchmark_ns_ping,
+	&benchmark_pcm_mix,
 	&benchmark_ping_pong,
 	&benchmark_read1k,
 	&benchmark_taskgetid,
+	&benchmark_ncache_churn,
+	&benchmark_tcp_conns,
+	&benchmark_udp_pps,
+	&benchmark_route_scale,
 	&benchmark_write1k,
 };
 
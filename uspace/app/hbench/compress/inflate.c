@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <errno.h>
+#include <gzip.h>
+#include <stdlib.h>
+#include <str_error.h>
+#include "../hbench.h"
+#include "corpus.h"
+
+/*
+ * Benchmark of gzip decompression. The corpus consists of the gzipped
+ * TGA images of the barber animation frames, which are decoded the same
+ * way as when they are loaded by the application. Each operation expands
+ * one frame, thus the reported throughput multiplied by the average
+ * uncompressed size of a frame gives the decompression speed.
+ */
+
+/** Execute gzip decompression benchmark. */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	void *data;
+	size_t data_size;
+	errno_t rc;
+
+	bench_run_start(run);
+	for (uint64_t i = 0; i < size; i++) {
+		corpus_file_t *file = &corpus_files[i % CORPUS_FILES];
+
+		rc = gzip_expand(file->addr, file->size, &data, &data_size);
+		if (rc != EOK) {
+			bench_run_fail(run, "failed to expand %s: %s",
+			    file->name, str_error(rc));
+			return false;
+		}
+
+		free(data);
+	}
+	bench_run_stop(run);
+
+	return true;
+}
+
+benchmark_t benchmark_gunzip = {
+	.name = "gunzip",
+	.desc = "Expand gzipped images of a fixed corpus.",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/** @}
+ */
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <crypto.h>
+#include <errno.h>
+#include <mem.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include "../hbench.h"
+
+/*
+ * Benchmark of AES-128 bulk encryption. Each operation encrypts one
+ * message of 'length' bytes with a key expanded in advance. Multiplying
+ * the reported throughput by the message length gives bytes per second,
+ * the clock frequency divided by that gives the cost in cycles per byte.
+ *
+ * Setting 'impl' to 'table' disables the AES instructions of the
+ * processor so that both implementations can be compared.
+ */
+
+/** Default message length */
+#define DEFAULT_LENGTH "1024"
+
+/** Execute AES benchmark. */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	const char *mode;
+	const char *impl;
+	const char *lenstr;
+	aes_gcm_context_t ctx;
+	uint8_t key[AES_CIPHER_LENGTH];
+	uint8_t counter[AES_CIPHER_LENGTH];
+	uint8_t iv[AES_GCM_IV_LENGTH];
+	uint8_t tag[AES_GCM_TAG_LENGTH];
+	uint8_t *data = NULL;
+	size_t length;
+	errno_t rc;
+
+	mode = bench_env_param_get(env, "mode", "ctr");
+	if ((str_cmp(mode, "ecb") != 0) && (str_cmp(mode, "ctr") != 0) &&
+	    (str_cmp(mode, "gcm") != 0)) {
+		bench_run_fail(run, "'mode' must be ecb, ctr or gcm.");
+		goto error;
+	}
+
+	impl = bench_env_param_get(env, "impl", "auto");
+	if ((str_cmp(impl, "auto") != 0) && (str_cmp(impl, "table") != 0)) {
+		bench_run_fail(run, "'impl' must be auto or table.");
+		goto error;
+	}
+
+	lenstr = bench_env_param_get(env, "length", DEFAULT_LENGTH);
+	if (sscanf(lenstr, "%zu", &length) < 1 || length == 0 ||
+	    (length % AES_CIPHER_LENGTH) != 0) {
+		bench_run_fail(run, "'length' must be a positive multiple "
+		    "of %d.", AES_CIPHER_LENGTH);
+		goto error;
+	}
+
+	data = malloc(length);
+	if (data == NULL) {
+		bench_run_fail(run, "failed to allocate buffer.");
+		goto error;
+	}
+
+	for (size_t i = 0; i < AES_CIPHER_LENGTH; i++)
+		key[i] = (uint8_t) (i * 13 + 1);
+
+	for (size_t i = 0; i < length; i++)
+		data[i] = (uint8_t) (i * 7);
+
+	memset(counter, 0, sizeof(counter));
+	memset(iv, 0, sizeof(iv));
+
+	aes_gcm_init(&ctx, key);
+	if (str_cmp(impl, "table") == 0)
+		ctx.aes.aesni = false;
+
+	bench_run_start(run);
+	for (uint64_t i = 0; i < size; i++) {
+		switch (mode[0]) {
+		case 'e':
+			for (size_t j = 0; j < length; j += AES_CIPHER_LENGTH)
+				aes_encrypt_block(&ctx.aes, data + j, data + j);
+			break;
+		case 'c':
+			aes_ctr(&ctx.aes, counter, data, data, length);
+			break;
+		default:
+			/* A fresh nonce for every message */
+			memcpy(iv, &i, sizeof(i));
+
+			rc = aes_gcm_encrypt(&ctx, iv, sizeof(iv), NULL, 0,
+			    data, data, length, tag);
+			if (rc != EOK) {
+				bench_run_fail(run, "failed to encrypt: %s",
+				    str_error(rc));
+				goto error;
+			}
+		}
+	}
+	bench_run_stop(run);
+
+	free(data);
+	return true;
+error:
+	free(data);
+	return false;
+}
+
+benchmark_t benchmark_aes = {
+	.name = "aes",
+	.desc = "Encrypt messages with AES-128 (optional 'mode' ecb/ctr/gcm, "
+	    "'impl' auto/table and 'length').",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/** @}
+ */
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <adt/checksum.h>
+#include <errno.h>
+#include <mem.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include "../hbench.h"
+
+/*
+ * Benchmark of data integrity checksums. Each operation computes the
+ * checksum of one buffer of 'length' bytes, either the Internet checksum
+ * used by IP, ICMP, UDP and TCP ('alg' inet, default packet-sized buffer)
+ * or CRC-32 used by gzip and GPT ('alg' crc32).
+ */
+
+/** Default buffer length */
+#define DEFAULT_LENGTH "1500"
+
+/** Execute checksum benchmark. */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	const char *alg;
+	const char *lenstr;
+	uint8_t *data = NULL;
+	size_t length;
+	bool crc32;
+	uint32_t sum;
+
+	alg = bench_env_param_get(env, "alg", "inet");
+	if (str_cmp(alg, "inet") == 0) {
+		crc32 = false;
+	} else if (str_cmp(alg, "crc32") == 0) {
+		crc32 = true;
+	} else {
+		bench_run_fail(run, "'alg' must be inet or crc32.");
+		goto error;
+	}
+
+	lenstr = bench_env_param_get(env, "length", DEFAULT_LENGTH);
+	if (sscanf(lenstr, "%zu", &length) < 1 || length < sizeof(sum)) {
+		bench_run_fail(run, "'length' must be at least %zu.",
+		    sizeof(sum));
+		goto error;
+	}
+
+	data = malloc(length);
+	if (data == NULL) {
+		bench_run_fail(run, "failed to allocate buffer.");
+		goto error;
+	}
+
+	for (size_t i = 0; i < length; i++)
+		data[i] = (uint8_t) (i * 7);
+
+	bench_run_start(run);
+	for (uint64_t i = 0; i < size; i++) {
+		if (crc32)
+			sum = compute_crc32(data, length);
+		else
+			sum = compute_ocsum(data, length);
+
+		/* Chain the buffers so that no iteration can be skipped */
+		memcpy(data, &sum, sizeof(sum));
+	}
+	bench_run_stop(run);
+
+	free(data);
+	return true;
+error:
+	free(data);
+	return false;
+}
+
+benchmark_t benchmark_checksum = {
+	.name = "checksum",
+	.desc = "Checksum buffers (optional 'alg' inet/crc32 and 'length').",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/** @}
+ */
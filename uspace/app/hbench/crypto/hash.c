@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <crypto.h>
+#include <errno.h>
+#include <mem.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include "../hbench.h"
+
+/*
+ * Benchmark of cryptographic hash functions. Each operation hashes one
+ * message of 'length' bytes through the incremental interface, so the
+ * cost of initialization and finalization is included just as when
+ * hashing a file.
+ *
+ * Setting 'impl' to 'generic' disables the SHA instructions of the
+ * processor so that both implementations of SHA-256 can be compared.
+ */
+
+/** Default message length */
+#define DEFAULT_LENGTH "4096"
+
+/** Execute hash benchmark. */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	const char *alg;
+	const char *impl;
+	const char *lenstr;
+	hash_func_t func;
+	hash_ctx_t ctx;
+	uint8_t digest[HASH_LENGTH_MAX];
+	uint8_t *data = NULL;
+	size_t length;
+	errno_t rc;
+
+	alg = bench_env_param_get(env, "alg", "sha256");
+	if (str_cmp(alg, "md5") == 0) {
+		func = HASH_MD5;
+	} else if (str_cmp(alg, "sha1") == 0) {
+		func = HASH_SHA1;
+	} else if (str_cmp(alg, "sha256") == 0) {
+		func = HASH_SHA256;
+	} else if (str_cmp(alg, "sha512") == 0) {
+		func = HASH_SHA512;
+	} else {
+		bench_run_fail(run, "'alg' must be md5, sha1, sha256 or "
+		    "sha512.");
+		goto error;
+	}
+
+	impl = bench_env_param_get(env, "impl", "auto");
+	if ((str_cmp(impl, "auto") != 0) && (str_cmp(impl, "generic") != 0)) {
+		bench_run_fail(run, "'impl' must be auto or generic.");
+		goto error;
+	}
+
+	lenstr = bench_env_param_get(env, "length", DEFAULT_LENGTH);
+	if (sscanf(lenstr, "%zu", &length) < 1 || length == 0) {
+		bench_run_fail(run, "'length' must be a positive number.");
+		goto error;
+	}
+
+	data = malloc(length);
+	if (data == NULL) {
+		bench_run_fail(run, "failed to allocate buffer.");
+		goto error;
+	}
+
+	for (size_t i = 0; i < length; i++)
+		data[i] = (uint8_t) (i * 7);
+
+	bench_run_start(run);
+	for (uint64_t i = 0; i < size; i++) {
+		rc = hash_init(&ctx, func);
+		if (rc != EOK) {
+			bench_run_fail(run, "failed to initialize hash: %s",
+			    str_error(rc));
+			goto error;
+		}
+
+		if (str_cmp(impl, "generic") == 0)
+			ctx.shani = false;
+
+		hash_update(&ctx, data, length);
+		hash_final(&ctx, digest);
+
+		/* Chain the messages so that no iteration can be skipped */
+		memcpy(data, digest, min(length, (size_t) func));
+	}
+	bench_run_stop(run);
+
+	free(data);
+	return true;
+error:
+	free(data);
+	return false;
+}
+
+benchmark_t benchmark_hash = {
+	.name = "hash",
+	.desc = "Hash messages (optional 'alg' md5/sha1/sha256/sha512, "
+	    "'impl' auto/generic and 'length').",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/** @}
+ */
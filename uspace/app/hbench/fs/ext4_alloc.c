@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ext4/bitmap.h>
+#include "../hbench.h"
+
+/*
+ * Benchmark of the ext4 bitmap search used by block and i-node
+ * allocation. A bitmap of one 4 KiB block (a whole block group) is filled
+ * to the requested level and each operation allocates the first free bit
+ * after a random goal and frees it again, so the fill level stays the same.
+ */
+
+/** Number of bits in the bitmap */
+#define BITMAP_BITS (4096 * 8)
+
+/** Number of precomputed goals */
+#define GOAL_COUNT 1024
+
+/** Execute ext4 allocation benchmark. */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	const char *fillstr;
+	uint32_t *goals = NULL;
+	uint8_t *bitmap = NULL;
+	unsigned fill;
+	uint32_t index;
+	errno_t rc;
+
+	fillstr = bench_env_param_get(env, "fill", "90");
+	if (sscanf(fillstr, "%u", &fill) < 1 || fill > 100) {
+		bench_run_fail(run, "'fill' must be a percentage (0-100).");
+		goto error;
+	}
+
+	bitmap = calloc(1, BITMAP_BITS / 8);
+	goals = malloc(GOAL_COUNT * sizeof(uint32_t));
+	if (bitmap == NULL || goals == NULL) {
+		bench_run_fail(run, "failed to allocate buffers.");
+		goto error;
+	}
+
+	srand(1);
+	for (uint32_t i = 0; i < BITMAP_BITS; i++) {
+		if ((unsigned) (rand() % 100) < fill)
+			ext4_bitmap_set_bit(bitmap, i);
+	}
+
+	for (size_t i = 0; i < GOAL_COUNT; i++)
+		goals[i] = rand() % BITMAP_BITS;
+
+	bench_run_start(run);
+	for (uint64_t i = 0; i < size; i++) {
+		rc = ext4_bitmap_find_free_bit_and_set(bitmap,
+		    goals[i % GOAL_COUNT], &index, BITMAP_BITS);
+		if (rc == EOK)
+			ext4_bitmap_free_bit(bitmap, index);
+	}
+	bench_run_stop(run);
+
+	free(bitmap);
+	free(goals);
+	return true;
+error:
+	free(bitmap);
+	free(goals);
+	return false;
+}
+
+benchmark_t benchmark_ext4_alloc = {
+	.name = "ext4_alloc",
+	.desc = "Allocate and free bits in an ext4 bitmap filled to "
+	    "90 % (optional 'fill' percentage).",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/** @}
+ */
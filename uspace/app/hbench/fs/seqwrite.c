@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <str_error.h>
+#include <vfs/vfs.h>
+#include "../hbench.h"
+
+/** Size of a single write request */
+#define CHUNK_SIZE (64 * 1024)
+
+/** Execute sequential file writing benchmark.
+ *
+ * Each operation appends one chunk to a newly created file, thus the
+ * reported throughput multiplied by CHUNK_SIZE gives the write speed
+ * in bytes per second. The file is synced before the measurement stops
+ * so that the time of writing the data to the device is included.
+ */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	const char *path = bench_env_param_get(env, "filename",
+	    "/tmp/hbench_seqwrite");
+	bool ret = true;
+	aoff64_t pos = 0;
+	size_t nwr;
+	errno_t rc;
+	int fd;
+
+	char *buf = malloc(CHUNK_SIZE);
+	if (buf == NULL) {
+		return bench_run_fail(run, "failed to allocate %dB buffer",
+		    CHUNK_SIZE);
+	}
+
+	for (size_t i = 0; i < CHUNK_SIZE; i++)
+		buf[i] = (char) i;
+
+	rc = vfs_lookup_open(path, WALK_REGULAR | WALK_MAY_CREATE, MODE_WRITE,
+	    &fd);
+	if (rc != EOK) {
+		bench_run_fail(run, "failed to create %s: %s", path,
+		    str_error(rc));
+		ret = false;
+		goto leave_free_buf;
+	}
+
+	rc = vfs_resize(fd, 0);
+	if (rc != EOK) {
+		bench_run_fail(run, "failed to truncate %s: %s", path,
+		    str_error(rc));
+		ret = false;
+		goto leave_close;
+	}
+
+	bench_run_start(run);
+	for (uint64_t i = 0; i < size; i++) {
+		rc = vfs_write(fd, &pos, buf, CHUNK_SIZE, &nwr);
+		if (rc != EOK) {
+			bench_run_fail(run, "failed to write to %s: %s",
+			    path, str_error(rc));
+			ret = false;
+			goto leave_close;
+		}
+	}
+
+	rc = vfs_sync(fd);
+	if (rc != EOK) {
+		bench_run_fail(run, "failed to sync %s: %s", path,
+		    str_error(rc));
+		ret = false;
+		goto leave_close;
+	}
+	bench_run_stop(run);
+
+leave_close:
+	vfs_put(fd);
+	(void) vfs_unlink_path(path);
+
+leave_free_buf:
+	free(buf);
+
+	return ret;
+}
+
+benchmark_t benchmark_seq_write = {
+	.name = "seq_write",
+	.desc = "Sequentially write 64 KiB chunks to a new file (use 'filename' param to select the file system).",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/**
+ * @}
+ */
@@ -131,17 +131,31 @@ extern benchmark_t *benchmarks[];
 extern size_t benchmark_count;
 
 /* Put your benchmark descriptors here (and also to benchlist.c). */
+extern benchmark_t benchmark_aes;
+extern benchmark_t benchmark_checksum;
 extern benchmark_t benchmark_dir_read;
+extern benchmark_t benchmark_dl_start;
+extern benchmark_t benchmark_ext4_alloc;
 extern benchmark_t benchmark_fibril_mutex;
 extern benchmark_t benchmark_file_read;
+extern benchmark_t benchmark_futex_contention;
+extern benchmark_t benchmark_gunzip;
+extern benchmark_t benchmark_hash;
+extern benchmark_t benchmark_loc_lookup;
 extern benchmark_t benchmark_rand_read;
 extern benchmark_t benchmark_seq_read;
+extern benchmark_t benchmark_seq_write;
 extern benchmark_t benchmark_malloc1;
 extern benchmark_t benchmark_malloc2;
 extern benchmark_t benchmark_ns_ping;
+extern benchmark_t benchmark_pcm_mix;
 extern benchmark_t benchmark_ping_pong;
 extern benchmark_t benchmark_read1k;
 extern benchmark_t benchmark_taskgetid;
+extern benchmark_t benchmark_ncache_churn;
+extern benchmark_t benchmark_tcp_conns;
+extern benchmark_t benchmark_udp_pps;
+extern benchmark_t benchmark_route_scale;
 extern benchmark_t benchmark_write1k;
 
 #endif
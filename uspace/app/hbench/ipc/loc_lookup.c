@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <async.h>
+#include <errno.h>
+#include <ipc/services.h>
+#include <loc.h>
+#include <stdio.h>
+#include <str.h>
+#include <str_error.h>
+#include "../hbench.h"
+
+/*
+ * Benchmark of the location service lookup path. In 'lookup' mode each
+ * operation resolves the service name to an ID, in 'connect' mode the
+ * service is also connected to and the session is closed again, which
+ * is what a typical client does when opening a device.
+ *
+ * Unless 'svc' is given, a null service is created for the lookups
+ * (this cannot be connected to, though).
+ *
+ * The client caches service IDs only if it registers a category change
+ * callback, 'cache' set to 'yes' does that before the measurement.
+ */
+
+/** Category change callback, only needed to enable the ID cache. */
+static void cat_change_cb(void *arg)
+{
+}
+
+/** Execute location service lookup benchmark. */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	const char *mode;
+	const char *svc;
+	char null_name[LOC_NAME_MAXLEN + 1];
+	int null_id = -1;
+	service_id_t sid;
+	async_sess_t *sess;
+	bool connect;
+	errno_t rc;
+
+	mode = bench_env_param_get(env, "mode", "lookup");
+	if ((str_cmp(mode, "lookup") != 0) && (str_cmp(mode, "connect") != 0)) {
+		bench_run_fail(run, "'mode' must be lookup or connect.");
+		goto error;
+	}
+
+	connect = str_cmp(mode, "connect") == 0;
+
+	if (str_cmp(bench_env_param_get(env, "cache", "no"), "yes") == 0) {
+		rc = loc_register_cat_change_cb(cat_change_cb, NULL);
+		if (rc != EOK && rc != EEXIST) {
+			bench_run_fail(run, "failed registering callback: %s",
+			    str_error(rc));
+			goto error;
+		}
+	}
+
+	svc = bench_env_param_get(env, "svc", NULL);
+	if (svc == NULL) {
+		if (connect) {
+			bench_run_fail(run, "'connect' mode requires 'svc'.");
+			goto error;
+		}
+
+		null_id = loc_null_create();
+		if (null_id < 0) {
+			bench_run_fail(run, "failed to create null service.");
+			goto error;
+		}
+
+		snprintf(null_name, sizeof(null_name), "null/%d", null_id);
+		svc = null_name;
+	}
+
+	bench_run_start(run);
+	for (uint64_t i = 0; i < size; i++) {
+		rc = loc_service_get_id(svc, &sid, 0);
+		if (rc != EOK) {
+			bench_run_fail(run, "failed resolving '%s': %s", svc,
+			    str_error(rc));
+			goto error;
+		}
+
+		if (connect) {
+			sess = loc_service_connect(sid, INTERFACE_DDF, 0);
+			if (sess == NULL) {
+				bench_run_fail(run, "failed connecting to '%s'.",
+				    svc);
+				goto error;
+			}
+
+			async_hangup(sess);
+		}
+	}
+	bench_run_stop(run);
+
+	if (null_id >= 0)
+		loc_null_destroy(null_id);
+	return true;
+error:
+	if (null_id >= 0)
+		loc_null_destroy(null_id);
+	return false;
+}
+
+benchmark_t benchmark_loc_lookup = {
+	.name = "loc_lookup",
+	.desc = "Resolve a service name with the location service (optional "
+	    "'mode' lookup/connect, 'svc' and 'cache' yes/no).",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/** @}
+ */
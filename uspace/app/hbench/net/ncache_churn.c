@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <errno.h>
+#include <inet/addr.h>
+#include <inet/eth_addr.h>
+#include <inet/ncache.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str_error.h>
+#include "../hbench.h"
+
+/*
+ * Neighbor cache churn benchmark. Lookups are spread over 'neighbors'
+ * addresses (default 4096). A lookup that misses is answered right away
+ * as if the reply had arrived, and every 'churn'-th operation (default 4)
+ * a neighbor is removed, so that entries are created and destroyed
+ * all the time. The workload size is the number of lookups.
+ */
+
+/** Maximum number of neighbors */
+#define NEIGHBORS_MAX  (1024 * 1024)
+
+/** Get address of neighbor @a i. */
+static void ncache_churn_addr(unsigned long i, inet_addr_t *addr)
+{
+	inet_addr(addr, 10, (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+}
+
+/** Execute neighbor cache churn benchmark. */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	ncache_t *ncache = NULL;
+	ncache_stats_t stats;
+	inet_addr_t addr;
+	eth_addr_t mac;
+	eth_addr_t rmac;
+	unsigned long neighbors;
+	unsigned long churn;
+	const char *str;
+	bool solicit;
+	uint64_t n;
+	usec_t usec;
+	bool ok = false;
+	errno_t rc;
+
+	str = bench_env_param_get(env, "neighbors", "4096");
+	neighbors = strtoul(str, NULL, 10);
+	str = bench_env_param_get(env, "churn", "4");
+	churn = strtoul(str, NULL, 10);
+
+	if (neighbors == 0 || neighbors > NEIGHBORS_MAX) {
+		return bench_run_fail(run, "'neighbors' must be between 1 "
+		    "and %u.", NEIGHBORS_MAX);
+	}
+
+	if (churn == 0)
+		return bench_run_fail(run, "'churn' must be positive.");
+
+	rc = ncache_create(&ncache);
+	if (rc != EOK) {
+		return bench_run_fail(run, "failed creating neighbor cache: %s",
+		    str_error(rc));
+	}
+
+	eth_addr_decode((uint8_t *) "\x02\x00\x00\x00\x00\x01", &mac);
+
+	bench_run_start(run);
+
+	for (n = 0; n < size; n++) {
+		ncache_churn_addr((n * 7919) % neighbors, &addr);
+
+		rc = ncache_resolve(ncache, &addr, &rmac, &solicit);
+		if (rc == EAGAIN) {
+			/* Reply arrives */
+			rc = ncache_update(ncache, &addr, &mac, NULL);
+		}
+
+		if (rc != EOK) {
+			bench_run_fail(run, "lookup failed: %s",
+			    str_error(rc));
+			goto out;
+		}
+
+		if (n % churn == 0) {
+			/* Neighbor goes away */
+			ncache_churn_addr((n * 104729) % neighbors, &addr);
+			(void) ncache_remove(ncache, &addr);
+		}
+
+		if (n % neighbors == 0)
+			ncache_age(ncache);
+	}
+
+	bench_run_stop(run);
+
+	ncache_get_stats(ncache, &stats);
+	usec = NSEC2USEC(stopwatch_get_nanos(&run->stopwatch));
+	printf("ncache_churn: %" PRIu64 " hits, %" PRIu64 " misses, "
+	    "%" PRIu64 " lookups/s\n", stats.hits, stats.misses,
+	    usec != 0 ? size * 1000000 / (uint64_t) usec : 0);
+
+	ok = true;
+out:
+	ncache_destroy(ncache);
+	return ok;
+}
+
+benchmark_t benchmark_ncache_churn = {
+	.name = "ncache_churn",
+	.desc = "Look up, add and remove neighbor cache entries "
+	    "(optional 'neighbors' and 'churn').",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/** @}
+ */
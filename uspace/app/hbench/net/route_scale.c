@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <errno.h>
+#include <inet/addr.h>
+#include <inet/inet.h>
+#include <inet/inetcfg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str_error.h>
+#include "../hbench.h"
+
+/*
+ * Route lookup benchmark of the internet service. 'routes' static routes
+ * (default 4096) to distinct /24 prefixes in 10.0.0.0/8 are installed via
+ * the loopback address, then the source address for destinations within
+ * them is queried, which requires a route lookup for each query. The
+ * workload size is the number of lookups. The routes are installed and
+ * removed in a configuration batch, so that the network configuration is
+ * only saved once rather than after every route.
+ */
+
+/** Maximum number of routes */
+#define ROUTES_MAX  65536
+
+/** Experimental IP protocol number used for the connection (RFC 3692) */
+#define ROUTE_SCALE_PROTO  253
+
+static bool inet_ready = false;
+
+/** Datagram received (there should be none). */
+static errno_t route_scale_recv(inet_dgram_t *dgram)
+{
+	return EOK;
+}
+
+static inet_ev_ops_t route_scale_ev_ops = {
+	.recv = route_scale_recv
+};
+
+/** Get destination network of route @a i. */
+static void route_scale_dest(unsigned long i, inet_naddr_t *naddr)
+{
+	inet_naddr(naddr, 10, (i >> 8) & 0xff, i & 0xff, 0, 24);
+}
+
+/** Execute route lookup benchmark. */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	inet_naddr_t dest;
+	inet_addr_t router;
+	inet_addr_t remote;
+	inet_addr_t local;
+	sysarg_t *ids = NULL;
+	unsigned long nroutes;
+	unsigned long ncreated = 0;
+	unsigned long i;
+	bool batch = false;
+	const char *str;
+	char *name;
+	uint64_t n;
+	usec_t usec;
+	bool ok = false;
+	errno_t rc;
+
+	str = bench_env_param_get(env, "routes", "4096");
+	nroutes = strtoul(str, NULL, 10);
+
+	if (nroutes == 0 || nroutes > ROUTES_MAX) {
+		return bench_run_fail(run, "'routes' must be between 1 and %u.",
+		    ROUTES_MAX);
+	}
+
+	if (!inet_ready) {
+		rc = inetcfg_init();
+		if (rc != EOK) {
+			return bench_run_fail(run, "failed connecting to "
+			    "internet service: %s", str_error(rc));
+		}
+
+		rc = inet_init(ROUTE_SCALE_PROTO, &route_scale_ev_ops);
+		if (rc != EOK) {
+			return bench_run_fail(run, "failed connecting to "
+			    "internet service: %s", str_error(rc));
+		}
+
+		inet_ready = true;
+	}
+
+	ids = calloc(nroutes, sizeof(sysarg_t));
+	if (ids == NULL)
+		return bench_run_fail(run, "out of memory.");
+
+	inet_addr(&router, 127, 0, 0, 1);
+
+	rc = inetcfg_batch_begin();
+	if (rc != EOK) {
+		bench_run_fail(run, "failed starting configuration batch: %s",
+		    str_error(rc));
+		goto out;
+	}
+
+	batch = true;
+
+	for (i = 0; i < nroutes; i++) {
+		route_scale_dest(i, &dest);
+
+		if (asprintf(&name, "hbench%lu", i) < 0) {
+			bench_run_fail(run, "out of memory.");
+			goto out;
+		}
+
+		rc = inetcfg_sroute_create(name, &dest, &router, &ids[i]);
+		free(name);
+		if (rc != EOK) {
+			bench_run_fail(run, "failed creating route: %s",
+			    str_error(rc));
+			goto out;
+		}
+
+		++ncreated;
+	}
+
+	rc = inetcfg_batch_end();
+	batch = false;
+	if (rc != EOK) {
+		bench_run_fail(run, "failed saving configuration: %s",
+		    str_error(rc));
+		goto out;
+	}
+
+	bench_run_start(run);
+
+	for (n = 0; n < size; n++) {
+		i = (n * 7919) % nroutes;
+		inet_addr(&remote, 10, (i >> 8) & 0xff, i & 0xff,
+		    1 + n % 254);
+
+		rc = inet_get_srcaddr(&remote, 0, &local);
+		if (rc != EOK) {
+			bench_run_fail(run, "route lookup failed: %s",
+			    str_error(rc));
+			goto out;
+		}
+	}
+
+	bench_run_stop(run);
+
+	usec = NSEC2USEC(stopwatch_get_nanos(&run->stopwatch));
+	printf("route_scale: %lu routes, %" PRIu64 " lookups/s\n", nroutes,
+	    usec != 0 ? size * 1000000 / (uint64_t) usec : 0);
+
+	ok = true;
+out:
+	if (ncreated > 0 && !batch)
+		batch = inetcfg_batch_begin() == EOK;
+	for (i = 0; i < ncreated; i++)
+		(void) inetcfg_sroute_delete(ids[i]);
+	if (batch)
+		(void) inetcfg_batch_end();
+	free(ids);
+	return ok;
+}
+
+benchmark_t benchmark_route_scale = {
+	.name = "route_scale",
+	.desc = "Look up destinations among many static routes "
+	    "(optional 'routes').",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/** @}
+ */
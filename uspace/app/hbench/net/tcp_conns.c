@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <inet/addr.h>
+#include <inet/endpoint.h>
+#include <inet/tcp.h>
+#include <qsort.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include <time.h>
+#include "../hbench.h"
+
+/*
+ * Benchmark of the TCP service with many concurrent connections. A number
+ * of client connections ('conns', default 16) is opened over the loopback
+ * to a local echo listener ('port', default 8090) and each of them
+ * performs request/response round trips with 'msg' bytes (default 256)
+ * in parallel. The workload size is the total number of round trips.
+ *
+ * Besides the duration the benchmark prints the aggregate throughput and
+ * the median and 99th percentile of the round-trip latency.
+ */
+
+/** First byte of the last request on a connection */
+#define REQ_LAST  0xff
+
+/** Maximum message size */
+#define MSG_SIZE_MAX  16384
+
+/** Benchmark state shared by all connections */
+typedef struct {
+	/** Message size */
+	size_t msg_size;
+	/** Round-trip latencies (usec) */
+	usec_t *lat;
+	/** Number of latencies recorded */
+	size_t nlat;
+	/** Number of client fibrils still running */
+	unsigned clients;
+	/** Number of server handlers still running */
+	unsigned servers;
+	/** First error encountered */
+	errno_t rc;
+	fibril_mutex_t lock;
+	fibril_condvar_t cv;
+} tcp_conns_t;
+
+/** Client connection */
+typedef struct {
+	tcp_conns_t *bench;
+	tcp_conn_t *conn;
+	/** Number of round trips to perform */
+	uint64_t rounds;
+} tcp_conns_client_t;
+
+static void tcp_conns_new_conn(tcp_listener_t *, tcp_conn_t *);
+
+static tcp_listen_cb_t listen_cb = {
+	.new_conn = tcp_conns_new_conn
+};
+
+static tcp_cb_t conn_cb = {
+	.connected = NULL
+};
+
+/** Receive exactly @a size bytes. */
+static errno_t recv_all(tcp_conn_t *conn, uint8_t *buf, size_t size)
+{
+	size_t nrecv;
+	errno_t rc;
+
+	while (size > 0) {
+		rc = tcp_conn_recv_wait(conn, buf, size, &nrecv);
+		if (rc != EOK)
+			return rc;
+		if (nrecv == 0)
+			return EIO;
+
+		buf += nrecv;
+		size -= nrecv;
+	}
+
+	return EOK;
+}
+
+/** Record failure of a connection. */
+static void tcp_conns_fail(tcp_conns_t *bench, errno_t rc)
+{
+	fibril_mutex_lock(&bench->lock);
+	if (bench->rc == EOK)
+		bench->rc = rc;
+	fibril_mutex_unlock(&bench->lock);
+}
+
+/** Echo server connection handler. */
+static void tcp_conns_new_conn(tcp_listener_t *lst, tcp_conn_t *conn)
+{
+	tcp_conns_t *bench = (tcp_conns_t *) tcp_listener_userptr(lst);
+	uint8_t *buf;
+	bool last;
+	errno_t rc;
+
+	(void) tcp_conn_set_nodelay(conn, true);
+
+	buf = malloc(bench->msg_size);
+	if (buf == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	do {
+		rc = recv_all(conn, buf, bench->msg_size);
+		if (rc != EOK)
+			break;
+
+		last = buf[0] == REQ_LAST;
+
+		rc = tcp_conn_send(conn, buf, bench->msg_size);
+		if (rc != EOK)
+			break;
+	} while (!last);
+
+	free(buf);
+out:
+	if (rc != EOK)
+		tcp_conns_fail(bench, rc);
+
+	fibril_mutex_lock(&bench->lock);
+	bench->servers--;
+	fibril_mutex_unlock(&bench->lock);
+	fibril_condvar_broadcast(&bench->cv);
+}
+
+/** Client fibril performing round trips on one connection. */
+static errno_t tcp_conns_client(void *arg)
+{
+	tcp_conns_client_t *client = (tcp_conns_client_t *) arg;
+	tcp_conns_t *bench = client->bench;
+	struct timespec start, end;
+	uint8_t *buf;
+	usec_t usec;
+	uint64_t i;
+	errno_t rc = EOK;
+
+	buf = malloc(bench->msg_size);
+	if (buf == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	memset(buf, 0, bench->msg_size);
+
+	for (i = 0; i < client->rounds; i++) {
+		buf[0] = (i + 1 == client->rounds) ? REQ_LAST : 0;
+
+		getuptime(&start);
+
+		rc = tcp_conn_send(client->conn, buf, bench->msg_size);
+		if (rc != EOK)
+			break;
+
+		rc = recv_all(client->conn, buf, bench->msg_size);
+		if (rc != EOK)
+			break;
+
+		getuptime(&end);
+		usec = NSEC2USEC(ts_sub_diff(&end, &start));
+
+		fibril_mutex_lock(&bench->lock);
+		bench->lat[bench->nlat++] = usec;
+		fibril_mutex_unlock(&bench->lock);
+	}
+
+	free(buf);
+out:
+	if (rc != EOK)
+		tcp_conns_fail(bench, rc);
+
+	fibril_mutex_lock(&bench->lock);
+	bench->clients--;
+	fibril_mutex_unlock(&bench->lock);
+	fibril_condvar_broadcast(&bench->cv);
+	return EOK;
+}
+
+static int usec_cmp(const void *a, const void *b)
+{
+	usec_t ua = *(const usec_t *) a;
+	usec_t ub = *(const usec_t *) b;
+
+	return (ua > ub) - (ua < ub);
+}
+
+/** Execute many-connection TCP benchmark. */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	tcp_conns_t bench;
+	tcp_conns_client_t *clients = NULL;
+	tcp_listener_t *lst = NULL;
+	tcp_t *tcp = NULL;
+	inet_ep_t ep;
+	inet_ep2_t epp;
+	const char *str;
+	unsigned long nconns;
+	unsigned long port;
+	unsigned long i;
+	uint64_t bytes;
+	usec_t usec;
+	fid_t fid;
+	bool ok = false;
+	errno_t rc;
+
+	memset(&bench, 0, sizeof(bench));
+	fibril_mutex_initialize(&bench.lock);
+	fibril_condvar_initialize(&bench.cv);
+
+	str = bench_env_param_get(env, "conns", "16");
+	nconns = strtoul(str, NULL, 10);
+	str = bench_env_param_get(env, "msg", "256");
+	bench.msg_size = strtoul(str, NULL, 10);
+	str = bench_env_param_get(env, "port", "8090");
+	port = strtoul(str, NULL, 10);
+
+	if (nconns == 0 || size < nconns) {
+		return bench_run_fail(run, "'conns' must be between 1 and "
+		    "the workload size.");
+	}
+
+	if (bench.msg_size == 0 || bench.msg_size > MSG_SIZE_MAX) {
+		return bench_run_fail(run, "'msg' must be between 1 and %u.",
+		    MSG_SIZE_MAX);
+	}
+
+	if (port == 0 || port > UINT16_MAX)
+		return bench_run_fail(run, "'port' is out of range.");
+
+	bench.lat = calloc(size, sizeof(usec_t));
+	clients = calloc(nconns, sizeof(tcp_conns_client_t));
+	if (bench.lat == NULL || clients == NULL) {
+		bench_run_fail(run, "out of memory.");
+		goto out;
+	}
+
+	rc = tcp_create(&tcp);
+	if (rc != EOK) {
+		bench_run_fail(run, "failed connecting to TCP service: %s",
+		    str_error(rc));
+		goto out;
+	}
+
+	inet_ep_init(&ep);
+	ep.port = port;
+
+	rc = tcp_listener_create(tcp, &ep, &listen_cb, &bench, &conn_cb,
+	    NULL, &lst);
+	if (rc != EOK) {
+		bench_run_fail(run, "failed creating listener: %s",
+		    str_error(rc));
+		goto out;
+	}
+
+	inet_ep2_init(&epp);
+	inet_addr(&epp.remote.addr, 127, 0, 0, 1);
+	epp.remote.port = port;
+
+	/* Establish connections */
+	for (i = 0; i < nconns; i++) {
+		clients[i].bench = &bench;
+		clients[i].rounds = size / nconns + (i < size % nconns ? 1 : 0);
+
+		fibril_mutex_lock(&bench.lock);
+		bench.servers++;
+		fibril_mutex_unlock(&bench.lock);
+
+		rc = tcp_conn_create(tcp, &epp, &conn_cb, NULL,
+		    &clients[i].conn);
+		if (rc == EOK)
+			rc = tcp_conn_wait_connected(clients[i].conn);
+		if (rc != EOK) {
+			bench_run_fail(run, "failed connecting: %s",
+			    str_error(rc));
+			goto out;
+		}
+
+		(void) tcp_conn_set_nodelay(clients[i].conn, true);
+	}
+
+	bench_run_start(run);
+
+	for (i = 0; i < nconns; i++) {
+		fid = fibril_create(tcp_conns_client, &clients[i]);
+		if (fid == 0) {
+			bench_run_fail(run, "failed creating fibril.");
+			goto out;
+		}
+
+		fibril_mutex_lock(&bench.lock);
+		bench.clients++;
+		fibril_mutex_unlock(&bench.lock);
+
+		fibril_add_ready(fid);
+	}
+
+	fibril_mutex_lock(&bench.lock);
+	while (bench.clients > 0)
+		fibril_condvar_wait(&bench.cv, &bench.lock);
+	fibril_mutex_unlock(&bench.lock);
+
+	bench_run_stop(run);
+
+	if (bench.rc != EOK) {
+		bench_run_fail(run, "transfer failed: %s",
+		    str_error(bench.rc));
+		goto out;
+	}
+
+	/* Report throughput and latency distribution */
+	qsort(bench.lat, bench.nlat, sizeof(usec_t), usec_cmp);
+	bytes = 2 * (uint64_t) bench.msg_size * bench.nlat;
+	usec = NSEC2USEC(stopwatch_get_nanos(&run->stopwatch));
+
+	printf("tcp_conns: %lu connections, %" PRIu64 " KiB/s, latency "
+	    "p50 %" PRIu64 " us, p99 %" PRIu64 " us\n", nconns,
+	    usec != 0 ? bytes * 1000000 / 1024 / (uint64_t) usec : 0,
+	    (uint64_t) bench.lat[bench.nlat / 2],
+	    (uint64_t) bench.lat[bench.nlat * 99 / 100]);
+
+	ok = true;
+out:
+	if (clients != NULL) {
+		for (i = 0; i < nconns; i++) {
+			if (clients[i].conn != NULL)
+				tcp_conn_destroy(clients[i].conn);
+		}
+	}
+
+	/* Wait for echo handlers to finish */
+	if (lst != NULL) {
+		fibril_mutex_lock(&bench.lock);
+		while (bench.servers > 0 && ok) {
+			fibril_condvar_wait(&bench.cv, &bench.lock);
+		}
+		fibril_mutex_unlock(&bench.lock);
+
+		tcp_listener_destroy(lst);
+	}
+
+	tcp_destroy(tcp);
+	free(clients);
+	free(bench.lat);
+	return ok;
+}
+
+benchmark_t benchmark_tcp_conns = {
+	.name = "tcp_conns",
+	.desc = "Request/response over many loopback TCP connections "
+	    "(optional 'conns', 'msg' and 'port').",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/** @}
+ */
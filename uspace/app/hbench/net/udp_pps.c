@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <errno.h>
+#include <fibril_synch.h>
+#include <inet/addr.h>
+#include <inet/endpoint.h>
+#include <inet/udp.h>
+#include <macros.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str_error.h>
+#include "../hbench.h"
+
+/*
+ * Packet rate benchmark of the UDP service. Datagrams of 'msg' bytes
+ * (default 64) are sent over the loopback to a local port ('port',
+ * default 8091) in batches of 'batch' messages (default 32, 1 sends
+ * each message with a separate request). The workload size is the number
+ * of datagrams. The run ends when all datagrams have been received or
+ * when no datagram arrives for a second.
+ */
+
+/** Maximum message size */
+#define MSG_SIZE_MAX  1472
+
+/** Maximum batch size */
+#define BATCH_MAX  256
+
+/** Time to wait for next datagram (usec) */
+#define RECV_TIMEOUT  (1000 * 1000)
+
+/** Receiver state */
+typedef struct {
+	/** Number of datagrams received */
+	uint64_t nrecv;
+	/** Receive buffer */
+	uint8_t buf[MSG_SIZE_MAX];
+	fibril_mutex_t lock;
+	fibril_condvar_t cv;
+} udp_pps_t;
+
+static void udp_pps_recv_msg(udp_assoc_t *, udp_rmsg_t *);
+
+static udp_cb_t udp_pps_cb = {
+	.recv_msg = udp_pps_recv_msg
+};
+
+/** Datagram received. */
+static void udp_pps_recv_msg(udp_assoc_t *assoc, udp_rmsg_t *rmsg)
+{
+	udp_pps_t *pps = (udp_pps_t *) udp_assoc_userptr(assoc);
+	errno_t rc;
+
+	rc = udp_rmsg_read(rmsg, 0, pps->buf, sizeof(pps->buf));
+	if (rc != EOK)
+		return;
+
+	fibril_mutex_lock(&pps->lock);
+	++pps->nrecv;
+	fibril_mutex_unlock(&pps->lock);
+	fibril_condvar_broadcast(&pps->cv);
+}
+
+/** Execute UDP packet rate benchmark. */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	udp_pps_t pps;
+	udp_t *udp = NULL;
+	udp_assoc_t *rassoc = NULL;
+	udp_assoc_t *tassoc = NULL;
+	udp_smsg_t smsg[BATCH_MAX];
+	uint8_t data[MSG_SIZE_MAX];
+	inet_ep2_t epp;
+	const char *str;
+	unsigned long msg_size;
+	unsigned long batch;
+	unsigned long port;
+	uint64_t nsent;
+	uint64_t last;
+	size_t cnt;
+	size_t n;
+	size_t i;
+	usec_t usec;
+	bool ok = false;
+	errno_t rc;
+
+	str = bench_env_param_get(env, "msg", "64");
+	msg_size = strtoul(str, NULL, 10);
+	str = bench_env_param_get(env, "batch", "32");
+	batch = strtoul(str, NULL, 10);
+	str = bench_env_param_get(env, "port", "8091");
+	port = strtoul(str, NULL, 10);
+
+	if (msg_size == 0 || msg_size > MSG_SIZE_MAX) {
+		return bench_run_fail(run, "'msg' must be between 1 and %u.",
+		    MSG_SIZE_MAX);
+	}
+
+	if (batch == 0 || batch > BATCH_MAX) {
+		return bench_run_fail(run, "'batch' must be between 1 and %u.",
+		    BATCH_MAX);
+	}
+
+	if (port == 0 || port > UINT16_MAX)
+		return bench_run_fail(run, "'port' is out of range.");
+
+	pps.nrecv = 0;
+	fibril_mutex_initialize(&pps.lock);
+	fibril_condvar_initialize(&pps.cv);
+
+	for (i = 0; i < msg_size; i++)
+		data[i] = (uint8_t) i;
+
+	rc = udp_create(&udp);
+	if (rc != EOK) {
+		bench_run_fail(run, "failed connecting to UDP service: %s",
+		    str_error(rc));
+		goto out;
+	}
+
+	/* Receiving association */
+	inet_ep2_init(&epp);
+	epp.local.port = port;
+
+	rc = udp_assoc_create(udp, &epp, &udp_pps_cb, &pps, &rassoc);
+	if (rc != EOK) {
+		bench_run_fail(run, "failed creating association: %s",
+		    str_error(rc));
+		goto out;
+	}
+
+	/* Sending association */
+	inet_ep2_init(&epp);
+	inet_addr(&epp.remote.addr, 127, 0, 0, 1);
+	epp.remote.port = port;
+
+	rc = udp_assoc_create(udp, &epp, NULL, NULL, &tassoc);
+	if (rc != EOK) {
+		bench_run_fail(run, "failed creating association: %s",
+		    str_error(rc));
+		goto out;
+	}
+
+	for (i = 0; i < batch; i++) {
+		smsg[i].dest = NULL;
+		smsg[i].data = data;
+		smsg[i].size = msg_size;
+	}
+
+	bench_run_start(run);
+
+	nsent = 0;
+	while (nsent < size) {
+		cnt = min(size - nsent, (uint64_t) batch);
+
+		if (batch == 1) {
+			rc = udp_assoc_send_msg(tassoc, NULL, data, msg_size);
+			n = 1;
+		} else {
+			rc = udp_assoc_send_batch(tassoc, smsg, cnt, &n);
+		}
+
+		if (rc != EOK) {
+			bench_run_fail(run, "failed sending: %s",
+			    str_error(rc));
+			goto out;
+		}
+
+		nsent += n;
+	}
+
+	/* Wait for all datagrams or until they stop arriving */
+	fibril_mutex_lock(&pps.lock);
+	while (pps.nrecv < size) {
+		last = pps.nrecv;
+		rc = fibril_condvar_wait_timeout(&pps.cv, &pps.lock,
+		    RECV_TIMEOUT);
+		if (rc == ETIMEOUT && pps.nrecv == last)
+			break;
+	}
+	fibril_mutex_unlock(&pps.lock);
+
+	bench_run_stop(run);
+
+	usec = NSEC2USEC(stopwatch_get_nanos(&run->stopwatch));
+	printf("udp_pps: %" PRIu64 " sent, %" PRIu64 " received, "
+	    "%" PRIu64 " packets/s\n", nsent, pps.nrecv,
+	    usec != 0 ? pps.nrecv * 1000000 / (uint64_t) usec : 0);
+
+	if (pps.nrecv == 0) {
+		bench_run_fail(run, "no datagrams received.");
+		goto out;
+	}
+
+	ok = true;
+out:
+	udp_assoc_destroy(tassoc);
+	udp_assoc_destroy(rassoc);
+	udp_destroy(udp);
+	return ok;
+}
+
+benchmark_t benchmark_udp_pps = {
+	.name = "udp_pps",
+	.desc = "Send datagrams over loopback UDP (optional 'msg', "
+	    "'batch' and 'port').",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/** @}
+ */
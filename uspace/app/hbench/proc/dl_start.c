@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <crypto.h>
+#include <errno.h>
+#include <stdio.h>
+#include <str_error.h>
+#include <task.h>
+#include "../hbench.h"
+
+/*
+ * Benchmark of program start-up. Each operation spawns a dynamically
+ * linked program which exits as soon as it reaches main(), so the time
+ * of one operation is the latency from exec to main plus task teardown.
+ *
+ * Running the program with the '-t' option instead prints the number of
+ * relocations processed by the dynamic linker, the relocations per
+ * millisecond and the time from the start of linking to main().
+ */
+
+/** Default program (started with the '-s' option). */
+#define DEFAULT_APP "/app/dltests"
+
+/** Execute program start-up benchmark. */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	const char *app;
+	const char *args[3];
+	task_id_t id;
+	task_wait_t wait;
+	task_exit_t texit;
+	int retval;
+	errno_t rc;
+
+	app = bench_env_param_get(env, "app", DEFAULT_APP);
+
+	args[0] = app;
+	args[1] = "-s";
+	args[2] = NULL;
+
+	bench_run_start(run);
+	for (uint64_t i = 0; i < size; i++) {
+		rc = task_spawnv(&id, &wait, app, args);
+		if (rc != EOK) {
+			return bench_run_fail(run, "failed to spawn %s: %s",
+			    app, str_error(rc));
+		}
+
+		rc = task_wait(&wait, &texit, &retval);
+		if (rc != EOK) {
+			return bench_run_fail(run, "failed waiting for %s: %s",
+			    app, str_error(rc));
+		}
+
+		if (texit != TASK_EXIT_NORMAL || retval != 0) {
+			return bench_run_fail(run, "%s did not exit cleanly",
+			    app);
+		}
+	}
+	bench_run_stop(run);
+
+	return true;
+}
+
+benchmark_t benchmark_dl_start = {
+	.name = "dl_start",
+	.desc = "Start a dynamically linked program (optional 'app', "
+	    "started with -s).",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/** @}
+ */
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <errno.h>
+#include <fibril.h>
+#include <malloc.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../hbench.h"
+
+/*
+ * Futex contention benchmark. 'threads' fibrils (default 4), each running
+ * in its own thread, allocate and free small blocks in a tight loop, so
+ * that they all compete for the heap lock. The workload size is the total
+ * number of allocations. Run with threads=1, 2, ... N to see how lock
+ * throughput scales with contention.
+ */
+
+/** Maximum number of threads */
+#define THREADS_MAX  64
+
+/** Size of allocated blocks */
+#define BLOCK_SIZE  32
+
+typedef struct {
+	/** Allocations per fibril */
+	uint64_t count;
+	/** Number of fibrils not finished yet */
+	atomic_int left;
+	/** Number of failed allocations */
+	atomic_int failed;
+} shared_t;
+
+/** Number of runner threads spawned so far besides the main one */
+static int runners;
+
+static errno_t worker(void *arg)
+{
+	shared_t *shared = arg;
+	void *p;
+
+	fibril_detach(fibril_get_id());
+
+	for (uint64_t i = 0; i < shared->count; i++) {
+		p = malloc(BLOCK_SIZE);
+		if (p == NULL)
+			atomic_fetch_add(&shared->failed, 1);
+		free(p);
+	}
+
+	atomic_fetch_sub(&shared->left, 1);
+	return EOK;
+}
+
+/** Execute futex contention benchmark. */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	futex_stats_t before;
+	futex_stats_t after;
+	shared_t shared;
+	unsigned long threads;
+	uint64_t contended;
+	const char *str;
+	fid_t fid;
+	usec_t usec;
+	bool ok = true;
+
+	str = bench_env_param_get(env, "threads", "4");
+	threads = strtoul(str, NULL, 10);
+
+	if (threads == 0 || threads > THREADS_MAX) {
+		return bench_run_fail(run, "'threads' must be between 1 "
+		    "and %u.", THREADS_MAX);
+	}
+
+	/* Runner threads cannot be stopped, only spawn the missing ones */
+	if ((unsigned long) runners < threads - 1) {
+		runners += fibril_test_spawn_runners(threads - 1 - runners);
+		if ((unsigned long) runners < threads - 1) {
+			return bench_run_fail(run, "failed spawning %lu threads.",
+			    threads - 1);
+		}
+	}
+
+	shared.count = size / threads;
+	atomic_store(&shared.left, 0);
+	atomic_store(&shared.failed, 0);
+
+	heap_lock_stats(&before);
+	bench_run_start(run);
+
+	for (unsigned long i = 0; i < threads; i++) {
+		fid = fibril_create(worker, &shared);
+		if (fid == 0) {
+			ok = bench_run_fail(run, "failed creating fibril.");
+			break;
+		}
+
+		atomic_fetch_add(&shared.left, 1);
+		fibril_add_ready(fid);
+	}
+
+	while (atomic_load(&shared.left) > 0)
+		fibril_yield();
+
+	bench_run_stop(run);
+	heap_lock_stats(&after);
+
+	if (!ok)
+		return false;
+
+	if (atomic_load(&shared.failed) > 0)
+		return bench_run_fail(run, "out of memory.");
+
+	contended = after.contended - before.contended;
+	usec = NSEC2USEC(stopwatch_get_nanos(&run->stopwatch));
+	printf("futex_contention: %lu threads, %" PRIu64 " acquisitions, "
+	    "%" PRIu64 " contended, %" PRIu64 " spins/contended, "
+	    "%" PRIu64 " sleeps, %" PRIu64 " allocations/s\n", threads,
+	    after.acquisitions - before.acquisitions, contended,
+	    contended != 0 ? (after.spins - before.spins) / contended : 0,
+	    after.sleeps - before.sleeps,
+	    usec != 0 ? shared.count * threads * 1000000 / (uint64_t) usec : 0);
+
+	return true;
+}
+
+benchmark_t benchmark_futex_contention = {
+	.name = "futex_contention",
+	.desc = "Allocate memory from several threads at once, competing "
+	    "for the heap lock (optional 'threads').",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/** @}
+ */
@@ -117,6 +117,9 @@ errno_t conn_open(const char *hostport)
 	if (rc != EOK)
 		goto error;
 
+	/* Send keystrokes as they are typed */
+	(void) tcp_conn_set_nodelay(conn, true);
+
 	return EOK;
 error:
 	tcp_conn_destroy(conn);
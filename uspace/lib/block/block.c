@@ -52,6 +52,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stacktrace.h>
+#include <stdatomic.h>
 #include <str_error.h>
 #include <offset.h>
 #include <inttypes.h>
@@ -59,20 +60,140 @@
 
 #define MAX_WRITE_RETRIES 10
 
+/** Maximum readahead window in logical blocks */
+#define RA_MAX_BLOCKS	8
+/** Maximum size of a single readahead transfer in bytes */
+#define RA_MAX_BYTES	(64 * 1024)
+
+/** Write-behind period in microseconds */
+#define WB_INTERVAL	500000
+/** Number of released dirty blocks that wakes up write-behind early */
+#define WB_BATCH	8
+/** Maximum size of a single write-behind pass in bytes */
+#define WB_MAX_BYTES	(128 * 1024)
+
 /** Lock protecting the device connection list */
 static FIBRIL_MUTEX_INITIALIZE(dcl_lock);
 /** Device connection list head. */
 static LIST_INITIALIZE(dcl);
 
+/** Number of cache shards (must be a power of two) */
+#define CACHE_SHARDS	8
+/** Default cache size in bytes, used if the client does not specify one */
+#define CACHE_DEFAULT_SIZE	(512 * 1024)
+/** Minimum number of blocks per shard */
+#define CACHE_SHARD_MIN_BLOCKS	8
+/** Maximum number of blocks allocated at once */
+#define CACHE_SLAB_BLOCKS	32
+/** Maximum size of a slab in bytes */
+#define CACHE_SLAB_SIZE	(128 * 1024)
+
+/** Replacement policy queues.
+ *
+ * The cache uses the 2Q replacement policy. Blocks referenced for the first
+ * time enter the A1in FIFO. When evicted from A1in, their addresses are
+ * remembered in the A1out ghost FIFO. Only blocks that miss while still
+ * remembered in A1out enter the Am LRU queue. Further references to a block
+ * in A1in are considered correlated and do not move it. Large sequential
+ * scans thus only cycle through A1in and do not push frequently used (e.g.
+ * metadata) blocks out of Am.
+ */
+enum cache_queue {
+	/** The block is not on any queue */
+	CACHE_Q_NONE,
+	/** Blocks referenced once, oldest first */
+	CACHE_Q_A1IN,
+	/** Blocks read ahead and not referenced yet, on the A1in list */
+	CACHE_Q_A1IN_RA,
+	/** Blocks referenced repeatedly, least recently used first */
+	CACHE_Q_AM
+};
+
+/** Ghost entry remembering the address of a block evicted from A1in */
+typedef struct {
+	/** Link for placing the entry into the ghost hash table */
+	ht_link_t hash_link;
+	/** Link for placing the entry on the A1out or free list */
+	link_t link;
+	/** Logical block address */
+	aoff64_t lba;
+} cache_ghost_t;
+
+/** Cache shard.
+ *
+ * Blocks are distributed among shards by their logical address. Each shard
+ * has its own lock, hash table and replacement policy state so that
+ * concurrent block_get() and block_put() operations on different blocks
+ * rarely contend.
+ */
 typedef struct {
+	fibril_mutex_t lock;
+	hash_table_t block_hash;
+	list_t a1in;              /**< A1in queue */
+	list_t am;                /**< Am queue */
+	size_t a1in_count;        /**< Number of blocks in A1in */
+	size_t blocks_cached;     /**< Number of cached blocks. */
+	hash_table_t ghost_hash;
+	list_t a1out;             /**< A1out ghost queue */
+	list_t ghost_free;        /**< Unused ghost entries */
+	cache_ghost_t *ghosts;    /**< Array of all ghost entries */
+	/** Incremented whenever a block leaves the shard */
+	atomic_uint gen;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t ghost_hits;
+	uint64_t evictions;
+} cache_shard_t;
+
+/** Slab of block structures and block buffers */
+typedef struct {
+	link_t link;
+	block_t *blocks;
+	void *data;
+} cache_slab_t;
+
+typedef struct {
+	/** Lock protecting readahead and write-behind state */
 	fibril_mutex_t lock;
 	size_t lblock_size;       /**< Logical block size. */
 	unsigned blocks_cluster;  /**< Physical blocks per block_t */
 	unsigned block_count;     /**< Total number of blocks. */
-	unsigned blocks_cached;   /**< Number of cached blocks. */
-	hash_table_t block_hash;
-	list_t free_list;
+	size_t shard_blocks;      /**< Number of blocks per shard. */
+	size_t a1in_max;          /**< Target size of A1in per shard. */
+	size_t ghosts_max;        /**< Size of A1out per shard. */
 	enum cache_mode mode;
+	cache_shard_t shards[CACHE_SHARDS];
+
+	/** Lock protecting the slab lists */
+	fibril_mutex_t slab_lock;
+	/** All slabs */
+	list_t slabs;
+	/** Unused blocks in all slabs */
+	list_t slab_free;
+	/** Number of blocks per slab */
+	size_t slab_blocks;
+
+	/** Readahead: LBA expected to miss next if the streak continues */
+	aoff64_t ra_next;
+	/** Readahead: LBA of the last cache miss */
+	aoff64_t ra_last;
+	/** Readahead: current window size in logical blocks */
+	unsigned ra_window;
+	/** Readahead: maximum window size in logical blocks */
+	unsigned ra_max;
+	/** Number of blocks read ahead */
+	uint64_t ra_blocks;
+
+	/** Write-behind: signalled to wake up or to confirm termination */
+	fibril_condvar_t wb_cv;
+	/** Write-behind: dirty blocks released since the last pass */
+	unsigned wb_pending;
+	/** Write-behind: fibril has been asked to terminate */
+	bool wb_stop;
+	/** Write-behind: fibril is running */
+	bool wb_running;
+	/** Number of blocks written back */
+	uint64_t wb_blocks;
 } cache_t;
 
 typedef struct {
@@ -90,6 +211,8 @@ typedef struct {
 static errno_t read_blocks(devcon_t *, aoff64_t, size_t, void *, size_t);
 static errno_t write_blocks(devcon_t *, aoff64_t, size_t, void *, size_t);
 static aoff64_t ba_ltop(devcon_t *, aoff64_t);
+static errno_t cache_flush(devcon_t *);
+static errno_t cache_wb_fibril(void *);
 
 static devcon_t *devcon_search(service_id_t service_id)
 {
@@ -244,13 +367,13 @@ void *block_bb_get(service_id_t service_id)
 static size_t cache_key_hash(const void *key)
 {
 	const aoff64_t *lba = key;
-	return *lba;
+	return *lba / CACHE_SHARDS;
 }
 
 static size_t cache_hash(const ht_link_t *item)
 {
 	block_t *b = hash_table_get_inst(item, block_t, hash_link);
-	return b->lba;
+	return b->lba / CACHE_SHARDS;
 }
 
 static bool cache_key_equal(const void *key, size_t hash, const ht_link_t *item)
@@ -268,40 +391,447 @@ static const hash_table_ops_t cache_ops = {
 	.remove_callback = NULL
 };
 
+static size_t ghost_key_hash(const void *key)
+{
+	const aoff64_t *lba = key;
+	return *lba / CACHE_SHARDS;
+}
+
+static size_t ghost_hash(const ht_link_t *item)
+{
+	cache_ghost_t *g = hash_table_get_inst(item, cache_ghost_t, hash_link);
+	return g->lba / CACHE_SHARDS;
+}
+
+static bool ghost_key_equal(const void *key, size_t hash, const ht_link_t *item)
+{
+	const aoff64_t *lba = key;
+	cache_ghost_t *g = hash_table_get_inst(item, cache_ghost_t, hash_link);
+	return g->lba == *lba;
+}
+
+static const hash_table_ops_t ghost_ops = {
+	.hash = ghost_hash,
+	.key_hash = ghost_key_hash,
+	.key_equal = ghost_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Get the cache shard holding a block. */
+static cache_shard_t *cache_shard(cache_t *cache, aoff64_t lba)
+{
+	return &cache->shards[lba & (CACHE_SHARDS - 1)];
+}
+
+/** Initialize a cache shard.
+ *
+ * @param cache		Cache.
+ * @param shard		Shard.
+ *
+ * @return		EOK on success or ENOMEM.
+ */
+static errno_t cache_shard_init(cache_t *cache, cache_shard_t *shard)
+{
+	size_t i;
+
+	fibril_mutex_initialize(&shard->lock);
+	list_initialize(&shard->a1in);
+	list_initialize(&shard->am);
+	list_initialize(&shard->a1out);
+	list_initialize(&shard->ghost_free);
+	shard->a1in_count = 0;
+	shard->blocks_cached = 0;
+	shard->hits = 0;
+	shard->misses = 0;
+	shard->ghost_hits = 0;
+	shard->evictions = 0;
+	atomic_store(&shard->gen, 0);
+
+	shard->ghosts = calloc(cache->ghosts_max, sizeof(cache_ghost_t));
+	if (shard->ghosts == NULL)
+		return ENOMEM;
+
+	for (i = 0; i < cache->ghosts_max; i++) {
+		link_initialize(&shard->ghosts[i].link);
+		list_append(&shard->ghosts[i].link, &shard->ghost_free);
+	}
+
+	if (!hash_table_create(&shard->block_hash, 0, 0, &cache_ops)) {
+		free(shard->ghosts);
+		return ENOMEM;
+	}
+
+	if (!hash_table_create(&shard->ghost_hash, 0, 0, &ghost_ops)) {
+		hash_table_destroy(&shard->block_hash);
+		free(shard->ghosts);
+		return ENOMEM;
+	}
+
+	return EOK;
+}
+
+/** Finalize a cache shard. */
+static void cache_shard_fini(cache_shard_t *shard)
+{
+	hash_table_destroy(&shard->ghost_hash);
+	hash_table_destroy(&shard->block_hash);
+	free(shard->ghosts);
+}
+
+/** Allocate a block structure with buffer from the slab allocator.
+ *
+ * Blocks are allocated in slabs, with the buffers of all blocks in a slab
+ * forming one contiguous area. Blocks are never returned to the heap before
+ * block_cache_fini().
+ *
+ * @param cache		Cache.
+ *
+ * @return		Block or NULL if out of memory.
+ */
+static block_t *cache_slab_alloc(cache_t *cache)
+{
+	cache_slab_t *slab;
+	block_t *b;
+	size_t i;
+
+	fibril_mutex_lock(&cache->slab_lock);
+
+	if (list_empty(&cache->slab_free)) {
+		slab = calloc(1, sizeof(cache_slab_t));
+		if (slab == NULL) {
+			fibril_mutex_unlock(&cache->slab_lock);
+			return NULL;
+		}
+
+		slab->blocks = calloc(cache->slab_blocks, sizeof(block_t));
+		slab->data = malloc(cache->slab_blocks * cache->lblock_size);
+		if (slab->blocks == NULL || slab->data == NULL) {
+			free(slab->blocks);
+			free(slab->data);
+			free(slab);
+			fibril_mutex_unlock(&cache->slab_lock);
+			return NULL;
+		}
+
+		for (i = 0; i < cache->slab_blocks; i++) {
+			b = &slab->blocks[i];
+			b->data = slab->data + i * cache->lblock_size;
+			link_initialize(&b->free_link);
+			list_append(&b->free_link, &cache->slab_free);
+		}
+
+		list_append(&slab->link, &cache->slabs);
+	}
+
+	b = list_get_instance(list_first(&cache->slab_free), block_t,
+	    free_link);
+	list_remove(&b->free_link);
+
+	fibril_mutex_unlock(&cache->slab_lock);
+	return b;
+}
+
+/** Return a block structure to the slab allocator. */
+static void cache_slab_free(cache_t *cache, block_t *b)
+{
+	fibril_mutex_lock(&cache->slab_lock);
+	list_append(&b->free_link, &cache->slab_free);
+	fibril_mutex_unlock(&cache->slab_lock);
+}
+
+/** Put a newly instantiated block on a replacement policy queue.
+ *
+ * Must be called with the shard lock held.
+ *
+ * @param shard		Cache shard.
+ * @param b		Block.
+ * @param queue		Queue.
+ */
+static void cache_enqueue(cache_shard_t *shard, block_t *b,
+    enum cache_queue queue)
+{
+	b->queue = queue;
+	if (queue == CACHE_Q_AM) {
+		list_append(&b->free_link, &shard->am);
+	} else {
+		list_append(&b->free_link, &shard->a1in);
+		shard->a1in_count++;
+	}
+}
+
+/** Take a block off its replacement policy queue.
+ *
+ * Must be called with the shard lock held.
+ */
+static void cache_dequeue(cache_shard_t *shard, block_t *b)
+{
+	list_remove(&b->free_link);
+	if (b->queue == CACHE_Q_A1IN || b->queue == CACHE_Q_A1IN_RA)
+		shard->a1in_count--;
+	b->queue = CACHE_Q_NONE;
+}
+
+/** Update the replacement policy state on a cache hit.
+ *
+ * Must be called with the shard lock held, after the reference count has
+ * been incremented.
+ */
+static void cache_touch(cache_shard_t *shard, block_t *b)
+{
+	switch (b->queue) {
+	case CACHE_Q_A1IN_RA:
+		/* First reference to a block read ahead */
+		b->queue = CACHE_Q_A1IN;
+		break;
+	case CACHE_Q_A1IN:
+		/* Correlated reference, only an A1out hit promotes to Am */
+		break;
+	case CACHE_Q_AM:
+		list_remove(&b->free_link);
+		list_append(&b->free_link, &shard->am);
+		break;
+	default:
+		assert(false);
+	}
+}
+
+/** Remember the address of a block evicted from A1in.
+ *
+ * Must be called with the shard lock held.
+ */
+static void cache_ghost_add(cache_shard_t *shard, aoff64_t lba)
+{
+	cache_ghost_t *g;
+
+	if (!list_empty(&shard->ghost_free)) {
+		g = list_get_instance(list_first(&shard->ghost_free),
+		    cache_ghost_t, link);
+	} else if (!list_empty(&shard->a1out)) {
+		/* Forget the oldest entry. */
+		g = list_get_instance(list_first(&shard->a1out),
+		    cache_ghost_t, link);
+		hash_table_remove_item(&shard->ghost_hash, &g->hash_link);
+	} else {
+		return;
+	}
+
+	list_remove(&g->link);
+	g->lba = lba;
+	list_append(&g->link, &shard->a1out);
+	hash_table_insert(&shard->ghost_hash, &g->hash_link);
+}
+
+/** Check for and forget the ghost entry of a block.
+ *
+ * Must be called with the shard lock held.
+ *
+ * @return		True if the block was evicted from A1in recently.
+ */
+static bool cache_ghost_take(cache_shard_t *shard, aoff64_t lba)
+{
+	ht_link_t *hlink;
+	cache_ghost_t *g;
+
+	hlink = hash_table_find(&shard->ghost_hash, &lba);
+	if (hlink == NULL)
+		return false;
+
+	g = hash_table_get_inst(hlink, cache_ghost_t, hash_link);
+	hash_table_remove_item(&shard->ghost_hash, &g->hash_link);
+	list_remove(&g->link);
+	list_append(&g->link, &shard->ghost_free);
+	return true;
+}
+
+/** Find an unreferenced block on a queue.
+ *
+ * @param queue		Queue to search.
+ * @param clean		Only consider clean blocks.
+ *
+ * @return		Block or NULL if there is none.
+ */
+static block_t *cache_queue_victim(list_t *queue, bool clean)
+{
+	list_foreach(*queue, free_link, block_t, b) {
+		if (b->refcnt == 0 && (!clean || !b->dirty))
+			return b;
+	}
+
+	return NULL;
+}
+
+/** Select a block to evict from a shard.
+ *
+ * Blocks are taken from A1in if it is over its target size, otherwise from
+ * Am. Referenced blocks are skipped. The reference count only changes with
+ * the shard lock held, so it can be examined without the block lock.
+ *
+ * Must be called with the shard lock held.
+ *
+ * @param cache		Cache.
+ * @param shard		Cache shard.
+ * @param clean		Only consider clean blocks.
+ *
+ * @return		Block or NULL if there is none.
+ */
+static block_t *cache_victim(cache_t *cache, cache_shard_t *shard, bool clean)
+{
+	list_t *first;
+	list_t *second;
+	block_t *b;
+
+	if (shard->a1in_count > cache->a1in_max || list_empty(&shard->am)) {
+		first = &shard->a1in;
+		second = &shard->am;
+	} else {
+		first = &shard->am;
+		second = &shard->a1in;
+	}
+
+	b = cache_queue_victim(first, clean);
+	if (b == NULL)
+		b = cache_queue_victim(second, clean);
+
+	return b;
+}
+
+/** Evict a clean unreferenced block from a shard.
+ *
+ * The block is removed from the hash table and from its queue, but not
+ * returned to the slab allocator so that it can be reused right away.
+ *
+ * Must be called with the shard lock held.
+ */
+static void cache_evict(cache_shard_t *shard, block_t *b)
+{
+	assert(b->refcnt == 0);
+
+	if (b->queue == CACHE_Q_A1IN)
+		cache_ghost_add(shard, b->lba);
+	cache_dequeue(shard, b);
+	hash_table_remove_item(&shard->block_hash, &b->hash_link);
+	atomic_fetch_add(&shard->gen, 1);
+	shard->evictions++;
+}
+
 errno_t block_cache_init(service_id_t service_id, size_t size, unsigned blocks,
     enum cache_mode mode)
 {
 	devcon_t *devcon = devcon_search(service_id);
 	cache_t *cache;
+	size_t capacity;
+	unsigned i;
+	errno_t rc;
+
 	if (!devcon)
 		return ENOENT;
 	if (devcon->cache)
 		return EEXIST;
-	cache = malloc(sizeof(cache_t));
+	if (size == 0)
+		return EINVAL;
+
+	/* Allow 1:1 or small-to-large block size translation */
+	if (size % devcon->pblock_size != 0)
+		return ENOTSUP;
+
+	cache = calloc(1, sizeof(cache_t));
 	if (!cache)
 		return ENOMEM;
 
+	capacity = blocks;
+	if (capacity == 0)
+		capacity = CACHE_DEFAULT_SIZE / size;
+	capacity = max(capacity, CACHE_SHARDS * CACHE_SHARD_MIN_BLOCKS);
+
 	fibril_mutex_initialize(&cache->lock);
-	list_initialize(&cache->free_list);
 	cache->lblock_size = size;
-	cache->block_count = blocks;
-	cache->blocks_cached = 0;
+	cache->blocks_cluster = cache->lblock_size / devcon->pblock_size;
+	cache->shard_blocks = (capacity + CACHE_SHARDS - 1) / CACHE_SHARDS;
+	cache->block_count = cache->shard_blocks * CACHE_SHARDS;
+	cache->a1in_max = max(cache->shard_blocks / 4, 1);
+	cache->ghosts_max = max(cache->shard_blocks / 2, 1);
 	cache->mode = mode;
 
-	/* Allow 1:1 or small-to-large block size translation */
-	if (cache->lblock_size % devcon->pblock_size != 0) {
-		free(cache);
-		return ENOTSUP;
+	fibril_mutex_initialize(&cache->slab_lock);
+	list_initialize(&cache->slabs);
+	list_initialize(&cache->slab_free);
+	cache->slab_blocks = max(min(CACHE_SLAB_BLOCKS,
+	    CACHE_SLAB_SIZE / size), 1);
+
+	cache->ra_next = 0;
+	cache->ra_last = 0;
+	cache->ra_window = 0;
+	cache->ra_max = min(RA_MAX_BLOCKS, RA_MAX_BYTES / size);
+	if (cache->ra_max < 1)
+		cache->ra_max = 1;
+
+	fibril_condvar_initialize(&cache->wb_cv);
+	cache->wb_pending = 0;
+	cache->wb_stop = false;
+	cache->wb_running = false;
+
+	for (i = 0; i < CACHE_SHARDS; i++) {
+		rc = cache_shard_init(cache, &cache->shards[i]);
+		if (rc != EOK) {
+			while (i > 0)
+				cache_shard_fini(&cache->shards[--i]);
+			free(cache);
+			return rc;
+		}
 	}
 
-	cache->blocks_cluster = cache->lblock_size / devcon->pblock_size;
+	devcon->cache = cache;
 
-	if (!hash_table_create(&cache->block_hash, 0, 0, &cache_ops)) {
-		free(cache);
-		return ENOMEM;
+	if (mode == CACHE_MODE_WB) {
+		/*
+		 * Dirty blocks are written back in the background so that
+		 * adjacent blocks can be coalesced into larger transfers.
+		 * Without the fibril they are still written back when
+		 * recycled, so failing to create it is not fatal.
+		 */
+		fid_t fid = fibril_create(cache_wb_fibril, devcon);
+		if (fid != 0) {
+			cache->wb_running = true;
+			fibril_add_ready(fid);
+		}
+	}
+
+	return EOK;
+}
+
+/** Write back and drop all blocks of a shard.
+ *
+ * @param devcon	Device connection.
+ * @param shard		Cache shard.
+ * @param queue		Queue to drain.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t cache_drain(devcon_t *devcon, cache_shard_t *shard,
+    list_t *queue)
+{
+	cache_t *cache = devcon->cache;
+	errno_t rc;
+
+	while (!list_empty(queue)) {
+		block_t *b = list_get_instance(list_first(queue), block_t,
+		    free_link);
+
+		if (b->dirty) {
+			rc = write_blocks(devcon, b->pba, cache->blocks_cluster,
+			    b->data, b->size);
+			if (rc != EOK)
+				return rc;
+			b->dirty = false;
+		}
+
+		cache_dequeue(shard, b);
+		hash_table_remove_item(&shard->block_hash, &b->hash_link);
+		atomic_fetch_add(&shard->gen, 1);
+		shard->blocks_cached--;
 	}
 
-	devcon->cache = cache;
 	return EOK;
 }
 
@@ -309,6 +839,7 @@ errno_t block_cache_fini(service_id_t service_id)
 {
 	devcon_t *devcon = devcon_search(service_id);
 	cache_t *cache;
+	unsigned i;
 	errno_t rc;
 
 	if (!devcon)
@@ -317,45 +848,93 @@ errno_t block_cache_fini(service_id_t service_id)
 		return EOK;
 	cache = devcon->cache;
 
+	/* Stop the write-behind fibril and wait for it to terminate. */
+	fibril_mutex_lock(&cache->lock);
+	cache->wb_stop = true;
+	fibril_condvar_broadcast(&cache->wb_cv);
+	while (cache->wb_running)
+		fibril_condvar_wait(&cache->wb_cv, &cache->lock);
+	fibril_mutex_unlock(&cache->lock);
+
+	/* Write back as much as possible using coalesced transfers. */
+	(void) cache_flush(devcon);
+
 	/*
-	 * We are expecting to find all blocks for this device handle on the
-	 * free list, i.e. the block reference count should be zero. Do not
-	 * bother with the cache and block locks because we are single-threaded.
+	 * We are expecting all blocks for this device handle to be
+	 * unreferenced. Do not bother with the cache and block locks because
+	 * we are single-threaded.
 	 */
-	while (!list_empty(&cache->free_list)) {
-		block_t *b = list_get_instance(list_first(&cache->free_list),
-		    block_t, free_link);
+	for (i = 0; i < CACHE_SHARDS; i++) {
+		cache_shard_t *shard = &cache->shards[i];
 
-		list_remove(&b->free_link);
-		if (b->dirty) {
-			rc = write_blocks(devcon, b->pba, cache->blocks_cluster,
-			    b->data, b->size);
-			if (rc != EOK)
-				return rc;
-		}
+		rc = cache_drain(devcon, shard, &shard->a1in);
+		if (rc != EOK)
+			return rc;
+		rc = cache_drain(devcon, shard, &shard->am);
+		if (rc != EOK)
+			return rc;
+	}
+
+	for (i = 0; i < CACHE_SHARDS; i++)
+		cache_shard_fini(&cache->shards[i]);
 
-		hash_table_remove_item(&cache->block_hash, &b->hash_link);
+	while (!list_empty(&cache->slabs)) {
+		cache_slab_t *slab = list_get_instance(list_first(&cache->slabs),
+		    cache_slab_t, link);
 
-		free(b->data);
-		free(b);
+		list_remove(&slab->link);
+		free(slab->data);
+		free(slab->blocks);
+		free(slab);
 	}
 
-	hash_table_destroy(&cache->block_hash);
 	devcon->cache = NULL;
 	free(cache);
 
 	return EOK;
 }
 
-#define CACHE_LO_WATERMARK	10
-#define CACHE_HI_WATERMARK	20
-static bool cache_can_grow(cache_t *cache)
+/** Get block cache statistics.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param stats		Place to store the statistics.
+ *
+ * @return		EOK on success or an error code.
+ */
+errno_t block_cache_get_stats(service_id_t service_id,
+    block_cache_stats_t *stats)
 {
-	if (cache->blocks_cached < CACHE_LO_WATERMARK)
-		return true;
-	if (!list_empty(&cache->free_list))
-		return false;
-	return true;
+	devcon_t *devcon = devcon_search(service_id);
+	cache_t *cache;
+	unsigned i;
+
+	if (!devcon)
+		return ENOENT;
+	if (!devcon->cache)
+		return ENOENT;
+	cache = devcon->cache;
+
+	memset(stats, 0, sizeof(block_cache_stats_t));
+	stats->capacity = cache->block_count;
+
+	for (i = 0; i < CACHE_SHARDS; i++) {
+		cache_shard_t *shard = &cache->shards[i];
+
+		fibril_mutex_lock(&shard->lock);
+		stats->blocks += shard->blocks_cached;
+		stats->hits += shard->hits;
+		stats->misses += shard->misses;
+		stats->ghost_hits += shard->ghost_hits;
+		stats->evictions += shard->evictions;
+		fibril_mutex_unlock(&shard->lock);
+	}
+
+	fibril_mutex_lock(&cache->lock);
+	stats->readahead = cache->ra_blocks;
+	stats->writebacks = cache->wb_blocks;
+	fibril_mutex_unlock(&cache->lock);
+
+	return EOK;
 }
 
 static void block_initialize(block_t *b)
@@ -367,6 +946,131 @@ static void block_initialize(block_t *b)
 	b->toxic = false;
 	fibril_rwlock_initialize(&b->contents_lock);
 	link_initialize(&b->free_link);
+	b->queue = CACHE_Q_NONE;
+}
+
+/** Update readahead state on a cache miss.
+ *
+ * A miss on the block that immediately follows the previous miss or the
+ * previous readahead continues a sequential streak and doubles the readahead
+ * window. Any other miss halves the window, so that random access quickly
+ * falls back to reading single blocks.
+ *
+ * @param devcon	Device connection.
+ * @param ba		Logical address of the block that missed.
+ *
+ * @return		Number of logical blocks to read starting with @a ba.
+ */
+static unsigned cache_ra_update(devcon_t *devcon, aoff64_t ba)
+{
+	cache_t *cache = devcon->cache;
+	unsigned cnt;
+	unsigned i;
+
+	fibril_mutex_lock(&cache->lock);
+
+	if (ba == cache->ra_next || ba == cache->ra_last + 1) {
+		if (cache->ra_window == 0)
+			cache->ra_window = 2;
+		else
+			cache->ra_window = min(2 * cache->ra_window,
+			    cache->ra_max);
+	} else {
+		cache->ra_window /= 2;
+	}
+
+	cache->ra_last = ba;
+	cnt = min(max(cache->ra_window, 1), cache->ra_max);
+
+	/* Do not read beyond the end of the device. */
+	for (i = 1; i < cnt; i++) {
+		if (ba_ltop(devcon, ba + i) + cache->blocks_cluster >=
+		    devcon->pblocks)
+			break;
+	}
+
+	cache->ra_next = ba + i;
+	fibril_mutex_unlock(&cache->lock);
+
+	return i;
+}
+
+/** Insert a block obtained by readahead into the cache.
+ *
+ * The block is put on A1in with no references. Only clean blocks are evicted
+ * to make room for it so that readahead never has to write anything back.
+ *
+ * If any block left the shard while the readahead was in progress, the
+ * data may be stale: the block might have been cached and modified when
+ * the device was read and written back afterwards. The data is dropped
+ * in that case.
+ *
+ * @param devcon	Device connection.
+ * @param first		Logical address of the first block of the readahead.
+ * @param ba		Logical address of the block.
+ * @param data		Block data.
+ * @param gen		Generation of the block's shard before the device
+ *			was read.
+ *
+ * @return		False if there was no room for the block, true
+ *			otherwise.
+ */
+static bool cache_ra_insert(devcon_t *devcon, aoff64_t first, aoff64_t ba,
+    const void *data, unsigned gen)
+{
+	cache_t *cache = devcon->cache;
+	cache_shard_t *shard = cache_shard(cache, ba);
+	block_t *b = NULL;
+
+	fibril_mutex_lock(&shard->lock);
+	if (hash_table_find(&shard->block_hash, &ba) != NULL) {
+		/* Somebody else has instantiated the block meanwhile. */
+		fibril_mutex_unlock(&shard->lock);
+		return true;
+	}
+
+	if (atomic_load(&shard->gen) != gen) {
+		/* The data may be stale. */
+		fibril_mutex_unlock(&shard->lock);
+		return true;
+	}
+
+	if (shard->blocks_cached < cache->shard_blocks) {
+		b = cache_slab_alloc(cache);
+		if (b != NULL)
+			shard->blocks_cached++;
+	}
+
+	if (b == NULL) {
+		b = cache_victim(cache, shard, true);
+		/* Do not evict this very readahead. */
+		if (b != NULL && b->lba >= first && b->lba < ba)
+			b = NULL;
+		if (b != NULL)
+			cache_evict(shard, b);
+	}
+
+	if (b == NULL) {
+		fibril_mutex_unlock(&shard->lock);
+		return false;
+	}
+
+	block_initialize(b);
+	b->refcnt = 0;
+	b->service_id = devcon->service_id;
+	b->size = cache->lblock_size;
+	b->lba = ba;
+	b->pba = ba_ltop(devcon, b->lba);
+	memcpy(b->data, data, cache->lblock_size);
+	hash_table_insert(&shard->block_hash, &b->hash_link);
+	cache_enqueue(shard, b, CACHE_Q_A1IN_RA);
+	fibril_mutex_unlock(&shard->lock);
+
+	fibril_mutex_lock(&cache->lock);
+	cache->ra_blocks++;
+	fibril_mutex_unlock(&cache->lock);
+
+	return true;
 }
 
 /** Instantiate a block in memory and get a reference to it.
@@ -385,9 +1089,14 @@ errno_t block_get(block_t **block, service_id_t service_id, aoff64_t ba, int fla
 {
 	devcon_t *devcon;
 	cache_t *cache;
+	cache_shard_t *shard;
 	block_t *b;
-	link_t *link;
 	aoff64_t p_ba;
+	unsigned ra_cnt;
+	unsigned ra_gen[RA_MAX_BLOCKS];
+	void *ra_buf;
+	unsigned i;
+	bool ghost;
 	errno_t rc;
 
 	devcon = devcon_search(service_id);
@@ -396,6 +1105,7 @@ errno_t block_get(block_t **block, service_id_t service_id, aoff64_t ba, int fla
 	assert(devcon->cache);
 
 	cache = devcon->cache;
+	shard = cache_shard(cache, ba);
 
 	/*
 	 * Check whether the logical block (or part of it) is beyond
@@ -411,154 +1121,191 @@ errno_t block_get(block_t **block, service_id_t service_id, aoff64_t ba, int fla
 retry:
 	rc = EOK;
 	b = NULL;
+	ra_cnt = 1;
+	ra_buf = NULL;
 
-	fibril_mutex_lock(&cache->lock);
-	ht_link_t *hlink = hash_table_find(&cache->block_hash, &ba);
+	fibril_mutex_lock(&shard->lock);
+	ht_link_t *hlink = hash_table_find(&shard->block_hash, &ba);
 	if (hlink) {
-	found:
 		/*
 		 * We found the block in the cache.
 		 */
 		b = hash_table_get_inst(hlink, block_t, hash_link);
 		fibril_mutex_lock(&b->lock);
-		if (b->refcnt++ == 0)
-			list_remove(&b->free_link);
+		b->refcnt++;
 		if (b->toxic)
 			rc = EIO;
 		fibril_mutex_unlock(&b->lock);
-		fibril_mutex_unlock(&cache->lock);
+		cache_touch(shard, b);
+		shard->hits++;
+		fibril_mutex_unlock(&shard->lock);
 	} else {
 		/*
 		 * The block was not found in the cache.
 		 */
-		if (cache_can_grow(cache)) {
+		if (shard->blocks_cached < cache->shard_blocks) {
 			/*
 			 * We can grow the cache by allocating new blocks.
 			 * Should the allocation fail, we fail over and try to
 			 * recycle a block from the cache.
 			 */
-			b = malloc(sizeof(block_t));
-			if (!b)
-				goto recycle;
-			b->data = malloc(cache->lblock_size);
-			if (!b->data) {
-				free(b);
-				b = NULL;
-				goto recycle;
-			}
-			cache->blocks_cached++;
-		} else {
+			b = cache_slab_alloc(cache);
+			if (b != NULL)
+				shard->blocks_cached++;
+		}
+
+		if (b == NULL) {
 			/*
-			 * Try to recycle a block from the free list.
+			 * Try to recycle a block selected by the replacement
+			 * policy.
 			 */
-		recycle:
-			if (list_empty(&cache->free_list)) {
-				fibril_mutex_unlock(&cache->lock);
-				rc = ENOMEM;
-				goto out;
-			}
-			link = list_first(&cache->free_list);
-			b = list_get_instance(link, block_t, free_link);
-
-			fibril_mutex_lock(&b->lock);
-			if (b->dirty) {
+			b = cache_victim(cache, shard, false);
+			if (b == NULL) {
 				/*
-				 * The block needs to be written back to the
-				 * device before it changes identity. Do this
-				 * while not holding the cache lock so that
-				 * concurrency is not impeded. Also move the
-				 * block to the end of the free list so that we
-				 * do not slow down other instances of
-				 * block_get() draining the free list.
+				 * All blocks are in use. Grow the cache over
+				 * its capacity, it will shrink back as the
+				 * blocks are released.
 				 */
-				list_remove(&b->free_link);
-				list_append(&b->free_link, &cache->free_list);
-				fibril_mutex_unlock(&cache->lock);
-				rc = write_blocks(devcon, b->pba,
-				    cache->blocks_cluster, b->data, b->size);
-				if (rc != EOK) {
+				b = cache_slab_alloc(cache);
+				if (b == NULL) {
+					fibril_mutex_unlock(&shard->lock);
+					rc = ENOMEM;
+					goto out;
+				}
+				shard->blocks_cached++;
+			} else {
+				fibril_mutex_lock(&b->lock);
+				if (b->dirty) {
 					/*
-					 * We did not manage to write the block
-					 * to the device. Keep it around for
-					 * another try. Hopefully, we will grab
-					 * another block next time.
+					 * The block needs to be written back to
+					 * the device before it changes
+					 * identity. Do this while not holding
+					 * the shard lock so that concurrency
+					 * is not impeded. Also move the block
+					 * to the end of its queue so that we
+					 * do not slow down other instances of
+					 * block_get() looking for a victim.
 					 */
-					if (b->write_failures < MAX_WRITE_RETRIES) {
-						b->write_failures++;
-						fibril_mutex_unlock(&b->lock);
-						goto retry;
-					} else {
-						printf("Too many errors writing block %"
-						    PRIuOFF64 "from device handle %" PRIun "\n"
-						    "SEVERE DATA LOSS POSSIBLE\n",
-						    b->lba, devcon->service_id);
-					}
-				} else
-					b->write_failures = 0;
-
-				b->dirty = false;
-				if (!fibril_mutex_trylock(&cache->lock)) {
+					enum cache_queue queue = b->queue;
+
+					cache_dequeue(shard, b);
+					cache_enqueue(shard, b, queue);
+					fibril_mutex_unlock(&shard->lock);
+					rc = write_blocks(devcon, b->pba,
+					    cache->blocks_cluster, b->data,
+					    b->size);
+					if (rc != EOK) {
+						/*
+						 * We did not manage to write
+						 * the block to the device.
+						 * Keep it around for another
+						 * try. Hopefully, we will grab
+						 * another block next time.
+						 */
+						if (b->write_failures <
+						    MAX_WRITE_RETRIES) {
+							b->write_failures++;
+							fibril_mutex_unlock(&b->lock);
+							goto retry;
+						} else {
+							printf("Too many errors writing block %"
+							    PRIuOFF64 "from device handle %" PRIun "\n"
+							    "SEVERE DATA LOSS POSSIBLE\n",
+							    b->lba, devcon->service_id);
+						}
+					} else
+						b->write_failures = 0;
+
 					/*
-					 * Somebody is probably racing with us.
-					 * Unlock the block and retry.
+					 * The situation may have changed while
+					 * we were not holding the shard lock.
+					 * Start over.
 					 */
+					b->dirty = false;
 					fibril_mutex_unlock(&b->lock);
 					goto retry;
 				}
-				hlink = hash_table_find(&cache->block_hash, &ba);
-				if (hlink) {
-					/*
-					 * Someone else must have already
-					 * instantiated the block while we were
-					 * not holding the cache lock.
-					 * Leave the recycled block on the
-					 * freelist and continue as if we
-					 * found the block of interest during
-					 * the first try.
-					 */
-					fibril_mutex_unlock(&b->lock);
-					goto found;
-				}
+				fibril_mutex_unlock(&b->lock);
 
+				cache_evict(shard, b);
 			}
-			fibril_mutex_unlock(&b->lock);
-
-			/*
-			 * Unlink the block from the free list and the hash
-			 * table.
-			 */
-			list_remove(&b->free_link);
-			hash_table_remove_item(&cache->block_hash, &b->hash_link);
 		}
 
+		ghost = cache_ghost_take(shard, ba);
+		if (ghost)
+			shard->ghost_hits++;
+		shard->misses++;
+
+		if (!(flags & BLOCK_FLAGS_NOREAD))
+			ra_cnt = cache_ra_update(devcon, ba);
+
 		block_initialize(b);
 		b->service_id = service_id;
 		b->size = cache->lblock_size;
 		b->lba = ba;
 		b->pba = ba_ltop(devcon, b->lba);
-		hash_table_insert(&cache->block_hash, &b->hash_link);
+		hash_table_insert(&shard->block_hash, &b->hash_link);
+		cache_enqueue(shard, b, ghost ? CACHE_Q_AM : CACHE_Q_A1IN);
 
 		/*
-		 * Lock the block before releasing the cache lock. Thus we don't
+		 * Lock the block before releasing the shard lock. Thus we don't
 		 * kill concurrent operations on the cache while doing I/O on
 		 * the block.
 		 */
 		fibril_mutex_lock(&b->lock);
-		fibril_mutex_unlock(&cache->lock);
+		fibril_mutex_unlock(&shard->lock);
 
 		if (!(flags & BLOCK_FLAGS_NOREAD)) {
 			/*
 			 * The block contains old or no data. We need to read
-			 * the new contents from the device.
+			 * the new contents from the device. If we are in
+			 * a sequential streak, read the following blocks
+			 * as well using a single transfer.
 			 */
-			rc = read_blocks(devcon, b->pba, cache->blocks_cluster,
-			    b->data, cache->lblock_size);
+			if (ra_cnt > 1)
+				ra_buf = malloc(ra_cnt * cache->lblock_size);
+			if (ra_buf != NULL) {
+				for (i = 1; i < ra_cnt; i++) {
+					ra_gen[i] = atomic_load(
+					    &cache_shard(cache, ba + i)->gen);
+				}
+
+				rc = read_blocks(devcon, b->pba,
+				    ra_cnt * cache->blocks_cluster, ra_buf,
+				    ra_cnt * cache->lblock_size);
+				if (rc == EOK) {
+					memcpy(b->data, ra_buf,
+					    cache->lblock_size);
+				} else {
+					free(ra_buf);
+					ra_buf = NULL;
+				}
+			}
+			if (ra_buf == NULL) {
+				rc = read_blocks(devcon, b->pba,
+				    cache->blocks_cluster, b->data,
+				    cache->lblock_size);
+			}
 			if (rc != EOK)
 				b->toxic = true;
 		} else
 			rc = EOK;
 
 		fibril_mutex_unlock(&b->lock);
+
+		/*
+		 * Populate the cache with the blocks read ahead. This must
+		 * not be done while holding the block lock as it requires
+		 * the shard locks.
+		 */
+		if (ra_buf != NULL) {
+			for (i = 1; i < ra_cnt; i++) {
+				if (!cache_ra_insert(devcon, ba, ba + i,
+				    ra_buf + i * cache->lblock_size, ra_gen[i]))
+					break;
+			}
+			free(ra_buf);
+		}
 	}
 out:
 	if ((rc != EOK) && b) {
@@ -572,7 +1319,8 @@ out:
 
 /** Release a reference to a block.
  *
- * If the last reference is dropped, the block is put on the free list.
+ * If the last reference is dropped, the block becomes a candidate for
+ * eviction.
  *
  * @param block		Block of which a reference is to be released.
  *
@@ -582,8 +1330,8 @@ errno_t block_put(block_t *block)
 {
 	devcon_t *devcon = devcon_search(block->service_id);
 	cache_t *cache;
-	unsigned blocks_cached;
-	enum cache_mode mode;
+	cache_shard_t *shard;
+	bool over;
 	errno_t rc = EOK;
 
 	assert(devcon);
@@ -591,25 +1339,25 @@ errno_t block_put(block_t *block)
 	assert(block->refcnt >= 1);
 
 	cache = devcon->cache;
+	shard = cache_shard(cache, block->lba);
 
 retry:
-	fibril_mutex_lock(&cache->lock);
-	blocks_cached = cache->blocks_cached;
-	mode = cache->mode;
-	fibril_mutex_unlock(&cache->lock);
+	fibril_mutex_lock(&shard->lock);
+	over = shard->blocks_cached > cache->shard_blocks;
+	fibril_mutex_unlock(&shard->lock);
 
 	/*
 	 * Determine whether to sync the block. Syncing the block is best done
-	 * when not holding the cache lock as it does not impede concurrency.
-	 * Since the situation may have changed when we unlocked the cache, the
-	 * blocks_cached and mode variables are mere hints. We will recheck the
-	 * conditions later when the cache lock is held again.
+	 * when not holding the shard lock as it does not impede concurrency.
+	 * Since the situation may have changed when we unlocked the shard, the
+	 * over variable is a mere hint. We will recheck the conditions later
+	 * when the shard lock is held again.
 	 */
 	fibril_mutex_lock(&block->lock);
 	if (block->toxic)
 		block->dirty = false;	/* will not write back toxic block */
 	if (block->dirty && (block->refcnt == 1) &&
-	    (blocks_cached > CACHE_HI_WATERMARK || mode != CACHE_MODE_WB)) {
+	    (over || cache->mode != CACHE_MODE_WB)) {
 		rc = write_blocks(devcon, block->pba, cache->blocks_cluster,
 		    block->data, block->size);
 		if (rc == EOK)
@@ -618,15 +1366,15 @@ retry:
 	}
 	fibril_mutex_unlock(&block->lock);
 
-	fibril_mutex_lock(&cache->lock);
+	fibril_mutex_lock(&shard->lock);
 	fibril_mutex_lock(&block->lock);
 	if (!--block->refcnt) {
 		/*
 		 * Last reference to the block was dropped. Either free the
-		 * block or put it on the free list. In case of an I/O error,
+		 * block or leave it in the cache. In case of an I/O error,
 		 * free the block.
 		 */
-		if ((cache->blocks_cached > CACHE_HI_WATERMARK) ||
+		if ((shard->blocks_cached > cache->shard_blocks) ||
 		    (rc != EOK)) {
 			/*
 			 * Currently there are too many cached blocks or there
@@ -636,14 +1384,14 @@ retry:
 			if (block->dirty) {
 				/*
 				 * We cannot sync the block while holding the
-				 * cache lock. Release everything and retry.
+				 * shard lock. Release everything and retry.
 				 */
 				block->refcnt++;
 
 				if (block->write_failures < MAX_WRITE_RETRIES) {
 					block->write_failures++;
 					fibril_mutex_unlock(&block->lock);
-					fibril_mutex_unlock(&cache->lock);
+					fibril_mutex_unlock(&shard->lock);
 					goto retry;
 				} else {
 					printf("Too many errors writing block %"
@@ -651,39 +1399,253 @@ retry:
 					    "SEVERE DATA LOSS POSSIBLE\n",
 					    block->lba, devcon->service_id);
 				}
+				block->refcnt--;
 			}
 			/*
 			 * Take the block out of the cache and free it.
 			 */
-			hash_table_remove_item(&cache->block_hash, &block->hash_link);
+			cache_dequeue(shard, block);
+			hash_table_remove_item(&shard->block_hash,
+			    &block->hash_link);
+			atomic_fetch_add(&shard->gen, 1);
 			fibril_mutex_unlock(&block->lock);
-			free(block->data);
-			free(block);
-			cache->blocks_cached--;
-			fibril_mutex_unlock(&cache->lock);
+			shard->blocks_cached--;
+			fibril_mutex_unlock(&shard->lock);
+			cache_slab_free(cache, block);
 			return rc;
 		}
 		/*
-		 * Put the block on the free list.
+		 * Leave the block in the cache.
 		 */
 		if (cache->mode != CACHE_MODE_WB && block->dirty) {
 			/*
-			 * We cannot sync the block while holding the cache
+			 * We cannot sync the block while holding the shard
 			 * lock. Release everything and retry.
 			 */
 			block->refcnt++;
 			fibril_mutex_unlock(&block->lock);
-			fibril_mutex_unlock(&cache->lock);
+			fibril_mutex_unlock(&shard->lock);
 			goto retry;
 		}
-		list_append(&block->free_link, &cache->free_list);
+
+		if (block->dirty) {
+			/* Let the write-behind fibril know there is work. */
+			fibril_mutex_lock(&cache->lock);
+			if (++cache->wb_pending >= WB_BATCH)
+				fibril_condvar_signal(&cache->wb_cv);
+			fibril_mutex_unlock(&cache->lock);
+		}
 	}
 	fibril_mutex_unlock(&block->lock);
+	fibril_mutex_unlock(&shard->lock);
+
+	return rc;
+}
+
+/** Block selected for write-behind */
+typedef struct {
+	/** Pinned block */
+	block_t *block;
+	/** Index of the snapshot of the block contents */
+	size_t slot;
+} cache_wb_ent_t;
+
+static int cache_flush_cmp(const void *a, const void *b)
+{
+	const cache_wb_ent_t *ea = a;
+	const cache_wb_ent_t *eb = b;
+
+	if (ea->block->lba < eb->block->lba)
+		return -1;
+	if (ea->block->lba > eb->block->lba)
+		return 1;
+	return 0;
+}
+
+/** Select dirty unreferenced blocks from a queue for write-behind.
+ *
+ * The contents of the blocks are copied while holding the shard lock, which
+ * guarantees that nobody holds a reference to them. The blocks are pinned
+ * until the write completes so that they cannot be evicted and read back
+ * from the device before their new contents get there.
+ *
+ * Must be called with the shard lock held.
+ */
+static void cache_flush_select(cache_t *cache, list_t *queue,
+    cache_wb_ent_t *ents, size_t *nents, size_t maxents, uint8_t *snap)
+{
+	list_foreach(*queue, free_link, block_t, b) {
+		if (*nents >= maxents)
+			break;
+
+		/*
+		 * The reference count is protected by the shard lock. Do not
+		 * wait for the lock of a referenced block while holding it.
+		 */
+		if (b->refcnt != 0)
+			continue;
+
+		fibril_mutex_lock(&b->lock);
+		if (b->dirty && !b->toxic &&
+		    b->write_failures < MAX_WRITE_RETRIES) {
+			memcpy(snap + *nents * cache->lblock_size, b->data,
+			    cache->lblock_size);
+			b->dirty = false;
+			b->refcnt++;
+			ents[*nents].block = b;
+			ents[*nents].slot = *nents;
+			(*nents)++;
+		}
+		fibril_mutex_unlock(&b->lock);
+	}
+}
+
+/** Write back one batch of dirty unreferenced blocks.
+ *
+ * Dirty blocks are sorted by address and runs of adjacent blocks are
+ * written with a single transfer.
+ *
+ * @param devcon	Device connection.
+ * @param nwritten	Place to store number of blocks written.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t cache_flush_batch(devcon_t *devcon, size_t *nwritten)
+{
+	cache_t *cache = devcon->cache;
+	size_t lbs = cache->lblock_size;
+	size_t bmax = max(WB_MAX_BYTES / lbs, 1);
+	cache_wb_ent_t *ents;
+	uint8_t *snap;
+	uint8_t *buf;
+	size_t nents;
+	size_t i, j, k;
+	errno_t rc = EOK;
+
+	*nwritten = 0;
+
+	ents = calloc(bmax, sizeof(cache_wb_ent_t));
+	snap = malloc(bmax * lbs);
+	buf = malloc(bmax * lbs);
+	if (ents == NULL || snap == NULL || buf == NULL) {
+		free(ents);
+		free(snap);
+		free(buf);
+		return ENOMEM;
+	}
+
+	nents = 0;
+	for (i = 0; i < CACHE_SHARDS; i++) {
+		cache_shard_t *shard = &cache->shards[i];
+
+		fibril_mutex_lock(&shard->lock);
+		cache_flush_select(cache, &shard->a1in, ents, &nents, bmax,
+		    snap);
+		cache_flush_select(cache, &shard->am, ents, &nents, bmax,
+		    snap);
+		fibril_mutex_unlock(&shard->lock);
+	}
+
+	qsort(ents, nents, sizeof(cache_wb_ent_t), cache_flush_cmp);
+
+	for (i = 0; i < nents; i = j) {
+		errno_t wrc;
+
+		for (j = i + 1; j < nents; j++) {
+			if (ents[j].block->lba != ents[j - 1].block->lba + 1)
+				break;
+		}
+
+		for (k = i; k < j; k++) {
+			memcpy(buf + (k - i) * lbs, snap + ents[k].slot * lbs,
+			    lbs);
+		}
+
+		wrc = write_blocks(devcon, ents[i].block->pba,
+		    (j - i) * cache->blocks_cluster, buf, (j - i) * lbs);
+		if (wrc != EOK) {
+			for (k = i; k < j; k++) {
+				block_t *b = ents[k].block;
+
+				fibril_mutex_lock(&b->lock);
+				b->dirty = true;
+				b->write_failures++;
+				fibril_mutex_unlock(&b->lock);
+			}
+			rc = wrc;
+		} else {
+			*nwritten += j - i;
+		}
+	}
+
+	for (i = 0; i < nents; i++)
+		(void) block_put(ents[i].block);
+
+	fibril_mutex_lock(&cache->lock);
+	cache->wb_blocks += *nwritten;
 	fibril_mutex_unlock(&cache->lock);
 
+	free(buf);
+	free(snap);
+	free(ents);
 	return rc;
 }
 
+/** Write back all dirty unreferenced blocks.
+ *
+ * @param devcon	Device connection.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t cache_flush(devcon_t *devcon)
+{
+	size_t nwritten;
+	errno_t rc;
+
+	do {
+		rc = cache_flush_batch(devcon, &nwritten);
+	} while (rc == EOK && nwritten > 0);
+
+	return rc;
+}
+
+/** Write-behind fibril.
+ *
+ * Periodically, or when enough dirty blocks have been released, writes
+ * dirty blocks back to the device.
+ *
+ * @param arg		Device connection.
+ *
+ * @return		EOK.
+ */
+static errno_t cache_wb_fibril(void *arg)
+{
+	devcon_t *devcon = (devcon_t *) arg;
+	cache_t *cache = devcon->cache;
+
+	fibril_mutex_lock(&cache->lock);
+	while (!cache->wb_stop) {
+		if (cache->wb_pending < WB_BATCH) {
+			(void) fibril_condvar_wait_timeout(&cache->wb_cv,
+			    &cache->lock, WB_INTERVAL);
+		}
+
+		if (cache->wb_stop || cache->wb_pending == 0)
+			continue;
+
+		cache->wb_pending = 0;
+		fibril_mutex_unlock(&cache->lock);
+		(void) cache_flush(devcon);
+		fibril_mutex_lock(&cache->lock);
+	}
+
+	cache->wb_running = false;
+	fibril_condvar_broadcast(&cache->wb_cv);
+	fibril_mutex_unlock(&cache->lock);
+
+	return EOK;
+}
+
 /** Read sequential data from a block device.
  *
  * @param service_id	Service ID of the block device.
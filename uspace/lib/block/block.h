@@ -83,8 +83,10 @@ typedef struct block {
 	size_t size;
 	/** Number of write failures. */
 	int write_failures;
-	/** Link for placing the block into the free block list. */
+	/** Link for placing the block on a replacement policy queue. */
 	link_t free_link;
+	/** Replacement policy queue the block is on. */
+	int queue;
 	/** Link for placing the block into the block hash table. */
 	ht_link_t hash_link;
 	/** Buffer with the block data. */
@@ -99,6 +101,26 @@ enum cache_mode {
 	CACHE_MODE_WB
 };
 
+/** Block cache statistics */
+typedef struct {
+	/** Number of cached blocks */
+	size_t blocks;
+	/** Cache capacity in blocks */
+	size_t capacity;
+	/** Number of block_get() calls satisfied from the cache */
+	uint64_t hits;
+	/** Number of block_get() calls that missed the cache */
+	uint64_t misses;
+	/** Number of misses on blocks evicted recently */
+	uint64_t ghost_hits;
+	/** Number of blocks evicted from the cache */
+	uint64_t evictions;
+	/** Number of blocks read ahead */
+	uint64_t readahead;
+	/** Number of blocks written back in the background */
+	uint64_t writebacks;
+} block_cache_stats_t;
+
 extern errno_t block_init(service_id_t);
 extern void block_fini(service_id_t);
 
@@ -107,6 +129,7 @@ extern void *block_bb_get(service_id_t);
 
 extern errno_t block_cache_init(service_id_t, size_t, unsigned, enum cache_mode);
 extern errno_t block_cache_fini(service_id_t);
+extern errno_t block_cache_get_stats(service_id_t, block_cache_stats_t *);
 
 extern errno_t block_get(block_t **, service_id_t, aoff64_t, int);
 extern errno_t block_put(block_t *);
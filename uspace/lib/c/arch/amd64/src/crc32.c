@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup libcamd64
+ * @{
+ */
+/** @file CRC-32 using carry-less multiplication.
+ *
+ * The data is folded 64 bytes at a time into four 128-bit remainders
+ * using the PCLMULQDQ instruction, these are then folded into one and
+ * reduced to 32 bits by Barrett reduction. The fold constants are powers
+ * of x modulo the (bit-reflected) CRC-32 polynomial, see Gopal et al.:
+ * Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+ * Instruction, Intel, 2009.
+ */
+
+#include <libarch/crc32.h>
+#include <mem.h>
+
+/** CPUID feature flag of PCLMULQDQ (leaf 1, ECX). */
+#define CPUID_ECX_PCLMUL  (1 << 1)
+
+/** Two 64-bit halves of an SSE register. */
+typedef uint64_t xmm_t __attribute__((vector_size(16)));
+
+#define CRC32_TARGET  __attribute__((target("sse2,pclmul")))
+
+/** x^(4*128+32) mod P, x^(4*128-32) mod P */
+static const uint64_t k1k2[2] = { 0x0154442bd4, 0x01c6e41596 };
+/** x^(128+32) mod P, x^(128-32) mod P */
+static const uint64_t k3k4[2] = { 0x01751997d0, 0x00ccaa009e };
+/** x^64 mod P */
+static const uint64_t k5 = 0x0163cd6124;
+/** P and floor(x^64 / P) */
+static const uint64_t poly[2] = { 0x01db710641, 0x01f7011641 };
+
+/** Check whether the processor implements PCLMULQDQ.
+ *
+ * The result is cached as executing CPUID is expensive under
+ * virtualization.
+ *
+ * @return True if carry-less multiplication is available.
+ */
+bool crc32_pclmul_supported(void)
+{
+	static int supported = -1;
+
+	if (supported < 0) {
+		uint32_t eax = 1;
+		uint32_t ebx;
+		uint32_t ecx = 0;
+		uint32_t edx;
+
+		asm volatile (
+		    "cpuid\n"
+		    : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx)
+		);
+
+		supported = (ecx & CPUID_ECX_PCLMUL) != 0 ? 1 : 0;
+	}
+
+	return supported != 0;
+}
+
+static inline CRC32_TARGET xmm_t load(const uint8_t *data)
+{
+	xmm_t x;
+
+	memcpy(&x, data, sizeof(x));
+	return x;
+}
+
+/** Multiply low halves of @a a and @a b. */
+static inline CRC32_TARGET xmm_t clmul_ll(xmm_t a, xmm_t b)
+{
+	asm ("pclmulqdq $0x00, %[b], %[a]\n"
+	    : [a] "+x" (a)
+	    : [b] "x" (b)
+	);
+
+	return a;
+}
+
+/** Multiply high halves of @a a and @a b. */
+static inline CRC32_TARGET xmm_t clmul_hh(xmm_t a, xmm_t b)
+{
+	asm ("pclmulqdq $0x11, %[b], %[a]\n"
+	    : [a] "+x" (a)
+	    : [b] "x" (b)
+	);
+
+	return a;
+}
+
+/** Multiply low half of @a a and high half of @a b. */
+static inline CRC32_TARGET xmm_t clmul_lh(xmm_t a, xmm_t b)
+{
+	asm ("pclmulqdq $0x10, %[b], %[a]\n"
+	    : [a] "+x" (a)
+	    : [b] "x" (b)
+	);
+
+	return a;
+}
+
+/** Fold 128-bit remainder @a x over the next 128 bits @a next. */
+static inline CRC32_TARGET xmm_t fold(xmm_t x, xmm_t k, xmm_t next)
+{
+	return clmul_ll(x, k) ^ clmul_hh(x, k) ^ next;
+}
+
+/** Update CRC-32 with a block of data.
+ *
+ * @param crc    CRC register (i.e. not inverted)
+ * @param data   Data
+ * @param length Length of data in bytes, at least CRC32_PCLMUL_MIN
+ *               and a multiple of 16
+ * @return Updated CRC register
+ */
+CRC32_TARGET uint32_t crc32_pclmul(uint32_t crc, const uint8_t *data,
+    size_t length)
+{
+	const xmm_t mask32 = { 0xffffffff, 0xffffffff };
+	xmm_t x1, x2, x3, x4;
+	xmm_t k;
+
+	x1 = load(data) ^ (xmm_t) { crc, 0 };
+	x2 = load(data + 16);
+	x3 = load(data + 32);
+	x4 = load(data + 48);
+	data += 64;
+	length -= 64;
+
+	/* Fold four remainders at a time */
+	k = (xmm_t) { k1k2[0], k1k2[1] };
+	while (length >= 64) {
+		x1 = fold(x1, k, load(data));
+		x2 = fold(x2, k, load(data + 16));
+		x3 = fold(x3, k, load(data + 32));
+		x4 = fold(x4, k, load(data + 48));
+		data += 64;
+		length -= 64;
+	}
+
+	/* Fold into single 128-bit remainder */
+	k = (xmm_t) { k3k4[0], k3k4[1] };
+	x1 = fold(x1, k, x2);
+	x1 = fold(x1, k, x3);
+	x1 = fold(x1, k, x4);
+
+	while (length >= 16) {
+		x1 = fold(x1, k, load(data));
+		data += 16;
+		length -= 16;
+	}
+
+	/* Fold 128 bits to 64 bits */
+	x2 = clmul_lh(x1, k);
+	x1 = (xmm_t) { x1[1], 0 } ^ x2;
+
+	x2 = (xmm_t) { x1[0] >> 32 | x1[1] << 32, x1[1] >> 32 };
+	x1 = clmul_ll(x1 & mask32, (xmm_t) { k5, 0 }) ^ x2;
+
+	/* Barrett reduction to 32 bits */
+	k = (xmm_t) { poly[0], poly[1] };
+	x2 = clmul_lh(x1 & mask32, k);
+	x2 = clmul_ll(x2 & mask32, k);
+	x1 ^= x2;
+
+	return (uint32_t) (x1[0] >> 32);
+}
+
+/** @}
+ */
@@ -64,6 +64,9 @@ void *dlopen(const char *path, int flag)
 
 		/* Now relocate. */
 		module_process_relocs(m);
+
+		/* The resolved symbols are only needed while relocating */
+		symbol_cache_destroy(runtime_env);
 	}
 
 	return (void *) m;
@@ -27,6 +27,8 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <adt/hash.h>
+#include <adt/hash_table.h>
 #include <str.h>
 #include <ipc/services.h>
 #include <ns.h>
@@ -49,6 +51,149 @@ static void *cat_change_arg = NULL;
 static async_sess_t *loc_cons_block_sess = NULL;
 static async_sess_t *loc_consumer_sess = NULL;
 
+/** Maximum number of names kept in the service ID cache */
+#define LOC_ID_CACHE_MAX  64
+
+/** Cached result of loc_service_get_id() */
+typedef struct {
+	ht_link_t link;
+	char *name;
+	service_id_t id;
+} loc_id_cache_entry_t;
+
+/*
+ * Service ID cache. Entries are only valid as long as we receive
+ * change events from the location service, which announces every
+ * unregistration as a category change. Any such event flushes the
+ * whole cache.
+ */
+static FIBRIL_MUTEX_INITIALIZE(loc_id_cache_mutex);
+static hash_table_t loc_id_cache;
+static bool loc_id_cache_ready = false;
+static size_t loc_id_cache_count = 0;
+/** Incremented on every flush to discard lookups racing with it */
+static unsigned loc_id_cache_gen = 0;
+
+static size_t loc_id_cache_key_hash(const void *key)
+{
+	return hash_string((const char *) key);
+}
+
+static size_t loc_id_cache_hash(const ht_link_t *item)
+{
+	loc_id_cache_entry_t *entry =
+	    hash_table_get_inst(item, loc_id_cache_entry_t, link);
+	return hash_string(entry->name);
+}
+
+static bool loc_id_cache_key_equal(const void *key, size_t hash,
+    const ht_link_t *item)
+{
+	loc_id_cache_entry_t *entry =
+	    hash_table_get_inst(item, loc_id_cache_entry_t, link);
+	return str_cmp(entry->name, (const char *) key) == 0;
+}
+
+static void loc_id_cache_remove(ht_link_t *item)
+{
+	loc_id_cache_entry_t *entry =
+	    hash_table_get_inst(item, loc_id_cache_entry_t, link);
+	free(entry->name);
+	free(entry);
+}
+
+static const hash_table_ops_t loc_id_cache_ops = {
+	.hash = loc_id_cache_hash,
+	.key_hash = loc_id_cache_key_hash,
+	.key_equal = loc_id_cache_key_equal,
+	.equal = NULL,
+	.remove_callback = loc_id_cache_remove
+};
+
+/** Drop all entries from the service ID cache. */
+static void loc_id_cache_flush(void)
+{
+	fibril_mutex_lock(&loc_id_cache_mutex);
+
+	loc_id_cache_gen++;
+	if (loc_id_cache_ready && loc_id_cache_count > 0) {
+		hash_table_clear(&loc_id_cache);
+		loc_id_cache_count = 0;
+	}
+
+	fibril_mutex_unlock(&loc_id_cache_mutex);
+}
+
+/** Look up a service name in the ID cache.
+ *
+ * @param name Fully qualified service name
+ * @param id Place to store the service ID
+ * @param gen Place to store the cache generation (on a miss)
+ * @return @c true on a cache hit
+ */
+static bool loc_id_cache_find(const char *name, service_id_t *id,
+    unsigned *gen)
+{
+	bool found = false;
+
+	fibril_mutex_lock(&loc_id_cache_mutex);
+
+	if (loc_id_cache_ready) {
+		ht_link_t *link = hash_table_find(&loc_id_cache, name);
+		if (link != NULL) {
+			*id = hash_table_get_inst(link, loc_id_cache_entry_t,
+			    link)->id;
+			found = true;
+		}
+	}
+
+	*gen = loc_id_cache_gen;
+	fibril_mutex_unlock(&loc_id_cache_mutex);
+	return found;
+}
+
+/** Remember the service ID for a name.
+ *
+ * The entry is not inserted if the cache was flushed since the lookup
+ * started (as indicated by @a gen), since the result may already be stale.
+ *
+ * @param name Fully qualified service name
+ * @param id Service ID
+ * @param gen Cache generation returned by loc_id_cache_find()
+ */
+static void loc_id_cache_insert(const char *name, service_id_t id,
+    unsigned gen)
+{
+	fibril_mutex_lock(&loc_id_cache_mutex);
+
+	if (!loc_id_cache_ready || gen != loc_id_cache_gen)
+		goto out;
+
+	if (hash_table_find(&loc_id_cache, name) != NULL)
+		goto out;
+
+	if (loc_id_cache_count >= LOC_ID_CACHE_MAX) {
+		hash_table_clear(&loc_id_cache);
+		loc_id_cache_count = 0;
+	}
+
+	loc_id_cache_entry_t *entry = malloc(sizeof(loc_id_cache_entry_t));
+	if (entry == NULL)
+		goto out;
+
+	entry->name = str_dup(name);
+	if (entry->name == NULL) {
+		free(entry);
+		goto out;
+	}
+
+	entry->id = id;
+	hash_table_insert(&loc_id_cache, &entry->link);
+	loc_id_cache_count++;
+out:
+	fibril_mutex_unlock(&loc_id_cache_mutex);
+}
+
 static void loc_cb_conn(ipc_call_t *icall, void *arg)
 {
 	while (true) {
@@ -62,6 +207,8 @@ static void loc_cb_conn(ipc_call_t *icall, void *arg)
 
 		switch (ipc_get_imethod(&call)) {
 		case LOC_EVENT_CAT_CHANGE:
+			loc_id_cache_flush();
+
 			fibril_mutex_lock(&loc_callback_mutex);
 			loc_cat_change_cb_t cb_fun = cat_change_cb;
 			void *cb_arg = cat_change_arg;
@@ -126,6 +273,28 @@ static errno_t loc_callback_create(void)
 	return EOK;
 }
 
+/** Enable the service ID cache.
+ *
+ * The cache relies on change events, therefore it is only enabled once
+ * the client has registered a category change callback (and thus keeps
+ * the callback connection open anyway).
+ */
+static void loc_id_cache_enable(void)
+{
+	fibril_mutex_lock(&loc_id_cache_mutex);
+	if (!loc_id_cache_ready) {
+		loc_id_cache_ready = hash_table_create(&loc_id_cache, 0, 0,
+		    &loc_id_cache_ops);
+
+		/*
+		 * Lookups that started before the callback existed could
+		 * have missed an event, do not cache their results.
+		 */
+		loc_id_cache_gen++;
+	}
+	fibril_mutex_unlock(&loc_id_cache_mutex);
+}
+
 /** Start an async exchange on the loc session (blocking).
  *
  * @return New exchange.
@@ -313,10 +482,29 @@ errno_t loc_service_unregister(loc_srv_t *srv, service_id_t sid)
 	return (errno_t)retval;
 }
 
+/** Get service ID from its fully qualified name.
+ *
+ * Successful lookups are cached until the location service announces
+ * a change, so that repeated lookups of the same name (e.g. before
+ * every connection) do not need a round trip to the location service.
+ *
+ * @param fqdn Fully qualified service name
+ * @param handle Place to store the service ID or @c NULL
+ * @param flags IPC_FLAG_BLOCKING to wait for the service to appear
+ * @return EOK on success or an error code
+ */
 errno_t loc_service_get_id(const char *fqdn, service_id_t *handle,
     unsigned int flags)
 {
 	async_exch_t *exch;
+	service_id_t id;
+	unsigned gen;
+
+	if (loc_id_cache_find(fqdn, &id, &gen)) {
+		if (handle != NULL)
+			*handle = id;
+		return EOK;
+	}
 
 	if (flags & IPC_FLAG_BLOCKING)
 		exch = loc_exchange_begin_blocking();
@@ -347,8 +535,11 @@ errno_t loc_service_get_id(const char *fqdn, service_id_t *handle,
 		return retval;
 	}
 
+	id = (service_id_t) ipc_get_arg1(&answer);
 	if (handle != NULL)
-		*handle = (service_id_t) ipc_get_arg1(&answer);
+		*handle = id;
+
+	loc_id_cache_insert(fqdn, id, gen);
 
 	return retval;
 }
@@ -560,6 +751,10 @@ async_sess_t *loc_service_connect(service_id_t handle, iface_t iface,
 	else
 		sess = service_connect(SERVICE_LOC, iface, handle, NULL);
 
+	/* The ID might have come from the cache and be stale by now */
+	if (sess == NULL)
+		loc_id_cache_flush();
+
 	return sess;
 }
 
@@ -854,6 +1049,16 @@ errno_t loc_get_categories(category_id_t **data, size_t *count)
 	    data, count);
 }
 
+/** Register category change callback.
+ *
+ * Registering the callback also enables caching of service IDs returned
+ * by loc_service_get_id(), since the cache can then be kept up to date
+ * using the change events.
+ *
+ * @param cb_fun	Callback function
+ * @param cb_arg	Callback argument
+ * @return		EOK on success or an error code
+ */
 errno_t loc_register_cat_change_cb(loc_cat_change_cb_t cb_fun, void *cb_arg)
 {
 	fibril_mutex_lock(&loc_callback_mutex);
@@ -871,5 +1076,6 @@ errno_t loc_register_cat_change_cb(loc_cat_change_cb_t cb_fun, void *cb_arg)
 	cat_change_arg = cb_arg;
 	fibril_mutex_unlock(&loc_callback_mutex);
 
+	loc_id_cache_enable();
 	return EOK;
 }
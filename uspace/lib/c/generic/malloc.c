@@ -1059,5 +1059,14 @@ void *heap_check(void)
 	return NULL;
 }
 
+/** Get contention statistics of the heap lock.
+ *
+ * @param stats Place to store statistics.
+ */
+void heap_lock_stats(futex_stats_t *stats)
+{
+	futex_get_stats(&malloc_mutex.futex, stats);
+}
+
 /** @}
  */
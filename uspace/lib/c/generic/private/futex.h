@@ -43,17 +43,32 @@
 #include <fibril.h>
 #include <abi/cap.h>
 #include <abi/synch.h>
+#include <types/futex.h>
+
+/** Minimum number of spin iterations before sleeping in futex_lock() */
+#define FUTEX_SPIN_MIN  16
+/** Maximum number of spin iterations before sleeping in futex_lock() */
+#define FUTEX_SPIN_MAX  4096
+/** Maximum number of pause iterations between two probes of the futex */
+#define FUTEX_BACKOFF_MAX  64
 
 typedef struct futex {
 	volatile atomic_int val;
 	volatile cap_waitq_handle_t whandle;
 
+	/** Running average of spin iterations needed to get the futex */
+	atomic_uint spin;
+	/** Contention statistics, only updated by the futex holder */
+	futex_stats_t stats;
+
 #ifdef CONFIG_DEBUG_FUTEX
 	_Atomic(fibril_t *) owner;
 #endif
 } futex_t;
 
 extern errno_t futex_initialize(futex_t *futex, int value);
+extern void futex_lock_slow(futex_t *);
+extern void futex_get_stats(futex_t *, futex_stats_t *);
 
 static inline errno_t futex_destroy(futex_t *futex)
 {
@@ -85,8 +100,8 @@ void __futex_give_to(futex_t *, void *, const char *);
 
 #else
 
-#define futex_lock(fut)     (void) futex_down((fut))
-#define futex_trylock(fut)  futex_trydown((fut))
+#define futex_lock(fut)     futex_lock_spin((fut))
+#define futex_trylock(fut)  futex_trylock_spin((fut))
 #define futex_unlock(fut)   (void) futex_up((fut))
 
 #define futex_give_to(fut, owner) ((void)0)
@@ -100,6 +115,27 @@ static inline errno_t futex_allocate_waitq(futex_t *futex)
 	return __SYSCALL1(SYS_WAITQ_CREATE, (sysarg_t) &futex->whandle);
 }
 
+/** Lock futex used as a mutex.
+ *
+ * Unlike futex_down(), contention does not put the caller to sleep right
+ * away. If the futex is found locked, futex_lock_slow() spins for a while
+ * hoping the holder releases it soon.
+ *
+ * @param futex Futex.
+ */
+static inline void futex_lock_spin(futex_t *futex)
+{
+	int val = 1;
+
+	if (atomic_compare_exchange_strong_explicit(&futex->val, &val, 0,
+	    memory_order_acquire, memory_order_relaxed)) {
+		futex->stats.acquisitions++;
+		return;
+	}
+
+	futex_lock_slow(futex);
+}
+
 /** Down the futex with timeout, composably.
  *
  * This means that when the operation fails due to a timeout or being
@@ -209,6 +245,22 @@ static inline bool futex_trydown(futex_t *futex)
 	return futex_down_timeout(futex, &tv) == EOK;
 }
 
+/** Try to lock futex used as a mutex.
+ *
+ * @param futex Futex.
+ *
+ * @return true if the futex was acquired.
+ * @return false if the futex was not acquired.
+ */
+static inline bool futex_trylock_spin(futex_t *futex)
+{
+	if (!futex_trydown(futex))
+		return false;
+
+	futex->stats.acquisitions++;
+	return true;
+}
+
 /** Down the futex.
  *
  * @param futex Futex.
@@ -44,6 +44,7 @@
 #include <stdlib.h>
 #include <str.h>
 #include <macros.h>
+#include <time.h>
 
 #include <rtld/rtld.h>
 #include <rtld/rtld_debug.h>
@@ -113,12 +114,17 @@ errno_t module_create_entrypoint(elf_finfo_t *p_info, rtld_t *rtld, module_t **r
  */
 void module_process_relocs(module_t *m)
 {
+	struct timespec start, end;
+	size_t relocs = 0;
+
 	DPRINTF("module_process_relocs('%s')\n", m->dyn.soname);
 
 	/* Do not relocate twice. */
 	if (m->relocated)
 		return;
 
+	getuptime(&start);
+
 	module_process_pre_arch(m);
 
 	/* jmp_rel table */
@@ -127,10 +133,12 @@ void module_process_relocs(module_t *m)
 		if (m->dyn.plt_rel == DT_REL) {
 			DPRINTF("jmp_rel table type DT_REL\n");
 			rel_table_process(m, m->dyn.jmp_rel, m->dyn.plt_rel_sz);
+			relocs += m->dyn.plt_rel_sz / sizeof(elf_rel_t);
 		} else {
 			assert(m->dyn.plt_rel == DT_RELA);
 			DPRINTF("jmp_rel table type DT_RELA\n");
 			rela_table_process(m, m->dyn.jmp_rel, m->dyn.plt_rel_sz);
+			relocs += m->dyn.plt_rel_sz / sizeof(elf_rela_t);
 		}
 	}
 
@@ -138,15 +146,21 @@ void module_process_relocs(module_t *m)
 	if (m->dyn.rel != NULL) {
 		DPRINTF("rel table\n");
 		rel_table_process(m, m->dyn.rel, m->dyn.rel_sz);
+		relocs += m->dyn.rel_sz / sizeof(elf_rel_t);
 	}
 
 	/* rela table */
 	if (m->dyn.rela != NULL) {
 		DPRINTF("rela table\n");
 		rela_table_process(m, m->dyn.rela, m->dyn.rela_sz);
+		relocs += m->dyn.rela_sz / sizeof(elf_rela_t);
 	}
 
 	m->relocated = true;
+
+	getuptime(&end);
+	m->rtld->stats.relocs += relocs;
+	m->rtld->stats.reloc_usec += NSEC2USEC(ts_sub_diff(&end, &start));
 }
 
 /** Find module structure by soname/pathname.
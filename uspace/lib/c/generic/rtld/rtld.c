@@ -38,8 +38,10 @@
 #include <rtld/module.h>
 #include <rtld/rtld.h>
 #include <rtld/rtld_debug.h>
+#include <rtld/symbol.h>
 #include <stdlib.h>
 #include <str.h>
+#include <time.h>
 
 rtld_t *runtime_env;
 
@@ -59,6 +61,8 @@ errno_t rtld_prog_process(elf_finfo_t *p_info, rtld_t **rre)
 	if (env == NULL)
 		return ENOMEM;
 
+	getuptime(&env->stats.start);
+
 	list_initialize(&env->modules);
 	list_initialize(&env->imodules);
 	env->next_id = 1;
@@ -98,6 +102,13 @@ errno_t rtld_prog_process(elf_finfo_t *p_info, rtld_t **rre)
 		/* Process relocations in all modules */
 		DPRINTF("Relocate all modules\n");
 		modules_process_relocs(env, module);
+
+		/*
+		 * The cache lives in the heap of the loader, which the
+		 * program cannot manage. dlopen() creates a cache of its
+		 * own and frees it once the loaded module is relocated.
+		 */
+		symbol_cache_destroy(env);
 	}
 
 	if (rre != NULL)
@@ -34,6 +34,9 @@
  * @file
  */
 
+#include <adt/hash_table.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <str.h>
@@ -44,6 +47,38 @@
 #include <rtld/rtld_debug.h>
 #include <rtld/symbol.h>
 
+/** Number of bits in a word of the GNU hash table Bloom filter */
+#define GNU_BLOOM_BITS (sizeof(uintptr_t) * 8)
+
+/** Symbol name with precomputed hash values. */
+typedef struct {
+	/** Name of the symbol */
+	const char *name;
+	/** Search flags */
+	symbol_search_flags_t flags;
+	/** GNU hash of the name */
+	elf_word gnu_hash;
+	/** System V hash of the name, valid if sysv_valid is @c true */
+	elf_word sysv_hash;
+	bool sysv_valid;
+} symbol_query_t;
+
+/** Resolved global symbol. */
+typedef struct {
+	/** Link to rtld_t.sym_cache */
+	ht_link_t link;
+	/** Name of the symbol (in the string table of the defining module) */
+	const char *name;
+	/** Search flags */
+	symbol_search_flags_t flags;
+	/** GNU hash of the name */
+	elf_word gnu_hash;
+	/** Symbol definition */
+	elf_symbol_t *sym;
+	/** Module containing the definition */
+	module_t *mod;
+} symbol_cache_entry_t;
+
 /*
  * Hash tables are 32-bit (elf_word) even for 64-bit ELF files.
  */
@@ -62,41 +97,130 @@ static elf_word elf_hash(const unsigned char *name)
 	return h;
 }
 
-static elf_symbol_t *def_find_in_module(const char *name, module_t *m)
+/** Hash function used by DT_GNU_HASH tables (Bernstein's). */
+static elf_word gnu_hash(const unsigned char *name)
 {
-	if (m->dyn.hash == NULL) {
-		/* No hash table */
-		return NULL;
-	}
+	elf_word h = 5381;
 
+	while (*name)
+		h = h * 33 + *name++;
+
+	return h;
+}
+
+static void symbol_query_init(symbol_query_t *q, const char *name,
+    symbol_search_flags_t flags)
+{
+	q->name = name;
+	q->flags = flags;
+	q->gnu_hash = gnu_hash((const unsigned char *) name);
+	q->sysv_valid = false;
+}
+
+/** Look up a symbol using the System V hash table of a module. */
+static elf_symbol_t *sysv_find_in_module(symbol_query_t *q, module_t *m)
+{
 	elf_symbol_t *sym_table;
-	elf_symbol_t *s, *sym;
+	elf_symbol_t *s;
 	elf_word nbucket;
 	/* elf_word nchain; */
 	elf_word i;
 	char *s_name;
 	elf_word bucket;
 
-	DPRINTF("def_find_in_module('%s', %s)\n", name, m->dyn.soname);
+	if (!q->sysv_valid) {
+		q->sysv_hash = elf_hash((const unsigned char *) q->name);
+		q->sysv_valid = true;
+	}
 
 	sym_table = m->dyn.sym_tab;
 	nbucket = m->dyn.hash[0];
 	/* nchain = m->dyn.hash[1]; XXX Use to check HT range */
 
-	bucket = elf_hash((unsigned char *)name) % nbucket;
+	bucket = q->sysv_hash % nbucket;
 	i = m->dyn.hash[2 + bucket];
 
-	sym = NULL;
 	while (i != STN_UNDEF) {
 		s = &sym_table[i];
 		s_name = m->dyn.str_tab + s->st_name;
 
-		if (str_cmp(name, s_name) == 0) {
-			sym = s;
+		if (str_cmp(q->name, s_name) == 0)
+			return s;
+
+		i = m->dyn.hash[2 + nbucket + i];
+	}
+
+	return NULL;
+}
+
+/** Look up a symbol using the GNU hash table of a module.
+ *
+ * The table starts with a Bloom filter which rejects most names not
+ * defined in the module without touching the buckets. Hash chains store
+ * the hash value of each symbol (with the lowest bit marking the end
+ * of the chain), so names are only compared when the hashes match.
+ */
+static elf_symbol_t *gnu_find_in_module(symbol_query_t *q, module_t *m)
+{
+	elf_word *gh = m->dyn.gnu_hash;
+	elf_word nbucket = gh[0];
+	elf_word symoffset = gh[1];
+	elf_word bloom_size = gh[2];
+	elf_word bloom_shift = gh[3];
+	uintptr_t *bloom = (uintptr_t *) &gh[4];
+	elf_word *buckets = (elf_word *) &bloom[bloom_size];
+	elf_word *chain = &buckets[nbucket];
+	elf_symbol_t *sym_table = m->dyn.sym_tab;
+	elf_word h = q->gnu_hash;
+	uintptr_t word, mask;
+	elf_symbol_t *s;
+	elf_word i;
+
+	word = bloom[(h / GNU_BLOOM_BITS) % bloom_size];
+	mask = ((uintptr_t) 1 << (h % GNU_BLOOM_BITS)) |
+	    ((uintptr_t) 1 << ((h >> bloom_shift) % GNU_BLOOM_BITS));
+	if ((word & mask) != mask)
+		return NULL;
+
+	i = buckets[h % nbucket];
+	if (i < symoffset) {
+		/* Empty bucket */
+		return NULL;
+	}
+
+	while (true) {
+		elf_word ch = chain[i - symoffset];
+
+		if ((ch | 1) == (h | 1)) {
+			s = &sym_table[i];
+			if (str_cmp(q->name, m->dyn.str_tab + s->st_name) == 0)
+				return s;
+		}
+
+		if ((ch & 1) != 0) {
+			/* End of chain */
 			break;
 		}
 
-		i = m->dyn.hash[2 + nbucket + i];
+		++i;
+	}
+
+	return NULL;
+}
+
+static elf_symbol_t *def_find_in_module(symbol_query_t *q, module_t *m)
+{
+	elf_symbol_t *sym;
+
+	DPRINTF("def_find_in_module('%s', %s)\n", q->name, m->dyn.soname);
+
+	if (m->dyn.gnu_hash != NULL) {
+		sym = gnu_find_in_module(q, m);
+	} else if (m->dyn.hash != NULL) {
+		sym = sysv_find_in_module(q, m);
+	} else {
+		/* No hash table */
+		return NULL;
 	}
 
 	if (!sym)
@@ -110,6 +234,123 @@ static elf_symbol_t *def_find_in_module(const char *name, module_t *m)
 	return sym; /* Found */
 }
 
+static size_t sym_cache_hash(const ht_link_t *item)
+{
+	symbol_cache_entry_t *entry =
+	    hash_table_get_inst(item, symbol_cache_entry_t, link);
+	return entry->gnu_hash;
+}
+
+static size_t sym_cache_key_hash(const void *key)
+{
+	const symbol_query_t *q = key;
+	return q->gnu_hash;
+}
+
+static bool sym_cache_key_equal(const void *key, size_t hash,
+    const ht_link_t *item)
+{
+	const symbol_query_t *q = key;
+	symbol_cache_entry_t *entry =
+	    hash_table_get_inst(item, symbol_cache_entry_t, link);
+
+	return entry->gnu_hash == q->gnu_hash && entry->flags == q->flags &&
+	    str_cmp(entry->name, q->name) == 0;
+}
+
+static bool sym_cache_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	symbol_cache_entry_t *e1 =
+	    hash_table_get_inst(item1, symbol_cache_entry_t, link);
+	symbol_cache_entry_t *e2 =
+	    hash_table_get_inst(item2, symbol_cache_entry_t, link);
+
+	return e1->gnu_hash == e2->gnu_hash && e1->flags == e2->flags &&
+	    str_cmp(e1->name, e2->name) == 0;
+}
+
+static void sym_cache_remove_callback(ht_link_t *item)
+{
+	free(hash_table_get_inst(item, symbol_cache_entry_t, link));
+}
+
+/** Operations of the symbol cache */
+static const hash_table_ops_t sym_cache_ops = {
+	.hash = sym_cache_hash,
+	.key_hash = sym_cache_key_hash,
+	.key_equal = sym_cache_key_equal,
+	.equal = sym_cache_equal,
+	.remove_callback = sym_cache_remove_callback
+};
+
+/** Look up a symbol among previously resolved global symbols.
+ *
+ * Global modules are only ever appended to the module list, so the
+ * first global definition of a name, once found, stays the first.
+ * Relocations in different modules frequently refer to the same
+ * symbols, which then need to be looked up only once.
+ */
+static elf_symbol_t *sym_cache_find(rtld_t *rtld, symbol_query_t *q,
+    module_t **mod)
+{
+	ht_link_t *link;
+	symbol_cache_entry_t *entry;
+
+	if (!rtld->sym_cache_valid)
+		return NULL;
+
+	link = hash_table_find(&rtld->sym_cache, q);
+	if (link == NULL)
+		return NULL;
+
+	entry = hash_table_get_inst(link, symbol_cache_entry_t, link);
+	*mod = entry->mod;
+	return entry->sym;
+}
+
+/** Remember a resolved global symbol.
+ *
+ * Failure to allocate memory only means that the symbol will have
+ * to be looked up again next time.
+ */
+static void sym_cache_insert(rtld_t *rtld, symbol_query_t *q,
+    elf_symbol_t *sym, module_t *mod)
+{
+	symbol_cache_entry_t *entry;
+
+	if (!rtld->sym_cache_valid) {
+		rtld->sym_cache_valid = hash_table_create(&rtld->sym_cache, 0,
+		    0, &sym_cache_ops);
+		if (!rtld->sym_cache_valid)
+			return;
+	}
+
+	entry = malloc(sizeof(symbol_cache_entry_t));
+	if (entry == NULL)
+		return;
+
+	entry->name = mod->dyn.str_tab + sym->st_name;
+	entry->flags = q->flags;
+	entry->gnu_hash = q->gnu_hash;
+	entry->sym = sym;
+	entry->mod = mod;
+
+	hash_table_insert(&rtld->sym_cache, &entry->link);
+}
+
+/** Discard all resolved global symbols.
+ *
+ * @param rtld Run-time dynamic linker
+ */
+void symbol_cache_destroy(rtld_t *rtld)
+{
+	if (!rtld->sym_cache_valid)
+		return;
+
+	hash_table_destroy(&rtld->sym_cache);
+	rtld->sym_cache_valid = false;
+}
+
 /** Find the definition of a symbol in a module and its deps.
  *
  * Search the module dependency graph is breadth-first, beginning
@@ -126,9 +367,12 @@ elf_symbol_t *symbol_bfs_find(const char *name, module_t *start,
 {
 	module_t *m, *dm;
 	elf_symbol_t *sym, *s;
+	symbol_query_t q;
 	list_t queue;
 	size_t i;
 
+	symbol_query_init(&q, name, ssf_none);
+
 	/*
 	 * Do a BFS using the queue_link and bfs_tag fields.
 	 * Vertices (modules) are tagged the moment they are inserted
@@ -167,7 +411,7 @@ elf_symbol_t *symbol_bfs_find(const char *name, module_t *start,
 		list_remove(&m->queue_link);
 
 		/* If ssf_noroot is specified, do not look in start module */
-		s = def_find_in_module(name, m);
+		s = def_find_in_module(&q, m);
 		if (s != NULL) {
 			/* Symbol found */
 			sym = s;
@@ -216,17 +460,23 @@ elf_symbol_t *symbol_bfs_find(const char *name, module_t *start,
 elf_symbol_t *symbol_def_find(const char *name, module_t *origin,
     symbol_search_flags_t flags, module_t **mod)
 {
+	rtld_t *rtld = origin->rtld;
+	symbol_query_t q;
 	elf_symbol_t *s;
 
 	DPRINTF("symbol_def_find('%s', origin='%s'\n",
 	    name, origin->dyn.soname);
+
+	symbol_query_init(&q, name, flags);
+	++rtld->stats.lookups;
+
 	if (origin->dyn.symbolic && (!origin->exec || (flags & ssf_noexec) == 0)) {
 		DPRINTF("symbolic->find '%s' in module '%s'\n", name, origin->dyn.soname);
 		/*
 		 * Origin module has a DT_SYMBOLIC flag.
 		 * Try this module first
 		 */
-		s = def_find_in_module(name, origin);
+		s = def_find_in_module(&q, origin);
 		if (s != NULL) {
 			/* Found */
 			*mod = origin;
@@ -236,13 +486,21 @@ elf_symbol_t *symbol_def_find(const char *name, module_t *origin,
 
 	/* Not DT_SYMBOLIC or no match. Now try other locations. */
 
-	list_foreach(origin->rtld->modules, modules_link, module_t, m) {
+	s = sym_cache_find(rtld, &q, mod);
+	if (s != NULL) {
+		DPRINTF("'%s' found in symbol cache\n", name);
+		++rtld->stats.cache_hits;
+		return s;
+	}
+
+	list_foreach(rtld->modules, modules_link, module_t, m) {
 		DPRINTF("module '%s' local?\n", m->dyn.soname);
 		if (!m->local && (!m->exec || (flags & ssf_noexec) == 0)) {
 			DPRINTF("!local->find '%s' in module '%s'\n", name, m->dyn.soname);
-			s = def_find_in_module(name, m);
+			s = def_find_in_module(&q, m);
 			if (s != NULL) {
 				/* Found */
+				sym_cache_insert(rtld, &q, s, m);
 				*mod = m;
 				return s;
 			}
@@ -255,7 +513,7 @@ elf_symbol_t *symbol_def_find(const char *name, module_t *origin,
 	    origin->dyn.soname);
 
 	if (!origin->exec || (flags & ssf_noexec) == 0) {
-		s = def_find_in_module(name, origin);
+		s = def_find_in_module(&q, origin);
 		if (s != NULL) {
 			/* Found */
 			*mod = origin;
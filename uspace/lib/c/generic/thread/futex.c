@@ -36,6 +36,8 @@
 #include <stdatomic.h>
 #include <fibril.h>
 #include <io/kio.h>
+#include <libc.h>
+#include <macros.h>
 
 #include "../private/fibril.h"
 #include "../private/futex.h"
@@ -53,10 +55,115 @@
 errno_t futex_initialize(futex_t *futex, int val)
 {
 	atomic_store_explicit(&futex->val, val, memory_order_relaxed);
+	atomic_store_explicit(&futex->spin, FUTEX_SPIN_MIN,
+	    memory_order_relaxed);
+	futex->stats = (futex_stats_t) { 0 };
 	futex->whandle = CAP_NIL;
 	return futex_allocate_waitq(futex);
 }
 
+/** Tell the CPU we are busy-waiting.
+ *
+ * @param count Number of pause iterations.
+ */
+static void futex_spin_pause(unsigned int count)
+{
+	while (count-- > 0) {
+#if defined(__i386__) || defined(__x86_64__)
+		asm volatile ("pause" ::: "memory");
+#elif defined(__aarch64__) || (defined(__arm__) && __ARM_ARCH >= 7)
+		asm volatile ("yield" ::: "memory");
+#else
+		atomic_signal_fence(memory_order_seq_cst);
+#endif
+	}
+}
+
+/** Lock futex after finding it locked.
+ *
+ * Critical sections protected by futexes are usually very short, so
+ * the holder is likely to release the futex in less time than it takes
+ * to sleep in the kernel and be woken up again. Therefore we first poll
+ * the futex with exponential backoff. The number of iterations is adapted
+ * to how long it took to get the futex in the past, so that on a futex
+ * whose holder rarely releases it quickly (or on a single CPU) we stop
+ * wasting time spinning.
+ *
+ * If there are threads already sleeping on the futex, we do not spin,
+ * as they are first in line.
+ *
+ * @param futex Futex.
+ */
+void futex_lock_slow(futex_t *futex)
+{
+	unsigned int avg;
+	unsigned int limit;
+	unsigned int spins = 0;
+	unsigned int delay = 1;
+	bool slept = false;
+	errno_t rc;
+	int val;
+
+	avg = atomic_load_explicit(&futex->spin, memory_order_relaxed);
+	limit = min(2 * avg + FUTEX_SPIN_MIN, FUTEX_SPIN_MAX);
+
+	while (spins < limit) {
+		val = atomic_load_explicit(&futex->val, memory_order_relaxed);
+		if (val < 0)
+			break;
+
+		if (val > 0 && atomic_compare_exchange_weak_explicit(&futex->val,
+		    &val, val - 1, memory_order_acquire, memory_order_relaxed))
+			goto locked;
+
+		futex_spin_pause(delay);
+		spins += delay;
+		if (delay < FUTEX_BACKOFF_MAX)
+			delay *= 2;
+	}
+
+	/* Spinning did not help, sleep in the kernel */
+	if (atomic_fetch_sub_explicit(&futex->val, 1, memory_order_acquire) <= 0) {
+		slept = true;
+		rc = __SYSCALL3(SYS_WAITQ_SLEEP, (sysarg_t) futex->whandle,
+		    (sysarg_t) 0, (sysarg_t) SYNCH_FLAGS_FUTEX);
+		if (rc != EOK)
+			futex_up(futex);
+	}
+
+locked:
+	/* We hold the futex now, so we can update the statistics */
+	futex->stats.acquisitions++;
+	futex->stats.contended++;
+	futex->stats.spins += spins;
+
+	if (slept) {
+		futex->stats.sleeps++;
+		avg -= avg / 8;
+	} else {
+		avg = (7 * avg + spins) / 8;
+	}
+
+	atomic_store_explicit(&futex->spin, max(avg, FUTEX_SPIN_MIN),
+	    memory_order_relaxed);
+}
+
+/** Get futex contention statistics.
+ *
+ * The statistics are read without locking the futex, so they may be
+ * slightly out of date.
+ *
+ * @param futex Futex.
+ * @param stats Place to store statistics.
+ */
+void futex_get_stats(futex_t *futex, futex_stats_t *stats)
+{
+	stats->acquisitions = futex->stats.acquisitions;
+	stats->contended = futex->stats.contended;
+	stats->spins = futex->stats.spins;
+	stats->sleeps = futex->stats.sleeps;
+}
+
 #ifdef CONFIG_DEBUG_FUTEX
 
 void __futex_assert_is_locked(futex_t *futex, const char *name)
@@ -91,7 +198,7 @@ void __futex_lock(futex_t *futex, const char *name)
 	fibril_t *self = (fibril_t *) fibril_get_id();
 	DPRINTF("Locking futex %s (%p) by fibril %p.\n", name, futex, self);
 	__futex_assert_is_not_locked(futex, name);
-	futex_down(futex);
+	futex_lock_spin(futex);
 
 	void *prev_owner = atomic_load_explicit(&futex->owner,
 	    memory_order_relaxed);
@@ -111,7 +218,7 @@ void __futex_unlock(futex_t *futex, const char *name)
 bool __futex_trylock(futex_t *futex, const char *name)
 {
 	fibril_t *self = (fibril_t *) fibril_get_id();
-	bool success = futex_trydown(futex);
+	bool success = futex_trylock_spin(futex);
 	if (success) {
 		void *owner = atomic_load_explicit(&futex->owner,
 		    memory_order_relaxed);
@@ -39,9 +39,12 @@
 #include <_bits/decls.h>
 
 #ifdef _HELENOS_SOURCE
+#include <types/futex.h>
+
 __HELENOS_DECLS_BEGIN;
 
 extern void *heap_check(void);
+extern void heap_lock_stats(futex_stats_t *);
 
 __HELENOS_DECLS_END;
 #endif
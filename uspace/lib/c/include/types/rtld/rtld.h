@@ -35,13 +35,30 @@
 #ifndef _LIBC_TYPES_RTLD_RTLD_H_
 #define _LIBC_TYPES_RTLD_RTLD_H_
 
+#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <elf/elf_mod.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <time.h>
 
 #include <types/rtld/module.h>
 
+/** Dynamic linking statistics */
+typedef struct {
+	/** Uptime when dynamic linking of the program started */
+	struct timespec start;
+	/** Number of relocations processed */
+	size_t relocs;
+	/** Number of symbol definition lookups */
+	size_t lookups;
+	/** Lookups answered from the symbol cache */
+	size_t cache_hits;
+	/** Time spent processing relocations in microseconds */
+	uint64_t reloc_usec;
+} rtld_stats_t;
+
 typedef struct rtld {
 	elf_dyn_t *rtld_dynamic;
 	module_t rtld;
@@ -60,6 +77,14 @@ typedef struct rtld {
 
 	/** List of initial modules */
 	list_t imodules;
+
+	/** Resolved global symbols (symbol_cache_entry_t) */
+	hash_table_t sym_cache;
+	/** @c true iff sym_cache has been created */
+	bool sym_cache_valid;
+
+	/** Dynamic linking statistics */
+	rtld_stats_t stats;
 } rtld_t;
 
 #endif
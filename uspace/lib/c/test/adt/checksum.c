@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <adt/checksum.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(checksum);
+
+enum {
+	data_size = 1500
+};
+
+static uint8_t data[data_size];
+
+/** Fill test buffer with a pseudo-random pattern. */
+static void fill_data(void)
+{
+	uint32_t x = 1;
+	size_t i;
+
+	for (i = 0; i < data_size; i++) {
+		x = x * 1103515245 + 12345;
+		data[i] = x >> 16;
+	}
+}
+
+/** Reference Internet checksum summing one 16-bit word at a time. */
+static uint16_t ocsum_ref(const uint8_t *buf, size_t size)
+{
+	uint32_t sum = 0;
+	size_t i;
+
+	for (i = 0; i + 1 < size; i += 2) {
+		sum += ((uint16_t) buf[i] << 8) | buf[i + 1];
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	if (size % 2 != 0) {
+		sum += (uint16_t) buf[size - 1] << 8;
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	return ~sum;
+}
+
+/** Reference CRC-32 processing one bit at a time. */
+static uint32_t crc32_ref(const uint8_t *buf, size_t size)
+{
+	uint32_t crc = 0xffffffff;
+	size_t i;
+	int b;
+
+	for (i = 0; i < size; i++) {
+		crc ^= buf[i];
+		for (b = 0; b < 8; b++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+
+	return ~crc;
+}
+
+/** Internet checksum of the RFC 1071 example. */
+PCUT_TEST(ocsum_rfc1071)
+{
+	uint8_t buf[] = { 0x00, 0x01, 0xf2, 0x03, 0xf4, 0xf5, 0xf6, 0xf7 };
+
+	PCUT_ASSERT_INT_EQUALS(0x220d, compute_ocsum(buf, sizeof(buf)));
+}
+
+/** Internet checksum of all lengths and alignments matches reference. */
+PCUT_TEST(ocsum_sizes)
+{
+	size_t offs, size;
+
+	fill_data();
+
+	for (offs = 0; offs < 8; offs++) {
+		for (size = 0; size < 100; size++) {
+			PCUT_ASSERT_INT_EQUALS(ocsum_ref(data + offs, size),
+			    compute_ocsum(data + offs, size));
+		}
+	}
+
+	PCUT_ASSERT_INT_EQUALS(ocsum_ref(data, data_size),
+	    compute_ocsum(data, data_size));
+}
+
+/** Incremental Internet checksum with pieces of odd length. */
+PCUT_TEST(ocsum_incremental)
+{
+	ocsum_t cs;
+	size_t offs;
+	size_t plen;
+
+	fill_data();
+
+	for (plen = 1; plen < 20; plen++) {
+		ocsum_init(&cs);
+		offs = 0;
+		while (offs < data_size) {
+			size_t n = data_size - offs < plen ?
+			    data_size - offs : plen;
+			ocsum_add(&cs, data + offs, n);
+			offs += n;
+		}
+
+		PCUT_ASSERT_INT_EQUALS(ocsum_ref(data, data_size),
+		    ocsum_get(&cs));
+	}
+}
+
+/** Updating Internet checksum after changing a word. */
+PCUT_TEST(ocsum_update16)
+{
+	uint16_t cksum;
+	uint16_t oldw;
+	uint16_t neww;
+
+	fill_data();
+
+	cksum = compute_ocsum(data, 64);
+	oldw = ((uint16_t) data[10] << 8) | data[11];
+	neww = oldw ^ 0x5aa5;
+	data[10] = neww >> 8;
+	data[11] = neww & 0xff;
+
+	PCUT_ASSERT_INT_EQUALS(compute_ocsum(data, 64),
+	    ocsum_update16(cksum, oldw, neww));
+}
+
+/** CRC-32 check value. */
+PCUT_TEST(crc32_check)
+{
+	uint8_t buf[] = "123456789";
+
+	PCUT_ASSERT_INT_EQUALS(0xcbf43926, compute_crc32(buf, 9));
+}
+
+/** CRC-32 of various lengths and alignments matches reference. */
+PCUT_TEST(crc32_sizes)
+{
+	size_t offs, size;
+
+	fill_data();
+
+	for (offs = 0; offs < 8; offs++) {
+		for (size = 0; size < 300; size += 7) {
+			PCUT_ASSERT_INT_EQUALS(crc32_ref(data + offs, size),
+			    compute_crc32(data + offs, size));
+		}
+	}
+
+	PCUT_ASSERT_INT_EQUALS(crc32_ref(data, data_size),
+	    compute_crc32(data, data_size));
+}
+
+/** CRC-32 computed in pieces equals CRC-32 of the whole data. */
+PCUT_TEST(crc32_seed)
+{
+	uint32_t crc;
+	size_t split;
+
+	fill_data();
+
+	for (split = 0; split < data_size; split += 97) {
+		crc = compute_crc32(data, split);
+		crc = compute_crc32_seed(data + split, data_size - split, crc);
+		PCUT_ASSERT_INT_EQUALS(crc32_ref(data, data_size), crc);
+	}
+}
+
+PCUT_EXPORT(checksum);
@@ -34,6 +34,7 @@ PCUT_INIT;
 
 PCUT_IMPORT(capa);
 PCUT_IMPORT(casting);
+PCUT_IMPORT(checksum);
 PCUT_IMPORT(circ_buf);
 PCUT_IMPORT(double_to_str);
 PCUT_IMPORT(fibril_timer);
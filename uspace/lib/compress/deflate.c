@@ -0,0 +1,1096 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @file
+ * @brief Implementation of deflate compression
+ *
+ * A streaming compressor producing `deflate' streams as described by
+ * RFC 1951. Matches are searched greedily using hash chains over a 64 KB
+ * buffer which holds the last 32 KB of already compressed data followed
+ * by the lookahead. The resulting literals and length/distance pairs are
+ * collected and emitted as a block whenever the symbol buffer fills up or
+ * the buffer has to slide. Each block is stored, coded using the fixed
+ * codes or coded using length-limited dynamic Huffman codes, whichever
+ * is the shortest.
+ *
+ * The memory usage is bounded by the size of the context (about 320 KB)
+ * regardless of the amount of data compressed.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <assert.h>
+#include <mem.h>
+#include "deflate.h"
+
+/** Size of the sliding window */
+#define WINDOW_SIZE  32768
+/** Mask of positions in the sliding window */
+#define WINDOW_MASK  (WINDOW_SIZE - 1)
+/** Size of the buffer holding the window and the lookahead */
+#define BUFFER_SIZE  (2 * WINDOW_SIZE)
+
+/** Number of bits of the hash of three bytes */
+#define HASH_BITS  15
+/** Number of hash chains */
+#define HASH_SIZE  (1 << HASH_BITS)
+
+/** Shortest match */
+#define MIN_MATCH  3
+/** Longest match */
+#define MAX_MATCH  258
+/** Lookahead needed to find the longest match at any position */
+#define MIN_LOOKAHEAD  (MAX_MATCH + MIN_MATCH + 1)
+/** Farthest distance worth coding a shortest match */
+#define MIN_MATCH_FAR  4096
+
+/** Number of symbols collected before a block is emitted */
+#define BLOCK_SYMBOLS  16384
+/** Longest stored block */
+#define MAX_STORED  65535
+/** Size of the output staging buffer (enough for the largest block) */
+#define OUTPUT_SIZE  (BUFFER_SIZE + 256)
+
+/** Maximum bits in the Huffman code */
+#define MAX_HUFFMAN_BIT  15
+/** Maximum bits in the code length code */
+#define MAX_CODE_LEN_BIT  7
+
+/** Number of length codes */
+#define MAX_LEN           29
+/** Number of distance codes */
+#define MAX_DIST          30
+/** Number of order codes */
+#define MAX_ORDER         19
+/** Number of literal/length codes */
+#define MAX_LITLEN        286
+/** Number of fixed literal/length codes */
+#define MAX_FIXED_LITLEN  288
+/** End-of-block code */
+#define END_OF_BLOCK      256
+
+/** Maximum number of run-length coded code lengths */
+#define MAX_CODE  (MAX_LITLEN + MAX_DIST)
+
+/** Base values for length codes 257..285 */
+static const uint16_t lens[MAX_LEN] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+/** Extra bits for length codes 257..285 */
+static const uint16_t lens_ext[MAX_LEN] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+/** Base values for distance codes 0..29 */
+static const uint16_t dists[MAX_DIST] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577
+};
+
+/** Extra bits for distance codes 0..29 */
+static const uint16_t dists_ext[MAX_DIST] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11,
+	12, 12, 13, 13
+};
+
+/** Order of code length codes */
+static const short order[MAX_ORDER] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/** Extra bits of the code length codes 16..18 */
+static const uint8_t code_len_ext[3] = { 2, 3, 7 };
+
+/** Match search parameters of the compression levels */
+static const struct {
+	uint16_t chain;  /**< Longest hash chain searched */
+	uint16_t nice;   /**< Match length which stops the search */
+} deflate_levels[DEFLATE_LEVEL_MAX + 1] = {
+	{ 0, 0 },
+	{ 4, 8 },
+	{ 8, 16 },
+	{ 16, 32 },
+	{ 32, 64 },
+	{ 64, 128 },
+	{ 128, 128 },
+	{ 256, 258 },
+	{ 1024, 258 },
+	{ 4096, 258 }
+};
+
+/** Huffman code for encoding
+ *
+ */
+typedef struct {
+	uint16_t code[MAX_FIXED_LITLEN];   /**< Bit-reversed codes */
+	uint8_t length[MAX_FIXED_LITLEN];  /**< Code lengths */
+} deflate_huffman_t;
+
+/** Symbol with its weight for Huffman code construction */
+typedef struct {
+	uint32_t weight;
+	uint16_t symbol;
+} deflate_weight_t;
+
+/** Streaming deflate context
+ *
+ */
+struct deflate_stream {
+	size_t chain;               /**< Longest hash chain searched */
+	size_t nice;                /**< Match length which stops the search */
+
+	const uint8_t *src;         /**< Current input chunk */
+	size_t srclen;              /**< Size of the input chunk */
+	size_t srccnt;              /**< Position in the input chunk */
+	bool finish;                /**< No more input will be supplied */
+	bool done;                  /**< The last block has been emitted */
+
+	uint8_t window[BUFFER_SIZE];  /**< Window and lookahead */
+	size_t wend;                /**< End of valid data in the buffer */
+	size_t pos;                 /**< Position of the next byte to code */
+	size_t block_start;         /**< Start of the current block */
+
+	uint16_t head[HASH_SIZE];   /**< Last position of each hash */
+	uint16_t prev[WINDOW_SIZE]; /**< Previous position with the same hash */
+
+	uint8_t sym_len[BLOCK_SYMBOLS];    /**< Literal or match length - 3 */
+	uint16_t sym_dist[BLOCK_SYMBOLS];  /**< Match distance or 0 */
+	size_t sym_count;           /**< Number of collected symbols */
+
+	uint32_t lit_freq[MAX_FIXED_LITLEN];  /**< Literal/length frequencies */
+	uint32_t dist_freq[MAX_DIST];         /**< Distance frequencies */
+
+	uint8_t len_code[MAX_MATCH - MIN_MATCH + 1];  /**< Length to code */
+	uint8_t dist_code[512];     /**< Distance to code */
+
+	deflate_huffman_t fixed_lit;   /**< Fixed literal/length code */
+	deflate_huffman_t fixed_dist;  /**< Fixed distance code */
+	deflate_huffman_t dyn_lit;     /**< Dynamic literal/length code */
+	deflate_huffman_t dyn_dist;    /**< Dynamic distance code */
+	deflate_huffman_t code_len;    /**< Code length code */
+
+	uint8_t rle_symbol[MAX_CODE];  /**< Run-length coded code lengths */
+	uint8_t rle_extra[MAX_CODE];   /**< Extra bits of the code lengths */
+	size_t rle_count;              /**< Number of coded code lengths */
+
+	uint8_t out[OUTPUT_SIZE];   /**< Compressed data staging buffer */
+	size_t outstart;            /**< Start of data not yet returned */
+	size_t outend;              /**< End of valid data */
+	uint64_t bitbuf;            /**< Bits not yet stored in the buffer */
+	size_t bitlen;              /**< Number of bits in the bit buffer */
+};
+
+/** Append bits to the output
+ *
+ * @param stream Streaming deflate context.
+ * @param value  Bits to append (least significant first).
+ * @param cnt    Number of bits (at most 16).
+ *
+ */
+static inline void put_bits(deflate_stream_t *stream, uint32_t value,
+    size_t cnt)
+{
+	stream->bitbuf |= ((uint64_t) value) << stream->bitlen;
+	stream->bitlen += cnt;
+
+	while (stream->bitlen >= 8) {
+		stream->out[stream->outend] = (uint8_t) stream->bitbuf;
+		stream->outend++;
+		stream->bitbuf >>= 8;
+		stream->bitlen -= 8;
+	}
+}
+
+/** Pad the output to a byte boundary
+ *
+ * @param stream Streaming deflate context.
+ *
+ */
+static void align_bits(deflate_stream_t *stream)
+{
+	put_bits(stream, 0, (8 - stream->bitlen) & 7);
+}
+
+/** Get the code of a match distance
+ *
+ * @param stream Streaming deflate context.
+ * @param dist   Match distance.
+ *
+ * @return Distance code.
+ *
+ */
+static inline uint8_t deflate_dist_code(deflate_stream_t *stream, size_t dist)
+{
+	dist--;
+	if (dist < 256)
+		return stream->dist_code[dist];
+
+	return stream->dist_code[256 + (dist >> 7)];
+}
+
+/** Assign canonical codes to code lengths
+ *
+ * The codes are stored bit-reversed, since the output is filled
+ * starting with the least significant bit.
+ *
+ * @param huffman Huffman code with valid lengths.
+ * @param n       Number of symbols.
+ *
+ */
+static void huffman_codes(deflate_huffman_t *huffman, size_t n)
+{
+	uint16_t count[MAX_HUFFMAN_BIT + 1];
+	uint16_t next[MAX_HUFFMAN_BIT + 1];
+
+	memset(count, 0, sizeof(count));
+	for (size_t symbol = 0; symbol < n; symbol++)
+		count[huffman->length[symbol]]++;
+
+	count[0] = 0;
+	uint16_t code = 0;
+	for (size_t len = 1; len <= MAX_HUFFMAN_BIT; len++) {
+		code = (code + count[len - 1]) << 1;
+		next[len] = code;
+	}
+
+	for (size_t symbol = 0; symbol < n; symbol++) {
+		size_t len = huffman->length[symbol];
+		if (len == 0)
+			continue;
+
+		uint16_t fwd = next[len]++;
+		uint16_t rev = 0;
+		for (size_t bit = 0; bit < len; bit++)
+			rev |= ((fwd >> bit) & 1) << (len - 1 - bit);
+
+		huffman->code[symbol] = rev;
+	}
+}
+
+/** Compare symbol weights for sorting
+ *
+ */
+static int weight_compare(const void *a, const void *b)
+{
+	const deflate_weight_t *wa = (const deflate_weight_t *) a;
+	const deflate_weight_t *wb = (const deflate_weight_t *) b;
+
+	if (wa->weight != wb->weight)
+		return (wa->weight < wb->weight) ? -1 : 1;
+
+	return (int) wa->symbol - (int) wb->symbol;
+}
+
+/** Compute optimal code lengths in place
+ *
+ * The in-place algorithm by A. Moffat and J. Katajainen. On input the
+ * array holds the weights in ascending order, on output the respective
+ * code lengths.
+ *
+ * @param a Weights sorted in ascending order (at least two).
+ * @param n Number of weights.
+ *
+ */
+static void huffman_minimum_redundancy(uint32_t *a, int n)
+{
+	int root = 0;
+	int leaf = 2;
+	int next;
+
+	/* Build the tree, internal nodes refer to their parents */
+	a[0] += a[1];
+	for (next = 1; next < n - 1; next++) {
+		if ((leaf >= n) || (a[root] < a[leaf])) {
+			a[next] = a[root];
+			a[root++] = next;
+		} else {
+			a[next] = a[leaf++];
+		}
+
+		if ((leaf >= n) || ((root < next) && (a[root] < a[leaf]))) {
+			a[next] += a[root];
+			a[root++] = next;
+		} else {
+			a[next] += a[leaf++];
+		}
+	}
+
+	/* Compute the depths of the internal nodes */
+	a[n - 2] = 0;
+	for (next = n - 3; next >= 0; next--)
+		a[next] = a[a[next]] + 1;
+
+	/* Compute the depths of the leaves */
+	int avail = 1;
+	int used = 0;
+	uint32_t depth = 0;
+
+	root = n - 2;
+	next = n - 1;
+
+	while (avail > 0) {
+		while ((root >= 0) && (a[root] == depth)) {
+			used++;
+			root--;
+		}
+
+		while (avail > used) {
+			a[next--] = depth;
+			avail--;
+		}
+
+		avail = 2 * used;
+		depth++;
+		used = 0;
+	}
+}
+
+/** Construct a length-limited Huffman code
+ *
+ * Optimal code lengths are computed first. If some of them exceed the
+ * limit, they are shortened and the Kraft inequality is then restored by
+ * lengthening the longest codes below the limit. Finally the lengths are
+ * reassigned so that more frequent symbols never get longer codes.
+ *
+ * At least two symbols are always assigned a code, so that the code is
+ * complete even if only one (or no) symbol is used.
+ *
+ * @param huffman Huffman code to construct.
+ * @param freq    Symbol frequencies.
+ * @param n       Number of symbols.
+ * @param limit   Maximum code length.
+ *
+ */
+static void huffman_build(deflate_huffman_t *huffman, const uint32_t *freq,
+    size_t n, size_t limit)
+{
+	deflate_weight_t weights[MAX_FIXED_LITLEN];
+	uint32_t depth[MAX_FIXED_LITLEN];
+	size_t count = 0;
+
+	for (size_t symbol = 0; symbol < n; symbol++) {
+		huffman->length[symbol] = 0;
+
+		if (freq[symbol] != 0) {
+			weights[count].weight = freq[symbol];
+			weights[count].symbol = symbol;
+			count++;
+		}
+	}
+
+	/* Make sure there are at least two codes */
+	for (size_t symbol = 0; (count < 2) && (symbol < n); symbol++) {
+		if (freq[symbol] == 0) {
+			weights[count].weight = 1;
+			weights[count].symbol = symbol;
+			count++;
+		}
+	}
+
+	qsort(weights, count, sizeof(deflate_weight_t), weight_compare);
+
+	for (size_t i = 0; i < count; i++)
+		depth[i] = weights[i].weight;
+
+	huffman_minimum_redundancy(depth, (int) count);
+
+	/* Count the codes of each length, clamping to the limit */
+	uint32_t bl_count[MAX_HUFFMAN_BIT + 1];
+	memset(bl_count, 0, sizeof(bl_count));
+
+	for (size_t i = 0; i < count; i++)
+		bl_count[(depth[i] < limit) ? depth[i] : limit]++;
+
+	/* Restore the Kraft inequality */
+	uint32_t total = 0;
+	for (size_t len = 1; len <= limit; len++)
+		total += bl_count[len] << (limit - len);
+
+	while (total > (UINT32_C(1) << limit)) {
+		bl_count[limit]--;
+
+		for (size_t len = limit - 1; len > 0; len--) {
+			if (bl_count[len] != 0) {
+				bl_count[len]--;
+				bl_count[len + 1] += 2;
+				break;
+			}
+		}
+
+		total--;
+	}
+
+	/* The least frequent symbols get the longest codes */
+	size_t i = 0;
+	for (size_t len = limit; len > 0; len--) {
+		for (uint32_t j = 0; j < bl_count[len]; j++) {
+			huffman->length[weights[i].symbol] = len;
+			i++;
+		}
+	}
+
+	huffman_codes(huffman, n);
+}
+
+/** Compute the size of the block data coded using the given codes
+ *
+ * @param stream Streaming deflate context.
+ * @param lit    Literal/length code.
+ * @param dist   Distance code.
+ *
+ * @return Number of bits of the coded symbols.
+ *
+ */
+static size_t deflate_data_bits(deflate_stream_t *stream,
+    deflate_huffman_t *lit, deflate_huffman_t *dist)
+{
+	size_t bits = 0;
+
+	for (size_t symbol = 0; symbol < MAX_LITLEN; symbol++)
+		bits += stream->lit_freq[symbol] * lit->length[symbol];
+
+	for (size_t code = 0; code < MAX_LEN; code++)
+		bits += stream->lit_freq[END_OF_BLOCK + 1 + code] * lens_ext[code];
+
+	for (size_t code = 0; code < MAX_DIST; code++) {
+		bits += stream->dist_freq[code] *
+		    (dist->length[code] + dists_ext[code]);
+	}
+
+	return bits;
+}
+
+/** Append a run-length coded code length
+ *
+ * @param stream Streaming deflate context.
+ * @param symbol Code length code.
+ * @param extra  Extra bits.
+ * @param freq   Code length code frequencies.
+ *
+ */
+static void deflate_rle_put(deflate_stream_t *stream, uint8_t symbol,
+    uint8_t extra, uint32_t *freq)
+{
+	stream->rle_symbol[stream->rle_count] = symbol;
+	stream->rle_extra[stream->rle_count] = extra;
+	stream->rle_count++;
+	freq[symbol]++;
+}
+
+/** Run-length code the literal/length and distance code lengths
+ *
+ * @param stream Streaming deflate context.
+ * @param nlen   Number of literal/length codes.
+ * @param ndist  Number of distance codes.
+ * @param freq   Code length code frequencies to fill in.
+ *
+ */
+static void deflate_rle(deflate_stream_t *stream, size_t nlen, size_t ndist,
+    uint32_t *freq)
+{
+	uint8_t length[MAX_CODE];
+
+	memcpy(length, stream->dyn_lit.length, nlen);
+	memcpy(length + nlen, stream->dyn_dist.length, ndist);
+
+	size_t total = nlen + ndist;
+	size_t i = 0;
+
+	stream->rle_count = 0;
+	memset(freq, 0, MAX_ORDER * sizeof(uint32_t));
+
+	while (i < total) {
+		uint8_t cur = length[i];
+		size_t run = 1;
+		while ((i + run < total) && (length[i + run] == cur))
+			run++;
+
+		i += run;
+
+		if (cur == 0) {
+			while (run >= 11) {
+				size_t cnt = (run < 138) ? run : 138;
+				deflate_rle_put(stream, 18, cnt - 11, freq);
+				run -= cnt;
+			}
+
+			if (run >= 3) {
+				deflate_rle_put(stream, 17, run - 3, freq);
+				run = 0;
+			}
+		} else {
+			deflate_rle_put(stream, cur, 0, freq);
+			run--;
+
+			while (run >= 3) {
+				size_t cnt = (run < 6) ? run : 6;
+				deflate_rle_put(stream, 16, cnt - 3, freq);
+				run -= cnt;
+			}
+		}
+
+		while (run > 0) {
+			deflate_rle_put(stream, cur, 0, freq);
+			run--;
+		}
+	}
+}
+
+/** Emit the collected symbols using the given codes
+ *
+ * @param stream Streaming deflate context.
+ * @param lit    Literal/length code.
+ * @param dist   Distance code.
+ *
+ */
+static void deflate_emit_symbols(deflate_stream_t *stream,
+    deflate_huffman_t *lit, deflate_huffman_t *dist)
+{
+	for (size_t i = 0; i < stream->sym_count; i++) {
+		size_t symbol = stream->sym_len[i];
+		size_t distance = stream->sym_dist[i];
+
+		if (distance == 0) {
+			put_bits(stream, lit->code[symbol], lit->length[symbol]);
+			continue;
+		}
+
+		size_t code = stream->len_code[symbol];
+		put_bits(stream, lit->code[END_OF_BLOCK + 1 + code],
+		    lit->length[END_OF_BLOCK + 1 + code]);
+		put_bits(stream, symbol + MIN_MATCH - lens[code], lens_ext[code]);
+
+		code = deflate_dist_code(stream, distance);
+		put_bits(stream, dist->code[code], dist->length[code]);
+		put_bits(stream, distance - dists[code], dists_ext[code]);
+	}
+
+	put_bits(stream, lit->code[END_OF_BLOCK], lit->length[END_OF_BLOCK]);
+}
+
+/** Emit the current block
+ *
+ * The output staging buffer must be empty.
+ *
+ * @param stream Streaming deflate context.
+ * @param last   This is the last block of the stream.
+ *
+ */
+static void deflate_emit_block(deflate_stream_t *stream, bool last)
+{
+	assert(stream->outstart == stream->outend);
+
+	stream->outstart = 0;
+	stream->outend = 0;
+	stream->lit_freq[END_OF_BLOCK] = 1;
+
+	/* Dynamic codes */
+	huffman_build(&stream->dyn_lit, stream->lit_freq, MAX_LITLEN,
+	    MAX_HUFFMAN_BIT);
+	huffman_build(&stream->dyn_dist, stream->dist_freq, MAX_DIST,
+	    MAX_HUFFMAN_BIT);
+
+	size_t nlen = MAX_LITLEN;
+	while ((nlen > END_OF_BLOCK + 1) && (stream->dyn_lit.length[nlen - 1] == 0))
+		nlen--;
+
+	size_t ndist = MAX_DIST;
+	while ((ndist > 1) && (stream->dyn_dist.length[ndist - 1] == 0))
+		ndist--;
+
+	uint32_t code_len_freq[MAX_ORDER];
+	deflate_rle(stream, nlen, ndist, code_len_freq);
+	huffman_build(&stream->code_len, code_len_freq, MAX_ORDER,
+	    MAX_CODE_LEN_BIT);
+
+	size_t ncode = MAX_ORDER;
+	while ((ncode > 4) && (stream->code_len.length[order[ncode - 1]] == 0))
+		ncode--;
+
+	size_t dynamic_bits = 3 + 5 + 5 + 4 + 3 * ncode +
+	    deflate_data_bits(stream, &stream->dyn_lit, &stream->dyn_dist);
+
+	for (size_t i = 0; i < MAX_ORDER; i++) {
+		dynamic_bits += code_len_freq[i] * stream->code_len.length[i];
+		if (i >= 16)
+			dynamic_bits += code_len_freq[i] * code_len_ext[i - 16];
+	}
+
+	/* Fixed codes */
+	size_t fixed_bits = 3 +
+	    deflate_data_bits(stream, &stream->fixed_lit, &stream->fixed_dist);
+
+	/* Stored blocks (upper bound including the alignment) */
+	size_t len = stream->pos - stream->block_start;
+	size_t nstored = (len + MAX_STORED - 1) / MAX_STORED;
+	if (nstored == 0)
+		nstored = 1;
+
+	size_t stored_bits = len * 8 + nstored * (3 + 7 + 32);
+
+	if ((stream->chain == 0) ||
+	    ((stored_bits < fixed_bits) && (stored_bits < dynamic_bits))) {
+		const uint8_t *data = stream->window + stream->block_start;
+
+		do {
+			size_t cnt = (len < MAX_STORED) ? len : MAX_STORED;
+			len -= cnt;
+
+			put_bits(stream, (last && (len == 0)) ? 1 : 0, 1);
+			put_bits(stream, 0, 2);
+			align_bits(stream);
+			put_bits(stream, cnt, 16);
+			put_bits(stream, (uint16_t) ~cnt, 16);
+
+			memcpy(stream->out + stream->outend, data, cnt);
+			stream->outend += cnt;
+			data += cnt;
+		} while (len > 0);
+	} else if (fixed_bits <= dynamic_bits) {
+		put_bits(stream, last ? 1 : 0, 1);
+		put_bits(stream, 1, 2);
+		deflate_emit_symbols(stream, &stream->fixed_lit,
+		    &stream->fixed_dist);
+	} else {
+		put_bits(stream, last ? 1 : 0, 1);
+		put_bits(stream, 2, 2);
+		put_bits(stream, nlen - 257, 5);
+		put_bits(stream, ndist - 1, 5);
+		put_bits(stream, ncode - 4, 4);
+
+		for (size_t i = 0; i < ncode; i++)
+			put_bits(stream, stream->code_len.length[order[i]], 3);
+
+		for (size_t i = 0; i < stream->rle_count; i++) {
+			uint8_t symbol = stream->rle_symbol[i];
+			put_bits(stream, stream->code_len.code[symbol],
+			    stream->code_len.length[symbol]);
+
+			if (symbol >= 16) {
+				put_bits(stream, stream->rle_extra[i],
+				    code_len_ext[symbol - 16]);
+			}
+		}
+
+		deflate_emit_symbols(stream, &stream->dyn_lit,
+		    &stream->dyn_dist);
+	}
+
+	if (last)
+		align_bits(stream);
+
+	/* Start a new block */
+	stream->block_start = stream->pos;
+	stream->sym_count = 0;
+	memset(stream->lit_freq, 0, sizeof(stream->lit_freq));
+	memset(stream->dist_freq, 0, sizeof(stream->dist_freq));
+}
+
+/** Compute the hash of three bytes at the given position
+ *
+ */
+static inline size_t deflate_hash(deflate_stream_t *stream, size_t pos)
+{
+	const uint8_t *p = stream->window + pos;
+	return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & (HASH_SIZE - 1);
+}
+
+/** Insert a position into its hash chain
+ *
+ * @param stream Streaming deflate context.
+ * @param pos    Position with at least three bytes of data.
+ *
+ * @return Previous position with the same hash (0 if none).
+ *
+ */
+static inline size_t deflate_insert(deflate_stream_t *stream, size_t pos)
+{
+	size_t hash = deflate_hash(stream, pos);
+	size_t cur = stream->head[hash];
+
+	stream->prev[pos & WINDOW_MASK] = cur;
+	stream->head[hash] = pos;
+	return cur;
+}
+
+/** Find the longest match at the current position
+ *
+ * @param stream    Streaming deflate context.
+ * @param cur       First candidate position.
+ * @param[out] rdist Distance of the longest match.
+ *
+ * @return Length of the longest match (less than MIN_MATCH if none).
+ *
+ */
+static size_t deflate_longest_match(deflate_stream_t *stream, size_t cur,
+    size_t *rdist)
+{
+	size_t pos = stream->pos;
+	size_t max = stream->wend - pos;
+	if (max > MAX_MATCH)
+		max = MAX_MATCH;
+
+	size_t limit = (pos > WINDOW_SIZE) ? pos - WINDOW_SIZE : 0;
+	const uint8_t *scan = stream->window + pos;
+	size_t best = MIN_MATCH - 1;
+	size_t chain = stream->chain;
+
+	while ((cur > limit) && (chain > 0)) {
+		const uint8_t *match = stream->window + cur;
+
+		if ((match[best] == scan[best]) && (match[0] == scan[0]) &&
+		    (match[1] == scan[1])) {
+			size_t len = 2;
+			while ((len < max) && (match[len] == scan[len]))
+				len++;
+
+			if (len > best) {
+				best = len;
+				*rdist = pos - cur;
+
+				if ((len >= stream->nice) || (len == max))
+					break;
+			}
+		}
+
+		size_t next = stream->prev[cur & WINDOW_MASK];
+		if (next >= cur)
+			break;
+
+		cur = next;
+		chain--;
+	}
+
+	return best;
+}
+
+/** Code the byte or match at the current position
+ *
+ * @param stream Streaming deflate context.
+ *
+ */
+static void deflate_symbol(deflate_stream_t *stream)
+{
+	size_t pos = stream->pos;
+	size_t look = stream->wend - pos;
+	size_t len = 0;
+	size_t dist = 0;
+
+	if ((stream->chain > 0) && (look >= MIN_MATCH)) {
+		size_t cur = deflate_insert(stream, pos);
+		len = deflate_longest_match(stream, cur, &dist);
+
+		if ((len == MIN_MATCH) && (dist > MIN_MATCH_FAR))
+			len = 0;
+	}
+
+	size_t i = stream->sym_count;
+	stream->sym_count++;
+
+	if (len < MIN_MATCH) {
+		uint8_t byte = stream->window[pos];
+
+		stream->sym_len[i] = byte;
+		stream->sym_dist[i] = 0;
+		stream->lit_freq[byte]++;
+		stream->pos++;
+		return;
+	}
+
+	stream->sym_len[i] = len - MIN_MATCH;
+	stream->sym_dist[i] = dist;
+	stream->lit_freq[END_OF_BLOCK + 1 +
+	    stream->len_code[len - MIN_MATCH]]++;
+	stream->dist_freq[deflate_dist_code(stream, dist)]++;
+
+	/* Insert the positions covered by the match */
+	for (size_t p = pos + 1; (p < pos + len) &&
+	    (p + MIN_MATCH <= stream->wend); p++)
+		(void) deflate_insert(stream, p);
+
+	stream->pos += len;
+}
+
+/** Slide the window by its size
+ *
+ * @param stream Streaming deflate context.
+ *
+ */
+static void deflate_slide(deflate_stream_t *stream)
+{
+	assert(stream->block_start >= WINDOW_SIZE);
+
+	memcpy(stream->window, stream->window + WINDOW_SIZE,
+	    stream->wend - WINDOW_SIZE);
+	stream->wend -= WINDOW_SIZE;
+	stream->pos -= WINDOW_SIZE;
+	stream->block_start -= WINDOW_SIZE;
+
+	for (size_t i = 0; i < HASH_SIZE; i++) {
+		stream->head[i] = (stream->head[i] >= WINDOW_SIZE) ?
+		    stream->head[i] - WINDOW_SIZE : 0;
+	}
+
+	for (size_t i = 0; i < WINDOW_SIZE; i++) {
+		stream->prev[i] = (stream->prev[i] >= WINDOW_SIZE) ?
+		    stream->prev[i] - WINDOW_SIZE : 0;
+	}
+}
+
+/** Compress data until a block is emitted or more input is needed
+ *
+ * The output staging buffer must be empty.
+ *
+ * @param stream Streaming deflate context.
+ *
+ * @return True if a block has been emitted.
+ * @return False if more input is needed.
+ *
+ */
+static bool deflate_step(deflate_stream_t *stream)
+{
+	while (true) {
+		size_t look = stream->wend - stream->pos;
+
+		if ((look < MIN_LOOKAHEAD) &&
+		    (stream->srccnt < stream->srclen)) {
+			if (stream->wend == BUFFER_SIZE) {
+				/* The block must not extend beyond the window */
+				if (stream->block_start < WINDOW_SIZE) {
+					deflate_emit_block(stream, false);
+					return true;
+				}
+
+				deflate_slide(stream);
+			}
+
+			size_t cnt = stream->srclen - stream->srccnt;
+			if (cnt > BUFFER_SIZE - stream->wend)
+				cnt = BUFFER_SIZE - stream->wend;
+
+			memcpy(stream->window + stream->wend,
+			    stream->src + stream->srccnt, cnt);
+			stream->wend += cnt;
+			stream->srccnt += cnt;
+			continue;
+		}
+
+		if ((look < MIN_LOOKAHEAD) && (!stream->finish))
+			return false;
+
+		while ((stream->sym_count < BLOCK_SYMBOLS) &&
+		    (stream->pos < stream->wend) &&
+		    ((stream->finish) ||
+		    (stream->wend - stream->pos >= MIN_LOOKAHEAD)))
+			deflate_symbol(stream);
+
+		if (stream->sym_count == BLOCK_SYMBOLS) {
+			deflate_emit_block(stream, false);
+			return true;
+		}
+
+		if ((stream->finish) && (stream->pos == stream->wend) &&
+		    (stream->srccnt == stream->srclen)) {
+			deflate_emit_block(stream, true);
+			stream->done = true;
+			return true;
+		}
+	}
+}
+
+/** Create streaming deflate context
+ *
+ * @param level        Compression level (0 to DEFLATE_LEVEL_MAX). Level 0
+ *                     only stores the data, higher levels search more
+ *                     matches and are slower.
+ * @param[out] rstream Place to store pointer to the new context.
+ *
+ * @return EOK on success.
+ * @return EINVAL on invalid compression level.
+ * @return ENOMEM if out of memory.
+ *
+ */
+errno_t deflate_stream_create(unsigned int level, deflate_stream_t **rstream)
+{
+	if (level > DEFLATE_LEVEL_MAX)
+		return EINVAL;
+
+	deflate_stream_t *stream = calloc(1, sizeof(deflate_stream_t));
+	if (stream == NULL)
+		return ENOMEM;
+
+	stream->chain = deflate_levels[level].chain;
+	stream->nice = deflate_levels[level].nice;
+
+	/* Length and distance code lookup tables */
+	for (size_t code = 0; code < MAX_LEN; code++) {
+		for (size_t len = lens[code];
+		    (len < lens[code] + (1U << lens_ext[code])) &&
+		    (len <= MAX_MATCH); len++)
+			stream->len_code[len - MIN_MATCH] = code;
+	}
+
+	for (size_t code = 0; code < MAX_DIST; code++) {
+		for (size_t dist = dists[code] - 1;
+		    dist < dists[code] - 1 + (1U << dists_ext[code]); dist++) {
+			if (dist < 256)
+				stream->dist_code[dist] = code;
+			else
+				stream->dist_code[256 + (dist >> 7)] = code;
+		}
+	}
+
+	/* Fixed codes */
+	for (size_t symbol = 0; symbol < MAX_FIXED_LITLEN; symbol++) {
+		if (symbol < 144)
+			stream->fixed_lit.length[symbol] = 8;
+		else if (symbol < 256)
+			stream->fixed_lit.length[symbol] = 9;
+		else if (symbol < 280)
+			stream->fixed_lit.length[symbol] = 7;
+		else
+			stream->fixed_lit.length[symbol] = 8;
+	}
+
+	for (size_t symbol = 0; symbol < MAX_DIST; symbol++)
+		stream->fixed_dist.length[symbol] = 5;
+
+	huffman_codes(&stream->fixed_lit, MAX_FIXED_LITLEN);
+	huffman_codes(&stream->fixed_dist, MAX_DIST);
+
+	*rstream = stream;
+	return EOK;
+}
+
+/** Destroy streaming deflate context
+ *
+ * @param stream Streaming deflate context or NULL.
+ *
+ */
+void deflate_stream_destroy(deflate_stream_t *stream)
+{
+	free(stream);
+}
+
+/** Supply the next chunk of data to compress
+ *
+ * The chunk is referenced (not copied) until it is consumed, which is
+ * signalled by deflate_stream_output() returning less data than
+ * requested before the stream is finished. Only then may the next
+ * chunk be supplied.
+ *
+ * @param stream Streaming deflate context.
+ * @param src    Data to compress.
+ * @param srclen Size of the data (bytes).
+ *
+ */
+void deflate_stream_input(deflate_stream_t *stream, const void *src,
+    size_t srclen)
+{
+	assert(stream->srccnt == stream->srclen);
+	assert(!stream->finish);
+
+	stream->src = (const uint8_t *) src;
+	stream->srclen = srclen;
+	stream->srccnt = 0;
+}
+
+/** Mark the end of the data to compress
+ *
+ * The data supplied so far (including the current chunk) are the
+ * whole input. No more input can be supplied.
+ *
+ * @param stream Streaming deflate context.
+ *
+ */
+void deflate_stream_finish(deflate_stream_t *stream)
+{
+	stream->finish = true;
+}
+
+/** Retrieve compressed data
+ *
+ * Compress as much of the supplied input as possible. If less than
+ * @a size bytes are produced, either the whole input has been consumed
+ * and the next chunk can be supplied, or the stream is finished.
+ *
+ * @param stream        Streaming deflate context.
+ * @param dest          Destination buffer.
+ * @param size          Size of the destination buffer (bytes).
+ * @param[out] produced Number of compressed bytes stored.
+ *
+ * @return EOK on success.
+ *
+ */
+errno_t deflate_stream_output(deflate_stream_t *stream, void *dest,
+    size_t size, size_t *produced)
+{
+	uint8_t *out = (uint8_t *) dest;
+	size_t cnt = 0;
+
+	while (true) {
+		size_t avail = stream->outend - stream->outstart;
+		if (avail > size - cnt)
+			avail = size - cnt;
+
+		memcpy(out + cnt, stream->out + stream->outstart, avail);
+		stream->outstart += avail;
+		cnt += avail;
+
+		if ((cnt == size) || (stream->done))
+			break;
+
+		if (!deflate_step(stream))
+			break;
+	}
+
+	*produced = cnt;
+	return EOK;
+}
+
+/** Check whether the stream is finished
+ *
+ * @param stream Streaming deflate context.
+ *
+ * @return True if the last block has been emitted and all compressed
+ *         data have been returned.
+ *
+ */
+bool deflate_stream_finished(deflate_stream_t *stream)
+{
+	return (stream->done) && (stream->outstart == stream->outend);
+}
@@ -32,8 +32,11 @@
 #include <mem.h>
 #include <byteorder.h>
 #include <stdlib.h>
+#include <assert.h>
+#include <adt/checksum.h>
 #include "gzip.h"
 #include "inflate.h"
+#include "deflate.h"
 
 #define GZIP_ID1  UINT8_C(0x1f)
 #define GZIP_ID2  UINT8_C(0x8b)
@@ -46,6 +49,11 @@
 #define GZIP_FLAG_FNAME     UINT8_C(1 << 3)
 #define GZIP_FLAG_FCOMMENT  UINT8_C(1 << 4)
 
+#define GZIP_XFL_MAX      UINT8_C(2)
+#define GZIP_XFL_FASTEST  UINT8_C(4)
+
+#define GZIP_OS_UNKNOWN  UINT8_C(255)
+
 typedef struct {
 	uint8_t id1;
 	uint8_t id2;
@@ -69,7 +77,7 @@ typedef struct {
  * data to 4 GiB (expanding input streams that actually
  * encode more data will always fail).
  *
- * So far, no CRC is perfomed.
+ * The CRC-32 and the size stored in the trailer are verified.
  *
  * @param[in]  src     Source data buffer.
  * @param[in]  srclen  Source buffer size (bytes).
@@ -79,7 +87,8 @@ typedef struct {
  * @return EOK on success.
  * @return ENOENT on distance too large.
  * @return EINVAL on invalid Huffman code, invalid deflate data,
- *                   invalid compression method or invalid stream.
+ *                   invalid compression method, invalid stream
+ *                   or checksum mismatch.
  * @return ELIMIT on input buffer overrun.
  * @return ENOMEM on output buffer overrun.
  *
@@ -175,9 +184,548 @@ errno_t gzip_expand(void *src, size_t srclen, void **dest, size_t *destlen)
 
 	errno_t ret = inflate(stream, stream_length, *dest, *destlen);
 	if (ret != EOK) {
-		free(dest);
+		free(*dest);
 		return ret;
 	}
 
+	if (compute_crc32(*dest, *destlen) != uint32_t_le2host(footer.crc32)) {
+		free(*dest);
+		return EINVAL;
+	}
+
+	return EOK;
+}
+
+/** Streaming phases */
+typedef enum {
+	/** Fixed part of the header */
+	GZIP_PHASE_HEADER,
+	/** Length of the extra field */
+	GZIP_PHASE_EXTRA_LEN,
+	/** Extra field */
+	GZIP_PHASE_EXTRA,
+	/** Zero-terminated file name */
+	GZIP_PHASE_NAME,
+	/** Zero-terminated comment */
+	GZIP_PHASE_COMMENT,
+	/** Header CRC */
+	GZIP_PHASE_HCRC,
+	/** Deflate stream */
+	GZIP_PHASE_DATA,
+	/** Trailer with CRC-32 and size */
+	GZIP_PHASE_TRAILER,
+	/** End of the member */
+	GZIP_PHASE_DONE
+} gzip_phase_t;
+
+/** Streaming GZIP decompression context
+ *
+ */
+struct gzip_expand {
+	inflate_stream_t *inflate;  /**< Deflate stream decoder */
+	gzip_phase_t phase;         /**< Current phase */
+	uint8_t flags;              /**< Header flags */
+	errno_t error;              /**< Sticky error */
+
+	const uint8_t *src;         /**< Input chunk outside the deflate stream */
+	size_t srclen;              /**< Size of the input chunk */
+	size_t srccnt;              /**< Position in the input chunk */
+
+	uint8_t buf[sizeof(gzip_header_t)];  /**< Collected header bytes */
+	size_t bufcnt;              /**< Number of collected bytes */
+	size_t skip;                /**< Bytes of the extra field to skip */
+
+	uint32_t crc;               /**< CRC-32 of the decompressed data */
+	uint32_t size;              /**< Size of the decompressed data */
+};
+
+/** Streaming GZIP compression context
+ *
+ */
+struct gzip_compress {
+	deflate_stream_t *deflate;  /**< Deflate stream encoder */
+	gzip_phase_t phase;         /**< Current phase */
+
+	uint8_t buf[sizeof(gzip_header_t)];  /**< Header or trailer */
+	size_t bufcnt;              /**< Number of bytes returned */
+	size_t buflen;              /**< Size of the header or trailer */
+
+	uint32_t crc;               /**< CRC-32 of the uncompressed data */
+	uint32_t size;              /**< Size of the uncompressed data */
+};
+
+/** Create streaming GZIP decompression context
+ *
+ * @param[out] rgz Place to store pointer to the new context.
+ *
+ * @return EOK on success.
+ * @return ENOMEM if out of memory.
+ *
+ */
+errno_t gzip_expand_create(gzip_expand_t **rgz)
+{
+	gzip_expand_t *gz = calloc(1, sizeof(gzip_expand_t));
+	if (gz == NULL)
+		return ENOMEM;
+
+	errno_t rc = inflate_stream_create(&gz->inflate);
+	if (rc != EOK) {
+		free(gz);
+		return rc;
+	}
+
+	gz->phase = GZIP_PHASE_HEADER;
+	gz->error = EOK;
+
+	*rgz = gz;
 	return EOK;
 }
+
+/** Destroy streaming GZIP decompression context
+ *
+ * @param gz Streaming GZIP decompression context or NULL.
+ *
+ */
+void gzip_expand_destroy(gzip_expand_t *gz)
+{
+	if (gz == NULL)
+		return;
+
+	inflate_stream_destroy(gz->inflate);
+	free(gz);
+}
+
+/** Supply the next chunk of compressed data
+ *
+ * The chunk is referenced (not copied) until it is consumed, which is
+ * signalled by gzip_expand_output() returning less data than requested
+ * while the stream is not finished. Only then may the next chunk be
+ * supplied.
+ *
+ * @param gz     Streaming GZIP decompression context.
+ * @param src    Compressed data.
+ * @param srclen Size of the compressed data (bytes).
+ *
+ */
+void gzip_expand_input(gzip_expand_t *gz, const void *src, size_t srclen)
+{
+	if (gz->phase == GZIP_PHASE_DATA) {
+		inflate_stream_input(gz->inflate, src, srclen);
+		return;
+	}
+
+	assert(gz->srccnt == gz->srclen);
+
+	gz->src = (const uint8_t *) src;
+	gz->srclen = srclen;
+	gz->srccnt = 0;
+}
+
+/** Collect header bytes from the current input chunk
+ *
+ * @param gz  Streaming GZIP decompression context.
+ * @param cnt Number of bytes to collect.
+ *
+ * @return True if all bytes have been collected.
+ *
+ */
+static bool gzip_expand_collect(gzip_expand_t *gz, size_t cnt)
+{
+	size_t avail = gz->srclen - gz->srccnt;
+	if (avail > cnt - gz->bufcnt)
+		avail = cnt - gz->bufcnt;
+
+	if (avail > 0) {
+		memcpy(gz->buf + gz->bufcnt, gz->src + gz->srccnt, avail);
+		gz->bufcnt += avail;
+		gz->srccnt += avail;
+	}
+
+	return (gz->bufcnt == cnt);
+}
+
+/** Skip a zero-terminated header field in the current input chunk
+ *
+ * @param gz Streaming GZIP decompression context.
+ *
+ * @return True if the terminating zero has been reached.
+ *
+ */
+static bool gzip_expand_skip_string(gzip_expand_t *gz)
+{
+	while (gz->srccnt < gz->srclen) {
+		uint8_t byte = gz->src[gz->srccnt];
+		gz->srccnt++;
+
+		if (byte == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/** Advance to the next header field present in the stream
+ *
+ * @param gz Streaming GZIP decompression context.
+ *
+ */
+static void gzip_expand_advance(gzip_expand_t *gz)
+{
+	gz->bufcnt = 0;
+
+	while (true) {
+		gz->phase++;
+
+		switch (gz->phase) {
+		case GZIP_PHASE_EXTRA_LEN:
+		case GZIP_PHASE_EXTRA:
+			if ((gz->flags & GZIP_FLAG_FEXTRA) != 0)
+				return;
+			break;
+		case GZIP_PHASE_NAME:
+			if ((gz->flags & GZIP_FLAG_FNAME) != 0)
+				return;
+			break;
+		case GZIP_PHASE_COMMENT:
+			if ((gz->flags & GZIP_FLAG_FCOMMENT) != 0)
+				return;
+			break;
+		case GZIP_PHASE_HCRC:
+			if ((gz->flags & GZIP_FLAG_FHCRC) != 0)
+				return;
+			break;
+		default:
+			return;
+		}
+	}
+}
+
+/** Process the header and the trailer of the stream
+ *
+ * @param gz Streaming GZIP decompression context.
+ *
+ * @return EOK if the phase is complete.
+ * @return EAGAIN if more input is needed.
+ * @return EINVAL on invalid stream or checksum mismatch.
+ *
+ */
+static errno_t gzip_expand_frame(gzip_expand_t *gz)
+{
+	gzip_header_t header;
+	gzip_footer_t footer;
+	uint16_t extra_length;
+
+	switch (gz->phase) {
+	case GZIP_PHASE_HEADER:
+		if (!gzip_expand_collect(gz, sizeof(header)))
+			return EAGAIN;
+
+		memcpy(&header, gz->buf, sizeof(header));
+
+		if ((header.id1 != GZIP_ID1) ||
+		    (header.id2 != GZIP_ID2) ||
+		    (header.method != GZIP_METHOD_DEFLATE) ||
+		    ((header.flags & (~GZIP_FLAGS_MASK)) != 0))
+			return EINVAL;
+
+		gz->flags = header.flags;
+		break;
+	case GZIP_PHASE_EXTRA_LEN:
+		if (!gzip_expand_collect(gz, sizeof(extra_length)))
+			return EAGAIN;
+
+		memcpy(&extra_length, gz->buf, sizeof(extra_length));
+		gz->skip = uint16_t_le2host(extra_length);
+		break;
+	case GZIP_PHASE_EXTRA:
+		while ((gz->skip > 0) && (gz->srccnt < gz->srclen)) {
+			size_t cnt = gz->srclen - gz->srccnt;
+			if (cnt > gz->skip)
+				cnt = gz->skip;
+
+			gz->srccnt += cnt;
+			gz->skip -= cnt;
+		}
+
+		if (gz->skip > 0)
+			return EAGAIN;
+		break;
+	case GZIP_PHASE_NAME:
+	case GZIP_PHASE_COMMENT:
+		if (!gzip_expand_skip_string(gz))
+			return EAGAIN;
+		break;
+	case GZIP_PHASE_HCRC:
+		if (!gzip_expand_collect(gz, 2))
+			return EAGAIN;
+		break;
+	case GZIP_PHASE_TRAILER:
+		/* Part of the trailer might have been read by the decoder */
+		gz->bufcnt += inflate_stream_tail(gz->inflate,
+		    gz->buf + gz->bufcnt, sizeof(footer) - gz->bufcnt);
+
+		if (!gzip_expand_collect(gz, sizeof(footer)))
+			return EAGAIN;
+
+		memcpy(&footer, gz->buf, sizeof(footer));
+
+		if ((uint32_t_le2host(footer.crc32) != gz->crc) ||
+		    (uint32_t_le2host(footer.size) != gz->size))
+			return EINVAL;
+		break;
+	default:
+		assert(false);
+		return EINVAL;
+	}
+
+	gzip_expand_advance(gz);
+	return EOK;
+}
+
+/** Decompress data
+ *
+ * Decompress as much of the supplied input as possible. If less than
+ * @a size bytes are produced, either the whole input has been consumed
+ * and the next chunk can be supplied, or the stream is finished.
+ * The CRC-32 and the size of the data are verified at the end of the
+ * stream.
+ *
+ * Only a single member is decompressed, any data following it are
+ * ignored.
+ *
+ * @param gz            Streaming GZIP decompression context.
+ * @param dest          Destination buffer.
+ * @param size          Size of the destination buffer (bytes).
+ * @param[out] produced Number of decompressed bytes stored.
+ *
+ * @return EOK on success.
+ * @return ENOENT on distance too large.
+ * @return EINVAL on invalid Huffman code, invalid deflate data,
+ *                   invalid compression method, invalid stream
+ *                   or checksum mismatch.
+ *
+ */
+errno_t gzip_expand_output(gzip_expand_t *gz, void *dest, size_t size,
+    size_t *produced)
+{
+	size_t cnt = 0;
+	errno_t rc = gz->error;
+
+	while ((rc == EOK) && (gz->phase != GZIP_PHASE_DONE)) {
+		if (gz->phase != GZIP_PHASE_DATA) {
+			rc = gzip_expand_frame(gz);
+			if (rc == EAGAIN) {
+				rc = EOK;
+				break;
+			}
+
+			if ((rc == EOK) && (gz->phase == GZIP_PHASE_DATA) &&
+			    (gz->srccnt < gz->srclen)) {
+				/* Pass the rest of the chunk to the decoder */
+				inflate_stream_input(gz->inflate,
+				    gz->src + gz->srccnt, gz->srclen - gz->srccnt);
+				gz->srccnt = gz->srclen;
+			}
+
+			continue;
+		}
+
+		size_t done;
+		uint8_t *out = (uint8_t *) dest + cnt;
+
+		rc = inflate_stream_output(gz->inflate, out, size - cnt, &done);
+		gz->crc = compute_crc32_seed(out, done, gz->crc);
+		gz->size += done;
+		cnt += done;
+
+		if ((rc != EOK) || (!inflate_stream_finished(gz->inflate)))
+			break;
+
+		gz->phase = GZIP_PHASE_TRAILER;
+		gz->bufcnt = 0;
+	}
+
+	gz->error = rc;
+	*produced = cnt;
+	return rc;
+}
+
+/** Check whether the end of the stream has been reached
+ *
+ * @param gz Streaming GZIP decompression context.
+ *
+ * @return True if the whole stream has been decompressed and verified.
+ *
+ */
+bool gzip_expand_finished(gzip_expand_t *gz)
+{
+	return (gz->phase == GZIP_PHASE_DONE);
+}
+
+/** Create streaming GZIP compression context
+ *
+ * @param level    Compression level (0 to DEFLATE_LEVEL_MAX).
+ * @param[out] rgz Place to store pointer to the new context.
+ *
+ * @return EOK on success.
+ * @return EINVAL on invalid compression level.
+ * @return ENOMEM if out of memory.
+ *
+ */
+errno_t gzip_compress_create(unsigned int level, gzip_compress_t **rgz)
+{
+	gzip_compress_t *gz = calloc(1, sizeof(gzip_compress_t));
+	if (gz == NULL)
+		return ENOMEM;
+
+	errno_t rc = deflate_stream_create(level, &gz->deflate);
+	if (rc != EOK) {
+		free(gz);
+		return rc;
+	}
+
+	gzip_header_t header;
+
+	header.id1 = GZIP_ID1;
+	header.id2 = GZIP_ID2;
+	header.method = GZIP_METHOD_DEFLATE;
+	header.flags = 0;
+	header.mtime = 0;
+	header.os = GZIP_OS_UNKNOWN;
+
+	if (level == DEFLATE_LEVEL_MAX)
+		header.extra_flags = GZIP_XFL_MAX;
+	else if (level <= 1)
+		header.extra_flags = GZIP_XFL_FASTEST;
+	else
+		header.extra_flags = 0;
+
+	memcpy(gz->buf, &header, sizeof(header));
+	gz->buflen = sizeof(header);
+	gz->phase = GZIP_PHASE_HEADER;
+
+	*rgz = gz;
+	return EOK;
+}
+
+/** Destroy streaming GZIP compression context
+ *
+ * @param gz Streaming GZIP compression context or NULL.
+ *
+ */
+void gzip_compress_destroy(gzip_compress_t *gz)
+{
+	if (gz == NULL)
+		return;
+
+	deflate_stream_destroy(gz->deflate);
+	free(gz);
+}
+
+/** Supply the next chunk of data to compress
+ *
+ * The chunk is referenced (not copied) until it is consumed, which is
+ * signalled by gzip_compress_output() returning less data than
+ * requested while the stream is not finished. Only then may the next
+ * chunk be supplied.
+ *
+ * @param gz     Streaming GZIP compression context.
+ * @param src    Data to compress.
+ * @param srclen Size of the data (bytes).
+ *
+ */
+void gzip_compress_input(gzip_compress_t *gz, const void *src, size_t srclen)
+{
+	gz->crc = compute_crc32_seed((uint8_t *) src, srclen, gz->crc);
+	gz->size += srclen;
+
+	deflate_stream_input(gz->deflate, src, srclen);
+}
+
+/** Mark the end of the data to compress
+ *
+ * @param gz Streaming GZIP compression context.
+ *
+ */
+void gzip_compress_finish(gzip_compress_t *gz)
+{
+	deflate_stream_finish(gz->deflate);
+}
+
+/** Retrieve compressed data
+ *
+ * Compress as much of the supplied input as possible. If less than
+ * @a size bytes are produced, either the whole input has been consumed
+ * and the next chunk can be supplied, or the stream is finished.
+ *
+ * @param gz            Streaming GZIP compression context.
+ * @param dest          Destination buffer.
+ * @param size          Size of the destination buffer (bytes).
+ * @param[out] produced Number of compressed bytes stored.
+ *
+ * @return EOK on success.
+ *
+ */
+errno_t gzip_compress_output(gzip_compress_t *gz, void *dest, size_t size,
+    size_t *produced)
+{
+	uint8_t *out = (uint8_t *) dest;
+	size_t cnt = 0;
+
+	while ((cnt < size) && (gz->phase != GZIP_PHASE_DONE)) {
+		if (gz->phase == GZIP_PHASE_DATA) {
+			size_t done;
+			errno_t rc = deflate_stream_output(gz->deflate, out + cnt,
+			    size - cnt, &done);
+			cnt += done;
+
+			if (rc != EOK) {
+				*produced = cnt;
+				return rc;
+			}
+
+			if (!deflate_stream_finished(gz->deflate))
+				break;
+
+			gzip_footer_t footer;
+
+			footer.crc32 = host2uint32_t_le(gz->crc);
+			footer.size = host2uint32_t_le(gz->size);
+
+			memcpy(gz->buf, &footer, sizeof(footer));
+			gz->buflen = sizeof(footer);
+			gz->bufcnt = 0;
+			gz->phase = GZIP_PHASE_TRAILER;
+			continue;
+		}
+
+		size_t avail = gz->buflen - gz->bufcnt;
+		if (avail > size - cnt)
+			avail = size - cnt;
+
+		memcpy(out + cnt, gz->buf + gz->bufcnt, avail);
+		gz->bufcnt += avail;
+		cnt += avail;
+
+		if (gz->bufcnt == gz->buflen) {
+			gz->phase = (gz->phase == GZIP_PHASE_HEADER) ?
+			    GZIP_PHASE_DATA : GZIP_PHASE_DONE;
+		}
+	}
+
+	*produced = cnt;
+	return EOK;
+}
+
+/** Check whether the stream is finished
+ *
+ * @param gz Streaming GZIP compression context.
+ *
+ * @return True if all compressed data including the trailer have been
+ *         returned.
+ *
+ */
+bool gzip_compress_finished(gzip_compress_t *gz)
+{
+	return (gz->phase == GZIP_PHASE_DONE);
+}
@@ -29,8 +29,30 @@
 #ifndef LIBCOMPRESS_GZIP_H_
 #define LIBCOMPRESS_GZIP_H_
 
+#include <errno.h>
+#include <stdbool.h>
 #include <stddef.h>
 
+/** Streaming GZIP decompression context */
+typedef struct gzip_expand gzip_expand_t;
+
+/** Streaming GZIP compression context */
+typedef struct gzip_compress gzip_compress_t;
+
 extern errno_t gzip_expand(void *, size_t, void **, size_t *);
 
+extern errno_t gzip_expand_create(gzip_expand_t **);
+extern void gzip_expand_destroy(gzip_expand_t *);
+extern void gzip_expand_input(gzip_expand_t *, const void *, size_t);
+extern errno_t gzip_expand_output(gzip_expand_t *, void *, size_t, size_t *);
+extern bool gzip_expand_finished(gzip_expand_t *);
+
+extern errno_t gzip_compress_create(unsigned int, gzip_compress_t **);
+extern void gzip_compress_destroy(gzip_compress_t *);
+extern void gzip_compress_input(gzip_compress_t *, const void *, size_t);
+extern void gzip_compress_finish(gzip_compress_t *);
+extern errno_t gzip_compress_output(gzip_compress_t *, void *, size_t,
+    size_t *);
+extern bool gzip_compress_finished(gzip_compress_t *);
+
 #endif
@@ -31,11 +31,18 @@
  * @brief Implementation of inflate decompression
  *
  * A simple inflate implementation (decompression of `deflate' stream as
- * described by RFC 1951) based on puff.c by Mark Adler. This code is
- * currently not optimized for speed but for readability.
+ * described by RFC 1951) based on puff.c by Mark Adler.
  *
- * All dynamically allocated memory memory is taken from the stack. The
- * stack usage should be typically bounded by 2 KB.
+ * Huffman codes are decoded using a lookup table indexed by the next
+ * HUFFMAN_FAST_BITS bits of the input, which resolves all short codes in
+ * a single step. Only the rare longer codes fall back to the canonical
+ * bit-by-bit decoding of puff.c. Input bits are kept in a 64-bit buffer
+ * which is refilled a word at a time.
+ *
+ * The one-shot inflate() takes all dynamically allocated memory from
+ * the stack. The stack usage should be typically bounded by 5 KB. The
+ * streaming decoder keeps its state including a 32 KB sliding window in
+ * a heap allocated context instead.
  *
  * Original copyright notice:
  *
@@ -67,12 +74,22 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <errno.h>
+#include <assert.h>
+#include <byteorder.h>
 #include <mem.h>
+#include <stdlib.h>
 #include "inflate.h"
 
 /** Maximum bits in the Huffman code */
 #define MAX_HUFFMAN_BIT  15
 
+/** Number of bits resolved by the Huffman lookup table */
+#define HUFFMAN_FAST_BITS  9
+/** Number of entries in the Huffman lookup table */
+#define HUFFMAN_FAST_SIZE  (1 << HUFFMAN_FAST_BITS)
+/** Bits of the code length in a lookup table entry */
+#define HUFFMAN_FAST_LEN_BITS  4
+
 /** Number of length codes */
 #define MAX_LEN           29
 /** Number of distance codes */
@@ -106,7 +123,7 @@ typedef struct {
 	size_t srclen;    /**< Input buffer size */
 	size_t srccnt;    /**< Position in the input buffer */
 
-	uint16_t bitbuf;  /**< Bit buffer */
+	uint64_t bitbuf;  /**< Bit buffer */
 	size_t bitlen;    /**< Number of bits in the bit buffer */
 
 	bool overrun;     /**< Overrun condition */
@@ -118,6 +135,14 @@ typedef struct {
 typedef struct {
 	uint16_t *count;   /**< Array of symbol counts */
 	uint16_t *symbol;  /**< Array of symbols */
+
+	/**
+	 * Lookup table indexed by the next HUFFMAN_FAST_BITS input bits.
+	 * An entry holds the decoded symbol shifted left by
+	 * HUFFMAN_FAST_LEN_BITS and the length of its code, or zero
+	 * if the code is longer than HUFFMAN_FAST_BITS.
+	 */
+	uint16_t *fast;
 } huffman_t;
 
 /** Length codes
@@ -210,21 +235,47 @@ static uint16_t dist_symbol[MAX_DIST] = {
 	16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29
 };
 
-/** Huffman code for lengths
+/** Refill the bit buffer
+ *
+ * Load as many whole bytes as fit into the bit buffer. Away from the end
+ * of the input a single unaligned 64-bit load is used. The bits above
+ * bitlen may then already contain the following input bits, which are
+ * loaded again at the same position by the next refill.
+ *
+ * @param state Inflate state.
  *
  */
-static huffman_t len_code = {
-	.count = len_count,
-	.symbol = len_symbol
-};
+static inline void refill_bits(inflate_state_t *state)
+{
+	if (state->srclen - state->srccnt >= sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, state->src + state->srccnt, sizeof(word));
+
+		state->bitbuf |= uint64_t_le2host(word) << state->bitlen;
+		state->srccnt += (63 - state->bitlen) >> 3;
+		state->bitlen |= 56;
+		return;
+	}
+
+	while ((state->bitlen <= 56) && (state->srccnt < state->srclen)) {
+		state->bitbuf |=
+		    ((uint64_t) state->src[state->srccnt]) << state->bitlen;
+		state->srccnt++;
+		state->bitlen += 8;
+	}
+}
 
-/** Huffman code for distances
+/** Drop bits from the bit buffer
+ *
+ * @param state Inflate state.
+ * @param cnt   Number of bits to drop (at most bitlen).
  *
  */
-static huffman_t dist_code = {
-	.count = dist_count,
-	.symbol = dist_symbol
-};
+static inline void drop_bits(inflate_state_t *state, size_t cnt)
+{
+	state->bitbuf >>= cnt;
+	state->bitlen -= cnt;
+}
 
 /** Get bits from the bit buffer
  *
@@ -236,26 +287,19 @@ static huffman_t dist_code = {
  */
 static inline uint16_t get_bits(inflate_state_t *state, size_t cnt)
 {
-	/* Bit accumulator for at least 20 bits */
-	uint32_t val = state->bitbuf;
+	if (state->bitlen < cnt) {
+		refill_bits(state);
 
-	while (state->bitlen < cnt) {
-		if (state->srccnt == state->srclen) {
+		if (state->bitlen < cnt) {
 			state->overrun = true;
 			return 0;
 		}
-
-		/* Load 8 more bits */
-		val |= ((uint32_t) state->src[state->srccnt]) << state->bitlen;
-		state->srccnt++;
-		state->bitlen += 8;
 	}
 
-	/* Update bits in the buffer */
-	state->bitbuf = (uint16_t) (val >> cnt);
-	state->bitlen -= cnt;
+	uint16_t val = (uint16_t) (state->bitbuf & ((1 << cnt) - 1));
+	drop_bits(state, cnt);
 
-	return ((uint16_t) (val & ((1 << cnt) - 1)));
+	return val;
 }
 
 /** Decode `stored' block
@@ -270,7 +314,11 @@ static inline uint16_t get_bits(inflate_state_t *state, size_t cnt)
  */
 static errno_t inflate_stored(inflate_state_t *state)
 {
-	/* Discard bits in the bit buffer */
+	/*
+	 * Discard the bits up to the byte boundary and return the whole
+	 * bytes left in the bit buffer to the input.
+	 */
+	state->srccnt -= state->bitlen / 8;
 	state->bitbuf = 0;
 	state->bitlen = 0;
 
@@ -304,7 +352,9 @@ static errno_t inflate_stored(inflate_state_t *state)
 	return EOK;
 }
 
-/** Decode a symbol using the Huffman code
+/** Decode a symbol using the canonical Huffman code
+ *
+ * Slow path for codes not resolved by the lookup table.
  *
  * @param state   Inflate state.
  * @param huffman Huffman code.
@@ -312,11 +362,15 @@ static errno_t inflate_stored(inflate_state_t *state)
  *
  * @param EOK on success.
  * @param EINVAL on invalid Huffman code.
+ * @param ELIMIT on input buffer overrun.
  *
  */
-static errno_t huffman_decode(inflate_state_t *state, huffman_t *huffman,
+static errno_t huffman_decode_slow(inflate_state_t *state, huffman_t *huffman,
     uint16_t *symbol)
 {
+	/* Input bits not yet consumed */
+	uint64_t bits = state->bitbuf;
+
 	/* Decode bits */
 	uint16_t code = 0;
 
@@ -333,14 +387,18 @@ static errno_t huffman_decode(inflate_state_t *state, huffman_t *huffman,
 	size_t len;
 
 	for (len = 1; len <= MAX_HUFFMAN_BIT; len++) {
+		if (len > state->bitlen)
+			return ELIMIT;
+
 		/* Get next bit */
-		code |= get_bits(state, 1);
-		CHECK_OVERRUN(*state);
+		code |= bits & 1;
+		bits >>= 1;
 
 		uint16_t count = huffman->count[len];
 		if (code < first + count) {
 			/* Return decoded symbol */
 			*symbol = huffman->symbol[index + code - first];
+			drop_bits(state, len);
 			return EOK;
 		}
 
@@ -354,6 +412,71 @@ static errno_t huffman_decode(inflate_state_t *state, huffman_t *huffman,
 	return EINVAL;
 }
 
+/** Decode a symbol using the Huffman code
+ *
+ * @param state   Inflate state.
+ * @param huffman Huffman code.
+ * @param symbol  Decoded symbol.
+ *
+ * @param EOK on success.
+ * @param EINVAL on invalid Huffman code.
+ * @param ELIMIT on input buffer overrun.
+ *
+ */
+static inline errno_t huffman_decode(inflate_state_t *state,
+    huffman_t *huffman, uint16_t *symbol)
+{
+	if (state->bitlen < MAX_HUFFMAN_BIT)
+		refill_bits(state);
+
+	uint16_t entry =
+	    huffman->fast[state->bitbuf & (HUFFMAN_FAST_SIZE - 1)];
+	size_t len = entry & ((1 << HUFFMAN_FAST_LEN_BITS) - 1);
+
+	if ((len == 0) || (len > state->bitlen))
+		return huffman_decode_slow(state, huffman, symbol);
+
+	*symbol = entry >> HUFFMAN_FAST_LEN_BITS;
+	drop_bits(state, len);
+	return EOK;
+}
+
+/** Fill the lookup table of a Huffman code
+ *
+ * Canonical codes of each length are consecutive and assigned in the
+ * order of the symbol table, which is enough to compute the code of
+ * every symbol. The input holds the codes starting with their most
+ * significant bit, so the table is indexed by the bit-reversed code.
+ *
+ * @param huffman Huffman code with valid counts and symbols.
+ *
+ */
+static void huffman_fast_construct(huffman_t *huffman)
+{
+	memset(huffman->fast, 0, HUFFMAN_FAST_SIZE * sizeof(uint16_t));
+
+	size_t code = 0;
+	size_t index = 0;
+
+	for (size_t len = 1; len <= HUFFMAN_FAST_BITS; len++) {
+		for (size_t i = 0; i < huffman->count[len]; i++) {
+			size_t rev = 0;
+			for (size_t bit = 0; bit < len; bit++)
+				rev |= ((code >> bit) & 1) << (len - 1 - bit);
+
+			uint16_t entry =
+			    (huffman->symbol[index] << HUFFMAN_FAST_LEN_BITS) | len;
+			for (size_t j = rev; j < HUFFMAN_FAST_SIZE; j += 1 << len)
+				huffman->fast[j] = entry;
+
+			code++;
+			index++;
+		}
+
+		code <<= 1;
+	}
+}
+
 /** Construct Huffman tables from canonical Huffman code
  *
  * @param huffman Constructed Huffman tables.
@@ -379,6 +502,7 @@ static int16_t huffman_construct(huffman_t *huffman, uint16_t *length, size_t n)
 
 	if (huffman->count[0] == n) {
 		/* The code is complete, but decoding will fail */
+		memset(huffman->fast, 0, HUFFMAN_FAST_SIZE * sizeof(uint16_t));
 		return 0;
 	}
 
@@ -407,6 +531,7 @@ static int16_t huffman_construct(huffman_t *huffman, uint16_t *length, size_t n)
 		}
 	}
 
+	huffman_fast_construct(huffman);
 	return left;
 }
 
@@ -458,19 +583,35 @@ static errno_t inflate_codes(inflate_state_t *state, huffman_t *len_code,
 			if (err != EOK)
 				return err;
 
+			if (symbol >= MAX_DIST)
+				return EINVAL;
+
 			size_t dist = dists[symbol] + get_bits(state, dists_ext[symbol]);
+			CHECK_OVERRUN(*state);
+
 			if (dist > state->destcnt)
 				return ENOENT;
 
 			if (state->destcnt + len > state->destlen)
 				return ENOMEM;
 
-			while (len > 0) {
-				/* Copy len bytes from distance bytes back */
-				state->dest[state->destcnt] =
-				    state->dest[state->destcnt - dist];
-				state->destcnt++;
-				len--;
+			/* Copy len bytes from distance bytes back */
+			uint8_t *out = state->dest + state->destcnt;
+			const uint8_t *from = out - dist;
+			state->destcnt += len;
+
+			if (dist == 1) {
+				memset(out, *from, len);
+			} else {
+				/* Overlapping copy repeats the last dist bytes */
+				while (len > dist) {
+					memcpy(out, from, dist);
+					out += dist;
+					from += dist;
+					len -= dist;
+				}
+
+				memcpy(out, from, len);
 			}
 		}
 	} while (symbol != 256);
@@ -481,8 +622,6 @@ static errno_t inflate_codes(inflate_state_t *state, huffman_t *len_code,
 /** Decode `fixed codes' block
  *
  * @param state     Inflate state.
- * @param len_code  Huffman code for literal/length.
- * @param dist_code Huffman code for distance.
  *
  * @return EOK on success.
  * @return ENOENT on distance too large.
@@ -491,10 +630,25 @@ static errno_t inflate_codes(inflate_state_t *state, huffman_t *len_code,
  * @return ENOMEM on output buffer overrun.
  *
  */
-static errno_t inflate_fixed(inflate_state_t *state, huffman_t *len_code,
-    huffman_t *dist_code)
+static errno_t inflate_fixed(inflate_state_t *state)
 {
-	return inflate_codes(state, len_code, dist_code);
+	uint16_t len_fast[HUFFMAN_FAST_SIZE];
+	uint16_t dist_fast[HUFFMAN_FAST_SIZE];
+	huffman_t len_code;
+	huffman_t dist_code;
+
+	len_code.count = len_count;
+	len_code.symbol = len_symbol;
+	len_code.fast = len_fast;
+
+	dist_code.count = dist_count;
+	dist_code.symbol = dist_symbol;
+	dist_code.fast = dist_fast;
+
+	huffman_fast_construct(&len_code);
+	huffman_fast_construct(&dist_code);
+
+	return inflate_codes(state, &len_code, &dist_code);
 }
 
 /** Decode `dynamic codes' block
@@ -515,14 +669,18 @@ static errno_t inflate_dynamic(inflate_state_t *state)
 	uint16_t dyn_len_symbol[MAX_LITLEN];
 	uint16_t dyn_dist_count[MAX_HUFFMAN_BIT + 1];
 	uint16_t dyn_dist_symbol[MAX_DIST];
+	uint16_t dyn_len_fast[HUFFMAN_FAST_SIZE];
+	uint16_t dyn_dist_fast[HUFFMAN_FAST_SIZE];
 	huffman_t dyn_len_code;
 	huffman_t dyn_dist_code;
 
 	dyn_len_code.count = dyn_len_count;
 	dyn_len_code.symbol = dyn_len_symbol;
+	dyn_len_code.fast = dyn_len_fast;
 
 	dyn_dist_code.count = dyn_dist_count;
 	dyn_dist_code.symbol = dyn_dist_symbol;
+	dyn_dist_code.fast = dyn_dist_fast;
 
 	/* Get number of bits in each table */
 	uint16_t nlen = get_bits(state, 5) + 257;
@@ -560,7 +718,7 @@ static errno_t inflate_dynamic(inflate_state_t *state)
 		uint16_t symbol;
 		errno_t err = huffman_decode(state, &dyn_len_code, &symbol);
 		if (err != EOK)
-			return EOK;
+			return err;
 
 		if (symbol < 16) {
 			length[index] = symbol;
@@ -660,7 +818,7 @@ errno_t inflate(void *src, size_t srclen, void *dest, size_t destlen)
 			ret = inflate_stored(&state);
 			break;
 		case 1:
-			ret = inflate_fixed(&state, &len_code, &dist_code);
+			ret = inflate_fixed(&state);
 			break;
 		case 2:
 			ret = inflate_dynamic(&state);
@@ -672,3 +830,764 @@ errno_t inflate(void *src, size_t srclen, void *dest, size_t destlen)
 
 	return ret;
 }
+
+/** Size of the sliding window of the streaming decoder */
+#define INFLATE_WINDOW_SIZE  32768
+/** Mask of positions in the sliding window */
+#define INFLATE_WINDOW_MASK  (INFLATE_WINDOW_SIZE - 1)
+/** Longest output of a single length/distance pair */
+#define INFLATE_MAX_MATCH    258
+
+/** Streaming decoder phases */
+typedef enum {
+	/** Expecting a block header */
+	INFLATE_PHASE_HEADER,
+	/** Expecting the length of a stored block */
+	INFLATE_PHASE_STORED_LEN,
+	/** Copying the data of a stored block */
+	INFLATE_PHASE_STORED,
+	/** Expecting the sizes of the dynamic code tables */
+	INFLATE_PHASE_TABLE_SIZES,
+	/** Reading the code length code lengths */
+	INFLATE_PHASE_TABLE_ORDER,
+	/** Reading the literal/length and distance code lengths */
+	INFLATE_PHASE_TABLE_LENS,
+	/** Decoding the compressed data of a block */
+	INFLATE_PHASE_CODES,
+	/** The last block has been decoded */
+	INFLATE_PHASE_DONE
+} inflate_phase_t;
+
+/** Streaming inflate context
+ *
+ * The decoder reuses inflate_state_t for its bit buffer with the source
+ * pointing to the current input chunk. Each syntactic unit (a block
+ * header, one code length, one literal or one length/distance pair) is
+ * decoded atomically: if the chunk ends in the middle of a unit, the bit
+ * buffer is rolled back to the start of the unit and the rest of the
+ * chunk is moved into the bit buffer, so that decoding can be resumed
+ * once the next chunk arrives.
+ *
+ * The decoded data are kept in a ring buffer which doubles as the
+ * sliding window of back references.
+ *
+ */
+struct inflate_stream {
+	inflate_state_t state;     /**< Bit buffer and current input chunk */
+	inflate_phase_t phase;     /**< Decoder phase */
+	bool last;                 /**< Current block is the last one */
+	errno_t error;             /**< Sticky decoding error */
+
+	uint8_t window[INFLATE_WINDOW_SIZE];  /**< Recent output */
+	size_t wpos;               /**< Position of the next output byte */
+	size_t whave;              /**< Valid bytes in the window */
+	size_t pending;            /**< Bytes not yet returned to the caller */
+
+	size_t stored_left;        /**< Bytes left in a stored block */
+
+	uint16_t nlen;             /**< Number of literal/length codes */
+	uint16_t ndist;            /**< Number of distance codes */
+	uint16_t ncode;            /**< Number of code length codes */
+	uint16_t index;            /**< Index of the next code length */
+	uint16_t length[MAX_CODE]; /**< Code lengths */
+
+	uint16_t len_count[MAX_HUFFMAN_BIT + 1];
+	uint16_t len_symbol[MAX_LITLEN];
+	uint16_t len_fast[HUFFMAN_FAST_SIZE];
+	uint16_t dist_count[MAX_HUFFMAN_BIT + 1];
+	uint16_t dist_symbol[MAX_DIST];
+	uint16_t dist_fast[HUFFMAN_FAST_SIZE];
+	huffman_t len_code;        /**< Literal/length code */
+	huffman_t dist_code;       /**< Distance code */
+};
+
+/** Bit buffer snapshot */
+typedef struct {
+	uint64_t bitbuf;
+	size_t bitlen;
+	size_t srccnt;
+} inflate_mark_t;
+
+/** Remember the bit buffer position before decoding a unit
+ *
+ * @param stream Streaming inflate context.
+ * @param mark   Snapshot to fill in.
+ *
+ */
+static inline void inflate_stream_mark(inflate_stream_t *stream,
+    inflate_mark_t *mark)
+{
+	mark->bitbuf = stream->state.bitbuf;
+	mark->bitlen = stream->state.bitlen;
+	mark->srccnt = stream->state.srccnt;
+}
+
+/** Roll back a partially decoded unit and wait for more input
+ *
+ * The unit did not fit into the available input, which therefore
+ * consists of less than 48 bits. All of it is moved into the bit buffer,
+ * making the current chunk consumed.
+ *
+ * @param stream Streaming inflate context.
+ * @param mark   Snapshot taken before the unit.
+ *
+ * @return EAGAIN.
+ *
+ */
+static errno_t inflate_stream_rollback(inflate_stream_t *stream,
+    inflate_mark_t *mark)
+{
+	inflate_state_t *state = &stream->state;
+
+	state->bitbuf = mark->bitbuf;
+	state->bitlen = mark->bitlen;
+	state->srccnt = mark->srccnt;
+	state->overrun = false;
+
+	if (state->bitlen < 64)
+		state->bitbuf &= (UINT64_C(1) << state->bitlen) - 1;
+
+	while (state->srccnt < state->srclen) {
+		state->bitbuf |=
+		    ((uint64_t) state->src[state->srccnt]) << state->bitlen;
+		state->srccnt++;
+		state->bitlen += 8;
+	}
+
+	return EAGAIN;
+}
+
+/** Append a byte to the window
+ *
+ * @param stream Streaming inflate context.
+ * @param byte   Decoded byte.
+ *
+ */
+static inline void inflate_stream_put(inflate_stream_t *stream, uint8_t byte)
+{
+	stream->window[stream->wpos] = byte;
+	stream->wpos = (stream->wpos + 1) & INFLATE_WINDOW_MASK;
+	stream->pending++;
+
+	if (stream->whave < INFLATE_WINDOW_SIZE)
+		stream->whave++;
+}
+
+/** Append a back reference to the window
+ *
+ * @param stream Streaming inflate context.
+ * @param len    Length of the match.
+ * @param dist   Distance of the match (at most whave).
+ *
+ */
+static void inflate_stream_copy(inflate_stream_t *stream, size_t len,
+    size_t dist)
+{
+	size_t from = (stream->wpos - dist) & INFLATE_WINDOW_MASK;
+
+	/*
+	 * The source and destination must not wrap around the end of the
+	 * window and must not overlap. With a distance close to the window
+	 * size the source starts just after the destination.
+	 */
+	if ((dist >= len) && (from + len <= INFLATE_WINDOW_SIZE) &&
+	    (stream->wpos + len <= INFLATE_WINDOW_SIZE) &&
+	    ((from + len <= stream->wpos) || (stream->wpos + len <= from))) {
+		memcpy(stream->window + stream->wpos, stream->window + from, len);
+		stream->wpos = (stream->wpos + len) & INFLATE_WINDOW_MASK;
+	} else {
+		for (size_t i = 0; i < len; i++) {
+			stream->window[stream->wpos] = stream->window[from];
+			stream->wpos = (stream->wpos + 1) & INFLATE_WINDOW_MASK;
+			from = (from + 1) & INFLATE_WINDOW_MASK;
+		}
+	}
+
+	stream->pending += len;
+	stream->whave += len;
+	if (stream->whave > INFLATE_WINDOW_SIZE)
+		stream->whave = INFLATE_WINDOW_SIZE;
+}
+
+/** Decode a block header
+ *
+ * @param stream Streaming inflate context.
+ *
+ * @return EOK on success.
+ * @return EAGAIN if more input is needed.
+ * @return EINVAL on invalid block type.
+ *
+ */
+static errno_t inflate_stream_header(inflate_stream_t *stream)
+{
+	inflate_mark_t mark;
+	inflate_stream_mark(stream, &mark);
+
+	uint16_t last = get_bits(&stream->state, 1);
+	uint16_t type = get_bits(&stream->state, 2);
+	if (stream->state.overrun)
+		return inflate_stream_rollback(stream, &mark);
+
+	stream->last = (last != 0);
+
+	switch (type) {
+	case 0:
+		stream->phase = INFLATE_PHASE_STORED_LEN;
+		break;
+	case 1:
+		stream->len_code.count = len_count;
+		stream->len_code.symbol = len_symbol;
+		stream->dist_code.count = dist_count;
+		stream->dist_code.symbol = dist_symbol;
+
+		huffman_fast_construct(&stream->len_code);
+		huffman_fast_construct(&stream->dist_code);
+
+		stream->phase = INFLATE_PHASE_CODES;
+		break;
+	case 2:
+		stream->len_code.count = stream->len_count;
+		stream->len_code.symbol = stream->len_symbol;
+		stream->dist_code.count = stream->dist_count;
+		stream->dist_code.symbol = stream->dist_symbol;
+
+		stream->phase = INFLATE_PHASE_TABLE_SIZES;
+		break;
+	default:
+		return EINVAL;
+	}
+
+	return EOK;
+}
+
+/** Decode the length of a stored block
+ *
+ * @param stream Streaming inflate context.
+ *
+ * @return EOK on success.
+ * @return EAGAIN if more input is needed.
+ * @return EINVAL on invalid length.
+ *
+ */
+static errno_t inflate_stream_stored_len(inflate_stream_t *stream)
+{
+	inflate_mark_t mark;
+	inflate_stream_mark(stream, &mark);
+
+	/* Discard leftover bits from current byte */
+	drop_bits(&stream->state, stream->state.bitlen & 7);
+
+	uint16_t len = get_bits(&stream->state, 16);
+	uint16_t nlen = get_bits(&stream->state, 16);
+	if (stream->state.overrun)
+		return inflate_stream_rollback(stream, &mark);
+
+	if ((uint16_t) (len ^ nlen) != 0xffff)
+		return EINVAL;
+
+	stream->stored_left = len;
+	stream->phase = INFLATE_PHASE_STORED;
+	return EOK;
+}
+
+/** Copy the data of a stored block into the window
+ *
+ * @param stream Streaming inflate context.
+ *
+ * @return EOK if the block is complete or the window is full.
+ * @return EAGAIN if more input is needed.
+ *
+ */
+static errno_t inflate_stream_stored(inflate_stream_t *stream)
+{
+	inflate_state_t *state = &stream->state;
+
+	/* Whole bytes left in the bit buffer come first */
+	while ((stream->stored_left > 0) && (state->bitlen >= 8) &&
+	    (stream->pending < INFLATE_WINDOW_SIZE)) {
+		inflate_stream_put(stream, (uint8_t) get_bits(state, 8));
+		stream->stored_left--;
+	}
+
+	if (state->bitlen == 0) {
+		/* The input is read directly, drop the prefetched bits */
+		state->bitbuf = 0;
+
+		while ((stream->stored_left > 0) &&
+		    (state->srccnt < state->srclen) &&
+		    (stream->pending < INFLATE_WINDOW_SIZE)) {
+			size_t cnt = stream->stored_left;
+
+			if (cnt > state->srclen - state->srccnt)
+				cnt = state->srclen - state->srccnt;
+
+			if (cnt > INFLATE_WINDOW_SIZE - stream->pending)
+				cnt = INFLATE_WINDOW_SIZE - stream->pending;
+
+			if (cnt > INFLATE_WINDOW_SIZE - stream->wpos)
+				cnt = INFLATE_WINDOW_SIZE - stream->wpos;
+
+			memcpy(stream->window + stream->wpos,
+			    state->src + state->srccnt, cnt);
+			state->srccnt += cnt;
+			stream->wpos = (stream->wpos + cnt) & INFLATE_WINDOW_MASK;
+			stream->pending += cnt;
+			stream->whave += cnt;
+			if (stream->whave > INFLATE_WINDOW_SIZE)
+				stream->whave = INFLATE_WINDOW_SIZE;
+
+			stream->stored_left -= cnt;
+		}
+	}
+
+	if (stream->stored_left == 0) {
+		stream->phase = stream->last ? INFLATE_PHASE_DONE :
+		    INFLATE_PHASE_HEADER;
+		return EOK;
+	}
+
+	if (stream->pending == INFLATE_WINDOW_SIZE)
+		return EOK;
+
+	return EAGAIN;
+}
+
+/** Decode the sizes of the dynamic code tables
+ *
+ * @param stream Streaming inflate context.
+ *
+ * @return EOK on success.
+ * @return EAGAIN if more input is needed.
+ * @return EINVAL on invalid sizes.
+ *
+ */
+static errno_t inflate_stream_table_sizes(inflate_stream_t *stream)
+{
+	inflate_mark_t mark;
+	inflate_stream_mark(stream, &mark);
+
+	stream->nlen = get_bits(&stream->state, 5) + 257;
+	stream->ndist = get_bits(&stream->state, 5) + 1;
+	stream->ncode = get_bits(&stream->state, 4) + 4;
+	if (stream->state.overrun)
+		return inflate_stream_rollback(stream, &mark);
+
+	if ((stream->nlen > MAX_LITLEN) || (stream->ndist > MAX_DIST) ||
+	    (stream->ncode > MAX_ORDER))
+		return EINVAL;
+
+	stream->index = 0;
+	stream->phase = INFLATE_PHASE_TABLE_ORDER;
+	return EOK;
+}
+
+/** Decode the code length code lengths
+ *
+ * @param stream Streaming inflate context.
+ *
+ * @return EOK on success.
+ * @return EAGAIN if more input is needed.
+ * @return EINVAL on invalid code.
+ *
+ */
+static errno_t inflate_stream_table_order(inflate_stream_t *stream)
+{
+	while (stream->index < stream->ncode) {
+		inflate_mark_t mark;
+		inflate_stream_mark(stream, &mark);
+
+		uint16_t len = get_bits(&stream->state, 3);
+		if (stream->state.overrun)
+			return inflate_stream_rollback(stream, &mark);
+
+		stream->length[order[stream->index]] = len;
+		stream->index++;
+	}
+
+	/* Set missing lengths to zero */
+	for (uint16_t index = stream->ncode; index < MAX_ORDER; index++)
+		stream->length[order[index]] = 0;
+
+	/* Build Huffman code */
+	stream->len_code.fast = stream->len_fast;
+	int16_t rc = huffman_construct(&stream->len_code, stream->length,
+	    MAX_ORDER);
+	if (rc != 0)
+		return EINVAL;
+
+	stream->index = 0;
+	stream->phase = INFLATE_PHASE_TABLE_LENS;
+	return EOK;
+}
+
+/** Decode the literal/length and distance code lengths
+ *
+ * @param stream Streaming inflate context.
+ *
+ * @return EOK on success.
+ * @return EAGAIN if more input is needed.
+ * @return EINVAL on invalid code.
+ *
+ */
+static errno_t inflate_stream_table_lens(inflate_stream_t *stream)
+{
+	uint16_t total = stream->nlen + stream->ndist;
+
+	while (stream->index < total) {
+		inflate_mark_t mark;
+		inflate_stream_mark(stream, &mark);
+
+		uint16_t symbol;
+		errno_t err = huffman_decode(&stream->state, &stream->len_code,
+		    &symbol);
+		if (err == ELIMIT)
+			return inflate_stream_rollback(stream, &mark);
+
+		if (err != EOK)
+			return err;
+
+		if (symbol < 16) {
+			stream->length[stream->index] = symbol;
+			stream->index++;
+			continue;
+		}
+
+		uint16_t len = 0;
+
+		if (symbol == 16) {
+			if (stream->index == 0)
+				return EINVAL;
+
+			len = stream->length[stream->index - 1];
+			symbol = get_bits(&stream->state, 2) + 3;
+		} else if (symbol == 17) {
+			symbol = get_bits(&stream->state, 3) + 3;
+		} else {
+			symbol = get_bits(&stream->state, 7) + 11;
+		}
+
+		if (stream->state.overrun)
+			return inflate_stream_rollback(stream, &mark);
+
+		if (stream->index + symbol > total)
+			return EINVAL;
+
+		while (symbol > 0) {
+			stream->length[stream->index] = len;
+			stream->index++;
+			symbol--;
+		}
+	}
+
+	/* Check for end-of-block code */
+	if (stream->length[256] == 0)
+		return EINVAL;
+
+	/* Build Huffman tables for literal/length codes */
+	int16_t rc = huffman_construct(&stream->len_code, stream->length,
+	    stream->nlen);
+	if ((rc < 0) ||
+	    ((rc > 0) && (stream->len_code.count[0] + 1 != stream->nlen)))
+		return EINVAL;
+
+	/* Build Huffman tables for distance codes */
+	rc = huffman_construct(&stream->dist_code,
+	    stream->length + stream->nlen, stream->ndist);
+	if ((rc < 0) ||
+	    ((rc > 0) && (stream->dist_code.count[0] + 1 != stream->ndist)))
+		return EINVAL;
+
+	stream->phase = INFLATE_PHASE_CODES;
+	return EOK;
+}
+
+/** Decode compressed data into the window
+ *
+ * Decoding stops at the end of the block or when the window might not
+ * have room for the longest match.
+ *
+ * @param stream Streaming inflate context.
+ *
+ * @return EOK at the end of block or when the window is full.
+ * @return EAGAIN if more input is needed.
+ * @return ENOENT on distance too large.
+ * @return EINVAL on invalid Huffman code.
+ *
+ */
+static errno_t inflate_stream_codes(inflate_stream_t *stream)
+{
+	inflate_state_t *state = &stream->state;
+
+	while (stream->pending <= INFLATE_WINDOW_SIZE - INFLATE_MAX_MATCH) {
+		inflate_mark_t mark;
+		inflate_stream_mark(stream, &mark);
+
+		uint16_t symbol;
+		errno_t err = huffman_decode(state, &stream->len_code, &symbol);
+		if (err == ELIMIT)
+			return inflate_stream_rollback(stream, &mark);
+
+		if (err != EOK)
+			return err;
+
+		if (symbol < 256) {
+			inflate_stream_put(stream, (uint8_t) symbol);
+			continue;
+		}
+
+		if (symbol == 256) {
+			stream->phase = stream->last ? INFLATE_PHASE_DONE :
+			    INFLATE_PHASE_HEADER;
+			return EOK;
+		}
+
+		/* Compute length */
+		symbol -= 257;
+		if (symbol >= 29)
+			return EINVAL;
+
+		size_t len = lens[symbol] + get_bits(state, lens_ext[symbol]);
+		if (state->overrun)
+			return inflate_stream_rollback(stream, &mark);
+
+		/* Get distance */
+		err = huffman_decode(state, &stream->dist_code, &symbol);
+		if (err == ELIMIT)
+			return inflate_stream_rollback(stream, &mark);
+
+		if (err != EOK)
+			return err;
+
+		if (symbol >= MAX_DIST)
+			return EINVAL;
+
+		size_t dist = dists[symbol] + get_bits(state, dists_ext[symbol]);
+		if (state->overrun)
+			return inflate_stream_rollback(stream, &mark);
+
+		if (dist > stream->whave)
+			return ENOENT;
+
+		inflate_stream_copy(stream, len, dist);
+	}
+
+	return EOK;
+}
+
+/** Create streaming inflate context
+ *
+ * @param[out] rstream Place to store pointer to the new context.
+ *
+ * @return EOK on success.
+ * @return ENOMEM if out of memory.
+ *
+ */
+errno_t inflate_stream_create(inflate_stream_t **rstream)
+{
+	inflate_stream_t *stream = calloc(1, sizeof(inflate_stream_t));
+	if (stream == NULL)
+		return ENOMEM;
+
+	stream->phase = INFLATE_PHASE_HEADER;
+	stream->error = EOK;
+	stream->len_code.fast = stream->len_fast;
+	stream->dist_code.fast = stream->dist_fast;
+
+	*rstream = stream;
+	return EOK;
+}
+
+/** Destroy streaming inflate context
+ *
+ * @param stream Streaming inflate context or NULL.
+ *
+ */
+void inflate_stream_destroy(inflate_stream_t *stream)
+{
+	free(stream);
+}
+
+/** Supply the next chunk of compressed data
+ *
+ * The chunk is referenced (not copied) until it is consumed, which is
+ * signalled by inflate_stream_output() returning less data than
+ * requested before the end of the stream. Only then may the next
+ * chunk be supplied.
+ *
+ * @param stream Streaming inflate context.
+ * @param src    Compressed data.
+ * @param srclen Size of the compressed data (bytes).
+ *
+ */
+void inflate_stream_input(inflate_stream_t *stream, const void *src,
+    size_t srclen)
+{
+	assert(stream->state.srccnt == stream->state.srclen);
+
+	stream->state.src = (uint8_t *) src;
+	stream->state.srclen = srclen;
+	stream->state.srccnt = 0;
+}
+
+/** Copy pending decoded data to the caller
+ *
+ * @param stream Streaming inflate context.
+ * @param dest   Destination buffer.
+ * @param size   Free space in the destination buffer (bytes).
+ *
+ * @return Number of bytes copied.
+ *
+ */
+static size_t inflate_stream_drain(inflate_stream_t *stream, uint8_t *dest,
+    size_t size)
+{
+	size_t cnt = (size < stream->pending) ? size : stream->pending;
+	size_t start = (stream->wpos - stream->pending) & INFLATE_WINDOW_MASK;
+	size_t first = INFLATE_WINDOW_SIZE - start;
+
+	if (first >= cnt) {
+		memcpy(dest, stream->window + start, cnt);
+	} else {
+		memcpy(dest, stream->window + start, first);
+		memcpy(dest + first, stream->window, cnt - first);
+	}
+
+	stream->pending -= cnt;
+	return cnt;
+}
+
+/** Decompress data
+ *
+ * Decode as much of the supplied input as possible. If less than @a size
+ * bytes are produced, either the whole input has been consumed and the
+ * next chunk can be supplied, or the end of the stream has been reached.
+ *
+ * @param stream        Streaming inflate context.
+ * @param dest          Destination buffer.
+ * @param size          Size of the destination buffer (bytes).
+ * @param[out] produced Number of decompressed bytes stored.
+ *
+ * @return EOK on success.
+ * @return ENOENT on distance too large.
+ * @return EINVAL on invalid Huffman code or invalid deflate data.
+ *
+ */
+errno_t inflate_stream_output(inflate_stream_t *stream, void *dest,
+    size_t size, size_t *produced)
+{
+	uint8_t *out = (uint8_t *) dest;
+	size_t cnt = 0;
+
+	*produced = 0;
+	if (stream->error != EOK)
+		return stream->error;
+
+	while (true) {
+		cnt += inflate_stream_drain(stream, out + cnt, size - cnt);
+		if ((cnt == size) || (stream->phase == INFLATE_PHASE_DONE))
+			break;
+
+		errno_t rc;
+
+		switch (stream->phase) {
+		case INFLATE_PHASE_HEADER:
+			rc = inflate_stream_header(stream);
+			break;
+		case INFLATE_PHASE_STORED_LEN:
+			rc = inflate_stream_stored_len(stream);
+			break;
+		case INFLATE_PHASE_STORED:
+			rc = inflate_stream_stored(stream);
+			break;
+		case INFLATE_PHASE_TABLE_SIZES:
+			rc = inflate_stream_table_sizes(stream);
+			break;
+		case INFLATE_PHASE_TABLE_ORDER:
+			rc = inflate_stream_table_order(stream);
+			break;
+		case INFLATE_PHASE_TABLE_LENS:
+			rc = inflate_stream_table_lens(stream);
+			break;
+		case INFLATE_PHASE_CODES:
+			rc = inflate_stream_codes(stream);
+			break;
+		default:
+			assert(false);
+			rc = EINVAL;
+		}
+
+		if (stream->phase == INFLATE_PHASE_DONE) {
+			/* Trailing data start at a byte boundary */
+			drop_bits(&stream->state, stream->state.bitlen & 7);
+		}
+
+		if (rc == EAGAIN) {
+			/* Flush what has been decoded so far */
+			cnt += inflate_stream_drain(stream, out + cnt, size - cnt);
+			break;
+		}
+
+		if (rc != EOK) {
+			stream->error = rc;
+			*produced = cnt;
+			return rc;
+		}
+	}
+
+	*produced = cnt;
+	return EOK;
+}
+
+/** Check whether the end of the stream has been reached
+ *
+ * @param stream Streaming inflate context.
+ *
+ * @return True if the last block has been decoded and all decompressed
+ *         data have been returned.
+ *
+ */
+bool inflate_stream_finished(inflate_stream_t *stream)
+{
+	return (stream->phase == INFLATE_PHASE_DONE) && (stream->pending == 0);
+}
+
+/** Retrieve input data following the end of the stream
+ *
+ * Container formats store a trailer after the deflate stream. These
+ * bytes might have been already read into the bit buffer or be left
+ * in the current input chunk.
+ *
+ * @param stream Streaming inflate context (finished).
+ * @param dest   Destination buffer.
+ * @param size   Size of the destination buffer (bytes).
+ *
+ * @return Number of bytes stored.
+ *
+ */
+size_t inflate_stream_tail(inflate_stream_t *stream, void *dest, size_t size)
+{
+	inflate_state_t *state = &stream->state;
+	uint8_t *out = (uint8_t *) dest;
+	size_t cnt = 0;
+
+	assert(stream->phase == INFLATE_PHASE_DONE);
+
+	while ((cnt < size) && (state->bitlen >= 8)) {
+		out[cnt] = (uint8_t) get_bits(state, 8);
+		cnt++;
+	}
+
+	if (state->bitlen == 0)
+		state->bitbuf = 0;
+
+	size_t rest = state->srclen - state->srccnt;
+	if (rest > size - cnt)
+		rest = size - cnt;
+
+	if (rest > 0) {
+		memcpy(out + cnt, state->src + state->srccnt, rest);
+		state->srccnt += rest;
+	}
+
+	return cnt + rest;
+}
@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <macros.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "../deflate.h"
+#include "../inflate.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(deflate);
+
+enum {
+	/** Size of test data (more than the window) */
+	test_data_size = 100000,
+	/** Size of buffer for compressed data */
+	test_comp_size = 2 * test_data_size
+};
+
+/** Fill buffer with compressible pseudo-random data.
+ *
+ * Short random literal runs alternate with copies of earlier data
+ * from distances up to beyond the window size.
+ */
+static void test_data_fill(uint8_t *buf, size_t size)
+{
+	uint32_t state = 1;
+	size_t pos = 0;
+	size_t len;
+	size_t dist;
+
+	while (pos < size) {
+		state = state * 1103515245 + 12345;
+		if (pos > 0 && (state >> 16) % 4 == 0) {
+			state = state * 1103515245 + 12345;
+			dist = 1 + (state >> 8) % min(pos, 40000);
+			len = 3 + (state >> 24) % 300;
+			for (size_t i = 0; i < len && pos < size; i++) {
+				buf[pos] = buf[pos - dist];
+				pos++;
+			}
+		} else {
+			len = 1 + (state >> 16) % 16;
+			for (size_t i = 0; i < len && pos < size; i++) {
+				state = state * 1103515245 + 12345;
+				buf[pos++] = 'a' + (state >> 16) % 26;
+			}
+		}
+	}
+}
+
+/** Deflate data supplying input and taking output in chunks.
+ *
+ * @param level    Compression level
+ * @param src      Data to compress
+ * @param srclen   Size of data
+ * @param ichunk   Input chunk size
+ * @param ochunk   Output chunk size
+ * @param dest     Destination buffer
+ * @param destsize Size of destination buffer
+ * @param destlen  Place to store size of compressed data
+ * @return EOK on success, ENOMEM if the destination buffer is too small
+ */
+static errno_t test_deflate_chunked(unsigned level, const uint8_t *src,
+    size_t srclen, size_t ichunk, size_t ochunk, uint8_t *dest,
+    size_t destsize, size_t *destlen)
+{
+	deflate_stream_t *stream;
+	size_t ipos;
+	size_t olen = 0;
+	size_t req;
+	size_t produced;
+	errno_t rc;
+
+	rc = deflate_stream_create(level, &stream);
+	if (rc != EOK)
+		return rc;
+
+	ipos = min(ichunk, srclen);
+	deflate_stream_input(stream, src, ipos);
+	if (ipos == srclen)
+		deflate_stream_finish(stream);
+
+	while (true) {
+		req = min(ochunk, destsize - olen);
+		rc = deflate_stream_output(stream, dest + olen, req, &produced);
+		if (rc != EOK)
+			break;
+
+		olen += produced;
+		if (deflate_stream_finished(stream))
+			break;
+
+		if (produced < req) {
+			/* Input consumed, supply next chunk */
+			deflate_stream_input(stream, src + ipos,
+			    min(ichunk, srclen - ipos));
+			ipos += min(ichunk, srclen - ipos);
+			if (ipos == srclen)
+				deflate_stream_finish(stream);
+		} else if (olen == destsize) {
+			rc = ENOMEM;
+			break;
+		}
+	}
+
+	deflate_stream_destroy(stream);
+	*destlen = olen;
+	return rc;
+}
+
+/** Inflate data supplying input and taking output in chunks.
+ *
+ * @param src      Compressed data
+ * @param srclen   Size of compressed data
+ * @param ichunk   Input chunk size
+ * @param ochunk   Output chunk size
+ * @param dest     Destination buffer
+ * @param destsize Size of destination buffer
+ * @param destlen  Place to store size of decompressed data
+ * @return EOK on success, EIO if the stream is truncated, ENOMEM if
+ *         the destination buffer is too small or an inflate error
+ */
+static errno_t test_inflate_chunked(const uint8_t *src, size_t srclen,
+    size_t ichunk, size_t ochunk, uint8_t *dest, size_t destsize,
+    size_t *destlen)
+{
+	inflate_stream_t *stream;
+	size_t ipos;
+	size_t olen = 0;
+	size_t req;
+	size_t produced;
+	errno_t rc;
+
+	rc = inflate_stream_create(&stream);
+	if (rc != EOK)
+		return rc;
+
+	ipos = min(ichunk, srclen);
+	inflate_stream_input(stream, src, ipos);
+
+	while (true) {
+		req = min(ochunk, destsize - olen);
+		rc = inflate_stream_output(stream, dest + olen, req, &produced);
+		if (rc != EOK)
+			break;
+
+		olen += produced;
+		if (inflate_stream_finished(stream))
+			break;
+
+		if (produced < req) {
+			if (ipos == srclen) {
+				rc = EIO;
+				break;
+			}
+
+			/* Input consumed, supply next chunk */
+			inflate_stream_input(stream, src + ipos,
+			    min(ichunk, srclen - ipos));
+			ipos += min(ichunk, srclen - ipos);
+		} else if (olen == destsize) {
+			rc = ENOMEM;
+			break;
+		}
+	}
+
+	inflate_stream_destroy(stream);
+	*destlen = olen;
+	return rc;
+}
+
+/** Compress at a level and check the data inflate back unchanged */
+static void test_round_trip(unsigned level, size_t ichunk, size_t ochunk)
+{
+	uint8_t *data;
+	uint8_t *comp;
+	uint8_t *out;
+	size_t clen;
+	size_t olen;
+	errno_t rc;
+
+	data = malloc(test_data_size);
+	comp = malloc(test_comp_size);
+	out = malloc(test_data_size + 1);
+	PCUT_ASSERT_NOT_NULL(data);
+	PCUT_ASSERT_NOT_NULL(comp);
+	PCUT_ASSERT_NOT_NULL(out);
+
+	test_data_fill(data, test_data_size);
+
+	rc = test_deflate_chunked(level, data, test_data_size, ichunk, ochunk,
+	    comp, test_comp_size, &clen);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	if (level > 0)
+		PCUT_ASSERT_TRUE(clen < test_data_size);
+
+	/* One-shot decoder */
+	memset(out, 0, test_data_size);
+	rc = inflate(comp, clen, out, test_data_size);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(out, data, test_data_size));
+
+	/* Streaming decoder */
+	memset(out, 0, test_data_size);
+	rc = test_inflate_chunked(comp, clen, ochunk, ichunk, out,
+	    test_data_size + 1, &olen);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(test_data_size, olen);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(out, data, test_data_size));
+
+	free(out);
+	free(comp);
+	free(data);
+}
+
+/** Stored blocks only */
+PCUT_TEST(level_0)
+{
+	test_round_trip(0, 4096, 4096);
+}
+
+/** Fastest compression, small chunks */
+PCUT_TEST(level_1)
+{
+	test_round_trip(1, 333, 17);
+}
+
+/** Default compression, large chunks */
+PCUT_TEST(level_default)
+{
+	test_round_trip(DEFLATE_LEVEL_DEFAULT, 65536, 8192);
+}
+
+/** Best compression, whole input at once, byte-sized output chunks */
+PCUT_TEST(level_max)
+{
+	test_round_trip(DEFLATE_LEVEL_MAX, test_data_size, 1);
+}
+
+/** Empty input */
+PCUT_TEST(empty)
+{
+	uint8_t comp[64];
+	uint8_t out[1];
+	size_t clen;
+	size_t olen;
+	errno_t rc;
+
+	rc = test_deflate_chunked(DEFLATE_LEVEL_DEFAULT, NULL, 0, 1, 64,
+	    comp, sizeof(comp), &clen);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_TRUE(clen > 0);
+
+	rc = test_inflate_chunked(comp, clen, 1, 1, out, sizeof(out), &olen);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, olen);
+}
+
+/** Invalid level is rejected */
+PCUT_TEST(bad_level)
+{
+	deflate_stream_t *stream;
+	errno_t rc;
+
+	rc = deflate_stream_create(DEFLATE_LEVEL_MAX + 1, &stream);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+}
+
+PCUT_EXPORT(deflate);
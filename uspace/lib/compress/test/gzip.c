@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <macros.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "../deflate.h"
+#include "../gzip.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(gzip);
+
+enum {
+	/** Size of test data (more than the window) */
+	test_data_size = 100000,
+	/** Size of buffer for compressed data */
+	test_comp_size = 2 * test_data_size
+};
+
+/** Fill buffer with compressible pseudo-random data */
+static void test_data_fill(uint8_t *buf, size_t size)
+{
+	uint32_t state = 7;
+	size_t pos = 0;
+	size_t len;
+	size_t dist;
+
+	while (pos < size) {
+		state = state * 1103515245 + 12345;
+		if (pos > 0 && (state >> 16) % 3 == 0) {
+			state = state * 1103515245 + 12345;
+			dist = 1 + (state >> 8) % min(pos, 40000);
+			len = 3 + (state >> 24) % 300;
+			for (size_t i = 0; i < len && pos < size; i++) {
+				buf[pos] = buf[pos - dist];
+				pos++;
+			}
+		} else {
+			state = state * 1103515245 + 12345;
+			buf[pos++] = state >> 16;
+		}
+	}
+}
+
+/** Compress data supplying input and taking output in chunks.
+ *
+ * @param src      Data to compress
+ * @param srclen   Size of data
+ * @param ichunk   Input chunk size
+ * @param ochunk   Output chunk size
+ * @param dest     Destination buffer
+ * @param destsize Size of destination buffer
+ * @param destlen  Place to store size of compressed data
+ * @return EOK on success, ENOMEM if the destination buffer is too small
+ */
+static errno_t test_compress_chunked(const uint8_t *src, size_t srclen,
+    size_t ichunk, size_t ochunk, uint8_t *dest, size_t destsize,
+    size_t *destlen)
+{
+	gzip_compress_t *gz;
+	size_t ipos;
+	size_t olen = 0;
+	size_t req;
+	size_t produced;
+	errno_t rc;
+
+	rc = gzip_compress_create(DEFLATE_LEVEL_DEFAULT, &gz);
+	if (rc != EOK)
+		return rc;
+
+	ipos = min(ichunk, srclen);
+	gzip_compress_input(gz, src, ipos);
+	if (ipos == srclen)
+		gzip_compress_finish(gz);
+
+	while (true) {
+		req = min(ochunk, destsize - olen);
+		rc = gzip_compress_output(gz, dest + olen, req, &produced);
+		if (rc != EOK)
+			break;
+
+		olen += produced;
+		if (gzip_compress_finished(gz))
+			break;
+
+		if (produced < req) {
+			/* Input consumed, supply next chunk */
+			gzip_compress_input(gz, src + ipos,
+			    min(ichunk, srclen - ipos));
+			ipos += min(ichunk, srclen - ipos);
+			if (ipos == srclen)
+				gzip_compress_finish(gz);
+		} else if (olen == destsize) {
+			rc = ENOMEM;
+			break;
+		}
+	}
+
+	gzip_compress_destroy(gz);
+	*destlen = olen;
+	return rc;
+}
+
+/** Expand data supplying input and taking output in chunks.
+ *
+ * @param src      Compressed data
+ * @param srclen   Size of compressed data
+ * @param ichunk   Input chunk size
+ * @param ochunk   Output chunk size
+ * @param dest     Destination buffer
+ * @param destsize Size of destination buffer
+ * @param destlen  Place to store size of decompressed data
+ * @return EOK on success, EIO if the stream is truncated, ENOMEM if
+ *         the destination buffer is too small or an expand error
+ */
+static errno_t test_expand_chunked(const uint8_t *src, size_t srclen,
+    size_t ichunk, size_t ochunk, uint8_t *dest, size_t destsize,
+    size_t *destlen)
+{
+	gzip_expand_t *gz;
+	size_t ipos;
+	size_t olen = 0;
+	size_t req;
+	size_t produced;
+	errno_t rc;
+
+	rc = gzip_expand_create(&gz);
+	if (rc != EOK)
+		return rc;
+
+	ipos = min(ichunk, srclen);
+	gzip_expand_input(gz, src, ipos);
+
+	while (true) {
+		req = min(ochunk, destsize - olen);
+		rc = gzip_expand_output(gz, dest + olen, req, &produced);
+		if (rc != EOK)
+			break;
+
+		olen += produced;
+		if (gzip_expand_finished(gz))
+			break;
+
+		if (produced < req) {
+			if (ipos == srclen) {
+				rc = EIO;
+				break;
+			}
+
+			/* Input consumed, supply next chunk */
+			gzip_expand_input(gz, src + ipos,
+			    min(ichunk, srclen - ipos));
+			ipos += min(ichunk, srclen - ipos);
+		} else if (olen == destsize) {
+			rc = ENOMEM;
+			break;
+		}
+	}
+
+	gzip_expand_destroy(gz);
+	*destlen = olen;
+	return rc;
+}
+
+/** Streaming compression and both decoders agree */
+PCUT_TEST(round_trip)
+{
+	static const size_t chunks[] = { 1, 10, 4096, test_comp_size };
+	uint8_t *data;
+	uint8_t *comp;
+	uint8_t *out;
+	void *exp;
+	size_t clen;
+	size_t olen;
+	size_t elen;
+	errno_t rc;
+
+	data = malloc(test_data_size);
+	comp = malloc(test_comp_size);
+	out = malloc(test_data_size + 1);
+	PCUT_ASSERT_NOT_NULL(data);
+	PCUT_ASSERT_NOT_NULL(comp);
+	PCUT_ASSERT_NOT_NULL(out);
+
+	test_data_fill(data, test_data_size);
+
+	rc = test_compress_chunked(data, test_data_size, 1000, 100, comp,
+	    test_comp_size, &clen);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_TRUE(clen < test_data_size);
+
+	/* One-shot decoder */
+	rc = gzip_expand(comp, clen, &exp, &elen);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(test_data_size, elen);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(exp, data, test_data_size));
+	free(exp);
+
+	/* Streaming decoder */
+	for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+		memset(out, 0, test_data_size);
+		rc = test_expand_chunked(comp, clen, chunks[i],
+		    chunks[sizeof(chunks) / sizeof(chunks[0]) - 1 - i], out,
+		    test_data_size + 1, &olen);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		PCUT_ASSERT_INT_EQUALS(test_data_size, olen);
+		PCUT_ASSERT_INT_EQUALS(0, memcmp(out, data, test_data_size));
+	}
+
+	free(out);
+	free(comp);
+	free(data);
+}
+
+/** Corrupted data are detected by the CRC-32 check */
+PCUT_TEST(crc_mismatch)
+{
+	uint8_t data[256];
+	uint8_t comp[512];
+	uint8_t out[257];
+	size_t clen;
+	size_t olen;
+	errno_t rc;
+
+	for (size_t i = 0; i < sizeof(data); i++)
+		data[i] = i;
+
+	rc = test_compress_chunked(data, sizeof(data), sizeof(data),
+	    sizeof(comp), comp, sizeof(comp), &clen);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = test_expand_chunked(comp, clen, 16, 16, out, sizeof(out), &olen);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(sizeof(data), olen);
+
+	/* Flip a bit in the CRC-32 field of the trailer */
+	comp[clen - 8] ^= 0x01;
+	rc = test_expand_chunked(comp, clen, 16, 16, out, sizeof(out), &olen);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+}
+
+/** Truncated stream is reported */
+PCUT_TEST(truncated)
+{
+	uint8_t data[1000];
+	uint8_t comp[2000];
+	uint8_t out[1001];
+	size_t clen;
+	size_t olen;
+	errno_t rc;
+
+	test_data_fill(data, sizeof(data));
+
+	rc = test_compress_chunked(data, sizeof(data), 100, 100, comp,
+	    sizeof(comp), &clen);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = test_expand_chunked(comp, clen - 4, 100, 100, out, sizeof(out),
+	    &olen);
+	PCUT_ASSERT_ERRNO_VAL(EIO, rc);
+}
+
+PCUT_EXPORT(gzip);
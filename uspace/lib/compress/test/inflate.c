@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <macros.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "../inflate.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(inflate);
+
+enum {
+	/** Size of the inflate window */
+	test_window = 32768,
+	/** Size of the test stream */
+	test_stream_size = test_window + 64,
+	/** Size of data encoded in the test stream */
+	test_data_size = test_window + 258 + 3
+};
+
+/** Bit writer for hand-made deflate streams */
+typedef struct {
+	uint8_t *buf;
+	size_t pos;
+	unsigned bit;
+} test_bits_t;
+
+/** Write bits, least significant first (header fields, extra bits) */
+static void test_bits_put(test_bits_t *bits, uint32_t val, unsigned cnt)
+{
+	for (unsigned i = 0; i < cnt; i++) {
+		if (bits->bit == 0)
+			bits->buf[bits->pos] = 0;
+
+		bits->buf[bits->pos] |= ((val >> i) & 1) << bits->bit;
+		if (++bits->bit == 8) {
+			bits->bit = 0;
+			bits->pos++;
+		}
+	}
+}
+
+/** Write Huffman code, most significant bit first */
+static void test_bits_code(test_bits_t *bits, uint32_t code, unsigned cnt)
+{
+	for (unsigned i = cnt; i > 0; i--)
+		test_bits_put(bits, (code >> (i - 1)) & 1, 1);
+}
+
+/** Skip to the next byte boundary */
+static void test_bits_align(test_bits_t *bits)
+{
+	if (bits->bit != 0) {
+		bits->bit = 0;
+		bits->pos++;
+	}
+}
+
+/** Create deflate stream filling the whole window and reaching back.
+ *
+ * A stored block fills the window with @a data. A block with fixed
+ * Huffman codes then copies 258 bytes from distance 32768 (source and
+ * destination are the same window position) and 3 bytes from distance 1
+ * (overlapping copy).
+ *
+ * @param data  Data of the stored block (test_window bytes)
+ * @param buf   Buffer for the stream (test_stream_size bytes)
+ * @return      Size of the stream
+ */
+static size_t test_stream_make(const uint8_t *data, uint8_t *buf)
+{
+	test_bits_t bits = {
+		.buf = buf
+	};
+
+	/* Stored block, not final */
+	test_bits_put(&bits, 0, 1);
+	test_bits_put(&bits, 0, 2);
+	test_bits_align(&bits);
+	test_bits_put(&bits, test_window, 16);
+	test_bits_put(&bits, (uint16_t) ~test_window, 16);
+	for (size_t i = 0; i < test_window; i++)
+		test_bits_put(&bits, data[i], 8);
+
+	/* Fixed Huffman block, final */
+	test_bits_put(&bits, 1, 1);
+	test_bits_put(&bits, 1, 2);
+
+	/* Length 258 (code 285), distance 32768 (code 29, extra 8191) */
+	test_bits_code(&bits, 0xc0 + 285 - 280, 8);
+	test_bits_code(&bits, 29, 5);
+	test_bits_put(&bits, 32768 - 24577, 13);
+
+	/* Length 3 (code 257), distance 1 (code 0) */
+	test_bits_code(&bits, 257 - 256, 7);
+	test_bits_code(&bits, 0, 5);
+
+	/* End of block */
+	test_bits_code(&bits, 0, 7);
+	test_bits_align(&bits);
+
+	return bits.pos;
+}
+
+/** Inflate stream supplying input and taking output in chunks.
+ *
+ * @param src      Compressed data
+ * @param srclen   Size of compressed data
+ * @param ichunk   Input chunk size
+ * @param ochunk   Output chunk size
+ * @param dest     Destination buffer
+ * @param destsize Size of destination buffer
+ * @param destlen  Place to store size of decompressed data
+ * @return EOK on success, EIO if the stream is truncated, ENOMEM if
+ *         the destination buffer is too small or an inflate error
+ */
+static errno_t test_inflate_chunked(const uint8_t *src, size_t srclen,
+    size_t ichunk, size_t ochunk, uint8_t *dest, size_t destsize,
+    size_t *destlen)
+{
+	inflate_stream_t *stream;
+	size_t ipos;
+	size_t olen = 0;
+	size_t req;
+	size_t produced;
+	errno_t rc;
+
+	rc = inflate_stream_create(&stream);
+	if (rc != EOK)
+		return rc;
+
+	ipos = min(ichunk, srclen);
+	inflate_stream_input(stream, src, ipos);
+
+	while (true) {
+		req = min(ochunk, destsize - olen);
+		rc = inflate_stream_output(stream, dest + olen, req, &produced);
+		if (rc != EOK)
+			break;
+
+		olen += produced;
+		if (inflate_stream_finished(stream))
+			break;
+
+		if (produced < req) {
+			if (ipos == srclen) {
+				rc = EIO;
+				break;
+			}
+
+			/* Input consumed, supply next chunk */
+			inflate_stream_input(stream, src + ipos,
+			    min(ichunk, srclen - ipos));
+			ipos += min(ichunk, srclen - ipos);
+		} else if (olen == destsize) {
+			rc = ENOMEM;
+			break;
+		}
+	}
+
+	inflate_stream_destroy(stream);
+	*destlen = olen;
+	return rc;
+}
+
+/** Fill buffer with pseudo-random bytes */
+static void test_random_fill(uint8_t *buf, size_t size)
+{
+	uint32_t state = 1;
+
+	for (size_t i = 0; i < size; i++) {
+		state = state * 1103515245 + 12345;
+		buf[i] = state >> 16;
+	}
+}
+
+/** Back references reaching through the whole window */
+PCUT_TEST(window_distance)
+{
+	static const size_t chunks[] = { 1, 7, 258, 4096, 65536 };
+	size_t explen = test_data_size;
+	uint8_t *data;
+	uint8_t *stream;
+	uint8_t *out;
+	size_t len;
+	size_t outlen;
+	errno_t rc;
+
+	data = malloc(test_window);
+	stream = malloc(test_stream_size);
+	out = malloc(explen + 1);
+	PCUT_ASSERT_NOT_NULL(data);
+	PCUT_ASSERT_NOT_NULL(stream);
+	PCUT_ASSERT_NOT_NULL(out);
+
+	test_random_fill(data, test_window);
+	len = test_stream_make(data, stream);
+
+	/* One-shot decoder */
+	rc = inflate(stream, len, out, explen);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(out, data, test_window));
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(out + test_window, data, 258));
+	for (size_t i = 0; i < 3; i++)
+		PCUT_ASSERT_INT_EQUALS(data[257], out[test_window + 258 + i]);
+
+	/* Streaming decoder, the window wraps at different points */
+	for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+		for (size_t j = 0; j < sizeof(chunks) / sizeof(chunks[0]);
+		    j++) {
+			memset(out, 0, explen + 1);
+			rc = test_inflate_chunked(stream, len, chunks[i],
+			    chunks[j], out, explen + 1, &outlen);
+			PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+			PCUT_ASSERT_INT_EQUALS(explen, outlen);
+			PCUT_ASSERT_INT_EQUALS(0, memcmp(out, data,
+			    test_window));
+			PCUT_ASSERT_INT_EQUALS(0, memcmp(out + test_window,
+			    data, 258));
+			for (size_t k = 0; k < 3; k++) {
+				PCUT_ASSERT_INT_EQUALS(data[257],
+				    out[test_window + 258 + k]);
+			}
+		}
+	}
+
+	free(out);
+	free(stream);
+	free(data);
+}
+
+/** Truncated stream is reported */
+PCUT_TEST(truncated)
+{
+	uint8_t *data;
+	uint8_t *stream;
+	uint8_t *out;
+	size_t len;
+	size_t outlen;
+	errno_t rc;
+
+	data = malloc(test_window);
+	stream = malloc(test_stream_size);
+	out = malloc(test_data_size + 1);
+	PCUT_ASSERT_NOT_NULL(data);
+	PCUT_ASSERT_NOT_NULL(stream);
+	PCUT_ASSERT_NOT_NULL(out);
+
+	test_random_fill(data, test_window);
+	len = test_stream_make(data, stream);
+
+	rc = test_inflate_chunked(stream, len - 2, 100, 100, out,
+	    test_data_size + 1, &outlen);
+	PCUT_ASSERT_ERRNO_VAL(EIO, rc);
+	PCUT_ASSERT_TRUE(outlen < test_data_size);
+
+	free(out);
+	free(stream);
+	free(data);
+}
+
+PCUT_EXPORT(inflate);
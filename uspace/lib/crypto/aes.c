@@ -30,13 +30,21 @@
  *
  * Implementation of AES-128 symmetric cipher cryptographic algorithm.
  *
- * Based on FIPS 197.
+ * Based on FIPS 197. The key is expanded once into a context. Rounds are
+ * computed on 32-bit columns using a table which combines the S-box with
+ * the mix columns transformation, decryption uses the equivalent inverse
+ * cipher. On amd64 the AES instructions of the processor are used when
+ * available.
+ *
+ * The CTR and GCM modes follow NIST SP 800-38A and SP 800-38D. GHASH
+ * multiplication uses 4-bit tables derived from the hash subkey.
  */
 
 #include <stdbool.h>
 #include <errno.h>
 #include <mem.h>
 #include "crypto.h"
+#include "aes_ni.h"
 
 /* Number of elements in rows/columns in AES arrays. */
 #define ELEMS  4
@@ -50,6 +58,9 @@
 /* Number of iterations in AES algorithm. */
 #define ROUNDS  10
 
+/* Number of blocks processed at once in the CTR mode. */
+#define CTR_BLOCKS  8
+
 /** Irreducible polynomial used in AES algorithm.
  *
  * NOTE: x^8 + x^4 + x^3 + x + 1.
@@ -126,7 +137,7 @@ static const uint8_t sbox[BLOCK_LEN][BLOCK_LEN] = {
 };
 
 /** Precomputed values for AES inv_sub_byte transformation. */
-static uint8_t inv_sbox[BLOCK_LEN][BLOCK_LEN] = {
+static const uint8_t inv_sbox[BLOCK_LEN][BLOCK_LEN] = {
 	{
 		0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38,
 		0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb
@@ -200,6 +211,149 @@ static const uint32_t r_con_array[] = {
 	0x1b000000, 0x36000000
 };
 
+/** Round table of the cipher (S-box combined with mix columns). */
+static const uint32_t te[256] = {
+	0xc66363a5, 0xf87c7c84, 0xee777799, 0xf67b7b8d,
+	0xfff2f20d, 0xd66b6bbd, 0xde6f6fb1, 0x91c5c554,
+	0x60303050, 0x02010103, 0xce6767a9, 0x562b2b7d,
+	0xe7fefe19, 0xb5d7d762, 0x4dababe6, 0xec76769a,
+	0x8fcaca45, 0x1f82829d, 0x89c9c940, 0xfa7d7d87,
+	0xeffafa15, 0xb25959eb, 0x8e4747c9, 0xfbf0f00b,
+	0x41adadec, 0xb3d4d467, 0x5fa2a2fd, 0x45afafea,
+	0x239c9cbf, 0x53a4a4f7, 0xe4727296, 0x9bc0c05b,
+	0x75b7b7c2, 0xe1fdfd1c, 0x3d9393ae, 0x4c26266a,
+	0x6c36365a, 0x7e3f3f41, 0xf5f7f702, 0x83cccc4f,
+	0x6834345c, 0x51a5a5f4, 0xd1e5e534, 0xf9f1f108,
+	0xe2717193, 0xabd8d873, 0x62313153, 0x2a15153f,
+	0x0804040c, 0x95c7c752, 0x46232365, 0x9dc3c35e,
+	0x30181828, 0x379696a1, 0x0a05050f, 0x2f9a9ab5,
+	0x0e070709, 0x24121236, 0x1b80809b, 0xdfe2e23d,
+	0xcdebeb26, 0x4e272769, 0x7fb2b2cd, 0xea75759f,
+	0x1209091b, 0x1d83839e, 0x582c2c74, 0x341a1a2e,
+	0x361b1b2d, 0xdc6e6eb2, 0xb45a5aee, 0x5ba0a0fb,
+	0xa45252f6, 0x763b3b4d, 0xb7d6d661, 0x7db3b3ce,
+	0x5229297b, 0xdde3e33e, 0x5e2f2f71, 0x13848497,
+	0xa65353f5, 0xb9d1d168, 0x00000000, 0xc1eded2c,
+	0x40202060, 0xe3fcfc1f, 0x79b1b1c8, 0xb65b5bed,
+	0xd46a6abe, 0x8dcbcb46, 0x67bebed9, 0x7239394b,
+	0x944a4ade, 0x984c4cd4, 0xb05858e8, 0x85cfcf4a,
+	0xbbd0d06b, 0xc5efef2a, 0x4faaaae5, 0xedfbfb16,
+	0x864343c5, 0x9a4d4dd7, 0x66333355, 0x11858594,
+	0x8a4545cf, 0xe9f9f910, 0x04020206, 0xfe7f7f81,
+	0xa05050f0, 0x783c3c44, 0x259f9fba, 0x4ba8a8e3,
+	0xa25151f3, 0x5da3a3fe, 0x804040c0, 0x058f8f8a,
+	0x3f9292ad, 0x219d9dbc, 0x70383848, 0xf1f5f504,
+	0x63bcbcdf, 0x77b6b6c1, 0xafdada75, 0x42212163,
+	0x20101030, 0xe5ffff1a, 0xfdf3f30e, 0xbfd2d26d,
+	0x81cdcd4c, 0x180c0c14, 0x26131335, 0xc3ecec2f,
+	0xbe5f5fe1, 0x359797a2, 0x884444cc, 0x2e171739,
+	0x93c4c457, 0x55a7a7f2, 0xfc7e7e82, 0x7a3d3d47,
+	0xc86464ac, 0xba5d5de7, 0x3219192b, 0xe6737395,
+	0xc06060a0, 0x19818198, 0x9e4f4fd1, 0xa3dcdc7f,
+	0x44222266, 0x542a2a7e, 0x3b9090ab, 0x0b888883,
+	0x8c4646ca, 0xc7eeee29, 0x6bb8b8d3, 0x2814143c,
+	0xa7dede79, 0xbc5e5ee2, 0x160b0b1d, 0xaddbdb76,
+	0xdbe0e03b, 0x64323256, 0x743a3a4e, 0x140a0a1e,
+	0x924949db, 0x0c06060a, 0x4824246c, 0xb85c5ce4,
+	0x9fc2c25d, 0xbdd3d36e, 0x43acacef, 0xc46262a6,
+	0x399191a8, 0x319595a4, 0xd3e4e437, 0xf279798b,
+	0xd5e7e732, 0x8bc8c843, 0x6e373759, 0xda6d6db7,
+	0x018d8d8c, 0xb1d5d564, 0x9c4e4ed2, 0x49a9a9e0,
+	0xd86c6cb4, 0xac5656fa, 0xf3f4f407, 0xcfeaea25,
+	0xca6565af, 0xf47a7a8e, 0x47aeaee9, 0x10080818,
+	0x6fbabad5, 0xf0787888, 0x4a25256f, 0x5c2e2e72,
+	0x381c1c24, 0x57a6a6f1, 0x73b4b4c7, 0x97c6c651,
+	0xcbe8e823, 0xa1dddd7c, 0xe874749c, 0x3e1f1f21,
+	0x964b4bdd, 0x61bdbddc, 0x0d8b8b86, 0x0f8a8a85,
+	0xe0707090, 0x7c3e3e42, 0x71b5b5c4, 0xcc6666aa,
+	0x904848d8, 0x06030305, 0xf7f6f601, 0x1c0e0e12,
+	0xc26161a3, 0x6a35355f, 0xae5757f9, 0x69b9b9d0,
+	0x17868691, 0x99c1c158, 0x3a1d1d27, 0x279e9eb9,
+	0xd9e1e138, 0xebf8f813, 0x2b9898b3, 0x22111133,
+	0xd26969bb, 0xa9d9d970, 0x078e8e89, 0x339494a7,
+	0x2d9b9bb6, 0x3c1e1e22, 0x15878792, 0xc9e9e920,
+	0x87cece49, 0xaa5555ff, 0x50282878, 0xa5dfdf7a,
+	0x038c8c8f, 0x59a1a1f8, 0x09898980, 0x1a0d0d17,
+	0x65bfbfda, 0xd7e6e631, 0x844242c6, 0xd06868b8,
+	0x824141c3, 0x299999b0, 0x5a2d2d77, 0x1e0f0f11,
+	0x7bb0b0cb, 0xa85454fc, 0x6dbbbbd6, 0x2c16163a
+};
+
+/** Round table of the inverse cipher (inverse S-box combined with
+ * inverse mix columns). */
+static const uint32_t td[256] = {
+	0x51f4a750, 0x7e416553, 0x1a17a4c3, 0x3a275e96,
+	0x3bab6bcb, 0x1f9d45f1, 0xacfa58ab, 0x4be30393,
+	0x2030fa55, 0xad766df6, 0x88cc7691, 0xf5024c25,
+	0x4fe5d7fc, 0xc52acbd7, 0x26354480, 0xb562a38f,
+	0xdeb15a49, 0x25ba1b67, 0x45ea0e98, 0x5dfec0e1,
+	0xc32f7502, 0x814cf012, 0x8d4697a3, 0x6bd3f9c6,
+	0x038f5fe7, 0x15929c95, 0xbf6d7aeb, 0x955259da,
+	0xd4be832d, 0x587421d3, 0x49e06929, 0x8ec9c844,
+	0x75c2896a, 0xf48e7978, 0x99583e6b, 0x27b971dd,
+	0xbee14fb6, 0xf088ad17, 0xc920ac66, 0x7dce3ab4,
+	0x63df4a18, 0xe51a3182, 0x97513360, 0x62537f45,
+	0xb16477e0, 0xbb6bae84, 0xfe81a01c, 0xf9082b94,
+	0x70486858, 0x8f45fd19, 0x94de6c87, 0x527bf8b7,
+	0xab73d323, 0x724b02e2, 0xe31f8f57, 0x6655ab2a,
+	0xb2eb2807, 0x2fb5c203, 0x86c57b9a, 0xd33708a5,
+	0x302887f2, 0x23bfa5b2, 0x02036aba, 0xed16825c,
+	0x8acf1c2b, 0xa779b492, 0xf307f2f0, 0x4e69e2a1,
+	0x65daf4cd, 0x0605bed5, 0xd134621f, 0xc4a6fe8a,
+	0x342e539d, 0xa2f355a0, 0x058ae132, 0xa4f6eb75,
+	0x0b83ec39, 0x4060efaa, 0x5e719f06, 0xbd6e1051,
+	0x3e218af9, 0x96dd063d, 0xdd3e05ae, 0x4de6bd46,
+	0x91548db5, 0x71c45d05, 0x0406d46f, 0x605015ff,
+	0x1998fb24, 0xd6bde997, 0x894043cc, 0x67d99e77,
+	0xb0e842bd, 0x07898b88, 0xe7195b38, 0x79c8eedb,
+	0xa17c0a47, 0x7c420fe9, 0xf8841ec9, 0x00000000,
+	0x09808683, 0x322bed48, 0x1e1170ac, 0x6c5a724e,
+	0xfd0efffb, 0x0f853856, 0x3daed51e, 0x362d3927,
+	0x0a0fd964, 0x685ca621, 0x9b5b54d1, 0x24362e3a,
+	0x0c0a67b1, 0x9357e70f, 0xb4ee96d2, 0x1b9b919e,
+	0x80c0c54f, 0x61dc20a2, 0x5a774b69, 0x1c121a16,
+	0xe293ba0a, 0xc0a02ae5, 0x3c22e043, 0x121b171d,
+	0x0e090d0b, 0xf28bc7ad, 0x2db6a8b9, 0x141ea9c8,
+	0x57f11985, 0xaf75074c, 0xee99ddbb, 0xa37f60fd,
+	0xf701269f, 0x5c72f5bc, 0x44663bc5, 0x5bfb7e34,
+	0x8b432976, 0xcb23c6dc, 0xb6edfc68, 0xb8e4f163,
+	0xd731dcca, 0x42638510, 0x13972240, 0x84c61120,
+	0x854a247d, 0xd2bb3df8, 0xaef93211, 0xc729a16d,
+	0x1d9e2f4b, 0xdcb230f3, 0x0d8652ec, 0x77c1e3d0,
+	0x2bb3166c, 0xa970b999, 0x119448fa, 0x47e96422,
+	0xa8fc8cc4, 0xa0f03f1a, 0x567d2cd8, 0x223390ef,
+	0x87494ec7, 0xd938d1c1, 0x8ccaa2fe, 0x98d40b36,
+	0xa6f581cf, 0xa57ade28, 0xdab78e26, 0x3fadbfa4,
+	0x2c3a9de4, 0x5078920d, 0x6a5fcc9b, 0x547e4662,
+	0xf68d13c2, 0x90d8b8e8, 0x2e39f75e, 0x82c3aff5,
+	0x9f5d80be, 0x69d0937c, 0x6fd52da9, 0xcf2512b3,
+	0xc8ac993b, 0x10187da7, 0xe89c636e, 0xdb3bbb7b,
+	0xcd267809, 0x6e5918f4, 0xec9ab701, 0x834f9aa8,
+	0xe6956e65, 0xaaffe67e, 0x21bccf08, 0xef15e8e6,
+	0xbae79bd9, 0x4a6f36ce, 0xea9f09d4, 0x29b07cd6,
+	0x31a4b2af, 0x2a3f2331, 0xc6a59430, 0x35a266c0,
+	0x744ebc37, 0xfc82caa6, 0xe090d0b0, 0x33a7d815,
+	0xf104984a, 0x41ecdaf7, 0x7fcd500e, 0x1791f62f,
+	0x764dd68d, 0x43efb04d, 0xccaa4d54, 0xe49604df,
+	0x9ed1b5e3, 0x4c6a881b, 0xc12c1fb8, 0x4665517f,
+	0x9d5eea04, 0x018c355d, 0xfa877473, 0xfb0b412e,
+	0xb3671d5a, 0x92dbd252, 0xe9105633, 0x6dd64713,
+	0x9ad7618c, 0x37a10c7a, 0x59f8148e, 0xeb133c89,
+	0xcea927ee, 0xb761c935, 0xe11ce5ed, 0x7a47b13c,
+	0x9cd2df59, 0x55f2733f, 0x1814ce79, 0x73c737bf,
+	0x53f7cdea, 0x5ffdaa5b, 0xdf3d6f14, 0x7844db86,
+	0xcaaff381, 0xb968c43e, 0x3824342c, 0xc2a3405f,
+	0x161dc372, 0xbce2250c, 0x283c498b, 0xff0d9541,
+	0x39a80171, 0x080cb3de, 0xd8b4e49c, 0x6456c190,
+	0x7bcb8461, 0xd532b670, 0x486c5c74, 0xd0b85742
+};
+
+/** Remainders of the GHASH reduction of a 4-bit shift. */
+static const uint16_t ghash_last4[16] = {
+	0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+	0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
 /** Perform substitution transformation on given byte.
  *
  * @param byte Input byte.
@@ -219,235 +373,652 @@ static uint8_t sub_byte(uint8_t byte, bool inv)
 	return inv_sbox[i][j];
 }
 
-/** Perform substitution transformation on state table.
+/** Perform substitution transformation on given word.
+ *
+ * @param byte Input word.
+ *
+ * @return Substituted word.
+ *
+ */
+static uint32_t sub_word(uint32_t word)
+{
+	uint32_t temp = word;
+	uint8_t *start = (uint8_t *) &temp;
+
+	for (size_t i = 0; i < 4; i++)
+		*(start + i) = sub_byte(*(start + i), false);
+
+	return temp;
+}
+
+/** Perform left rotation by one byte on given word.
+ *
+ * @param byte Input word.
+ *
+ * @return Rotated word.
+ *
+ */
+static uint32_t rot_word(uint32_t word)
+{
+	return (word << 8 | word >> 24);
+}
+
+/** Key expansion procedure for AES algorithm.
  *
- * @param state State table to be modified.
- * @param inv   Flag indicating whether to use inverse table.
+ * @param key     Input key.
+ * @param key_exp Result key expansion.
  *
  */
-static void sub_bytes(uint8_t state[ELEMS][ELEMS], bool inv)
+static void key_expansion(const uint8_t *key, uint32_t *key_exp)
 {
-	uint8_t val;
+	uint32_t temp;
+
+	for (size_t i = 0; i < CIPHER_ELEMS; i++) {
+		key_exp[i] =
+		    (key[4 * i] << 24) +
+		    (key[4 * i + 1] << 16) +
+		    (key[4 * i + 2] << 8) +
+		    (key[4 * i + 3]);
+	}
+
+	for (size_t i = CIPHER_ELEMS; i < ELEMS * (ROUNDS + 1); i++) {
+		temp = key_exp[i - 1];
 
-	for (size_t i = 0; i < ELEMS; i++) {
-		for (size_t j = 0; j < ELEMS; j++) {
-			val = state[i][j];
-			state[i][j] = sub_byte(val, inv);
+		if ((i % CIPHER_ELEMS) == 0) {
+			temp = sub_word(rot_word(temp)) ^
+			    r_con_array[i / CIPHER_ELEMS - 1];
 		}
+
+		key_exp[i] = key_exp[i - CIPHER_ELEMS] ^ temp;
 	}
 }
 
-/** Perform shift rows transformation on state table.
+/** Load big-endian word.
  *
- * @param state State table to be modified.
+ */
+static inline uint32_t load_word(const uint8_t *data)
+{
+	return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) |
+	    ((uint32_t) data[2] << 8) | data[3];
+}
+
+/** Store big-endian word.
  *
  */
-static void shift_rows(uint8_t state[ELEMS][ELEMS])
+static inline void store_word(uint8_t *data, uint32_t word)
 {
-	uint8_t temp[ELEMS];
+	data[0] = word >> 24;
+	data[1] = (word >> 16) & 0xff;
+	data[2] = (word >> 8) & 0xff;
+	data[3] = word & 0xff;
+}
 
-	for (size_t i = 1; i < ELEMS; i++) {
-		memcpy(temp, state[i], i);
-		memmove(state[i], state[i] + i, ELEMS - i);
-		memcpy(state[i] + ELEMS - i, temp, i);
-	}
+/** Perform inverse mix columns transformation on round key word.
+ *
+ * The round table of the inverse cipher combines the inverse S-box with
+ * the inverse mix columns, so the S-box is applied first.
+ *
+ * @param word Round key word.
+ *
+ * @return Transformed word.
+ *
+ */
+static uint32_t inv_mix_word(uint32_t word)
+{
+	return td[sub_byte(word >> 24, false)] ^
+	    rotr_uint32(td[sub_byte((word >> 16) & 0xff, false)], 8) ^
+	    rotr_uint32(td[sub_byte((word >> 8) & 0xff, false)], 16) ^
+	    rotr_uint32(td[sub_byte(word & 0xff, false)], 24);
 }
 
-/** Perform inverted shift rows transformation on state table.
+/** Expand AES-128 key.
  *
- * @param state State table to be modified.
+ * @param ctx Context to initialize.
+ * @param key Key (AES_CIPHER_LENGTH bytes).
  *
  */
-static void inv_shift_rows(uint8_t state[ELEMS][ELEMS])
+void aes_init(aes_context_t *ctx, const uint8_t *key)
 {
-	uint8_t temp[ELEMS];
+	key_expansion(key, ctx->enc);
+
+	/* Round keys of the equivalent inverse cipher */
+	for (size_t k = 0; k <= ROUNDS; k++) {
+		for (size_t i = 0; i < ELEMS; i++) {
+			uint32_t word = ctx->enc[(ROUNDS - k) * ELEMS + i];
+
+			if ((k > 0) && (k < ROUNDS))
+				word = inv_mix_word(word);
+
+			ctx->dec[k * ELEMS + i] = word;
+		}
+	}
 
-	for (size_t i = 1; i < ELEMS; i++) {
-		memcpy(temp, state[i], ELEMS - i);
-		memmove(state[i], state[i] + ELEMS - i, i);
-		memcpy(state[i] + i, temp, ELEMS - i);
+	for (size_t i = 0; i < ELEMS * (ROUNDS + 1); i++) {
+		store_word(ctx->enc_bytes + 4 * i, ctx->enc[i]);
+		store_word(ctx->dec_bytes + 4 * i, ctx->dec[i]);
 	}
+
+	ctx->aesni = aes_ni_supported();
 }
 
-/** Multiplication in GF(2^8).
+/** Encrypt single block using round tables.
  *
- * @param x First factor.
- * @param y Second factor.
- *
- * @return Multiplication of given factors in GF(2^8).
+ * @param ctx    Expanded key.
+ * @param input  Input block.
+ * @param output Output block.
  *
  */
-static uint8_t galois_mult(uint8_t x, uint8_t y)
+static void aes_encrypt_table(const aes_context_t *ctx, const uint8_t *input,
+    uint8_t *output)
 {
-	uint8_t result = 0;
-	uint8_t f_bith;
+	const uint32_t *rk = ctx->enc;
 
-	for (size_t i = 0; i < 8; i++) {
-		if (y & 1)
-			result ^= x;
+	uint32_t s0 = load_word(input) ^ rk[0];
+	uint32_t s1 = load_word(input + 4) ^ rk[1];
+	uint32_t s2 = load_word(input + 8) ^ rk[2];
+	uint32_t s3 = load_word(input + 12) ^ rk[3];
 
-		f_bith = (x & 0x80);
-		x <<= 1;
+	for (size_t k = 1; k < ROUNDS; k++) {
+		rk += ELEMS;
 
-		if (f_bith)
-			x ^= AES_IP;
+		uint32_t t0 = te[s0 >> 24] ^
+		    rotr_uint32(te[(s1 >> 16) & 0xff], 8) ^
+		    rotr_uint32(te[(s2 >> 8) & 0xff], 16) ^
+		    rotr_uint32(te[s3 & 0xff], 24) ^ rk[0];
+		uint32_t t1 = te[s1 >> 24] ^
+		    rotr_uint32(te[(s2 >> 16) & 0xff], 8) ^
+		    rotr_uint32(te[(s3 >> 8) & 0xff], 16) ^
+		    rotr_uint32(te[s0 & 0xff], 24) ^ rk[1];
+		uint32_t t2 = te[s2 >> 24] ^
+		    rotr_uint32(te[(s3 >> 16) & 0xff], 8) ^
+		    rotr_uint32(te[(s0 >> 8) & 0xff], 16) ^
+		    rotr_uint32(te[s1 & 0xff], 24) ^ rk[2];
+		uint32_t t3 = te[s3 >> 24] ^
+		    rotr_uint32(te[(s0 >> 16) & 0xff], 8) ^
+		    rotr_uint32(te[(s1 >> 8) & 0xff], 16) ^
+		    rotr_uint32(te[s2 & 0xff], 24) ^ rk[3];
 
-		y >>= 1;
+		s0 = t0;
+		s1 = t1;
+		s2 = t2;
+		s3 = t3;
 	}
 
-	return result;
+	/* Last round has no mix columns */
+	rk += ELEMS;
+
+	store_word(output, ((uint32_t) sub_byte(s0 >> 24, false) << 24 |
+	    (uint32_t) sub_byte((s1 >> 16) & 0xff, false) << 16 |
+	    (uint32_t) sub_byte((s2 >> 8) & 0xff, false) << 8 |
+	    sub_byte(s3 & 0xff, false)) ^ rk[0]);
+	store_word(output + 4, ((uint32_t) sub_byte(s1 >> 24, false) << 24 |
+	    (uint32_t) sub_byte((s2 >> 16) & 0xff, false) << 16 |
+	    (uint32_t) sub_byte((s3 >> 8) & 0xff, false) << 8 |
+	    sub_byte(s0 & 0xff, false)) ^ rk[1]);
+	store_word(output + 8, ((uint32_t) sub_byte(s2 >> 24, false) << 24 |
+	    (uint32_t) sub_byte((s3 >> 16) & 0xff, false) << 16 |
+	    (uint32_t) sub_byte((s0 >> 8) & 0xff, false) << 8 |
+	    sub_byte(s1 & 0xff, false)) ^ rk[2]);
+	store_word(output + 12, ((uint32_t) sub_byte(s3 >> 24, false) << 24 |
+	    (uint32_t) sub_byte((s0 >> 16) & 0xff, false) << 16 |
+	    (uint32_t) sub_byte((s1 >> 8) & 0xff, false) << 8 |
+	    sub_byte(s2 & 0xff, false)) ^ rk[3]);
 }
 
-/** Perform mix columns transformation on state table.
+/** Decrypt single block using round tables.
  *
- * @param state State table to be modified.
+ * @param ctx    Expanded key.
+ * @param input  Input block.
+ * @param output Output block.
  *
  */
-static void mix_columns(uint8_t state[ELEMS][ELEMS])
+static void aes_decrypt_table(const aes_context_t *ctx, const uint8_t *input,
+    uint8_t *output)
 {
-	uint8_t orig_state[ELEMS][ELEMS];
-	memcpy(orig_state, state, BLOCK_LEN);
-
-	for (size_t j = 0; j < ELEMS; j++) {
-		state[0][j] =
-		    galois_mult(0x2, orig_state[0][j]) ^
-		    galois_mult(0x3, orig_state[1][j]) ^
-		    orig_state[2][j] ^
-		    orig_state[3][j];
-		state[1][j] =
-		    orig_state[0][j] ^
-		    galois_mult(0x2, orig_state[1][j]) ^
-		    galois_mult(0x3, orig_state[2][j]) ^
-		    orig_state[3][j];
-		state[2][j] =
-		    orig_state[0][j] ^
-		    orig_state[1][j] ^
-		    galois_mult(0x2, orig_state[2][j]) ^
-		    galois_mult(0x3, orig_state[3][j]);
-		state[3][j] =
-		    galois_mult(0x3, orig_state[0][j]) ^
-		    orig_state[1][j] ^
-		    orig_state[2][j] ^
-		    galois_mult(0x2, orig_state[3][j]);
+	const uint32_t *rk = ctx->dec;
+
+	uint32_t s0 = load_word(input) ^ rk[0];
+	uint32_t s1 = load_word(input + 4) ^ rk[1];
+	uint32_t s2 = load_word(input + 8) ^ rk[2];
+	uint32_t s3 = load_word(input + 12) ^ rk[3];
+
+	for (size_t k = 1; k < ROUNDS; k++) {
+		rk += ELEMS;
+
+		uint32_t t0 = td[s0 >> 24] ^
+		    rotr_uint32(td[(s3 >> 16) & 0xff], 8) ^
+		    rotr_uint32(td[(s2 >> 8) & 0xff], 16) ^
+		    rotr_uint32(td[s1 & 0xff], 24) ^ rk[0];
+		uint32_t t1 = td[s1 >> 24] ^
+		    rotr_uint32(td[(s0 >> 16) & 0xff], 8) ^
+		    rotr_uint32(td[(s3 >> 8) & 0xff], 16) ^
+		    rotr_uint32(td[s2 & 0xff], 24) ^ rk[1];
+		uint32_t t2 = td[s2 >> 24] ^
+		    rotr_uint32(td[(s1 >> 16) & 0xff], 8) ^
+		    rotr_uint32(td[(s0 >> 8) & 0xff], 16) ^
+		    rotr_uint32(td[s3 & 0xff], 24) ^ rk[2];
+		uint32_t t3 = td[s3 >> 24] ^
+		    rotr_uint32(td[(s2 >> 16) & 0xff], 8) ^
+		    rotr_uint32(td[(s1 >> 8) & 0xff], 16) ^
+		    rotr_uint32(td[s0 & 0xff], 24) ^ rk[3];
+
+		s0 = t0;
+		s1 = t1;
+		s2 = t2;
+		s3 = t3;
 	}
+
+	/* Last round has no inverse mix columns */
+	rk += ELEMS;
+
+	store_word(output, ((uint32_t) sub_byte(s0 >> 24, true) << 24 |
+	    (uint32_t) sub_byte((s3 >> 16) & 0xff, true) << 16 |
+	    (uint32_t) sub_byte((s2 >> 8) & 0xff, true) << 8 |
+	    sub_byte(s1 & 0xff, true)) ^ rk[0]);
+	store_word(output + 4, ((uint32_t) sub_byte(s1 >> 24, true) << 24 |
+	    (uint32_t) sub_byte((s0 >> 16) & 0xff, true) << 16 |
+	    (uint32_t) sub_byte((s3 >> 8) & 0xff, true) << 8 |
+	    sub_byte(s2 & 0xff, true)) ^ rk[1]);
+	store_word(output + 8, ((uint32_t) sub_byte(s2 >> 24, true) << 24 |
+	    (uint32_t) sub_byte((s1 >> 16) & 0xff, true) << 16 |
+	    (uint32_t) sub_byte((s0 >> 8) & 0xff, true) << 8 |
+	    sub_byte(s3 & 0xff, true)) ^ rk[2]);
+	store_word(output + 12, ((uint32_t) sub_byte(s3 >> 24, true) << 24 |
+	    (uint32_t) sub_byte((s2 >> 16) & 0xff, true) << 16 |
+	    (uint32_t) sub_byte((s1 >> 8) & 0xff, true) << 8 |
+	    sub_byte(s0 & 0xff, true)) ^ rk[3]);
 }
 
-/** Perform inverted mix columns transformation on state table.
+/** Encrypt blocks independently.
  *
- * @param state State table to be modified.
+ * @param ctx     Expanded key.
+ * @param input   Input blocks.
+ * @param output  Output blocks.
+ * @param nblocks Number of blocks.
  *
  */
-static void inv_mix_columns(uint8_t state[ELEMS][ELEMS])
+static void aes_encrypt_blocks(const aes_context_t *ctx, const uint8_t *input,
+    uint8_t *output, size_t nblocks)
 {
-	uint8_t orig_state[ELEMS][ELEMS];
-	memcpy(orig_state, state, BLOCK_LEN);
-
-	for (size_t j = 0; j < ELEMS; j++) {
-		state[0][j] =
-		    galois_mult(0x0e, orig_state[0][j]) ^
-		    galois_mult(0x0b, orig_state[1][j]) ^
-		    galois_mult(0x0d, orig_state[2][j]) ^
-		    galois_mult(0x09, orig_state[3][j]);
-		state[1][j] =
-		    galois_mult(0x09, orig_state[0][j]) ^
-		    galois_mult(0x0e, orig_state[1][j]) ^
-		    galois_mult(0x0b, orig_state[2][j]) ^
-		    galois_mult(0x0d, orig_state[3][j]);
-		state[2][j] =
-		    galois_mult(0x0d, orig_state[0][j]) ^
-		    galois_mult(0x09, orig_state[1][j]) ^
-		    galois_mult(0x0e, orig_state[2][j]) ^
-		    galois_mult(0x0b, orig_state[3][j]);
-		state[3][j] =
-		    galois_mult(0x0b, orig_state[0][j]) ^
-		    galois_mult(0x0d, orig_state[1][j]) ^
-		    galois_mult(0x09, orig_state[2][j]) ^
-		    galois_mult(0x0e, orig_state[3][j]);
+	if (ctx->aesni) {
+		aes_ni_encrypt(ctx->enc_bytes, input, output, nblocks);
+		return;
 	}
+
+	for (size_t i = 0; i < nblocks; i++)
+		aes_encrypt_table(ctx, input + i * BLOCK_LEN, output + i * BLOCK_LEN);
 }
 
-/** Perform round key transformation on state table.
+/** Encrypt single block with expanded key.
  *
- * @param state     State table to be modified.
- * @param round_key Round key to be applied on state table.
+ * @param ctx    Expanded key.
+ * @param input  Input block (AES_CIPHER_LENGTH bytes).
+ * @param output Output block (can be the same as input).
  *
  */
-static void add_round_key(uint8_t state[ELEMS][ELEMS], uint32_t *round_key)
+void aes_encrypt_block(const aes_context_t *ctx, const uint8_t *input,
+    uint8_t *output)
 {
-	uint8_t byte_round;
-	uint8_t shift;
-	uint32_t mask = 0xff;
+	aes_encrypt_blocks(ctx, input, output, 1);
+}
 
-	for (size_t j = 0; j < ELEMS; j++) {
-		for (size_t i = 0; i < ELEMS; i++) {
-			shift = 24 - 8 * i;
-			byte_round = (round_key[j] & (mask << shift)) >> shift;
-			state[i][j] = state[i][j] ^ byte_round;
-		}
+/** Decrypt single block with expanded key.
+ *
+ * @param ctx    Expanded key.
+ * @param input  Input block (AES_CIPHER_LENGTH bytes).
+ * @param output Output block (can be the same as input).
+ *
+ */
+void aes_decrypt_block(const aes_context_t *ctx, const uint8_t *input,
+    uint8_t *output)
+{
+	if (ctx->aesni) {
+		aes_ni_decrypt(ctx->dec_bytes, input, output, 1);
+		return;
 	}
+
+	aes_decrypt_table(ctx, input, output);
 }
 
-/** Perform substitution transformation on given word.
+/** Increment counter block.
  *
- * @param byte Input word.
+ * @param counter Counter block (big-endian).
+ * @param width   Number of trailing bytes forming the counter.
  *
- * @return Substituted word.
+ */
+static void ctr_increment(uint8_t *counter, size_t width)
+{
+	for (size_t i = BLOCK_LEN; i > BLOCK_LEN - width; i--) {
+		counter[i - 1]++;
+		if (counter[i - 1] != 0)
+			break;
+	}
+}
+
+/** XOR data with counter mode key stream.
+ *
+ * @param ctx     Expanded key.
+ * @param counter Counter block, incremented for each block used.
+ * @param width   Number of trailing counter bytes incremented.
+ * @param input   Input data.
+ * @param output  Output data (can be the same as input).
+ * @param len     Length of the data.
  *
  */
-static uint32_t sub_word(uint32_t word)
+static void ctr_xor(const aes_context_t *ctx, uint8_t *counter, size_t width,
+    const uint8_t *input, uint8_t *output, size_t len)
 {
-	uint32_t temp = word;
-	uint8_t *start = (uint8_t *) &temp;
+	uint8_t blocks[CTR_BLOCKS * BLOCK_LEN];
 
-	for (size_t i = 0; i < 4; i++)
-		*(start + i) = sub_byte(*(start + i), false);
+	while (len > 0) {
+		size_t nblocks = (len + BLOCK_LEN - 1) / BLOCK_LEN;
+		if (nblocks > CTR_BLOCKS)
+			nblocks = CTR_BLOCKS;
 
-	return temp;
+		for (size_t i = 0; i < nblocks; i++) {
+			memcpy(blocks + i * BLOCK_LEN, counter, BLOCK_LEN);
+			ctr_increment(counter, width);
+		}
+
+		aes_encrypt_blocks(ctx, blocks, blocks, nblocks);
+
+		size_t cnt = nblocks * BLOCK_LEN;
+		if (cnt > len)
+			cnt = len;
+
+		for (size_t i = 0; i < cnt; i++)
+			output[i] = input[i] ^ blocks[i];
+
+		input += cnt;
+		output += cnt;
+		len -= cnt;
+	}
 }
 
-/** Perform left rotation by one byte on given word.
+/** Encrypt or decrypt data in CTR mode.
  *
- * @param byte Input word.
+ * The whole counter block is incremented as a big-endian number after
+ * each block. When the data are processed in several calls, all but the
+ * last one must use a multiple of AES_CIPHER_LENGTH bytes.
  *
- * @return Rotated word.
+ * @param ctx     Expanded key.
+ * @param counter Initial counter block, updated to the next unused one.
+ * @param input   Input data.
+ * @param output  Output data (can be the same as input).
+ * @param len     Length of the data.
  *
  */
-static uint32_t rot_word(uint32_t word)
+void aes_ctr(const aes_context_t *ctx, uint8_t *counter, const uint8_t *input,
+    uint8_t *output, size_t len)
 {
-	return (word << 8 | word >> 24);
+	ctr_xor(ctx, counter, BLOCK_LEN, input, output, len);
 }
 
-/** Key expansion procedure for AES algorithm.
+/** Initialize AES-GCM context.
  *
- * @param key     Input key.
- * @param key_exp Result key expansion.
+ * Expand the key and precompute the multiples of the hash subkey.
+ *
+ * @param ctx Context to initialize.
+ * @param key Key (AES_CIPHER_LENGTH bytes).
  *
  */
-static void key_expansion(uint8_t *key, uint32_t *key_exp)
+void aes_gcm_init(aes_gcm_context_t *ctx, const uint8_t *key)
 {
-	uint32_t temp;
+	uint8_t h[BLOCK_LEN];
 
-	for (size_t i = 0; i < CIPHER_ELEMS; i++) {
-		key_exp[i] =
-		    (key[4 * i] << 24) +
-		    (key[4 * i + 1] << 16) +
-		    (key[4 * i + 2] << 8) +
-		    (key[4 * i + 3]);
+	aes_init(&ctx->aes, key);
+
+	memset(h, 0, BLOCK_LEN);
+	aes_encrypt_block(&ctx->aes, h, h);
+
+	uint64_t vh = ((uint64_t) load_word(h) << 32) | load_word(h + 4);
+	uint64_t vl = ((uint64_t) load_word(h + 8) << 32) | load_word(h + 12);
+
+	/* Entry 8 is H itself, entries 4, 2 and 1 are H times x, x^2, x^3 */
+	ctx->hh[0] = 0;
+	ctx->hl[0] = 0;
+	ctx->hh[8] = vh;
+	ctx->hl[8] = vl;
+
+	for (size_t i = 4; i > 0; i >>= 1) {
+		uint64_t reduce = (vl & 1) ? UINT64_C(0xe100000000000000) : 0;
+
+		vl = (vh << 63) | (vl >> 1);
+		vh = (vh >> 1) ^ reduce;
+
+		ctx->hh[i] = vh;
+		ctx->hl[i] = vl;
 	}
 
-	for (size_t i = CIPHER_ELEMS; i < ELEMS * (ROUNDS + 1); i++) {
-		temp = key_exp[i - 1];
+	/* Other entries are sums of these */
+	for (size_t i = 2; i <= 8; i <<= 1) {
+		for (size_t j = 1; j < i; j++) {
+			ctx->hh[i + j] = ctx->hh[i] ^ ctx->hh[j];
+			ctx->hl[i + j] = ctx->hl[i] ^ ctx->hl[j];
+		}
+	}
+}
 
-		if ((i % CIPHER_ELEMS) == 0) {
-			temp = sub_word(rot_word(temp)) ^
-			    r_con_array[i / CIPHER_ELEMS - 1];
+/** Multiply block by the hash subkey in GF(2^128).
+ *
+ * @param ctx AES-GCM context.
+ * @param x   Block to multiply, replaced by the product.
+ *
+ */
+static void ghash_mult(const aes_gcm_context_t *ctx, uint8_t *x)
+{
+	uint64_t zh = 0;
+	uint64_t zl = 0;
+
+	for (int i = BLOCK_LEN - 1; i >= 0; i--) {
+		uint8_t nibble[2] = { x[i] & 0xf, x[i] >> 4 };
+
+		for (size_t j = 0; j < 2; j++) {
+			if ((i != BLOCK_LEN - 1) || (j != 0)) {
+				uint8_t rem = zl & 0xf;
+
+				zl = (zh << 60) | (zl >> 4);
+				zh = (zh >> 4) ^ ((uint64_t) ghash_last4[rem] << 48);
+			}
+
+			zh ^= ctx->hh[nibble[j]];
+			zl ^= ctx->hl[nibble[j]];
 		}
+	}
 
-		key_exp[i] = key_exp[i - CIPHER_ELEMS] ^ temp;
+	store_word(x, zh >> 32);
+	store_word(x + 4, zh & 0xffffffff);
+	store_word(x + 8, zl >> 32);
+	store_word(x + 12, zl & 0xffffffff);
+}
+
+/** Absorb data into GHASH.
+ *
+ * The data are padded with zeros to a multiple of the block size.
+ *
+ * @param ctx  AES-GCM context.
+ * @param hash Hash value.
+ * @param data Data.
+ * @param len  Length of the data.
+ *
+ */
+static void ghash_update(const aes_gcm_context_t *ctx, uint8_t *hash,
+    const uint8_t *data, size_t len)
+{
+	while (len > 0) {
+		size_t cnt = (len < BLOCK_LEN) ? len : BLOCK_LEN;
+
+		for (size_t i = 0; i < cnt; i++)
+			hash[i] ^= data[i];
+
+		ghash_mult(ctx, hash);
+		data += cnt;
+		len -= cnt;
+	}
+}
+
+/** Absorb the lengths block into GHASH.
+ *
+ * @param ctx     AES-GCM context.
+ * @param hash    Hash value.
+ * @param len_a   Length of the first string (bytes).
+ * @param len_b   Length of the second string (bytes).
+ *
+ */
+static void ghash_lengths(const aes_gcm_context_t *ctx, uint8_t *hash,
+    uint64_t len_a, uint64_t len_b)
+{
+	uint8_t block[BLOCK_LEN];
+
+	store_word(block, (len_a * 8) >> 32);
+	store_word(block + 4, (len_a * 8) & 0xffffffff);
+	store_word(block + 8, (len_b * 8) >> 32);
+	store_word(block + 12, (len_b * 8) & 0xffffffff);
+
+	ghash_update(ctx, hash, block, BLOCK_LEN);
+}
+
+/** Derive the pre-counter block from the initialization vector.
+ *
+ * @param ctx    AES-GCM context.
+ * @param iv     Initialization vector.
+ * @param ivlen  Length of the initialization vector (non-zero).
+ * @param j0     Pre-counter block.
+ *
+ */
+static void gcm_start(const aes_gcm_context_t *ctx, const uint8_t *iv,
+    size_t ivlen, uint8_t *j0)
+{
+	memset(j0, 0, BLOCK_LEN);
+
+	if (ivlen == AES_GCM_IV_LENGTH) {
+		memcpy(j0, iv, AES_GCM_IV_LENGTH);
+		j0[BLOCK_LEN - 1] = 1;
+	} else {
+		ghash_update(ctx, j0, iv, ivlen);
+		ghash_lengths(ctx, j0, 0, ivlen);
 	}
 }
 
+/** Compute the authentication tag.
+ *
+ * @param ctx    AES-GCM context.
+ * @param j0     Pre-counter block.
+ * @param aad    Additional authenticated data.
+ * @param aadlen Length of the additional authenticated data.
+ * @param data   Cipher text.
+ * @param len    Length of the cipher text.
+ * @param tag    Authentication tag (AES_GCM_TAG_LENGTH bytes).
+ *
+ */
+static void gcm_tag(const aes_gcm_context_t *ctx, const uint8_t *j0,
+    const uint8_t *aad, size_t aadlen, const uint8_t *data, size_t len,
+    uint8_t *tag)
+{
+	uint8_t hash[BLOCK_LEN];
+	uint8_t mask[BLOCK_LEN];
+
+	memset(hash, 0, BLOCK_LEN);
+	ghash_update(ctx, hash, aad, aadlen);
+	ghash_update(ctx, hash, data, len);
+	ghash_lengths(ctx, hash, aadlen, len);
+
+	aes_encrypt_block(&ctx->aes, j0, mask);
+
+	for (size_t i = 0; i < AES_GCM_TAG_LENGTH; i++)
+		tag[i] = hash[i] ^ mask[i];
+}
+
+/** Encrypt and authenticate data in GCM mode.
+ *
+ * @param ctx    AES-GCM context.
+ * @param iv     Initialization vector (AES_GCM_IV_LENGTH bytes
+ *               recommended).
+ * @param ivlen  Length of the initialization vector.
+ * @param aad    Additional authenticated data.
+ * @param aadlen Length of the additional authenticated data.
+ * @param input  Plain text.
+ * @param output Cipher text (can be the same as input).
+ * @param len    Length of the data.
+ * @param tag    Authentication tag (AES_GCM_TAG_LENGTH bytes).
+ *
+ * @return EINVAL when the initialization vector is empty,
+ *         otherwise EOK.
+ *
+ */
+errno_t aes_gcm_encrypt(const aes_gcm_context_t *ctx, const uint8_t *iv,
+    size_t ivlen, const uint8_t *aad, size_t aadlen, const uint8_t *input,
+    uint8_t *output, size_t len, uint8_t *tag)
+{
+	uint8_t j0[BLOCK_LEN];
+	uint8_t counter[BLOCK_LEN];
+
+	if (ivlen == 0)
+		return EINVAL;
+
+	gcm_start(ctx, iv, ivlen, j0);
+
+	memcpy(counter, j0, BLOCK_LEN);
+	ctr_increment(counter, 4);
+	ctr_xor(&ctx->aes, counter, 4, input, output, len);
+
+	gcm_tag(ctx, j0, aad, aadlen, output, len, tag);
+	return EOK;
+}
+
+/** Verify and decrypt data in GCM mode.
+ *
+ * The tag is verified before decrypting, so no output is produced for
+ * data which fail the authentication.
+ *
+ * @param ctx    AES-GCM context.
+ * @param iv     Initialization vector.
+ * @param ivlen  Length of the initialization vector.
+ * @param aad    Additional authenticated data.
+ * @param aadlen Length of the additional authenticated data.
+ * @param input  Cipher text.
+ * @param output Plain text (can be the same as input).
+ * @param len    Length of the data.
+ * @param tag    Expected authentication tag (AES_GCM_TAG_LENGTH bytes).
+ *
+ * @return EINVAL when the initialization vector is empty,
+ *         EACCES when the authentication fails,
+ *         otherwise EOK.
+ *
+ */
+errno_t aes_gcm_decrypt(const aes_gcm_context_t *ctx, const uint8_t *iv,
+    size_t ivlen, const uint8_t *aad, size_t aadlen, const uint8_t *input,
+    uint8_t *output, size_t len, const uint8_t *tag)
+{
+	uint8_t j0[BLOCK_LEN];
+	uint8_t counter[BLOCK_LEN];
+	uint8_t computed[AES_GCM_TAG_LENGTH];
+
+	if (ivlen == 0)
+		return EINVAL;
+
+	gcm_start(ctx, iv, ivlen, j0);
+	gcm_tag(ctx, j0, aad, aadlen, input, len, computed);
+
+	/* Compare in constant time */
+	uint8_t diff = 0;
+	for (size_t i = 0; i < AES_GCM_TAG_LENGTH; i++)
+		diff |= computed[i] ^ tag[i];
+
+	if (diff != 0)
+		return EACCES;
+
+	memcpy(counter, j0, BLOCK_LEN);
+	ctr_increment(counter, 4);
+	ctr_xor(&ctx->aes, counter, 4, input, output, len);
+
+	return EOK;
+}
+
 /** AES-128 encryption algorithm.
+ *
+ * Expands the key for a single block. Use aes_init() and
+ * aes_encrypt_block() to encrypt more blocks with the same key.
  *
  * @param key    Input key.
  * @param input  Input data sequence to be encrypted.
@@ -466,40 +1037,17 @@ errno_t aes_encrypt(uint8_t *key, uint8_t *input, uint8_t *output)
 	if (!output)
 		return ENOMEM;
 
-	/* Create key expansion. */
-	uint32_t key_exp[ELEMS * (ROUNDS + 1)];
-	key_expansion(key, key_exp);
-
-	/* Copy input into state array. */
-	uint8_t state[ELEMS][ELEMS];
-	for (size_t i = 0; i < ELEMS; i++) {
-		for (size_t j = 0; j < ELEMS; j++)
-			state[i][j] = input[i + ELEMS * j];
-	}
-
-	/* Processing loop. */
-	add_round_key(state, key_exp);
-
-	for (size_t k = 1; k <= ROUNDS; k++) {
-		sub_bytes(state, false);
-		shift_rows(state);
-
-		if (k < ROUNDS)
-			mix_columns(state);
-
-		add_round_key(state, key_exp + k * ELEMS);
-	}
-
-	/* Copy state array into output. */
-	for (size_t i = 0; i < ELEMS; i++) {
-		for (size_t j = 0; j < ELEMS; j++)
-			output[i + j * ELEMS] = state[i][j];
-	}
+	aes_context_t ctx;
+	aes_init(&ctx, key);
+	aes_encrypt_block(&ctx, input, output);
 
 	return EOK;
 }
 
 /** AES-128 decryption algorithm.
+ *
+ * Expands the key for a single block. Use aes_init() and
+ * aes_decrypt_block() to decrypt more blocks with the same key.
  *
  * @param key    Input key.
  * @param input  Input data sequence to be decrypted.
@@ -518,34 +1066,9 @@ errno_t aes_decrypt(uint8_t *key, uint8_t *input, uint8_t *output)
 	if (!output)
 		return ENOMEM;
 
-	/* Create key expansion. */
-	uint32_t key_exp[ELEMS * (ROUNDS + 1)];
-	key_expansion(key, key_exp);
-
-	/* Copy input into state array. */
-	uint8_t state[ELEMS][ELEMS];
-	for (size_t i = 0; i < ELEMS; i++) {
-		for (size_t j = 0; j < ELEMS; j++)
-			state[i][j] = input[i + ELEMS * j];
-	}
-
-	/* Processing loop. */
-	add_round_key(state, key_exp + ROUNDS * ELEMS);
-
-	for (int k = ROUNDS - 1; k >= 0; k--) {
-		inv_shift_rows(state);
-		sub_bytes(state, true);
-		add_round_key(state, key_exp + k * ELEMS);
-
-		if (k > 0)
-			inv_mix_columns(state);
-	}
-
-	/* Copy state array into output. */
-	for (size_t i = 0; i < ELEMS; i++) {
-		for (size_t j = 0; j < ELEMS; j++)
-			output[i + j * ELEMS] = state[i][j];
-	}
+	aes_context_t ctx;
+	aes_init(&ctx, key);
+	aes_decrypt_block(&ctx, input, output);
 
 	return EOK;
 }
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @file aes_ni.h
+ *
+ * AES rounds using processor instructions.
+ */
+
+#ifndef LIBCRYPTO_AES_NI_H
+#define LIBCRYPTO_AES_NI_H
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef AES_NI
+
+extern bool aes_ni_supported(void);
+extern void aes_ni_encrypt(const uint8_t *, const uint8_t *, uint8_t *,
+    size_t);
+extern void aes_ni_decrypt(const uint8_t *, const uint8_t *, uint8_t *,
+    size_t);
+
+#else
+
+static inline bool aes_ni_supported(void)
+{
+	return false;
+}
+
+static inline void aes_ni_encrypt(const uint8_t *round_keys,
+    const uint8_t *input, uint8_t *output, size_t nblocks)
+{
+	assert(false);
+}
+
+static inline void aes_ni_decrypt(const uint8_t *round_keys,
+    const uint8_t *input, uint8_t *output, size_t nblocks)
+{
+	assert(false);
+}
+
+#endif
+
+#endif
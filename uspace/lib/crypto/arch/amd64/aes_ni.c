@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @file aes_ni.c
+ *
+ * AES-128 rounds using the AES instructions of amd64 processors.
+ *
+ * Four independent blocks are processed at once to hide the latency of
+ * the round instructions.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <mem.h>
+#include "../../aes_ni.h"
+
+/* Number of iterations in AES algorithm. */
+#define ROUNDS  10
+
+/* Length of AES block. */
+#define BLOCK_LEN  16
+
+/* Number of blocks processed in parallel. */
+#define LANES  4
+
+/** CPUID feature flag of the AES instructions (leaf 1, ECX). */
+#define CPUID_ECX_AES  (1 << 25)
+
+/** 128-bit SSE register. */
+typedef uint64_t xmm_t __attribute__((vector_size(BLOCK_LEN)));
+
+/** Check whether the processor implements the AES instructions.
+ *
+ * @return True if the AES instructions are available.
+ *
+ */
+bool aes_ni_supported(void)
+{
+	uint32_t eax = 1;
+	uint32_t ebx;
+	uint32_t ecx = 0;
+	uint32_t edx;
+
+	asm volatile (
+	    "cpuid\n"
+	    : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx)
+	);
+
+	return (ecx & CPUID_ECX_AES) != 0;
+}
+
+static inline xmm_t load_block(const uint8_t *data)
+{
+	xmm_t block;
+	memcpy(&block, data, BLOCK_LEN);
+	return block;
+}
+
+static inline void store_block(uint8_t *data, xmm_t block)
+{
+	memcpy(data, &block, BLOCK_LEN);
+}
+
+static inline xmm_t aesenc(xmm_t state, xmm_t key)
+{
+	asm ("aesenc %[key], %[state]\n"
+	    : [state] "+x" (state)
+	    : [key] "x" (key)
+	);
+
+	return state;
+}
+
+static inline xmm_t aesenclast(xmm_t state, xmm_t key)
+{
+	asm ("aesenclast %[key], %[state]\n"
+	    : [state] "+x" (state)
+	    : [key] "x" (key)
+	);
+
+	return state;
+}
+
+static inline xmm_t aesdec(xmm_t state, xmm_t key)
+{
+	asm ("aesdec %[key], %[state]\n"
+	    : [state] "+x" (state)
+	    : [key] "x" (key)
+	);
+
+	return state;
+}
+
+static inline xmm_t aesdeclast(xmm_t state, xmm_t key)
+{
+	asm ("aesdeclast %[key], %[state]\n"
+	    : [state] "+x" (state)
+	    : [key] "x" (key)
+	);
+
+	return state;
+}
+
+/** Encrypt blocks independently.
+ *
+ * @param round_keys Round keys of the cipher as byte strings.
+ * @param input      Input blocks.
+ * @param output     Output blocks (can be the same as input).
+ * @param nblocks    Number of blocks.
+ *
+ */
+void aes_ni_encrypt(const uint8_t *round_keys, const uint8_t *input,
+    uint8_t *output, size_t nblocks)
+{
+	xmm_t rk[ROUNDS + 1];
+
+	for (size_t k = 0; k <= ROUNDS; k++)
+		rk[k] = load_block(round_keys + k * BLOCK_LEN);
+
+	while (nblocks >= LANES) {
+		xmm_t s[LANES];
+
+		for (size_t i = 0; i < LANES; i++)
+			s[i] = load_block(input + i * BLOCK_LEN) ^ rk[0];
+
+		for (size_t k = 1; k < ROUNDS; k++) {
+			for (size_t i = 0; i < LANES; i++)
+				s[i] = aesenc(s[i], rk[k]);
+		}
+
+		for (size_t i = 0; i < LANES; i++)
+			store_block(output + i * BLOCK_LEN, aesenclast(s[i], rk[ROUNDS]));
+
+		input += LANES * BLOCK_LEN;
+		output += LANES * BLOCK_LEN;
+		nblocks -= LANES;
+	}
+
+	while (nblocks > 0) {
+		xmm_t s = load_block(input) ^ rk[0];
+
+		for (size_t k = 1; k < ROUNDS; k++)
+			s = aesenc(s, rk[k]);
+
+		store_block(output, aesenclast(s, rk[ROUNDS]));
+
+		input += BLOCK_LEN;
+		output += BLOCK_LEN;
+		nblocks--;
+	}
+}
+
+/** Decrypt blocks independently.
+ *
+ * @param round_keys Round keys of the equivalent inverse cipher as byte
+ *                   strings.
+ * @param input      Input blocks.
+ * @param output     Output blocks (can be the same as input).
+ * @param nblocks    Number of blocks.
+ *
+ */
+void aes_ni_decrypt(const uint8_t *round_keys, const uint8_t *input,
+    uint8_t *output, size_t nblocks)
+{
+	xmm_t rk[ROUNDS + 1];
+
+	for (size_t k = 0; k <= ROUNDS; k++)
+		rk[k] = load_block(round_keys + k * BLOCK_LEN);
+
+	while (nblocks > 0) {
+		xmm_t s = load_block(input) ^ rk[0];
+
+		for (size_t k = 1; k < ROUNDS; k++)
+			s = aesdec(s, rk[k]);
+
+		store_block(output, aesdeclast(s, rk[ROUNDS]));
+
+		input += BLOCK_LEN;
+		output += BLOCK_LEN;
+		nblocks--;
+	}
+}
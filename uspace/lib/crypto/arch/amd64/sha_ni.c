@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @file sha_ni.c
+ *
+ * SHA-256 rounds using the SHA extensions of amd64 processors.
+ *
+ * The instructions keep the working variables in two registers
+ * laid out as ABEF and CDGH, each instruction performs two rounds
+ * and the message schedule is computed four words at a time.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <byteorder.h>
+#include <mem.h>
+#include "../../sha_ni.h"
+
+/** Length of SHA-256 block. */
+#define BLOCK_LEN  64
+
+/** CPUID feature flag of the SHA extensions (leaf 7, EBX). */
+#define CPUID_EBX_SHA  (1 << 29)
+
+/** 128-bit SSE register holding four 32-bit words. */
+typedef uint32_t xmm_t __attribute__((vector_size(16)));
+
+static void cpuid(uint32_t leaf, uint32_t *ebx, uint32_t *ecx)
+{
+	uint32_t eax = leaf;
+	uint32_t edx;
+
+	*ecx = 0;
+
+	asm volatile (
+	    "cpuid\n"
+	    : "+a" (eax), "=b" (*ebx), "+c" (*ecx), "=d" (edx)
+	);
+}
+
+/** Check whether the processor implements the SHA extensions.
+ *
+ * The result is cached since hash contexts are initialized often
+ * and executing CPUID is expensive under virtualization.
+ *
+ * @return True if the SHA extensions are available.
+ *
+ */
+bool sha_ni_supported(void)
+{
+	static int supported = -1;
+
+	if (supported < 0) {
+		uint32_t ebx;
+		uint32_t ecx;
+		uint32_t max_leaf;
+
+		asm volatile (
+		    "cpuid\n"
+		    : "=a" (max_leaf), "=b" (ebx), "=c" (ecx)
+		    : "a" (0)
+		    : "edx"
+		);
+
+		bool sha = false;
+
+		if (max_leaf >= 7) {
+			cpuid(7, &ebx, &ecx);
+			sha = (ebx & CPUID_EBX_SHA) != 0;
+		}
+
+		supported = sha ? 1 : 0;
+	}
+
+	return supported != 0;
+}
+
+static inline xmm_t load_block(const uint8_t *data)
+{
+	uint32_t w[4];
+
+	memcpy(w, data, sizeof(w));
+	return (xmm_t) {
+		uint32_t_be2host(w[0]), uint32_t_be2host(w[1]),
+		uint32_t_be2host(w[2]), uint32_t_be2host(w[3])
+	};
+}
+
+static inline xmm_t sha256rnds2(xmm_t cdgh, xmm_t abef, xmm_t wk)
+{
+	asm ("sha256rnds2 %[wk], %[abef], %[cdgh]\n"
+	    : [cdgh] "+x" (cdgh)
+	    : [abef] "x" (abef), [wk] "Yz" (wk)
+	);
+
+	return cdgh;
+}
+
+static inline xmm_t sha256msg1(xmm_t a, xmm_t b)
+{
+	asm ("sha256msg1 %[b], %[a]\n"
+	    : [a] "+x" (a)
+	    : [b] "x" (b)
+	);
+
+	return a;
+}
+
+static inline xmm_t sha256msg2(xmm_t a, xmm_t b)
+{
+	asm ("sha256msg2 %[b], %[a]\n"
+	    : [a] "+x" (a)
+	    : [b] "x" (b)
+	);
+
+	return a;
+}
+
+/** Process SHA-256 blocks.
+ *
+ * @param h       Interim hash value (eight words A to H).
+ * @param k       Round constants of SHA-256.
+ * @param data    Input blocks.
+ * @param nblocks Number of blocks.
+ *
+ */
+void sha_ni_sha256(uint32_t *h, const uint32_t *k, const uint8_t *data,
+    size_t nblocks)
+{
+	xmm_t abef = { h[5], h[4], h[1], h[0] };
+	xmm_t cdgh = { h[7], h[6], h[3], h[2] };
+
+	while (nblocks > 0) {
+		xmm_t abef_save = abef;
+		xmm_t cdgh_save = cdgh;
+		xmm_t msg[4];
+
+		for (size_t i = 0; i < 4; i++)
+			msg[i] = load_block(data + 16 * i);
+
+		/* Sixteen groups of four rounds. */
+		for (size_t i = 0; i < 16; i++) {
+			xmm_t cur = msg[i % 4];
+			xmm_t wk = cur + (xmm_t) {
+				k[4 * i], k[4 * i + 1], k[4 * i + 2], k[4 * i + 3]
+			};
+
+			cdgh = sha256rnds2(cdgh, abef, wk);
+
+			/* Finish the schedule of words 4 * (i + 1) and up. */
+			if ((i >= 3) && (i <= 14)) {
+				xmm_t prev = msg[(i + 3) % 4];
+				xmm_t next = msg[(i + 1) % 4] + (xmm_t) {
+					prev[1], prev[2], prev[3], cur[0]
+				};
+
+				msg[(i + 1) % 4] = sha256msg2(next, cur);
+			}
+
+			abef = sha256rnds2(abef, cdgh, (xmm_t) {
+				wk[2], wk[3], 0, 0
+			});
+
+			/* Start the schedule of words 4 * (i + 3) and up. */
+			if ((i >= 1) && (i <= 12))
+				msg[(i + 3) % 4] = sha256msg1(msg[(i + 3) % 4], cur);
+		}
+
+		abef += abef_save;
+		cdgh += cdgh_save;
+
+		data += BLOCK_LEN;
+		nblocks--;
+	}
+
+	h[0] = abef[3];
+	h[1] = abef[2];
+	h[2] = cdgh[3];
+	h[3] = cdgh[2];
+	h[4] = abef[1];
+	h[5] = abef[0];
+	h[6] = cdgh[1];
+	h[7] = cdgh[0];
+}
@@ -34,36 +34,36 @@
 #include <assert.h>
 #include <str.h>
 #include <macros.h>
+#include <mem.h>
 #include <errno.h>
 #include <byteorder.h>
 #include <limits.h>
 #include "crypto.h"
+#include "sha_ni.h"
 
-/** Hash function procedure definition. */
-typedef void (*hash_fnc_t)(uint32_t *, uint32_t *);
-
-/** Length of HMAC block. */
-#define HMAC_BLOCK_LENGTH  64
-
-/** Ceiling for uint32_t. */
-#define ceil_uint32(val) \
-	(((val) - (uint32_t) (val)) > 0 ? \
-	(uint32_t) ((val) + 1) : (uint32_t) (val))
-
-/** Floor for uint32_t. */
-#define floor_uint32(val) \
-	(((val) - (uint32_t) (val)) < 0 ? \
-	(uint32_t) ((val) - 1) : (uint32_t) (val))
-
-/** Pick value at specified index from array or zero if out of bounds. */
-#define get_at(input, size, i) \
-	((i) < (size) ? (input[i]) : 0)
+/* Right rotation for uint64_t. */
+#define rotr_uint64(val, shift) \
+	(((val) >> shift) | ((val) << (64 - shift)))
 
 /** Init values used in SHA1 and MD5 functions. */
-static const uint32_t hash_init[] = {
+static const uint32_t md5_sha1_init[] = {
 	0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
 };
 
+/** Init values used in SHA-256 function. */
+static const uint32_t sha256_init[] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+/** Init values used in SHA-512 function. */
+static const uint64_t sha512_init[] = {
+	0x6a09e667f3bcc908, 0xbb67ae8584caa73b,
+	0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+	0x510e527fade682d1, 0x9b05688c2b3e6c1f,
+	0x1f83d9abfb41bd6b, 0x5be0cd19137e2179
+};
+
 /** Shift amount array for MD5 algorithm. */
 static const uint32_t md5_shift[] = {
 	7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,
@@ -92,13 +92,122 @@ static const uint32_t md5_sbox[] = {
 	0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
 };
 
+/** Round constants for SHA-256 algorithm. */
+static const uint32_t sha256_k[] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/** Round constants for SHA-512 algorithm. */
+static const uint64_t sha512_k[] = {
+	0x428a2f98d728ae22, 0x7137449123ef65cd,
+	0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc,
+	0x3956c25bf348b538, 0x59f111f1b605d019,
+	0x923f82a4af194f9b, 0xab1c5ed5da6d8118,
+	0xd807aa98a3030242, 0x12835b0145706fbe,
+	0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2,
+	0x72be5d74f27b896f, 0x80deb1fe3b1696b1,
+	0x9bdc06a725c71235, 0xc19bf174cf692694,
+	0xe49b69c19ef14ad2, 0xefbe4786384f25e3,
+	0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
+	0x2de92c6f592b0275, 0x4a7484aa6ea6e483,
+	0x5cb0a9dcbd41fbd4, 0x76f988da831153b5,
+	0x983e5152ee66dfab, 0xa831c66d2db43210,
+	0xb00327c898fb213f, 0xbf597fc7beef0ee4,
+	0xc6e00bf33da88fc2, 0xd5a79147930aa725,
+	0x06ca6351e003826f, 0x142929670a0e6e70,
+	0x27b70a8546d22ffc, 0x2e1b21385c26c926,
+	0x4d2c6dfc5ac42aed, 0x53380d139d95b3df,
+	0x650a73548baf63de, 0x766a0abb3c77b2a8,
+	0x81c2c92e47edaee6, 0x92722c851482353b,
+	0xa2bfe8a14cf10364, 0xa81a664bbc423001,
+	0xc24b8b70d0f89791, 0xc76c51a30654be30,
+	0xd192e819d6ef5218, 0xd69906245565a910,
+	0xf40e35855771202a, 0x106aa07032bbd1b8,
+	0x19a4c116b8d2d0c8, 0x1e376c085141ab53,
+	0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8,
+	0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb,
+	0x5b9cca4f7763e373, 0x682e6ff3d6b2b8a3,
+	0x748f82ee5defb2fc, 0x78a5636f43172f60,
+	0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+	0x90befffa23631e28, 0xa4506cebde82bde9,
+	0xbef9a3f7b2c67915, 0xc67178f2e372532b,
+	0xca273eceea26619c, 0xd186b8c721c0c207,
+	0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178,
+	0x06f067aa72176fba, 0x0a637dc5a2c898a6,
+	0x113f9804bef90dae, 0x1b710b35131c471b,
+	0x28db77f523047d84, 0x32caab7b40c72493,
+	0x3c9ebe0a15c9bebc, 0x431d67c49c100d4c,
+	0x4cc5d4becb3e42b6, 0x597f299cfc657e2a,
+	0x5fcb6fab3ad6faec, 0x6c44198c4a475817
+};
+
+static inline uint32_t load_uint32_le(const uint8_t *data)
+{
+	uint32_t val;
+	memcpy(&val, data, sizeof(val));
+	return uint32_t_le2host(val);
+}
+
+static inline uint32_t load_uint32_be(const uint8_t *data)
+{
+	uint32_t val;
+	memcpy(&val, data, sizeof(val));
+	return uint32_t_be2host(val);
+}
+
+static inline uint64_t load_uint64_be(const uint8_t *data)
+{
+	uint64_t val;
+	memcpy(&val, data, sizeof(val));
+	return uint64_t_be2host(val);
+}
+
+static inline void store_uint32_le(uint8_t *data, uint32_t val)
+{
+	val = host2uint32_t_le(val);
+	memcpy(data, &val, sizeof(val));
+}
+
+static inline void store_uint32_be(uint8_t *data, uint32_t val)
+{
+	val = host2uint32_t_be(val);
+	memcpy(data, &val, sizeof(val));
+}
+
+static inline void store_uint64_le(uint8_t *data, uint64_t val)
+{
+	val = host2uint64_t_le(val);
+	memcpy(data, &val, sizeof(val));
+}
+
+static inline void store_uint64_be(uint8_t *data, uint64_t val)
+{
+	val = host2uint64_t_be(val);
+	memcpy(data, &val, sizeof(val));
+}
+
 /** Working procedure of MD5 cryptographic hash function.
  *
  * @param h         Working array with interim hash parts values.
  * @param sched_arr Input array with scheduled values from input string.
  *
  */
-static void md5_proc(uint32_t *h, uint32_t *sched_arr)
+static void md5_proc(uint32_t *h, const uint32_t *sched_arr)
 {
 	uint32_t f, g, temp;
 	uint32_t w[HASH_MD5 / 4];
@@ -123,8 +232,7 @@ static void md5_proc(uint32_t *h, uint32_t *sched_arr)
 		temp = w[3];
 		w[3] = w[2];
 		w[2] = w[1];
-		w[1] += rotl_uint32(w[0] + f + md5_sbox[k] +
-		    uint32_t_byteorder_swap(sched_arr[g]),
+		w[1] += rotl_uint32(w[0] + f + md5_sbox[k] + sched_arr[g],
 		    md5_shift[k]);
 		w[0] = temp;
 	}
@@ -183,6 +291,328 @@ static void sha1_proc(uint32_t *h, uint32_t *sched_arr)
 		h[k] += w[k];
 }
 
+/** Working procedure of SHA-256 cryptographic hash function.
+ *
+ * @param h     Working array with interim hash parts values.
+ * @param block Input block of 64 bytes.
+ *
+ */
+static void sha256_proc(uint32_t *h, const uint8_t *block)
+{
+	uint32_t sched_arr[64];
+
+	for (size_t k = 0; k < 16; k++)
+		sched_arr[k] = load_uint32_be(block + 4 * k);
+
+	for (size_t k = 16; k < 64; k++) {
+		uint32_t w15 = sched_arr[k - 15];
+		uint32_t w2 = sched_arr[k - 2];
+		uint32_t s0 = rotr_uint32(w15, 7) ^ rotr_uint32(w15, 18) ^
+		    (w15 >> 3);
+		uint32_t s1 = rotr_uint32(w2, 17) ^ rotr_uint32(w2, 19) ^
+		    (w2 >> 10);
+
+		sched_arr[k] = sched_arr[k - 16] + s0 + sched_arr[k - 7] + s1;
+	}
+
+	uint32_t a = h[0];
+	uint32_t b = h[1];
+	uint32_t c = h[2];
+	uint32_t d = h[3];
+	uint32_t e = h[4];
+	uint32_t f = h[5];
+	uint32_t g = h[6];
+	uint32_t hh = h[7];
+
+	for (size_t k = 0; k < 64; k++) {
+		uint32_t s1 = rotr_uint32(e, 6) ^ rotr_uint32(e, 11) ^
+		    rotr_uint32(e, 25);
+		uint32_t ch = (e & f) ^ (~e & g);
+		uint32_t t1 = hh + s1 + ch + sha256_k[k] + sched_arr[k];
+		uint32_t s0 = rotr_uint32(a, 2) ^ rotr_uint32(a, 13) ^
+		    rotr_uint32(a, 22);
+		uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+		uint32_t t2 = s0 + maj;
+
+		hh = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	h[0] += a;
+	h[1] += b;
+	h[2] += c;
+	h[3] += d;
+	h[4] += e;
+	h[5] += f;
+	h[6] += g;
+	h[7] += hh;
+}
+
+/** Working procedure of SHA-512 cryptographic hash function.
+ *
+ * @param h     Working array with interim hash parts values.
+ * @param block Input block of 128 bytes.
+ *
+ */
+static void sha512_proc(uint64_t *h, const uint8_t *block)
+{
+	uint64_t sched_arr[80];
+
+	for (size_t k = 0; k < 16; k++)
+		sched_arr[k] = load_uint64_be(block + 8 * k);
+
+	for (size_t k = 16; k < 80; k++) {
+		uint64_t w15 = sched_arr[k - 15];
+		uint64_t w2 = sched_arr[k - 2];
+		uint64_t s0 = rotr_uint64(w15, 1) ^ rotr_uint64(w15, 8) ^
+		    (w15 >> 7);
+		uint64_t s1 = rotr_uint64(w2, 19) ^ rotr_uint64(w2, 61) ^
+		    (w2 >> 6);
+
+		sched_arr[k] = sched_arr[k - 16] + s0 + sched_arr[k - 7] + s1;
+	}
+
+	uint64_t a = h[0];
+	uint64_t b = h[1];
+	uint64_t c = h[2];
+	uint64_t d = h[3];
+	uint64_t e = h[4];
+	uint64_t f = h[5];
+	uint64_t g = h[6];
+	uint64_t hh = h[7];
+
+	for (size_t k = 0; k < 80; k++) {
+		uint64_t s1 = rotr_uint64(e, 14) ^ rotr_uint64(e, 18) ^
+		    rotr_uint64(e, 41);
+		uint64_t ch = (e & f) ^ (~e & g);
+		uint64_t t1 = hh + s1 + ch + sha512_k[k] + sched_arr[k];
+		uint64_t s0 = rotr_uint64(a, 28) ^ rotr_uint64(a, 34) ^
+		    rotr_uint64(a, 39);
+		uint64_t maj = (a & b) ^ (a & c) ^ (b & c);
+		uint64_t t2 = s0 + maj;
+
+		hh = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	h[0] += a;
+	h[1] += b;
+	h[2] += c;
+	h[3] += d;
+	h[4] += e;
+	h[5] += f;
+	h[6] += g;
+	h[7] += hh;
+}
+
+/** Feed whole input blocks to the working procedure of a hash function.
+ *
+ * @param ctx     Hash context.
+ * @param data    Input blocks.
+ * @param nblocks Number of blocks.
+ *
+ */
+static void hash_blocks(hash_ctx_t *ctx, const uint8_t *data, size_t nblocks)
+{
+	uint32_t sched_arr[80];
+
+	switch (ctx->func) {
+	case HASH_MD5:
+		for (; nblocks > 0; nblocks--, data += 64) {
+			for (size_t k = 0; k < 16; k++)
+				sched_arr[k] = load_uint32_le(data + 4 * k);
+
+			md5_proc(ctx->state.h32, sched_arr);
+		}
+		break;
+	case HASH_SHA1:
+		for (; nblocks > 0; nblocks--, data += 64) {
+			for (size_t k = 0; k < 16; k++)
+				sched_arr[k] = load_uint32_be(data + 4 * k);
+
+			sha1_proc(ctx->state.h32, sched_arr);
+		}
+		break;
+	case HASH_SHA256:
+		if (ctx->shani) {
+			sha_ni_sha256(ctx->state.h32, sha256_k, data, nblocks);
+			break;
+		}
+
+		for (; nblocks > 0; nblocks--, data += 64)
+			sha256_proc(ctx->state.h32, data);
+		break;
+	case HASH_SHA512:
+		for (; nblocks > 0; nblocks--, data += 128)
+			sha512_proc(ctx->state.h64, data);
+		break;
+	}
+}
+
+/** Get the length of the input block of a hash function.
+ *
+ * @param hash_sel Hash function selector.
+ *
+ * @return Block length in bytes or zero if the hash function
+ *         is not supported.
+ *
+ */
+size_t hash_block_length(hash_func_t hash_sel)
+{
+	switch (hash_sel) {
+	case HASH_MD5:
+	case HASH_SHA1:
+	case HASH_SHA256:
+		return 64;
+	case HASH_SHA512:
+		return 128;
+	}
+
+	return 0;
+}
+
+/** Start incremental hash computation.
+ *
+ * @param ctx      Hash context to initialize.
+ * @param hash_sel Hash function selector.
+ *
+ * @return EINVAL when the hash function is not supported,
+ *         otherwise EOK.
+ *
+ */
+errno_t hash_init(hash_ctx_t *ctx, hash_func_t hash_sel)
+{
+	switch (hash_sel) {
+	case HASH_MD5:
+	case HASH_SHA1:
+		memcpy(ctx->state.h32, md5_sha1_init, hash_sel);
+		break;
+	case HASH_SHA256:
+		memcpy(ctx->state.h32, sha256_init, sizeof(sha256_init));
+		break;
+	case HASH_SHA512:
+		memcpy(ctx->state.h64, sha512_init, sizeof(sha512_init));
+		break;
+	default:
+		return EINVAL;
+	}
+
+	ctx->func = hash_sel;
+	ctx->length = 0;
+	ctx->fill = 0;
+	ctx->shani = (hash_sel == HASH_SHA256) && sha_ni_supported();
+
+	return EOK;
+}
+
+/** Add data to incremental hash computation.
+ *
+ * @param ctx  Hash context.
+ * @param data Input data.
+ * @param size Size of input data.
+ *
+ */
+void hash_update(hash_ctx_t *ctx, const void *data, size_t size)
+{
+	const uint8_t *input = data;
+	size_t block_len = hash_block_length(ctx->func);
+
+	ctx->length += size;
+
+	if (ctx->fill > 0) {
+		size_t now = min(size, block_len - ctx->fill);
+
+		memcpy(ctx->block + ctx->fill, input, now);
+		ctx->fill += now;
+		input += now;
+		size -= now;
+
+		if (ctx->fill < block_len)
+			return;
+
+		hash_blocks(ctx, ctx->block, 1);
+		ctx->fill = 0;
+	}
+
+	if (size >= block_len) {
+		size_t nblocks = size / block_len;
+
+		hash_blocks(ctx, input, nblocks);
+		input += nblocks * block_len;
+		size -= nblocks * block_len;
+	}
+
+	if (size > 0) {
+		memcpy(ctx->block, input, size);
+		ctx->fill = size;
+	}
+}
+
+/** Finish incremental hash computation.
+ *
+ * The context has to be initialized again before further use.
+ *
+ * @param ctx    Hash context.
+ * @param output Result hash byte sequence (the length is given
+ *               by the hash function selector).
+ *
+ */
+void hash_final(hash_ctx_t *ctx, uint8_t *output)
+{
+	size_t block_len = hash_block_length(ctx->func);
+	size_t length_len = (ctx->func == HASH_SHA512) ? 16 : 8;
+
+	ctx->block[ctx->fill++] = 0x80;
+
+	if (ctx->fill > block_len - length_len) {
+		memset(ctx->block + ctx->fill, 0, block_len - ctx->fill);
+		hash_blocks(ctx, ctx->block, 1);
+		ctx->fill = 0;
+	}
+
+	memset(ctx->block + ctx->fill, 0, block_len - ctx->fill);
+
+	if (ctx->func == HASH_MD5) {
+		store_uint64_le(ctx->block + block_len - 8, ctx->length << 3);
+	} else {
+		if (ctx->func == HASH_SHA512)
+			store_uint64_be(ctx->block + block_len - 16,
+			    ctx->length >> 61);
+
+		store_uint64_be(ctx->block + block_len - 8, ctx->length << 3);
+	}
+
+	hash_blocks(ctx, ctx->block, 1);
+
+	switch (ctx->func) {
+	case HASH_MD5:
+		for (size_t i = 0; i < HASH_MD5 / 4; i++)
+			store_uint32_le(output + 4 * i, ctx->state.h32[i]);
+		break;
+	case HASH_SHA1:
+	case HASH_SHA256:
+		for (size_t i = 0; i < ctx->func / 4; i++)
+			store_uint32_be(output + 4 * i, ctx->state.h32[i]);
+		break;
+	case HASH_SHA512:
+		for (size_t i = 0; i < HASH_SHA512 / 8; i++)
+			store_uint64_be(output + 8 * i, ctx->state.h64[i]);
+		break;
+	}
+}
+
 /** Create hash based on selected algorithm.
  *
  * @param input      Input message byte sequence.
@@ -190,71 +620,109 @@ static void sha1_proc(uint32_t *h, uint32_t *sched_arr)
  * @param output     Result hash byte sequence.
  * @param hash_sel   Hash function selector.
  *
- * @return EINVAL when input not specified,
- *         ENOMEM when pointer for output hash result
- *         is not allocated, otherwise EOK.
+ * @return EINVAL when input not specified or the hash function
+ *         is not supported, ENOMEM when pointer for output hash
+ *         result is not allocated, otherwise EOK.
  *
  */
 errno_t create_hash(const uint8_t *input, size_t input_size, uint8_t *output,
     hash_func_t hash_sel)
 {
-	assert(input_size < SSIZE_MAX);
-
 	if (!input)
 		return EINVAL;
 
 	if (!output)
 		return ENOMEM;
 
-	hash_fnc_t hash_func = (hash_sel == HASH_MD5) ? md5_proc : sha1_proc;
-
-	/* Prepare scheduled input. */
-	uint8_t work_input[input_size + 1];
-	memcpy(work_input, input, input_size);
-	work_input[input_size] = 0x80;
-
-	// FIXME: double?
-	size_t blocks = ceil_uint32((((double) input_size + 1) / 4 + 2) / 16);
-	uint32_t work_arr[blocks * 16];
-	for (size_t i = 0; i < blocks; i++) {
-		for (size_t j = 0; j < 16; j++) {
-			work_arr[i * 16 + j] =
-			    (get_at(work_input, input_size + 1, i * 64 + j * 4) << 24) |
-			    (get_at(work_input, input_size + 1, i * 64 + j * 4 + 1) << 16) |
-			    (get_at(work_input, input_size + 1, i * 64 + j * 4 + 2) << 8) |
-			    get_at(work_input, input_size + 1, i * 64 + j * 4 + 3);
-		}
-	}
+	hash_ctx_t ctx;
+	errno_t rc = hash_init(&ctx, hash_sel);
+	if (rc != EOK)
+		return rc;
 
-	uint64_t bits_size = (uint64_t) (input_size * 8);
-	if (hash_sel == HASH_MD5)
-		bits_size = uint64_t_byteorder_swap(bits_size);
+	hash_update(&ctx, input, input_size);
+	hash_final(&ctx, output);
 
-	work_arr[(blocks - 1) * 16 + 14] = bits_size >> 32;
-	work_arr[(blocks - 1) * 16 + 15] = bits_size & 0xffffffff;
+	return EOK;
+}
 
-	/* Hash computation. */
-	uint32_t h[hash_sel / 4];
-	memcpy(h, hash_init, (hash_sel / 4) * sizeof(uint32_t));
-	uint32_t sched_arr[80];
-	for (size_t i = 0; i < blocks; i++) {
-		for (size_t k = 0; k < 16; k++)
-			sched_arr[k] = work_arr[i * 16 + k];
+/** Start incremental HMAC computation.
+ *
+ * Both padded keys are absorbed into the hash states right away,
+ * so a copy of the initialized context can be used to authenticate
+ * any number of messages without processing the key again.
+ *
+ * @param ctx      HMAC context to initialize.
+ * @param key      Cryptographic key sequence.
+ * @param key_size Size of key sequence.
+ * @param hash_sel Hash function selector.
+ *
+ * @return EINVAL when the hash function is not supported,
+ *         otherwise EOK.
+ *
+ */
+errno_t hmac_init(hmac_ctx_t *ctx, const uint8_t *key, size_t key_size,
+    hash_func_t hash_sel)
+{
+	size_t block_len = hash_block_length(hash_sel);
+	if (block_len == 0)
+		return EINVAL;
 
-		hash_func(h, sched_arr);
+	uint8_t work_key[HASH_BLOCK_LENGTH_MAX];
+	uint8_t key_pad[HASH_BLOCK_LENGTH_MAX];
+	memset(work_key, 0, block_len);
+
+	if (key_size > block_len) {
+		(void) hash_init(&ctx->inner, hash_sel);
+		hash_update(&ctx->inner, key, key_size);
+		hash_final(&ctx->inner, work_key);
+	} else {
+		memcpy(work_key, key, key_size);
 	}
 
-	/* Copy hash parts into final result. */
-	for (size_t i = 0; i < hash_sel / 4; i++) {
-		if (hash_sel == HASH_SHA1)
-			h[i] = uint32_t_byteorder_swap(h[i]);
+	for (size_t i = 0; i < block_len; i++)
+		key_pad[i] = work_key[i] ^ 0x36;
 
-		memcpy(output + i * sizeof(uint32_t), &h[i], sizeof(uint32_t));
-	}
+	(void) hash_init(&ctx->inner, hash_sel);
+	hash_update(&ctx->inner, key_pad, block_len);
+
+	for (size_t i = 0; i < block_len; i++)
+		key_pad[i] = work_key[i] ^ 0x5c;
+
+	(void) hash_init(&ctx->outer, hash_sel);
+	hash_update(&ctx->outer, key_pad, block_len);
 
 	return EOK;
 }
 
+/** Add data to incremental HMAC computation.
+ *
+ * @param ctx  HMAC context.
+ * @param data Message data.
+ * @param size Size of message data.
+ *
+ */
+void hmac_update(hmac_ctx_t *ctx, const void *data, size_t size)
+{
+	hash_update(&ctx->inner, data, size);
+}
+
+/** Finish incremental HMAC computation.
+ *
+ * The context has to be initialized again before further use.
+ *
+ * @param ctx  HMAC context.
+ * @param hash Output parameter for result hash.
+ *
+ */
+void hmac_final(hmac_ctx_t *ctx, uint8_t *hash)
+{
+	uint8_t temp_hash[HASH_LENGTH_MAX];
+
+	hash_final(&ctx->inner, temp_hash);
+	hash_update(&ctx->outer, temp_hash, ctx->outer.func);
+	hash_final(&ctx->outer, hash);
+}
+
 /** Hash-based message authentication code.
  *
  * @param key      Cryptographic key sequence.
@@ -264,9 +732,9 @@ errno_t create_hash(const uint8_t *input, size_t input_size, uint8_t *output,
  * @param hash     Output parameter for result hash.
  * @param hash_sel Hash function selector.
  *
- * @return EINVAL when key or message not specified,
- *         ENOMEM when pointer for output hash result
- *         is not allocated, otherwise EOK.
+ * @return EINVAL when key or message not specified or the hash
+ *         function is not supported, ENOMEM when pointer for output
+ *         hash result is not allocated, otherwise EOK.
  *
  */
 errno_t hmac(uint8_t *key, size_t key_size, uint8_t *msg, size_t msg_size,
@@ -278,33 +746,75 @@ errno_t hmac(uint8_t *key, size_t key_size, uint8_t *msg, size_t msg_size,
 	if (!hash)
 		return ENOMEM;
 
-	uint8_t work_key[HMAC_BLOCK_LENGTH];
-	uint8_t o_key_pad[HMAC_BLOCK_LENGTH];
-	uint8_t i_key_pad[HMAC_BLOCK_LENGTH];
-	uint8_t temp_hash[hash_sel];
-	memset(work_key, 0, HMAC_BLOCK_LENGTH);
+	hmac_ctx_t ctx;
+	errno_t rc = hmac_init(&ctx, key, key_size, hash_sel);
+	if (rc != EOK)
+		return rc;
 
-	if (key_size > HMAC_BLOCK_LENGTH)
-		create_hash(key, key_size, work_key, hash_sel);
-	else
-		memcpy(work_key, key, key_size);
+	hmac_update(&ctx, msg, msg_size);
+	hmac_final(&ctx, hash);
 
-	for (size_t i = 0; i < HMAC_BLOCK_LENGTH; i++) {
-		o_key_pad[i] = work_key[i] ^ 0x5c;
-		i_key_pad[i] = work_key[i] ^ 0x36;
-	}
+	return EOK;
+}
 
-	uint8_t temp_work[HMAC_BLOCK_LENGTH + max(msg_size, hash_sel)];
-	memcpy(temp_work, i_key_pad, HMAC_BLOCK_LENGTH);
-	memcpy(temp_work + HMAC_BLOCK_LENGTH, msg, msg_size);
+/** Password-Based Key Derivation Function 2.
+ *
+ * As defined in RFC 2898 with HMAC as the pseudorandom function.
+ * The password is absorbed into the HMAC state only once, each
+ * iteration then costs two runs of the hash working procedure.
+ *
+ * @param hash_sel    Hash function selector.
+ * @param pass        Password sequence.
+ * @param pass_size   Password sequence length.
+ * @param salt        Salt sequence to be used with password.
+ * @param salt_size   Salt sequence length.
+ * @param iterations  Number of iterations.
+ * @param output      Output parameter for derived key.
+ * @param output_size Length of derived key.
+ *
+ * @return EINVAL when the number of iterations is zero or the hash
+ *         function is not supported, otherwise EOK.
+ *
+ */
+errno_t pbkdf2_hmac(hash_func_t hash_sel, const uint8_t *pass,
+    size_t pass_size, const uint8_t *salt, size_t salt_size,
+    unsigned int iterations, uint8_t *output, size_t output_size)
+{
+	if (iterations == 0)
+		return EINVAL;
 
-	create_hash(temp_work, HMAC_BLOCK_LENGTH + msg_size, temp_hash,
-	    hash_sel);
+	hmac_ctx_t keyed;
+	errno_t rc = hmac_init(&keyed, pass, pass_size, hash_sel);
+	if (rc != EOK)
+		return rc;
 
-	memcpy(temp_work, o_key_pad, HMAC_BLOCK_LENGTH);
-	memcpy(temp_work + HMAC_BLOCK_LENGTH, temp_hash, hash_sel);
+	hmac_ctx_t work;
+	uint8_t work_hmac[HASH_LENGTH_MAX];
+	uint8_t xor_hmac[HASH_LENGTH_MAX];
 
-	create_hash(temp_work, HMAC_BLOCK_LENGTH + hash_sel, hash, hash_sel);
+	for (uint32_t i = 1; output_size > 0; i++) {
+		uint32_t be_i = host2uint32_t_be(i);
+
+		work = keyed;
+		hmac_update(&work, salt, salt_size);
+		hmac_update(&work, &be_i, sizeof(be_i));
+		hmac_final(&work, work_hmac);
+		memcpy(xor_hmac, work_hmac, hash_sel);
+
+		for (unsigned int k = 1; k < iterations; k++) {
+			work = keyed;
+			hmac_update(&work, work_hmac, hash_sel);
+			hmac_final(&work, work_hmac);
+
+			for (size_t t = 0; t < hash_sel; t++)
+				xor_hmac[t] ^= work_hmac[t];
+		}
+
+		size_t now = min(output_size, (size_t) hash_sel);
+		memcpy(output, xor_hmac, now);
+		output += now;
+		output_size -= now;
+	}
 
 	return EOK;
 }
@@ -334,34 +844,6 @@ errno_t pbkdf2(uint8_t *pass, size_t pass_size, uint8_t *salt, size_t salt_size,
 	if (!hash)
 		return ENOMEM;
 
-	uint8_t work_salt[salt_size + 4];
-	memcpy(work_salt, salt, salt_size);
-	uint8_t work_hmac[HASH_SHA1];
-	uint8_t temp_hmac[HASH_SHA1];
-	uint8_t xor_hmac[HASH_SHA1];
-	uint8_t temp_hash[HASH_SHA1 * 2];
-
-	for (size_t i = 0; i < 2; i++) {
-		uint32_t be_i = host2uint32_t_be(i + 1);
-
-		memcpy(work_salt + salt_size, &be_i, 4);
-		hmac(pass, pass_size, work_salt, salt_size + 4,
-		    work_hmac, HASH_SHA1);
-		memcpy(xor_hmac, work_hmac, HASH_SHA1);
-
-		for (size_t k = 1; k < 4096; k++) {
-			memcpy(temp_hmac, work_hmac, HASH_SHA1);
-			hmac(pass, pass_size, temp_hmac, HASH_SHA1,
-			    work_hmac, HASH_SHA1);
-
-			for (size_t t = 0; t < HASH_SHA1; t++)
-				xor_hmac[t] ^= work_hmac[t];
-		}
-
-		memcpy(temp_hash + i * HASH_SHA1, xor_hmac, HASH_SHA1);
-	}
-
-	memcpy(hash, temp_hash, PBKDF2_KEY_LENGTH);
-
-	return EOK;
+	return pbkdf2_hmac(HASH_SHA1, pass, pass_size, salt, salt_size, 4096,
+	    hash, PBKDF2_KEY_LENGTH);
 }
@@ -30,12 +30,22 @@
 #define LIBCRYPTO_H
 
 #include <errno.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 #define AES_CIPHER_LENGTH  16
 #define PBKDF2_KEY_LENGTH  32
 
+/* Number of round key words of AES-128. */
+#define AES_KEY_WORDS  44
+
+/* Recommended length of AES-GCM initialization vector. */
+#define AES_GCM_IV_LENGTH  12
+
+/* Length of AES-GCM authentication tag. */
+#define AES_GCM_TAG_LENGTH  16
+
 /* Left rotation for uint32_t. */
 #define rotl_uint32(val, shift) \
 	(((val) << shift) | ((val) >> (32 - shift)))
@@ -44,17 +54,99 @@
 #define rotr_uint32(val, shift) \
 	(((val) >> shift) | ((val) << (32 - shift)))
 
+/* Largest block length of the supported hash functions. */
+#define HASH_BLOCK_LENGTH_MAX  128
+
+/* Largest result length of the supported hash functions. */
+#define HASH_LENGTH_MAX  64
+
 /** Hash function selector and also result hash length indicator. */
 typedef enum {
 	HASH_MD5 =  16,
-	HASH_SHA1 = 20
+	HASH_SHA1 = 20,
+	HASH_SHA256 = 32,
+	HASH_SHA512 = 64
 } hash_func_t;
 
+/** Incremental hash computation. */
+typedef struct {
+	/** Hash function. */
+	hash_func_t func;
+	/** Interim hash value. */
+	union {
+		uint32_t h32[8];
+		uint64_t h64[8];
+	} state;
+	/** Number of bytes hashed so far. */
+	uint64_t length;
+	/** Partial input block. */
+	uint8_t block[HASH_BLOCK_LENGTH_MAX];
+	/** Number of bytes in the partial input block. */
+	size_t fill;
+	/** Use the SHA instructions of the processor. */
+	bool shani;
+} hash_ctx_t;
+
+/** Incremental HMAC computation. */
+typedef struct {
+	/** Hash of the inner padded key followed by the message. */
+	hash_ctx_t inner;
+	/** Hash of the outer padded key. */
+	hash_ctx_t outer;
+} hmac_ctx_t;
+
+/** Expanded AES-128 key. */
+typedef struct {
+	/** Round keys of the cipher. */
+	uint32_t enc[AES_KEY_WORDS];
+	/** Round keys of the equivalent inverse cipher. */
+	uint32_t dec[AES_KEY_WORDS];
+	/** Round keys of the cipher as byte strings. */
+	uint8_t enc_bytes[4 * AES_KEY_WORDS] __attribute__((aligned(16)));
+	/** Round keys of the inverse cipher as byte strings. */
+	uint8_t dec_bytes[4 * AES_KEY_WORDS] __attribute__((aligned(16)));
+	/** Use the AES instructions of the processor. */
+	bool aesni;
+} aes_context_t;
+
+/** AES-128 key with precomputed GHASH tables. */
+typedef struct {
+	/** Expanded key. */
+	aes_context_t aes;
+	/** Multiples of the hash subkey (high halves). */
+	uint64_t hh[16];
+	/** Multiples of the hash subkey (low halves). */
+	uint64_t hl[16];
+} aes_gcm_context_t;
+
 extern errno_t rc4(uint8_t *, size_t, uint8_t *, size_t, size_t, uint8_t *);
 extern errno_t aes_encrypt(uint8_t *, uint8_t *, uint8_t *);
 extern errno_t aes_decrypt(uint8_t *, uint8_t *, uint8_t *);
+extern void aes_init(aes_context_t *, const uint8_t *);
+extern void aes_encrypt_block(const aes_context_t *, const uint8_t *,
+    uint8_t *);
+extern void aes_decrypt_block(const aes_context_t *, const uint8_t *,
+    uint8_t *);
+extern void aes_ctr(const aes_context_t *, uint8_t *, const uint8_t *,
+    uint8_t *, size_t);
+extern void aes_gcm_init(aes_gcm_context_t *, const uint8_t *);
+extern errno_t aes_gcm_encrypt(const aes_gcm_context_t *, const uint8_t *,
+    size_t, const uint8_t *, size_t, const uint8_t *, uint8_t *, size_t,
+    uint8_t *);
+extern errno_t aes_gcm_decrypt(const aes_gcm_context_t *, const uint8_t *,
+    size_t, const uint8_t *, size_t, const uint8_t *, uint8_t *, size_t,
+    const uint8_t *);
+extern size_t hash_block_length(hash_func_t);
+extern errno_t hash_init(hash_ctx_t *, hash_func_t);
+extern void hash_update(hash_ctx_t *, const void *, size_t);
+extern void hash_final(hash_ctx_t *, uint8_t *);
 extern errno_t create_hash(const uint8_t *, size_t, uint8_t *, hash_func_t);
+extern errno_t hmac_init(hmac_ctx_t *, const uint8_t *, size_t, hash_func_t);
+extern void hmac_update(hmac_ctx_t *, const void *, size_t);
+extern void hmac_final(hmac_ctx_t *, uint8_t *);
 extern errno_t hmac(uint8_t *, size_t, uint8_t *, size_t, uint8_t *, hash_func_t);
+extern errno_t pbkdf2_hmac(hash_func_t, const uint8_t *, size_t,
+    const uint8_t *, size_t, unsigned int, uint8_t *, size_t);
 extern errno_t pbkdf2(uint8_t *, size_t, uint8_t *, size_t, uint8_t *);
 
 extern uint16_t crc16_ibm(uint16_t crc, uint8_t *buf, size_t len);
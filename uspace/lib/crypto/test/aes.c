@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+#include <str.h>
+#include "../crypto.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(aes);
+
+/** Convert hexadecimal string to bytes.
+ *
+ * @param hex  Hexadecimal string
+ * @param buf  Output buffer
+ * @param size Size of output buffer
+ * @return     Number of bytes stored
+ */
+static size_t test_unhex(const char *hex, uint8_t *buf, size_t size)
+{
+	size_t len = str_length(hex) / 2;
+	uint8_t nib[2];
+
+	PCUT_ASSERT_TRUE(len <= size);
+
+	for (size_t i = 0; i < len; i++) {
+		for (size_t j = 0; j < 2; j++) {
+			char c = hex[2 * i + j];
+
+			if (c >= 'a')
+				nib[j] = c - 'a' + 10;
+			else
+				nib[j] = c - '0';
+		}
+
+		buf[i] = (nib[0] << 4) | nib[1];
+	}
+
+	return len;
+}
+
+/** Check a block cipher known answer */
+static void test_cipher_kat(const char *khex, const char *phex,
+    const char *chex)
+{
+	aes_context_t ctx;
+	uint8_t key[AES_CIPHER_LENGTH];
+	uint8_t pt[AES_CIPHER_LENGTH];
+	uint8_t ct[AES_CIPHER_LENGTH];
+	uint8_t out[AES_CIPHER_LENGTH];
+	errno_t rc;
+
+	test_unhex(khex, key, sizeof(key));
+	test_unhex(phex, pt, sizeof(pt));
+	test_unhex(chex, ct, sizeof(ct));
+
+	aes_init(&ctx, key);
+	aes_encrypt_block(&ctx, pt, out);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(out, ct, sizeof(ct)));
+	aes_decrypt_block(&ctx, ct, out);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(out, pt, sizeof(pt)));
+
+	/* One-shot interface */
+	rc = aes_encrypt(key, pt, out);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(out, ct, sizeof(ct)));
+	rc = aes_decrypt(key, ct, out);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(out, pt, sizeof(pt)));
+}
+
+/** FIPS-197 Appendix B, cipher example */
+PCUT_TEST(fips197_b)
+{
+	test_cipher_kat("2b7e151628aed2a6abf7158809cf4f3c",
+	    "3243f6a8885a308d313198a2e0370734",
+	    "3925841d02dc09fbdc118597196a0b32");
+}
+
+/** FIPS-197 Appendix C.1, AES-128 */
+PCUT_TEST(fips197_c1)
+{
+	test_cipher_kat("000102030405060708090a0b0c0d0e0f",
+	    "00112233445566778899aabbccddeeff",
+	    "69c4e0d86a7b0430d8cdb78070b4c55a");
+}
+
+/** SP 800-38A F.5.1 and F.5.2, CTR-AES128 */
+PCUT_TEST(sp800_38a_ctr)
+{
+	aes_context_t ctx;
+	uint8_t key[AES_CIPHER_LENGTH];
+	uint8_t ctr[AES_CIPHER_LENGTH];
+	uint8_t next[AES_CIPHER_LENGTH];
+	uint8_t pt[64];
+	uint8_t ct[64];
+	uint8_t buf[64];
+
+	test_unhex("2b7e151628aed2a6abf7158809cf4f3c", key, sizeof(key));
+	test_unhex("6bc1bee22e409f96e93d7e117393172a"
+	    "ae2d8a571e03ac9c9eb76fac45af8e51"
+	    "30c81c46a35ce411e5fbc1191a0a52ef"
+	    "f69f2445df4f9b17ad2b417be66c3710", pt, sizeof(pt));
+	test_unhex("874d6191b620e3261bef6864990db6ce"
+	    "9806f66b7970fdff8617187bb9fffdff"
+	    "5ae4df3edbd5d35e5b4f09020db03eab"
+	    "1e031dda2fbe03d1792170a0f3009cee", ct, sizeof(ct));
+	test_unhex("f0f1f2f3f4f5f6f7f8f9fafbfcfdff03", next, sizeof(next));
+
+	aes_init(&ctx, key);
+
+	/* Encrypt all at once */
+	test_unhex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff", ctr, sizeof(ctr));
+	aes_ctr(&ctx, ctr, pt, buf, sizeof(pt));
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(buf, ct, sizeof(ct)));
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(ctr, next, sizeof(next)));
+
+	/* Decrypt in place, in two calls */
+	test_unhex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff", ctr, sizeof(ctr));
+	aes_ctr(&ctx, ctr, buf, buf, 32);
+	aes_ctr(&ctx, ctr, buf + 32, buf + 32, 32);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(buf, pt, sizeof(pt)));
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(ctr, next, sizeof(next)));
+
+	/* Partial last block */
+	memset(buf, 0, sizeof(buf));
+	test_unhex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff", ctr, sizeof(ctr));
+	aes_ctr(&ctx, ctr, pt, buf, 60);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(buf, ct, 60));
+	PCUT_ASSERT_INT_EQUALS(0, buf[60]);
+}
+
+/** Check a GCM known answer.
+ *
+ * @param khex Key
+ * @param ivhex Initialization vector
+ * @param phex Plain text
+ * @param ahex Additional authenticated data
+ * @param chex Cipher text
+ * @param thex Authentication tag
+ */
+static void test_gcm_kat(const char *khex, const char *ivhex,
+    const char *phex, const char *ahex, const char *chex, const char *thex)
+{
+	aes_gcm_context_t ctx;
+	uint8_t key[AES_CIPHER_LENGTH];
+	uint8_t iv[64];
+	uint8_t pt[64];
+	uint8_t aad[32];
+	uint8_t ct[64];
+	uint8_t tag[AES_GCM_TAG_LENGTH];
+	uint8_t out[64];
+	uint8_t otag[AES_GCM_TAG_LENGTH];
+	size_t ivlen;
+	size_t len;
+	size_t aadlen;
+	errno_t rc;
+
+	test_unhex(khex, key, sizeof(key));
+	ivlen = test_unhex(ivhex, iv, sizeof(iv));
+	len = test_unhex(phex, pt, sizeof(pt));
+	aadlen = test_unhex(ahex, aad, sizeof(aad));
+	PCUT_ASSERT_INT_EQUALS(len, test_unhex(chex, ct, sizeof(ct)));
+	test_unhex(thex, tag, sizeof(tag));
+
+	aes_gcm_init(&ctx, key);
+
+	rc = aes_gcm_encrypt(&ctx, iv, ivlen, aad, aadlen, pt, out, len,
+	    otag);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(out, ct, len));
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(otag, tag, sizeof(tag)));
+
+	rc = aes_gcm_decrypt(&ctx, iv, ivlen, aad, aadlen, ct, out, len, tag);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(out, pt, len));
+
+	/* Any change of the tag is detected */
+	tag[AES_GCM_TAG_LENGTH - 1] ^= 0x80;
+	rc = aes_gcm_decrypt(&ctx, iv, ivlen, aad, aadlen, ct, out, len, tag);
+	PCUT_ASSERT_ERRNO_VAL(EACCES, rc);
+}
+
+/** GCM specification test case 1, empty plain text */
+PCUT_TEST(gcm_1)
+{
+	test_gcm_kat("00000000000000000000000000000000",
+	    "000000000000000000000000", "", "", "",
+	    "58e2fccefa7e3061367f1d57a4e7455a");
+}
+
+/** GCM specification test case 2, single zero block */
+PCUT_TEST(gcm_2)
+{
+	test_gcm_kat("00000000000000000000000000000000",
+	    "000000000000000000000000",
+	    "00000000000000000000000000000000", "",
+	    "0388dace60b6a392f328c2b971b2fe78",
+	    "ab6e47d42cec13bdf53a67b21257bddf");
+}
+
+/** GCM specification test case 3, four blocks */
+PCUT_TEST(gcm_3)
+{
+	test_gcm_kat("feffe9928665731c6d6a8f9467308308",
+	    "cafebabefacedbaddecaf888",
+	    "d9313225f88406e5a55909c5aff5269a"
+	    "86a7a9531534f7da2e4c303d8a318a72"
+	    "1c3c0c95956809532fcf0e2449a6b525"
+	    "b16aedf5aa0de657ba637b391aafd255", "",
+	    "42831ec2217774244b7221b784d0d49c"
+	    "e3aa212f2c02a4e035c17e2329aca12e"
+	    "21d514b25466931c7d8f6a5aac84aa05"
+	    "1ba30b396a0aac973d58e091473f5985",
+	    "4d5c2af327cd64a62cf35abd2ba6fab4");
+}
+
+/** GCM specification test case 4, partial block and AAD */
+PCUT_TEST(gcm_4)
+{
+	test_gcm_kat("feffe9928665731c6d6a8f9467308308",
+	    "cafebabefacedbaddecaf888",
+	    "d9313225f88406e5a55909c5aff5269a"
+	    "86a7a9531534f7da2e4c303d8a318a72"
+	    "1c3c0c95956809532fcf0e2449a6b525"
+	    "b16aedf5aa0de657ba637b39",
+	    "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+	    "42831ec2217774244b7221b784d0d49c"
+	    "e3aa212f2c02a4e035c17e2329aca12e"
+	    "21d514b25466931c7d8f6a5aac84aa05"
+	    "1ba30b396a0aac973d58e091",
+	    "5bc94fbc3221a5db94fae95ae7121a47");
+}
+
+/** GCM specification test case 6, 60 byte initialization vector */
+PCUT_TEST(gcm_6)
+{
+	test_gcm_kat("feffe9928665731c6d6a8f9467308308",
+	    "9313225df88406e555909c5aff5269aa"
+	    "6a7a9538534f7da1e4c303d2a318a728"
+	    "c3c0c95156809539fcf0e2429a6b5254"
+	    "16aedbf5a0de6a57a637b39b",
+	    "d9313225f88406e5a55909c5aff5269a"
+	    "86a7a9531534f7da2e4c303d8a318a72"
+	    "1c3c0c95956809532fcf0e2449a6b525"
+	    "b16aedf5aa0de657ba637b39",
+	    "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+	    "8ce24998625615b603a033aca13fb894"
+	    "be9112a5c3a211a8ba262a3cca7e2ca7"
+	    "01e4a9a4fba43c90ccdcb281d48c7c6f"
+	    "d62875d2aca417034c34aee5",
+	    "619cc5aefffe0bfa462af43c1699d050");
+}
+
+/** Empty initialization vector is rejected */
+PCUT_TEST(gcm_empty_iv)
+{
+	aes_gcm_context_t ctx;
+	uint8_t key[AES_CIPHER_LENGTH];
+	uint8_t tag[AES_GCM_TAG_LENGTH];
+	errno_t rc;
+
+	memset(key, 0, sizeof(key));
+	aes_gcm_init(&ctx, key);
+
+	rc = aes_gcm_encrypt(&ctx, NULL, 0, NULL, 0, NULL, NULL, 0, tag);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+}
+
+PCUT_EXPORT(aes);
@@ -0,0 +1,393 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <macros.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <str.h>
+#include "../crypto.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(hash);
+
+/** Convert hexadecimal string to bytes.
+ *
+ * @param hex  Hexadecimal string
+ * @param buf  Output buffer
+ * @param size Size of output buffer
+ * @return     Number of bytes stored
+ */
+static size_t test_unhex(const char *hex, uint8_t *buf, size_t size)
+{
+	size_t len = str_length(hex) / 2;
+	uint8_t nib[2];
+
+	PCUT_ASSERT_TRUE(len <= size);
+
+	for (size_t i = 0; i < len; i++) {
+		for (size_t j = 0; j < 2; j++) {
+			char c = hex[2 * i + j];
+
+			if (c >= 'a')
+				nib[j] = c - 'a' + 10;
+			else
+				nib[j] = c - '0';
+		}
+
+		buf[i] = (nib[0] << 4) | nib[1];
+	}
+
+	return len;
+}
+
+/** Check a hash known answer, hashing at once and in pieces.
+ *
+ * @param func Hash function
+ * @param msg  Message
+ * @param len  Length of message
+ * @param dhex Expected digest
+ */
+static void test_hash_kat(hash_func_t func, const uint8_t *msg, size_t len,
+    const char *dhex)
+{
+	hash_ctx_t ctx;
+	uint8_t exp[HASH_LENGTH_MAX];
+	uint8_t out[HASH_LENGTH_MAX];
+	size_t step;
+	errno_t rc;
+
+	PCUT_ASSERT_INT_EQUALS(func, test_unhex(dhex, exp, sizeof(exp)));
+
+	rc = create_hash(msg, len, out, func);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(out, exp, func));
+
+	/* Pieces not aligned to the block length */
+	for (step = 1; step <= 200; step += 37) {
+		rc = hash_init(&ctx, func);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		for (size_t i = 0; i < len; i += step)
+			hash_update(&ctx, msg + i, min(step, len - i));
+		hash_final(&ctx, out);
+		PCUT_ASSERT_INT_EQUALS(0, memcmp(out, exp, func));
+	}
+}
+
+/** FIPS 180 examples */
+static const char *test_msg[] = {
+	"",
+	"abc",
+	"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+	"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+	"hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu"
+};
+
+/** SHA-256 of the FIPS 180 examples */
+PCUT_TEST(sha256)
+{
+	static const char *digest[] = {
+		"e3b0c44298fc1c149afbf4c8996fb924"
+		"27ae41e4649b934ca495991b7852b855",
+		"ba7816bf8f01cfea414140de5dae2223"
+		"b00361a396177a9cb410ff61f20015ad",
+		"248d6a61d20638b8e5c026930c3e6039"
+		"a33ce45964ff2167f6ecedd419db06c1",
+		"cf5b16a778af8380036ce59e7b049237"
+		"0b249b11e8f07a51afac45037afee9d1"
+	};
+
+	for (size_t i = 0; i < sizeof(digest) / sizeof(digest[0]); i++) {
+		test_hash_kat(HASH_SHA256, (const uint8_t *) test_msg[i],
+		    str_length(test_msg[i]), digest[i]);
+	}
+}
+
+/** SHA-512 of the FIPS 180 examples */
+PCUT_TEST(sha512)
+{
+	static const char *digest[] = {
+		"cf83e1357eefb8bdf1542850d66d8007"
+		"d620e4050b5715dc83f4a921d36ce9ce"
+		"47d0d13c5d85f2b0ff8318d2877eec2f"
+		"63b931bd47417a81a538327af927da3e",
+		"ddaf35a193617abacc417349ae204131"
+		"12e6fa4e89a97ea20a9eeee64b55d39a"
+		"2192992a274fc1a836ba3c23a3feebbd"
+		"454d4423643ce80e2a9ac94fa54ca49f",
+		"204a8fc6dda82f0a0ced7beb8e08a416"
+		"57c16ef468b228a8279be331a703c335"
+		"96fd15c13b1b07f9aa1d3bea57789ca0"
+		"31ad85c7a71dd70354ec631238ca3445",
+		"8e959b75dae313da8cf4f72814fc143f"
+		"8f7779c6eb9f7fa17299aeadb6889018"
+		"501d289e4900f7e4331b99dec4b5433a"
+		"c7d329eeb6dd26545e96e55b874be909"
+	};
+
+	for (size_t i = 0; i < sizeof(digest) / sizeof(digest[0]); i++) {
+		test_hash_kat(HASH_SHA512, (const uint8_t *) test_msg[i],
+		    str_length(test_msg[i]), digest[i]);
+	}
+}
+
+/** One million repetitions of 'a' */
+PCUT_TEST(million_a)
+{
+	size_t len = 1000000;
+	uint8_t *msg;
+
+	msg = malloc(len);
+	PCUT_ASSERT_NOT_NULL(msg);
+	memset(msg, 'a', len);
+
+	test_hash_kat(HASH_SHA256, msg, len,
+	    "cdc76e5c9914fb9281a1c7e284d73e67"
+	    "f1809a48a497200e046d39ccc7112cd0");
+	test_hash_kat(HASH_SHA512, msg, len,
+	    "e718483d0ce769644e2e42c7bc15b4638e1f98b13b2044285632a803afa973eb"
+	    "de0ff244877ea60a4cb0432ce577c31beb009c5c2c49aa2e4eadb217ad8cc09b");
+
+	free(msg);
+}
+
+/** RFC 4231 test case */
+typedef struct {
+	/** Key */
+	const char *key;
+	/** Data */
+	const char *data;
+	/** HMAC-SHA-256 */
+	const char *sha256;
+	/** HMAC-SHA-512 */
+	const char *sha512;
+} test_hmac_case_t;
+
+/** Check an HMAC known answer with both interfaces */
+static void test_hmac_kat(hash_func_t func, const uint8_t *key,
+    size_t key_size, const uint8_t *data, size_t data_size,
+    const char *dhex)
+{
+	hmac_ctx_t ctx;
+	uint8_t exp[HASH_LENGTH_MAX];
+	uint8_t out[HASH_LENGTH_MAX];
+	errno_t rc;
+
+	test_unhex(dhex, exp, sizeof(exp));
+
+	rc = hmac((uint8_t *) key, key_size, (uint8_t *) data, data_size, out,
+	    func);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(out, exp, func));
+
+	rc = hmac_init(&ctx, key, key_size, func);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	hmac_update(&ctx, data, data_size / 2);
+	hmac_update(&ctx, data + data_size / 2, data_size - data_size / 2);
+	hmac_final(&ctx, out);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(out, exp, func));
+}
+
+/** RFC 4231 test cases 1-4, 6 and 7 */
+PCUT_TEST(hmac_rfc4231)
+{
+	static const test_hmac_case_t cases[] = {
+		{
+			"0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b",
+			"4869205468657265",
+			"b0344c61d8db38535ca8afceaf0bf12b"
+			"881dc200c9833da726e9376c2e32cff7",
+			"87aa7cdea5ef619d4ff0b4241a1d6cb0"
+			"2379f4e2ce4ec2787ad0b30545e17cde"
+			"daa833b7d6b8a702038b274eaea3f4e4"
+			"be9d914eeb61f1702e696c203a126854"
+		},
+		{
+			"4a656665",
+			"7768617420646f2079612077616e7420"
+			"666f72206e6f7468696e673f",
+			"5bdcc146bf60754e6a042426089575c7"
+			"5a003f089d2739839dec58b964ec3843",
+			"164b7a7bfcf819e2e395fbe73b56e0a3"
+			"87bd64222e831fd610270cd7ea250554"
+			"9758bf75c05a994a6d034f65f8f0e6fd"
+			"caeab1a34d4a6b4b636e070a38bce737"
+		},
+		{
+			"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+			"dddddddddddddddddddddddddddddddd"
+			"dddddddddddddddddddddddddddddddd"
+			"dddddddddddddddddddddddddddddddddddd",
+			"773ea91e36800e46854db8ebd09181a7"
+			"2959098b3ef8c122d9635514ced565fe",
+			"fa73b0089d56a284efb0f0756c890be9"
+			"b1b5dbdd8ee81a3655f83e33b2279d39"
+			"bf3e848279a722c806b485a47e67c807"
+			"b946a337bee8942674278859e13292fb"
+		},
+		{
+			"0102030405060708090a0b0c0d0e0f10111213141516171819",
+			"cdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcd"
+			"cdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcd"
+			"cdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcd",
+			"82558a389a443c0ea4cc819899f2083a"
+			"85f0faa3e578f8077a2e3ff46729665b",
+			"b0ba465637458c6990e5a8c5f61d4af7"
+			"e576d97ff94b872de76f8050361ee3db"
+			"a91ca5c11aa25eb4d679275cc5788063"
+			"a5f19741120c4f2de2adebeb10a298dd"
+		},
+		{
+			"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+			"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+			"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+			"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+			"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+			"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+			"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+			"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+			"aaaaaa",
+			"54657374205573696e67204c61726765"
+			"72205468616e20426c6f636b2d53697a"
+			"65204b6579202d2048617368204b6579"
+			"204669727374",
+			"60e431591ee0b67f0d8a26aacbf5b77f"
+			"8e0bc6213728c5140546040f0ee37f54",
+			"80b24263c7c1a3ebb71493c1dd7be8b4"
+			"9b46d1f41b4aeec1121b013783f8f352"
+			"6b56d037e05f2598bd0fd2215d6a1e52"
+			"95e64f73f63f0aec8b915a985d786598"
+		},
+		{
+			"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+			"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+			"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+			"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+			"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+			"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+			"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+			"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+			"aaaaaa",
+			"54686973206973206120746573742075"
+			"73696e672061206c6172676572207468"
+			"616e20626c6f636b2d73697a65206b65"
+			"7920616e642061206c61726765722074"
+			"68616e20626c6f636b2d73697a652064"
+			"6174612e20546865206b6579206e6565"
+			"647320746f2062652068617368656420"
+			"6265666f7265206265696e6720757365"
+			"642062792074686520484d414320616c"
+			"676f726974686d2e",
+			"9b09ffa71b942fcb27635fbcd5b0e944"
+			"bfdc63644f0713938a7f51535c3a35e2",
+			"e37b6a775dc87dbaa4dfa9f96e5e3ffd"
+			"debd71f8867289865df5a32d20cdc944"
+			"b6022cac3c4982b10d5eeb55c3e4de15"
+			"134676fb6de0446065c97440fa8c6a58"
+		}
+	};
+	uint8_t key[131];
+	uint8_t data[152];
+	size_t key_size;
+	size_t data_size;
+
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		key_size = test_unhex(cases[i].key, key, sizeof(key));
+		data_size = test_unhex(cases[i].data, data, sizeof(data));
+
+		test_hmac_kat(HASH_SHA256, key, key_size, data, data_size,
+		    cases[i].sha256);
+		test_hmac_kat(HASH_SHA512, key, key_size, data, data_size,
+		    cases[i].sha512);
+	}
+}
+
+/** Check a PBKDF2-HMAC-SHA1 known answer */
+static void test_pbkdf2_kat(const char *pass, size_t pass_size,
+    const char *salt, size_t salt_size, unsigned int iterations,
+    const char *dkhex)
+{
+	uint8_t exp[32];
+	uint8_t out[32];
+	size_t len;
+	errno_t rc;
+
+	len = test_unhex(dkhex, exp, sizeof(exp));
+
+	rc = pbkdf2_hmac(HASH_SHA1, (const uint8_t *) pass, pass_size,
+	    (const uint8_t *) salt, salt_size, iterations, out, len);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(out, exp, len));
+}
+
+/** RFC 6070 test vectors, except the one with 16777216 iterations */
+PCUT_TEST(pbkdf2_rfc6070)
+{
+	test_pbkdf2_kat("password", 8, "salt", 4, 1,
+	    "0c60c80f961f0e71f3a9b524af6012062fe037a6");
+	test_pbkdf2_kat("password", 8, "salt", 4, 2,
+	    "ea6c014dc72d6f8ccd1ed92ace1d41f0d8de8957");
+	test_pbkdf2_kat("password", 8, "salt", 4, 4096,
+	    "4b007901b765489abead49d926f721d065a429c1");
+	test_pbkdf2_kat("passwordPASSWORDpassword", 24,
+	    "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36, 4096,
+	    "3d2eec4fe41c849b80c8d83662c0e44a8b291a964cf2f07038");
+	test_pbkdf2_kat("pass\0word", 9, "sa\0lt", 5, 4096,
+	    "56fa6aa75548099dcc37d7f03425e0c3");
+}
+
+/** Fixed parameter interface (HMAC-SHA1, 4096 iterations, 32 bytes) */
+PCUT_TEST(pbkdf2_wpa)
+{
+	uint8_t exp[PBKDF2_KEY_LENGTH];
+	uint8_t out[PBKDF2_KEY_LENGTH];
+	errno_t rc;
+
+	test_unhex("4b007901b765489abead49d926f721d0"
+	    "65a429c12e463f6c4cd79401085b03db", exp, sizeof(exp));
+
+	rc = pbkdf2((uint8_t *) "password", 8, (uint8_t *) "salt", 4, out);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(out, exp, sizeof(exp)));
+}
+
+/** Zero iterations are rejected */
+PCUT_TEST(pbkdf2_no_iterations)
+{
+	uint8_t out[20];
+	errno_t rc;
+
+	rc = pbkdf2_hmac(HASH_SHA1, (const uint8_t *) "password", 8,
+	    (const uint8_t *) "salt", 4, 0, out, sizeof(out));
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+}
+
+PCUT_EXPORT(hash);
@@ -86,6 +86,7 @@ extern errno_t devman_driver_get_name(devman_handle_t, char *, size_t);
 extern errno_t devman_driver_get_state(devman_handle_t, driver_state_t *);
 extern errno_t devman_driver_load(devman_handle_t);
 extern errno_t devman_driver_unload(devman_handle_t);
+extern errno_t devman_get_boot_stats(devman_boot_stats_t *);
 
 #endif
 
@@ -37,6 +37,7 @@
 #include <ipc/common.h>
 #include <adt/list.h>
 #include <mem.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #define DEVMAN_NAME_MAXLEN  256
@@ -57,6 +58,36 @@ typedef enum {
 	DRIVER_RUNNING
 } driver_state_t;
 
+/** Device manager start-up phases */
+typedef enum {
+	/** Available drivers have been enumerated */
+	DEVMAN_BOOT_DRIVERS_FOUND = 0,
+	/** Root device has been created and its driver assigned */
+	DEVMAN_BOOT_TREE_INIT,
+	/** Device manager accepts connections */
+	DEVMAN_BOOT_ACCEPTING,
+	/** All devices found so far have been attached */
+	DEVMAN_BOOT_TREE_STABLE,
+
+	DEVMAN_BOOT_PHASES
+} devman_boot_phase_t;
+
+/** Device manager start-up statistics */
+typedef struct {
+	/** System uptime when the device manager started (usec) */
+	uint64_t start_usec;
+	/** Time of reaching each phase since start, zero if not reached (usec) */
+	uint64_t phase_usec[DEVMAN_BOOT_PHASES];
+	/** Time of the last successful device-add answer since start (usec) */
+	uint64_t last_dev_usec;
+	/** Number of driver tasks spawned */
+	uint32_t drivers_started;
+	/** Number of devices passed to drivers */
+	uint32_t devices_added;
+	/** Highest number of device-add requests in progress at once */
+	uint32_t max_parallel_adds;
+} devman_boot_stats_t;
+
 typedef enum {
 	/** Invalid value for debugging purposes */
 	fun_invalid = 0,
@@ -182,7 +213,8 @@ typedef enum {
 	DEVMAN_DRIVER_GET_NAME,
 	DEVMAN_DRIVER_GET_STATE,
 	DEVMAN_DRIVER_LOAD,
-	DEVMAN_DRIVER_UNLOAD
+	DEVMAN_DRIVER_UNLOAD,
+	DEVMAN_GET_BOOT_STATS
 } client_to_devman_t;
 
 #endif
@@ -779,5 +779,32 @@ errno_t devman_driver_unload(devman_handle_t drvh)
 	return rc;
 }
 
+/** Get device manager start-up statistics.
+ *
+ * @param stats Place to store the statistics
+ * @return EOK on success or an error code
+ */
+errno_t devman_get_boot_stats(devman_boot_stats_t *stats)
+{
+	async_exch_t *exch = devman_exchange_begin(INTERFACE_DDF_CLIENT);
+	if (exch == NULL)
+		return ENOMEM;
+
+	ipc_call_t answer;
+	aid_t req = async_send_0(exch, DEVMAN_GET_BOOT_STATS, &answer);
+	errno_t rc = async_data_read_start(exch, stats, sizeof(*stats));
+
+	devman_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+	return retval;
+}
+
 /** @}
  */
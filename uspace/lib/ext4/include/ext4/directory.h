@@ -66,7 +66,7 @@ extern errno_t ext4_directory_find_entry(ext4_directory_search_result_t *,
     ext4_inode_ref_t *, const char *);
 extern errno_t ext4_directory_remove_entry(ext4_inode_ref_t *, const char *);
 
-extern errno_t ext4_directory_try_insert_entry(ext4_superblock_t *, block_t *,
+extern errno_t ext4_directory_try_insert_entry(ext4_filesystem_t *, block_t *,
     ext4_inode_ref_t *, const char *, uint32_t);
 
 extern errno_t ext4_directory_find_in_block(block_t *, ext4_superblock_t *, size_t,
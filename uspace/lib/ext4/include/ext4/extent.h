@@ -65,6 +65,8 @@ extern errno_t ext4_extent_release_blocks_from(ext4_inode_ref_t *, uint32_t);
 
 extern errno_t ext4_extent_append_block(ext4_inode_ref_t *, uint32_t *, uint32_t *,
     bool);
+extern errno_t ext4_extent_append_blocks(ext4_inode_ref_t *, uint32_t,
+    uint32_t *, uint32_t *);
 
 #endif
 
@@ -47,8 +47,19 @@ typedef struct ext4_instance {
 	service_id_t service_id;
 	ext4_filesystem_t *filesystem;
 	unsigned int open_nodes_count;
+	list_t open_files;  /* Open counts of files (ext4_open_file_t) */
 } ext4_instance_t;
 
+/**
+ * Number of times a file is open. Kept separately from the node,
+ * which is released while the file stays open.
+ */
+typedef struct ext4_open_file {
+	link_t link;
+	fs_index_t index;
+	unsigned int count;
+} ext4_open_file_t;
+
 /**
  * Type for wrapping common fs_node and add some useful pointers.
  */
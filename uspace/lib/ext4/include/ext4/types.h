@@ -35,7 +35,10 @@
 #ifndef LIBEXT4_TYPES_H_
 #define LIBEXT4_TYPES_H_
 
+#include <adt/hash_table.h>
+#include <adt/list.h>
 #include <block.h>
+#include <fibril_synch.h>
 
 /*
  * Structure of the super block
@@ -215,6 +218,7 @@ typedef struct ext4_superblock {
 
 #define EXT4_FEATURE_INCOMPAT_SUPP \
 	(EXT4_FEATURE_INCOMPAT_FILETYPE | \
+	EXT4_FEATURE_INCOMPAT_RECOVER | \
 	EXT4_FEATURE_INCOMPAT_EXTENTS | \
 	EXT4_FEATURE_INCOMPAT_64BIT | \
 	EXT4_FEATURE_INCOMPAT_FLEX_BG)
@@ -227,13 +231,40 @@ typedef struct ext4_superblock {
 	EXT4_FEATURE_RO_COMPAT_GDT_CSUM | \
 	EXT4_FEATURE_RO_COMPAT_EXTRA_ISIZE)
 
+struct ext4_journal;
+
+/*
+ * In-memory summary of free space in a block group
+ */
+typedef struct ext4_group_summary {
+	uint32_t free_blocks;  /* Free blocks count */
+	uint32_t free_inodes;  /* Free i-nodes count */
+	uint32_t max_run;      /* Upper bound of the longest free block run */
+} ext4_group_summary_t;
+
 typedef struct ext4_filesystem {
 	service_id_t device;
 	ext4_superblock_t *superblock;
 	aoff64_t inode_block_limits[4];
 	aoff64_t inode_blocks_per_level[4];
+	list_t prealloc;          /* Per-inode preallocations, most recent first */
+	unsigned prealloc_count;  /* Number of entries in prealloc */
+	struct ext4_journal *journal;  /* Metadata journal or NULL */
+	ext4_group_summary_t *group_summary;  /* Free space of each group */
 } ext4_filesystem_t;
 
+/*
+ * Blocks reserved for future appends to an i-node. The reservation only
+ * exists in memory: the blocks stay free on disk until they are handed
+ * to the i-node, the allocator just avoids them meanwhile.
+ */
+typedef struct ext4_prealloc {
+	link_t link;
+	uint32_t index;  /* I-node number */
+	uint32_t start;  /* First preallocated block */
+	uint32_t count;  /* Number of preallocated blocks */
+} ext4_prealloc_t;
+
 /** Size of buffer for volume name. To hold 16 latin-1 chars encoded as UTF-8
  * and a null terminator we need 2 * 16 + 1 bytes
  */
@@ -557,6 +588,149 @@ typedef struct ext4_hash_info {
 	const uint32_t *seed;
 } ext4_hash_info_t;
 
+/*
+ * JBD2 journal structures, all fields are big-endian
+ */
+#define EXT4_JOURNAL_MAGIC  0xC03B3998U
+
+#define EXT4_JOURNAL_BT_DESCRIPTOR  1
+#define EXT4_JOURNAL_BT_COMMIT      2
+#define EXT4_JOURNAL_BT_SB_V1       3
+#define EXT4_JOURNAL_BT_SB_V2       4
+#define EXT4_JOURNAL_BT_REVOKE      5
+
+#define EXT4_JOURNAL_FLAG_ESCAPE     0x1  /* First word of block was magic */
+#define EXT4_JOURNAL_FLAG_SAME_UUID  0x2  /* No UUID follows the tag */
+#define EXT4_JOURNAL_FLAG_DELETED    0x4
+#define EXT4_JOURNAL_FLAG_LAST_TAG   0x8  /* Last tag in the descriptor */
+
+#define EXT4_JOURNAL_FEATURE_COMPAT_CHECKSUM      0x0001
+#define EXT4_JOURNAL_FEATURE_INCOMPAT_REVOKE      0x0001
+#define EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT       0x0002
+#define EXT4_JOURNAL_FEATURE_INCOMPAT_ASYNC_COMMIT 0x0004
+#define EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V2     0x0008
+#define EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V3     0x0010
+#define EXT4_JOURNAL_FEATURE_INCOMPAT_FAST_COMMIT 0x0020
+
+typedef struct ext4_journal_header {
+	uint32_t magic;
+	uint32_t blocktype;
+	uint32_t sequence;  /* Transaction ID */
+} ext4_journal_header_t;
+
+typedef struct ext4_journal_sb {
+	ext4_journal_header_t header;
+	uint32_t blocksize;          /* Journal device block size */
+	uint32_t maxlen;             /* Total blocks in journal */
+	uint32_t first;              /* First block of log information */
+	uint32_t sequence;           /* First commit ID expected in log */
+	uint32_t start;              /* Block number of start of log, 0 if clean */
+	uint32_t error;
+	uint32_t feature_compat;
+	uint32_t feature_incompat;
+	uint32_t feature_ro_compat;
+	uint8_t uuid[16];
+	uint32_t nr_users;
+	uint32_t dynsuper;
+	uint32_t max_transaction;
+	uint32_t max_trans_data;
+	uint8_t checksum_type;
+	uint8_t padding2[3];
+	uint32_t num_fc_blocks;
+	uint32_t head;
+	uint32_t padding[40];
+	uint32_t checksum;
+	uint8_t users[16 * 48];
+} ext4_journal_sb_t;
+
+/* Tag in a descriptor block of a journal without checksums */
+typedef struct ext4_journal_tag {
+	uint32_t blocknr;
+	uint16_t checksum;
+	uint16_t flags;
+	uint32_t blocknr_high;  /* Only if the 64bit feature is set */
+} ext4_journal_tag_t;
+
+/* Tag in a descriptor block of a journal with v3 checksums */
+typedef struct ext4_journal_tag3 {
+	uint32_t blocknr;
+	uint32_t flags;
+	uint32_t blocknr_high;
+	uint32_t checksum;
+} ext4_journal_tag3_t;
+
+typedef struct ext4_journal_revoke_header {
+	ext4_journal_header_t header;
+	uint32_t count;  /* Bytes used in the block, including the header */
+} ext4_journal_revoke_header_t;
+
+/*
+ * Metadata block modified by a transaction. The journal holds a reference
+ * to the block until it has been written to its home location. Blocks freed
+ * after being logged stay in the table unpinned, so that the log copies can
+ * be revoked should the block be freed again.
+ */
+typedef struct ext4_journal_block {
+	ht_link_t link;    /* Link in journal->blocks */
+	link_t tlink;      /* Link in journal->running or journal->checkpoint */
+	aoff64_t lba;      /* Block address */
+	block_t *block;    /* Pinned block or NULL if the block was freed */
+	uint32_t tid;      /* Last transaction that modified the block */
+	uint32_t rtid;     /* Last transaction that revoked the block */
+	bool logged;       /* A copy of the block is in the log */
+	bool revoked;      /* The block was revoked by transaction rtid */
+} ext4_journal_block_t;
+
+/*
+ * Blocks freed by the running transaction. They are not allocated again
+ * until the transaction commits, so that neither replay of older log copies
+ * nor the old metadata still on the device can clobber a reused block.
+ */
+typedef struct ext4_journal_freed {
+	link_t link;       /* Link in journal->freed */
+	uint32_t start;    /* First freed block */
+	uint32_t count;    /* Number of freed blocks */
+} ext4_journal_freed_t;
+
+typedef struct ext4_journal {
+	ext4_filesystem_t *fs;
+	ext4_journal_sb_t *sb;    /* Copy of the journal superblock */
+	uint32_t *map;            /* Home block of each journal block */
+	uint32_t maxlen;          /* Journal length in blocks */
+	uint32_t first;           /* First log block */
+	uint32_t block_size;
+	size_t dev_blocks;        /* Device blocks per file system block */
+	size_t tag_size;          /* Size of a descriptor tag */
+	uint32_t compat;          /* Compatible journal features */
+	uint32_t incompat;        /* Incompatible journal features */
+
+	uint32_t tid;             /* ID of the running transaction */
+	uint32_t head;            /* Next free log block */
+	uint32_t used;            /* Log blocks holding live transactions */
+
+	hash_table_t blocks;      /* Pinned blocks by address */
+	list_t running;           /* Blocks modified by running transaction */
+	list_t checkpoint;        /* Committed blocks not yet written home */
+	size_t running_count;
+	size_t checkpoint_count;
+	uint32_t *revoked;        /* Blocks revoked by running transaction */
+	size_t revoked_count;
+	size_t revoked_size;
+	list_t freed;             /* Blocks freed by running transaction */
+
+	uint8_t *iobuf;           /* Buffer for coalescing log writes */
+	uint32_t iobuf_start;     /* First log block in iobuf */
+	size_t iobuf_count;       /* Number of blocks in iobuf */
+
+	fibril_mutex_t lock;
+	fibril_condvar_t cv;      /* Signalled when handles or commit finish */
+	fibril_condvar_t timer_cv;
+	unsigned handles;         /* Number of running handles */
+	bool committing;
+	bool stop;                /* Commit fibril should terminate */
+	bool fibril_running;
+} ext4_journal_t;
+
 #endif
 
 /**
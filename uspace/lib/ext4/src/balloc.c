@@ -36,16 +36,31 @@
  */
 
 #include <errno.h>
+#include <macros.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include "ext4/balloc.h"
 #include "ext4/bitmap.h"
 #include "ext4/block_group.h"
 #include "ext4/filesystem.h"
 #include "ext4/inode.h"
+#include "ext4/journal.h"
 #include "ext4/superblock.h"
 #include "ext4/types.h"
 
+/** Smallest number of blocks preallocated for a regular file */
+#define EXT4_PREALLOC_MIN_BLOCKS  16
+
+/** Largest number of blocks preallocated for a regular file */
+#define EXT4_PREALLOC_MAX_BLOCKS  1024
+
+/** Maximum number of i-nodes with preallocated blocks */
+#define EXT4_PREALLOC_MAX_INODES  32
+
+/** Free runs shorter than this are only used if nothing better exists */
+#define EXT4_BALLOC_GOOD_RUN  16
+
 /** Free block.
  *
  * @param inode_ref  Inode, where the block is allocated
@@ -64,9 +79,14 @@ errno_t ext4_balloc_free_block(ext4_inode_ref_t *inode_ref, uint32_t block_addr)
 	uint32_t index_in_group =
 	    ext4_filesystem_blockaddr2_index_in_group(sb, block_addr);
 
+	/* Journaled copies of the block must not be replayed */
+	errno_t rc = ext4_journal_revoke(fs, block_addr, 1);
+	if (rc != EOK)
+		return rc;
+
 	/* Load block group reference */
 	ext4_block_group_ref_t *bg_ref;
-	errno_t rc = ext4_filesystem_get_block_group_ref(fs, block_group, &bg_ref);
+	rc = ext4_filesystem_get_block_group_ref(fs, block_group, &bg_ref);
 	if (rc != EOK)
 		return rc;
 
@@ -82,7 +102,7 @@ errno_t ext4_balloc_free_block(ext4_inode_ref_t *inode_ref, uint32_t block_addr)
 
 	/* Modify bitmap */
 	ext4_bitmap_free_bit(bitmap_block->data, index_in_group);
-	bitmap_block->dirty = true;
+	ext4_journal_dirty(fs, bitmap_block);
 
 	/* Release block with bitmap */
 	rc = block_put(bitmap_block);
@@ -119,10 +139,19 @@ errno_t ext4_balloc_free_block(ext4_inode_ref_t *inode_ref, uint32_t block_addr)
 	return ext4_filesystem_put_block_group_ref(bg_ref);
 }
 
-static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
-    uint32_t first, uint32_t count)
+/** Free continuous set of blocks within one block group.
+ *
+ * @param fs        Filesystem
+ * @param inode_ref Inode owning the blocks
+ * @param first     First block to release
+ * @param count     Number of blocks to release
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_balloc_free_blocks_internal(ext4_filesystem_t *fs,
+    ext4_inode_ref_t *inode_ref, uint32_t first, uint32_t count)
 {
-	ext4_filesystem_t *fs = inode_ref->fs;
 	ext4_superblock_t *sb = fs->superblock;
 
 	/* Compute indexes */
@@ -133,9 +162,14 @@ static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
 
 	assert(block_group_first == block_group_last);
 
+	/* Journaled copies of the blocks must not be replayed */
+	errno_t rc = ext4_journal_revoke(fs, first, count);
+	if (rc != EOK)
+		return rc;
+
 	/* Load block group reference */
 	ext4_block_group_ref_t *bg_ref;
-	errno_t rc = ext4_filesystem_get_block_group_ref(fs, block_group_first, &bg_ref);
+	rc = ext4_filesystem_get_block_group_ref(fs, block_group_first, &bg_ref);
 	if (rc != EOK)
 		return rc;
 
@@ -155,7 +189,7 @@ static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
 
 	/* Modify bitmap */
 	ext4_bitmap_free_bits(bitmap_block->data, index_in_group_first, count);
-	bitmap_block->dirty = true;
+	ext4_journal_dirty(fs, bitmap_block);
 
 	/* Release block with bitmap */
 	rc = block_put(bitmap_block);
@@ -220,7 +254,7 @@ errno_t ext4_balloc_free_blocks(ext4_inode_ref_t *inode_ref,
 			 */
 			uint32_t s = limit - first;
 
-			r = ext4_balloc_free_blocks_internal(inode_ref,
+			r = ext4_balloc_free_blocks_internal(fs, inode_ref,
 			    first, s);
 			if (r != EOK)
 				return r;
@@ -228,7 +262,7 @@ errno_t ext4_balloc_free_blocks(ext4_inode_ref_t *inode_ref,
 			first = limit;
 			count -= s;
 		} else {
-			return ext4_balloc_free_blocks_internal(inode_ref,
+			return ext4_balloc_free_blocks_internal(fs, inode_ref,
 			    first, count);
 		}
 	}
@@ -335,283 +369,656 @@ static errno_t ext4_balloc_find_goal(ext4_inode_ref_t *inode_ref, uint32_t *goal
 	return ext4_filesystem_put_block_group_ref(bg_ref);
 }
 
-/** Data block allocation algorithm.
+/** Check whether a block group surely lacks a free run of given length.
  *
- * @param inode_ref Inode to allocate block for
- * @param fblock    Allocated block address
+ * Uses only the in-memory group summary, so no descriptor is read.
  *
- * @return Error code
+ * @param fs   Filesystem
+ * @param bgid Block group index
+ * @param need Length of the run
+ *
+ * @return True if the group can be skipped
  *
  */
-errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
+static bool ext4_balloc_group_lacks_run(ext4_filesystem_t *fs, uint32_t bgid,
+    uint32_t need)
 {
-	uint32_t allocated_block = 0;
+	if (fs->group_summary == NULL)
+		return false;
 
-	uint32_t bitmap_block_addr;
-	block_t *bitmap_block;
-	uint32_t rel_block_idx = 0;
-	uint32_t free_blocks;
-	uint32_t goal;
-	uint32_t block_size;
-
-	/* Find GOAL */
-	errno_t rc = ext4_balloc_find_goal(inode_ref, &goal);
-	if (rc != EOK)
-		return rc;
+	return fs->group_summary[bgid].max_run < need;
+}
 
+/** Account newly allocated blocks to an inode.
+ *
+ * @param inode_ref Inode the blocks were allocated for
+ * @param count     Number of blocks
+ *
+ */
+static void ext4_balloc_inode_add_blocks(ext4_inode_ref_t *inode_ref,
+    uint32_t count)
+{
 	ext4_superblock_t *sb = inode_ref->fs->superblock;
+	uint32_t block_size = ext4_superblock_get_block_size(sb);
 
-	/* Load block group number for goal and relative index */
-	uint32_t block_group = ext4_filesystem_blockaddr2group(sb, goal);
-	uint32_t index_in_group =
-	    ext4_filesystem_blockaddr2_index_in_group(sb, goal);
-
-	/* Load block group reference */
-	ext4_block_group_ref_t *bg_ref;
-	rc = ext4_filesystem_get_block_group_ref(inode_ref->fs,
-	    block_group, &bg_ref);
-	if (rc != EOK)
-		return rc;
+	/* Update inode blocks (different block size!) count */
+	uint64_t ino_blocks =
+	    ext4_inode_get_blocks_count(sb, inode_ref->inode);
+	ino_blocks += count * (block_size / EXT4_INODE_BLOCK_SIZE);
+	ext4_inode_set_blocks_count(sb, inode_ref->inode, ino_blocks);
+	inode_ref->dirty = true;
+}
 
-	free_blocks =
-	    ext4_block_group_get_free_blocks_count(bg_ref->block_group, sb);
-	if (free_blocks == 0) {
-		/* This group has no free blocks */
-		goto goal_failed;
+/** Find preallocation of an inode.
+ *
+ * @param fs    Filesystem
+ * @param index I-node number
+ *
+ * @return Preallocation or NULL if the inode has none
+ *
+ */
+static ext4_prealloc_t *ext4_balloc_prealloc_find(ext4_filesystem_t *fs,
+    uint32_t index)
+{
+	list_foreach(fs->prealloc, link, ext4_prealloc_t, pa) {
+		if (pa->index == index)
+			return pa;
 	}
 
-	/* Compute indexes */
-	uint32_t first_in_group =
-	    ext4_balloc_get_first_data_block_in_group(sb, bg_ref);
+	return NULL;
+}
 
-	uint32_t first_in_group_index =
-	    ext4_filesystem_blockaddr2_index_in_group(sb, first_in_group);
+/** Destroy preallocation entry.
+ *
+ * Preallocated blocks are only reserved in memory, so nothing needs to be
+ * written. The block group summary may have been lowered while the window
+ * was hiding the blocks, so it is reset to the group's free block count.
+ *
+ * @param fs Filesystem
+ * @param pa Preallocation, must be already removed from the list
+ *
+ */
+static void ext4_balloc_prealloc_release(ext4_filesystem_t *fs,
+    ext4_prealloc_t *pa)
+{
+	if (fs->group_summary != NULL && pa->count > 0) {
+		uint32_t bgid = ext4_filesystem_blockaddr2group(fs->superblock,
+		    pa->start);
+		fs->group_summary[bgid].max_run =
+		    fs->group_summary[bgid].free_blocks;
+	}
 
-	if (index_in_group < first_in_group_index)
-		index_in_group = first_in_group_index;
+	free(pa);
+}
 
-	/* Load block with bitmap */
-	bitmap_block_addr =
-	    ext4_block_group_get_block_bitmap(bg_ref->block_group, sb);
+/** Discard preallocated blocks of an inode.
+ *
+ * Needs to be called whenever the inode is truncated or when the
+ * preallocation is not going to be used anymore (file is closed).
+ *
+ * @param fs    Filesystem
+ * @param index I-node number
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_balloc_discard_prealloc(ext4_filesystem_t *fs, uint32_t index)
+{
+	ext4_prealloc_t *pa = ext4_balloc_prealloc_find(fs, index);
+	if (pa == NULL)
+		return EOK;
 
-	rc = block_get(&bitmap_block, inode_ref->fs->device,
-	    bitmap_block_addr, BLOCK_FLAGS_NONE);
-	if (rc != EOK) {
-		ext4_filesystem_put_block_group_ref(bg_ref);
-		return rc;
-	}
+	list_remove(&pa->link);
+	fs->prealloc_count--;
 
-	/* Check if goal is free */
-	if (ext4_bitmap_is_free_bit(bitmap_block->data, index_in_group)) {
-		ext4_bitmap_set_bit(bitmap_block->data, index_in_group);
-		bitmap_block->dirty = true;
-		rc = block_put(bitmap_block);
-		if (rc != EOK) {
-			ext4_filesystem_put_block_group_ref(bg_ref);
-			return rc;
-		}
+	ext4_balloc_prealloc_release(fs, pa);
+	return EOK;
+}
 
-		allocated_block =
-		    ext4_filesystem_index_in_group2blockaddr(sb, index_in_group,
-		    block_group);
+/** Discard preallocated blocks of all inodes.
+ *
+ * @param fs Filesystem
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_balloc_discard_all_prealloc(ext4_filesystem_t *fs)
+{
+	while (!list_empty(&fs->prealloc)) {
+		ext4_prealloc_t *pa = list_get_instance(
+		    list_first(&fs->prealloc), ext4_prealloc_t, link);
+		list_remove(&pa->link);
+		fs->prealloc_count--;
 
-		goto success;
+		ext4_balloc_prealloc_release(fs, pa);
 	}
 
-	uint32_t blocks_in_group =
-	    ext4_superblock_get_blocks_in_group(sb, block_group);
+	return EOK;
+}
 
-	uint32_t end_idx = (index_in_group + 63) & ~63;
-	if (end_idx > blocks_in_group)
-		end_idx = blocks_in_group;
+/** Clip a run of free blocks by reservations.
+ *
+ * Blocks in preallocation windows and blocks freed by the running journal
+ * transaction are reserved.
+ *
+ * @param fs   Filesystem
+ * @param addr First block of the run
+ * @param len  Length of the run
+ * @param skip Output value - if the first block is reserved, number of
+ *             blocks until the end of the reservation
+ *
+ * @return Number of blocks starting at @a addr that are not reserved
+ *
+ */
+static uint32_t ext4_balloc_unreserved(ext4_filesystem_t *fs, uint32_t addr,
+    uint32_t len, uint32_t *skip)
+{
+	list_foreach(fs->prealloc, link, ext4_prealloc_t, pa) {
+		if (pa->count == 0)
+			continue;
 
-	/* Try to find free block near to goal */
-	for (uint32_t tmp_idx = index_in_group + 1; tmp_idx < end_idx;
-	    ++tmp_idx) {
-		if (ext4_bitmap_is_free_bit(bitmap_block->data, tmp_idx)) {
-			ext4_bitmap_set_bit(bitmap_block->data, tmp_idx);
-			bitmap_block->dirty = true;
-			rc = block_put(bitmap_block);
-			if (rc != EOK)
-				return rc;
+		if (pa->start <= addr && addr < pa->start + pa->count) {
+			*skip = pa->start + pa->count - addr;
+			return 0;
+		}
+
+		if (addr < pa->start && pa->start < addr + len)
+			len = pa->start - addr;
+	}
 
-			allocated_block =
-			    ext4_filesystem_index_in_group2blockaddr(sb, tmp_idx,
-			    block_group);
+	return ext4_journal_clip_freed(fs, addr, len, skip);
+}
+
+/** Find the longest free run within part of a block bitmap.
+ *
+ * Reserved blocks count as used. The search stops early
+ * once a run of at least @a want blocks is found.
+ *
+ * @param fs     Filesystem
+ * @param bgid   Block group index
+ * @param bitmap Block bitmap
+ * @param from   First index to search
+ * @param to     Index after the last index to search
+ * @param want   Number of blocks needed
+ * @param start  Output value - first index of the run
+ *
+ * @return Length of the run (at most @a want), 0 if there is no free block
+ *
+ */
+static uint32_t ext4_balloc_find_run(ext4_filesystem_t *fs, uint32_t bgid,
+    uint8_t *bitmap, uint32_t from, uint32_t to, uint32_t want,
+    uint32_t *start)
+{
+	uint32_t best_len = 0;
+	uint32_t idx = from;
+	uint32_t skip;
+
+	while (idx < to) {
+		if (ext4_bitmap_find_free_bit(bitmap, idx, &idx, to) != EOK)
+			break;
+
+		uint32_t len = ext4_bitmap_free_run(bitmap, idx,
+		    min(to, idx + want));
+		len = ext4_balloc_unreserved(fs,
+		    ext4_filesystem_index_in_group2blockaddr(fs->superblock,
+		    idx, bgid), len, &skip);
+		if (len == 0) {
+			idx += skip;
+			continue;
+		}
 
-			goto success;
+		if (len > best_len) {
+			best_len = len;
+			*start = idx;
+			if (len >= want)
+				break;
 		}
+
+		idx += len;
 	}
 
-	/* Find free BYTE in bitmap */
-	rc = ext4_bitmap_find_free_byte_and_set_bit(bitmap_block->data,
-	    index_in_group, &rel_block_idx, blocks_in_group);
-	if (rc == EOK) {
-		bitmap_block->dirty = true;
-		rc = block_put(bitmap_block);
-		if (rc != EOK)
-			return rc;
+	return best_len;
+}
 
-		allocated_block =
-		    ext4_filesystem_index_in_group2blockaddr(sb, rel_block_idx,
-		    block_group);
+/** Mark blocks as used.
+ *
+ * Updates the block bitmap, group descriptor and superblock.
+ *
+ * @param fs           Filesystem
+ * @param bg_ref       Block group of the blocks
+ * @param bitmap_block Block with the group's block bitmap
+ * @param index        Index of the first block in group
+ * @param count        Number of blocks
+ *
+ */
+static void ext4_balloc_mark_used(ext4_filesystem_t *fs,
+    ext4_block_group_ref_t *bg_ref, block_t *bitmap_block, uint32_t index,
+    uint32_t count)
+{
+	ext4_superblock_t *sb = fs->superblock;
 
-		goto success;
-	}
+	/* Modify bitmap */
+	ext4_bitmap_set_bits(bitmap_block->data, index, count);
+	ext4_journal_dirty(fs, bitmap_block);
 
-	/* Find free bit in bitmap */
-	rc = ext4_bitmap_find_free_bit_and_set(bitmap_block->data,
-	    index_in_group, &rel_block_idx, blocks_in_group);
-	if (rc == EOK) {
-		bitmap_block->dirty = true;
-		rc = block_put(bitmap_block);
-		if (rc != EOK)
-			return rc;
+	/* Update superblock free blocks count */
+	uint32_t sb_free_blocks = ext4_superblock_get_free_blocks_count(sb);
+	sb_free_blocks -= count;
+	ext4_superblock_set_free_blocks_count(sb, sb_free_blocks);
 
-		allocated_block =
-		    ext4_filesystem_index_in_group2blockaddr(sb, rel_block_idx,
-		    block_group);
+	/* Update block group free blocks count */
+	uint32_t free_blocks =
+	    ext4_block_group_get_free_blocks_count(bg_ref->block_group, sb);
+	free_blocks -= count;
+	ext4_block_group_set_free_blocks_count(bg_ref->block_group, sb,
+	    free_blocks);
+	bg_ref->dirty = true;
+}
 
-		goto success;
-	}
+/** Take blocks from a preallocation window.
+ *
+ * The window is only reserved in memory. Allocators that do not know
+ * about windows (ext4_balloc_try_alloc_block()) may have taken some of its
+ * blocks in the meantime and the blocks may even have been freed again by
+ * the running journal transaction, so only the free blocks at the start of
+ * the window that can be reused are taken.
+ *
+ * @param fs    Filesystem
+ * @param first First block
+ * @param want  Number of blocks wanted
+ * @param count Output value - number of blocks taken (0 to @a want)
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_balloc_claim_run(ext4_filesystem_t *fs, uint32_t first,
+    uint32_t want, uint32_t *count)
+{
+	ext4_superblock_t *sb = fs->superblock;
+	uint32_t bgid = ext4_filesystem_blockaddr2group(sb, first);
+	uint32_t index = ext4_filesystem_blockaddr2_index_in_group(sb, first);
+	errno_t rc;
 
-	/* No free block found yet */
-	rc = block_put(bitmap_block);
+	ext4_block_group_ref_t *bg_ref;
+	rc = ext4_filesystem_get_block_group_ref(fs, bgid, &bg_ref);
+	if (rc != EOK)
+		return rc;
+
+	/* Load block with bitmap */
+	uint32_t bitmap_block_addr =
+	    ext4_block_group_get_block_bitmap(bg_ref->block_group, sb);
+	block_t *bitmap_block;
+	rc = block_get(&bitmap_block, fs->device, bitmap_block_addr,
+	    BLOCK_FLAGS_NONE);
 	if (rc != EOK) {
 		ext4_filesystem_put_block_group_ref(bg_ref);
 		return rc;
 	}
 
-goal_failed:
+	uint32_t skip;
+	uint32_t n = ext4_bitmap_free_run(bitmap_block->data, index,
+	    index + want);
+	n = ext4_journal_clip_freed(fs, first, n, &skip);
+	if (n > 0)
+		ext4_balloc_mark_used(fs, bg_ref, bitmap_block, index, n);
 
-	rc = ext4_filesystem_put_block_group_ref(bg_ref);
-	if (rc != EOK)
+	rc = block_put(bitmap_block);
+	if (rc != EOK) {
+		ext4_filesystem_put_block_group_ref(bg_ref);
 		return rc;
+	}
 
-	/* Try other block groups */
+	*count = n;
+	return ext4_filesystem_put_block_group_ref(bg_ref);
+}
+
+/** Allocate a run of contiguous blocks.
+ *
+ * The run starts at @a goal if that block is free. Otherwise the goal
+ * group and then the following groups are searched for a run of at least
+ * @a want blocks. If there is none, a run of EXT4_BALLOC_GOOD_RUN blocks is
+ * accepted and only then any free block. Reserved blocks (see
+ * ext4_balloc_unreserved()) are not used.
+ *
+ * Only the first @a mark blocks of the run are marked as used in
+ * the bitmap, group descriptor and superblock. They are not accounted
+ * to any inode.
+ *
+ * @param fs    Filesystem
+ * @param goal  Preferred first block
+ * @param want  Preferred number of blocks
+ * @param mark  Number of blocks to mark as used
+ * @param first Output value - first block of the run
+ * @param count Output value - length of the run (1 to @a want)
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_balloc_alloc_run(ext4_filesystem_t *fs, uint32_t goal,
+    uint32_t want, uint32_t mark, uint32_t *first, uint32_t *count)
+{
+	ext4_superblock_t *sb = fs->superblock;
 	uint32_t block_group_count = ext4_superblock_get_block_group_count(sb);
+	uint32_t goal_group = ext4_filesystem_blockaddr2group(sb, goal);
+	uint32_t goal_index =
+	    ext4_filesystem_blockaddr2_index_in_group(sb, goal);
+	errno_t rc;
 
-	uint32_t bgid = (block_group + 1) % block_group_count;
-	uint32_t count = block_group_count;
+	if (goal_group >= block_group_count) {
+		goal_group = 0;
+		goal_index = 0;
+	}
 
-	while (count > 0) {
-		rc = ext4_filesystem_get_block_group_ref(inode_ref->fs, bgid,
-		    &bg_ref);
-		if (rc != EOK)
-			return rc;
+	/*
+	 * Pass 0 wants the whole run, pass 1 a reasonably long run and
+	 * pass 2 takes whatever is left.
+	 */
+	for (unsigned pass = 0; pass < 3; pass++) {
+		uint32_t need = want;
+		if (pass == 1)
+			need = min(want, EXT4_BALLOC_GOOD_RUN);
+		else if (pass == 2)
+			need = 1;
+
+		uint32_t bgid = goal_group;
+		for (uint32_t i = 0; i < block_group_count; i++) {
+			if ((pass != 0 || bgid != goal_group) &&
+			    ext4_balloc_group_lacks_run(fs, bgid, need)) {
+				bgid = (bgid + 1) % block_group_count;
+				continue;
+			}
 
-		free_blocks =
-		    ext4_block_group_get_free_blocks_count(bg_ref->block_group, sb);
-		if (free_blocks == 0) {
-			/* This group has no free blocks */
-			goto next_group;
-		}
+			ext4_block_group_ref_t *bg_ref;
+			rc = ext4_filesystem_get_block_group_ref(fs, bgid,
+			    &bg_ref);
+			if (rc != EOK)
+				return rc;
 
-		/* Load block with bitmap */
-		bitmap_block_addr =
-		    ext4_block_group_get_block_bitmap(bg_ref->block_group, sb);
+			uint32_t free_blocks =
+			    ext4_block_group_get_free_blocks_count(
+			    bg_ref->block_group, sb);
+			if (free_blocks == 0 || (free_blocks < need &&
+			    (pass != 0 || bgid != goal_group)))
+				goto next_group;
+
+			/* Load block with bitmap */
+			uint32_t bitmap_block_addr =
+			    ext4_block_group_get_block_bitmap(
+			    bg_ref->block_group, sb);
+			block_t *bitmap_block;
+			rc = block_get(&bitmap_block, fs->device,
+			    bitmap_block_addr, BLOCK_FLAGS_NONE);
+			if (rc != EOK) {
+				ext4_filesystem_put_block_group_ref(bg_ref);
+				return rc;
+			}
 
-		rc = block_get(&bitmap_block, inode_ref->fs->device,
-		    bitmap_block_addr, 0);
-		if (rc != EOK) {
-			ext4_filesystem_put_block_group_ref(bg_ref);
-			return rc;
-		}
+			/* Compute indexes */
+			uint32_t first_in_group =
+			    ext4_balloc_get_first_data_block_in_group(sb,
+			    bg_ref);
+			uint32_t first_index =
+			    ext4_filesystem_blockaddr2_index_in_group(sb,
+			    first_in_group);
+			uint32_t blocks_in_group =
+			    ext4_superblock_get_blocks_in_group(sb, bgid);
+
+			uint32_t start_index = first_index;
+			if (bgid == goal_group && goal_index > start_index)
+				start_index = goal_index;
+
+			uint32_t run_index = 0;
+			uint32_t run_len = 0;
+			uint32_t skip;
+
+			/* Take whatever is free at the goal itself */
+			if (bgid == goal_group && pass == 0 &&
+			    start_index < blocks_in_group &&
+			    ext4_bitmap_is_free_bit(bitmap_block->data,
+			    start_index)) {
+				run_index = start_index;
+				run_len = ext4_bitmap_free_run(
+				    bitmap_block->data, start_index,
+				    min(blocks_in_group, start_index + want));
+				run_len = ext4_balloc_unreserved(fs,
+				    ext4_filesystem_index_in_group2blockaddr(sb,
+				    start_index, bgid), run_len, &skip);
+			}
 
-		/* Compute indexes */
-		first_in_group =
-		    ext4_balloc_get_first_data_block_in_group(sb, bg_ref);
-		index_in_group =
-		    ext4_filesystem_blockaddr2_index_in_group(sb, first_in_group);
-		blocks_in_group = ext4_superblock_get_blocks_in_group(sb, bgid);
+			if (run_len > 0) {
+				need = 1;
+			} else {
+				run_len = ext4_balloc_find_run(fs, bgid,
+				    bitmap_block->data, start_index,
+				    blocks_in_group, want, &run_index);
+				if (run_len < need && start_index > first_index) {
+					uint32_t idx;
+					uint32_t len = ext4_balloc_find_run(fs,
+					    bgid, bitmap_block->data,
+					    first_index, start_index, want,
+					    &idx);
+					if (len > run_len) {
+						run_len = len;
+						run_index = idx;
+					}
+				}
+			}
 
-		first_in_group_index =
-		    ext4_filesystem_blockaddr2_index_in_group(sb, first_in_group);
+			if (run_len < need) {
+				/* Remember the longest run of a fully searched group */
+				if (run_len < want && start_index == first_index &&
+				    fs->group_summary != NULL)
+					fs->group_summary[bgid].max_run = run_len;
+
+				rc = block_put(bitmap_block);
+				if (rc != EOK) {
+					ext4_filesystem_put_block_group_ref(
+					    bg_ref);
+					return rc;
+				}
+				goto next_group;
+			}
 
-		if (index_in_group < first_in_group_index)
-			index_in_group = first_in_group_index;
+			ext4_balloc_mark_used(fs, bg_ref, bitmap_block,
+			    run_index, min(run_len, mark));
 
-		/* Try to find free byte in bitmap */
-		rc = ext4_bitmap_find_free_byte_and_set_bit(bitmap_block->data,
-		    index_in_group, &rel_block_idx, blocks_in_group);
-		if (rc == EOK) {
-			bitmap_block->dirty = true;
 			rc = block_put(bitmap_block);
 			if (rc != EOK) {
 				ext4_filesystem_put_block_group_ref(bg_ref);
 				return rc;
 			}
 
-			allocated_block =
-			    ext4_filesystem_index_in_group2blockaddr(sb, rel_block_idx,
-			    bgid);
+			*first = ext4_filesystem_index_in_group2blockaddr(sb,
+			    run_index, bgid);
+			*count = run_len;
 
-			goto success;
-		}
+			return ext4_filesystem_put_block_group_ref(bg_ref);
 
-		/* Try to find free bit in bitmap */
-		rc = ext4_bitmap_find_free_bit_and_set(bitmap_block->data,
-		    index_in_group, &rel_block_idx, blocks_in_group);
-		if (rc == EOK) {
-			bitmap_block->dirty = true;
-			rc = block_put(bitmap_block);
-			if (rc != EOK) {
-				ext4_filesystem_put_block_group_ref(bg_ref);
+		next_group:
+			rc = ext4_filesystem_put_block_group_ref(bg_ref);
+			if (rc != EOK)
 				return rc;
-			}
-
-			allocated_block =
-			    ext4_filesystem_index_in_group2blockaddr(sb, rel_block_idx,
-			    bgid);
 
-			goto success;
+			bgid = (bgid + 1) % block_group_count;
 		}
+	}
+
+	return ENOSPC;
+}
+
+/** Block allocation algorithm.
+ *
+ * Allocates a single block, e.g. for metadata, near the end of the inode.
+ *
+ * @param inode_ref Inode to allocate block for
+ * @param fblock    Allocated block address
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+	uint32_t goal;
+	uint32_t count;
+
+	/* Find GOAL */
+	errno_t rc = ext4_balloc_find_goal(inode_ref, &goal);
+	if (rc != EOK)
+		return rc;
 
-		rc = block_put(bitmap_block);
-		if (rc != EOK) {
-			ext4_filesystem_put_block_group_ref(bg_ref);
+	rc = ext4_balloc_alloc_run(fs, goal, 1, 1, fblock, &count);
+	if (rc == ENOSPC && !list_empty(&fs->prealloc)) {
+		/* Reclaim preallocations and retry */
+		rc = ext4_balloc_discard_all_prealloc(fs);
+		if (rc != EOK)
 			return rc;
+		rc = ext4_balloc_alloc_run(fs, goal, 1, 1, fblock, &count);
+	}
+	if (rc != EOK)
+		return rc;
+
+	ext4_balloc_inode_add_blocks(inode_ref, 1);
+	return EOK;
+}
+
+/** Multiple block allocation algorithm.
+ *
+ * Allocates a run of physically contiguous blocks for an inode, preferably
+ * starting at @a goal. Blocks preallocated for the inode are used first.
+ * When allocating for a regular file, a run longer than requested is
+ * looked for and the rest of it is kept as the inode's preallocation
+ * window, so that subsequent appends continue the same run even if other
+ * files are written at the same time.
+ *
+ * The window is only reserved in memory. Its blocks are marked as used
+ * on disk when they are handed to the inode, so nothing is leaked
+ * if the system goes down while the file is open.
+ *
+ * @param inode_ref Inode to allocate blocks for
+ * @param goal      Preferred first block, 0 to compute it from the inode
+ * @param fblock    Output value - first allocated block
+ * @param count     Number of blocks wanted; output value - number of
+ *                  blocks allocated (at least one)
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_balloc_alloc_blocks(ext4_inode_ref_t *inode_ref, uint32_t goal,
+    uint32_t *fblock, uint32_t *count)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+	ext4_superblock_t *sb = fs->superblock;
+	uint32_t want = *count;
+	errno_t rc;
+
+	assert(want > 0);
+
+	/* Use preallocated blocks if they continue at the goal */
+	ext4_prealloc_t *pa = ext4_balloc_prealloc_find(fs, inode_ref->index);
+	if (pa != NULL && (goal == 0 || goal == pa->start)) {
+		uint32_t n;
+
+		rc = ext4_balloc_claim_run(fs, pa->start, min(want, pa->count),
+		    &n);
+		if (rc != EOK)
+			return rc;
+
+		if (n > 0) {
+			*fblock = pa->start;
+			*count = n;
+			pa->start += n;
+			pa->count -= n;
+
+			if (pa->count == 0) {
+				list_remove(&pa->link);
+				fs->prealloc_count--;
+				free(pa);
+			} else {
+				/* Keep the most recently used entries at the front */
+				list_remove(&pa->link);
+				list_prepend(&pa->link, &fs->prealloc);
+			}
+
+			ext4_balloc_inode_add_blocks(inode_ref, n);
+			return EOK;
 		}
 
-	next_group:
-		rc = ext4_filesystem_put_block_group_ref(bg_ref);
+		/* The window has been taken by someone else */
+		goal = pa->start;
+	}
+
+	/* The file continues elsewhere, the preallocation is useless */
+	if (pa != NULL) {
+		rc = ext4_balloc_discard_prealloc(fs, inode_ref->index);
 		if (rc != EOK)
 			return rc;
+	}
 
-		/* Goto next group */
-		bgid = (bgid + 1) % block_group_count;
-		count--;
+	if (goal == 0) {
+		rc = ext4_balloc_find_goal(inode_ref, &goal);
+		if (rc != EOK)
+			return rc;
 	}
 
-	return ENOSPC;
+	/* Preallocate in proportion to the file size */
+	uint32_t reserve = want;
+	if (ext4_inode_is_type(sb, inode_ref->inode, EXT4_INODE_MODE_FILE)) {
+		uint32_t block_size = ext4_superblock_get_block_size(sb);
+		uint64_t file_blocks =
+		    ext4_inode_get_size(sb, inode_ref->inode) / block_size;
 
-success:
-	block_size = ext4_superblock_get_block_size(sb);
+		reserve = max(want, (uint32_t) min(max(file_blocks,
+		    (uint64_t) EXT4_PREALLOC_MIN_BLOCKS),
+		    (uint64_t) EXT4_PREALLOC_MAX_BLOCKS));
+	}
 
-	/* Update superblock free blocks count */
-	uint32_t sb_free_blocks = ext4_superblock_get_free_blocks_count(sb);
-	sb_free_blocks--;
-	ext4_superblock_set_free_blocks_count(sb, sb_free_blocks);
+	uint32_t first;
+	uint32_t n;
+	rc = ext4_balloc_alloc_run(fs, goal, reserve, want, &first, &n);
+	if (rc == ENOSPC && !list_empty(&fs->prealloc)) {
+		/* Reclaim preallocations of other inodes and retry */
+		rc = ext4_balloc_discard_all_prealloc(fs);
+		if (rc != EOK)
+			return rc;
+		rc = ext4_balloc_alloc_run(fs, goal, reserve, want, &first,
+		    &n);
+	}
+	if (rc != EOK)
+		return rc;
 
-	/* Update inode blocks (different block size!) count */
-	uint64_t ino_blocks =
-	    ext4_inode_get_blocks_count(sb, inode_ref->inode);
-	ino_blocks += block_size / EXT4_INODE_BLOCK_SIZE;
-	ext4_inode_set_blocks_count(sb, inode_ref->inode, ino_blocks);
-	inode_ref->dirty = true;
+	uint32_t used = min(n, want);
+	ext4_balloc_inode_add_blocks(inode_ref, used);
 
-	/* Update block group free blocks count */
-	uint32_t bg_free_blocks =
-	    ext4_block_group_get_free_blocks_count(bg_ref->block_group, sb);
-	bg_free_blocks--;
-	ext4_block_group_set_free_blocks_count(bg_ref->block_group, sb,
-	    bg_free_blocks);
-	bg_ref->dirty = true;
+	*fblock = first;
+	*count = used;
+
+	if (n == used)
+		return EOK;
+
+	/* Reserve the rest of the run for subsequent appends */
+	pa = malloc(sizeof(ext4_prealloc_t));
+	if (pa == NULL)
+		return EOK;
 
-	rc = ext4_filesystem_put_block_group_ref(bg_ref);
+	link_initialize(&pa->link);
+	pa->index = inode_ref->index;
+	pa->start = first + used;
+	pa->count = n - used;
+	list_prepend(&pa->link, &fs->prealloc);
+	fs->prealloc_count++;
 
-	*fblock = allocated_block;
-	return rc;
+	/* Limit number of inodes holding preallocated blocks */
+	while (fs->prealloc_count > EXT4_PREALLOC_MAX_INODES) {
+		ext4_prealloc_t *old = list_get_instance(
+		    list_last(&fs->prealloc), ext4_prealloc_t, link);
+		list_remove(&old->link);
+		fs->prealloc_count--;
+
+		ext4_balloc_prealloc_release(fs, old);
+	}
+
+	return EOK;
 }
 
 /** Try to allocate concrete block.
@@ -652,13 +1059,15 @@ errno_t ext4_balloc_try_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t fblock
 		return rc;
 	}
 
-	/* Check if block is free */
-	*free = ext4_bitmap_is_free_bit(bitmap_block->data, index_in_group);
+	/* Check if block is free and not freed by the running transaction */
+	uint32_t skip;
+	*free = ext4_bitmap_is_free_bit(bitmap_block->data, index_in_group) &&
+	    ext4_journal_clip_freed(fs, fblock, 1, &skip) > 0;
 
 	/* Allocate block if possible */
 	if (*free) {
 		ext4_bitmap_set_bit(bitmap_block->data, index_in_group);
-		bitmap_block->dirty = true;
+		ext4_journal_dirty(fs, bitmap_block);
 	}
 
 	/* Release block with bitmap */
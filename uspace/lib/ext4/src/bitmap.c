@@ -34,11 +34,48 @@
  * @brief Ext4 bitmap operations.
  */
 
+#include <bitops.h>
+#include <byteorder.h>
 #include <errno.h>
 #include <block.h>
+#include <mem.h>
 #include <stdint.h>
 #include "ext4/bitmap.h"
 
+/** Number of bits in a bitmap word */
+#define EXT4_BITMAP_WORD_BITS  64
+
+/** Load a 64-bit word from bitmap.
+ *
+ * Bit i of the word is bit i of the bitmap counted from @a index.
+ *
+ * @param bitmap Pointer to bitmap
+ * @param index  Index of the first bit of the word, multiple of 8
+ *
+ * @return Bitmap word
+ *
+ */
+static inline uint64_t ext4_bitmap_get_word(const uint8_t *bitmap,
+    uint32_t index)
+{
+	uint64_t word;
+
+	memcpy(&word, bitmap + index / 8, sizeof(word));
+	return uint64_t_le2host(word);
+}
+
+/** Get index of the lowest set bit in a non-zero word.
+ *
+ * @param word Word with at least one bit set
+ *
+ * @return Index of the lowest set bit
+ *
+ */
+static inline unsigned int ext4_bitmap_lowest_bit(uint64_t word)
+{
+	return fnzb64(word & -word);
+}
+
 /** Set bit in bitmap to 0 (free).
  *
  * Index must be checked by caller, if it's not out of bounds.
@@ -68,51 +105,24 @@ void ext4_bitmap_free_bit(uint8_t *bitmap, uint32_t index)
  */
 void ext4_bitmap_free_bits(uint8_t *bitmap, uint32_t index, uint32_t count)
 {
-	uint8_t *target;
 	uint32_t idx = index;
 	uint32_t remaining = count;
-	uint32_t byte_index;
 
 	/* Align index to multiple of 8 */
 	while (((idx % 8) != 0) && (remaining > 0)) {
-		byte_index = idx / 8;
-		uint32_t bit_index = idx % 8;
-
-		target = bitmap + byte_index;
-		*target &= ~(1 << bit_index);
-
+		bitmap[idx / 8] &= ~(1 << (idx % 8));
 		idx++;
 		remaining--;
 	}
 
-	/* For < 8 bits this check necessary */
-	if (remaining == 0)
-		return;
-
-	assert((idx % 8) == 0);
-
-	byte_index = idx / 8;
-	target = bitmap + byte_index;
-
 	/* Zero the whole bytes */
-	while (remaining >= 8) {
-		*target = 0;
-
-		idx += 8;
-		remaining -= 8;
-		target++;
-	}
+	memset(bitmap + idx / 8, 0, remaining / 8);
+	idx += remaining & ~7;
+	remaining %= 8;
 
-	assert(remaining < 8);
-
-	/* Zero remaining bytes */
+	/* Zero remaining bits */
 	while (remaining != 0) {
-		byte_index = idx / 8;
-		uint32_t bit_index = idx % 8;
-
-		target = bitmap + byte_index;
-		*target &= ~(1 << bit_index);
-
+		bitmap[idx / 8] &= ~(1 << (idx % 8));
 		idx++;
 		remaining--;
 	}
@@ -134,6 +144,40 @@ void ext4_bitmap_set_bit(uint8_t *bitmap, uint32_t index)
 	*target |= 1 << bit_index;
 }
 
+/** Set continous set of bits to 1 (used).
+ *
+ * Index and count must be checked by caller, if they aren't out of bounds.
+ *
+ * @param bitmap Pointer to bitmap
+ * @param index  Index of first bit to set
+ * @param count  Number of bits to be set
+ *
+ */
+void ext4_bitmap_set_bits(uint8_t *bitmap, uint32_t index, uint32_t count)
+{
+	uint32_t idx = index;
+	uint32_t remaining = count;
+
+	/* Align index to multiple of 8 */
+	while (((idx % 8) != 0) && (remaining > 0)) {
+		bitmap[idx / 8] |= 1 << (idx % 8);
+		idx++;
+		remaining--;
+	}
+
+	/* Set the whole bytes */
+	memset(bitmap + idx / 8, 255, remaining / 8);
+	idx += remaining & ~7;
+	remaining %= 8;
+
+	/* Set remaining bits */
+	while (remaining != 0) {
+		bitmap[idx / 8] |= 1 << (idx % 8);
+		idx++;
+		remaining--;
+	}
+}
+
 /** Check if requested bit is free.
  *
  * @param bitmap Pointer to bitmap
@@ -158,7 +202,8 @@ bool ext4_bitmap_is_free_bit(uint8_t *bitmap, uint32_t index)
 /** Try to find free byte and set the first bit as used.
  *
  * Walk through bitmap and try to find free byte (equal to 0).
- * If byte found, set the first bit as used.
+ * If byte found, set the first bit as used. Whole 64-bit words without
+ * a zero byte are skipped at once.
  *
  * @param bitmap Pointer to bitmap
  * @param start  Index of bit, where the algorithm will begin
@@ -179,19 +224,32 @@ errno_t ext4_bitmap_find_free_byte_and_set_bit(uint8_t *bitmap, uint32_t start,
 	else
 		idx = start;
 
-	uint8_t *pos = bitmap + (idx / 8);
-
 	/* Try to find free byte */
 	while (idx < max) {
-		if (*pos == 0) {
-			*pos |= 1;
+		if ((idx % EXT4_BITMAP_WORD_BITS) == 0 &&
+		    max - idx >= EXT4_BITMAP_WORD_BITS) {
+			uint64_t word = ext4_bitmap_get_word(bitmap, idx);
+
+			/* Mark the highest bit of every zero byte */
+			uint64_t zero = (word - UINT64_C(0x0101010101010101)) &
+			    ~word & UINT64_C(0x8080808080808080);
+			if (zero == 0) {
+				idx += EXT4_BITMAP_WORD_BITS;
+				continue;
+			}
+
+			/* The lowest mark always belongs to a zero byte */
+			idx += ext4_bitmap_lowest_bit(zero) & ~7;
+		}
+
+		if (bitmap[idx / 8] == 0) {
+			bitmap[idx / 8] |= 1;
 
 			*index = idx;
 			return EOK;
 		}
 
 		idx += 8;
-		++pos;
 	}
 
 	/* Free byte not found */
@@ -213,16 +271,53 @@ errno_t ext4_bitmap_find_free_byte_and_set_bit(uint8_t *bitmap, uint32_t start,
 errno_t ext4_bitmap_find_free_bit_and_set(uint8_t *bitmap, uint32_t start_idx,
     uint32_t *index, uint32_t max)
 {
-	uint8_t *pos = bitmap + (start_idx / 8);
+	errno_t rc = ext4_bitmap_find_free_bit(bitmap, start_idx, index, max);
+	if (rc != EOK)
+		return rc;
+
+	ext4_bitmap_set_bit(bitmap, *index);
+	return EOK;
+}
+
+/** Try to find free bit without modifying the bitmap.
+ *
+ * The bitmap is scanned bit by bit only up to the next 64-bit boundary,
+ * then a word at a time.
+ *
+ * @param bitmap    Pointer to bitmap
+ * @param start_idx Index of bit, where algorithm will begin
+ * @param index     Output value - index of the free bit (if found)
+ * @param max       Maximum index of bit in bitmap
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_bitmap_find_free_bit(uint8_t *bitmap, uint32_t start_idx,
+    uint32_t *index, uint32_t max)
+{
 	uint32_t idx = start_idx;
-	bool byte_part = false;
 
-	/* Check the rest of first byte */
-	while ((idx % 8) != 0) {
-		byte_part = true;
+	while (idx < max) {
+		/* Skip whole used words */
+		if ((idx % EXT4_BITMAP_WORD_BITS) == 0 &&
+		    max - idx >= EXT4_BITMAP_WORD_BITS) {
+			uint64_t word = ~ext4_bitmap_get_word(bitmap, idx);
+			if (word == 0) {
+				idx += EXT4_BITMAP_WORD_BITS;
+				continue;
+			}
+
+			*index = idx + ext4_bitmap_lowest_bit(word);
+			return EOK;
+		}
+
+		/* Skip whole used bytes */
+		if ((idx % 8) == 0 && bitmap[idx / 8] == 255) {
+			idx += 8;
+			continue;
+		}
 
-		if ((*pos & (1 << (idx % 8))) == 0) {
-			*pos |= (1 << (idx % 8));
+		if ((bitmap[idx / 8] & (1 << (idx % 8))) == 0) {
 			*index = idx;
 			return EOK;
 		}
@@ -230,38 +325,50 @@ errno_t ext4_bitmap_find_free_bit_and_set(uint8_t *bitmap, uint32_t start_idx,
 		++idx;
 	}
 
-	if (byte_part)
-		++pos;
+	/* Free bit not found */
+	return ENOSPC;
+}
+
+/** Compute length of a run of free bits.
+ *
+ * @param bitmap    Pointer to bitmap
+ * @param start_idx Index of the first bit of the run
+ * @param max       Maximum index of bit in bitmap (exclusive)
+ *
+ * @return Number of consecutive free bits starting at start_idx
+ *
+ */
+uint32_t ext4_bitmap_free_run(uint8_t *bitmap, uint32_t start_idx, uint32_t max)
+{
+	uint32_t idx = start_idx;
 
-	/* Check the whole bytes (255 = 11111111 binary) */
 	while (idx < max) {
-		if ((*pos & 255) != 255) {
-			/* Free bit found */
+		/* Skip whole free words */
+		if ((idx % EXT4_BITMAP_WORD_BITS) == 0 &&
+		    max - idx >= EXT4_BITMAP_WORD_BITS) {
+			uint64_t word = ext4_bitmap_get_word(bitmap, idx);
+			if (word == 0) {
+				idx += EXT4_BITMAP_WORD_BITS;
+				continue;
+			}
+
+			idx += ext4_bitmap_lowest_bit(word);
 			break;
 		}
 
-		idx += 8;
-		++pos;
-	}
-
-	/* If idx < max, some free bit found */
-	if (idx < max) {
-		/* Check which bit from byte is free */
-		for (uint8_t i = 0; i < 8; ++i) {
-			if ((*pos & (1 << i)) == 0) {
-				/* Free bit found */
-				*pos |= (1 << i);
+		/* Skip whole free bytes */
+		if ((idx % 8) == 0 && (max - idx) >= 8 && bitmap[idx / 8] == 0) {
+			idx += 8;
+			continue;
+		}
 
-				*index = idx;
-				return EOK;
-			}
+		if ((bitmap[idx / 8] & (1 << (idx % 8))) != 0)
+			break;
 
-			idx++;
-		}
+		++idx;
 	}
 
-	/* Free bit not found */
-	return ENOSPC;
+	return idx - start_idx;
 }
 
 /**
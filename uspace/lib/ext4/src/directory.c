@@ -44,6 +44,7 @@
 #include "ext4/directory_index.h"
 #include "ext4/filesystem.h"
 #include "ext4/inode.h"
+#include "ext4/journal.h"
 #include "ext4/superblock.h"
 
 /** Get i-node number from directory entry.
@@ -432,7 +433,7 @@ errno_t ext4_directory_add_entry(ext4_inode_ref_t *parent, const char *name,
 			return rc;
 
 		/* If adding is successful, function can finish */
-		rc = ext4_directory_try_insert_entry(fs->superblock, block,
+		rc = ext4_directory_try_insert_entry(fs, block,
 		    child, name, name_len);
 		if (rc == EOK)
 			success = true;
@@ -466,7 +467,7 @@ errno_t ext4_directory_add_entry(ext4_inode_ref_t *parent, const char *name,
 	    child, name, name_len);
 
 	/* Save new block */
-	new_block->dirty = true;
+	ext4_journal_dirty(fs, new_block);
 	rc = block_put(new_block);
 
 	return rc;
@@ -612,14 +613,14 @@ errno_t ext4_directory_remove_entry(ext4_inode_ref_t *parent, const char *name)
 		    tmp_dentry_length + del_entry_length);
 	}
 
-	result.block->dirty = true;
+	ext4_journal_dirty(parent->fs, result.block);
 
 	return ext4_directory_destroy_result(&result);
 }
 
 /** Try to insert entry to concrete data block.
  *
- * @param sb           Superblock
+ * @param fs           Filesystem
  * @param target_block Block to try to insert entry to
  * @param child        Child i-node to be inserted by new entry
  * @param name         Name of the new entry
@@ -628,10 +629,12 @@ errno_t ext4_directory_remove_entry(ext4_inode_ref_t *parent, const char *name)
  * @return Error code
  *
  */
-errno_t ext4_directory_try_insert_entry(ext4_superblock_t *sb,
+errno_t ext4_directory_try_insert_entry(ext4_filesystem_t *fs,
     block_t *target_block, ext4_inode_ref_t *child, const char *name,
     uint32_t name_len)
 {
+	ext4_superblock_t *sb = fs->superblock;
+
 	/* Compute required length entry and align it to 4 bytes */
 	uint32_t block_size = ext4_superblock_get_block_size(sb);
 	uint16_t required_len = sizeof(ext4_fake_directory_entry_t) + name_len;
@@ -655,7 +658,7 @@ errno_t ext4_directory_try_insert_entry(ext4_superblock_t *sb,
 		if ((inode == 0) && (rec_len >= required_len)) {
 			ext4_directory_write_entry(sb, dentry, rec_len, child,
 			    name, name_len);
-			target_block->dirty = true;
+			ext4_journal_dirty(fs, target_block);
 
 			return EOK;
 		}
@@ -682,7 +685,7 @@ errno_t ext4_directory_try_insert_entry(ext4_superblock_t *sb,
 				ext4_directory_write_entry(sb, new_entry,
 				    free_space, child, name, name_len);
 
-				target_block->dirty = true;
+				ext4_journal_dirty(fs, target_block);
 
 				return EOK;
 			}
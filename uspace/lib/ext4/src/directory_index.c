@@ -44,6 +44,7 @@
 #include "ext4/filesystem.h"
 #include "ext4/hash.h"
 #include "ext4/inode.h"
+#include "ext4/journal.h"
 #include "ext4/superblock.h"
 
 /** Type entry to pass to sorting algorithm.
@@ -294,7 +295,7 @@ errno_t ext4_directory_dx_init(ext4_inode_ref_t *dir)
 	ext4_directory_entry_ll_set_entry_length(block_entry, block_size);
 	ext4_directory_entry_ll_set_inode(block_entry, 0);
 
-	new_block->dirty = true;
+	ext4_journal_dirty(dir->fs, new_block);
 	rc = block_put(new_block);
 	if (rc != EOK) {
 		block_put(block);
@@ -305,7 +306,7 @@ errno_t ext4_directory_dx_init(ext4_inode_ref_t *dir)
 	ext4_directory_dx_entry_t *entry = root->entries;
 	ext4_directory_dx_entry_set_block(entry, iblock);
 
-	block->dirty = true;
+	ext4_journal_dirty(dir->fs, block);
 
 	return block_put(block);
 }
@@ -690,12 +691,13 @@ static int ext4_directory_dx_entry_comparator(const void *arg1,
  *
  * Note that space for new entry must be checked by caller.
  *
+ * @param fs          Filesystem
  * @param index_block Block where to insert new entry
  * @param hash        Hash value covered by child node
  * @param iblock      Logical number of child block
  *
  */
-static void ext4_directory_dx_insert_entry(
+static void ext4_directory_dx_insert_entry(ext4_filesystem_t *fs,
     ext4_directory_dx_block_t *index_block, uint32_t hash, uint32_t iblock)
 {
 	ext4_directory_dx_entry_t *old_index_entry = index_block->position;
@@ -715,7 +717,7 @@ static void ext4_directory_dx_insert_entry(
 
 	ext4_directory_dx_countlimit_set_count(countlimit, count + 1);
 
-	index_block->block->dirty = true;
+	ext4_journal_dirty(fs, index_block->block);
 }
 
 /** Split directory entries to two parts preventing node overflow.
@@ -873,14 +875,14 @@ static errno_t ext4_directory_dx_split_data(ext4_inode_ref_t *inode_ref,
 	}
 
 	/* Do some steps to finish operation */
-	old_data_block->dirty = true;
-	new_data_block_tmp->dirty = true;
+	ext4_journal_dirty(inode_ref->fs, old_data_block);
+	ext4_journal_dirty(inode_ref->fs, new_data_block_tmp);
 
 	free(sort_array);
 	free(entry_buffer);
 
-	ext4_directory_dx_insert_entry(index_block, new_hash + continued,
-	    new_iblock);
+	ext4_directory_dx_insert_entry(inode_ref->fs, index_block,
+	    new_hash + continued, new_iblock);
 
 	*new_data_block = new_data_block_tmp;
 
@@ -983,7 +985,7 @@ static errno_t ext4_directory_dx_split_index(ext4_inode_ref_t *inode_ref,
 			/* Which index block is target for new entry */
 			uint32_t position_index = (dx_block->position - dx_block->entries);
 			if (position_index >= count_left) {
-				dx_block->block->dirty = true;
+				ext4_journal_dirty(inode_ref->fs, dx_block->block);
 
 				block_t *block_tmp = dx_block->block;
 				dx_block->block = new_block;
@@ -995,7 +997,8 @@ static errno_t ext4_directory_dx_split_index(ext4_inode_ref_t *inode_ref,
 			}
 
 			/* Finally insert new entry */
-			ext4_directory_dx_insert_entry(dx_blocks, hash_right, new_iblock);
+			ext4_directory_dx_insert_entry(inode_ref->fs, dx_blocks,
+			    hash_right, new_iblock);
 
 			return block_put(new_block);
 		} else {
@@ -1105,7 +1108,7 @@ errno_t ext4_directory_dx_add_entry(ext4_inode_ref_t *parent,
 		goto release_index;
 
 	/* Check if insert operation passed */
-	rc = ext4_directory_try_insert_entry(fs->superblock, target_block, child,
+	rc = ext4_directory_try_insert_entry(fs, target_block, child,
 	    name, name_len);
 	if (rc == EOK)
 		goto release_target_index;
@@ -1131,10 +1134,10 @@ errno_t ext4_directory_dx_add_entry(ext4_inode_ref_t *parent,
 	uint32_t new_block_hash =
 	    ext4_directory_dx_entry_get_hash(dx_block->position + 1);
 	if (hinfo.hash >= new_block_hash)
-		rc = ext4_directory_try_insert_entry(fs->superblock, new_block,
+		rc = ext4_directory_try_insert_entry(fs, new_block,
 		    child, name, name_len);
 	else
-		rc = ext4_directory_try_insert_entry(fs->superblock, target_block,
+		rc = ext4_directory_try_insert_entry(fs, target_block,
 		    child, name, name_len);
 
 	/* Cleanup */
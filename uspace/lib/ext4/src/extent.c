@@ -36,11 +36,13 @@
 
 #include <byteorder.h>
 #include <errno.h>
+#include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
 #include "ext4/balloc.h"
 #include "ext4/extent.h"
 #include "ext4/inode.h"
+#include "ext4/journal.h"
 #include "ext4/superblock.h"
 
 /** Get logical number of the block covered by extent.
@@ -677,7 +679,7 @@ errno_t ext4_extent_release_blocks_from(ext4_inode_ref_t *inode_ref,
 	}
 
 	ext4_extent_header_set_entries_count(path_ptr->header, entries);
-	path_ptr->block->dirty = true;
+	ext4_journal_dirty(inode_ref->fs, path_ptr->block);
 
 	/* If leaf node is empty, parent entry must be modified */
 	bool remove_parent_record = false;
@@ -716,7 +718,7 @@ errno_t ext4_extent_release_blocks_from(ext4_inode_ref_t *inode_ref,
 		}
 
 		ext4_extent_header_set_entries_count(path_ptr->header, entries);
-		path_ptr->block->dirty = true;
+		ext4_journal_dirty(inode_ref->fs, path_ptr->block);
 
 		/* Free the node if it is empty */
 		if ((entries == 0) && (path_ptr != path)) {
@@ -828,7 +830,7 @@ static errno_t ext4_extent_append_extent(ext4_inode_ref_t *inode_ref,
 			ext4_extent_header_set_depth(path_ptr->header, path_ptr->depth);
 			ext4_extent_header_set_generation(path_ptr->header, 0);
 
-			path_ptr->block->dirty = true;
+			ext4_journal_dirty(inode_ref->fs, path_ptr->block);
 
 			/* Jump to the preceeding item */
 			path_ptr--;
@@ -844,7 +846,7 @@ static errno_t ext4_extent_append_extent(ext4_inode_ref_t *inode_ref,
 			}
 
 			ext4_extent_header_set_entries_count(path_ptr->header, entries + 1);
-			path_ptr->block->dirty = true;
+			ext4_journal_dirty(inode_ref->fs, path_ptr->block);
 
 			/* No more splitting needed */
 			return EOK;
@@ -915,7 +917,7 @@ static errno_t ext4_extent_append_extent(ext4_inode_ref_t *inode_ref,
 		ext4_extent_header_set_entries_count(old_root->header, entries + 1);
 		ext4_extent_header_set_max_entries_count(old_root->header, limit);
 
-		old_root->block->dirty = true;
+		ext4_journal_dirty(inode_ref->fs, old_root->block);
 
 		/* Re-initialize new root metadata */
 		new_root->depth = root_depth + 1;
@@ -931,7 +933,7 @@ static errno_t ext4_extent_append_extent(ext4_inode_ref_t *inode_ref,
 		ext4_extent_index_set_first_block(new_root->index, 0);
 		ext4_extent_index_set_leaf(new_root->index, new_fblock);
 
-		new_root->block->dirty = true;
+		ext4_journal_dirty(inode_ref->fs, new_root->block);
 	} else {
 		if (path->depth) {
 			path->index = EXT4_EXTENT_FIRST_INDEX(path->header) + entries;
@@ -943,7 +945,7 @@ static errno_t ext4_extent_append_extent(ext4_inode_ref_t *inode_ref,
 		}
 
 		ext4_extent_header_set_entries_count(path->header, entries + 1);
-		path->block->dirty = true;
+		ext4_journal_dirty(inode_ref->fs, path->block);
 	}
 
 	return EOK;
@@ -1017,7 +1019,7 @@ errno_t ext4_extent_append_block(ext4_inode_ref_t *inode_ref, uint32_t *iblock,
 				inode_ref->dirty = true;
 			}
 
-			path_ptr->block->dirty = true;
+			ext4_journal_dirty(inode_ref->fs, path_ptr->block);
 
 			goto finish;
 		} else {
@@ -1045,7 +1047,7 @@ errno_t ext4_extent_append_block(ext4_inode_ref_t *inode_ref, uint32_t *iblock,
 				inode_ref->dirty = true;
 			}
 
-			path_ptr->block->dirty = true;
+			ext4_journal_dirty(inode_ref->fs, path_ptr->block);
 
 			goto finish;
 		}
@@ -1081,7 +1083,7 @@ append_extent:
 		inode_ref->dirty = true;
 	}
 
-	path_ptr->block->dirty = true;
+	ext4_journal_dirty(inode_ref->fs, path_ptr->block);
 
 finish:
 	rc2 = EOK;
@@ -1108,6 +1110,134 @@ finish:
 	return rc;
 }
 
+/** Append a run of data blocks to the i-node.
+ *
+ * Unlike ext4_extent_append_block() the position of the new blocks is given
+ * explicitly and the i-node size is not updated, so that a series of runs
+ * can be appended before the size is set. Physically contiguous blocks
+ * are requested from the allocator at once and merged into the last
+ * extent whenever possible.
+ *
+ * @param inode_ref I-node to append blocks to
+ * @param iblock    Logical number of the first new block, must follow
+ *                  the last block of the i-node
+ * @param fblock    Output value - physical number of the first new block
+ * @param count     Number of blocks wanted; output value - number of
+ *                  physically contiguous blocks appended (at least one)
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_extent_append_blocks(ext4_inode_ref_t *inode_ref, uint32_t iblock,
+    uint32_t *fblock, uint32_t *count)
+{
+	const uint16_t block_limit = (1 << 15);
+	uint32_t phys_block = 0;
+	uint32_t n = min(*count, block_limit);
+	bool allocated = false;
+
+	/* Load the nearest leaf (with extent) */
+	ext4_extent_path_t *path;
+	errno_t rc2;
+	errno_t rc = ext4_extent_find_extent(inode_ref, iblock, &path);
+	if (rc != EOK)
+		return rc;
+
+	/* Jump to last item of the path (extent) */
+	ext4_extent_path_t *path_ptr = path;
+	while (path_ptr->depth != 0)
+		path_ptr++;
+
+	/* Add new extent to the node if not present */
+	if (path_ptr->extent == NULL)
+		goto append_extent;
+
+	uint16_t block_count = ext4_extent_get_block_count(path_ptr->extent);
+
+	if (block_count == 0) {
+		/* Existing extent is empty */
+		rc = ext4_balloc_alloc_blocks(inode_ref, 0, &phys_block, &n);
+		if (rc != EOK)
+			goto finish;
+
+		/* Initialize extent */
+		ext4_extent_set_first_block(path_ptr->extent, iblock);
+		ext4_extent_set_start(path_ptr->extent, phys_block);
+		ext4_extent_set_block_count(path_ptr->extent, n);
+
+		ext4_journal_dirty(inode_ref->fs, path_ptr->block);
+		goto finish;
+	}
+
+	uint32_t extent_end = ext4_extent_get_first_block(path_ptr->extent) +
+	    block_count;
+	uint32_t goal = ext4_extent_get_start(path_ptr->extent) + block_count;
+
+	if (extent_end == iblock && block_count < block_limit) {
+		/* Try to continue the last extent */
+		n = min(n, (uint32_t) (block_limit - block_count));
+		rc = ext4_balloc_alloc_blocks(inode_ref, goal, &phys_block, &n);
+		if (rc != EOK)
+			goto finish;
+
+		if (phys_block == goal) {
+			ext4_extent_set_block_count(path_ptr->extent,
+			    block_count + n);
+			ext4_journal_dirty(inode_ref->fs, path_ptr->block);
+			goto finish;
+		}
+
+		/* Blocks were allocated elsewhere, they need a new extent */
+		allocated = true;
+	}
+
+append_extent:
+	if (!allocated) {
+		rc = ext4_balloc_alloc_blocks(inode_ref, 0, &phys_block, &n);
+		if (rc != EOK)
+			goto finish;
+	}
+
+	/* Append extent for new blocks (includes tree splitting if needed) */
+	rc = ext4_extent_append_extent(inode_ref, path, iblock);
+	if (rc != EOK) {
+		ext4_balloc_free_blocks(inode_ref, phys_block, n);
+		goto finish;
+	}
+
+	uint32_t tree_depth = ext4_extent_header_get_depth(path->header);
+	path_ptr = path + tree_depth;
+
+	/* Initialize newly created extent */
+	ext4_extent_set_block_count(path_ptr->extent, n);
+	ext4_extent_set_first_block(path_ptr->extent, iblock);
+	ext4_extent_set_start(path_ptr->extent, phys_block);
+
+	ext4_journal_dirty(inode_ref->fs, path_ptr->block);
+
+finish:
+	/* Set return values */
+	*fblock = phys_block;
+	*count = n;
+
+	/*
+	 * Put loaded blocks
+	 * starting from 1: 0 is a block with inode data
+	 */
+	for (uint16_t i = 1; i <= path->depth; ++i) {
+		if (path[i].block) {
+			rc2 = block_put(path[i].block);
+			if (rc == EOK && rc2 != EOK)
+				rc = rc2;
+		}
+	}
+
+	/* Destroy temporary data structure */
+	free(path);
+
+	return rc;
+}
+
 /**
  * @}
  */
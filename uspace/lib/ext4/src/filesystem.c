@@ -53,6 +53,7 @@
 #include "ext4/filesystem.h"
 #include "ext4/ialloc.h"
 #include "ext4/inode.h"
+#include "ext4/journal.h"
 #include "ext4/ops.h"
 #include "ext4/superblock.h"
 
@@ -80,6 +81,8 @@ static errno_t ext4_filesystem_init(ext4_filesystem_t *fs, service_id_t service_
 	ext4_superblock_t *temp_superblock = NULL;
 
 	fs->device = service_id;
+	list_initialize(&fs->prealloc);
+	fs->prealloc_count = 0;
 
 	/* Initialize block library (4096 is size of communication channel) */
 	rc = block_init(fs->device);
@@ -119,8 +122,14 @@ static errno_t ext4_filesystem_init(ext4_filesystem_t *fs, service_id_t service_
 
 	uint16_t state = ext4_superblock_get_state(fs->superblock);
 
-	if (((state & EXT4_SUPERBLOCK_STATE_VALID_FS) !=
-	    EXT4_SUPERBLOCK_STATE_VALID_FS) ||
+	/* Journaled file system that was not unmounted cleanly is replayed */
+	bool recover = ext4_superblock_has_feature_compatible(fs->superblock,
+	    EXT4_FEATURE_COMPAT_HAS_JOURNAL) &&
+	    ext4_superblock_has_feature_incompatible(fs->superblock,
+	    EXT4_FEATURE_INCOMPAT_RECOVER);
+
+	if ((((state & EXT4_SUPERBLOCK_STATE_VALID_FS) !=
+	    EXT4_SUPERBLOCK_STATE_VALID_FS) && !recover) ||
 	    ((state & EXT4_SUPERBLOCK_STATE_ERROR_FS) ==
 	    EXT4_SUPERBLOCK_STATE_ERROR_FS)) {
 		rc = ENOTSUP;
@@ -157,12 +166,70 @@ static void ext4_filesystem_fini(ext4_filesystem_t *fs)
 {
 	/* Release memory space for superblock */
 	free(fs->superblock);
+	free(fs->group_summary);
 
 	/* Finish work with block library */
 	block_cache_fini(fs->device);
 	block_fini(fs->device);
 }
 
+/** Build the in-memory free space summary of all block groups.
+ *
+ * The descriptors are read directly so that groups with uninitialized
+ * bitmaps are not initialized just by mounting the filesystem.
+ *
+ * @param fs Filesystem
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_filesystem_init_group_summary(ext4_filesystem_t *fs)
+{
+	ext4_superblock_t *sb = fs->superblock;
+	uint32_t block_group_count = ext4_superblock_get_block_group_count(sb);
+	uint32_t desc_size = ext4_superblock_get_desc_size(sb);
+	uint32_t descriptors_per_block =
+	    ext4_superblock_get_block_size(sb) / desc_size;
+	aoff64_t block_id = ext4_superblock_get_first_data_block(sb) + 1;
+
+	ext4_group_summary_t *summary =
+	    calloc(block_group_count, sizeof(ext4_group_summary_t));
+	if (summary == NULL)
+		return ENOMEM;
+
+	uint32_t bgid = 0;
+	while (bgid < block_group_count) {
+		block_t *block;
+		errno_t rc = block_get(&block, fs->device, block_id, 0);
+		if (rc != EOK) {
+			free(summary);
+			return rc;
+		}
+
+		for (uint32_t i = 0; i < descriptors_per_block &&
+		    bgid < block_group_count; i++, bgid++) {
+			ext4_block_group_t *bg = block->data + i * desc_size;
+
+			summary[bgid].free_blocks =
+			    ext4_block_group_get_free_blocks_count(bg, sb);
+			summary[bgid].free_inodes =
+			    ext4_block_group_get_free_inodes_count(bg, sb);
+			summary[bgid].max_run = summary[bgid].free_blocks;
+		}
+
+		rc = block_put(block);
+		if (rc != EOK) {
+			free(summary);
+			return rc;
+		}
+
+		block_id++;
+	}
+
+	fs->group_summary = summary;
+	return EOK;
+}
+
 /** Create lost+found directory.
  *
  * @param fs Filesystem
@@ -440,13 +507,36 @@ errno_t ext4_filesystem_open(ext4_instance_t *inst, service_id_t service_id,
 
 	fs_inited = 1;
 
+	/* Replay the journal if needed and start journaling */
+	rc = ext4_journal_init(fs);
+	if (rc != EOK)
+		goto error;
+
+	rc = ext4_filesystem_init_group_summary(fs);
+	if (rc != EOK)
+		goto error;
+
 	/* Read root node */
 	rc = ext4_node_get_core(&root_node, inst, EXT4_INODE_ROOT_INDEX);
 	if (rc != EOK)
 		goto error;
 
 	/* Mark system as mounted */
-	ext4_superblock_set_state(fs->superblock, EXT4_SUPERBLOCK_STATE_ERROR_FS);
+	if (fs->journal != NULL) {
+		/* Replay the journal should the system not be unmounted */
+		uint16_t state = ext4_superblock_get_state(fs->superblock);
+		ext4_superblock_set_state(fs->superblock,
+		    state & ~EXT4_SUPERBLOCK_STATE_VALID_FS);
+
+		uint32_t features =
+		    ext4_superblock_get_features_incompatible(fs->superblock);
+		ext4_superblock_set_features_incompatible(fs->superblock,
+		    features | EXT4_FEATURE_INCOMPAT_RECOVER);
+	} else {
+		ext4_superblock_set_state(fs->superblock,
+		    EXT4_SUPERBLOCK_STATE_ERROR_FS);
+	}
+
 	rc = ext4_superblock_write_direct(fs->device, fs->superblock);
 	if (rc != EOK)
 		goto error;
@@ -465,8 +555,10 @@ error:
 	if (root_node != NULL)
 		ext4_node_put(root_node);
 
-	if (fs_inited)
+	if (fs_inited) {
+		(void) ext4_journal_fini(fs);
 		ext4_filesystem_fini(fs);
+	}
 	free(fs);
 	return rc;
 }
@@ -481,9 +573,27 @@ error:
  */
 errno_t ext4_filesystem_close(ext4_filesystem_t *fs)
 {
+	/* Return preallocated blocks */
+	errno_t rc = ext4_balloc_discard_all_prealloc(fs);
+	if (rc != EOK)
+		return rc;
+
+	/* Write journaled metadata home */
+	bool journaled = fs->journal != NULL;
+	rc = ext4_journal_fini(fs);
+	if (rc != EOK)
+		return rc;
+
+	if (journaled) {
+		uint32_t features =
+		    ext4_superblock_get_features_incompatible(fs->superblock);
+		ext4_superblock_set_features_incompatible(fs->superblock,
+		    features & ~EXT4_FEATURE_INCOMPAT_RECOVER);
+	}
+
 	/* Write the superblock to the device */
 	ext4_superblock_set_state(fs->superblock, EXT4_SUPERBLOCK_STATE_VALID_FS);
-	errno_t rc = ext4_superblock_write_direct(fs->device, fs->superblock);
+	rc = ext4_superblock_write_direct(fs->device, fs->superblock);
 	if (rc != EOK)
 		return rc;
 
@@ -689,7 +799,7 @@ static errno_t ext4_filesystem_init_block_groups(ext4_filesystem_t *fs)
 			bg_block0 += ext4_superblock_get_blocks_per_group(sb);
 		}
 
-		block->dirty = true;
+		ext4_journal_dirty(fs, block);
 
 		rc = block_put(block);
 		if (rc != EOK)
@@ -800,7 +910,7 @@ static errno_t ext4_filesystem_init_block_bitmap(ext4_block_group_ref_t *bg_ref)
 		ext4_bitmap_set_bit(bitmap, block);
 	}
 
-	bitmap_block->dirty = true;
+	ext4_journal_dirty(bg_ref->fs, bitmap_block);
 
 	/* Save bitmap */
 	return block_put(bitmap_block);
@@ -843,7 +953,7 @@ static errno_t ext4_filesystem_init_inode_bitmap(ext4_block_group_ref_t *bg_ref)
 	if (i < end_bit)
 		memset(bitmap + (i >> 3), 0xff, (end_bit - i) >> 3);
 
-	bitmap_block->dirty = true;
+	ext4_journal_dirty(bg_ref->fs, bitmap_block);
 
 	/* Save bitmap */
 	return block_put(bitmap_block);
@@ -886,7 +996,7 @@ static errno_t ext4_filesystem_init_inode_table(ext4_block_group_ref_t *bg_ref)
 			return rc;
 
 		memset(block->data, 0, block_size);
-		block->dirty = true;
+		ext4_journal_dirty(bg_ref->fs, block);
 
 		rc = block_put(block);
 		if (rc != EOK)
@@ -1079,6 +1189,30 @@ uint32_t ext4_filesystem_bg_get_backup_blocks(ext4_block_group_ref_t *bg)
 	    bg->index);
 }
 
+/** Update free space summary of a modified block group.
+ *
+ * The longest free run can only be shortened by allocations. Once some
+ * blocks are freed, its bound is reset to the number of free blocks.
+ *
+ * @param ref Reference to the modified block group
+ *
+ */
+static void ext4_filesystem_update_group_summary(ext4_block_group_ref_t *ref)
+{
+	ext4_superblock_t *sb = ref->fs->superblock;
+	ext4_group_summary_t *summary = &ref->fs->group_summary[ref->index];
+
+	uint32_t free_blocks =
+	    ext4_block_group_get_free_blocks_count(ref->block_group, sb);
+	if (free_blocks > summary->free_blocks ||
+	    summary->max_run > free_blocks)
+		summary->max_run = free_blocks;
+
+	summary->free_blocks = free_blocks;
+	summary->free_inodes =
+	    ext4_block_group_get_free_inodes_count(ref->block_group, sb);
+}
+
 /** Put reference to block group.
  *
  * @param ref Pointer for reference to be put back
@@ -1097,7 +1231,10 @@ errno_t ext4_filesystem_put_block_group_ref(ext4_block_group_ref_t *ref)
 		ext4_block_group_set_checksum(ref->block_group, checksum);
 
 		/* Mark block dirty for writing changes to physical device */
-		ref->block->dirty = true;
+		ext4_journal_dirty(ref->fs, ref->block);
+
+		if (ref->fs->group_summary != NULL)
+			ext4_filesystem_update_group_summary(ref);
 	}
 
 	/* Put back block, that contains block group descriptor */
@@ -1196,7 +1333,7 @@ errno_t ext4_filesystem_put_inode_ref(ext4_inode_ref_t *ref)
 	/* Check if reference modified */
 	if (ref->dirty) {
 		/* Mark block dirty for writing changes to physical device */
-		ref->block->dirty = true;
+		ext4_journal_dirty(ref->fs, ref->block);
 	}
 
 	/* Put back block, that contains i-node */
@@ -1538,6 +1675,12 @@ errno_t ext4_filesystem_truncate_inode(ext4_inode_ref_t *inode_ref,
 	if (old_size < new_size)
 		return EINVAL;
 
+	/* Preallocated blocks would no longer follow the end of file */
+	errno_t rc = ext4_balloc_discard_prealloc(inode_ref->fs,
+	    inode_ref->index);
+	if (rc != EOK)
+		return rc;
+
 	/* Compute how many blocks will be released */
 	aoff64_t size_diff = old_size - new_size;
 	uint32_t block_size  = ext4_superblock_get_block_size(sb);
@@ -1553,7 +1696,7 @@ errno_t ext4_filesystem_truncate_inode(ext4_inode_ref_t *inode_ref,
 	    EXT4_FEATURE_INCOMPAT_EXTENTS)) &&
 	    (ext4_inode_has_flag(inode_ref->inode, EXT4_INODE_FLAG_EXTENTS))) {
 		/* Extents require special operation */
-		errno_t rc = ext4_extent_release_blocks_from(inode_ref,
+		rc = ext4_extent_release_blocks_from(inode_ref,
 		    old_blocks_count - diff_blocks_count);
 		if (rc != EOK)
 			return rc;
@@ -1562,7 +1705,7 @@ errno_t ext4_filesystem_truncate_inode(ext4_inode_ref_t *inode_ref,
 
 		/* Starting from 1 because of logical blocks are numbered from 0 */
 		for (uint32_t i = 1; i <= diff_blocks_count; ++i) {
-			errno_t rc = ext4_filesystem_release_inode_block(inode_ref,
+			rc = ext4_filesystem_release_inode_block(inode_ref,
 			    old_blocks_count - i);
 			if (rc != EOK)
 				return rc;
@@ -1767,7 +1910,7 @@ errno_t ext4_filesystem_set_inode_data_block_index(ext4_inode_ref_t *inode_ref,
 
 		/* Initialize new block */
 		memset(new_block->data, 0, block_size);
-		new_block->dirty = true;
+		ext4_journal_dirty(fs, new_block);
 
 		/* Put back the allocated block */
 		rc = block_put(new_block);
@@ -1807,7 +1950,7 @@ errno_t ext4_filesystem_set_inode_data_block_index(ext4_inode_ref_t *inode_ref,
 
 			/* Initialize allocated block */
 			memset(new_block->data, 0, block_size);
-			new_block->dirty = true;
+			ext4_journal_dirty(fs, new_block);
 
 			rc = block_put(new_block);
 			if (rc != EOK) {
@@ -1818,7 +1961,7 @@ errno_t ext4_filesystem_set_inode_data_block_index(ext4_inode_ref_t *inode_ref,
 			/* Write block address to the parent */
 			((uint32_t *) block->data)[offset_in_block] =
 			    host2uint32_t_le(new_block_addr);
-			block->dirty = true;
+			ext4_journal_dirty(fs, block);
 			current_block = new_block_addr;
 		}
 
@@ -1826,7 +1969,7 @@ errno_t ext4_filesystem_set_inode_data_block_index(ext4_inode_ref_t *inode_ref,
 		if (level == 1) {
 			((uint32_t *) block->data)[offset_in_block] =
 			    host2uint32_t_le(fblock);
-			block->dirty = true;
+			ext4_journal_dirty(fs, block);
 		}
 
 		rc = block_put(block);
@@ -1927,7 +2070,7 @@ errno_t ext4_filesystem_release_inode_block(ext4_inode_ref_t *inode_ref,
 		if (level == 1) {
 			((uint32_t *) block->data)[offset_in_block] =
 			    host2uint32_t_le(0);
-			block->dirty = true;
+			ext4_journal_dirty(fs, block);
 		}
 
 		rc = block_put(block);
@@ -41,6 +41,7 @@
 #include "ext4/block_group.h"
 #include "ext4/filesystem.h"
 #include "ext4/ialloc.h"
+#include "ext4/journal.h"
 #include "ext4/superblock.h"
 
 /** Convert i-node number to relative index in block group.
@@ -119,7 +120,7 @@ errno_t ext4_ialloc_free_inode(ext4_filesystem_t *fs, uint32_t index, bool is_di
 	/* Free i-node in the bitmap */
 	uint32_t index_in_group = ext4_ialloc_inode2index_in_group(sb, index);
 	ext4_bitmap_free_bit(bitmap_block->data, index_in_group);
-	bitmap_block->dirty = true;
+	ext4_journal_dirty(fs, bitmap_block);
 
 	/* Put back the block with bitmap */
 	rc = block_put(bitmap_block);
@@ -190,6 +191,19 @@ retry:
 
 	/* Try to find free i-node in all block groups */
 	while (bgid < bg_count) {
+		/* Skip groups the summary shows are not candidates */
+		if (fs->group_summary != NULL) {
+			ext4_group_summary_t *summary = &fs->group_summary[bgid];
+
+			if (summary->free_inodes == 0 ||
+			    summary->free_blocks == 0 ||
+			    (summary->free_inodes < avg_free_inodes &&
+			    bgid != bg_count - 1 && !pick_first_free)) {
+				++bgid;
+				continue;
+			}
+		}
+
 		/* Load block group to check */
 		ext4_block_group_ref_t *bg_ref;
 		errno_t rc = ext4_filesystem_get_block_group_ref(fs, bgid, &bg_ref);
@@ -252,7 +266,7 @@ retry:
 			}
 
 			/* Free i-node found, save the bitmap */
-			bitmap_block->dirty = true;
+			ext4_journal_dirty(fs, bitmap_block);
 
 			rc = block_put(bitmap_block);
 			if (rc != EOK) {
@@ -367,7 +381,7 @@ errno_t ext4_ialloc_alloc_this_inode(ext4_filesystem_t *fs, uint32_t inode,
 	ext4_bitmap_set_bit(bitmap_block->data, index_in_group);
 
 	/* Save the bitmap */
-	bitmap_block->dirty = true;
+	ext4_journal_dirty(fs, bitmap_block);
 
 	rc = block_put(bitmap_block);
 	if (rc != EOK) {
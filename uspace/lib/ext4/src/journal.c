@@ -0,0 +1,1732 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libext4
+ * @{
+ */
+/**
+ * @file  journal.c
+ * @brief JBD2 compatible metadata journal.
+ *
+ * Metadata blocks modified by file system operations are pinned in the
+ * block cache and collected into the running transaction. Operations are
+ * bracketed by handles and a transaction is committed only when no handle
+ * is running, so that it always contains whole operations.
+ *
+ * Commit writes copies of the blocks to the log, followed by a commit
+ * block. Writing the blocks to their home locations (checkpoint) is
+ * deferred until the log fills up, so that blocks modified by many
+ * transactions, such as bitmaps and group descriptors, are written home
+ * only once.
+ *
+ * Blocks freed by an operation stay out of the allocator until the
+ * transaction that freed them commits. Operations are kept small enough for
+ * their transaction to fit in the log, which is therefore never bypassed.
+ */
+
+#include <assert.h>
+#include <byteorder.h>
+#include <errno.h>
+#include <fibril.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdlib.h>
+#include "ext4/filesystem.h"
+#include "ext4/inode.h"
+#include "ext4/journal.h"
+#include "ext4/superblock.h"
+
+/** Interval between commits of the running transaction (usec) */
+#define EXT4_JOURNAL_COMMIT_INTERVAL  (5 * 1000 * 1000)
+
+/** Maximum number of blocks transferred to the device at once */
+#define EXT4_JOURNAL_IO_BLOCKS  32
+
+/** Number of pinned committed blocks that forces a checkpoint */
+#define EXT4_JOURNAL_MAX_PINNED  4096
+
+/** Incompatible journal features understood by recovery */
+#define EXT4_JOURNAL_INCOMPAT_SUPP \
+	(EXT4_JOURNAL_FEATURE_INCOMPAT_REVOKE | \
+	EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT | \
+	EXT4_JOURNAL_FEATURE_INCOMPAT_ASYNC_COMMIT | \
+	EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V2 | \
+	EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V3)
+
+/** Incompatible journal features that prevent writing to the journal */
+#define EXT4_JOURNAL_INCOMPAT_NOWRITE \
+	(EXT4_JOURNAL_FEATURE_INCOMPAT_ASYNC_COMMIT | \
+	EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V2 | \
+	EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V3)
+
+/** Recovery passes */
+typedef enum {
+	EXT4_JOURNAL_PASS_SCAN,
+	EXT4_JOURNAL_PASS_REVOKE,
+	EXT4_JOURNAL_PASS_REPLAY
+} ext4_journal_pass_t;
+
+/** Block revoked in the log, used during recovery */
+typedef struct {
+	ht_link_t link;
+	uint64_t blocknr;
+	uint32_t tid;     /* Last transaction revoking the block */
+} ext4_journal_revoke_t;
+
+/** Recovery state */
+typedef struct {
+	hash_table_t revoked;
+	uint32_t end_tid;  /* First transaction not committed in the log */
+	uint8_t *buf;      /* Buffer for log blocks */
+	uint8_t *data;     /* Buffer for data blocks */
+} ext4_journal_recovery_t;
+
+static errno_t ext4_journal_commit_fibril(void *);
+
+/** Compare transaction IDs, taking wrap-around into account. */
+static bool ext4_journal_tid_lt(uint32_t a, uint32_t b)
+{
+	return (int32_t) (a - b) < 0;
+}
+
+static size_t ext4_journal_block_key_hash(const void *key)
+{
+	const aoff64_t *lba = key;
+	return *lba;
+}
+
+static size_t ext4_journal_block_hash(const ht_link_t *item)
+{
+	ext4_journal_block_t *jb =
+	    hash_table_get_inst(item, ext4_journal_block_t, link);
+	return jb->lba;
+}
+
+static bool ext4_journal_block_key_equal(const void *key, size_t hash,
+    const ht_link_t *item)
+{
+	const aoff64_t *lba = key;
+	ext4_journal_block_t *jb =
+	    hash_table_get_inst(item, ext4_journal_block_t, link);
+	return jb->lba == *lba;
+}
+
+static const hash_table_ops_t ext4_journal_block_ops = {
+	.hash = ext4_journal_block_hash,
+	.key_hash = ext4_journal_block_key_hash,
+	.key_equal = ext4_journal_block_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+static size_t ext4_journal_revoke_key_hash(const void *key)
+{
+	const uint64_t *blocknr = key;
+	return *blocknr;
+}
+
+static size_t ext4_journal_revoke_hash(const ht_link_t *item)
+{
+	ext4_journal_revoke_t *rev =
+	    hash_table_get_inst(item, ext4_journal_revoke_t, link);
+	return rev->blocknr;
+}
+
+static bool ext4_journal_revoke_key_equal(const void *key, size_t hash,
+    const ht_link_t *item)
+{
+	const uint64_t *blocknr = key;
+	ext4_journal_revoke_t *rev =
+	    hash_table_get_inst(item, ext4_journal_revoke_t, link);
+	return rev->blocknr == *blocknr;
+}
+
+static void ext4_journal_revoke_remove(ht_link_t *item)
+{
+	free(hash_table_get_inst(item, ext4_journal_revoke_t, link));
+}
+
+static const hash_table_ops_t ext4_journal_revoke_ops = {
+	.hash = ext4_journal_revoke_hash,
+	.key_hash = ext4_journal_revoke_key_hash,
+	.key_equal = ext4_journal_revoke_key_equal,
+	.equal = NULL,
+	.remove_callback = ext4_journal_revoke_remove
+};
+
+/** Get the log block following a given one.
+ *
+ * @param j      Journal
+ * @param jblock Log block
+ *
+ * @return Next log block, wrapping around the end of the journal
+ *
+ */
+static uint32_t ext4_journal_next(ext4_journal_t *j, uint32_t jblock)
+{
+	if (++jblock >= j->maxlen)
+		jblock = j->first;
+
+	return jblock;
+}
+
+/** Read a block of the journal.
+ *
+ * @param j      Journal
+ * @param jblock Block number relative to the start of the journal
+ * @param buf    Buffer of block size
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_read_block(ext4_journal_t *j, uint32_t jblock,
+    void *buf)
+{
+	return block_read_direct(j->fs->device,
+	    (aoff64_t) j->map[jblock] * j->dev_blocks, j->dev_blocks, buf);
+}
+
+/** Flush volatile write cache of the device.
+ *
+ * @param j Journal
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_flush_device(ext4_journal_t *j)
+{
+	errno_t rc = block_sync_cache(j->fs->device, 0, 0);
+	if (rc == ENOTSUP)
+		return EOK;
+
+	return rc;
+}
+
+/** Write journal superblock.
+ *
+ * @param j        Journal
+ * @param start    First log block of the oldest live transaction,
+ *                 zero if the log is empty
+ * @param sequence ID of the transaction at start
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_write_sb(ext4_journal_t *j, uint32_t start,
+    uint32_t sequence)
+{
+	j->sb->start = host2uint32_t_be(start);
+	j->sb->sequence = host2uint32_t_be(sequence);
+
+	errno_t rc = block_write_direct(j->fs->device,
+	    (aoff64_t) j->map[0] * j->dev_blocks, j->dev_blocks, j->sb);
+	if (rc != EOK)
+		return rc;
+
+	return ext4_journal_flush_device(j);
+}
+
+/** Write log blocks gathered in the I/O buffer.
+ *
+ * @param j Journal
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_log_flush(ext4_journal_t *j)
+{
+	if (j->iobuf_count == 0)
+		return EOK;
+
+	errno_t rc = block_write_direct(j->fs->device,
+	    (aoff64_t) j->map[j->iobuf_start] * j->dev_blocks,
+	    j->iobuf_count * j->dev_blocks, j->iobuf);
+	j->iobuf_count = 0;
+	return rc;
+}
+
+/** Get buffer for the next log block.
+ *
+ * Log blocks that are physically contiguous are written with a single
+ * transfer. The returned buffer is valid until the next call.
+ *
+ * @param j   Journal
+ * @param buf Output pointer to block-sized buffer
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_log_next(ext4_journal_t *j, uint8_t **buf)
+{
+	if (j->iobuf_count > 0) {
+		uint32_t last = j->iobuf_start + j->iobuf_count - 1;
+
+		if ((j->iobuf_count == EXT4_JOURNAL_IO_BLOCKS) ||
+		    (last + 1 != j->head) ||
+		    (j->map[j->head] != j->map[last] + 1)) {
+			errno_t rc = ext4_journal_log_flush(j);
+			if (rc != EOK)
+				return rc;
+		}
+	}
+
+	if (j->iobuf_count == 0)
+		j->iobuf_start = j->head;
+
+	*buf = j->iobuf + j->iobuf_count * j->block_size;
+	memset(*buf, 0, j->block_size);
+	j->iobuf_count++;
+
+	j->head = ext4_journal_next(j, j->head);
+	j->used++;
+	return EOK;
+}
+
+/** Initialize header of a journal block.
+ *
+ * @param buf  Block buffer
+ * @param type Block type
+ * @param tid  Transaction ID
+ *
+ */
+static void ext4_journal_header_init(uint8_t *buf, uint32_t type, uint32_t tid)
+{
+	ext4_journal_header_t *header = (ext4_journal_header_t *) buf;
+
+	header->magic = host2uint32_t_be(EXT4_JOURNAL_MAGIC);
+	header->blocktype = host2uint32_t_be(type);
+	header->sequence = host2uint32_t_be(tid);
+}
+
+/** Size of revoke record in bytes. */
+static size_t ext4_journal_revoke_record_size(ext4_journal_t *j)
+{
+	if (j->incompat & EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT)
+		return sizeof(uint64_t);
+
+	return sizeof(uint32_t);
+}
+
+/** Usable space in descriptor and revoke blocks. */
+static size_t ext4_journal_block_limit(ext4_journal_t *j)
+{
+	if (j->incompat & (EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V2 |
+	    EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V3))
+		return j->block_size - sizeof(uint32_t);
+
+	return j->block_size;
+}
+
+/** Number of tags fitting into one descriptor block. */
+static size_t ext4_journal_tags_per_block(ext4_journal_t *j)
+{
+	/* The first tag is followed by the journal UUID */
+	return (ext4_journal_block_limit(j) - sizeof(ext4_journal_header_t) -
+	    sizeof(j->sb->uuid)) / j->tag_size;
+}
+
+/** Compute number of log blocks needed to commit running transaction. */
+static size_t ext4_journal_commit_size(ext4_journal_t *j)
+{
+	size_t tags = ext4_journal_tags_per_block(j);
+	size_t records = (ext4_journal_block_limit(j) -
+	    sizeof(ext4_journal_revoke_header_t)) /
+	    ext4_journal_revoke_record_size(j);
+
+	return j->running_count + (j->running_count + tags - 1) / tags +
+	    (j->revoked_count + records - 1) / records + 1;
+}
+
+/** Store descriptor tag.
+ *
+ * @param j       Journal
+ * @param dst     Place to store the tag to
+ * @param blocknr Home location of the block
+ * @param flags   Tag flags
+ *
+ */
+static void ext4_journal_tag_write(ext4_journal_t *j, uint8_t *dst,
+    uint64_t blocknr, uint32_t flags)
+{
+	ext4_journal_tag_t tag;
+
+	memset(&tag, 0, sizeof(tag));
+	tag.blocknr = host2uint32_t_be((uint32_t) blocknr);
+	tag.flags = host2uint16_t_be((uint16_t) flags);
+	tag.blocknr_high = host2uint32_t_be((uint32_t) (blocknr >> 32));
+
+	memcpy(dst, &tag, j->tag_size);
+}
+
+/** Load descriptor tag.
+ *
+ * @param j       Journal
+ * @param src     Tag in the descriptor block
+ * @param blocknr Output value for home location of the block
+ * @param flags   Output value for tag flags
+ *
+ */
+static void ext4_journal_tag_read(ext4_journal_t *j, const uint8_t *src,
+    uint64_t *blocknr, uint32_t *flags)
+{
+	uint64_t high = 0;
+
+	if (j->incompat & EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V3) {
+		ext4_journal_tag3_t tag;
+
+		memcpy(&tag, src, sizeof(tag));
+		*flags = uint32_t_be2host(tag.flags);
+		*blocknr = uint32_t_be2host(tag.blocknr);
+		high = uint32_t_be2host(tag.blocknr_high);
+	} else {
+		ext4_journal_tag_t tag;
+
+		memset(&tag, 0, sizeof(tag));
+		memcpy(&tag, src, min(j->tag_size, sizeof(tag)));
+		*flags = uint16_t_be2host(tag.flags);
+		*blocknr = uint32_t_be2host(tag.blocknr);
+		high = uint32_t_be2host(tag.blocknr_high);
+	}
+
+	if (j->incompat & EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT)
+		*blocknr |= high << 32;
+}
+
+/** Make blocks freed by a committed transaction available for allocation.
+ *
+ * @param j Journal
+ *
+ */
+static void ext4_journal_release_freed(ext4_journal_t *j)
+{
+	ext4_filesystem_t *fs = j->fs;
+
+	while (!list_empty(&j->freed)) {
+		ext4_journal_freed_t *fr = list_get_instance(
+		    list_first(&j->freed), ext4_journal_freed_t, link);
+		list_remove(&fr->link);
+
+		if (fs->group_summary != NULL) {
+			/* Free runs clipped by the blocks may be longer now */
+			uint32_t bgid = ext4_filesystem_blockaddr2group(
+			    fs->superblock, fr->start);
+			uint32_t last = ext4_filesystem_blockaddr2group(
+			    fs->superblock, fr->start + fr->count - 1);
+
+			for (; bgid <= last; bgid++) {
+				fs->group_summary[bgid].max_run =
+				    fs->group_summary[bgid].free_blocks;
+			}
+		}
+
+		free(fr);
+	}
+}
+
+/** Write running transaction to the log.
+ *
+ * On success the blocks of the transaction become part of the checkpoint
+ * list and a new transaction is started. On failure the transaction stays
+ * running and the log is left as it was.
+ *
+ * @param j Journal
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_write_transaction(ext4_journal_t *j)
+{
+	size_t per_desc = ext4_journal_tags_per_block(j);
+	size_t rec_size = ext4_journal_revoke_record_size(j);
+	size_t limit = ext4_journal_block_limit(j);
+	uint32_t start = j->head;
+	uint32_t used = j->used;
+	uint8_t *buf;
+	errno_t rc;
+
+	link_t *link = list_first(&j->running);
+	while (link != NULL) {
+		/* Descriptor block followed by the blocks it describes */
+		uint8_t *desc;
+		rc = ext4_journal_log_next(j, &desc);
+		if (rc != EOK)
+			goto error;
+
+		ext4_journal_header_init(desc, EXT4_JOURNAL_BT_DESCRIPTOR,
+		    j->tid);
+
+		link_t *first = link;
+		size_t off = sizeof(ext4_journal_header_t);
+		size_t count;
+
+		for (count = 0; count < per_desc && link != NULL; count++) {
+			ext4_journal_block_t *jb = list_get_instance(link,
+			    ext4_journal_block_t, tlink);
+			link = list_next(link, &j->running);
+
+			uint32_t flags = 0;
+			if (count > 0)
+				flags |= EXT4_JOURNAL_FLAG_SAME_UUID;
+			if (link == NULL || count + 1 == per_desc)
+				flags |= EXT4_JOURNAL_FLAG_LAST_TAG;
+			if (uint32_t_be2host(*(uint32_t *) jb->block->data) ==
+			    EXT4_JOURNAL_MAGIC)
+				flags |= EXT4_JOURNAL_FLAG_ESCAPE;
+
+			ext4_journal_tag_write(j, desc + off, jb->lba, flags);
+			off += j->tag_size;
+
+			if (count == 0) {
+				memcpy(desc + off, j->sb->uuid,
+				    sizeof(j->sb->uuid));
+				off += sizeof(j->sb->uuid);
+			}
+		}
+
+		link = first;
+		for (size_t i = 0; i < count; i++) {
+			ext4_journal_block_t *jb = list_get_instance(link,
+			    ext4_journal_block_t, tlink);
+			link = list_next(link, &j->running);
+
+			rc = ext4_journal_log_next(j, &buf);
+			if (rc != EOK)
+				goto error;
+
+			memcpy(buf, jb->block->data, j->block_size);
+			if (uint32_t_be2host(*(uint32_t *) buf) ==
+			    EXT4_JOURNAL_MAGIC)
+				memset(buf, 0, sizeof(uint32_t));
+		}
+	}
+
+	/* Revoke records */
+	size_t i = 0;
+	while (i < j->revoked_count) {
+		rc = ext4_journal_log_next(j, &buf);
+		if (rc != EOK)
+			goto error;
+
+		ext4_journal_header_init(buf, EXT4_JOURNAL_BT_REVOKE, j->tid);
+
+		size_t off = sizeof(ext4_journal_revoke_header_t);
+		while (i < j->revoked_count && off + rec_size <= limit) {
+			if (rec_size == sizeof(uint64_t)) {
+				uint64_t rec = host2uint64_t_be(j->revoked[i]);
+				memcpy(buf + off, &rec, sizeof(rec));
+			} else {
+				uint32_t rec = host2uint32_t_be(j->revoked[i]);
+				memcpy(buf + off, &rec, sizeof(rec));
+			}
+
+			off += rec_size;
+			i++;
+		}
+
+		ext4_journal_revoke_header_t *rh =
+		    (ext4_journal_revoke_header_t *) buf;
+		rh->count = host2uint32_t_be(off);
+	}
+
+	rc = ext4_journal_log_flush(j);
+	if (rc != EOK)
+		goto error;
+
+	/* Make the log live before its first transaction is committed */
+	if (j->sb->start == 0) {
+		rc = ext4_journal_write_sb(j, start, j->tid);
+	} else {
+		rc = ext4_journal_flush_device(j);
+	}
+
+	if (rc != EOK)
+		goto error;
+
+	/* Commit block makes the transaction valid */
+	rc = ext4_journal_log_next(j, &buf);
+	if (rc != EOK)
+		goto error;
+
+	ext4_journal_header_init(buf, EXT4_JOURNAL_BT_COMMIT, j->tid);
+
+	rc = ext4_journal_log_flush(j);
+	if (rc != EOK)
+		goto error;
+
+	rc = ext4_journal_flush_device(j);
+	if (rc != EOK)
+		goto error;
+
+	/* Blocks now wait for checkpoint */
+	list_foreach(j->running, tlink, ext4_journal_block_t, jb) {
+		jb->logged = true;
+	}
+
+	list_concat(&j->checkpoint, &j->running);
+	j->checkpoint_count += j->running_count;
+	j->running_count = 0;
+	j->revoked_count = 0;
+	j->tid++;
+
+	/* The revoke records are durable, freed blocks can be reused */
+	ext4_journal_release_freed(j);
+
+	return EOK;
+error:
+	j->iobuf_count = 0;
+	j->head = start;
+	j->used = used;
+	return rc;
+}
+
+static int ext4_journal_block_cmp(const void *a, const void *b)
+{
+	ext4_journal_block_t *ja = *(ext4_journal_block_t **) a;
+	ext4_journal_block_t *jb = *(ext4_journal_block_t **) b;
+
+	if (ja->lba < jb->lba)
+		return -1;
+	if (ja->lba > jb->lba)
+		return 1;
+	return 0;
+}
+
+/** Release tracked block.
+ *
+ * @param j  Journal
+ * @param jb Block to release
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_block_release(ext4_journal_t *j,
+    ext4_journal_block_t *jb)
+{
+	errno_t rc = EOK;
+
+	hash_table_remove_item(&j->blocks, &jb->link);
+	list_remove(&jb->tlink);
+
+	if (jb->block != NULL)
+		rc = block_put(jb->block);
+
+	free(jb);
+	return rc;
+}
+
+/** Write committed blocks to their home locations and empty the log.
+ *
+ * Blocks of the running transaction stay pinned, they reach their home
+ * locations only after being committed.
+ *
+ * @param j Journal
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_checkpoint(ext4_journal_t *j)
+{
+	size_t count = j->checkpoint_count;
+	ext4_journal_block_t **blocks = NULL;
+	size_t n = 0;
+	errno_t rc;
+
+	if (count > 0) {
+		blocks = calloc(count, sizeof(ext4_journal_block_t *));
+		if (blocks == NULL)
+			return ENOMEM;
+	}
+
+	list_foreach(j->checkpoint, tlink, ext4_journal_block_t, jb) {
+		if (jb->block != NULL)
+			blocks[n++] = jb;
+	}
+
+	assert(n == count);
+	qsort(blocks, n, sizeof(ext4_journal_block_t *),
+	    ext4_journal_block_cmp);
+
+	/* Coalesce writes of adjacent blocks */
+	size_t i = 0;
+	while (i < n) {
+		size_t run = 1;
+		while (i + run < n && run < EXT4_JOURNAL_IO_BLOCKS &&
+		    blocks[i + run]->lba == blocks[i]->lba + run)
+			run++;
+
+		for (size_t k = 0; k < run; k++) {
+			memcpy(j->iobuf + k * j->block_size,
+			    blocks[i + k]->block->data, j->block_size);
+		}
+
+		rc = block_write_direct(j->fs->device, blocks[i]->block->pba,
+		    run * j->dev_blocks, j->iobuf);
+		if (rc != EOK)
+			goto out;
+
+		i += run;
+	}
+
+	rc = ext4_journal_flush_device(j);
+	if (rc != EOK)
+		goto out;
+
+	rc = ext4_journal_write_sb(j, 0, j->tid);
+	if (rc != EOK)
+		goto out;
+
+	/* The blocks are clean now, unpin them */
+	for (i = 0; i < n; i++) {
+		fibril_mutex_lock(&blocks[i]->block->lock);
+		blocks[i]->block->dirty = false;
+		fibril_mutex_unlock(&blocks[i]->block->lock);
+	}
+
+	while (!list_empty(&j->checkpoint)) {
+		(void) ext4_journal_block_release(j, list_get_instance(
+		    list_first(&j->checkpoint), ext4_journal_block_t, tlink));
+	}
+
+	j->checkpoint_count = 0;
+	j->used = 0;
+	rc = EOK;
+out:
+	free(blocks);
+	return rc;
+}
+
+/** Commit running transaction.
+ *
+ * Waits for running handles to finish. Must be called with the journal
+ * lock held.
+ *
+ * @param j Journal
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_commit_locked(ext4_journal_t *j)
+{
+	errno_t rc;
+
+	while (j->committing)
+		fibril_condvar_wait(&j->cv, &j->lock);
+
+	if (j->running_count == 0 && j->revoked_count == 0)
+		return EOK;
+
+	j->committing = true;
+	while (j->handles > 0)
+		fibril_condvar_wait(&j->cv, &j->lock);
+
+	size_t size = ext4_journal_commit_size(j);
+	rc = EOK;
+	if (size > j->maxlen - j->first - j->used) {
+		/* Make room in the log */
+		rc = ext4_journal_checkpoint(j);
+	}
+
+	if (rc == EOK && size > j->maxlen - j->first) {
+		/*
+		 * Operations are split so that this does not happen. Should
+		 * it, the transaction stays running rather than being written
+		 * home without the protection of the log.
+		 */
+		rc = ENOSPC;
+	}
+
+	if (rc == EOK) {
+		rc = ext4_journal_write_transaction(j);
+		if (rc == EOK &&
+		    (j->used > (j->maxlen - j->first) / 2 ||
+		    j->checkpoint_count > EXT4_JOURNAL_MAX_PINNED))
+			rc = ext4_journal_checkpoint(j);
+	}
+
+	j->committing = false;
+	fibril_condvar_broadcast(&j->cv);
+	return rc;
+}
+
+/** Fibril committing the running transaction periodically.
+ *
+ * @param arg Journal
+ *
+ * @return EOK
+ *
+ */
+static errno_t ext4_journal_commit_fibril(void *arg)
+{
+	ext4_journal_t *j = (ext4_journal_t *) arg;
+
+	fibril_mutex_lock(&j->lock);
+	while (!j->stop) {
+		(void) fibril_condvar_wait_timeout(&j->timer_cv, &j->lock,
+		    EXT4_JOURNAL_COMMIT_INTERVAL);
+		if (j->stop)
+			break;
+
+		(void) ext4_journal_commit_locked(j);
+	}
+
+	j->fibril_running = false;
+	fibril_condvar_broadcast(&j->timer_cv);
+	fibril_mutex_unlock(&j->lock);
+
+	return EOK;
+}
+
+/** Check whether block was revoked during recovery.
+ *
+ * @param rec     Recovery state
+ * @param blocknr Home location of the block
+ * @param tid     Transaction containing copy of the block
+ *
+ * @return True if the copy must not be replayed
+ *
+ */
+static bool ext4_journal_is_revoked(ext4_journal_recovery_t *rec,
+    uint64_t blocknr, uint32_t tid)
+{
+	ht_link_t *link = hash_table_find(&rec->revoked, &blocknr);
+	if (link == NULL)
+		return false;
+
+	ext4_journal_revoke_t *rev =
+	    hash_table_get_inst(link, ext4_journal_revoke_t, link);
+	return !ext4_journal_tid_lt(rev->tid, tid);
+}
+
+/** Record revoke records of a revoke block during recovery.
+ *
+ * @param j   Journal
+ * @param rec Recovery state
+ * @param tid Transaction of the revoke block
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_scan_revoke(ext4_journal_t *j,
+    ext4_journal_recovery_t *rec, uint32_t tid)
+{
+	ext4_journal_revoke_header_t *rh =
+	    (ext4_journal_revoke_header_t *) rec->buf;
+	size_t rec_size = ext4_journal_revoke_record_size(j);
+	size_t end = min(uint32_t_be2host(rh->count),
+	    ext4_journal_block_limit(j));
+
+	for (size_t off = sizeof(*rh); off + rec_size <= end;
+	    off += rec_size) {
+		uint64_t blocknr;
+
+		if (rec_size == sizeof(uint64_t)) {
+			uint64_t val;
+			memcpy(&val, rec->buf + off, sizeof(val));
+			blocknr = uint64_t_be2host(val);
+		} else {
+			uint32_t val;
+			memcpy(&val, rec->buf + off, sizeof(val));
+			blocknr = uint32_t_be2host(val);
+		}
+
+		ht_link_t *link = hash_table_find(&rec->revoked, &blocknr);
+		if (link != NULL) {
+			ext4_journal_revoke_t *rev = hash_table_get_inst(link,
+			    ext4_journal_revoke_t, link);
+			if (ext4_journal_tid_lt(rev->tid, tid))
+				rev->tid = tid;
+			continue;
+		}
+
+		ext4_journal_revoke_t *rev = malloc(sizeof(*rev));
+		if (rev == NULL)
+			return ENOMEM;
+
+		rev->blocknr = blocknr;
+		rev->tid = tid;
+		hash_table_insert(&rec->revoked, &rev->link);
+	}
+
+	return EOK;
+}
+
+/** Write a logged copy of a block to its home location.
+ *
+ * The block is written through the block cache, so that the cache stays
+ * coherent with the device.
+ *
+ * @param j       Journal
+ * @param blocknr Home location
+ * @param data    Block contents
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_replay_block(ext4_journal_t *j, uint64_t blocknr,
+    const void *data)
+{
+	if (blocknr >= ext4_superblock_get_blocks_count(j->fs->superblock))
+		return EOK;
+
+	block_t *block;
+	errno_t rc = block_get(&block, j->fs->device, blocknr,
+	    BLOCK_FLAGS_NOREAD);
+	if (rc != EOK)
+		return rc;
+
+	memcpy(block->data, data, j->block_size);
+	rc = block_write_direct(j->fs->device, block->pba, j->dev_blocks,
+	    block->data);
+
+	errno_t rc2 = block_put(block);
+	return rc != EOK ? rc : rc2;
+}
+
+/** Perform one pass over the log.
+ *
+ * The scan pass finds the end of the last committed transaction, the revoke
+ * pass collects revoked blocks and the replay pass writes logged blocks
+ * to their home locations.
+ *
+ * @param j    Journal
+ * @param rec  Recovery state
+ * @param pass Pass to perform
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_recover_pass(ext4_journal_t *j,
+    ext4_journal_recovery_t *rec, ext4_journal_pass_t pass)
+{
+	uint32_t jblock = uint32_t_be2host(j->sb->start);
+	uint32_t tid = uint32_t_be2host(j->sb->sequence);
+	uint32_t walked = 0;
+	size_t limit = ext4_journal_block_limit(j);
+	errno_t rc;
+
+	while (walked < j->maxlen) {
+		if (pass != EXT4_JOURNAL_PASS_SCAN && tid == rec->end_tid)
+			break;
+
+		rc = ext4_journal_read_block(j, jblock, rec->buf);
+		if (rc != EOK)
+			return rc;
+
+		ext4_journal_header_t *header =
+		    (ext4_journal_header_t *) rec->buf;
+		if (uint32_t_be2host(header->magic) != EXT4_JOURNAL_MAGIC ||
+		    uint32_t_be2host(header->sequence) != tid)
+			break;
+
+		uint32_t type = uint32_t_be2host(header->blocktype);
+		jblock = ext4_journal_next(j, jblock);
+		walked++;
+
+		if (type == EXT4_JOURNAL_BT_COMMIT) {
+			tid++;
+			continue;
+		}
+
+		if (type == EXT4_JOURNAL_BT_REVOKE) {
+			if (pass == EXT4_JOURNAL_PASS_REVOKE) {
+				rc = ext4_journal_scan_revoke(j, rec, tid);
+				if (rc != EOK)
+					return rc;
+			}
+
+			continue;
+		}
+
+		if (type != EXT4_JOURNAL_BT_DESCRIPTOR)
+			break;
+
+		size_t off = sizeof(ext4_journal_header_t);
+		while (off + j->tag_size <= limit) {
+			uint64_t blocknr;
+			uint32_t flags;
+
+			ext4_journal_tag_read(j, rec->buf + off, &blocknr,
+			    &flags);
+			off += j->tag_size;
+			if ((flags & EXT4_JOURNAL_FLAG_SAME_UUID) == 0)
+				off += sizeof(j->sb->uuid);
+
+			if (pass == EXT4_JOURNAL_PASS_REPLAY &&
+			    !ext4_journal_is_revoked(rec, blocknr, tid)) {
+				rc = ext4_journal_read_block(j, jblock,
+				    rec->data);
+				if (rc != EOK)
+					return rc;
+
+				if (flags & EXT4_JOURNAL_FLAG_ESCAPE) {
+					uint32_t magic =
+					    host2uint32_t_be(EXT4_JOURNAL_MAGIC);
+					memcpy(rec->data, &magic, sizeof(magic));
+				}
+
+				rc = ext4_journal_replay_block(j, blocknr,
+				    rec->data);
+				if (rc != EOK)
+					return rc;
+			}
+
+			jblock = ext4_journal_next(j, jblock);
+			walked++;
+
+			if (flags & EXT4_JOURNAL_FLAG_LAST_TAG)
+				break;
+		}
+	}
+
+	if (pass == EXT4_JOURNAL_PASS_SCAN)
+		rec->end_tid = tid;
+
+	return EOK;
+}
+
+/** Replay committed transactions found in the log.
+ *
+ * @param j Journal
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_recover(ext4_journal_t *j)
+{
+	ext4_journal_recovery_t rec;
+	errno_t rc;
+
+	if (!hash_table_create(&rec.revoked, 0, 0, &ext4_journal_revoke_ops))
+		return ENOMEM;
+
+	rec.buf = malloc(j->block_size);
+	rec.data = malloc(j->block_size);
+	if (rec.buf == NULL || rec.data == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	rc = ext4_journal_recover_pass(j, &rec, EXT4_JOURNAL_PASS_SCAN);
+	if (rc != EOK)
+		goto out;
+
+	rc = ext4_journal_recover_pass(j, &rec, EXT4_JOURNAL_PASS_REVOKE);
+	if (rc != EOK)
+		goto out;
+
+	rc = ext4_journal_recover_pass(j, &rec, EXT4_JOURNAL_PASS_REPLAY);
+	if (rc != EOK)
+		goto out;
+
+	rc = ext4_journal_flush_device(j);
+	if (rc != EOK)
+		goto out;
+
+	/* The log is empty now */
+	rc = ext4_journal_write_sb(j, 0, rec.end_tid);
+out:
+	free(rec.buf);
+	free(rec.data);
+	hash_table_destroy(&rec.revoked);
+	return rc;
+}
+
+/** Load journal superblock and the block map of the journal.
+ *
+ * @param j     Journal
+ * @param index Number of the journal i-node
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_load(ext4_journal_t *j, uint32_t index)
+{
+	ext4_inode_ref_t *inode_ref;
+	uint32_t fblock;
+	errno_t rc;
+
+	rc = ext4_filesystem_get_inode_ref(j->fs, index, &inode_ref);
+	if (rc != EOK)
+		return rc;
+
+	uint64_t blocks = ext4_inode_get_size(j->fs->superblock,
+	    inode_ref->inode) / j->block_size;
+	if (blocks < 2) {
+		rc = EINVAL;
+		goto out;
+	}
+
+	rc = ext4_filesystem_get_inode_data_block_index(inode_ref, 0, &fblock);
+	if (rc != EOK)
+		goto out;
+
+	if (fblock == 0) {
+		rc = EINVAL;
+		goto out;
+	}
+
+	rc = block_read_direct(j->fs->device, (aoff64_t) fblock * j->dev_blocks,
+	    j->dev_blocks, j->sb);
+	if (rc != EOK)
+		goto out;
+
+	uint32_t type = uint32_t_be2host(j->sb->header.blocktype);
+	if (uint32_t_be2host(j->sb->header.magic) != EXT4_JOURNAL_MAGIC ||
+	    (type != EXT4_JOURNAL_BT_SB_V1 && type != EXT4_JOURNAL_BT_SB_V2) ||
+	    uint32_t_be2host(j->sb->blocksize) != j->block_size) {
+		rc = EINVAL;
+		goto out;
+	}
+
+	j->maxlen = uint32_t_be2host(j->sb->maxlen);
+	j->first = uint32_t_be2host(j->sb->first);
+	if (j->maxlen > blocks || j->first == 0 || j->first >= j->maxlen) {
+		rc = EINVAL;
+		goto out;
+	}
+
+	j->map = malloc(j->maxlen * sizeof(uint32_t));
+	if (j->map == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	for (uint32_t i = 0; i < j->maxlen; i++) {
+		rc = ext4_filesystem_get_inode_data_block_index(inode_ref, i,
+		    &j->map[i]);
+		if (rc != EOK)
+			goto out;
+
+		if (j->map[i] == 0) {
+			rc = EINVAL;
+			goto out;
+		}
+	}
+
+	if (type == EXT4_JOURNAL_BT_SB_V2) {
+		j->compat = uint32_t_be2host(j->sb->feature_compat);
+		j->incompat = uint32_t_be2host(j->sb->feature_incompat);
+	} else {
+		j->compat = 0;
+		j->incompat = 0;
+	}
+
+	if (j->incompat & EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V3) {
+		/*
+		 * Unlike the older tag, the v3 tag keeps its blocknr_high
+		 * field even without the 64bit feature (see journal_tag_bytes()
+		 * in JBD2), the field is just not used then.
+		 */
+		j->tag_size = sizeof(ext4_journal_tag3_t);
+	} else {
+		j->tag_size = 8;
+		if (j->incompat & EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V2)
+			j->tag_size += sizeof(uint16_t);
+		if (j->incompat & EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT)
+			j->tag_size += sizeof(uint32_t);
+	}
+out:
+	ext4_filesystem_put_inode_ref(inode_ref);
+	return rc;
+}
+
+/** Free journal structure.
+ *
+ * @param j Journal
+ *
+ */
+static void ext4_journal_free(ext4_journal_t *j)
+{
+	free(j->iobuf);
+	free(j->revoked);
+	free(j->map);
+	free(j->sb);
+	free(j);
+}
+
+/** Open the journal of a file system.
+ *
+ * Replays the log if the file system was not unmounted cleanly and starts
+ * journaling of metadata. If the file system has no journal, or the
+ * journal uses features not supported for writing, metadata are written in
+ * place as before.
+ *
+ * @param fs Filesystem
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_journal_init(ext4_filesystem_t *fs)
+{
+	size_t dev_bsize;
+	errno_t rc;
+
+	fs->journal = NULL;
+
+	if (!ext4_superblock_has_feature_compatible(fs->superblock,
+	    EXT4_FEATURE_COMPAT_HAS_JOURNAL))
+		return EOK;
+
+	uint32_t index = ext4_superblock_get_journal_inode_number(
+	    fs->superblock);
+	if (index == 0)
+		return EOK;
+
+	rc = block_get_bsize(fs->device, &dev_bsize);
+	if (rc != EOK)
+		return rc;
+
+	ext4_journal_t *j = calloc(1, sizeof(ext4_journal_t));
+	if (j == NULL)
+		return ENOMEM;
+
+	j->fs = fs;
+	j->block_size = ext4_superblock_get_block_size(fs->superblock);
+	j->dev_blocks = j->block_size / dev_bsize;
+
+	j->sb = malloc(j->block_size);
+	if (j->sb == NULL) {
+		rc = ENOMEM;
+		goto error;
+	}
+
+	rc = ext4_journal_load(j, index);
+	if (rc != EOK)
+		goto error;
+
+	bool dirty = j->sb->start != 0;
+	if (dirty) {
+		if ((j->incompat & ~EXT4_JOURNAL_INCOMPAT_SUPP) != 0) {
+			rc = ENOTSUP;
+			goto error;
+		}
+
+		rc = ext4_journal_recover(j);
+		if (rc != EOK)
+			goto error;
+
+		/* The superblock might have been replayed as well */
+		ext4_superblock_t *sb;
+		rc = ext4_superblock_read_direct(fs->device, &sb);
+		if (rc != EOK)
+			goto error;
+
+		ext4_superblock_release(fs->superblock);
+		fs->superblock = sb;
+	}
+
+	uint32_t features = ext4_superblock_get_features_incompatible(
+	    fs->superblock);
+	ext4_superblock_set_features_incompatible(fs->superblock,
+	    features & ~EXT4_FEATURE_INCOMPAT_RECOVER);
+
+	if (uint32_t_be2host(j->sb->header.blocktype) != EXT4_JOURNAL_BT_SB_V2 ||
+	    (j->compat & EXT4_JOURNAL_FEATURE_COMPAT_CHECKSUM) != 0 ||
+	    (j->incompat & ~EXT4_JOURNAL_INCOMPAT_SUPP) != 0 ||
+	    (j->incompat & EXT4_JOURNAL_INCOMPAT_NOWRITE) != 0) {
+		/* Cannot write this journal, update metadata in place */
+		ext4_journal_free(j);
+		return EOK;
+	}
+
+	j->iobuf = malloc(EXT4_JOURNAL_IO_BLOCKS * j->block_size);
+	if (j->iobuf == NULL) {
+		rc = ENOMEM;
+		goto error;
+	}
+
+	if (!hash_table_create(&j->blocks, 0, 0, &ext4_journal_block_ops)) {
+		rc = ENOMEM;
+		goto error;
+	}
+
+	list_initialize(&j->running);
+	list_initialize(&j->checkpoint);
+	list_initialize(&j->freed);
+	fibril_mutex_initialize(&j->lock);
+	fibril_condvar_initialize(&j->cv);
+	fibril_condvar_initialize(&j->timer_cv);
+
+	j->tid = uint32_t_be2host(j->sb->sequence);
+	j->head = j->first;
+	j->used = 0;
+
+	/* Revoke records are written by commits */
+	j->incompat |= EXT4_JOURNAL_FEATURE_INCOMPAT_REVOKE;
+	j->sb->feature_incompat = host2uint32_t_be(j->incompat);
+
+	rc = ext4_journal_write_sb(j, 0, j->tid);
+	if (rc != EOK) {
+		hash_table_destroy(&j->blocks);
+		goto error;
+	}
+
+	fid_t fid = fibril_create(ext4_journal_commit_fibril, j);
+	if (fid == 0) {
+		hash_table_destroy(&j->blocks);
+		rc = ENOMEM;
+		goto error;
+	}
+
+	j->fibril_running = true;
+	fibril_add_ready(fid);
+
+	fs->journal = j;
+	return EOK;
+error:
+	ext4_journal_free(j);
+	return rc;
+}
+
+/** Commit outstanding transactions and close the journal.
+ *
+ * All journaled blocks are written to their home locations and the log is
+ * marked empty.
+ *
+ * @param fs Filesystem
+ *
+ * @return Error code. On error the journal stays open.
+ *
+ */
+errno_t ext4_journal_fini(ext4_filesystem_t *fs)
+{
+	ext4_journal_t *j = fs->journal;
+	errno_t rc;
+
+	if (j == NULL)
+		return EOK;
+
+	fibril_mutex_lock(&j->lock);
+
+	j->stop = true;
+	fibril_condvar_broadcast(&j->timer_cv);
+	while (j->fibril_running)
+		fibril_condvar_wait(&j->timer_cv, &j->lock);
+
+	rc = ext4_journal_commit_locked(j);
+	if (rc == EOK)
+		rc = ext4_journal_checkpoint(j);
+
+	if (rc != EOK) {
+		fid_t fid = fibril_create(ext4_journal_commit_fibril, j);
+		if (fid != 0) {
+			j->stop = false;
+			j->fibril_running = true;
+			fibril_add_ready(fid);
+		}
+
+		fibril_mutex_unlock(&j->lock);
+		return rc;
+	}
+
+	fibril_mutex_unlock(&j->lock);
+
+	hash_table_destroy(&j->blocks);
+	ext4_journal_free(j);
+	fs->journal = NULL;
+	return EOK;
+}
+
+/** Start a journal handle.
+ *
+ * All metadata modified until the matching ext4_journal_stop() will be
+ * committed in the same transaction. Handles must not be nested.
+ *
+ * @param fs Filesystem
+ *
+ */
+void ext4_journal_start(ext4_filesystem_t *fs)
+{
+	ext4_journal_t *j = fs->journal;
+
+	if (j == NULL)
+		return;
+
+	fibril_mutex_lock(&j->lock);
+	while (j->committing)
+		fibril_condvar_wait(&j->cv, &j->lock);
+	j->handles++;
+	fibril_mutex_unlock(&j->lock);
+}
+
+/** Stop a journal handle.
+ *
+ * Commits the running transaction if it has grown big. The commit waits
+ * for the other running handles and keeps new ones from starting, so that
+ * the transaction cannot outgrow the log under a steady stream of
+ * overlapping operations. A failed commit leaves the transaction running,
+ * so the error resurfaces at the next commit, sync or unmount.
+ *
+ * @param fs Filesystem
+ *
+ */
+void ext4_journal_stop(ext4_filesystem_t *fs)
+{
+	ext4_journal_t *j = fs->journal;
+
+	if (j == NULL)
+		return;
+
+	fibril_mutex_lock(&j->lock);
+
+	assert(j->handles > 0);
+	if (--j->handles == 0)
+		fibril_condvar_broadcast(&j->cv);
+
+	if (!j->committing &&
+	    j->running_count >= (j->maxlen - j->first) / 4)
+		(void) ext4_journal_commit_locked(j);
+
+	fibril_mutex_unlock(&j->lock);
+}
+
+/** Restart a journal handle.
+ *
+ * Lets an operation too big for a single transaction continue in a new
+ * one. The operation must leave consistent metadata behind before calling
+ * this, as the first part can be committed on its own.
+ *
+ * @param fs Filesystem
+ *
+ */
+void ext4_journal_restart(ext4_filesystem_t *fs)
+{
+	ext4_journal_stop(fs);
+	ext4_journal_start(fs);
+}
+
+/** Make blocks freed by the running transaction available.
+ *
+ * Commits the running transaction if it holds freed blocks. Must be called
+ * outside of a handle.
+ *
+ * @param fs Filesystem
+ *
+ * @return True if an allocation that failed for lack of space is worth
+ *         retrying
+ *
+ */
+bool ext4_journal_retry_alloc(ext4_filesystem_t *fs)
+{
+	ext4_journal_t *j = fs->journal;
+
+	if (j == NULL)
+		return false;
+
+	fibril_mutex_lock(&j->lock);
+	bool retry = !list_empty(&j->freed) &&
+	    ext4_journal_commit_locked(j) == EOK;
+	fibril_mutex_unlock(&j->lock);
+
+	return retry;
+}
+
+/** Commit running transaction.
+ *
+ * @param fs Filesystem
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_journal_commit(ext4_filesystem_t *fs)
+{
+	ext4_journal_t *j = fs->journal;
+
+	if (j == NULL)
+		return EOK;
+
+	fibril_mutex_lock(&j->lock);
+	errno_t rc = ext4_journal_commit_locked(j);
+	fibril_mutex_unlock(&j->lock);
+
+	return rc;
+}
+
+/** Mark metadata block dirty.
+ *
+ * The block is added to the running transaction and it is kept in the
+ * cache until it is checkpointed. Should that fail, the block is written
+ * in place as if there was no journal.
+ *
+ * @param fs    Filesystem
+ * @param block Modified block
+ *
+ */
+void ext4_journal_dirty(ext4_filesystem_t *fs, block_t *block)
+{
+	ext4_journal_t *j = fs->journal;
+	ext4_journal_block_t *jb;
+
+	block->dirty = true;
+
+	if (j == NULL)
+		return;
+
+	fibril_mutex_lock(&j->lock);
+
+	/* Modifications outside of a handle could be committed half-done */
+	assert(j->handles > 0);
+
+	ht_link_t *link = hash_table_find(&j->blocks, &block->lba);
+	if (link != NULL) {
+		jb = hash_table_get_inst(link, ext4_journal_block_t, link);
+		if (jb->tid == j->tid && jb->block != NULL)
+			goto out;
+
+		if (jb->block == NULL) {
+			/* The block was freed and is now reused */
+			block_t *pin;
+			if (block_get(&pin, fs->device, block->lba,
+			    BLOCK_FLAGS_NOREAD) != EOK)
+				goto out;
+
+			jb->block = pin;
+		} else {
+			j->checkpoint_count--;
+		}
+
+		if (jb->revoked && jb->rtid == j->tid) {
+			/* Cancel revoke by the running transaction */
+			for (size_t i = 0; i < j->revoked_count; i++) {
+				if (j->revoked[i] == jb->lba) {
+					j->revoked[i] =
+					    j->revoked[--j->revoked_count];
+					break;
+				}
+			}
+
+			jb->revoked = false;
+		}
+
+		list_remove(&jb->tlink);
+		list_append(&jb->tlink, &j->running);
+		j->running_count++;
+		jb->tid = j->tid;
+		goto out;
+	}
+
+	jb = calloc(1, sizeof(ext4_journal_block_t));
+	if (jb == NULL)
+		goto out;
+
+	if (block_get(&jb->block, fs->device, block->lba,
+	    BLOCK_FLAGS_NOREAD) != EOK) {
+		free(jb);
+		goto out;
+	}
+
+	jb->lba = block->lba;
+	jb->tid = j->tid;
+	hash_table_insert(&j->blocks, &jb->link);
+	list_append(&jb->tlink, &j->running);
+	j->running_count++;
+out:
+	fibril_mutex_unlock(&j->lock);
+}
+
+/** Mark i-node dirty.
+ *
+ * Adds the block containing the i-node to the running transaction if the
+ * i-node was modified. The reference is clean afterwards, so putting it
+ * back after the handle has been stopped does not touch the journal.
+ *
+ * @param inode_ref I-node
+ *
+ */
+void ext4_journal_dirty_inode(ext4_inode_ref_t *inode_ref)
+{
+	if (inode_ref->dirty) {
+		ext4_journal_dirty(inode_ref->fs, inode_ref->block);
+		inode_ref->dirty = false;
+	}
+}
+
+/** Revoke a freed block.
+ *
+ * @param j       Journal
+ * @param blocknr Freed block
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_revoke_block(ext4_journal_t *j, uint32_t blocknr)
+{
+	aoff64_t lba = blocknr;
+
+	ht_link_t *link = hash_table_find(&j->blocks, &lba);
+	if (link == NULL)
+		return EOK;
+
+	ext4_journal_block_t *jb =
+	    hash_table_get_inst(link, ext4_journal_block_t, link);
+
+	if (jb->logged) {
+		if (j->revoked_count == j->revoked_size) {
+			size_t size = max(2 * j->revoked_size, 64);
+			uint32_t *revoked = realloc(j->revoked,
+			    size * sizeof(uint32_t));
+			if (revoked == NULL)
+				return ENOMEM;
+
+			j->revoked = revoked;
+			j->revoked_size = size;
+		}
+
+		if (!jb->revoked || jb->rtid != j->tid)
+			j->revoked[j->revoked_count++] = blocknr;
+
+		jb->revoked = true;
+		jb->rtid = j->tid;
+	}
+
+	if (jb->block == NULL)
+		return EOK;
+
+	if (jb->tid == j->tid)
+		j->running_count--;
+	else
+		j->checkpoint_count--;
+
+	/* Contents of the freed block need not reach the device */
+	fibril_mutex_lock(&jb->block->lock);
+	jb->block->dirty = false;
+	fibril_mutex_unlock(&jb->block->lock);
+
+	if (!jb->logged)
+		return ext4_journal_block_release(j, jb);
+
+	/* Keep the block in the table to know it has been logged */
+	errno_t rc = block_put(jb->block);
+	jb->block = NULL;
+	list_remove(&jb->tlink);
+	list_append(&jb->tlink, &j->checkpoint);
+	return rc;
+}
+
+/** Revoke freed blocks.
+ *
+ * Prevents copies of freed metadata blocks from being replayed over newer
+ * contents of the blocks. The blocks are kept from being allocated again
+ * until the running transaction commits. Until then a crash brings back
+ * metadata that still uses them, so they must not be overwritten.
+ *
+ * Must be called before the blocks are marked free in the bitmap.
+ *
+ * @param fs    Filesystem
+ * @param first First freed block
+ * @param count Number of freed blocks
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_journal_revoke(ext4_filesystem_t *fs, uint32_t first,
+    uint32_t count)
+{
+	ext4_journal_t *j = fs->journal;
+	errno_t rc = EOK;
+
+	if (j == NULL)
+		return EOK;
+
+	fibril_mutex_lock(&j->lock);
+
+	assert(j->handles > 0);
+
+	/* Extend the last extent if the blocks follow it */
+	ext4_journal_freed_t *fr = NULL;
+	if (!list_empty(&j->freed)) {
+		fr = list_get_instance(list_last(&j->freed),
+		    ext4_journal_freed_t, link);
+		if (fr->start + fr->count != first)
+			fr = NULL;
+	}
+
+	if (fr == NULL) {
+		fr = malloc(sizeof(ext4_journal_freed_t));
+		if (fr == NULL) {
+			rc = ENOMEM;
+			goto out;
+		}
+
+		link_initialize(&fr->link);
+		fr->start = first;
+		fr->count = 0;
+		list_append(&fr->link, &j->freed);
+	}
+
+	fr->count += count;
+
+	for (uint32_t i = 0; i < count; i++) {
+		rc = ext4_journal_revoke_block(j, first + i);
+		if (rc != EOK)
+			break;
+	}
+out:
+	fibril_mutex_unlock(&j->lock);
+	return rc;
+}
+
+/** Clip a run of free blocks by blocks freed in the running transaction.
+ *
+ * @param fs   Filesystem
+ * @param addr First block of the run
+ * @param len  Length of the run
+ * @param skip Output value - if the first block was freed, number of
+ *             blocks until the end of the freed extent
+ *
+ * @return Number of blocks starting at @a addr that can be allocated
+ *
+ */
+uint32_t ext4_journal_clip_freed(ext4_filesystem_t *fs, uint32_t addr,
+    uint32_t len, uint32_t *skip)
+{
+	ext4_journal_t *j = fs->journal;
+
+	if (j == NULL)
+		return len;
+
+	fibril_mutex_lock(&j->lock);
+
+	list_foreach(j->freed, link, ext4_journal_freed_t, fr) {
+		if (fr->start <= addr && addr < fr->start + fr->count) {
+			*skip = fr->start + fr->count - addr;
+			len = 0;
+			break;
+		}
+
+		if (addr < fr->start && fr->start < addr + len)
+			len = fr->start - addr;
+	}
+
+	fibril_mutex_unlock(&j->lock);
+	return len;
+}
+
+/**
+ * @}
+ */
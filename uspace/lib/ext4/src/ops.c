@@ -50,11 +50,18 @@
 #include "ext4/directory_index.h"
 #include "ext4/extent.h"
 #include "ext4/inode.h"
+#include "ext4/journal.h"
 #include "ext4/ops.h"
 #include "ext4/filesystem.h"
 #include "ext4/fstypes.h"
 #include "ext4/superblock.h"
 
+/** Maximum number of bytes handled by a single write request */
+#define EXT4_WRITE_MAX  (256 * 1024)
+
+/** Number of blocks released by one journal transaction of a truncate */
+#define EXT4_TRUNCATE_STEP  128
+
 /* Forward declarations of auxiliary functions */
 
 static errno_t ext4_read_directory(ipc_call_t *, aoff64_t, size_t,
@@ -371,6 +378,27 @@ static errno_t ext4_node_put_core(ext4_node_t *enode)
 	return EOK;
 }
 
+/** Find open count of a file.
+ *
+ * Must be called with open_nodes_lock held.
+ *
+ * @param inst  Instance
+ * @param index I-node number
+ *
+ * @return Open count or NULL if the file is not open
+ *
+ */
+static ext4_open_file_t *ext4_open_file_find(ext4_instance_t *inst,
+    fs_index_t index)
+{
+	list_foreach(inst->open_files, link, ext4_open_file_t, of) {
+		if (of->index == index)
+			return of;
+	}
+
+	return NULL;
+}
+
 /** Open node.
  *
  * This operation is stateless in this driver.
@@ -382,7 +410,29 @@ static errno_t ext4_node_put_core(ext4_node_t *enode)
  */
 errno_t ext4_node_open(fs_node_t *fn)
 {
-	/* Stateless operation */
+	ext4_node_t *enode = EXT4_NODE(fn);
+	ext4_instance_t *inst = enode->instance;
+	ext4_open_file_t *of;
+
+	fibril_mutex_lock(&open_nodes_lock);
+
+	of = ext4_open_file_find(inst, enode->inode_ref->index);
+	if (of == NULL) {
+		of = malloc(sizeof(ext4_open_file_t));
+		if (of == NULL) {
+			fibril_mutex_unlock(&open_nodes_lock);
+			return ENOMEM;
+		}
+
+		link_initialize(&of->link);
+		of->index = enode->inode_ref->index;
+		of->count = 0;
+		list_append(&of->link, &inst->open_files);
+	}
+
+	of->count++;
+
+	fibril_mutex_unlock(&open_nodes_lock);
 	return EOK;
 }
 
@@ -450,8 +500,10 @@ errno_t ext4_create_node(fs_node_t **rfn, service_id_t service_id, int flags)
 
 	/* Allocate new i-node in filesystem */
 	ext4_inode_ref_t *inode_ref;
+	ext4_journal_start(inst->filesystem);
 	rc = ext4_filesystem_alloc_inode(inst->filesystem, &inode_ref, flags);
 	if (rc != EOK) {
+		ext4_journal_stop(inst->filesystem);
 		free(enode);
 		free(fs_node);
 		return rc;
@@ -468,6 +520,8 @@ errno_t ext4_create_node(fs_node_t **rfn, service_id_t service_id, int flags)
 	inst->open_nodes_count++;
 
 	enode->inode_ref->dirty = true;
+	ext4_journal_dirty_inode(enode->inode_ref);
+	ext4_journal_stop(inst->filesystem);
 
 	fs_node_initialize(fs_node);
 	fs_node->data = enode;
@@ -477,6 +531,42 @@ errno_t ext4_create_node(fs_node_t **rfn, service_id_t service_id, int flags)
 	return EOK;
 }
 
+/** Truncate i-node within a journal handle.
+ *
+ * The blocks are released from the end of the file in steps, each leaving
+ * a consistent shorter file behind, and the handle is restarted between
+ * the steps. This way a transaction never has to hold all the metadata
+ * modified while releasing a large file.
+ *
+ * @param inode_ref I-node to truncate
+ * @param new_size  New size of the i-node
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_truncate_steps(ext4_inode_ref_t *inode_ref,
+    aoff64_t new_size)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+	aoff64_t step = (aoff64_t) EXT4_TRUNCATE_STEP *
+	    ext4_superblock_get_block_size(fs->superblock);
+
+	while (true) {
+		aoff64_t size = ext4_inode_get_size(fs->superblock,
+		    inode_ref->inode);
+		aoff64_t target = new_size;
+		if (size > new_size && size - new_size > step)
+			target = size - step;
+
+		errno_t rc = ext4_filesystem_truncate_inode(inode_ref, target);
+		if (rc != EOK || target == new_size)
+			return rc;
+
+		ext4_journal_dirty_inode(inode_ref);
+		ext4_journal_restart(fs);
+	}
+}
+
 /** Destroy existing node.
  *
  * @param fs Node to destroy
@@ -501,10 +591,15 @@ errno_t ext4_destroy_node(fs_node_t *fn)
 
 	ext4_node_t *enode = EXT4_NODE(fn);
 	ext4_inode_ref_t *inode_ref = enode->inode_ref;
+	ext4_filesystem_t *fs = enode->instance->filesystem;
+
+	ext4_journal_start(fs);
 
 	/* Release data blocks */
-	rc = ext4_filesystem_truncate_inode(inode_ref, 0);
+	rc = ext4_truncate_steps(inode_ref, 0);
 	if (rc != EOK) {
+		ext4_journal_dirty_inode(inode_ref);
+		ext4_journal_stop(fs);
 		ext4_node_put(fn);
 		return rc;
 	}
@@ -516,8 +611,19 @@ errno_t ext4_destroy_node(fs_node_t *fn)
 	ext4_inode_set_deletion_time(inode_ref->inode, 0xdeadbeef);
 	inode_ref->dirty = true;
 
+	/* Preallocated blocks can no longer be used */
+	rc = ext4_balloc_discard_prealloc(fs, inode_ref->index);
+	if (rc != EOK) {
+		ext4_journal_dirty_inode(inode_ref);
+		ext4_journal_stop(fs);
+		ext4_node_put(fn);
+		return rc;
+	}
+
 	/* Free inode */
 	rc = ext4_filesystem_free_inode(inode_ref);
+	ext4_journal_dirty_inode(inode_ref);
+	ext4_journal_stop(fs);
 	if (rc != EOK) {
 		ext4_node_put(fn);
 		return rc;
@@ -544,12 +650,18 @@ errno_t ext4_link(fs_node_t *pfn, fs_node_t *cfn, const char *name)
 	ext4_node_t *parent = EXT4_NODE(pfn);
 	ext4_node_t *child = EXT4_NODE(cfn);
 	ext4_filesystem_t *fs = parent->instance->filesystem;
+	bool undone;
+	errno_t rc;
+
+retry:
+	ext4_journal_start(fs);
 
 	/* Add entry to parent directory */
-	errno_t rc = ext4_directory_add_entry(parent->inode_ref, name,
+	undone = true;
+	rc = ext4_directory_add_entry(parent->inode_ref, name,
 	    child->inode_ref);
 	if (rc != EOK)
-		return rc;
+		goto out;
 
 	/* Fill new dir -> add '.' and '..' entries */
 	if (ext4_inode_is_type(fs->superblock, child->inode_ref->inode,
@@ -558,7 +670,7 @@ errno_t ext4_link(fs_node_t *pfn, fs_node_t *cfn, const char *name)
 		    child->inode_ref);
 		if (rc != EOK) {
 			ext4_directory_remove_entry(parent->inode_ref, name);
-			return rc;
+			goto out;
 		}
 
 		rc = ext4_directory_add_entry(child->inode_ref, "..",
@@ -566,15 +678,17 @@ errno_t ext4_link(fs_node_t *pfn, fs_node_t *cfn, const char *name)
 		if (rc != EOK) {
 			ext4_directory_remove_entry(parent->inode_ref, name);
 			ext4_directory_remove_entry(child->inode_ref, ".");
-			return rc;
+			goto out;
 		}
 
+		undone = false;
+
 		/* Initialize directory index if supported */
 		if (ext4_superblock_has_feature_compatible(fs->superblock,
 		    EXT4_FEATURE_COMPAT_DIR_INDEX)) {
 			rc = ext4_directory_dx_init(child->inode_ref);
 			if (rc != EOK)
-				return rc;
+				goto out;
 
 			ext4_inode_set_flag(child->inode_ref->inode,
 			    EXT4_INODE_FLAG_INDEX);
@@ -596,7 +710,16 @@ errno_t ext4_link(fs_node_t *pfn, fs_node_t *cfn, const char *name)
 
 	child->inode_ref->dirty = true;
 
-	return EOK;
+out:
+	ext4_journal_dirty_inode(parent->inode_ref);
+	ext4_journal_dirty_inode(child->inode_ref);
+	ext4_journal_stop(fs);
+
+	/* Space freed by the running transaction is reusable after commit */
+	if (rc == ENOSPC && undone && ext4_journal_retry_alloc(fs))
+		goto retry;
+
+	return rc;
 }
 
 /** Unlink node from specified directory.
@@ -619,11 +742,17 @@ errno_t ext4_unlink(fs_node_t *pfn, fs_node_t *cfn, const char *name)
 	if (has_children)
 		return ENOTEMPTY;
 
+	ext4_filesystem_t *fs = EXT4_NODE(pfn)->instance->filesystem;
+	ext4_journal_start(fs);
+
 	/* Remove entry from parent directory */
 	ext4_inode_ref_t *parent = EXT4_NODE(pfn)->inode_ref;
 	rc = ext4_directory_remove_entry(parent, name);
-	if (rc != EOK)
+	if (rc != EOK) {
+		ext4_journal_dirty_inode(parent);
+		ext4_journal_stop(fs);
 		return rc;
+	}
 
 	/* Decrement links count */
 	ext4_inode_ref_t *child_inode_ref = EXT4_NODE(cfn)->inode_ref;
@@ -668,6 +797,10 @@ errno_t ext4_unlink(fs_node_t *pfn, fs_node_t *cfn, const char *name)
 	ext4_inode_set_links_count(child_inode_ref->inode, lnk_count);
 	child_inode_ref->dirty = true;
 
+	ext4_journal_dirty_inode(parent);
+	ext4_journal_dirty_inode(child_inode_ref);
+	ext4_journal_stop(fs);
+
 	return EOK;
 }
 
@@ -950,6 +1083,7 @@ static errno_t ext4_mounted(service_id_t service_id, const char *opts,
 	link_initialize(&inst->link);
 	inst->service_id = service_id;
 	inst->open_nodes_count = 0;
+	list_initialize(&inst->open_files);
 
 	/* Initialize the filesystem */
 	aoff64_t rnsize;
@@ -1007,6 +1141,13 @@ static errno_t ext4_unmounted(service_id_t service_id)
 		fibril_mutex_unlock(&instance_list_mutex);
 	}
 
+	while (!list_empty(&inst->open_files)) {
+		ext4_open_file_t *of = list_get_instance(
+		    list_first(&inst->open_files), ext4_open_file_t, link);
+		list_remove(&of->link);
+		free(of);
+	}
+
 	free(inst);
 	return EOK;
 }
@@ -1269,7 +1410,180 @@ errno_t ext4_read_file(ipc_call_t *call, aoff64_t pos, size_t size,
 	return EOK;
 }
 
+/** Zero newly allocated blocks.
+ *
+ * @param fs     Filesystem
+ * @param fblock First block to zero
+ * @param count  Number of blocks to zero
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_zero_blocks(ext4_filesystem_t *fs, uint32_t fblock,
+    uint32_t count)
+{
+	uint32_t block_size = ext4_superblock_get_block_size(fs->superblock);
+
+	for (uint32_t i = 0; i < count; i++) {
+		block_t *block;
+		errno_t rc = block_get(&block, fs->device, fblock + i,
+		    BLOCK_FLAGS_NOREAD);
+		if (rc != EOK)
+			return rc;
+
+		memset(block->data, 0, block_size);
+		block->dirty = true;
+
+		rc = block_put(block);
+		if (rc != EOK)
+			return rc;
+	}
+
+	return EOK;
+}
+
+/** Write data to i-node.
+ *
+ * For extent-based i-nodes, blocks past the end of file are appended
+ * in physically contiguous runs covering the rest of the write at once.
+ * Other i-nodes are filled block by block, each new block allocated right
+ * after the previous one if possible. The i-node size is not updated.
+ *
+ * @param inode_ref I-node to write to
+ * @param pos       Position in file to start writing at
+ * @param buf       Data to write
+ * @param len       Number of bytes to write
+ * @param done      Output value - number of bytes written
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_write_data(ext4_inode_ref_t *inode_ref, aoff64_t pos,
+    const uint8_t *buf, size_t len, size_t *done)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+	ext4_superblock_t *sb = fs->superblock;
+	uint32_t block_size = ext4_superblock_get_block_size(sb);
+	bool extents = ext4_superblock_has_feature_incompatible(sb,
+	    EXT4_FEATURE_INCOMPAT_EXTENTS) &&
+	    ext4_inode_has_flag(inode_ref->inode, EXT4_INODE_FLAG_EXTENTS);
+	uint64_t size = ext4_inode_get_size(sb, inode_ref->inode);
+	size_t written = 0;
+	uint32_t goal = 0;
+	errno_t rc = EOK;
+
+	/* First logical block past the end of file */
+	uint32_t next_iblock = (size + block_size - 1) / block_size;
+	uint32_t last_iblock = (pos + len - 1) / block_size;
+
+	while (written < len) {
+		uint32_t iblock = (pos + written) / block_size;
+		uint32_t fblock;
+		uint32_t run = 1;
+		bool fresh = false;
+
+		if (extents && iblock >= next_iblock) {
+			/* Append blocks up to the end of this write */
+			uint32_t first = next_iblock;
+			run = last_iblock - next_iblock + 1;
+			rc = ext4_extent_append_blocks(inode_ref, first,
+			    &fblock, &run);
+			if (rc != EOK)
+				break;
+
+			next_iblock += run;
+			fresh = true;
+
+			if (first < iblock) {
+				/* Blocks in the gap before the written data */
+				uint32_t holes = min(run, iblock - first);
+				rc = ext4_zero_blocks(fs, fblock, holes);
+				if (rc != EOK)
+					break;
+
+				fblock += holes;
+				run -= holes;
+				if (run == 0)
+					continue;
+			}
+		} else {
+			rc = ext4_filesystem_get_inode_data_block_index(inode_ref,
+			    iblock, &fblock);
+			if (rc != EOK)
+				break;
+
+			if (fblock == 0) {
+				if (extents) {
+					/* Extent files are never sparse */
+					rc = EIO;
+					break;
+				}
+
+				/* Fill the hole in the file */
+				rc = ext4_balloc_alloc_blocks(inode_ref, goal,
+				    &fblock, &run);
+				if (rc != EOK)
+					break;
+
+				rc = ext4_filesystem_set_inode_data_block_index(
+				    inode_ref, iblock, fblock);
+				if (rc != EOK) {
+					ext4_balloc_free_block(inode_ref, fblock);
+					break;
+				}
+
+				fresh = true;
+			}
+		}
+
+		/* Copy data to the run of blocks */
+		for (uint32_t i = 0; i < run && written < len; i++) {
+			uint32_t offset = (pos + written) % block_size;
+			size_t bytes = min(len - written, block_size - offset);
+
+			int flags = BLOCK_FLAGS_NONE;
+			if (fresh || bytes == block_size)
+				flags = BLOCK_FLAGS_NOREAD;
+
+			block_t *block;
+			rc = block_get(&block, fs->device, fblock + i, flags);
+			if (rc != EOK)
+				goto out;
+
+			if (fresh && bytes != block_size)
+				memset(block->data, 0, block_size);
+
+			memcpy(block->data + offset, buf + written, bytes);
+			block->dirty = true;
+
+			rc = block_put(block);
+			if (rc != EOK)
+				goto out;
+
+			written += bytes;
+		}
+
+		goal = fblock + run;
+	}
+
+out:
+	if (rc != EOK && extents) {
+		/* Do not leave blocks mapped past the new end of file */
+		uint64_t end = max(size, pos + written);
+		uint32_t end_iblock = (end + block_size - 1) / block_size;
+		if (next_iblock > end_iblock)
+			(void) ext4_extent_release_blocks_from(inode_ref,
+			    end_iblock);
+	}
+
+	*done = written;
+	return rc;
+}
+
 /** Write bytes to file
+ *
+ * The whole write request is received at once (up to EXT4_WRITE_MAX bytes)
+ * and written through ext4_write_data().
  *
  * @param service_id Device identifier
  * @param index      I-node number of file
@@ -1284,6 +1598,7 @@ static errno_t ext4_write(service_id_t service_id, fs_index_t index, aoff64_t po
     size_t *wbytes, aoff64_t *nsize)
 {
 	fs_node_t *fn;
+	uint8_t *buf = NULL;
 	errno_t rc2;
 	errno_t rc = ext4_node_get(&fn, service_id, index);
 	if (rc != EOK)
@@ -1299,108 +1614,54 @@ static errno_t ext4_write(service_id_t service_id, fs_index_t index, aoff64_t po
 
 	ext4_node_t *enode = EXT4_NODE(fn);
 	ext4_filesystem_t *fs = enode->instance->filesystem;
-
-	uint32_t block_size = ext4_superblock_get_block_size(fs->superblock);
-
-	/* Prevent writing to more than one block */
-	uint32_t bytes = min(len, block_size - (pos % block_size));
-
-	int flags = BLOCK_FLAGS_NONE;
-	if (bytes == block_size)
-		flags = BLOCK_FLAGS_NOREAD;
-
-	uint32_t iblock =  pos / block_size;
-	uint32_t fblock;
-
-	/* Load inode */
 	ext4_inode_ref_t *inode_ref = enode->inode_ref;
-	rc = ext4_filesystem_get_inode_data_block_index(inode_ref, iblock,
-	    &fblock);
-	if (rc != EOK) {
-		async_answer_0(&call, rc);
-		goto exit;
-	}
 
-	/* Check for sparse file */
-	if (fblock == 0) {
-		if ((ext4_superblock_has_feature_incompatible(fs->superblock,
-		    EXT4_FEATURE_INCOMPAT_EXTENTS)) &&
-		    (ext4_inode_has_flag(inode_ref->inode, EXT4_INODE_FLAG_EXTENTS))) {
-			uint32_t last_iblock =
-			    ext4_inode_get_size(fs->superblock, inode_ref->inode) /
-			    block_size;
-
-			while (last_iblock < iblock) {
-				rc = ext4_extent_append_block(inode_ref, &last_iblock,
-				    &fblock, true);
-				if (rc != EOK) {
-					async_answer_0(&call, rc);
-					goto exit;
-				}
-			}
+	/* Prevent allocating too large buffer */
+	len = min(len, EXT4_WRITE_MAX);
 
-			rc = ext4_extent_append_block(inode_ref, &last_iblock,
-			    &fblock, false);
-			if (rc != EOK) {
-				async_answer_0(&call, rc);
-				goto exit;
-			}
-		} else {
-			rc = ext4_balloc_alloc_block(inode_ref, &fblock);
-			if (rc != EOK) {
-				async_answer_0(&call, rc);
-				goto exit;
-			}
-
-			rc = ext4_filesystem_set_inode_data_block_index(inode_ref,
-			    iblock, fblock);
-			if (rc != EOK) {
-				ext4_balloc_free_block(inode_ref, fblock);
-				async_answer_0(&call, rc);
-				goto exit;
-			}
-		}
-
-		flags = BLOCK_FLAGS_NOREAD;
-		inode_ref->dirty = true;
-	}
-
-	/* Load target block */
-	block_t *write_block;
-	rc = block_get(&write_block, service_id, fblock, flags);
-	if (rc != EOK) {
+	buf = malloc(max(len, 1));
+	if (buf == NULL) {
+		rc = ENOMEM;
 		async_answer_0(&call, rc);
 		goto exit;
 	}
 
-	if (flags == BLOCK_FLAGS_NOREAD)
-		memset(write_block->data, 0, block_size);
-
-	rc = async_data_write_finalize(&call, write_block->data +
-	    (pos % block_size), bytes);
-	if (rc != EOK) {
-		block_put(write_block);
+	rc = async_data_write_finalize(&call, buf, len);
+	if (rc != EOK)
 		goto exit;
-	}
 
-	write_block->dirty = true;
+	size_t bytes;
+retry:
+	ext4_journal_start(fs);
 
-	rc = block_put(write_block);
-	if (rc != EOK)
-		goto exit;
+	bytes = 0;
+	if (len > 0)
+		rc = ext4_write_data(inode_ref, pos, buf, len, &bytes);
 
 	/* Do some counting */
-	uint32_t old_inode_size = ext4_inode_get_size(fs->superblock,
+	uint64_t old_inode_size = ext4_inode_get_size(fs->superblock,
 	    inode_ref->inode);
 	if (pos + bytes > old_inode_size) {
 		ext4_inode_set_size(inode_ref->inode, pos + bytes);
 		inode_ref->dirty = true;
 	}
 
+	ext4_journal_dirty_inode(inode_ref);
+	ext4_journal_stop(fs);
+
+	/* Space freed by the running transaction is reusable after commit */
+	if (rc == ENOSPC && bytes == 0 && ext4_journal_retry_alloc(fs))
+		goto retry;
+
+	/* Report short write if some data made it to the file */
+	if (bytes > 0)
+		rc = EOK;
+
 	*nsize = ext4_inode_get_size(fs->superblock, inode_ref->inode);
 	*wbytes = bytes;
 
 exit:
+	free(buf);
 	rc2 = ext4_node_put(fn);
 	return rc == EOK ? rc2 : rc;
 }
@@ -1427,13 +1688,19 @@ static errno_t ext4_truncate(service_id_t service_id, fs_index_t index,
 	ext4_node_t *enode = EXT4_NODE(fn);
 	ext4_inode_ref_t *inode_ref = enode->inode_ref;
 
-	rc = ext4_filesystem_truncate_inode(inode_ref, new_size);
+	ext4_journal_start(inode_ref->fs);
+	rc = ext4_truncate_steps(inode_ref, new_size);
+	ext4_journal_dirty_inode(inode_ref);
+	ext4_journal_stop(inode_ref->fs);
+
 	errno_t const rc2 = ext4_node_put(fn);
 
 	return rc == EOK ? rc2 : rc;
 }
 
 /** Close file.
+ *
+ * Blocks preallocated for the file are returned on the last close.
  *
  * @param service_id Device identifier
  * @param index      I-node number
@@ -1443,7 +1710,33 @@ static errno_t ext4_truncate(service_id_t service_id, fs_index_t index,
  */
 static errno_t ext4_close(service_id_t service_id, fs_index_t index)
 {
-	return EOK;
+	ext4_instance_t *inst;
+	errno_t rc = ext4_instance_get(service_id, &inst);
+	if (rc != EOK)
+		return rc;
+
+	/* Keep the preallocation while the file is open elsewhere */
+	fibril_mutex_lock(&open_nodes_lock);
+
+	ext4_open_file_t *of = ext4_open_file_find(inst, index);
+	if (of != NULL && --of->count > 0) {
+		fibril_mutex_unlock(&open_nodes_lock);
+		return EOK;
+	}
+
+	if (of != NULL) {
+		list_remove(&of->link);
+		free(of);
+	}
+
+	fibril_mutex_unlock(&open_nodes_lock);
+
+	/* Return blocks preallocated for appending to the file */
+	ext4_journal_start(inst->filesystem);
+	rc = ext4_balloc_discard_prealloc(inst->filesystem, index);
+	ext4_journal_stop(inst->filesystem);
+
+	return rc;
 }
 
 /** Destroy node specified by index.
@@ -1479,9 +1772,19 @@ static errno_t ext4_sync(service_id_t service_id, fs_index_t index)
 		return rc;
 
 	ext4_node_t *enode = EXT4_NODE(fn);
+	ext4_filesystem_t *fs = enode->instance->filesystem;
+
+	ext4_journal_start(fs);
 	enode->inode_ref->dirty = true;
+	ext4_journal_dirty_inode(enode->inode_ref);
+	ext4_journal_stop(fs);
 
-	return ext4_node_put(fn);
+	rc = ext4_node_put(fn);
+	if (rc != EOK)
+		return rc;
+
+	/* Make the metadata changes made so far durable */
+	return ext4_journal_commit(fs);
 }
 
 /** VFS operations
@@ -988,6 +988,30 @@ void ext4_superblock_set_last_orphan(ext4_superblock_t *sb,
 	sb->last_orphan = host2uint32_t_le(last_orphan);
 }
 
+/** Get number of the i-node containing the journal.
+ *
+ * @param sb Superblock
+ *
+ * @return Journal i-node number, zero if there is no internal journal
+ *
+ */
+uint32_t ext4_superblock_get_journal_inode_number(ext4_superblock_t *sb)
+{
+	return uint32_t_le2host(sb->journal_inode_number);
+}
+
+/** Get device number of external journal.
+ *
+ * @param sb Superblock
+ *
+ * @return Journal device number
+ *
+ */
+uint32_t ext4_superblock_get_journal_dev(ext4_superblock_t *sb)
+{
+	return uint32_t_le2host(sb->journal_dev);
+}
+
 /** Get hash seed for directory index hash function.
  *
  * @param sb Superblock
@@ -0,0 +1,598 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <block.h>
+#include <byteorder.h>
+#include <errno.h>
+#include <ipc/vfs.h>
+#include <loc.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <task.h>
+#include "ext4/balloc.h"
+#include "ext4/directory.h"
+#include "ext4/filesystem.h"
+#include "ext4/inode.h"
+#include "ext4/journal.h"
+#include "ext4/ops.h"
+#include "ext4/superblock.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(journal);
+
+#define FILE_BD "/srv/bd/file_bd"
+
+/** Image of the file system under test */
+#define TEST_IMG "/tmp/ext4-journal.img"
+/** Copy of the image taken at the moment of a simulated crash */
+#define TEST_CRASH_IMG "/tmp/ext4-journal-crash.img"
+
+#define TEST_BLOCK_SIZE 1024
+#define TEST_BLOCKS 8192
+#define TEST_JOURNAL_INODE 8
+#define TEST_JOURNAL_BLOCKS 1024
+#define TEST_MTIME 0x12345678
+#define TEST_PATTERN 0xa5
+
+/** Block device backed by an image file */
+typedef struct {
+	task_id_t task;
+	service_id_t sid;
+} test_bd_t;
+
+/** Mounted file system */
+typedef struct {
+	test_bd_t bd;
+	ext4_instance_t inst;
+	ext4_filesystem_t *fs;
+} test_fs_t;
+
+static unsigned test_bd_count;
+
+/** Create a zero-filled image file. */
+static errno_t test_img_create(const char *path)
+{
+	char buf[TEST_BLOCK_SIZE];
+	errno_t rc = EOK;
+
+	FILE *f = fopen(path, "wb");
+	if (f == NULL)
+		return EIO;
+
+	memset(buf, 0, sizeof(buf));
+	for (size_t i = 0; i < TEST_BLOCKS; i++) {
+		if (fwrite(buf, sizeof(buf), 1, f) != 1) {
+			rc = EIO;
+			break;
+		}
+	}
+
+	if (fclose(f) != 0)
+		rc = EIO;
+
+	return rc;
+}
+
+/** Copy an image file.
+ *
+ * The device writes go straight to the image, so copying the image
+ * captures exactly what would survive a crash at this point.
+ */
+static errno_t test_img_copy(const char *src, const char *dst)
+{
+	char buf[TEST_BLOCK_SIZE];
+	errno_t rc = EOK;
+
+	FILE *in = fopen(src, "rb");
+	if (in == NULL)
+		return EIO;
+
+	FILE *out = fopen(dst, "wb");
+	if (out == NULL) {
+		fclose(in);
+		return EIO;
+	}
+
+	for (size_t i = 0; i < TEST_BLOCKS; i++) {
+		if (fread(buf, sizeof(buf), 1, in) != 1 ||
+		    fwrite(buf, sizeof(buf), 1, out) != 1) {
+			rc = EIO;
+			break;
+		}
+	}
+
+	fclose(in);
+	if (fclose(out) != 0)
+		rc = EIO;
+
+	return rc;
+}
+
+/** Start file_bd serving an image file. */
+static errno_t test_bd_start(const char *img, test_bd_t *bd)
+{
+	task_wait_t wait;
+	task_exit_t texit;
+	char *svc;
+	int retval;
+	errno_t rc;
+
+	if (asprintf(&svc, "test/ext4-journal%u", test_bd_count++) < 0)
+		return ENOMEM;
+
+	rc = task_spawnl(&bd->task, &wait, FILE_BD, FILE_BD, img, svc, NULL);
+	if (rc != EOK)
+		goto out;
+
+	/* file_bd reports success once the service is registered */
+	rc = task_wait(&wait, &texit, &retval);
+	if (rc != EOK || texit != TASK_EXIT_NORMAL || retval != 0) {
+		rc = EIO;
+		goto out;
+	}
+
+	rc = loc_service_get_id(svc, &bd->sid, 0);
+out:
+	free(svc);
+	return rc;
+}
+
+/** Stop file_bd. */
+static void test_bd_stop(test_bd_t *bd)
+{
+	(void) task_kill(bd->task);
+}
+
+/** Mount file system on an image file. */
+static errno_t test_mount(const char *img, test_fs_t *tfs)
+{
+	aoff64_t size;
+
+	errno_t rc = test_bd_start(img, &tfs->bd);
+	if (rc != EOK)
+		return rc;
+
+	link_initialize(&tfs->inst.link);
+	tfs->inst.service_id = tfs->bd.sid;
+	tfs->inst.open_nodes_count = 0;
+
+	rc = ext4_filesystem_open(&tfs->inst, tfs->bd.sid, CACHE_MODE_WB,
+	    &size, &tfs->fs);
+	if (rc != EOK)
+		test_bd_stop(&tfs->bd);
+
+	return rc;
+}
+
+/** Unmount file system. */
+static errno_t test_umount(test_fs_t *tfs)
+{
+	errno_t rc = ext4_filesystem_close(tfs->fs);
+	test_bd_stop(&tfs->bd);
+	return rc;
+}
+
+/** Create journal in the reserved journal i-node.
+ *
+ * @param fs File system without a journal
+ *
+ * @return Error code
+ *
+ */
+static errno_t test_add_journal(ext4_filesystem_t *fs)
+{
+	ext4_superblock_t *sb = fs->superblock;
+	ext4_inode_ref_t *inode_ref;
+	uint32_t fblock;
+	uint32_t iblock;
+	uint32_t first = 0;
+	block_t *block;
+	errno_t rc, rc2;
+
+	rc = ext4_filesystem_get_inode_ref(fs, TEST_JOURNAL_INODE, &inode_ref);
+	if (rc != EOK)
+		return rc;
+
+	ext4_inode_set_mode(sb, inode_ref->inode, EXT4_INODE_MODE_FILE | 0600);
+	ext4_inode_set_links_count(inode_ref->inode, 1);
+	inode_ref->dirty = true;
+
+	for (uint32_t i = 0; i < TEST_JOURNAL_BLOCKS; i++) {
+		rc = ext4_filesystem_append_inode_block(inode_ref, &fblock,
+		    &iblock);
+		if (rc != EOK)
+			goto out;
+
+		if (i == 0)
+			first = fblock;
+	}
+
+	rc = block_get(&block, fs->device, first, BLOCK_FLAGS_NOREAD);
+	if (rc != EOK)
+		goto out;
+
+	ext4_journal_sb_t *jsb = block->data;
+	memset(block->data, 0, TEST_BLOCK_SIZE);
+	jsb->header.magic = host2uint32_t_be(EXT4_JOURNAL_MAGIC);
+	jsb->header.blocktype = host2uint32_t_be(EXT4_JOURNAL_BT_SB_V2);
+	jsb->blocksize = host2uint32_t_be(TEST_BLOCK_SIZE);
+	jsb->maxlen = host2uint32_t_be(TEST_JOURNAL_BLOCKS);
+	jsb->first = host2uint32_t_be(1);
+	jsb->sequence = host2uint32_t_be(1);
+	jsb->nr_users = host2uint32_t_be(1);
+	block->dirty = true;
+
+	rc = block_put(block);
+	if (rc != EOK)
+		goto out;
+
+	sb->journal_inode_number = host2uint32_t_le(TEST_JOURNAL_INODE);
+	ext4_superblock_set_features_compatible(sb,
+	    ext4_superblock_get_features_compatible(sb) |
+	    EXT4_FEATURE_COMPAT_HAS_JOURNAL);
+out:
+	rc2 = ext4_filesystem_put_inode_ref(inode_ref);
+	return rc != EOK ? rc : rc2;
+}
+
+/** Create journaled file system in the test image. */
+static errno_t test_mkfs(void)
+{
+	ext4_cfg_t cfg;
+	test_fs_t tfs;
+	errno_t rc;
+
+	rc = test_img_create(TEST_IMG);
+	if (rc != EOK)
+		return rc;
+
+	rc = test_bd_start(TEST_IMG, &tfs.bd);
+	if (rc != EOK)
+		return rc;
+
+	cfg.version = extver_ext2;
+	cfg.volume_name = "";
+	cfg.bsize = TEST_BLOCK_SIZE;
+
+	rc = ext4_filesystem_create(&cfg, tfs.bd.sid);
+	test_bd_stop(&tfs.bd);
+	if (rc != EOK)
+		return rc;
+
+	rc = test_mount(TEST_IMG, &tfs);
+	if (rc != EOK)
+		return rc;
+
+	rc = test_add_journal(tfs.fs);
+	errno_t rc2 = test_umount(&tfs);
+	return rc != EOK ? rc : rc2;
+}
+
+/** Set modification time of the root directory in a journal handle. */
+static errno_t test_set_root_mtime(ext4_filesystem_t *fs, uint32_t mtime)
+{
+	ext4_inode_ref_t *inode_ref;
+
+	ext4_journal_start(fs);
+
+	errno_t rc = ext4_filesystem_get_inode_ref(fs, EXT4_INODE_ROOT_INDEX,
+	    &inode_ref);
+	if (rc == EOK) {
+		ext4_inode_set_modification_time(inode_ref->inode, mtime);
+		inode_ref->dirty = true;
+		ext4_journal_dirty_inode(inode_ref);
+		rc = ext4_filesystem_put_inode_ref(inode_ref);
+	}
+
+	ext4_journal_stop(fs);
+	return rc;
+}
+
+/** Get modification time of the root directory. */
+static uint32_t test_get_root_mtime(ext4_filesystem_t *fs)
+{
+	ext4_inode_ref_t *inode_ref;
+	uint32_t mtime;
+
+	errno_t rc = ext4_filesystem_get_inode_ref(fs, EXT4_INODE_ROOT_INDEX,
+	    &inode_ref);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	mtime = ext4_inode_get_modification_time(inode_ref->inode);
+
+	rc = ext4_filesystem_put_inode_ref(inode_ref);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	return mtime;
+}
+
+/** Create directory with one block, return the block. */
+static errno_t test_mkdir(ext4_filesystem_t *fs, ext4_inode_ref_t **dir,
+    uint32_t *fblock)
+{
+	errno_t rc = ext4_filesystem_alloc_inode(fs, dir, L_DIRECTORY);
+	if (rc != EOK)
+		return rc;
+
+	rc = ext4_directory_add_entry(*dir, ".", *dir);
+	if (rc != EOK)
+		return rc;
+
+	return ext4_filesystem_get_inode_data_block_index(*dir, 0, fblock);
+}
+
+PCUT_TEST_BEFORE
+{
+	errno_t rc = ext4_global_init();
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = test_mkfs();
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+}
+
+PCUT_TEST_AFTER
+{
+	(void) remove(TEST_IMG);
+	(void) remove(TEST_CRASH_IMG);
+	(void) ext4_global_fini();
+}
+
+/** Committed transaction is replayed after a crash. */
+PCUT_TEST(committed_replayed)
+{
+	test_fs_t tfs;
+	ext4_superblock_t *sb;
+	errno_t rc;
+
+	rc = test_mount(TEST_IMG, &tfs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = test_set_root_mtime(tfs.fs, TEST_MTIME);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = ext4_journal_commit(tfs.fs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Crash with the change only in the log */
+	rc = test_img_copy(TEST_IMG, TEST_CRASH_IMG);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = test_umount(&tfs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* The file system was left needing recovery */
+	rc = test_bd_start(TEST_CRASH_IMG, &tfs.bd);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = block_init(tfs.bd.sid);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = ext4_superblock_read_direct(tfs.bd.sid, &sb);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_TRUE(ext4_superblock_has_feature_incompatible(sb,
+	    EXT4_FEATURE_INCOMPAT_RECOVER));
+	ext4_superblock_release(sb);
+	block_fini(tfs.bd.sid);
+	test_bd_stop(&tfs.bd);
+
+	rc = test_mount(TEST_CRASH_IMG, &tfs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_INT_EQUALS(TEST_MTIME, test_get_root_mtime(tfs.fs));
+
+	rc = test_umount(&tfs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+}
+
+/** Transaction that did not commit is lost as a whole. */
+PCUT_TEST(uncommitted_discarded)
+{
+	test_fs_t tfs;
+	errno_t rc;
+
+	rc = test_mount(TEST_IMG, &tfs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	uint32_t mtime = test_get_root_mtime(tfs.fs);
+	PCUT_ASSERT_TRUE(mtime != TEST_MTIME);
+
+	rc = test_set_root_mtime(tfs.fs, TEST_MTIME);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Crash before the transaction commits */
+	rc = test_img_copy(TEST_IMG, TEST_CRASH_IMG);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = test_umount(&tfs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = test_mount(TEST_CRASH_IMG, &tfs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_INT_EQUALS(mtime, test_get_root_mtime(tfs.fs));
+
+	rc = test_umount(&tfs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+}
+
+/** Logged copy of a freed block is not replayed over its new contents. */
+PCUT_TEST(revoked_not_replayed)
+{
+	test_fs_t tfs;
+	ext4_inode_ref_t *dir;
+	ext4_inode_ref_t *file;
+	uint32_t fblock;
+	size_t bsize;
+	bool avail;
+	errno_t rc;
+
+	rc = test_mount(TEST_IMG, &tfs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	ext4_filesystem_t *fs = tfs.fs;
+
+	/* Log a directory block */
+	ext4_journal_start(fs);
+	rc = test_mkdir(fs, &dir, &fblock);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	ext4_journal_dirty_inode(dir);
+	ext4_journal_stop(fs);
+
+	rc = ext4_journal_commit(fs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Free it */
+	ext4_journal_start(fs);
+	rc = ext4_filesystem_truncate_inode(dir, 0);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	ext4_journal_dirty_inode(dir);
+	ext4_journal_stop(fs);
+
+	rc = ext4_journal_commit(fs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Reuse it for file data, which is written in place */
+	ext4_journal_start(fs);
+	rc = ext4_filesystem_alloc_inode(fs, &file, L_FILE);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = ext4_balloc_try_alloc_block(file, fblock, &avail);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_TRUE(avail);
+	rc = ext4_filesystem_set_inode_data_block_index(file, 0, fblock);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	ext4_inode_set_size(file->inode, TEST_BLOCK_SIZE);
+	file->dirty = true;
+	ext4_journal_dirty_inode(file);
+	ext4_journal_stop(fs);
+
+	rc = block_get_bsize(fs->device, &bsize);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	uint8_t *data = malloc(TEST_BLOCK_SIZE);
+	PCUT_ASSERT_NOT_NULL(data);
+	memset(data, TEST_PATTERN, TEST_BLOCK_SIZE);
+	rc = block_write_direct(fs->device,
+	    (aoff64_t) fblock * (TEST_BLOCK_SIZE / bsize),
+	    TEST_BLOCK_SIZE / bsize, data);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = ext4_journal_commit(fs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = test_img_copy(TEST_IMG, TEST_CRASH_IMG);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = ext4_filesystem_put_inode_ref(dir);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = ext4_filesystem_put_inode_ref(file);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = test_umount(&tfs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Replay must keep the file data */
+	rc = test_mount(TEST_CRASH_IMG, &tfs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	memset(data, 0, TEST_BLOCK_SIZE);
+	rc = block_read_direct(tfs.fs->device,
+	    (aoff64_t) fblock * (TEST_BLOCK_SIZE / bsize),
+	    TEST_BLOCK_SIZE / bsize, data);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	for (size_t i = 0; i < TEST_BLOCK_SIZE; i++)
+		PCUT_ASSERT_INT_EQUALS(TEST_PATTERN, data[i]);
+
+	free(data);
+
+	rc = test_umount(&tfs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+}
+
+/** Freed block is not reused before the freeing transaction commits. */
+PCUT_TEST(freed_block_held)
+{
+	test_fs_t tfs;
+	ext4_inode_ref_t *dir;
+	ext4_inode_ref_t *file;
+	uint32_t fblock;
+	bool avail;
+	errno_t rc;
+
+	rc = test_mount(TEST_IMG, &tfs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	ext4_filesystem_t *fs = tfs.fs;
+
+	ext4_journal_start(fs);
+	rc = test_mkdir(fs, &dir, &fblock);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	ext4_journal_dirty_inode(dir);
+	ext4_journal_stop(fs);
+
+	rc = ext4_journal_commit(fs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Free the block and try to take it in the same transaction */
+	ext4_journal_start(fs);
+	rc = ext4_filesystem_truncate_inode(dir, 0);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	ext4_journal_dirty_inode(dir);
+
+	rc = ext4_filesystem_alloc_inode(fs, &file, L_FILE);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = ext4_balloc_try_alloc_block(file, fblock, &avail);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_FALSE(avail);
+	ext4_journal_dirty_inode(file);
+	ext4_journal_stop(fs);
+
+	rc = ext4_journal_commit(fs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* The block is available after commit */
+	ext4_journal_start(fs);
+	rc = ext4_balloc_try_alloc_block(file, fblock, &avail);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_TRUE(avail);
+	rc = ext4_filesystem_set_inode_data_block_index(file, 0, fblock);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	ext4_inode_set_size(file->inode, TEST_BLOCK_SIZE);
+	file->dirty = true;
+	ext4_journal_dirty_inode(file);
+	ext4_journal_stop(fs);
+
+	rc = ext4_filesystem_put_inode_ref(dir);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = ext4_filesystem_put_inode_ref(file);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = test_umount(&tfs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+}
+
+PCUT_EXPORT(journal);
@@ -232,7 +232,9 @@ errno_t ieee80211_aes_key_unwrap(uint8_t *kek, uint8_t *data, size_t data_size,
 	uint8_t work_output[AES_CIPHER_LENGTH];
 	uint8_t *work_block;
 	uint8_t a[8];
+	aes_context_t ctx;
 
+	aes_init(&ctx, kek);
 	memcpy(a, data, 8);
 
 	uint64_t mask = 0xff;
@@ -250,7 +252,7 @@ errno_t ieee80211_aes_key_unwrap(uint8_t *kek, uint8_t *data, size_t data_size,
 			work_block = work_data + (i - 1) * 8;
 			memcpy(work_input, a, 8);
 			memcpy(work_input + 8, work_block, 8);
-			aes_decrypt(kek, work_input, work_output);
+			aes_decrypt_block(&ctx, work_input, work_output);
 			memcpy(a, work_output, 8);
 			memcpy(work_data + (i - 1) * 8, work_output + 8, 8);
 		}
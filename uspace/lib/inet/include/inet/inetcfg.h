@@ -44,6 +44,8 @@ extern errno_t inetcfg_addr_create_static(const char *, inet_naddr_t *, sysarg_t
 extern errno_t inetcfg_addr_delete(sysarg_t);
 extern errno_t inetcfg_addr_get(sysarg_t, inet_addr_info_t *);
 extern errno_t inetcfg_addr_get_id(const char *, sysarg_t, sysarg_t *);
+extern errno_t inetcfg_batch_begin(void);
+extern errno_t inetcfg_batch_end(void);
 extern errno_t inetcfg_get_addr_list(sysarg_t **, size_t *);
 extern errno_t inetcfg_get_link_list(sysarg_t **, size_t *);
 extern errno_t inetcfg_get_sroute_list(sysarg_t **, size_t *);
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup libinet
+ * @{
+ */
+/** @file Neighbor cache
+ */
+
+#ifndef LIBINET_INET_NCACHE_H
+#define LIBINET_INET_NCACHE_H
+
+#include <adt/hash_table.h>
+#include <adt/list.h>
+#include <errno.h>
+#include <fibril_synch.h>
+#include <inet/addr.h>
+#include <inet/eth_addr.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/** Time a confirmed entry is reachable (usec) */
+#define NCACHE_REACHABLE_TIME  (30 * 1000 * 1000)
+/** Time a stale entry is kept after it stopped being reachable (usec) */
+#define NCACHE_STALE_TIME  (60 * 1000 * 1000)
+/** Time to wait for resolution to complete (usec) */
+#define NCACHE_INCOMPLETE_TIME  (3 * 1000 * 1000)
+/** Time a failed resolution is remembered (usec) */
+#define NCACHE_FAILED_TIME  (5 * 1000 * 1000)
+/** Interval of removing expired entries (usec) */
+#define NCACHE_AGING_INTERVAL  (1000 * 1000)
+/** Maximum number of packets waiting for resolution of one address */
+#define NCACHE_PENDING_MAX  3
+
+/** Neighbor cache entry state */
+typedef enum {
+	/** Resolution in progress */
+	nce_incomplete,
+	/** Link address recently confirmed */
+	nce_reachable,
+	/** Link address not confirmed recently, still used */
+	nce_stale,
+	/** Resolution failed (negative entry) */
+	nce_failed
+} ncache_state_t;
+
+/** Neighbor cache entry */
+typedef struct {
+	/** Link in ncache_t.entries */
+	ht_link_t lentries;
+	/** Network address */
+	inet_addr_t addr;
+	/** Link address (valid when reachable or stale) */
+	eth_addr_t mac;
+	/** State */
+	ncache_state_t state;
+	/** Time when the entry leaves its current state (uptime, usec) */
+	usec_t expires;
+	/** Stale entry was handed out for refreshing */
+	bool probing;
+	/** Signalled when resolution completes or fails */
+	fibril_condvar_t cv;
+	/** Number of fibrils waiting on @c cv */
+	unsigned waiters;
+	/** Packets waiting for resolution (of ncache_pkt_t) */
+	list_t pending;
+	/** Number of packets in @c pending */
+	size_t npending;
+} ncache_entry_t;
+
+/** Packet waiting for address resolution */
+typedef struct {
+	/** Link in ncache_entry_t.pending */
+	link_t lpending;
+	/** Caller argument */
+	void *arg;
+	/** Packet data (owned by the packet) */
+	void *data;
+	/** Size of packet data */
+	size_t size;
+} ncache_pkt_t;
+
+/** Neighbor cache statistics */
+typedef struct {
+	/** Lookups answered with a link address */
+	uint64_t hits;
+	/** Lookups answered from a negative entry */
+	uint64_t neg_hits;
+	/** Lookups that started resolution */
+	uint64_t misses;
+	/** Resolutions that failed */
+	uint64_t failed;
+	/** Entries removed by aging */
+	uint64_t expired;
+	/** Packets dropped because the queue was full or resolution failed */
+	uint64_t dropped;
+} ncache_stats_t;
+
+/** Neighbor cache */
+typedef struct {
+	/** Protects the cache */
+	fibril_mutex_t lock;
+	/** Entries (of ncache_entry_t) hashed by network address */
+	hash_table_t entries;
+	/** Timer removing expired entries */
+	fibril_timer_t *aging_timer;
+	/** Time a confirmed entry is reachable (usec) */
+	usec_t reachable_time;
+	/** Time a stale entry is kept (usec) */
+	usec_t stale_time;
+	/** Time to wait for resolution (usec) */
+	usec_t incomplete_time;
+	/** Time a failed resolution is remembered (usec) */
+	usec_t failed_time;
+	/** Maximum number of pending packets per entry */
+	size_t pending_max;
+	/** Return current time (usec) */
+	usec_t (*uptime)(void);
+	/** Statistics */
+	ncache_stats_t stats;
+} ncache_t;
+
+extern errno_t ncache_create(ncache_t **);
+extern void ncache_destroy(ncache_t *);
+extern errno_t ncache_resolve(ncache_t *, inet_addr_t *, eth_addr_t *,
+    bool *);
+extern errno_t ncache_update(ncache_t *, inet_addr_t *, eth_addr_t *,
+    list_t *);
+extern errno_t ncache_enqueue(ncache_t *, inet_addr_t *, void *, void *,
+    size_t);
+extern errno_t ncache_wait(ncache_t *, inet_addr_t *, usec_t, eth_addr_t *);
+extern errno_t ncache_remove(ncache_t *, inet_addr_t *);
+extern void ncache_age(ncache_t *);
+extern void ncache_get_stats(ncache_t *, ncache_stats_t *);
+extern ncache_pkt_t *ncache_pkt_first(list_t *);
+extern void ncache_pkt_destroy(ncache_pkt_t *);
+
+#endif
+
+/** @}
+ */
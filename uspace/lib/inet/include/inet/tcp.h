@@ -113,6 +113,7 @@ extern errno_t tcp_conn_send(tcp_conn_t *, const void *, size_t);
 extern errno_t tcp_conn_send_fin(tcp_conn_t *);
 extern errno_t tcp_conn_push(tcp_conn_t *);
 extern errno_t tcp_conn_reset(tcp_conn_t *);
+extern errno_t tcp_conn_set_nodelay(tcp_conn_t *, bool);
 
 extern errno_t tcp_conn_recv(tcp_conn_t *, void *, size_t, size_t *);
 extern errno_t tcp_conn_recv_wait(tcp_conn_t *, void *, size_t, size_t *);
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup libinet
+ * @{
+ */
+/** @file UDP shared message ring
+ */
+
+#ifndef LIBINET_INET_UDP_RING_H
+#define LIBINET_INET_UDP_RING_H
+
+#include <inet/endpoint.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types/common.h>
+
+/** Size of receive ring (must be a power of two) */
+#define UDP_RING_RX_SIZE  (256 * 1024)
+/** Size of transmit buffer */
+#define UDP_RING_TX_SIZE  (128 * 1024)
+/** Alignment of messages in ring */
+#define UDP_RING_ALIGN  8
+
+/** Message flags */
+typedef enum {
+	/** Entry only pads the ring up to its end */
+	urf_wrap = 0x1
+} udp_ring_flags_t;
+
+/** Message in shared ring or transmit buffer */
+typedef struct {
+	/** Size of entry including this header and padding */
+	uint32_t esize;
+	/** Flags (udp_ring_flags_t) */
+	uint32_t flags;
+	/** Association ID */
+	sysarg_t assoc_id;
+	/** Remote endpoint (received) or destination (sent) */
+	inet_ep_t ep;
+	/** Size of message data following the header */
+	size_t size;
+} udp_ring_msg_t;
+
+/** Memory area shared between UDP client and UDP service.
+ *
+ * The service places received messages into the receive ring and
+ * the client consumes them without further IPC. The client places
+ * messages to be sent into the transmit buffer and hands them over
+ * with a single request.
+ */
+typedef struct {
+	/** Receive ring producer position, advanced by service */
+	atomic_size_t rx_head;
+	/** Receive ring consumer position, advanced by client */
+	atomic_size_t rx_tail;
+	/** Service has sent data event that client has not handled yet */
+	atomic_uint rx_event;
+	/** Service holds messages that did not fit into the ring */
+	atomic_uint rx_stalled;
+	/** Receive ring */
+	uint8_t rx[UDP_RING_RX_SIZE];
+	/** Transmit buffer */
+	uint8_t tx[UDP_RING_TX_SIZE];
+} udp_shm_t;
+
+extern void udp_shm_init(udp_shm_t *);
+extern size_t udp_ring_msg_esize(size_t);
+extern void udp_ring_msg_write(void *, sysarg_t, inet_ep_t *, const void *,
+    size_t);
+extern void *udp_ring_msg_data(udp_ring_msg_t *);
+extern bool udp_ring_put(udp_shm_t *, sysarg_t, inet_ep_t *, const void *,
+    size_t);
+extern udp_ring_msg_t *udp_ring_get(udp_shm_t *);
+extern void udp_ring_consume(udp_shm_t *, udp_ring_msg_t *);
+
+#endif
+
+/** @}
+ */
@@ -56,6 +56,8 @@ typedef enum {
 	INETCFG_ADDR_DELETE,
 	INETCFG_ADDR_GET,
 	INETCFG_ADDR_GET_ID,
+	INETCFG_BATCH_BEGIN,
+	INETCFG_BATCH_END,
 	INETCFG_GET_ADDR_LIST,
 	INETCFG_GET_LINK_LIST,
 	INETCFG_GET_SROUTE_LIST,
@@ -48,7 +48,8 @@ typedef enum {
 	TCP_CONN_PUSH,
 	TCP_CONN_RESET,
 	TCP_CONN_RECV,
-	TCP_CONN_RECV_WAIT
+	TCP_CONN_RECV_WAIT,
+	TCP_CONN_SET_NODELAY
 } tcp_request_t;
 
 typedef enum {
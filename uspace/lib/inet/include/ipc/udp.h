@@ -45,7 +45,10 @@ typedef enum {
 	UDP_ASSOC_SEND_MSG,
 	UDP_RMSG_INFO,
 	UDP_RMSG_READ,
-	UDP_RMSG_DISCARD
+	UDP_RMSG_DISCARD,
+	UDP_SHM_CREATE,
+	UDP_RMSG_RESUME,
+	UDP_ASSOC_SEND_BATCH
 } udp_request_t;
 
 typedef enum {
@@ -252,6 +252,39 @@ errno_t inetcfg_addr_get_id(const char *name, sysarg_t link_id, sysarg_t *addr_i
 	return retval;
 }
 
+/** Begin configuration batch.
+ *
+ * Until the batch is ended, changes are not saved to the configuration
+ * file. This makes it faster to apply many changes at once.
+ *
+ * @return EOK on success or an error code
+ */
+errno_t inetcfg_batch_begin(void)
+{
+	async_exch_t *exch = async_exchange_begin(inetcfg_sess);
+
+	errno_t rc = async_req_0_0(exch, INETCFG_BATCH_BEGIN);
+	async_exchange_end(exch);
+
+	return rc;
+}
+
+/** End configuration batch.
+ *
+ * If this was the last open batch, the configuration is saved.
+ *
+ * @return EOK on success or an error code
+ */
+errno_t inetcfg_batch_end(void)
+{
+	async_exch_t *exch = async_exchange_begin(inetcfg_sess);
+
+	errno_t rc = async_req_0_0(exch, INETCFG_BATCH_END);
+	async_exchange_end(exch);
+
+	return rc;
+}
+
 errno_t inetcfg_get_addr_list(sysarg_t **addrs, size_t *count)
 {
 	return inetcfg_get_ids_internal(INETCFG_GET_ADDR_LIST,
@@ -0,0 +1,673 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup libinet
+ * @{
+ */
+/** @file Neighbor cache
+ *
+ * Maps network addresses of neighbors to link addresses for ARP and NDP.
+ * Entries are hashed by network address. A lookup of an unknown address
+ * creates an incomplete entry and the caller is asked to send a request.
+ * Packets for the address can be queued on the entry (up to a limit) and
+ * fibrils can wait for resolution on the entry itself. A confirmed entry
+ * is reachable for a while, then becomes stale: it is still used, but
+ * the caller is asked once to refresh it. Stale entries that are not
+ * refreshed expire. A failed resolution leaves a negative entry behind
+ * so that lookups fail immediately for a while instead of sending more
+ * requests.
+ */
+
+#include <adt/hash.h>
+#include <adt/hash_table.h>
+#include <adt/list.h>
+#include <assert.h>
+#include <errno.h>
+#include <fibril_synch.h>
+#include <inet/addr.h>
+#include <inet/eth_addr.h>
+#include <inet/ncache.h>
+#include <macros.h>
+#include <stdlib.h>
+#include <time.h>
+
+static size_t ncache_addr_hash(const inet_addr_t *addr)
+{
+	size_t hash = 0;
+	size_t i;
+
+	switch (addr->version) {
+	case ip_v4:
+		return hash_mix(addr->addr);
+	case ip_v6:
+		for (i = 0; i < 16; i += 4) {
+			hash = hash_combine(hash, ((uint32_t) addr->addr6[i] << 24) |
+			    ((uint32_t) addr->addr6[i + 1] << 16) |
+			    ((uint32_t) addr->addr6[i + 2] << 8) |
+			    addr->addr6[i + 3]);
+		}
+		return hash;
+	default:
+		return 0;
+	}
+}
+
+static size_t ncache_hash(const ht_link_t *item)
+{
+	ncache_entry_t *entry = hash_table_get_inst(item, ncache_entry_t,
+	    lentries);
+
+	return ncache_addr_hash(&entry->addr);
+}
+
+static size_t ncache_key_hash(const void *key)
+{
+	return ncache_addr_hash((const inet_addr_t *) key);
+}
+
+static bool ncache_key_equal(const void *key, size_t hash,
+    const ht_link_t *item)
+{
+	ncache_entry_t *entry = hash_table_get_inst(item, ncache_entry_t,
+	    lentries);
+
+	return inet_addr_compare((const inet_addr_t *) key, &entry->addr);
+}
+
+static bool ncache_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	ncache_entry_t *entry1 = hash_table_get_inst(item1, ncache_entry_t,
+	    lentries);
+	ncache_entry_t *entry2 = hash_table_get_inst(item2, ncache_entry_t,
+	    lentries);
+
+	return inet_addr_compare(&entry1->addr, &entry2->addr);
+}
+
+/** Free pending packets of entry.
+ *
+ * @param entry Entry
+ * @return Number of packets freed
+ */
+static size_t ncache_entry_drop_pending(ncache_entry_t *entry)
+{
+	ncache_pkt_t *pkt;
+	size_t count = 0;
+
+	while ((pkt = ncache_pkt_first(&entry->pending)) != NULL) {
+		ncache_pkt_destroy(pkt);
+		++count;
+	}
+
+	entry->npending = 0;
+	return count;
+}
+
+static void ncache_remove_callback(ht_link_t *item)
+{
+	ncache_entry_t *entry = hash_table_get_inst(item, ncache_entry_t,
+	    lentries);
+
+	assert(entry->waiters == 0);
+	(void) ncache_entry_drop_pending(entry);
+	free(entry);
+}
+
+static const hash_table_ops_t ncache_ops = {
+	.hash = ncache_hash,
+	.key_hash = ncache_key_hash,
+	.key_equal = ncache_key_equal,
+	.equal = ncache_equal,
+	.remove_callback = ncache_remove_callback
+};
+
+/** Return current uptime in microseconds. */
+static usec_t ncache_uptime(void)
+{
+	struct timespec ts;
+
+	getuptime(&ts);
+	return SEC2USEC(ts.tv_sec) + NSEC2USEC(ts.tv_nsec);
+}
+
+static void ncache_aging_timer(void *arg)
+{
+	ncache_t *ncache = (ncache_t *) arg;
+
+	ncache_age(ncache);
+	fibril_timer_set(ncache->aging_timer, NCACHE_AGING_INTERVAL,
+	    ncache_aging_timer, ncache);
+}
+
+/** Create neighbor cache.
+ *
+ * Expired entries are removed periodically until the cache is destroyed.
+ *
+ * @param rncache Place to store pointer to new neighbor cache
+ * @return EOK on success, ENOMEM if out of memory
+ */
+errno_t ncache_create(ncache_t **rncache)
+{
+	ncache_t *ncache;
+
+	ncache = calloc(1, sizeof(ncache_t));
+	if (ncache == NULL)
+		return ENOMEM;
+
+	fibril_mutex_initialize(&ncache->lock);
+
+	if (!hash_table_create(&ncache->entries, 0, 0, &ncache_ops)) {
+		free(ncache);
+		return ENOMEM;
+	}
+
+	ncache->aging_timer = fibril_timer_create(NULL);
+	if (ncache->aging_timer == NULL) {
+		hash_table_destroy(&ncache->entries);
+		free(ncache);
+		return ENOMEM;
+	}
+
+	ncache->reachable_time = NCACHE_REACHABLE_TIME;
+	ncache->stale_time = NCACHE_STALE_TIME;
+	ncache->incomplete_time = NCACHE_INCOMPLETE_TIME;
+	ncache->failed_time = NCACHE_FAILED_TIME;
+	ncache->pending_max = NCACHE_PENDING_MAX;
+	ncache->uptime = ncache_uptime;
+
+	fibril_timer_set(ncache->aging_timer, NCACHE_AGING_INTERVAL,
+	    ncache_aging_timer, ncache);
+
+	*rncache = ncache;
+	return EOK;
+}
+
+/** Destroy neighbor cache.
+ *
+ * No fibril may be waiting on the cache.
+ *
+ * @param ncache Neighbor cache
+ */
+void ncache_destroy(ncache_t *ncache)
+{
+	if (ncache == NULL)
+		return;
+
+	(void) fibril_timer_clear(ncache->aging_timer);
+	fibril_timer_destroy(ncache->aging_timer);
+
+	hash_table_destroy(&ncache->entries);
+	free(ncache);
+}
+
+static ncache_entry_t *ncache_find(ncache_t *ncache, inet_addr_t *addr)
+{
+	ht_link_t *link;
+
+	assert(fibril_mutex_is_locked(&ncache->lock));
+
+	link = hash_table_find(&ncache->entries, addr);
+	if (link == NULL)
+		return NULL;
+
+	return hash_table_get_inst(link, ncache_entry_t, lentries);
+}
+
+static ncache_entry_t *ncache_entry_create(ncache_t *ncache,
+    inet_addr_t *addr)
+{
+	ncache_entry_t *entry;
+
+	assert(fibril_mutex_is_locked(&ncache->lock));
+
+	entry = calloc(1, sizeof(ncache_entry_t));
+	if (entry == NULL)
+		return NULL;
+
+	entry->addr = *addr;
+	fibril_condvar_initialize(&entry->cv);
+	list_initialize(&entry->pending);
+
+	hash_table_insert(&ncache->entries, &entry->lentries);
+	return entry;
+}
+
+/** Start resolution of entry. */
+static void ncache_entry_incomplete(ncache_t *ncache, ncache_entry_t *entry,
+    usec_t now)
+{
+	entry->state = nce_incomplete;
+	entry->expires = now + ncache->incomplete_time;
+	entry->probing = false;
+}
+
+/** Mark resolution of entry as failed.
+ *
+ * Pending packets are dropped and waiting fibrils are woken up.
+ */
+static void ncache_entry_fail(ncache_t *ncache, ncache_entry_t *entry,
+    usec_t now)
+{
+	entry->state = nce_failed;
+	entry->expires = now + ncache->failed_time;
+
+	++ncache->stats.failed;
+	ncache->stats.dropped += ncache_entry_drop_pending(entry);
+	fibril_condvar_broadcast(&entry->cv);
+}
+
+/** Update entry state according to current time. */
+static void ncache_entry_tick(ncache_t *ncache, ncache_entry_t *entry,
+    usec_t now)
+{
+	if (now < entry->expires)
+		return;
+
+	switch (entry->state) {
+	case nce_incomplete:
+		ncache_entry_fail(ncache, entry, now);
+		break;
+	case nce_reachable:
+		entry->state = nce_stale;
+		entry->expires = now + ncache->stale_time;
+		entry->probing = false;
+		break;
+	case nce_stale:
+	case nce_failed:
+		/* Entry has expired, left for the caller to remove */
+		break;
+	}
+}
+
+/** Look up link address of neighbor.
+ *
+ * If there is no usable entry, resolution is started and @a solicit is
+ * set to @c true: the caller should send a request (ARP request, neighbor
+ * solicitation) for @a addr. @a solicit is also set if a stale entry
+ * is returned and the caller should refresh it.
+ *
+ * @param ncache Neighbor cache
+ * @param addr Network address
+ * @param mac Place to store link address
+ * @param solicit Place to store @c true if a request should be sent
+ * @return EOK if @a mac was filled in, EAGAIN if resolution is in
+ *         progress, ENOENT if resolution failed recently, ENOMEM if
+ *         out of memory
+ */
+errno_t ncache_resolve(ncache_t *ncache, inet_addr_t *addr, eth_addr_t *mac,
+    bool *solicit)
+{
+	ncache_entry_t *entry;
+	usec_t now;
+	errno_t rc;
+
+	now = ncache->uptime();
+	*solicit = false;
+
+	fibril_mutex_lock(&ncache->lock);
+
+	entry = ncache_find(ncache, addr);
+	if (entry == NULL) {
+		entry = ncache_entry_create(ncache, addr);
+		if (entry == NULL) {
+			fibril_mutex_unlock(&ncache->lock);
+			return ENOMEM;
+		}
+
+		ncache_entry_incomplete(ncache, entry, now);
+		++ncache->stats.misses;
+		fibril_mutex_unlock(&ncache->lock);
+		*solicit = true;
+		return EAGAIN;
+	}
+
+	ncache_entry_tick(ncache, entry, now);
+
+	switch (entry->state) {
+	case nce_reachable:
+		*mac = entry->mac;
+		++ncache->stats.hits;
+		rc = EOK;
+		break;
+	case nce_stale:
+		if (now >= entry->expires) {
+			/* Expired, resolve again */
+			ncache_entry_incomplete(ncache, entry, now);
+			++ncache->stats.misses;
+			*solicit = true;
+			rc = EAGAIN;
+			break;
+		}
+
+		*mac = entry->mac;
+		++ncache->stats.hits;
+		if (!entry->probing) {
+			entry->probing = true;
+			*solicit = true;
+		}
+		rc = EOK;
+		break;
+	case nce_incomplete:
+		rc = EAGAIN;
+		break;
+	case nce_failed:
+		if (now >= entry->expires) {
+			ncache_entry_incomplete(ncache, entry, now);
+			++ncache->stats.misses;
+			*solicit = true;
+			rc = EAGAIN;
+			break;
+		}
+
+		++ncache->stats.neg_hits;
+		rc = ENOENT;
+		break;
+	}
+
+	fibril_mutex_unlock(&ncache->lock);
+	return rc;
+}
+
+/** Record link address of neighbor.
+ *
+ * Called when the link address of a neighbor is learned or confirmed.
+ * The entry becomes reachable, waiting fibrils are woken up and packets
+ * that were waiting for resolution are moved to @a sendq. The caller
+ * should fill in the link address, send them and destroy them.
+ *
+ * @param ncache Neighbor cache
+ * @param addr Network address
+ * @param mac Link address
+ * @param sendq List to append pending packets to (of ncache_pkt_t) or
+ *              @c NULL
+ * @return EOK on success, ENOMEM if out of memory
+ */
+errno_t ncache_update(ncache_t *ncache, inet_addr_t *addr, eth_addr_t *mac,
+    list_t *sendq)
+{
+	ncache_entry_t *entry;
+	usec_t now;
+
+	now = ncache->uptime();
+
+	fibril_mutex_lock(&ncache->lock);
+
+	entry = ncache_find(ncache, addr);
+	if (entry == NULL) {
+		entry = ncache_entry_create(ncache, addr);
+		if (entry == NULL) {
+			fibril_mutex_unlock(&ncache->lock);
+			return ENOMEM;
+		}
+	}
+
+	entry->mac = *mac;
+	entry->state = nce_reachable;
+	entry->expires = now + ncache->reachable_time;
+	entry->probing = false;
+
+	if (sendq != NULL)
+		list_concat(sendq, &entry->pending);
+	else
+		ncache->stats.dropped += ncache_entry_drop_pending(entry);
+	entry->npending = 0;
+
+	fibril_condvar_broadcast(&entry->cv);
+	fibril_mutex_unlock(&ncache->lock);
+	return EOK;
+}
+
+/** Queue packet until neighbor address is resolved.
+ *
+ * On success the packet data is owned by the cache. It is handed back
+ * by ncache_update() or freed if resolution fails.
+ *
+ * @param ncache Neighbor cache
+ * @param addr Network address
+ * @param arg Caller argument stored with the packet
+ * @param data Packet data allocated with malloc()
+ * @param size Size of packet data
+ * @return EOK on success, ENOENT if resolution of @a addr is not in
+ *         progress, ELIMIT if too many packets are queued already,
+ *         ENOMEM if out of memory
+ */
+errno_t ncache_enqueue(ncache_t *ncache, inet_addr_t *addr, void *arg,
+    void *data, size_t size)
+{
+	ncache_entry_t *entry;
+	ncache_pkt_t *pkt;
+
+	fibril_mutex_lock(&ncache->lock);
+
+	entry = ncache_find(ncache, addr);
+	if (entry == NULL || entry->state != nce_incomplete) {
+		fibril_mutex_unlock(&ncache->lock);
+		return ENOENT;
+	}
+
+	if (entry->npending >= ncache->pending_max) {
+		++ncache->stats.dropped;
+		fibril_mutex_unlock(&ncache->lock);
+		return ELIMIT;
+	}
+
+	pkt = calloc(1, sizeof(ncache_pkt_t));
+	if (pkt == NULL) {
+		fibril_mutex_unlock(&ncache->lock);
+		return ENOMEM;
+	}
+
+	pkt->arg = arg;
+	pkt->data = data;
+	pkt->size = size;
+	list_append(&pkt->lpending, &entry->pending);
+	++entry->npending;
+
+	fibril_mutex_unlock(&ncache->lock);
+	return EOK;
+}
+
+/** Wait for resolution of neighbor address.
+ *
+ * @param ncache Neighbor cache
+ * @param addr Network address
+ * @param timeout Maximum time to wait (usec)
+ * @param mac Place to store link address
+ * @return EOK on success, ENOENT if the address could not be resolved
+ */
+errno_t ncache_wait(ncache_t *ncache, inet_addr_t *addr, usec_t timeout,
+    eth_addr_t *mac)
+{
+	ncache_entry_t *entry;
+	usec_t now;
+	usec_t deadline;
+	usec_t delay;
+	errno_t rc;
+
+	now = ncache->uptime();
+	deadline = now + timeout;
+
+	fibril_mutex_lock(&ncache->lock);
+
+	entry = ncache_find(ncache, addr);
+	if (entry == NULL) {
+		fibril_mutex_unlock(&ncache->lock);
+		return ENOENT;
+	}
+
+	while (entry->state == nce_incomplete && now < deadline) {
+		delay = min(deadline, entry->expires) - now;
+		if (delay > 0) {
+			++entry->waiters;
+			(void) fibril_condvar_wait_timeout(&entry->cv,
+			    &ncache->lock, delay);
+			--entry->waiters;
+		}
+
+		now = ncache->uptime();
+		ncache_entry_tick(ncache, entry, now);
+	}
+
+	switch (entry->state) {
+	case nce_reachable:
+	case nce_stale:
+		*mac = entry->mac;
+		rc = EOK;
+		break;
+	default:
+		rc = ENOENT;
+		break;
+	}
+
+	fibril_mutex_unlock(&ncache->lock);
+	return rc;
+}
+
+/** Remove neighbor from cache.
+ *
+ * @param ncache Neighbor cache
+ * @param addr Network address
+ * @return EOK on success, ENOENT if there is no such entry
+ */
+errno_t ncache_remove(ncache_t *ncache, inet_addr_t *addr)
+{
+	ncache_entry_t *entry;
+	usec_t now;
+
+	now = ncache->uptime();
+
+	fibril_mutex_lock(&ncache->lock);
+
+	entry = ncache_find(ncache, addr);
+	if (entry == NULL) {
+		fibril_mutex_unlock(&ncache->lock);
+		return ENOENT;
+	}
+
+	if (entry->waiters > 0) {
+		/* Wake up waiters, aging removes the entry later */
+		ncache_entry_fail(ncache, entry, now);
+		entry->expires = now;
+	} else {
+		ncache->stats.dropped += ncache_entry_drop_pending(entry);
+		hash_table_remove_item(&ncache->entries, &entry->lentries);
+	}
+
+	fibril_mutex_unlock(&ncache->lock);
+	return EOK;
+}
+
+/** Neighbor cache aging context */
+typedef struct {
+	ncache_t *ncache;
+	usec_t now;
+} ncache_age_t;
+
+static bool ncache_age_entry(ht_link_t *item, void *arg)
+{
+	ncache_age_t *age = (ncache_age_t *) arg;
+	ncache_entry_t *entry = hash_table_get_inst(item, ncache_entry_t,
+	    lentries);
+
+	ncache_entry_tick(age->ncache, entry, age->now);
+
+	if ((entry->state == nce_stale || entry->state == nce_failed) &&
+	    age->now >= entry->expires && entry->waiters == 0) {
+		++age->ncache->stats.expired;
+		hash_table_remove_item(&age->ncache->entries, item);
+	}
+
+	return true;
+}
+
+/** Advance entry states and remove expired entries.
+ *
+ * Incomplete entries whose resolution timed out become negative entries,
+ * reachable entries become stale, stale and negative entries that
+ * expired are removed.
+ *
+ * @param ncache Neighbor cache
+ */
+void ncache_age(ncache_t *ncache)
+{
+	ncache_age_t age;
+
+	age.ncache = ncache;
+	age.now = ncache->uptime();
+
+	fibril_mutex_lock(&ncache->lock);
+	hash_table_apply(&ncache->entries, ncache_age_entry, &age);
+	fibril_mutex_unlock(&ncache->lock);
+}
+
+/** Get neighbor cache statistics.
+ *
+ * @param ncache Neighbor cache
+ * @param stats Place to store statistics
+ */
+void ncache_get_stats(ncache_t *ncache, ncache_stats_t *stats)
+{
+	fibril_mutex_lock(&ncache->lock);
+	*stats = ncache->stats;
+	fibril_mutex_unlock(&ncache->lock);
+}
+
+/** Get first packet in packet list.
+ *
+ * @param list List of ncache_pkt_t
+ * @return First packet or @c NULL if the list is empty
+ */
+ncache_pkt_t *ncache_pkt_first(list_t *list)
+{
+	link_t *link;
+
+	link = list_first(list);
+	if (link == NULL)
+		return NULL;
+
+	return list_get_instance(link, ncache_pkt_t, lpending);
+}
+
+/** Destroy packet.
+ *
+ * Removes the packet from the list it is in and frees its data.
+ *
+ * @param pkt Packet
+ */
+void ncache_pkt_destroy(ncache_pkt_t *pkt)
+{
+	if (link_used(&pkt->lpending))
+		list_remove(&pkt->lpending);
+
+	free(pkt->data);
+	free(pkt);
+}
+
+/** @}
+ */
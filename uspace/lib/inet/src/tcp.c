@@ -505,6 +505,28 @@ errno_t tcp_conn_push(tcp_conn_t *conn)
 	return rc;
 }
 
+/** Enable or disable delaying of small segments on connection.
+ *
+ * By default small segments are held back while there is unacknowledged
+ * data in flight so that they can be coalesced (Nagle algorithm).
+ * Latency-sensitive applications can disable this.
+ *
+ * @param conn Connection
+ * @param nodelay @c true to send small segments without delay
+ * @return EOK on success or an error code
+ */
+errno_t tcp_conn_set_nodelay(tcp_conn_t *conn, bool nodelay)
+{
+	async_exch_t *exch;
+
+	exch = async_exchange_begin(conn->tcp->sess);
+	errno_t rc = async_req_2_0(exch, TCP_CONN_SET_NODELAY, conn->id,
+	    nodelay);
+	async_exchange_end(exch);
+
+	return rc;
+}
+
 /** Reset connection.
  *
  * @param conn Connection
@@ -32,12 +32,16 @@
 /** @file UDP API
  */
 
+#include <as.h>
 #include <errno.h>
 #include <inet/endpoint.h>
 #include <inet/udp.h>
+#include <inet/udp_ring.h>
 #include <ipc/services.h>
 #include <ipc/udp.h>
 #include <loc.h>
+#include <macros.h>
+#include <mem.h>
 #include <stdlib.h>
 
 static void udp_cb_conn(ipc_call_t *, void *);
@@ -68,6 +72,51 @@ static errno_t udp_callback_create(udp_t *udp)
 	return retval;
 }
 
+/** Set up memory area shared with UDP service.
+ *
+ * Received messages are then passed through the shared receive ring
+ * and messages can be sent in batches.
+ *
+ * @param udp UDP service
+ * @return EOK on success or an error code
+ */
+static errno_t udp_shm_create(udp_t *udp)
+{
+	udp_shm_t *shm;
+	errno_t rc;
+
+	shm = as_area_create(AS_AREA_ANY, sizeof(udp_shm_t), AS_AREA_READ |
+	    AS_AREA_WRITE | AS_AREA_CACHEABLE, AS_AREA_UNPAGED);
+	if (shm == AS_MAP_FAILED)
+		return ENOMEM;
+
+	udp_shm_init(shm);
+
+	/* Events may start to arrive before the request is answered */
+	udp->shm = shm;
+
+	async_exch_t *exch = async_exchange_begin(udp->sess);
+	aid_t req = async_send_0(exch, UDP_SHM_CREATE, NULL);
+	rc = async_share_out_start(exch, shm, AS_AREA_READ | AS_AREA_WRITE |
+	    AS_AREA_CACHEABLE);
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		goto error;
+	}
+
+	async_wait_for(req, &rc);
+	if (rc != EOK)
+		goto error;
+
+	return EOK;
+error:
+	udp->shm = NULL;
+	as_area_destroy(shm);
+	return rc;
+}
+
 /** Create UDP client instance.
  *
  * @param  rudp Place to store pointer to new UDP client
@@ -89,6 +138,7 @@ errno_t udp_create(udp_t **rudp)
 	list_initialize(&udp->assoc);
 	fibril_mutex_initialize(&udp->lock);
 	fibril_condvar_initialize(&udp->cv);
+	fibril_mutex_initialize(&udp->tx_lock);
 
 	rc = loc_service_get_id(SERVICE_NAME_UDP, &udp_svcid,
 	    IPC_FLAG_BLOCKING);
@@ -110,6 +160,9 @@ errno_t udp_create(udp_t **rudp)
 		goto error;
 	}
 
+	/* Fall back to per-message requests if this fails */
+	(void) udp_shm_create(udp);
+
 	*rudp = udp;
 	return EOK;
 error:
@@ -133,6 +186,8 @@ void udp_destroy(udp_t *udp)
 		fibril_condvar_wait(&udp->cv, &udp->lock);
 	fibril_mutex_unlock(&udp->lock);
 
+	if (udp->shm != NULL)
+		as_area_destroy(udp->shm);
 	free(udp);
 }
 
@@ -291,6 +346,87 @@ errno_t udp_assoc_send_msg(udp_assoc_t *assoc, inet_ep_t *dest, void *data,
 	return rc;
 }
 
+/** Send batch of messages via UDP association.
+ *
+ * The messages are copied to the transmit buffer shared with the UDP
+ * service and handed over using a single request for as many messages
+ * as fit into the buffer.
+ *
+ * @param assoc Association
+ * @param msgs  Array of messages
+ * @param n     Number of messages
+ * @param rsent Place to store number of messages sent
+ *
+ * @return EOK if at least one message was sent, otherwise an error code
+ */
+errno_t udp_assoc_send_batch(udp_assoc_t *assoc, udp_smsg_t *msgs, size_t n,
+    size_t *rsent)
+{
+	udp_t *udp = assoc->udp;
+	async_exch_t *exch;
+	inet_ep_t ddest;
+	udp_smsg_t *smsg;
+	sysarg_t nsent;
+	size_t sent;
+	size_t cnt;
+	size_t len;
+	size_t esize;
+	errno_t rc = EOK;
+
+	inet_ep_init(&ddest);
+	sent = 0;
+
+	fibril_mutex_lock(&udp->tx_lock);
+
+	while (sent < n) {
+		/* Fill transmit buffer */
+		len = 0;
+		cnt = 0;
+		while (udp->shm != NULL && sent + cnt < n) {
+			smsg = &msgs[sent + cnt];
+			esize = udp_ring_msg_esize(smsg->size);
+			if (smsg->size > UDP_RING_TX_SIZE ||
+			    len + esize > UDP_RING_TX_SIZE)
+				break;
+
+			udp_ring_msg_write(&udp->shm->tx[len], assoc->id,
+			    smsg->dest != NULL ? smsg->dest : &ddest,
+			    smsg->data, smsg->size);
+			len += esize;
+			++cnt;
+		}
+
+		if (cnt == 0) {
+			/* No shared buffer or message too large for it */
+			smsg = &msgs[sent];
+			rc = udp_assoc_send_msg(assoc, smsg->dest, smsg->data,
+			    smsg->size);
+			if (rc != EOK)
+				break;
+
+			++sent;
+			continue;
+		}
+
+		exch = async_exchange_begin(udp->sess);
+		rc = async_req_2_1(exch, UDP_ASSOC_SEND_BATCH, assoc->id, len,
+		    &nsent);
+		async_exchange_end(exch);
+
+		if (rc != EOK)
+			break;
+
+		sent += min(nsent, cnt);
+		if (nsent < cnt)
+			break;
+	}
+
+	fibril_mutex_unlock(&udp->tx_lock);
+
+	*rsent = sent;
+	return sent > 0 ? EOK : rc;
+}
+
 /** Get the user/callback argument for an association.
  *
  * @param assoc UDP association
@@ -329,6 +465,16 @@ errno_t udp_rmsg_read(udp_rmsg_t *rmsg, size_t off, void *buf, size_t bsize)
 	async_exch_t *exch;
 	ipc_call_t answer;
 
+	if (rmsg->data != NULL) {
+		/* Message is in shared receive ring */
+		if (off > rmsg->size)
+			return EINVAL;
+
+		memcpy(buf, (uint8_t *) rmsg->data + off,
+		    min(rmsg->size - off, bsize));
+		return EOK;
+	}
+
 	exch = async_exchange_begin(rmsg->udp->sess);
 	aid_t req = async_send_1(exch, UDP_RMSG_READ, off, &answer);
 	errno_t rc = async_data_read_start(exch, buf, bsize);
@@ -413,6 +559,7 @@ static errno_t udp_rmsg_info(udp_t *udp, udp_rmsg_t *rmsg)
 	rmsg->assoc_id = ipc_get_arg1(&answer);
 	rmsg->size = ipc_get_arg2(&answer);
 	rmsg->remote_ep = ep;
+	rmsg->data = NULL;
 	return EOK;
 }
 
@@ -452,6 +599,51 @@ static errno_t udp_assoc_get(udp_t *udp, sysarg_t id, udp_assoc_t **rassoc)
 	return EINVAL;
 }
 
+/** Deliver messages from shared receive ring.
+ *
+ * @param udp UDP client
+ */
+static void udp_ev_data_ring(udp_t *udp)
+{
+	udp_shm_t *shm = udp->shm;
+	udp_ring_msg_t *msg;
+	udp_rmsg_t rmsg;
+	udp_assoc_t *assoc;
+	async_exch_t *exch;
+	errno_t rc;
+
+	/*
+	 * Clear the event flag before looking at the ring. If the service
+	 * adds messages after we have found the ring empty, it will see
+	 * the flag cleared and send another event.
+	 */
+	atomic_store(&shm->rx_event, 0);
+	atomic_thread_fence(memory_order_seq_cst);
+
+	while ((msg = udp_ring_get(shm)) != NULL) {
+		rmsg.udp = udp;
+		rmsg.assoc_id = msg->assoc_id;
+		rmsg.size = msg->size;
+		rmsg.remote_ep = msg->ep;
+		rmsg.data = udp_ring_msg_data(msg);
+
+		rc = udp_assoc_get(udp, rmsg.assoc_id, &assoc);
+		if (rc == EOK && assoc->cb != NULL &&
+		    assoc->cb->recv_msg != NULL)
+			assoc->cb->recv_msg(assoc, &rmsg);
+
+		udp_ring_consume(shm, msg);
+	}
+
+	/* Let the service refill the ring if it ran out of space */
+	if (atomic_exchange(&shm->rx_stalled, 0) != 0) {
+		exch = async_exchange_begin(udp->sess);
+		rc = async_req_0_0(exch, UDP_RMSG_RESUME);
+		async_exchange_end(exch);
+		(void) rc;
+	}
+}
+
 /** Handle 'data' event, i.e. some message(s) arrived.
  *
  * For each received message, get information about it, call @c recv_msg
@@ -467,6 +659,12 @@ static void udp_ev_data(udp_t *udp, ipc_call_t *icall)
 	udp_assoc_t *assoc;
 	errno_t rc;
 
+	if (udp->shm != NULL) {
+		udp_ev_data_ring(udp);
+		async_answer_0(icall, EOK);
+		return;
+	}
+
 	while (true) {
 		rc = udp_rmsg_info(udp, &rmsg);
 		if (rc != EOK) {
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup libinet
+ * @{
+ */
+/** @file UDP shared message ring
+ *
+ * Single-producer, single-consumer ring of variable-size messages
+ * in memory shared between the UDP service (producer) and a UDP client
+ * (consumer). Positions are free-running byte counters, the offset
+ * into the ring is the position modulo ring size. A message never
+ * wraps around, if it does not fit before the end of the ring,
+ * the rest of the ring is skipped.
+ */
+
+#include <align.h>
+#include <assert.h>
+#include <inet/udp_ring.h>
+#include <mem.h>
+
+static_assert((UDP_RING_RX_SIZE & (UDP_RING_RX_SIZE - 1)) == 0,
+    "Ring size must be a power of two");
+static_assert(sizeof(udp_ring_msg_t) % UDP_RING_ALIGN == 0,
+    "Misaligned message header");
+static_assert(offsetof(udp_shm_t, rx) % UDP_RING_ALIGN == 0,
+    "Misaligned receive ring");
+static_assert(offsetof(udp_shm_t, tx) % UDP_RING_ALIGN == 0,
+    "Misaligned transmit buffer");
+
+/** Initialize shared area.
+ *
+ * @param shm Shared area
+ */
+void udp_shm_init(udp_shm_t *shm)
+{
+	atomic_init(&shm->rx_head, 0);
+	atomic_init(&shm->rx_tail, 0);
+	atomic_init(&shm->rx_event, 0);
+	atomic_init(&shm->rx_stalled, 0);
+}
+
+/** Get size of ring entry holding a message.
+ *
+ * @param size Size of message data
+ * @return Size of entry including header and padding
+ */
+size_t udp_ring_msg_esize(size_t size)
+{
+	return ALIGN_UP(sizeof(udp_ring_msg_t) + size, UDP_RING_ALIGN);
+}
+
+/** Write message entry.
+ *
+ * @param dst      Destination, must have room for udp_ring_msg_esize(size)
+ * @param assoc_id Association ID
+ * @param ep       Endpoint
+ * @param data     Message data
+ * @param size     Message size
+ */
+void udp_ring_msg_write(void *dst, sysarg_t assoc_id, inet_ep_t *ep,
+    const void *data, size_t size)
+{
+	udp_ring_msg_t *msg = (udp_ring_msg_t *) dst;
+
+	msg->esize = udp_ring_msg_esize(size);
+	msg->flags = 0;
+	msg->assoc_id = assoc_id;
+	msg->ep = *ep;
+	msg->size = size;
+	memcpy(msg + 1, data, size);
+}
+
+/** Get data of message entry.
+ *
+ * @param msg Message entry
+ * @return Pointer to message data
+ */
+void *udp_ring_msg_data(udp_ring_msg_t *msg)
+{
+	return msg + 1;
+}
+
+/** Put message into receive ring.
+ *
+ * Only called by the producer.
+ *
+ * @param shm      Shared area
+ * @param assoc_id Association ID
+ * @param ep       Remote endpoint
+ * @param data     Message data
+ * @param size     Message size
+ * @return @c true on success, @c false if there is not enough free space
+ */
+bool udp_ring_put(udp_shm_t *shm, sysarg_t assoc_id, inet_ep_t *ep,
+    const void *data, size_t size)
+{
+	size_t head;
+	size_t tail;
+	size_t used;
+	size_t off;
+	size_t contig;
+	size_t esize;
+	size_t need;
+	udp_ring_msg_t *pad;
+
+	head = atomic_load_explicit(&shm->rx_head, memory_order_relaxed);
+	tail = atomic_load_explicit(&shm->rx_tail, memory_order_acquire);
+
+	/* Do not trust the other side */
+	used = head - tail;
+	if (used > UDP_RING_RX_SIZE)
+		return false;
+
+	off = head % UDP_RING_RX_SIZE;
+	contig = UDP_RING_RX_SIZE - off;
+	esize = udp_ring_msg_esize(size);
+
+	need = esize;
+	if (esize > contig)
+		need += contig;
+
+	if (need > UDP_RING_RX_SIZE - used)
+		return false;
+
+	if (esize > contig) {
+		/* Skip the rest of the ring */
+		if (contig >= sizeof(udp_ring_msg_t)) {
+			pad = (udp_ring_msg_t *) &shm->rx[off];
+			pad->esize = contig;
+			pad->flags = urf_wrap;
+		}
+
+		head += contig;
+		off = 0;
+	}
+
+	udp_ring_msg_write(&shm->rx[off], assoc_id, ep, data, size);
+	atomic_store_explicit(&shm->rx_head, head + esize,
+	    memory_order_release);
+	return true;
+}
+
+/** Get next message from receive ring.
+ *
+ * Only called by the consumer. The message stays in the ring until
+ * it is released using udp_ring_consume().
+ *
+ * @param shm Shared area
+ * @return Next message or @c NULL if the ring is empty
+ */
+udp_ring_msg_t *udp_ring_get(udp_shm_t *shm)
+{
+	size_t head;
+	size_t tail;
+	size_t off;
+	size_t contig;
+	udp_ring_msg_t *msg;
+
+	tail = atomic_load_explicit(&shm->rx_tail, memory_order_relaxed);
+	head = atomic_load_explicit(&shm->rx_head, memory_order_acquire);
+
+	while (tail != head) {
+		off = tail % UDP_RING_RX_SIZE;
+		contig = UDP_RING_RX_SIZE - off;
+
+		msg = (udp_ring_msg_t *) &shm->rx[off];
+		if (contig >= sizeof(udp_ring_msg_t) &&
+		    (msg->flags & urf_wrap) == 0) {
+			/* Do not trust the other side */
+			if (msg->size > contig || msg->esize > contig ||
+			    msg->esize < udp_ring_msg_esize(msg->size))
+				return NULL;
+
+			return msg;
+		}
+
+		tail += contig;
+		atomic_store_explicit(&shm->rx_tail, tail,
+		    memory_order_release);
+	}
+
+	return NULL;
+}
+
+/** Release message from receive ring.
+ *
+ * @param shm Shared area
+ * @param msg Message returned by udp_ring_get()
+ */
+void udp_ring_consume(udp_shm_t *shm, udp_ring_msg_t *msg)
+{
+	size_t tail;
+
+	tail = atomic_load_explicit(&shm->rx_tail, memory_order_relaxed);
+	assert((uint8_t *) msg == &shm->rx[tail % UDP_RING_RX_SIZE]);
+
+	atomic_store_explicit(&shm->rx_tail, tail + msg->esize,
+	    memory_order_release);
+}
+
+/** @}
+ */
@@ -32,5 +32,7 @@ PCUT_INIT;
 
 PCUT_IMPORT(addr);
 PCUT_IMPORT(eth_addr);
+PCUT_IMPORT(ncache);
+PCUT_IMPORT(udp_ring);
 
 PCUT_MAIN();
@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <adt/list.h>
+#include <errno.h>
+#include <inet/addr.h>
+#include <inet/eth_addr.h>
+#include <inet/ncache.h>
+#include <pcut/pcut.h>
+#include <stdlib.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(ncache);
+
+/** Current time seen by the cache under test */
+static usec_t test_now;
+
+static usec_t test_uptime(void)
+{
+	return test_now;
+}
+
+static ncache_t *test_ncache_create(void)
+{
+	ncache_t *ncache;
+	errno_t rc;
+
+	rc = ncache_create(&ncache);
+	if (rc != EOK)
+		return NULL;
+
+	test_now = 1000;
+	ncache->uptime = test_uptime;
+	return ncache;
+}
+
+/** Unknown address is resolved once a reply arrives */
+PCUT_TEST(resolve)
+{
+	ncache_t *ncache;
+	inet_addr_t addr;
+	eth_addr_t mac;
+	eth_addr_t rmac;
+	bool solicit;
+	errno_t rc;
+
+	ncache = test_ncache_create();
+	PCUT_ASSERT_NOT_NULL(ncache);
+
+	inet_addr(&addr, 10, 0, 0, 1);
+	eth_addr_decode((uint8_t *) "\x00\x11\x22\x33\x44\x55", &mac);
+
+	/* First lookup asks for a request */
+	rc = ncache_resolve(ncache, &addr, &rmac, &solicit);
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, rc);
+	PCUT_ASSERT_TRUE(solicit);
+
+	/* Second lookup does not send another one */
+	rc = ncache_resolve(ncache, &addr, &rmac, &solicit);
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, rc);
+	PCUT_ASSERT_FALSE(solicit);
+
+	rc = ncache_update(ncache, &addr, &mac, NULL);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = ncache_resolve(ncache, &addr, &rmac, &solicit);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_FALSE(solicit);
+	PCUT_ASSERT_INT_EQUALS(0, eth_addr_compare(&mac, &rmac));
+
+	rc = ncache_wait(ncache, &addr, 0, &rmac);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, eth_addr_compare(&mac, &rmac));
+
+	ncache_destroy(ncache);
+}
+
+/** Pending packets are bounded and handed back on resolution */
+PCUT_TEST(pending)
+{
+	ncache_t *ncache;
+	inet_addr_t addr;
+	eth_addr_t mac;
+	list_t sendq;
+	ncache_pkt_t *pkt;
+	ncache_stats_t stats;
+	bool solicit;
+	size_t i;
+	errno_t rc;
+
+	ncache = test_ncache_create();
+	PCUT_ASSERT_NOT_NULL(ncache);
+
+	inet_addr(&addr, 10, 0, 0, 2);
+	eth_addr_decode((uint8_t *) "\x00\x11\x22\x33\x44\x66", &mac);
+
+	/* No resolution in progress */
+	rc = ncache_enqueue(ncache, &addr, NULL, NULL, 0);
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, rc);
+
+	rc = ncache_resolve(ncache, &addr, &mac, &solicit);
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, rc);
+
+	for (i = 0; i < ncache->pending_max; i++) {
+		rc = ncache_enqueue(ncache, &addr, (void *) (i + 1),
+		    malloc(1), 1);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	}
+
+	rc = ncache_enqueue(ncache, &addr, NULL, NULL, 0);
+	PCUT_ASSERT_ERRNO_VAL(ELIMIT, rc);
+
+	list_initialize(&sendq);
+	rc = ncache_update(ncache, &addr, &mac, &sendq);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Packets come back in order */
+	for (i = 0; i < ncache->pending_max; i++) {
+		pkt = ncache_pkt_first(&sendq);
+		PCUT_ASSERT_NOT_NULL(pkt);
+		PCUT_ASSERT_EQUALS((void *) (i + 1), pkt->arg);
+		ncache_pkt_destroy(pkt);
+	}
+
+	PCUT_ASSERT_NULL(ncache_pkt_first(&sendq));
+
+	ncache_get_stats(ncache, &stats);
+	PCUT_ASSERT_INT_EQUALS(1, stats.dropped);
+
+	ncache_destroy(ncache);
+}
+
+/** Failed resolution is remembered for a while */
+PCUT_TEST(negative)
+{
+	ncache_t *ncache;
+	inet_addr_t addr;
+	eth_addr_t mac;
+	ncache_stats_t stats;
+	bool solicit;
+	errno_t rc;
+
+	ncache = test_ncache_create();
+	PCUT_ASSERT_NOT_NULL(ncache);
+
+	inet_addr(&addr, 10, 0, 0, 3);
+
+	rc = ncache_resolve(ncache, &addr, &mac, &solicit);
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, rc);
+	rc = ncache_enqueue(ncache, &addr, NULL, malloc(1), 1);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* No reply in time */
+	test_now += ncache->incomplete_time;
+
+	rc = ncache_resolve(ncache, &addr, &mac, &solicit);
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, rc);
+	PCUT_ASSERT_FALSE(solicit);
+
+	rc = ncache_wait(ncache, &addr, 1000, &mac);
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, rc);
+
+	ncache_get_stats(ncache, &stats);
+	PCUT_ASSERT_INT_EQUALS(1, stats.failed);
+	PCUT_ASSERT_INT_EQUALS(1, stats.neg_hits);
+	PCUT_ASSERT_INT_EQUALS(1, stats.dropped);
+
+	/* Negative entry expired, try again */
+	test_now += ncache->failed_time;
+
+	rc = ncache_resolve(ncache, &addr, &mac, &solicit);
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, rc);
+	PCUT_ASSERT_TRUE(solicit);
+
+	ncache_destroy(ncache);
+}
+
+/** Entries become stale, are refreshed once and expire */
+PCUT_TEST(aging)
+{
+	ncache_t *ncache;
+	inet_addr_t addr;
+	eth_addr_t mac;
+	eth_addr_t rmac;
+	ncache_stats_t stats;
+	bool solicit;
+	errno_t rc;
+
+	ncache = test_ncache_create();
+	PCUT_ASSERT_NOT_NULL(ncache);
+
+	inet_addr(&addr, 10, 0, 0, 4);
+	eth_addr_decode((uint8_t *) "\x00\x11\x22\x33\x44\x77", &mac);
+
+	rc = ncache_update(ncache, &addr, &mac, NULL);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	test_now += ncache->reachable_time;
+	ncache_age(ncache);
+
+	/* Stale entry is used, but should be refreshed */
+	rc = ncache_resolve(ncache, &addr, &rmac, &solicit);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_TRUE(solicit);
+	PCUT_ASSERT_INT_EQUALS(0, eth_addr_compare(&mac, &rmac));
+
+	rc = ncache_resolve(ncache, &addr, &rmac, &solicit);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_FALSE(solicit);
+
+	/* No confirmation came */
+	test_now += ncache->stale_time;
+	ncache_age(ncache);
+
+	ncache_get_stats(ncache, &stats);
+	PCUT_ASSERT_INT_EQUALS(1, stats.expired);
+
+	rc = ncache_resolve(ncache, &addr, &rmac, &solicit);
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, rc);
+	PCUT_ASSERT_TRUE(solicit);
+
+	ncache_destroy(ncache);
+}
+
+/** Entries can be removed */
+PCUT_TEST(remove)
+{
+	ncache_t *ncache;
+	inet_addr_t addr;
+	eth_addr_t mac;
+	bool solicit;
+	errno_t rc;
+
+	ncache = test_ncache_create();
+	PCUT_ASSERT_NOT_NULL(ncache);
+
+	inet_addr(&addr, 10, 0, 0, 5);
+	eth_addr_decode((uint8_t *) "\x00\x11\x22\x33\x44\x88", &mac);
+
+	rc = ncache_remove(ncache, &addr);
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, rc);
+
+	rc = ncache_update(ncache, &addr, &mac, NULL);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = ncache_remove(ncache, &addr);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = ncache_resolve(ncache, &addr, &mac, &solicit);
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, rc);
+
+	ncache_destroy(ncache);
+}
+
+PCUT_EXPORT(ncache);
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <inet/endpoint.h>
+#include <inet/udp_ring.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdlib.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(udp_ring);
+
+/** Put and get messages in order */
+PCUT_TEST(put_get)
+{
+	udp_shm_t *shm;
+	udp_ring_msg_t *msg;
+	inet_ep_t ep;
+	char data[] = "hello";
+	bool ok;
+
+	shm = calloc(1, sizeof(udp_shm_t));
+	PCUT_ASSERT_NOT_NULL(shm);
+	udp_shm_init(shm);
+
+	PCUT_ASSERT_NULL(udp_ring_get(shm));
+
+	inet_ep_init(&ep);
+	ep.port = 42;
+
+	ok = udp_ring_put(shm, 1, &ep, data, sizeof(data));
+	PCUT_ASSERT_TRUE(ok);
+	ep.port = 43;
+	ok = udp_ring_put(shm, 2, &ep, data, 3);
+	PCUT_ASSERT_TRUE(ok);
+
+	msg = udp_ring_get(shm);
+	PCUT_ASSERT_NOT_NULL(msg);
+	PCUT_ASSERT_INT_EQUALS(1, msg->assoc_id);
+	PCUT_ASSERT_INT_EQUALS(42, msg->ep.port);
+	PCUT_ASSERT_INT_EQUALS(sizeof(data), msg->size);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(udp_ring_msg_data(msg), data,
+	    sizeof(data)));
+	udp_ring_consume(shm, msg);
+
+	msg = udp_ring_get(shm);
+	PCUT_ASSERT_NOT_NULL(msg);
+	PCUT_ASSERT_INT_EQUALS(2, msg->assoc_id);
+	PCUT_ASSERT_INT_EQUALS(43, msg->ep.port);
+	PCUT_ASSERT_INT_EQUALS(3, msg->size);
+	udp_ring_consume(shm, msg);
+
+	PCUT_ASSERT_NULL(udp_ring_get(shm));
+	free(shm);
+}
+
+/** Ring refuses messages when full and accepts them after consumption */
+PCUT_TEST(full)
+{
+	udp_shm_t *shm;
+	udp_ring_msg_t *msg;
+	inet_ep_t ep;
+	void *data;
+	size_t size;
+	size_t n;
+	size_t i;
+
+	shm = calloc(1, sizeof(udp_shm_t));
+	PCUT_ASSERT_NOT_NULL(shm);
+	udp_shm_init(shm);
+	inet_ep_init(&ep);
+
+	size = 1000;
+	data = calloc(1, size);
+	PCUT_ASSERT_NOT_NULL(data);
+
+	n = 0;
+	while (udp_ring_put(shm, n, &ep, data, size))
+		++n;
+
+	PCUT_ASSERT_INT_EQUALS(UDP_RING_RX_SIZE / udp_ring_msg_esize(size),
+	    n);
+
+	msg = udp_ring_get(shm);
+	PCUT_ASSERT_NOT_NULL(msg);
+	PCUT_ASSERT_INT_EQUALS(0, msg->assoc_id);
+	udp_ring_consume(shm, msg);
+
+	PCUT_ASSERT_TRUE(udp_ring_put(shm, n, &ep, data, size));
+
+	for (i = 1; i <= n; i++) {
+		msg = udp_ring_get(shm);
+		PCUT_ASSERT_NOT_NULL(msg);
+		PCUT_ASSERT_INT_EQUALS(i, msg->assoc_id);
+		udp_ring_consume(shm, msg);
+	}
+
+	PCUT_ASSERT_NULL(udp_ring_get(shm));
+	free(data);
+	free(shm);
+}
+
+/** Messages of varying size wrap around the end of the ring */
+PCUT_TEST(wrap)
+{
+	udp_shm_t *shm;
+	udp_ring_msg_t *msg;
+	inet_ep_t ep;
+	uint8_t *data;
+	size_t maxsize;
+	size_t size;
+	size_t i, j;
+
+	shm = calloc(1, sizeof(udp_shm_t));
+	PCUT_ASSERT_NOT_NULL(shm);
+	udp_shm_init(shm);
+	inet_ep_init(&ep);
+
+	maxsize = 9000;
+	data = malloc(maxsize);
+	PCUT_ASSERT_NOT_NULL(data);
+
+	/* Keep up to three messages in the ring, cycle it several times */
+	for (i = 0; i < 300; i++) {
+		size = (i * 7919) % maxsize;
+		for (j = 0; j < size; j++)
+			data[j] = (uint8_t) (i + j);
+
+		PCUT_ASSERT_TRUE(udp_ring_put(shm, i, &ep, data, size));
+
+		if (i < 2)
+			continue;
+
+		msg = udp_ring_get(shm);
+		PCUT_ASSERT_NOT_NULL(msg);
+		PCUT_ASSERT_INT_EQUALS(i - 2, msg->assoc_id);
+		PCUT_ASSERT_INT_EQUALS(((i - 2) * 7919) % maxsize, msg->size);
+		for (j = 0; j < msg->size; j++) {
+			PCUT_ASSERT_INT_EQUALS((uint8_t) (i - 2 + j),
+			    ((uint8_t *) udp_ring_msg_data(msg))[j]);
+		}
+
+		udp_ring_consume(shm, msg);
+	}
+
+	free(data);
+	free(shm);
+}
+
+PCUT_EXPORT(udp_ring);
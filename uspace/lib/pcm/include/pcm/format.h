@@ -38,8 +38,12 @@
 
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <pcm/sample_format.h>
 
+/** Maximum number of channels supported by the sampling rate converter */
+#define PCM_RESAMPLER_MAX_CHANNELS  8
+
 /** Linear PCM audio parameters */
 typedef struct {
 	unsigned channels;
@@ -47,6 +51,16 @@ typedef struct {
 	pcm_sample_format_t sample_format;
 } pcm_format_t;
 
+/** Sampling rate converter state */
+typedef struct {
+	/** Last consumed source frame, converted to the destination layout */
+	int32_t prev[PCM_RESAMPLER_MAX_CHANNELS];
+	/** Position after prev in units of 1/destination rate source frames */
+	unsigned frac;
+	/** True if prev is valid */
+	bool have_prev;
+} pcm_resampler_t;
+
 extern const pcm_format_t AUDIO_FORMAT_DEFAULT;
 extern const pcm_format_t AUDIO_FORMAT_ANY;
 
@@ -100,6 +114,10 @@ void pcm_format_silence(void *dst, size_t size, const pcm_format_t *f);
 errno_t pcm_format_convert_and_mix(void *dst, size_t dst_size, const void *src,
     size_t src_size, const pcm_format_t *sf, const pcm_format_t *df);
 errno_t pcm_format_mix(void *dst, const void *src, size_t size, const pcm_format_t *f);
+void pcm_resampler_init(pcm_resampler_t *rs);
+errno_t pcm_format_resample_and_mix(pcm_resampler_t *rs, void *dst,
+    size_t *dst_size, const void *src, size_t *src_size,
+    const pcm_format_t *sf, const pcm_format_t *df);
 errno_t pcm_format_convert(pcm_format_t a, void *srca, size_t sizea,
     pcm_format_t b, void *srcb, size_t *sizeb);
 
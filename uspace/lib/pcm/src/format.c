@@ -40,6 +40,8 @@
 #include <stdio.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <mem.h>
+#include <stdint.h>
 
 #include "format.h"
 
@@ -50,7 +52,6 @@
 #define host2float_le(x) (x)
 #define host2float_be(x) (x)
 
-#define from(x, type, endian) (float)(type ## _ ## endian ## 2host(x))
 #define to(x, type, endian) (float)(host2 ## type ## _ ## endian(x))
 
 /** Default linear PCM format */
@@ -69,9 +70,6 @@ const pcm_format_t AUDIO_FORMAT_ANY = {
 	.sample_format = 0,
 };
 
-static float get_normalized_sample(const void *buffer, size_t size,
-    unsigned frame, unsigned channel, const pcm_format_t *f);
-
 /**
  * Compare PCM format attribtues.
  * @param a Format description.
@@ -164,6 +162,300 @@ errno_t pcm_format_mix(void *dst, const void *src, size_t size, const pcm_format
 	return pcm_format_convert_and_mix(dst, size, src, size, f, f);
 }
 
+/** Number of intermediate samples processed in one batch. */
+#define PCM_MIX_BATCH  256
+
+/*
+ * The mixing kernels below work on fixed-point samples. Integer formats are
+ * mapped to signed 32-bit (Q31) values by flipping the sign bit of unsigned
+ * formats and shifting the sample to the top of the word. This avoids going
+ * through float for every sample and keeps the inner loops simple enough
+ * for the compiler to vectorize them.
+ */
+
+/** Convert raw integer sample of the given width to Q31 */
+#define q31_from_raw(raw, bits, flip) \
+	((int32_t) (((uint32_t) ((raw) ^ (flip))) << (32 - (bits))))
+
+/** Convert Q31 sample to raw integer sample of the given width */
+#define q31_to_raw(q, bits, flip) \
+	((((uint32_t) (q)) >> (32 - (bits))) ^ (flip))
+
+/** Expand X for every integer sample format stored in a whole word.
+ *
+ * X is invoked with the raw (unsigned) sample type, its endianness, number
+ * of significant bits and the value that flips the sample to two's
+ * complement. 24 bit samples in 32 bit words occupy the low bits of the
+ * word, the padding byte is ignored on input and cleared on output.
+ */
+#define PCM_INT_FORMATS(X) \
+	case PCM_SAMPLE_UINT8: \
+		X(uint8_t, le, 8, UINT8_C(0x80)); \
+		break; \
+	case PCM_SAMPLE_SINT8: \
+		X(uint8_t, le, 8, 0); \
+		break; \
+	case PCM_SAMPLE_UINT16_LE: \
+		X(uint16_t, le, 16, UINT16_C(0x8000)); \
+		break; \
+	case PCM_SAMPLE_SINT16_LE: \
+		X(uint16_t, le, 16, 0); \
+		break; \
+	case PCM_SAMPLE_UINT16_BE: \
+		X(uint16_t, be, 16, UINT16_C(0x8000)); \
+		break; \
+	case PCM_SAMPLE_SINT16_BE: \
+		X(uint16_t, be, 16, 0); \
+		break; \
+	case PCM_SAMPLE_UINT24_32_LE: \
+		X(uint32_t, le, 24, UINT32_C(0x800000)); \
+		break; \
+	case PCM_SAMPLE_SINT24_32_LE: \
+		X(uint32_t, le, 24, 0); \
+		break; \
+	case PCM_SAMPLE_UINT24_32_BE: \
+		X(uint32_t, be, 24, UINT32_C(0x800000)); \
+		break; \
+	case PCM_SAMPLE_SINT24_32_BE: \
+		X(uint32_t, be, 24, 0); \
+		break; \
+	case PCM_SAMPLE_UINT32_LE: \
+		X(uint32_t, le, 32, UINT32_C(0x80000000)); \
+		break; \
+	case PCM_SAMPLE_SINT32_LE: \
+		X(uint32_t, le, 32, 0); \
+		break; \
+	case PCM_SAMPLE_UINT32_BE: \
+		X(uint32_t, be, 32, UINT32_C(0x80000000)); \
+		break; \
+	case PCM_SAMPLE_SINT32_BE: \
+		X(uint32_t, be, 32, 0); \
+		break;
+
+/** Expand X for every packed 24 bit sample format.
+ *
+ * X is invoked with a flag telling whether the samples are big endian and
+ * the value that flips the sample to two's complement.
+ */
+#define PCM_PACKED24_FORMATS(X) \
+	case PCM_SAMPLE_UINT24_LE: \
+		X(false, UINT32_C(0x800000)); \
+		break; \
+	case PCM_SAMPLE_SINT24_LE: \
+		X(false, 0); \
+		break; \
+	case PCM_SAMPLE_UINT24_BE: \
+		X(true, UINT32_C(0x800000)); \
+		break; \
+	case PCM_SAMPLE_SINT24_BE: \
+		X(true, 0); \
+		break;
+
+/** Load packed 24 bit sample. */
+static inline uint32_t load24(const uint8_t *p, bool be)
+{
+	if (be)
+		return ((uint32_t) p[0] << 16) | ((uint32_t) p[1] << 8) | p[2];
+	return ((uint32_t) p[2] << 16) | ((uint32_t) p[1] << 8) | p[0];
+}
+
+/** Store packed 24 bit sample. */
+static inline void store24(uint8_t *p, uint32_t v, bool be)
+{
+	p[be ? 0 : 2] = (v >> 16) & 0xff;
+	p[1] = (v >> 8) & 0xff;
+	p[be ? 2 : 0] = v & 0xff;
+}
+
+/**
+ * Mix samples of identical format with saturation.
+ * @param dst Destination samples.
+ * @param src Source samples.
+ * @param count Number of samples.
+ * @param format Sample format of both buffers.
+ * @return Error code, ENOTSUP if there is no kernel for the format.
+ *
+ * Packed 24 bit samples are left to the fixed-point conversion path.
+ */
+static errno_t mix_same(void *dst, const void *src, size_t count,
+    pcm_sample_format_t format)
+{
+#define MIX_SAME(type, endian, bits, flip) \
+do { \
+	type *d = dst; \
+	const type *s = src; \
+	for (size_t i = 0; i < count; ++i) { \
+		int64_t c = \
+		    (int64_t) q31_from_raw(type ## _ ## endian ## 2host(d[i]), bits, flip) + \
+		    (int64_t) q31_from_raw(type ## _ ## endian ## 2host(s[i]), bits, flip); \
+		if (c < INT32_MIN) \
+			c = INT32_MIN; \
+		if (c > INT32_MAX) \
+			c = INT32_MAX; \
+		d[i] = host2 ## type ## _ ## endian( \
+		    (type) q31_to_raw(c, bits, flip)); \
+	} \
+} while (0)
+
+	/* Sixteen bit signed native samples are by far the most common. */
+	if (format == PCM_SAMPLE_SINT16_LE) {
+		int16_t *d = dst;
+		const int16_t *s = src;
+		for (size_t i = 0; i < count; ++i) {
+			int32_t c = (int16_t) uint16_t_le2host(d[i]) +
+			    (int16_t) uint16_t_le2host(s[i]);
+			if (c < INT16_MIN)
+				c = INT16_MIN;
+			if (c > INT16_MAX)
+				c = INT16_MAX;
+			d[i] = host2uint16_t_le((uint16_t) c);
+		}
+		return EOK;
+	}
+
+	switch (format) {
+		PCM_INT_FORMATS(MIX_SAME)
+	default:
+		return ENOTSUP;
+	}
+	return EOK;
+#undef MIX_SAME
+}
+
+/**
+ * Convert frames to Q31 samples.
+ * @param src Source frames.
+ * @param frames Number of frames to convert.
+ * @param sf Source format.
+ * @param channels Number of channels of the converted frames.
+ * @param out Converted samples, @p frames * @p channels entries.
+ *
+ * Channels missing in the source and unsupported source formats produce
+ * silence, extra source channels are dropped.
+ */
+static void decode_q31(const void *src, size_t frames, const pcm_format_t *sf,
+    unsigned channels, int32_t *out)
+{
+	const unsigned sch = sf->channels;
+
+#define DECODE(type, endian, bits, flip) \
+do { \
+	const type *s = src; \
+	if (sch == channels) { \
+		for (size_t i = 0; i < frames * channels; ++i) \
+			out[i] = q31_from_raw( \
+			    type ## _ ## endian ## 2host(s[i]), bits, flip); \
+		break; \
+	} \
+	for (size_t i = 0; i < frames; ++i) { \
+		for (unsigned j = 0; j < channels; ++j) { \
+			out[i * channels + j] = (j < sch) ? q31_from_raw( \
+			    type ## _ ## endian ## 2host(s[i * sch + j]), \
+			    bits, flip) : 0; \
+		} \
+	} \
+} while (0)
+
+#define DECODE24(be, flip) \
+do { \
+	const uint8_t *s = src; \
+	for (size_t i = 0; i < frames; ++i) { \
+		for (unsigned j = 0; j < channels; ++j) { \
+			out[i * channels + j] = (j < sch) ? q31_from_raw( \
+			    load24(&s[(i * sch + j) * 3], be), 24, flip) : 0; \
+		} \
+	} \
+} while (0)
+
+	switch (sf->sample_format) {
+		PCM_INT_FORMATS(DECODE)
+		PCM_PACKED24_FORMATS(DECODE24)
+	case PCM_SAMPLE_FLOAT32:
+		for (size_t i = 0; i < frames; ++i) {
+			for (unsigned j = 0; j < channels; ++j) {
+				float f = (j < sch) ?
+				    ((const float *) src)[i * sch + j] : 0.0f;
+				int32_t q;
+				if (f >= 1.0f)
+					q = INT32_MAX;
+				else if (f <= -1.0f)
+					q = INT32_MIN;
+				else
+					q = (int32_t) (f * 2147483648.0f);
+				out[i * channels + j] = q;
+			}
+		}
+		break;
+	default:
+		memset(out, 0, frames * channels * sizeof(int32_t));
+		break;
+	}
+#undef DECODE24
+#undef DECODE
+}
+
+/**
+ * Add Q31 samples to a buffer with saturation.
+ * @param dst Destination samples.
+ * @param in Q31 samples to add.
+ * @param count Number of samples.
+ * @param format Sample format of the destination.
+ * @return Error code, ENOTSUP if the destination format is not supported.
+ */
+static errno_t mix_q31(void *dst, const int32_t *in, size_t count,
+    pcm_sample_format_t format)
+{
+#define MIX_Q31(type, endian, bits, flip) \
+do { \
+	type *d = dst; \
+	for (size_t i = 0; i < count; ++i) { \
+		int64_t c = (int64_t) q31_from_raw( \
+		    type ## _ ## endian ## 2host(d[i]), bits, flip) + in[i]; \
+		if (c < INT32_MIN) \
+			c = INT32_MIN; \
+		if (c > INT32_MAX) \
+			c = INT32_MAX; \
+		d[i] = host2 ## type ## _ ## endian( \
+		    (type) q31_to_raw(c, bits, flip)); \
+	} \
+} while (0)
+
+#define MIX_Q31_24(be, flip) \
+do { \
+	uint8_t *d = dst; \
+	for (size_t i = 0; i < count; ++i) { \
+		int64_t c = (int64_t) q31_from_raw( \
+		    load24(&d[i * 3], be), 24, flip) + in[i]; \
+		if (c < INT32_MIN) \
+			c = INT32_MIN; \
+		if (c > INT32_MAX) \
+			c = INT32_MAX; \
+		store24(&d[i * 3], q31_to_raw(c, 24, flip), be); \
+	} \
+} while (0)
+
+	switch (format) {
+		PCM_INT_FORMATS(MIX_Q31)
+		PCM_PACKED24_FORMATS(MIX_Q31_24)
+	case PCM_SAMPLE_FLOAT32:
+		for (size_t i = 0; i < count; ++i) {
+			float *d = dst;
+			float c = d[i] + (float) in[i] / 2147483648.0f;
+			if (c < -1.0f)
+				c = -1.0f;
+			if (c > 1.0f)
+				c = 1.0f;
+			d[i] = c;
+		}
+		break;
+	default:
+		return ENOTSUP;
+	}
+	return EOK;
+#undef MIX_Q31_24
+#undef MIX_Q31
+}
+
 /**
  * Add and mix audio data.
  * @param dst Destination audio buffer
@@ -176,6 +468,7 @@ errno_t pcm_format_mix(void *dst, const void *src, size_t size, const pcm_format
  *
  * Buffers must contain entire frames. Destination buffer is always filled.
  * If there are not enough data in the source buffer silent data is assumed.
+ * Sampling rates are not converted, see pcm_format_resample_and_mix().
  */
 errno_t pcm_format_convert_and_mix(void *dst, size_t dst_size, const void *src,
     size_t src_size, const pcm_format_t *sf, const pcm_format_t *df)
@@ -190,148 +483,150 @@ errno_t pcm_format_convert_and_mix(void *dst, size_t dst_size, const void *src,
 	if ((dst_size % dst_frame_size) != 0)
 		return EINVAL;
 
-	/*
-	 * This is so ugly it eats kittens, and puppies, and ducklings,
-	 * and all little fluffy things...
-	 */
-#define LOOP_ADD(type, endian, low, high) \
-do { \
-	const unsigned frame_count = dst_size / dst_frame_size; \
-	for (size_t i = 0; i < frame_count; ++i) { \
-		for (unsigned j = 0; j < df->channels; ++j) { \
-			const float a = \
-			    get_normalized_sample(dst, dst_size, i, j, df);\
-			const float b = \
-			    get_normalized_sample(src, src_size, i, j, sf);\
-			float c = (a + b); \
-			if (c < -1.0) c = -1.0; \
-			if (c > 1.0) c = 1.0; \
-			c += 1.0; \
-			c *= ((float)(type)high - (float)(type)low) / 2; \
-			c += (float)(type)low; \
-			type *dst_buf = dst; \
-			const unsigned pos = i * df->channels  + j; \
-			if (pos < (dst_size / sizeof(type))) \
-				dst_buf[pos] = to((type)c, type, endian); \
-		} \
-	} \
-} while (0)
+	const size_t frames = min(dst_size / dst_frame_size,
+	    src_size / src_frame_size);
 
-	switch (df->sample_format) {
-	case PCM_SAMPLE_UINT8:
-		LOOP_ADD(uint8_t, le, UINT8_MIN, UINT8_MAX);
-		break;
-	case PCM_SAMPLE_SINT8:
-		LOOP_ADD(uint8_t, le, INT8_MIN, INT8_MAX);
-		break;
-	case PCM_SAMPLE_UINT16_LE:
-		LOOP_ADD(uint16_t, le, UINT16_MIN, UINT16_MAX);
-		break;
-	case PCM_SAMPLE_SINT16_LE:
-		LOOP_ADD(int16_t, le, INT16_MIN, INT16_MAX);
-		break;
-	case PCM_SAMPLE_UINT16_BE:
-		LOOP_ADD(uint16_t, be, UINT16_MIN, UINT16_MAX);
-		break;
-	case PCM_SAMPLE_SINT16_BE:
-		LOOP_ADD(int16_t, be, INT16_MIN, INT16_MAX);
-		break;
-	case PCM_SAMPLE_UINT24_32_LE:
-	case PCM_SAMPLE_UINT32_LE: // TODO this are not right for 24bit
-		LOOP_ADD(uint32_t, le, UINT32_MIN, UINT32_MAX);
-		break;
-	case PCM_SAMPLE_SINT24_32_LE:
-	case PCM_SAMPLE_SINT32_LE:
-		LOOP_ADD(int32_t, le, INT32_MIN, INT32_MAX);
-		break;
-	case PCM_SAMPLE_UINT24_32_BE:
-	case PCM_SAMPLE_UINT32_BE:
-		LOOP_ADD(uint32_t, be, UINT32_MIN, UINT32_MAX);
-		break;
-	case PCM_SAMPLE_SINT24_32_BE:
-	case PCM_SAMPLE_SINT32_BE:
-		LOOP_ADD(int32_t, be, INT32_MIN, INT32_MAX);
-		break;
-	case PCM_SAMPLE_UINT24_LE:
-	case PCM_SAMPLE_SINT24_LE:
-	case PCM_SAMPLE_UINT24_BE:
-	case PCM_SAMPLE_SINT24_BE:
-	case PCM_SAMPLE_FLOAT32:
-	default:
+	/* Mix directly if no conversion is needed. */
+	if (sf->sample_format == df->sample_format &&
+	    sf->channels == df->channels) {
+		const errno_t ret = mix_same(dst, src, frames * df->channels,
+		    df->sample_format);
+		if (ret != ENOTSUP)
+			return ret;
+	}
+
+	const unsigned channels = df->channels;
+	if (channels == 0 || channels > PCM_MIX_BATCH)
 		return ENOTSUP;
+
+	/* Convert through a batch of fixed-point samples otherwise. */
+	int32_t batch[PCM_MIX_BATCH];
+	const size_t batch_frames = PCM_MIX_BATCH / channels;
+	for (size_t i = 0; i < frames; i += batch_frames) {
+		const size_t count = min(batch_frames, frames - i);
+		decode_q31(src + i * src_frame_size, count, sf, channels,
+		    batch);
+		const errno_t ret = mix_q31(dst + i * dst_frame_size, batch,
+		    count * channels, df->sample_format);
+		if (ret != EOK)
+			return ret;
 	}
 	return EOK;
-#undef LOOP_ADD
 }
 
 /**
- * Converts all sample formats to float <-1,1>
- * @param buffer Audio data
- * @param size Size of the buffer
- * @param frame Index of the frame to read
- * @param channel Channel within the frame
- * @param f Pointer to a format descriptor
- * @return Normalized sample <-1,1>, 0.0 if the data could not be read
+ * Initialize sampling rate converter.
+ * @param rs The converter.
  */
-static float get_normalized_sample(const void *buffer, size_t size,
-    unsigned frame, unsigned channel, const pcm_format_t *f)
+void pcm_resampler_init(pcm_resampler_t *rs)
 {
-	assert(f);
-	assert(buffer);
-	if (channel >= f->channels)
-		return 0.0f;
-#define GET(type, endian, low, high) \
-do { \
-	const type *src = buffer; \
-	const size_t sample_count = size / sizeof(type); \
-	const size_t sample_pos = frame * f->channels + channel; \
-	if (sample_pos >= sample_count) {\
-		return 0.0f; \
-	} \
-	float sample = from(src[sample_pos], type, endian); \
-	/* This makes it positive */ \
-	sample -= (float)(type)low; \
-	/* This makes it <0,2> */ \
-	sample /= (((float)(type)high - (float)(type)low) / 2.0f); \
-	return sample - 1.0f; \
-} while (0)
+	assert(rs);
+	rs->have_prev = false;
+	rs->frac = 0;
+}
 
-	switch (f->sample_format) {
-	case PCM_SAMPLE_UINT8:
-		GET(uint8_t, le, UINT8_MIN, UINT8_MAX);
-	case PCM_SAMPLE_SINT8:
-		GET(int8_t, le, INT8_MIN, INT8_MAX);
-	case PCM_SAMPLE_UINT16_LE:
-		GET(uint16_t, le, UINT16_MIN, UINT16_MAX);
-	case PCM_SAMPLE_SINT16_LE:
-		GET(int16_t, le, INT16_MIN, INT16_MAX);
-	case PCM_SAMPLE_UINT16_BE:
-		GET(uint16_t, be, UINT16_MIN, UINT16_MAX);
-	case PCM_SAMPLE_SINT16_BE:
-		GET(int16_t, be, INT16_MIN, INT16_MAX);
-	case PCM_SAMPLE_UINT24_32_LE:
-	case PCM_SAMPLE_UINT32_LE:
-		GET(uint32_t, le, UINT32_MIN, UINT32_MAX);
-	case PCM_SAMPLE_SINT24_32_LE:
-	case PCM_SAMPLE_SINT32_LE:
-		GET(int32_t, le, INT32_MIN, INT32_MAX);
-	case PCM_SAMPLE_UINT24_32_BE:
-	case PCM_SAMPLE_UINT32_BE:
-		GET(uint32_t, be, UINT32_MIN, UINT32_MAX);
-	case PCM_SAMPLE_SINT24_32_BE:
-	case PCM_SAMPLE_SINT32_BE:
-		GET(int32_t, le, INT32_MIN, INT32_MAX);
-	case PCM_SAMPLE_UINT24_LE:
-	case PCM_SAMPLE_SINT24_LE:
-	case PCM_SAMPLE_UINT24_BE:
-	case PCM_SAMPLE_SINT24_BE:
-	case PCM_SAMPLE_FLOAT32:
-	default:
-		break;
+/**
+ * Resample, convert and mix audio data.
+ * @param rs Sampling rate converter state.
+ * @param dst Destination audio buffer.
+ * @param dst_size Size of the destination buffer, updated to the number
+ *                 of bytes produced.
+ * @param src Source audio buffer.
+ * @param src_size Size of the source buffer, updated to the number of
+ *                 bytes consumed.
+ * @param sf Pointer to the source format descriptor.
+ * @param df Pointer to the destination format descriptor.
+ * @return Error code.
+ *
+ * Frames are interpolated linearly. The converter keeps the last consumed
+ * source frame and the position between frames in @p rs, so a stream can
+ * be processed in arbitrarily sized pieces. Either the destination buffer
+ * is filled or the source buffer is consumed entirely.
+ */
+errno_t pcm_format_resample_and_mix(pcm_resampler_t *rs, void *dst,
+    size_t *dst_size, const void *src, size_t *src_size,
+    const pcm_format_t *sf, const pcm_format_t *df)
+{
+	if (!rs || !dst || !dst_size || !src || !src_size || !sf || !df)
+		return EINVAL;
+	const size_t src_frame_size = pcm_format_frame_size(sf);
+	if ((*src_size % src_frame_size) != 0)
+		return EINVAL;
+
+	const size_t dst_frame_size = pcm_format_frame_size(df);
+	if ((*dst_size % dst_frame_size) != 0)
+		return EINVAL;
+
+	const unsigned channels = df->channels;
+	if (channels == 0 || channels > PCM_RESAMPLER_MAX_CHANNELS)
+		return ENOTSUP;
+	if (sf->sampling_rate == 0 || df->sampling_rate == 0)
+		return EINVAL;
+
+	const size_t src_frames = *src_size / src_frame_size;
+	const size_t dst_frames = *dst_size / dst_frame_size;
+
+	/* No conversion needed, mix as much as possible. */
+	if (sf->sampling_rate == df->sampling_rate && !rs->have_prev) {
+		const size_t frames = min(src_frames, dst_frames);
+		*src_size = frames * src_frame_size;
+		*dst_size = frames * dst_frame_size;
+		return pcm_format_convert_and_mix(dst, *dst_size, src,
+		    *src_size, sf, df);
+	}
+
+	int32_t batch[PCM_MIX_BATCH];
+	const size_t batch_frames = PCM_MIX_BATCH / channels;
+	int32_t next[PCM_RESAMPLER_MAX_CHANNELS];
+	size_t i = 0;
+	size_t o = 0;
+	size_t pending = 0;
+	errno_t ret = EOK;
+
+	while (true) {
+		/* Advance to the source frames around the output position. */
+		while (!rs->have_prev || rs->frac >= df->sampling_rate) {
+			if (i >= src_frames)
+				goto done;
+			if (rs->have_prev)
+				rs->frac -= df->sampling_rate;
+			decode_q31(src + i * src_frame_size, 1, sf, channels,
+			    rs->prev);
+			rs->have_prev = true;
+			++i;
+		}
+		if (o + pending >= dst_frames || i >= src_frames)
+			break;
+
+		decode_q31(src + i * src_frame_size, 1, sf, channels, next);
+		int32_t *out = &batch[pending * channels];
+		for (unsigned j = 0; j < channels; ++j) {
+			const int64_t delta = (int64_t) next[j] - rs->prev[j];
+			out[j] = rs->prev[j] +
+			    delta * rs->frac / df->sampling_rate;
+		}
+		rs->frac += sf->sampling_rate;
+
+		if (++pending == batch_frames) {
+			ret = mix_q31(dst + o * dst_frame_size, batch,
+			    pending * channels, df->sample_format);
+			if (ret != EOK)
+				goto done;
+			o += pending;
+			pending = 0;
+		}
 	}
-	return 0;
-#undef GET
+done:
+	if (pending > 0 && ret == EOK) {
+		ret = mix_q31(dst + o * dst_frame_size, batch,
+		    pending * channels, df->sample_format);
+		o += pending;
+	}
+	*src_size = i * src_frame_size;
+	*dst_size = o * dst_frame_size;
+	return ret;
 }
+
 /**
  * @}
  */
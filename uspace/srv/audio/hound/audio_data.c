@@ -35,6 +35,7 @@
 
 #include <macros.h>
 #include <stdlib.h>
+#include <str_error.h>
 
 #include "audio_data.h"
 #include "log.h"
@@ -186,6 +187,8 @@ void audio_pipe_init(audio_pipe_t *pipe)
 	fibril_mutex_initialize(&pipe->guard);
 	pipe->frames = 0;
 	pipe->bytes = 0;
+	pcm_resampler_init(&pipe->resampler);
+	pipe->no_resample = false;
 }
 
 /**
@@ -271,28 +274,51 @@ size_t audio_pipe_mix_data(audio_pipe_t *pipe, void *data,
 		audio_data_link_t *alink = audio_data_link_list_instance(l);
 
 		/* Get audio chunk metadata */
-		const size_t src_frame_size =
-		    pcm_format_frame_size(&alink->adata->format);
-		const size_t available_frames =
-		    audio_data_link_available_frames(alink);
-		const size_t copy_frames = min(available_frames, needed_frames);
-		const size_t dst_copy_size = copy_frames * dst_frame_size;
-		const size_t src_copy_size = copy_frames * src_frame_size;
+		const pcm_format_t *sf = &alink->adata->format;
+		const size_t src_frame_size = pcm_format_frame_size(sf);
+		size_t dst_copy_size = needed_frames * dst_frame_size;
+		size_t src_copy_size = audio_data_link_remain_size(alink);
 
-		assert(src_copy_size <= audio_data_link_remain_size(alink));
+		/* Copy audio data, resampling if necessary */
+		errno_t ret = ENOTSUP;
+		if (!pipe->no_resample) {
+			ret = pcm_format_resample_and_mix(&pipe->resampler,
+			    data, &dst_copy_size, audio_data_link_start(alink),
+			    &src_copy_size, sf, f);
+			if (ret == ENOTSUP) {
+				log_warning("Can not resample %u channel %s "
+				    "audio, mixing without rate conversion.",
+				    sf->channels,
+				    pcm_sample_format_str(sf->sample_format));
+				pipe->no_resample = true;
+			}
+		}
+		if (ret == ENOTSUP) {
+			/* Mix frame by frame regardless of sampling rate */
+			const size_t copy_frames = min(needed_frames,
+			    audio_data_link_available_frames(alink));
+			dst_copy_size = copy_frames * dst_frame_size;
+			src_copy_size = copy_frames * src_frame_size;
+			ret = pcm_format_convert_and_mix(data, dst_copy_size,
+			    audio_data_link_start(alink), src_copy_size, sf, f);
+		}
+		if (ret != EOK) {
+			/* Drop data that can not be mixed */
+			log_error("Failed to mix audio data: %s.",
+			    str_error(ret));
+			dst_copy_size = 0;
+			src_copy_size = audio_data_link_remain_size(alink);
+		}
 
-		/* Copy audio data */
-		pcm_format_convert_and_mix(data, dst_copy_size,
-		    audio_data_link_start(alink), src_copy_size,
-		    &alink->adata->format, f);
+		assert(src_copy_size <= audio_data_link_remain_size(alink));
 
 		/* Update values */
-		needed_frames -= copy_frames;
+		needed_frames -= dst_copy_size / dst_frame_size;
 		copied_size += dst_copy_size;
 		data += dst_copy_size;
 		alink->position += src_copy_size;
 		pipe->bytes -= src_copy_size;
-		pipe->frames -= copy_frames;
+		pipe->frames -= src_copy_size / src_frame_size;
 		if (audio_data_link_remain_size(alink) == 0) {
 			list_remove(&alink->link);
 			audio_data_link_destroy(alink);
@@ -64,6 +64,10 @@ typedef struct {
 	size_t frames;
 	/** List access synchronization */
 	fibril_mutex_t guard;
+	/** Sampling rate conversion state */
+	pcm_resampler_t resampler;
+	/** Resampling is not supported, mix without rate conversion */
+	bool no_resample;
 } audio_pipe_t;
 
 audio_data_t *audio_data_create(void *data, size_t size,
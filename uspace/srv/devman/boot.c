@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup devman
+ * @{
+ */
+
+/** @file Start-up statistics.
+ *
+ * Timestamps of the device manager start-up phases together with
+ * counters of the driver attachment work, so that the time it takes
+ * until all devices are ready can be measured.
+ */
+
+#include <assert.h>
+#include <fibril_synch.h>
+#include <inttypes.h>
+#include <io/log.h>
+#include <mem.h>
+#include <time.h>
+
+#include "boot.h"
+
+static FIBRIL_MUTEX_INITIALIZE(boot_stats_mutex);
+static devman_boot_stats_t boot_stats;
+static struct timespec boot_start;
+/** Number of device-add requests in progress */
+static uint32_t boot_adds_active;
+
+/** Microseconds elapsed since the device manager started. */
+static uint64_t boot_elapsed_usec(void)
+{
+	struct timespec now;
+
+	getuptime(&now);
+	return NSEC2USEC(ts_sub_diff(&now, &boot_start));
+}
+
+/** Initialize start-up statistics.
+ *
+ * Should be called as early as possible, the time of the call is
+ * considered the start of the device manager.
+ */
+void boot_stats_init(void)
+{
+	getuptime(&boot_start);
+
+	fibril_mutex_lock(&boot_stats_mutex);
+	memset(&boot_stats, 0, sizeof(boot_stats));
+	boot_stats.start_usec = SEC2USEC(boot_start.tv_sec) +
+	    NSEC2USEC(boot_start.tv_nsec);
+	boot_adds_active = 0;
+	fibril_mutex_unlock(&boot_stats_mutex);
+}
+
+/** Record that a start-up phase has been reached.
+ *
+ * @param phase Start-up phase
+ */
+void boot_phase(devman_boot_phase_t phase)
+{
+	assert(phase < DEVMAN_BOOT_PHASES);
+
+	uint64_t usec = boot_elapsed_usec();
+
+	fibril_mutex_lock(&boot_stats_mutex);
+	boot_stats.phase_usec[phase] = usec;
+	fibril_mutex_unlock(&boot_stats_mutex);
+
+	log_msg(LOG_DEFAULT, LVL_NOTE, "Start-up phase %d reached after "
+	    "%" PRIu64 " us.", phase, usec);
+}
+
+/** Record that a driver task has been spawned. */
+void boot_driver_started(void)
+{
+	fibril_mutex_lock(&boot_stats_mutex);
+	boot_stats.drivers_started++;
+	fibril_mutex_unlock(&boot_stats_mutex);
+}
+
+/** Record that a device is being passed to its driver. */
+void boot_dev_add_begin(void)
+{
+	fibril_mutex_lock(&boot_stats_mutex);
+	boot_stats.devices_added++;
+	boot_adds_active++;
+	if (boot_adds_active > boot_stats.max_parallel_adds)
+		boot_stats.max_parallel_adds = boot_adds_active;
+	fibril_mutex_unlock(&boot_stats_mutex);
+}
+
+/** Record that a driver has answered a device-add request.
+ *
+ * @param usable @c true if the device is usable now
+ */
+void boot_dev_add_end(bool usable)
+{
+	uint64_t usec = boot_elapsed_usec();
+
+	fibril_mutex_lock(&boot_stats_mutex);
+	assert(boot_adds_active > 0);
+	boot_adds_active--;
+	if (usable)
+		boot_stats.last_dev_usec = usec;
+	fibril_mutex_unlock(&boot_stats_mutex);
+}
+
+/** Get a snapshot of the start-up statistics.
+ *
+ * @param stats Place to store the statistics
+ */
+void boot_stats_get(devman_boot_stats_t *stats)
+{
+	fibril_mutex_lock(&boot_stats_mutex);
+	*stats = boot_stats;
+	fibril_mutex_unlock(&boot_stats_mutex);
+}
+
+/** @}
+ */
@@ -49,6 +49,7 @@
 #include <ctype.h>
 #include <ipc/devman.h>
 
+#include "boot.h"
 #include "client_conn.h"
 #include "dev.h"
 #include "devman.h"
@@ -778,6 +779,30 @@ static void devman_driver_unload(ipc_call_t *icall)
 	async_answer_0(icall, rc);
 }
 
+/** Get device manager start-up statistics. */
+static void devman_get_boot_stats(ipc_call_t *icall)
+{
+	devman_boot_stats_t stats;
+	ipc_call_t data;
+	size_t data_len;
+
+	if (!async_data_read_receive(&data, &data_len)) {
+		async_answer_0(icall, EINVAL);
+		return;
+	}
+
+	if (data_len != sizeof(stats)) {
+		async_answer_0(&data, EINVAL);
+		async_answer_0(icall, EINVAL);
+		return;
+	}
+
+	boot_stats_get(&stats);
+
+	errno_t rc = async_data_read_finalize(&data, &stats, sizeof(stats));
+	async_answer_0(icall, rc);
+}
+
 /** Function for handling connections from a client to the device manager. */
 void devman_connection_client(ipc_call_t *icall, void *arg)
 {
@@ -854,6 +879,9 @@ void devman_connection_client(ipc_call_t *icall, void *arg)
 		case DEVMAN_DRIVER_UNLOAD:
 			devman_driver_unload(&call);
 			break;
+		case DEVMAN_GET_BOOT_STATS:
+			devman_get_boot_stats(&call);
+			break;
 		default:
 			async_answer_0(&call, ENOENT);
 		}
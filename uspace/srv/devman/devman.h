@@ -89,6 +89,10 @@ typedef struct driver {
 	 * Fibril mutex for this driver - driver state, list of devices, session.
 	 */
 	fibril_mutex_t driver_mutex;
+	/** Number of devices being passed to the starting driver */
+	size_t pending_adds;
+	/** Signalled when pending_adds decreases */
+	fibril_condvar_t pending_cv;
 } driver_t;
 
 /** The list of drivers. */
@@ -40,6 +40,7 @@
 #include <stdio.h>
 #include <task.h>
 
+#include "boot.h"
 #include "dev.h"
 #include "devman.h"
 #include "driver.h"
@@ -47,6 +48,13 @@
 #include "match.h"
 #include "main.h"
 
+/** Device passed to a driver in a separate fibril */
+typedef struct {
+	driver_t *driver;
+	dev_node_t *dev;
+	dev_tree_t *tree;
+} dev_pass_t;
+
 static errno_t driver_reassign_fibril(void *);
 
 /**
@@ -340,6 +348,7 @@ bool start_driver(driver_t *drv)
 	}
 
 	drv->state = DRIVER_STARTING;
+	boot_driver_started();
 	return true;
 }
 
@@ -419,7 +428,63 @@ driver_t *driver_find_by_name(driver_list_t *drv_list, const char *drv_name)
 	return res;
 }
 
+/** Pass one device to a driver.
+ *
+ * If the driver rejects the device, another driver is looked for in
+ * a separate fibril.
+ *
+ * @param driver	The driver to which the device is passed.
+ * @param dev		The device, the caller's reference is consumed.
+ * @param tree		Device tree
+ */
+static void pass_device(driver_t *driver, dev_node_t *dev, dev_tree_t *tree)
+{
+	add_device(driver, dev, tree);
+
+	/* Device probe failed, need to try next best driver */
+	if (dev->state == DEVICE_NOT_PRESENT) {
+		fibril_mutex_lock(&driver->driver_mutex);
+		list_remove(&dev->driver_devices);
+		fibril_mutex_unlock(&driver->driver_mutex);
+		/* Give an extra reference to driver_reassign_fibril */
+		dev_add_ref(dev);
+		fid_t fid = fibril_create(driver_reassign_fibril, dev);
+		if (fid == 0) {
+			log_msg(LOG_DEFAULT, LVL_ERROR,
+			    "Error creating fibril to assign driver.");
+			dev_del_ref(dev);
+		}
+		fibril_add_ready(fid);
+	}
+
+	dev_del_ref(dev);
+
+	fibril_mutex_lock(&driver->driver_mutex);
+	assert(driver->pending_adds > 0);
+	driver->pending_adds--;
+	fibril_mutex_unlock(&driver->driver_mutex);
+	fibril_condvar_broadcast(&driver->pending_cv);
+}
+
+/** Pass one device to a driver in a separate fibril.
+ *
+ * @param arg Device to pass (dev_pass_t)
+ */
+static errno_t pass_device_fibril(void *arg)
+{
+	dev_pass_t *pass = (dev_pass_t *) arg;
+
+	pass_device(pass->driver, pass->dev, pass->tree);
+	free(pass);
+	return EOK;
+}
+
 /** Notify driver about the devices to which it was assigned.
+ *
+ * The devices are independent of each other (their parents are already
+ * attached), so each is passed to the driver in its own fibril and the
+ * driver can initialize them concurrently. The driver only enters the
+ * running state once all of them have been answered.
  *
  * @param driver	The driver to which the devices are passed.
  */
@@ -433,6 +498,7 @@ static void pass_devices_to_driver(driver_t *driver, dev_tree_t *tree)
 
 	fibril_mutex_lock(&driver->driver_mutex);
 
+restart:
 	/*
 	 * Go through devices list as long as there is some device
 	 * that has not been passed to the driver.
@@ -448,39 +514,35 @@ static void pass_devices_to_driver(driver_t *driver, dev_tree_t *tree)
 			continue;
 		}
 
+		/* Make sure the device is not picked up again */
+		dev->passed_to_driver = true;
 		dev_add_ref(dev);
+		driver->pending_adds++;
 
-		/*
-		 * Unlock to avoid deadlock when adding device
-		 * handled by itself.
-		 */
-		fibril_mutex_unlock(&driver->driver_mutex);
 		fibril_rwlock_write_unlock(&tree->rwlock);
 
-		add_device(driver, dev, tree);
-
-		/* Device probe failed, need to try next best driver */
-		if (dev->state == DEVICE_NOT_PRESENT) {
-			fibril_mutex_lock(&driver->driver_mutex);
-			list_remove(&dev->driver_devices);
-			fibril_mutex_unlock(&driver->driver_mutex);
-			/* Give an extra reference to driver_reassign_fibril */
-			dev_add_ref(dev);
-			fid_t fid = fibril_create(driver_reassign_fibril, dev);
-			if (fid == 0) {
-				log_msg(LOG_DEFAULT, LVL_ERROR,
-				    "Error creating fibril to assign driver.");
-				dev_del_ref(dev);
-			}
-			fibril_add_ready(fid);
+		dev_pass_t *pass = malloc(sizeof(dev_pass_t));
+		fid_t fid = 0;
+		if (pass != NULL) {
+			pass->driver = driver;
+			pass->dev = dev;
+			pass->tree = tree;
+			fid = fibril_create(pass_device_fibril, pass);
 		}
 
-		dev_del_ref(dev);
+		if (fid != 0) {
+			fibril_add_ready(fid);
+			link = link->next;
+			continue;
+		}
 
 		/*
-		 * Lock again as we will work with driver's
-		 * structure.
+		 * Fall back to passing the device synchronously. Unlock to
+		 * avoid deadlock when adding device handled by itself.
 		 */
+		free(pass);
+		fibril_mutex_unlock(&driver->driver_mutex);
+		pass_device(driver, dev, tree);
 		fibril_mutex_lock(&driver->driver_mutex);
 
 		/*
@@ -489,6 +551,19 @@ static void pass_devices_to_driver(driver_t *driver, dev_tree_t *tree)
 		link = driver->devices.head.next;
 	}
 
+	/*
+	 * Wait for all devices to be answered. More devices might have
+	 * been assigned to the driver in the meantime.
+	 */
+	if (driver->pending_adds > 0) {
+		while (driver->pending_adds > 0) {
+			fibril_condvar_wait(&driver->pending_cv,
+			    &driver->driver_mutex);
+		}
+
+		goto restart;
+	}
+
 	/*
 	 * Once we passed all devices to the driver, we need to mark the
 	 * driver as running.
@@ -537,6 +612,7 @@ void init_driver(driver_t *drv)
 	list_initialize(&drv->match_ids.ids);
 	list_initialize(&drv->devices);
 	fibril_mutex_initialize(&drv->driver_mutex);
+	fibril_condvar_initialize(&drv->pending_cv);
 	drv->sess = NULL;
 }
 
@@ -651,6 +727,8 @@ void add_device(driver_t *drv, dev_node_t *dev, dev_tree_t *tree)
 		parent_handle = 0;
 	}
 
+	boot_dev_add_begin();
+
 	async_exch_t *exch = async_exchange_begin(drv->sess);
 
 	ipc_call_t answer;
@@ -670,6 +748,8 @@ void add_device(driver_t *drv, dev_node_t *dev, dev_tree_t *tree)
 		async_wait_for(req, &rc);
 	}
 
+	boot_dev_add_end(rc == EOK);
+
 	if (rc == EOK) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "Device was added. Wait for "
 		    "child functions' devices to stabilize.");
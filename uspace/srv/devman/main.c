@@ -51,6 +51,7 @@
 #include <ipc/devman.h>
 #include <loc.h>
 
+#include "boot.h"
 #include "client_conn.h"
 #include "dev.h"
 #include "devman.h"
@@ -293,6 +294,8 @@ static bool devman_init(void)
 		return false;
 	}
 
+	boot_phase(DEVMAN_BOOT_DRIVERS_FOUND);
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "devman_init - list of drivers has been initialized.");
 
 	/* Create root device node. */
@@ -301,6 +304,8 @@ static bool devman_init(void)
 		return false;
 	}
 
+	boot_phase(DEVMAN_BOOT_TREE_INIT);
+
 	/*
 	 * Caution: As the device manager is not a real loc
 	 * driver (it uses a completely different IPC protocol
@@ -319,6 +324,7 @@ static bool devman_init(void)
 
 int main(int argc, char *argv[])
 {
+	boot_stats_init();
 	printf("%s: HelenOS Device Manager\n", NAME);
 
 	errno_t rc = log_init(NAME);
@@ -368,8 +374,10 @@ int main(int argc, char *argv[])
 	}
 
 	printf("%s: Accepting connections.\n", NAME);
+	boot_phase(DEVMAN_BOOT_ACCEPTING);
 	log_msg(LOG_DEFAULT, LVL_NOTE, "Wait for device tree to stabilize.");
 	dev_tree_wait_stable(&device_tree);
+	boot_phase(DEVMAN_BOOT_TREE_STABLE);
 	log_msg(LOG_DEFAULT, LVL_NOTE, "Device tree stable.");
 	task_retval(0);
 	async_manager();
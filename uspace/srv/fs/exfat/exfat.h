@@ -35,6 +35,7 @@
 #define EXFAT_EXFAT_H_
 
 #include "exfat_fat.h"
+#include "exfat_extent.h"
 #include <fibril_synch.h>
 #include <libfs.h>
 #include <stdint.h>
@@ -100,6 +101,7 @@ typedef enum {
 } exfat_node_type_t;
 
 struct exfat_node;
+
 struct exfat_idx_t;
 
 typedef struct {
@@ -151,16 +153,18 @@ typedef struct exfat_node {
 	bool			fragmented;
 
 	/*
-	 * Cache of the node's last and "current" cluster to avoid some
-	 * unnecessary FAT walks.
+	 * Cache of the node's last cluster to avoid some unnecessary FAT
+	 * walks.
 	 */
 	/* Node's last cluster in FAT. */
 	bool		lastc_cached_valid;
 	exfat_cluster_t	lastc_cached_value;
-	/* Node's "current" cluster, i.e. where the last I/O took place. */
-	bool		currc_cached_valid;
-	aoff64_t	currc_cached_bn;
-	exfat_cluster_t	currc_cached_value;
+
+	/*
+	 * Extents covering the beginning of a fragmented node's cluster
+	 * chain. The cache is extended lazily as the chain is walked.
+	 */
+	exfat_extents_t	extents;
 } exfat_node_t;
 
 extern vfs_out_ops_t exfat_ops;
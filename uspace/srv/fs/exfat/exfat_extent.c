@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup exfat
+ * @{
+ */
+
+/**
+ * @file	exfat_extent.c
+ * @brief	Cache of cluster runs of a node.
+ */
+
+#include "exfat_extent.h"
+#include <assert.h>
+#include <errno.h>
+#include <fibril_synch.h>
+#include <macros.h>
+#include <stdlib.h>
+
+/** Initial number of entries in a node's extent cache */
+#define EXFAT_EXTENTS_INIT	4
+/** Maximum number of entries in a node's extent cache */
+#define EXFAT_EXTENTS_MAX		1024
+
+/** Initialize an empty extent cache.
+ *
+ * @param ext		Extent cache.
+ */
+void exfat_extents_init(exfat_extents_t *ext)
+{
+	fibril_mutex_initialize(&ext->lock);
+	ext->extents = NULL;
+	ext->cnt = 0;
+	ext->alloc = 0;
+}
+
+/** Lock an extent cache.
+ *
+ * @param ext		Extent cache.
+ */
+void exfat_extents_lock(exfat_extents_t *ext)
+{
+	fibril_mutex_lock(&ext->lock);
+}
+
+/** Unlock an extent cache.
+ *
+ * @param ext		Extent cache.
+ */
+void exfat_extents_unlock(exfat_extents_t *ext)
+{
+	fibril_mutex_unlock(&ext->lock);
+}
+
+/** Drop all extents from the cache.
+ *
+ * The cache must be locked, or not be reachable by anybody else.
+ *
+ * @param ext		Extent cache.
+ */
+void exfat_extents_clear(exfat_extents_t *ext)
+{
+	free(ext->extents);
+	ext->extents = NULL;
+	ext->cnt = 0;
+	ext->alloc = 0;
+}
+
+/** Append a cluster run to the extent cache.
+ *
+ * @param ext		Extent cache.
+ * @param fcl		Index of the first cluster of the run within the node.
+ * @param dcl		First cluster of the run on the device.
+ *
+ * @return		EOK on success, ELIMIT if the cache is full or ENOMEM.
+ */
+static errno_t exfat_extents_append(exfat_extents_t *ext, uint32_t fcl,
+    exfat_cluster_t dcl)
+{
+	exfat_extent_t *extents;
+	size_t nalloc;
+
+	if (ext->cnt == ext->alloc) {
+		if (ext->alloc >= EXFAT_EXTENTS_MAX)
+			return ELIMIT;
+
+		nalloc = max(2 * ext->alloc, EXFAT_EXTENTS_INIT);
+		extents = realloc(ext->extents,
+		    nalloc * sizeof(exfat_extent_t));
+		if (extents == NULL)
+			return ENOMEM;
+
+		ext->extents = extents;
+		ext->alloc = nalloc;
+	}
+
+	ext->extents[ext->cnt].fcl = fcl;
+	ext->extents[ext->cnt].dcl = dcl;
+	ext->extents[ext->cnt].len = 1;
+	ext->cnt++;
+
+	return EOK;
+}
+
+/** Find the device cluster holding a given cluster of a node.
+ *
+ * Clusters covered by the cache are found by binary search. Otherwise the
+ * cluster chain is walked from the last cached cluster and the clusters
+ * visited are added to the cache. The cache must be locked.
+ *
+ * @param ext		Extent cache.
+ * @param firstc	First cluster of the node.
+ * @param fcl		Index of the cluster within the node.
+ * @param next		Function to get the next cluster in the chain.
+ * @param arg		Argument for @a next.
+ * @param clp		Place to store the cluster number.
+ *
+ * @return		EOK on success, ELIMIT if the cluster chain is shorter
+ *			or another error code.
+ */
+errno_t exfat_extents_lookup(exfat_extents_t *ext, exfat_cluster_t firstc,
+    uint32_t fcl, exfat_extents_next_t next, void *arg, exfat_cluster_t *clp)
+{
+	exfat_extent_t *e;
+	exfat_cluster_t clst;
+	uint32_t covered;
+	size_t lo, hi, mid;
+	bool caching;
+	errno_t rc;
+
+	assert(fibril_mutex_is_locked(&ext->lock));
+
+	if (ext->cnt == 0 && exfat_extents_append(ext, 0, firstc) != EOK) {
+		/* Cannot cache anything, walk the whole chain. */
+		clst = firstc;
+		for (covered = 0; covered < fcl; covered++) {
+			rc = next(arg, clst, &clst);
+			if (rc != EOK)
+				return rc;
+		}
+
+		*clp = clst;
+		return EOK;
+	}
+
+	e = &ext->extents[ext->cnt - 1];
+	covered = e->fcl + e->len;
+
+	if (fcl < covered) {
+		lo = 0;
+		hi = ext->cnt;
+		while (hi - lo > 1) {
+			mid = (lo + hi) / 2;
+			if (ext->extents[mid].fcl <= fcl)
+				lo = mid;
+			else
+				hi = mid;
+		}
+
+		e = &ext->extents[lo];
+		assert(fcl >= e->fcl && fcl < e->fcl + e->len);
+		*clp = e->dcl + (fcl - e->fcl);
+		return EOK;
+	}
+
+	/* Extend the cache by walking on from the last cached cluster. */
+	clst = e->dcl + e->len - 1;
+	caching = true;
+	while (covered <= fcl) {
+		rc = next(arg, clst, &clst);
+		if (rc != EOK)
+			return rc;
+
+		if (caching) {
+			e = &ext->extents[ext->cnt - 1];
+			if (clst == e->dcl + e->len)
+				e->len++;
+			else if (exfat_extents_append(ext, covered,
+			    clst) != EOK)
+				caching = false;
+		}
+
+		covered++;
+	}
+
+	*clp = clst;
+	return EOK;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup exfat
+ * @{
+ */
+
+#ifndef EXFAT_EXFAT_EXTENT_H_
+#define EXFAT_EXFAT_EXTENT_H_
+
+#include <errno.h>
+#include <fibril_synch.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "exfat_fat.h"
+
+/** Run of contiguous clusters of a node. */
+typedef struct {
+	/** Index of the first cluster of the run within the node. */
+	uint32_t	fcl;
+	/** First cluster of the run on the device. */
+	exfat_cluster_t	dcl;
+	/** Number of clusters in the run. */
+	uint32_t	len;
+} exfat_extent_t;
+
+/** Cache of extents covering the beginning of a node's cluster chain.
+ *
+ * The lock must be held while the cache is used and while the existing
+ * part of the cluster chain is being changed. It may be held across
+ * blocking operations.
+ */
+typedef struct {
+	fibril_mutex_t	lock;
+	/** Extents sorted by the index within the node. */
+	exfat_extent_t	*extents;
+	/** Number of valid extents. */
+	size_t		cnt;
+	/** Number of allocated extents. */
+	size_t		alloc;
+} exfat_extents_t;
+
+/** Get the cluster following a cluster in the chain.
+ *
+ * Returns ELIMIT if the cluster is the last one in the chain.
+ */
+typedef errno_t (*exfat_extents_next_t)(void *, exfat_cluster_t,
+    exfat_cluster_t *);
+
+extern void exfat_extents_init(exfat_extents_t *);
+extern void exfat_extents_lock(exfat_extents_t *);
+extern void exfat_extents_unlock(exfat_extents_t *);
+extern void exfat_extents_clear(exfat_extents_t *);
+extern errno_t exfat_extents_lookup(exfat_extents_t *, exfat_cluster_t,
+    uint32_t, exfat_extents_next_t, void *, exfat_cluster_t *);
+
+#endif
+
+/**
+ * @}
+ */
@@ -110,6 +110,86 @@ exfat_cluster_walk(exfat_bs_t *bs, service_id_t service_id,
 	return EOK;
 }
 
+/** Extent cache walk context. */
+typedef struct {
+	exfat_bs_t *bs;
+	service_id_t service_id;
+} exfat_extent_walk_t;
+
+/** Get the next cluster in a chain for the extent cache.
+ *
+ * @param arg		Walk context.
+ * @param clst		Cluster.
+ * @param nextp		Place to store the next cluster.
+ *
+ * @return		EOK on success, ELIMIT if @a clst is the last cluster
+ *			or another error code.
+ */
+static errno_t exfat_extent_next(void *arg, exfat_cluster_t clst,
+    exfat_cluster_t *nextp)
+{
+	exfat_extent_walk_t *walk = (exfat_extent_walk_t *) arg;
+	errno_t rc;
+
+	rc = exfat_get_cluster(walk->bs, walk->service_id, clst, &clst);
+	if (rc != EOK)
+		return rc;
+	if (clst == EXFAT_CLST_EOF)
+		return ELIMIT;
+	assert(clst != EXFAT_CLST_BAD);
+
+	*nextp = clst;
+	return EOK;
+}
+
+/** Find the device cluster holding a given cluster of a fragmented node.
+ *
+ * Uses and extends the node's extent cache.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param nodep		exFAT node. Must be fragmented.
+ * @param fcl		Index of the cluster within the node.
+ * @param clp		Place to store the cluster number.
+ *
+ * @return		EOK on success, ELIMIT if the cluster chain is shorter
+ *			or another error code.
+ */
+errno_t exfat_extent_lookup(exfat_bs_t *bs, exfat_node_t *nodep, uint32_t fcl,
+    exfat_cluster_t *clp)
+{
+	exfat_extent_walk_t walk;
+	errno_t rc;
+
+	assert(nodep->fragmented);
+
+	walk.bs = bs;
+	walk.service_id = nodep->idx->service_id;
+
+	exfat_extents_lock(&nodep->extents);
+	if (nodep->firstc < EXFAT_CLST_FIRST) {
+		rc = ELIMIT;
+	} else {
+		rc = exfat_extents_lookup(&nodep->extents, nodep->firstc, fcl,
+		    exfat_extent_next, &walk, clp);
+	}
+	exfat_extents_unlock(&nodep->extents);
+
+	return rc;
+}
+
+/** Drop the node's extent cache.
+ *
+ * Must be called before the node structure is freed or reused.
+ *
+ * @param nodep		exFAT node.
+ */
+void exfat_extents_invalidate(exfat_node_t *nodep)
+{
+	exfat_extents_lock(&nodep->extents);
+	exfat_extents_clear(&nodep->extents);
+	exfat_extents_unlock(&nodep->extents);
+}
+
 /** Read block from file located on a exFAT file system.
  *
  * @param block		Pointer to a block pointer for storing result.
@@ -124,49 +204,35 @@ errno_t
 exfat_block_get(block_t **block, exfat_bs_t *bs, exfat_node_t *nodep,
     aoff64_t bn, int flags)
 {
-	exfat_cluster_t firstc = nodep->firstc;
-	exfat_cluster_t currc = 0;
-	aoff64_t relbn = bn;
+	exfat_cluster_t c;
 	errno_t rc;
 
 	if (!nodep->size)
 		return ELIMIT;
 
-	if (nodep->fragmented) {
-		if (((((nodep->size - 1) / BPS(bs)) / SPC(bs)) == bn / SPC(bs)) &&
-		    nodep->lastc_cached_valid) {
-			/*
-			 * This is a request to read a block within the last cluster
-			 * when fortunately we have the last cluster number cached.
-			 */
-			return block_get(block, nodep->idx->service_id, DATA_FS(bs) +
-			    (nodep->lastc_cached_value - EXFAT_CLST_FIRST) * SPC(bs) +
-			    (bn % SPC(bs)), flags);
-		}
+	if (!nodep->fragmented) {
+		return exfat_block_get_by_clst(block, bs,
+		    nodep->idx->service_id, false, nodep->firstc, NULL, bn,
+		    flags);
+	}
 
-		if (nodep->currc_cached_valid && bn >= nodep->currc_cached_bn) {
-			/*
-			 * We can start with the cluster cached by the previous call to
-			 * fat_block_get().
-			 */
-			firstc = nodep->currc_cached_value;
-			relbn -= (nodep->currc_cached_bn / SPC(bs)) * SPC(bs);
-		}
+	if (((((nodep->size - 1) / BPS(bs)) / SPC(bs)) == bn / SPC(bs)) &&
+	    nodep->lastc_cached_valid) {
+		/*
+		 * This is a request to read a block within the last cluster
+		 * when fortunately we have the last cluster number cached.
+		 */
+		return block_get(block, nodep->idx->service_id, DATA_FS(bs) +
+		    (nodep->lastc_cached_value - EXFAT_CLST_FIRST) * SPC(bs) +
+		    (bn % SPC(bs)), flags);
 	}
 
-	rc = exfat_block_get_by_clst(block, bs, nodep->idx->service_id,
-	    nodep->fragmented, firstc, &currc, relbn, flags);
+	rc = exfat_extent_lookup(bs, nodep, bn / SPC(bs), &c);
 	if (rc != EOK)
 		return rc;
 
-	/*
-	 * Update the "current" cluster cache.
-	 */
-	nodep->currc_cached_valid = true;
-	nodep->currc_cached_bn = bn;
-	nodep->currc_cached_value = currc;
-
-	return rc;
+	return block_get(block, nodep->idx->service_id, DATA_FS(bs) +
+	    (c - EXFAT_CLST_FIRST) * SPC(bs) + (bn % SPC(bs)), flags);
 }
 
 /** Read block from file located on a exFAT file system.
@@ -406,6 +472,10 @@ exfat_append_clusters(exfat_bs_t *bs, exfat_node_t *nodep, exfat_cluster_t mcl,
 		nodep->firstc = mcl;
 		nodep->dirty = true;	/* need to sync node */
 	} else {
+		/*
+		 * The cached extents remain valid as appending does not change
+		 * the existing part of the cluster chain.
+		 */
 		if (nodep->lastc_cached_valid) {
 			lastc = nodep->lastc_cached_value;
 			nodep->lastc_cached_valid = false;
@@ -427,17 +497,9 @@ exfat_append_clusters(exfat_bs_t *bs, exfat_node_t *nodep, exfat_cluster_t mcl,
 	return EOK;
 }
 
-/** Chop off node clusters in FAT.
- *
- * @param bs		Buffer holding the boot sector of the file system.
- * @param nodep		FAT node where the chopping will take place.
- * @param lcl		Last cluster which will remain in the node. If this
- *			argument is FAT_CLST_RES0, then all clusters will
- *			be chopped off.
- *
- * @return		EOK on success or an error code.
- */
-errno_t exfat_chop_clusters(exfat_bs_t *bs, exfat_node_t *nodep, exfat_cluster_t lcl)
+/** Chop off node clusters with the extent cache locked. */
+static errno_t exfat_chop_clusters_locked(exfat_bs_t *bs, exfat_node_t *nodep,
+    exfat_cluster_t lcl)
 {
 	errno_t rc;
 	service_id_t service_id = nodep->idx->service_id;
@@ -446,8 +508,6 @@ errno_t exfat_chop_clusters(exfat_bs_t *bs, exfat_node_t *nodep, exfat_cluster_t
 	 * Invalidate cached cluster numbers.
 	 */
 	nodep->lastc_cached_valid = false;
-	if (nodep->currc_cached_value != lcl)
-		nodep->currc_cached_valid = false;
 
 	if (lcl == 0) {
 		/* The node will have zero size and no clusters allocated. */
@@ -483,6 +543,33 @@ errno_t exfat_chop_clusters(exfat_bs_t *bs, exfat_node_t *nodep, exfat_cluster_t
 	return EOK;
 }
 
+/** Chop off node clusters in FAT.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param nodep		FAT node where the chopping will take place.
+ * @param lcl		Last cluster which will remain in the node. If this
+ *			argument is FAT_CLST_RES0, then all clusters will
+ *			be chopped off.
+ *
+ * @return		EOK on success or an error code.
+ */
+errno_t exfat_chop_clusters(exfat_bs_t *bs, exfat_node_t *nodep, exfat_cluster_t lcl)
+{
+	errno_t rc;
+
+	/*
+	 * Keep the extent cache locked while the chain is being cut, so that
+	 * lookups in progress finish first and later ones neither see nor
+	 * cache the clusters being freed.
+	 */
+	exfat_extents_lock(&nodep->extents);
+	exfat_extents_clear(&nodep->extents);
+	rc = exfat_chop_clusters_locked(bs, nodep, lcl);
+	exfat_extents_unlock(&nodep->extents);
+
+	return rc;
+}
+
 errno_t
 exfat_zero_cluster(exfat_bs_t *bs, service_id_t service_id, exfat_cluster_t c)
 {
@@ -62,6 +62,9 @@ typedef uint32_t exfat_cluster_t;
 
 extern errno_t exfat_cluster_walk(struct exfat_bs *, service_id_t,
     exfat_cluster_t, exfat_cluster_t *, uint32_t *, uint32_t);
+extern errno_t exfat_extent_lookup(struct exfat_bs *, struct exfat_node *,
+    uint32_t, exfat_cluster_t *);
+extern void exfat_extents_invalidate(struct exfat_node *);
 extern errno_t exfat_block_get(block_t **, struct exfat_bs *, struct exfat_node *,
     aoff64_t, int);
 extern errno_t exfat_block_get_by_clst(block_t **, struct exfat_bs *, service_id_t,
@@ -110,9 +110,7 @@ static void exfat_node_initialize(exfat_node_t *node)
 	node->fragmented = false;
 	node->lastc_cached_valid = false;
 	node->lastc_cached_value = 0;
-	node->currc_cached_valid = false;
-	node->currc_cached_bn = 0;
-	node->currc_cached_value = 0;
+	exfat_extents_init(&node->extents);
 }
 
 static errno_t exfat_node_sync(exfat_node_t *node)
@@ -201,6 +199,7 @@ restart:
 				return rc;
 		}
 		nodep->idx->nodep = NULL;
+		exfat_extents_invalidate(nodep);
 		free(nodep->bp);
 		free(nodep);
 
@@ -239,6 +238,7 @@ static errno_t exfat_node_get_new(exfat_node_t **nodepp)
 				idxp_tmp->nodep = NULL;
 				fibril_mutex_unlock(&nodep->lock);
 				fibril_mutex_unlock(&idxp_tmp->lock);
+				exfat_extents_invalidate(nodep);
 				free(nodep->bp);
 				free(nodep);
 				return rc;
@@ -247,6 +247,7 @@ static errno_t exfat_node_get_new(exfat_node_t **nodepp)
 		idxp_tmp->nodep = NULL;
 		fibril_mutex_unlock(&nodep->lock);
 		fibril_mutex_unlock(&idxp_tmp->lock);
+		exfat_extents_invalidate(nodep);
 		fn = FS_NODE(nodep);
 	} else {
 	skip_cache:
@@ -471,8 +472,8 @@ static errno_t exfat_node_shrink(service_id_t service_id, exfat_node_t *nodep,
 				return rc;
 		} else {
 			exfat_cluster_t lastc;
-			rc = exfat_cluster_walk(bs, service_id, nodep->firstc,
-			    &lastc, NULL, (size - 1) / BPC(bs));
+			rc = exfat_extent_lookup(bs, nodep, (size - 1) / BPC(bs),
+			    &lastc);
 			if (rc != EOK)
 				return rc;
 			rc = exfat_chop_clusters(bs, nodep, lastc);
@@ -617,6 +618,7 @@ errno_t exfat_node_put(fs_node_t *fn)
 	}
 	fibril_mutex_unlock(&nodep->lock);
 	if (destroy) {
+		exfat_extents_invalidate(nodep);
 		free(nodep->bp);
 		free(nodep);
 	}
@@ -711,6 +713,7 @@ errno_t exfat_destroy_node(fs_node_t *fn)
 	}
 
 	exfat_idx_destroy(nodep->idx);
+	exfat_extents_invalidate(nodep);
 	free(nodep->bp);
 	free(nodep);
 	return rc;
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <fibril.h>
+#include <pcut/pcut.h>
+#include <stdbool.h>
+
+#include "../exfat_extent.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(extent);
+
+/** Number of clusters of the test node */
+#define TEST_CLUSTERS  64
+
+/** Device cluster holding each cluster of the test node */
+static exfat_cluster_t test_dcl[TEST_CLUSTERS];
+/** Current length of the test node's cluster chain */
+static uint32_t test_len;
+static exfat_extents_t test_ext;
+
+/** Set up a fragmented node, with runs of four clusters. */
+static void test_setup(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < TEST_CLUSTERS; i++)
+		test_dcl[i] = 100 + (i / 4) * 10 + i % 4;
+	test_len = TEST_CLUSTERS;
+	exfat_extents_init(&test_ext);
+}
+
+/** Get next cluster in the test chain, yielding as if reading the FAT. */
+static errno_t test_next(void *arg, exfat_cluster_t clst,
+    exfat_cluster_t *nextp)
+{
+	uint32_t i;
+
+	fibril_yield();
+
+	for (i = 0; i + 1 < test_len; i++) {
+		if (test_dcl[i] == clst) {
+			*nextp = test_dcl[i + 1];
+			return EOK;
+		}
+	}
+
+	return ELIMIT;
+}
+
+static errno_t test_lookup(uint32_t fcl, exfat_cluster_t *clp)
+{
+	errno_t rc;
+
+	exfat_extents_lock(&test_ext);
+	if (test_len == 0) {
+		rc = ELIMIT;
+	} else {
+		rc = exfat_extents_lookup(&test_ext, test_dcl[0], fcl,
+		    test_next, NULL, clp);
+	}
+	exfat_extents_unlock(&test_ext);
+	return rc;
+}
+
+/** Check that the cache is sorted, contiguous and matches the chain. */
+static void test_check_cache(void)
+{
+	uint32_t covered = 0;
+	size_t i;
+	uint32_t j;
+
+	for (i = 0; i < test_ext.cnt; i++) {
+		exfat_extent_t *e = &test_ext.extents[i];
+		PCUT_ASSERT_INT_EQUALS(covered, e->fcl);
+		PCUT_ASSERT_TRUE(e->len > 0);
+		for (j = 0; j < e->len; j++) {
+			PCUT_ASSERT_TRUE(e->fcl + j < test_len);
+			PCUT_ASSERT_INT_EQUALS(test_dcl[e->fcl + j],
+			    e->dcl + j);
+		}
+		covered += e->len;
+	}
+}
+
+typedef struct {
+	uint32_t fcl[2];
+	exfat_cluster_t cl[2];
+	errno_t rc[2];
+	bool done;
+} test_reader_t;
+
+/** Look up two clusters. */
+static errno_t test_reader(void *arg)
+{
+	test_reader_t *r = (test_reader_t *) arg;
+
+	r->rc[0] = test_lookup(r->fcl[0], &r->cl[0]);
+	r->rc[1] = test_lookup(r->fcl[1], &r->cl[1]);
+	r->done = true;
+	return EOK;
+}
+
+static bool test_truncated;
+
+/** Cut the test chain to eight clusters. */
+static errno_t test_truncator(void *arg)
+{
+	exfat_extents_lock(&test_ext);
+	exfat_extents_clear(&test_ext);
+	fibril_yield();
+	test_len = 8;
+	exfat_extents_unlock(&test_ext);
+	test_truncated = true;
+	return EOK;
+}
+
+/** Lookups walk the chain and return the right clusters */
+PCUT_TEST(walk)
+{
+	exfat_cluster_t cl;
+	uint32_t i;
+	errno_t rc;
+
+	test_setup();
+
+	rc = test_lookup(10, &cl);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(test_dcl[10], cl);
+
+	for (i = 0; i < TEST_CLUSTERS; i++) {
+		rc = test_lookup(i, &cl);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		PCUT_ASSERT_INT_EQUALS(test_dcl[i], cl);
+	}
+
+	rc = test_lookup(TEST_CLUSTERS, &cl);
+	PCUT_ASSERT_ERRNO_VAL(ELIMIT, rc);
+
+	test_check_cache();
+	PCUT_ASSERT_INT_EQUALS(TEST_CLUSTERS / 4, test_ext.cnt);
+	exfat_extents_clear(&test_ext);
+}
+
+/** Two readers extending the cache at the same time */
+PCUT_TEST(concurrent_readers)
+{
+	test_reader_t r1 = {
+		.fcl = { 60, 20 }
+	};
+	test_reader_t r2 = {
+		.fcl = { 40, 62 }
+	};
+	fid_t f1, f2;
+	int i;
+
+	test_setup();
+
+	f1 = fibril_create(test_reader, &r1);
+	PCUT_ASSERT_TRUE(f1 != 0);
+	f2 = fibril_create(test_reader, &r2);
+	PCUT_ASSERT_TRUE(f2 != 0);
+	fibril_start(f1);
+	fibril_start(f2);
+
+	while (!r1.done || !r2.done)
+		fibril_yield();
+
+	for (i = 0; i < 2; i++) {
+		PCUT_ASSERT_ERRNO_VAL(EOK, r1.rc[i]);
+		PCUT_ASSERT_INT_EQUALS(test_dcl[r1.fcl[i]], r1.cl[i]);
+		PCUT_ASSERT_ERRNO_VAL(EOK, r2.rc[i]);
+		PCUT_ASSERT_INT_EQUALS(test_dcl[r2.fcl[i]], r2.cl[i]);
+	}
+
+	test_check_cache();
+	exfat_extents_clear(&test_ext);
+}
+
+/** Truncation while a lookup is walking the chain */
+PCUT_TEST(truncate_during_lookup)
+{
+	test_reader_t r = {
+		.fcl = { 60, 30 }
+	};
+	exfat_cluster_t cl;
+	fid_t fr, ft;
+	errno_t rc;
+
+	test_setup();
+	test_truncated = false;
+
+	fr = fibril_create(test_reader, &r);
+	PCUT_ASSERT_TRUE(fr != 0);
+	ft = fibril_create(test_truncator, NULL);
+	PCUT_ASSERT_TRUE(ft != 0);
+
+	/* Let the reader start walking the chain, then truncate */
+	fibril_start(fr);
+	fibril_yield();
+	fibril_start(ft);
+
+	while (!r.done || !test_truncated)
+		fibril_yield();
+
+	/* The first lookup completed before the chain was cut */
+	PCUT_ASSERT_ERRNO_VAL(EOK, r.rc[0]);
+	PCUT_ASSERT_INT_EQUALS(test_dcl[60], r.cl[0]);
+	/* The second one saw the truncated chain */
+	PCUT_ASSERT_ERRNO_VAL(ELIMIT, r.rc[1]);
+
+	test_check_cache();
+
+	rc = test_lookup(5, &cl);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(test_dcl[5], cl);
+	rc = test_lookup(8, &cl);
+	PCUT_ASSERT_ERRNO_VAL(ELIMIT, rc);
+
+	test_check_cache();
+	exfat_extents_clear(&test_ext);
+}
+
+PCUT_EXPORT(extent);
@@ -35,6 +35,7 @@
 #define FAT_FAT_H_
 
 #include "fat_fat.h"
+#include "fat_extent.h"
 #include <fibril_synch.h>
 #include <libfs.h>
 #include <stdint.h>
@@ -243,16 +244,18 @@ typedef struct fat_node {
 	bool			dirty;
 
 	/*
-	 * Cache of the node's last and "current" cluster to avoid some
-	 * unnecessary FAT walks.
+	 * Cache of the node's last cluster to avoid some unnecessary FAT
+	 * walks.
 	 */
 	/* Node's last cluster in FAT. */
 	bool		lastc_cached_valid;
 	fat_cluster_t	lastc_cached_value;
-	/* Node's "current" cluster, i.e. where the last I/O took place. */
-	bool		currc_cached_valid;
-	aoff64_t	currc_cached_bn;
-	fat_cluster_t	currc_cached_value;
+
+	/*
+	 * Extents covering the beginning of the node's cluster chain. The
+	 * cache is extended lazily as the chain is walked.
+	 */
+	fat_extents_t	extents;
 } fat_node_t;
 
 typedef struct {
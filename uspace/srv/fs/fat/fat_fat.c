@@ -112,6 +112,84 @@ fat_cluster_walk(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc,
 	return EOK;
 }
 
+/** Extent cache walk context. */
+typedef struct {
+	fat_bs_t *bs;
+	service_id_t service_id;
+} fat_extent_walk_t;
+
+/** Get the next cluster in a chain for the extent cache.
+ *
+ * @param arg		Walk context.
+ * @param clst		Cluster.
+ * @param nextp		Place to store the next cluster.
+ *
+ * @return		EOK on success, ELIMIT if @a clst is the last cluster
+ *			or another error code.
+ */
+static errno_t fat_extent_next(void *arg, fat_cluster_t clst,
+    fat_cluster_t *nextp)
+{
+	fat_extent_walk_t *walk = (fat_extent_walk_t *) arg;
+	errno_t rc;
+
+	rc = fat_get_cluster(walk->bs, walk->service_id, FAT1, clst, &clst);
+	if (rc != EOK)
+		return rc;
+	if (clst >= FAT_CLST_LAST1(walk->bs))
+		return ELIMIT;
+	assert(clst != FAT_CLST_BAD(walk->bs));
+
+	*nextp = clst;
+	return EOK;
+}
+
+/** Find the device cluster holding a given cluster of a node.
+ *
+ * Uses and extends the node's extent cache.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param nodep		FAT node.
+ * @param fcl		Index of the cluster within the node.
+ * @param clp		Place to store the cluster number.
+ *
+ * @return		EOK on success, ELIMIT if the cluster chain is shorter
+ *			or another error code.
+ */
+errno_t fat_extent_lookup(fat_bs_t *bs, fat_node_t *nodep, uint32_t fcl,
+    fat_cluster_t *clp)
+{
+	fat_extent_walk_t walk;
+	errno_t rc;
+
+	walk.bs = bs;
+	walk.service_id = nodep->idx->service_id;
+
+	fat_extents_lock(&nodep->extents);
+	if (nodep->firstc == FAT_CLST_RES0) {
+		rc = ELIMIT;
+	} else {
+		rc = fat_extents_lookup(&nodep->extents, nodep->firstc, fcl,
+		    fat_extent_next, &walk, clp);
+	}
+	fat_extents_unlock(&nodep->extents);
+
+	return rc;
+}
+
+/** Drop the node's extent cache.
+ *
+ * Must be called before the node structure is freed or reused.
+ *
+ * @param nodep		FAT node.
+ */
+void fat_extents_invalidate(fat_node_t *nodep)
+{
+	fat_extents_lock(&nodep->extents);
+	fat_extents_clear(&nodep->extents);
+	fat_extents_unlock(&nodep->extents);
+}
+
 /** Read block from file located on a FAT file system.
  *
  * @param block		Pointer to a block pointer for storing result.
@@ -126,16 +204,16 @@ errno_t
 fat_block_get(block_t **block, struct fat_bs *bs, fat_node_t *nodep,
     aoff64_t bn, int flags)
 {
-	fat_cluster_t firstc = nodep->firstc;
-	fat_cluster_t currc = 0;
-	aoff64_t relbn = bn;
+	fat_cluster_t c;
 	errno_t rc;
 
 	if (!nodep->size)
 		return ELIMIT;
 
-	if (!FAT_IS_FAT32(bs) && nodep->firstc == FAT_CLST_ROOT)
-		goto fall_through;
+	if (!FAT_IS_FAT32(bs) && nodep->firstc == FAT_CLST_ROOT) {
+		return _fat_block_get(block, bs, nodep->idx->service_id,
+		    nodep->firstc, NULL, bn, flags);
+	}
 
 	if (((((nodep->size - 1) / BPS(bs)) / SPC(bs)) == bn / SPC(bs)) &&
 	    nodep->lastc_cached_valid) {
@@ -147,29 +225,12 @@ fat_block_get(block_t **block, struct fat_bs *bs, fat_node_t *nodep,
 		    CLBN2PBN(bs, nodep->lastc_cached_value, bn), flags);
 	}
 
-	if (nodep->currc_cached_valid && bn >= nodep->currc_cached_bn) {
-		/*
-		 * We can start with the cluster cached by the previous call to
-		 * fat_block_get().
-		 */
-		firstc = nodep->currc_cached_value;
-		relbn -= (nodep->currc_cached_bn / SPC(bs)) * SPC(bs);
-	}
-
-fall_through:
-	rc = _fat_block_get(block, bs, nodep->idx->service_id, firstc,
-	    &currc, relbn, flags);
+	rc = fat_extent_lookup(bs, nodep, bn / SPC(bs), &c);
 	if (rc != EOK)
 		return rc;
 
-	/*
-	 * Update the "current" cluster cache.
-	 */
-	nodep->currc_cached_valid = true;
-	nodep->currc_cached_bn = bn;
-	nodep->currc_cached_value = currc;
-
-	return rc;
+	return block_get(block, nodep->idx->service_id, CLBN2PBN(bs, c, bn),
+	    flags);
 }
 
 /** Read block from file located on a FAT file system.
@@ -793,6 +854,10 @@ errno_t fat_append_clusters(fat_bs_t *bs, fat_node_t *nodep, fat_cluster_t mcl,
 		nodep->firstc = mcl;
 		nodep->dirty = true;	/* need to sync node */
 	} else {
+		/*
+		 * The cached extents remain valid as appending does not change
+		 * the existing part of the cluster chain.
+		 */
 		if (nodep->lastc_cached_valid) {
 			lastc = nodep->lastc_cached_value;
 			nodep->lastc_cached_valid = false;
@@ -817,17 +882,9 @@ errno_t fat_append_clusters(fat_bs_t *bs, fat_node_t *nodep, fat_cluster_t mcl,
 	return EOK;
 }
 
-/** Chop off node clusters in all copies of FAT.
- *
- * @param bs		Buffer holding the boot sector of the file system.
- * @param nodep		FAT node where the chopping will take place.
- * @param lcl		Last cluster which will remain in the node. If this
- *			argument is FAT_CLST_RES0, then all clusters will
- *			be chopped off.
- *
- * @return		EOK on success or an error code.
- */
-errno_t fat_chop_clusters(fat_bs_t *bs, fat_node_t *nodep, fat_cluster_t lcl)
+/** Chop off node clusters with the extent cache locked. */
+static errno_t fat_chop_clusters_locked(fat_bs_t *bs, fat_node_t *nodep,
+    fat_cluster_t lcl)
 {
 	fat_cluster_t clst_last1 = FAT_CLST_LAST1(bs);
 	errno_t rc;
@@ -837,8 +894,6 @@ errno_t fat_chop_clusters(fat_bs_t *bs, fat_node_t *nodep, fat_cluster_t lcl)
 	 * Invalidate cached cluster numbers.
 	 */
 	nodep->lastc_cached_valid = false;
-	if (nodep->currc_cached_value != lcl)
-		nodep->currc_cached_valid = false;
 
 	if (lcl == FAT_CLST_RES0) {
 		/* The node will have zero size and no clusters allocated. */
@@ -878,6 +933,33 @@ errno_t fat_chop_clusters(fat_bs_t *bs, fat_node_t *nodep, fat_cluster_t lcl)
 	return EOK;
 }
 
+/** Chop off node clusters in all copies of FAT.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param nodep		FAT node where the chopping will take place.
+ * @param lcl		Last cluster which will remain in the node. If this
+ *			argument is FAT_CLST_RES0, then all clusters will
+ *			be chopped off.
+ *
+ * @return		EOK on success or an error code.
+ */
+errno_t fat_chop_clusters(fat_bs_t *bs, fat_node_t *nodep, fat_cluster_t lcl)
+{
+	errno_t rc;
+
+	/*
+	 * Keep the extent cache locked while the chain is being cut, so that
+	 * lookups in progress finish first and later ones neither see nor
+	 * cache the clusters being freed.
+	 */
+	fat_extents_lock(&nodep->extents);
+	fat_extents_clear(&nodep->extents);
+	rc = fat_chop_clusters_locked(bs, nodep, lcl);
+	fat_extents_unlock(&nodep->extents);
+
+	return rc;
+}
+
 errno_t
 fat_zero_cluster(struct fat_bs *bs, service_id_t service_id, fat_cluster_t c)
 {
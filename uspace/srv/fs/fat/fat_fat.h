@@ -110,6 +110,10 @@ typedef uint32_t fat_cluster_t;
 extern errno_t fat_cluster_walk(struct fat_bs *, service_id_t, fat_cluster_t,
     fat_cluster_t *, uint32_t *, uint32_t);
 
+extern errno_t fat_extent_lookup(struct fat_bs *, struct fat_node *, uint32_t,
+    fat_cluster_t *);
+extern void fat_extents_invalidate(struct fat_node *);
+
 extern errno_t fat_block_get(block_t **, struct fat_bs *, struct fat_node *,
     aoff64_t, int);
 extern errno_t _fat_block_get(block_t **, struct fat_bs *, service_id_t,
@@ -109,9 +109,7 @@ static void fat_node_initialize(fat_node_t *node)
 	node->dirty = false;
 	node->lastc_cached_valid = false;
 	node->lastc_cached_value = 0;
-	node->currc_cached_valid = false;
-	node->currc_cached_bn = 0;
-	node->currc_cached_value = 0;
+	fat_extents_init(&node->extents);
 }
 
 static errno_t fat_node_sync(fat_node_t *node)
@@ -193,6 +191,7 @@ restart:
 				return rc;
 		}
 		nodep->idx->nodep = NULL;
+		fat_extents_invalidate(nodep);
 		free(nodep->bp);
 		free(nodep);
 
@@ -231,6 +230,7 @@ static errno_t fat_node_get_new(fat_node_t **nodepp)
 				idxp_tmp->nodep = NULL;
 				fibril_mutex_unlock(&nodep->lock);
 				fibril_mutex_unlock(&idxp_tmp->lock);
+				fat_extents_invalidate(nodep);
 				free(nodep->bp);
 				free(nodep);
 				return rc;
@@ -239,6 +239,7 @@ static errno_t fat_node_get_new(fat_node_t **nodepp)
 		idxp_tmp->nodep = NULL;
 		fibril_mutex_unlock(&nodep->lock);
 		fibril_mutex_unlock(&idxp_tmp->lock);
+		fat_extents_invalidate(nodep);
 		fn = FS_NODE(nodep);
 	} else {
 	skip_cache:
@@ -477,6 +478,7 @@ errno_t fat_node_put(fs_node_t *fn)
 	}
 	fibril_mutex_unlock(&nodep->lock);
 	if (destroy) {
+		fat_extents_invalidate(nodep);
 		free(nodep->bp);
 		free(nodep);
 	}
@@ -570,6 +572,7 @@ errno_t fat_destroy_node(fs_node_t *fn)
 	}
 
 	fat_idx_destroy(nodep->idx);
+	fat_extents_invalidate(nodep);
 	free(nodep->bp);
 	free(nodep);
 	return rc;
@@ -1496,8 +1499,8 @@ fat_truncate(service_id_t service_id, fs_index_t index, aoff64_t size)
 				goto out;
 		} else {
 			fat_cluster_t lastc;
-			rc = fat_cluster_walk(bs, service_id, nodep->firstc,
-			    &lastc, NULL, (size - 1) / BPC(bs));
+			rc = fat_extent_lookup(bs, nodep, (size - 1) / BPC(bs),
+			    &lastc);
 			if (rc != EOK)
 				goto out;
 			rc = fat_chop_clusters(bs, nodep, lastc);
@@ -37,6 +37,7 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <adt/hash_table.h>
+#include "tmpfs_pages.h"
 
 #define TMPFS_NODE(node)	((node) ? (tmpfs_node_t *)(node)->data : NULL)
 #define FS_NODE(node)		((node) ? (node)->bp : NULL)
@@ -52,6 +53,8 @@ struct tmpfs_node;
 
 typedef struct tmpfs_dentry {
 	link_t link;		/**< Linkage for the list of siblings. */
+	ht_link_t dh_link;	/**< Dentries hash table link. */
+	struct tmpfs_node *parent;/**< Directory containing the dentry. */
 	struct tmpfs_node *node;/**< Back pointer to TMPFS node. */
 	char *name;		/**< Name of dentry. */
 } tmpfs_dentry_t;
@@ -64,8 +67,10 @@ typedef struct tmpfs_node {
 	tmpfs_dentry_type_t type;
 	unsigned lnkcnt;	/**< Link count. */
 	size_t size;		/**< File size if type is TMPFS_FILE. */
-	void *data;		/**< File content's if type is TMPFS_FILE. */
+	tmpfs_pages_t pages;	/**< File content's if type is TMPFS_FILE. */
 	list_t cs_list;		/**< Child's siblings list. */
+	link_t *rd_link;	/**< Last dentry returned by readdir or NULL. */
+	size_t rd_pos;		/**< Position of rd_link in cs_list. */
 } tmpfs_node_t;
 
 extern vfs_out_ops_t tmpfs_ops;
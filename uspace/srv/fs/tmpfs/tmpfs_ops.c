@@ -136,6 +136,12 @@ libfs_ops_t tmpfs_libfs_ops = {
 /** Hash table of all TMPFS nodes. */
 hash_table_t nodes;
 
+/** Hash table of all TMPFS dentries, keyed by parent node and name. */
+hash_table_t dentries;
+
+/** Page of zeroes backing reads from file holes. */
+static const uint8_t tmpfs_zero_page[PAGE_SIZE];
+
 /*
  * Implementation of hash table interface for the nodes hash table.
  */
@@ -176,13 +182,12 @@ static void nodes_remove_callback(ht_link_t *item)
 
 		assert(nodep->type == TMPFS_DIRECTORY);
 		list_remove(&dentryp->link);
+		hash_table_remove_item(&dentries, &dentryp->dh_link);
+		free(dentryp->name);
 		free(dentryp);
 	}
 
-	if (nodep->data) {
-		assert(nodep->type == TMPFS_FILE);
-		free(nodep->data);
-	}
+	tmpfs_pages_fini(&nodep->pages);
 	free(nodep->bp);
 	free(nodep);
 }
@@ -196,6 +201,70 @@ const hash_table_ops_t nodes_ops = {
 	.remove_callback = nodes_remove_callback
 };
 
+/*
+ * Implementation of hash table interface for the dentries hash table.
+ */
+
+typedef struct {
+	tmpfs_node_t *parent;
+	const char *name;
+} dentry_key_t;
+
+static size_t dentries_key_hash(const void *k)
+{
+	const dentry_key_t *key = k;
+	return hash_combine((size_t) key->parent, hash_string(key->name));
+}
+
+static size_t dentries_hash(const ht_link_t *item)
+{
+	tmpfs_dentry_t *dentryp = hash_table_get_inst(item, tmpfs_dentry_t,
+	    dh_link);
+	return hash_combine((size_t) dentryp->parent,
+	    hash_string(dentryp->name));
+}
+
+static bool dentries_key_equal(const void *key_arg, size_t hash,
+    const ht_link_t *item)
+{
+	tmpfs_dentry_t *dentryp = hash_table_get_inst(item, tmpfs_dentry_t,
+	    dh_link);
+	const dentry_key_t *key = key_arg;
+
+	return key->parent == dentryp->parent &&
+	    str_cmp(key->name, dentryp->name) == 0;
+}
+
+/** TMPFS dentries hash table operations. */
+const hash_table_ops_t dentries_ops = {
+	.hash = dentries_hash,
+	.key_hash = dentries_key_hash,
+	.key_equal = dentries_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Look up a dentry by its parent directory and name.
+ *
+ * @param parentp	Parent directory.
+ * @param name		Name of the dentry.
+ * @return		Dentry or NULL if there is no such dentry.
+ */
+static tmpfs_dentry_t *tmpfs_dentry_find(tmpfs_node_t *parentp,
+    const char *name)
+{
+	dentry_key_t key = {
+		.parent = parentp,
+		.name = name
+	};
+
+	ht_link_t *lnk = hash_table_find(&dentries, &key);
+	if (!lnk)
+		return NULL;
+
+	return hash_table_get_inst(lnk, tmpfs_dentry_t, dh_link);
+}
+
 static void tmpfs_node_initialize(tmpfs_node_t *nodep)
 {
 	nodep->bp = NULL;
@@ -204,14 +273,17 @@ static void tmpfs_node_initialize(tmpfs_node_t *nodep)
 	nodep->type = TMPFS_NONE;
 	nodep->lnkcnt = 0;
 	nodep->size = 0;
-	nodep->data = NULL;
+	tmpfs_pages_initialize(&nodep->pages);
 	list_initialize(&nodep->cs_list);
+	nodep->rd_link = NULL;
+	nodep->rd_pos = 0;
 }
 
 static void tmpfs_dentry_initialize(tmpfs_dentry_t *dentryp)
 {
 	link_initialize(&dentryp->link);
 	dentryp->name = NULL;
+	dentryp->parent = NULL;
 	dentryp->node = NULL;
 }
 
@@ -219,6 +291,10 @@ bool tmpfs_init(void)
 {
 	if (!hash_table_create(&nodes, 0, 0, &nodes_ops))
 		return false;
+	if (!hash_table_create(&dentries, 0, 0, &dentries_ops)) {
+		hash_table_destroy(&nodes);
+		return false;
+	}
 
 	return true;
 }
@@ -253,16 +329,9 @@ static void tmpfs_instance_done(service_id_t service_id)
 
 errno_t tmpfs_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 {
-	tmpfs_node_t *parentp = TMPFS_NODE(pfn);
-
-	list_foreach(parentp->cs_list, link, tmpfs_dentry_t, dentryp) {
-		if (!str_cmp(dentryp->name, component)) {
-			*rfn = FS_NODE(dentryp->node);
-			return EOK;
-		}
-	}
+	tmpfs_dentry_t *dentryp = tmpfs_dentry_find(TMPFS_NODE(pfn), component);
 
-	*rfn = NULL;
+	*rfn = dentryp ? FS_NODE(dentryp->node) : NULL;
 	return EOK;
 }
 
@@ -362,10 +431,8 @@ errno_t tmpfs_link_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 	assert(parentp->type == TMPFS_DIRECTORY);
 
 	/* Check for duplicit entries. */
-	list_foreach(parentp->cs_list, link, tmpfs_dentry_t, dp) {
-		if (!str_cmp(dp->name, nm))
-			return EEXIST;
-	}
+	if (tmpfs_dentry_find(parentp, nm))
+		return EEXIST;
 
 	/* Allocate and initialize the dentry. */
 	dentryp = malloc(sizeof(tmpfs_dentry_t));
@@ -381,9 +448,12 @@ errno_t tmpfs_link_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 		return ENOMEM;
 	}
 	str_cpy(dentryp->name, size + 1, nm);
+	dentryp->parent = parentp;
 	dentryp->node = childp;
 	childp->lnkcnt++;
+	/* Appending keeps positions of the other dentries, incl. rd_link. */
 	list_append(&dentryp->link, &parentp->cs_list);
+	hash_table_insert(&dentries, &dentryp->dh_link);
 
 	return EOK;
 }
@@ -391,31 +461,30 @@ errno_t tmpfs_link_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 errno_t tmpfs_unlink_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 {
 	tmpfs_node_t *parentp = TMPFS_NODE(pfn);
-	tmpfs_node_t *childp = NULL;
+	tmpfs_node_t *childp;
 	tmpfs_dentry_t *dentryp;
 
 	if (!parentp)
 		return EBUSY;
 
-	list_foreach(parentp->cs_list, link, tmpfs_dentry_t, dp) {
-		if (!str_cmp(dp->name, nm)) {
-			dentryp = dp;
-			childp = dentryp->node;
-			assert(FS_NODE(childp) == cfn);
-			break;
-		}
-	}
-
-	if (!childp)
+	dentryp = tmpfs_dentry_find(parentp, nm);
+	if (!dentryp)
 		return ENOENT;
+	childp = dentryp->node;
+	assert(FS_NODE(childp) == cfn);
 
 	if ((childp->lnkcnt == 1) && !list_empty(&childp->cs_list))
 		return ENOTEMPTY;
 
 	list_remove(&dentryp->link);
+	hash_table_remove_item(&dentries, &dentryp->dh_link);
+	free(dentryp->name);
 	free(dentryp);
 	childp->lnkcnt--;
 
+	/* Positions of the following dentries have shifted. */
+	parentp->rd_link = NULL;
+
 	return EOK;
 }
 
@@ -491,9 +560,18 @@ static errno_t tmpfs_read(service_id_t service_id, fs_index_t index, aoff64_t po
 
 	size_t bytes;
 	if (nodep->type == TMPFS_FILE) {
+		size_t off = pos % PAGE_SIZE;
+		const void *page;
+
+		/* Read at most up to the end of the current page. */
 		bytes = min(nodep->size - pos, size);
-		(void) async_data_read_finalize(&call, nodep->data + pos,
-		    bytes);
+		bytes = min(bytes, PAGE_SIZE - off);
+
+		page = tmpfs_page_find(&nodep->pages, pos / PAGE_SIZE);
+		if (page == NULL)
+			page = tmpfs_zero_page;
+
+		(void) async_data_read_finalize(&call, page + off, bytes);
 	} else {
 		tmpfs_dentry_t *dentryp;
 		link_t *lnk;
@@ -501,17 +579,26 @@ static errno_t tmpfs_read(service_id_t service_id, fs_index_t index, aoff64_t po
 		assert(nodep->type == TMPFS_DIRECTORY);
 
 		/*
-		 * Yes, we really use O(n) algorithm here.
-		 * If it bothers someone, it could be fixed by introducing a
-		 * hash table.
+		 * Directory listings are read sequentially, so continue from
+		 * the dentry returned last time instead of walking the list
+		 * from its beginning.
 		 */
-		lnk = list_nth(&nodep->cs_list, pos);
+		if (nodep->rd_link != NULL && pos >= nodep->rd_pos) {
+			lnk = nodep->rd_link;
+			for (aoff64_t i = nodep->rd_pos; i < pos && lnk; i++)
+				lnk = list_next(lnk, &nodep->cs_list);
+		} else {
+			lnk = list_nth(&nodep->cs_list, pos);
+		}
 
 		if (lnk == NULL) {
 			async_answer_0(&call, ENOENT);
 			return ENOENT;
 		}
 
+		nodep->rd_link = lnk;
+		nodep->rd_pos = pos;
+
 		dentryp = list_get_instance(lnk, tmpfs_dentry_t, link);
 
 		(void) async_data_read_finalize(&call, dentryp->name,
@@ -553,33 +640,29 @@ tmpfs_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	}
 
 	/*
-	 * Check whether the file needs to grow.
+	 * Write at most up to the end of the current page. The page is
+	 * allocated on demand; pages in the gap, if any, are left as holes.
 	 */
-	if (pos + size <= nodep->size) {
-		/* The file size is not changing. */
-		(void) async_data_write_finalize(&call, nodep->data + pos,
-		    size);
+	size_t off = pos % PAGE_SIZE;
+	size = min(size, PAGE_SIZE - off);
+
+	if (pos + size > SIZE_MAX) {
+		async_answer_0(&call, ENOMEM);
+		size = 0;
 		goto out;
 	}
-	size_t delta = (pos + size) - nodep->size;
-	/*
-	 * At this point, we are deliberately extremely straightforward and
-	 * simply realloc the contents of the file on every write that grows the
-	 * file. In the end, the situation might not be as bad as it may look:
-	 * our heap allocator can save us and just grow the block whenever
-	 * possible.
-	 */
-	void *newdata = realloc(nodep->data, nodep->size + delta);
-	if (!newdata) {
-		async_answer_0(&call, ENOMEM);
+
+	void *page;
+	errno_t rc = tmpfs_page_get(&nodep->pages, pos / PAGE_SIZE, &page);
+	if (rc != EOK) {
+		async_answer_0(&call, rc);
 		size = 0;
 		goto out;
 	}
-	/* Clear any newly allocated memory in order to emulate gaps. */
-	memset(newdata + nodep->size, 0, delta);
-	nodep->size += delta;
-	nodep->data = newdata;
-	(void) async_data_write_finalize(&call, nodep->data + pos, size);
+
+	(void) async_data_write_finalize(&call, page + off, size);
+	if (pos + size > nodep->size)
+		nodep->size = pos + size;
 
 out:
 	*wbytes = size;
@@ -609,17 +692,27 @@ static errno_t tmpfs_truncate(service_id_t service_id, fs_index_t index,
 	if (size > SIZE_MAX)
 		return ENOMEM;
 
-	void *newdata = realloc(nodep->data, size);
-	if (!newdata && size)
-		return ENOMEM;
+	if (size < nodep->size) {
+		size_t off = size % PAGE_SIZE;
+
+		/* Free whole pages past the new end of file. */
+		tmpfs_pages_truncate(&nodep->pages,
+		    size / PAGE_SIZE + (off != 0 ? 1 : 0));
 
-	if (size > nodep->size) {
-		size_t delta = size - nodep->size;
-		memset(newdata + nodep->size, 0, delta);
+		/*
+		 * Clear the tail of the last page so that growing the file
+		 * again exposes zeroes only.
+		 */
+		if (off != 0) {
+			void *page = tmpfs_page_find(&nodep->pages,
+			    size / PAGE_SIZE);
+			if (page != NULL)
+				memset(page + off, 0, PAGE_SIZE - off);
+		}
 	}
 
+	/* Growing the file just adds a hole. */
 	nodep->size = size;
-	nodep->data = newdata;
 	return EOK;
 }
 
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup tmpfs
+ * @{
+ */
+
+/**
+ * @file	tmpfs_pages.c
+ * @brief	Page-based storage of TMPFS file contents.
+ *
+ * File contents are kept in page-sized, page-aligned chunks indexed by a
+ * radix tree. Extending a file or writing into a hole only ever allocates
+ * the affected page (plus at most one interior node per tree level), so
+ * neither appends nor sparse writes need to copy existing data.
+ *
+ * Bytes of an allocated page which lie beyond the end of the file are
+ * always kept zeroed so that growing the file exposes zeroes only.
+ */
+
+#include "tmpfs_pages.h"
+#include <as.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <mem.h>
+
+/** Number of slots in an interior radix tree node. */
+#define TMPFS_RADIX_SLOTS	(PAGE_SIZE / sizeof(void *))
+
+/** Return the number of pages covered by a subtree of the given height.
+ *
+ * @param height	Height of the subtree.
+ * @return		Number of pages, saturated at SIZE_MAX.
+ */
+static size_t radix_span(unsigned height)
+{
+	size_t span = 1;
+
+	while (height-- > 0) {
+		if (span > SIZE_MAX / TMPFS_RADIX_SLOTS)
+			return SIZE_MAX;
+		span *= TMPFS_RADIX_SLOTS;
+	}
+
+	return span;
+}
+
+/** Free pages with index at least @a npages in a subtree.
+ *
+ * @param node		Root of the subtree, can be NULL.
+ * @param height	Height of the subtree.
+ * @param base		Index of the first page covered by the subtree.
+ * @param npages	Number of pages to keep.
+ * @return		@a node or NULL if the whole subtree was freed.
+ */
+static void *radix_trim(void *node, unsigned height, size_t base,
+    size_t npages)
+{
+	if (node == NULL)
+		return NULL;
+
+	if (height == 0) {
+		if (base >= npages) {
+			free(node);
+			return NULL;
+		}
+		return node;
+	}
+
+	void **slots = node;
+	size_t span = radix_span(height - 1);
+	bool empty = true;
+
+	for (size_t i = 0; i < TMPFS_RADIX_SLOTS; i++) {
+		size_t sbase = base + i * span;
+
+		if (slots[i] != NULL && sbase + span > npages) {
+			slots[i] = radix_trim(slots[i], height - 1, sbase,
+			    npages);
+		}
+		if (slots[i] != NULL)
+			empty = false;
+	}
+
+	if (empty) {
+		free(node);
+		return NULL;
+	}
+
+	return node;
+}
+
+/** Initialize an empty page tree.
+ *
+ * @param pages		Page tree.
+ */
+void tmpfs_pages_initialize(tmpfs_pages_t *pages)
+{
+	pages->root = NULL;
+	pages->height = 0;
+}
+
+/** Free all pages and interior nodes of a page tree.
+ *
+ * @param pages		Page tree.
+ */
+void tmpfs_pages_fini(tmpfs_pages_t *pages)
+{
+	tmpfs_pages_truncate(pages, 0);
+	pages->height = 0;
+}
+
+/** Find a data page.
+ *
+ * @param pages		Page tree.
+ * @param idx		Index of the page within the file.
+ * @return		Page or NULL if the page lies in a hole.
+ */
+void *tmpfs_page_find(tmpfs_pages_t *pages, size_t idx)
+{
+	unsigned height = pages->height;
+	void *node = pages->root;
+
+	if (idx >= radix_span(height))
+		return NULL;
+
+	while (height > 0 && node != NULL) {
+		size_t span = radix_span(height - 1);
+
+		node = ((void **) node)[(idx / span) % TMPFS_RADIX_SLOTS];
+		height--;
+	}
+
+	return node;
+}
+
+/** Find a data page, allocating it if necessary.
+ *
+ * Newly allocated pages are zero-filled.
+ *
+ * @param pages		Page tree.
+ * @param idx		Index of the page within the file.
+ * @param rpage		Place to store the page.
+ * @return		EOK on success or ENOMEM.
+ */
+errno_t tmpfs_page_get(tmpfs_pages_t *pages, size_t idx, void **rpage)
+{
+	/* Grow the tree until it covers the requested index. */
+	while (idx >= radix_span(pages->height)) {
+		if (pages->root != NULL) {
+			void **slots = calloc(TMPFS_RADIX_SLOTS,
+			    sizeof(void *));
+			if (slots == NULL)
+				return ENOMEM;
+			slots[0] = pages->root;
+			pages->root = slots;
+		}
+		pages->height++;
+	}
+
+	void **slot = &pages->root;
+	unsigned height = pages->height;
+
+	while (height > 0) {
+		if (*slot == NULL) {
+			*slot = calloc(TMPFS_RADIX_SLOTS, sizeof(void *));
+			if (*slot == NULL)
+				return ENOMEM;
+		}
+
+		size_t span = radix_span(height - 1);
+		slot = &((void **) *slot)[(idx / span) % TMPFS_RADIX_SLOTS];
+		height--;
+	}
+
+	if (*slot == NULL) {
+		void *page = memalign(PAGE_SIZE, PAGE_SIZE);
+		if (page == NULL)
+			return ENOMEM;
+		memset(page, 0, PAGE_SIZE);
+		*slot = page;
+	}
+
+	*rpage = *slot;
+	return EOK;
+}
+
+/** Free all pages with index at least @a npages.
+ *
+ * @param pages		Page tree.
+ * @param npages	Number of pages to keep.
+ */
+void tmpfs_pages_truncate(tmpfs_pages_t *pages, size_t npages)
+{
+	pages->root = radix_trim(pages->root, pages->height, 0, npages);
+}
+
+/**
+ * @}
+ */
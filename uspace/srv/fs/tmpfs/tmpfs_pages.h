@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup tmpfs
+ * @{
+ */
+
+#ifndef TMPFS_TMPFS_PAGES_H_
+#define TMPFS_TMPFS_PAGES_H_
+
+#include <errno.h>
+#include <stddef.h>
+
+/** Radix tree of file data pages.
+ *
+ * Each interior node is an array of page-sized fan-out. A tree of height
+ * zero consists of at most a single data page hanging directly off the root.
+ * Missing pages represent holes in the file and read as zeroes.
+ */
+typedef struct {
+	void *root;		/**< Root node or the only page, NULL if empty. */
+	unsigned height;	/**< Number of interior levels. */
+} tmpfs_pages_t;
+
+extern void tmpfs_pages_initialize(tmpfs_pages_t *);
+extern void tmpfs_pages_fini(tmpfs_pages_t *);
+extern void *tmpfs_page_find(tmpfs_pages_t *, size_t);
+extern errno_t tmpfs_page_get(tmpfs_pages_t *, size_t, void **);
+extern void tmpfs_pages_truncate(tmpfs_pages_t *, size_t);
+
+#endif
+
+/**
+ * @}
+ */
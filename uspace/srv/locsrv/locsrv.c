@@ -35,6 +35,8 @@
 /** @file
  */
 
+#include <adt/hash.h>
+#include <adt/hash_table.h>
 #include <ipc/services.h>
 #include <ns.h>
 #include <async.h>
@@ -61,10 +63,25 @@ typedef struct {
 	async_sess_t *sess;
 } cb_sess_t;
 
+/** Fully qualified service name used as a hash table key */
+typedef struct {
+	const char *ns_name;
+	const char *name;
+} loc_service_key_t;
+
 LIST_INITIALIZE(services_list);
 LIST_INITIALIZE(namespaces_list);
 LIST_INITIALIZE(servers_list);
 
+/*
+ * Indices of services_list and namespaces_list, protected by
+ * services_list_mutex as well.
+ */
+static hash_table_t services_by_id;
+static hash_table_t services_by_name;
+static hash_table_t namespaces_by_id;
+static hash_table_t namespaces_by_name;
+
 /*
  * Locking order:
  *  servers_list_mutex
@@ -108,6 +125,128 @@ service_id_t loc_create_id(void)
 	return last_id;
 }
 
+static size_t loc_service_name_hash(const char *ns_name, const char *name)
+{
+	return hash_combine(hash_string(ns_name), hash_string(name));
+}
+
+static size_t services_by_id_key_hash(const void *key)
+{
+	const service_id_t *id = key;
+	return *id;
+}
+
+static size_t services_by_id_hash(const ht_link_t *item)
+{
+	loc_service_t *service =
+	    hash_table_get_inst(item, loc_service_t, id_link);
+	return service->id;
+}
+
+static bool services_by_id_key_equal(const void *key, size_t hash,
+    const ht_link_t *item)
+{
+	const service_id_t *id = key;
+	loc_service_t *service =
+	    hash_table_get_inst(item, loc_service_t, id_link);
+	return service->id == *id;
+}
+
+static size_t services_by_name_key_hash(const void *key)
+{
+	const loc_service_key_t *skey = key;
+	return loc_service_name_hash(skey->ns_name, skey->name);
+}
+
+static size_t services_by_name_hash(const ht_link_t *item)
+{
+	loc_service_t *service =
+	    hash_table_get_inst(item, loc_service_t, name_link);
+	return loc_service_name_hash(service->namespace->name, service->name);
+}
+
+static bool services_by_name_key_equal(const void *key, size_t hash,
+    const ht_link_t *item)
+{
+	const loc_service_key_t *skey = key;
+	loc_service_t *service =
+	    hash_table_get_inst(item, loc_service_t, name_link);
+	return str_cmp(service->namespace->name, skey->ns_name) == 0 &&
+	    str_cmp(service->name, skey->name) == 0;
+}
+
+static size_t namespaces_by_id_hash(const ht_link_t *item)
+{
+	loc_namespace_t *namespace =
+	    hash_table_get_inst(item, loc_namespace_t, id_link);
+	return namespace->id;
+}
+
+static bool namespaces_by_id_key_equal(const void *key, size_t hash,
+    const ht_link_t *item)
+{
+	const service_id_t *id = key;
+	loc_namespace_t *namespace =
+	    hash_table_get_inst(item, loc_namespace_t, id_link);
+	return namespace->id == *id;
+}
+
+static size_t namespaces_by_name_key_hash(const void *key)
+{
+	return hash_string((const char *) key);
+}
+
+static size_t namespaces_by_name_hash(const ht_link_t *item)
+{
+	loc_namespace_t *namespace =
+	    hash_table_get_inst(item, loc_namespace_t, name_link);
+	return hash_string(namespace->name);
+}
+
+static bool namespaces_by_name_key_equal(const void *key, size_t hash,
+    const ht_link_t *item)
+{
+	loc_namespace_t *namespace =
+	    hash_table_get_inst(item, loc_namespace_t, name_link);
+	return str_cmp(namespace->name, (const char *) key) == 0;
+}
+
+/** Operations for services_by_id. */
+static const hash_table_ops_t services_by_id_ops = {
+	.hash = services_by_id_hash,
+	.key_hash = services_by_id_key_hash,
+	.key_equal = services_by_id_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Operations for services_by_name. */
+static const hash_table_ops_t services_by_name_ops = {
+	.hash = services_by_name_hash,
+	.key_hash = services_by_name_key_hash,
+	.key_equal = services_by_name_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Operations for namespaces_by_id. */
+static const hash_table_ops_t namespaces_by_id_ops = {
+	.hash = namespaces_by_id_hash,
+	.key_hash = services_by_id_key_hash,
+	.key_equal = namespaces_by_id_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Operations for namespaces_by_name. */
+static const hash_table_ops_t namespaces_by_name_ops = {
+	.hash = namespaces_by_name_hash,
+	.key_hash = namespaces_by_name_key_hash,
+	.key_equal = namespaces_by_name_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
 /** Convert fully qualified service name to namespace and service name.
  *
  * A fully qualified service name can be either a plain service name
@@ -185,29 +324,23 @@ static loc_namespace_t *loc_namespace_find_name(const char *name)
 {
 	assert(fibril_mutex_is_locked(&services_list_mutex));
 
-	list_foreach(namespaces_list, namespaces, loc_namespace_t, namespace) {
-		if (str_cmp(namespace->name, name) == 0)
-			return namespace;
-	}
+	ht_link_t *link = hash_table_find(&namespaces_by_name, name);
+	if (link == NULL)
+		return NULL;
 
-	return NULL;
+	return hash_table_get_inst(link, loc_namespace_t, name_link);
 }
 
-/** Find namespace with given ID.
- *
- * @todo: use hash table
- *
- */
+/** Find namespace with given ID. */
 static loc_namespace_t *loc_namespace_find_id(service_id_t id)
 {
 	assert(fibril_mutex_is_locked(&services_list_mutex));
 
-	list_foreach(namespaces_list, namespaces, loc_namespace_t, namespace) {
-		if (namespace->id == id)
-			return namespace;
-	}
+	ht_link_t *link = hash_table_find(&namespaces_by_id, &id);
+	if (link == NULL)
+		return NULL;
 
-	return NULL;
+	return hash_table_get_inst(link, loc_namespace_t, id_link);
 }
 
 /** Find service with given name. */
@@ -216,30 +349,38 @@ static loc_service_t *loc_service_find_name(const char *ns_name,
 {
 	assert(fibril_mutex_is_locked(&services_list_mutex));
 
-	list_foreach(services_list, services, loc_service_t, service) {
-		if ((str_cmp(service->namespace->name, ns_name) == 0) &&
-		    (str_cmp(service->name, name) == 0))
-			return service;
-	}
+	loc_service_key_t key = {
+		.ns_name = ns_name,
+		.name = name
+	};
 
-	return NULL;
+	ht_link_t *link = hash_table_find(&services_by_name, &key);
+	if (link == NULL)
+		return NULL;
+
+	return hash_table_get_inst(link, loc_service_t, name_link);
 }
 
-/** Find service with given ID.
- *
- * @todo: use hash table
- *
- */
+/** Find service with given ID. */
 static loc_service_t *loc_service_find_id(service_id_t id)
 {
 	assert(fibril_mutex_is_locked(&services_list_mutex));
 
-	list_foreach(services_list, services, loc_service_t, service) {
-		if (service->id == id)
-			return service;
-	}
+	ht_link_t *link = hash_table_find(&services_by_id, &id);
+	if (link == NULL)
+		return NULL;
+
+	return hash_table_get_inst(link, loc_service_t, id_link);
+}
+
+/** Insert service into the list of all services and its indices. */
+static void loc_service_insert(loc_service_t *service)
+{
+	assert(fibril_mutex_is_locked(&services_list_mutex));
 
-	return NULL;
+	list_append(&service->services, &services_list);
+	hash_table_insert(&services_by_id, &service->id_link);
+	hash_table_insert(&services_by_name, &service->name_link);
 }
 
 /** Create a namespace (if not already present). */
@@ -270,6 +411,8 @@ static loc_namespace_t *loc_namespace_create(const char *ns_name)
 	 * Insert new namespace into list of registered namespaces
 	 */
 	list_append(&(namespace->namespaces), &namespaces_list);
+	hash_table_insert(&namespaces_by_id, &namespace->id_link);
+	hash_table_insert(&namespaces_by_name, &namespace->name_link);
 
 	return namespace;
 }
@@ -281,6 +424,9 @@ static void loc_namespace_destroy(loc_namespace_t *namespace)
 
 	if (namespace->refcnt == 0) {
 		list_remove(&(namespace->namespaces));
+		hash_table_remove_item(&namespaces_by_id, &namespace->id_link);
+		hash_table_remove_item(&namespaces_by_name,
+		    &namespace->name_link);
 
 		free(namespace->name);
 		free(namespace);
@@ -312,6 +458,9 @@ static void loc_service_unregister_core(loc_service_t *service)
 	assert(fibril_mutex_is_locked(&services_list_mutex));
 	assert(fibril_mutex_is_locked(&cdir.mutex));
 
+	/* The name index needs the namespace to locate the service. */
+	hash_table_remove_item(&services_by_name, &service->name_link);
+	hash_table_remove_item(&services_by_id, &service->id_link);
 	loc_namespace_delref(service->namespace);
 	list_remove(&(service->services));
 	list_remove(&(service->server_services));
@@ -524,7 +673,7 @@ static void loc_service_register(ipc_call_t *icall, loc_server_t *server)
 	service->server = server;
 
 	/* Insert service into list of all services  */
-	list_append(&service->services, &services_list);
+	loc_service_insert(service);
 
 	/* Insert service into list of services supplied by one server */
 	fibril_mutex_lock(&service->server->services_mutex);
@@ -1234,7 +1383,7 @@ static void loc_null_create(ipc_call_t *icall)
 	 * Insert service into a dummy list of null server's services so that it
 	 * can be safely removed later.
 	 */
-	list_append(&service->services, &services_list);
+	loc_service_insert(service);
 	list_append(&service->server_services, &dummy_null_services);
 	null_services[i] = service;
 
@@ -1269,6 +1418,9 @@ static void loc_null_destroy(ipc_call_t *icall)
 	null_services[i] = NULL;
 
 	fibril_mutex_unlock(&null_services_mutex);
+
+	/* Let clients drop cached IDs of the removed service */
+	loc_category_change_event();
 	async_answer_0(icall, EOK);
 }
 
@@ -1324,6 +1476,17 @@ static bool loc_init(void)
 	for (i = 0; i < NULL_SERVICES; i++)
 		null_services[i] = NULL;
 
+	if (!hash_table_create(&services_by_id, 0, 0, &services_by_id_ops) ||
+	    !hash_table_create(&services_by_name, 0, 0,
+	    &services_by_name_ops) ||
+	    !hash_table_create(&namespaces_by_id, 0, 0,
+	    &namespaces_by_id_ops) ||
+	    !hash_table_create(&namespaces_by_name, 0, 0,
+	    &namespaces_by_name_ops)) {
+		printf("%s: No memory for service indices\n", NAME);
+		return false;
+	}
+
 	categ_dir_init(&cdir);
 
 	cat = category_new("disk");
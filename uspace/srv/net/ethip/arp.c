@@ -34,10 +34,12 @@
  * @brief
  */
 
+#include <adt/list.h>
 #include <errno.h>
 #include <inet/iplink_srv.h>
 #include <inet/addr.h>
 #include <inet/eth_addr.h>
+#include <inet/ncache.h>
 #include <io/log.h>
 #include <stdlib.h>
 #include "arp.h"
@@ -47,11 +49,32 @@
 #include "pdu.h"
 #include "std.h"
 
-/** Time to wait for ARP reply in microseconds */
-#define ARP_REQUEST_TIMEOUT (3 * 1000 * 1000)
-
 static errno_t arp_send_packet(ethip_nic_t *nic, arp_eth_packet_t *packet);
 
+/** Send frames that were waiting for address translation.
+ *
+ * Frames queued for a NIC that has been removed since are dropped.
+ *
+ * @param sendq List of frames (of ncache_pkt_t)
+ * @param mac_addr Destination MAC address
+ */
+static void arp_send_pending(list_t *sendq, eth_addr_t *mac_addr)
+{
+	ncache_pkt_t *pkt;
+	ethip_nic_t *nic;
+
+	while ((pkt = ncache_pkt_first(sendq)) != NULL) {
+		nic = ethip_nic_find_by_iplink_sid(
+		    (service_id_t) (uintptr_t) pkt->arg);
+		if (nic != NULL) {
+			eth_pdu_set_dest(pkt->data, mac_addr);
+			(void) ethip_nic_send(nic, pkt->data, pkt->size);
+		}
+
+		ncache_pkt_destroy(pkt);
+	}
+}
+
 void arp_received(ethip_nic_t *nic, eth_frame_t *frame)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "arp_received()");
@@ -78,8 +101,12 @@ void arp_received(ethip_nic_t *nic, eth_frame_t *frame)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "Request/reply to my address");
 
+	list_t sendq;
+	list_initialize(&sendq);
+
 	(void) atrans_add(packet.sender_proto_addr,
-	    &packet.sender_hw_addr);
+	    &packet.sender_hw_addr, &sendq);
+	arp_send_pending(&sendq, &packet.sender_hw_addr);
 
 	if (packet.opcode == aop_request) {
 		arp_eth_packet_t reply;
@@ -94,18 +121,33 @@ void arp_received(ethip_nic_t *nic, eth_frame_t *frame)
 	}
 }
 
+/** Translate IPv4 address to MAC address.
+ *
+ * Does not wait for an ARP reply. If the address is not known yet,
+ * an ARP request is sent and EAGAIN returned. The caller can queue
+ * the frame with atrans_enqueue() or wait with atrans_lookup_timeout().
+ *
+ * @param nic NIC
+ * @param src_addr Source IPv4 address
+ * @param ip_addr IPv4 address to translate
+ * @param mac_addr Place to store MAC address
+ * @return EOK on success, EAGAIN if resolution is in progress, ENOENT
+ *         if the address could not be resolved recently
+ */
 errno_t arp_translate(ethip_nic_t *nic, addr32_t src_addr, addr32_t ip_addr,
     eth_addr_t *mac_addr)
 {
+	bool solicit;
+
 	/* Broadcast address */
 	if (ip_addr == addr32_broadcast_all_hosts) {
 		*mac_addr = eth_addr_broadcast;
 		return EOK;
 	}
 
-	errno_t rc = atrans_lookup(ip_addr, mac_addr);
-	if (rc == EOK)
-		return EOK;
+	errno_t rc = atrans_lookup(ip_addr, mac_addr, &solicit);
+	if (!solicit)
+		return rc;
 
 	arp_eth_packet_t packet;
 
@@ -115,11 +157,11 @@ errno_t arp_translate(ethip_nic_t *nic, addr32_t src_addr, addr32_t ip_addr,
 	packet.target_hw_addr = eth_addr_broadcast;
 	packet.target_proto_addr = ip_addr;
 
-	rc = arp_send_packet(nic, &packet);
-	if (rc != EOK)
-		return rc;
+	errno_t send_rc = arp_send_packet(nic, &packet);
+	if (rc != EOK && send_rc != EOK)
+		return send_rc;
 
-	return atrans_lookup_timeout(ip_addr, ARP_REQUEST_TIMEOUT, mac_addr);
+	return rc;
 }
 
 static errno_t arp_send_packet(ethip_nic_t *nic, arp_eth_packet_t *packet)
@@ -42,6 +42,9 @@
 #include <inet/iplink_srv.h>
 #include "ethip.h"
 
+/** Time to wait for ARP reply in microseconds */
+#define ARP_REQUEST_TIMEOUT (3 * 1000 * 1000)
+
 extern void arp_received(ethip_nic_t *, eth_frame_t *);
 extern errno_t arp_translate(ethip_nic_t *, addr32_t, addr32_t, eth_addr_t *);
 
@@ -36,130 +36,94 @@
 
 #include <adt/list.h>
 #include <errno.h>
-#include <fibril_synch.h>
+#include <inet/addr.h>
 #include <inet/eth_addr.h>
 #include <inet/iplink_srv.h>
+#include <inet/ncache.h>
 #include <stdlib.h>
 
 #include "atrans.h"
 #include "ethip.h"
 
-/** Address translation list (of ethip_atrans_t) */
-static FIBRIL_MUTEX_INITIALIZE(atrans_list_lock);
-static LIST_INITIALIZE(atrans_list);
-static FIBRIL_CONDVAR_INITIALIZE(atrans_cv);
+/** Address translation table */
+static ncache_t *atrans_cache;
 
-static ethip_atrans_t *atrans_find(addr32_t ip_addr)
+errno_t atrans_init(void)
 {
-	list_foreach(atrans_list, atrans_list, ethip_atrans_t, atrans) {
-		if (atrans->ip_addr == ip_addr)
-			return atrans;
-	}
-
-	return NULL;
+	return ncache_create(&atrans_cache);
 }
 
-errno_t atrans_add(addr32_t ip_addr, eth_addr_t *mac_addr)
+/** Add or confirm translation.
+ *
+ * @param ip_addr IPv4 address
+ * @param mac_addr MAC address
+ * @param sendq List to append frames waiting for the translation to
+ *              (of ncache_pkt_t)
+ * @return EOK on success, ENOMEM if out of memory
+ */
+errno_t atrans_add(addr32_t ip_addr, eth_addr_t *mac_addr, list_t *sendq)
 {
-	ethip_atrans_t *atrans;
-	ethip_atrans_t *prev;
-
-	atrans = calloc(1, sizeof(ethip_atrans_t));
-	if (atrans == NULL)
-		return ENOMEM;
-
-	atrans->ip_addr = ip_addr;
-	atrans->mac_addr = *mac_addr;
-
-	fibril_mutex_lock(&atrans_list_lock);
-	prev = atrans_find(ip_addr);
-	if (prev != NULL) {
-		list_remove(&prev->atrans_list);
-		free(prev);
-	}
+	inet_addr_t addr;
 
-	list_append(&atrans->atrans_list, &atrans_list);
-	fibril_mutex_unlock(&atrans_list_lock);
-	fibril_condvar_broadcast(&atrans_cv);
-
-	return EOK;
+	inet_addr_set(ip_addr, &addr);
+	return ncache_update(atrans_cache, &addr, mac_addr, sendq);
 }
 
 errno_t atrans_remove(addr32_t ip_addr)
 {
-	ethip_atrans_t *atrans;
-
-	fibril_mutex_lock(&atrans_list_lock);
-	atrans = atrans_find(ip_addr);
-	if (atrans == NULL) {
-		fibril_mutex_unlock(&atrans_list_lock);
-		return ENOENT;
-	}
-
-	list_remove(&atrans->atrans_list);
-	fibril_mutex_unlock(&atrans_list_lock);
-	free(atrans);
+	inet_addr_t addr;
 
-	return EOK;
+	inet_addr_set(ip_addr, &addr);
+	return ncache_remove(atrans_cache, &addr);
 }
 
-static errno_t atrans_lookup_locked(addr32_t ip_addr, eth_addr_t *mac_addr)
+/** Look up translation.
+ *
+ * @param ip_addr IPv4 address
+ * @param mac_addr Place to store MAC address
+ * @param solicit Place to store @c true if an ARP request should be sent
+ * @return EOK on success, EAGAIN if resolution is in progress, ENOENT
+ *         if resolution failed recently, ENOMEM if out of memory
+ */
+errno_t atrans_lookup(addr32_t ip_addr, eth_addr_t *mac_addr, bool *solicit)
 {
-	ethip_atrans_t *atrans = atrans_find(ip_addr);
-	if (atrans == NULL)
-		return ENOENT;
+	inet_addr_t addr;
 
-	*mac_addr = atrans->mac_addr;
-	return EOK;
+	inet_addr_set(ip_addr, &addr);
+	return ncache_resolve(atrans_cache, &addr, mac_addr, solicit);
 }
 
-errno_t atrans_lookup(addr32_t ip_addr, eth_addr_t *mac_addr)
+/** Queue frame until its destination address is resolved.
+ *
+ * @param ip_addr IPv4 address
+ * @param nic NIC to send the frame through
+ * @param data Encoded frame, owned by the table on success
+ * @param size Size of frame
+ * @return EOK on success, ENOENT if resolution is not in progress,
+ *         ELIMIT if too many frames are queued, ENOMEM if out of memory
+ */
+errno_t atrans_enqueue(addr32_t ip_addr, ethip_nic_t *nic, void *data,
+    size_t size)
 {
-	errno_t rc;
-
-	fibril_mutex_lock(&atrans_list_lock);
-	rc = atrans_lookup_locked(ip_addr, mac_addr);
-	fibril_mutex_unlock(&atrans_list_lock);
+	inet_addr_t addr;
 
-	return rc;
-}
-
-static void atrans_lookup_timeout_handler(void *arg)
-{
-	bool *timedout = (bool *)arg;
+	inet_addr_set(ip_addr, &addr);
 
-	fibril_mutex_lock(&atrans_list_lock);
-	*timedout = true;
-	fibril_mutex_unlock(&atrans_list_lock);
-	fibril_condvar_broadcast(&atrans_cv);
+	/*
+	 * Refer to the NIC by its service ID so that frames queued for
+	 * a NIC that disappears meanwhile are simply dropped.
+	 */
+	return ncache_enqueue(atrans_cache, &addr,
+	    (void *) (uintptr_t) nic->iplink_sid, data, size);
 }
 
 errno_t atrans_lookup_timeout(addr32_t ip_addr, usec_t timeout,
     eth_addr_t *mac_addr)
 {
-	fibril_timer_t *t;
-	bool timedout;
-	errno_t rc;
-
-	t = fibril_timer_create(NULL);
-	if (t == NULL)
-		return ENOMEM;
-
-	timedout = false;
-	fibril_timer_set(t, timeout, atrans_lookup_timeout_handler, &timedout);
-
-	fibril_mutex_lock(&atrans_list_lock);
-
-	while ((rc = atrans_lookup_locked(ip_addr, mac_addr)) == ENOENT &&
-	    !timedout) {
-		fibril_condvar_wait(&atrans_cv, &atrans_list_lock);
-	}
-
-	fibril_mutex_unlock(&atrans_list_lock);
-	(void) fibril_timer_clear(t);
-	fibril_timer_destroy(t);
+	inet_addr_t addr;
 
-	return rc;
+	inet_addr_set(ip_addr, &addr);
+	return ncache_wait(atrans_cache, &addr, timeout, mac_addr);
 }
 
 /** @}
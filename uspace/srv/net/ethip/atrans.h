@@ -37,14 +37,18 @@
 #ifndef ATRANS_H_
 #define ATRANS_H_
 
+#include <adt/list.h>
 #include <inet/addr.h>
 #include <inet/eth_addr.h>
 #include <inet/iplink_srv.h>
+#include <stdbool.h>
 #include "ethip.h"
 
-extern errno_t atrans_add(addr32_t, eth_addr_t *);
+extern errno_t atrans_init(void);
+extern errno_t atrans_add(addr32_t, eth_addr_t *, list_t *);
 extern errno_t atrans_remove(addr32_t);
-extern errno_t atrans_lookup(addr32_t, eth_addr_t *);
+extern errno_t atrans_lookup(addr32_t, eth_addr_t *, bool *);
+extern errno_t atrans_enqueue(addr32_t, ethip_nic_t *, void *, size_t);
 extern errno_t atrans_lookup_timeout(addr32_t, usec_t, eth_addr_t *);
 
 #endif
@@ -46,6 +46,7 @@
 #include <stdlib.h>
 #include <task.h>
 #include "arp.h"
+#include "atrans.h"
 #include "ethip.h"
 #include "ethip_nic.h"
 #include "pdu.h"
@@ -83,7 +84,14 @@ static errno_t ethip_init(void)
 {
 	async_set_fallback_port_handler(ethip_client_conn, NULL);
 
-	errno_t rc = loc_server_register(NAME, &ethip_srv);
+	errno_t rc = atrans_init();
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed initializing address "
+		    "translation.");
+		return rc;
+	}
+
+	rc = loc_server_register(NAME, &ethip_srv);
 	if (rc != EOK) {
 		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed registering server.");
 		return rc;
@@ -178,9 +186,14 @@ static errno_t ethip_send(iplink_srv_t *srv, iplink_sdu_t *sdu)
 
 	ethip_nic_t *nic = (ethip_nic_t *) srv->arg;
 	eth_frame_t frame;
+	bool resolving = false;
 
 	errno_t rc = arp_translate(nic, sdu->src, sdu->dest, &frame.dest);
-	if (rc != EOK) {
+	if (rc == EAGAIN) {
+		/* Destination address is filled in once it is known */
+		frame.dest = eth_addr_broadcast;
+		resolving = true;
+	} else if (rc != EOK) {
 		log_msg(LOG_DEFAULT, LVL_WARN, "Failed to look up IPv4 address 0x%"
 		    PRIx32, sdu->dest);
 		return rc;
@@ -197,6 +210,25 @@ static errno_t ethip_send(iplink_srv_t *srv, iplink_sdu_t *sdu)
 	if (rc != EOK)
 		return rc;
 
+	if (resolving) {
+		/* Queue the frame until the ARP reply arrives */
+		rc = atrans_enqueue(sdu->dest, nic, data, size);
+		if (rc == EOK)
+			return EOK;
+
+		/* Too many frames queued already, wait for the reply */
+		rc = atrans_lookup_timeout(sdu->dest, ARP_REQUEST_TIMEOUT,
+		    &frame.dest);
+		if (rc != EOK) {
+			log_msg(LOG_DEFAULT, LVL_WARN, "Failed to look up IPv4 "
+			    "address 0x%" PRIx32, sdu->dest);
+			free(data);
+			return rc;
+		}
+
+		eth_pdu_set_dest(data, &frame.dest);
+	}
+
 	rc = ethip_nic_send(nic, data, size);
 	free(data);
 
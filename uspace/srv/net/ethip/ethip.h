@@ -109,13 +109,6 @@ typedef struct {
 	addr32_t target_proto_addr;
 } arp_eth_packet_t;
 
-/** Address translation table element */
-typedef struct {
-	link_t atrans_list;
-	addr32_t ip_addr;
-	eth_addr_t mac_addr;
-} ethip_atrans_t;
-
 extern errno_t ethip_iplink_init(ethip_nic_t *);
 extern errno_t ethip_received(iplink_srv_t *, void *, size_t);
 
@@ -41,6 +41,7 @@
 
 extern errno_t eth_pdu_encode(eth_frame_t *, void **, size_t *);
 extern errno_t eth_pdu_decode(void *, size_t, eth_frame_t *);
+extern void eth_pdu_set_dest(void *, eth_addr_t *);
 extern errno_t arp_pdu_encode(arp_eth_packet_t *, void **, size_t *);
 extern errno_t arp_pdu_decode(void *, size_t, arp_eth_packet_t *);
 
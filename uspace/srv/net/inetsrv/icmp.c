@@ -34,6 +34,7 @@
  * @brief
  */
 
+#include <adt/checksum.h>
 #include <byteorder.h>
 #include <errno.h>
 #include <io/log.h>
@@ -101,7 +102,7 @@ static errno_t icmp_recv_echo_request(inet_dgram_t *dgram)
 	reply->code = 0;
 	reply->checksum = 0;
 
-	checksum = inet_checksum_calc(INET_CHECKSUM_INIT, reply, size);
+	checksum = compute_ocsum(reply, size);
 	reply->checksum = host2uint16_t_be(checksum);
 
 	rdgram.iplink = 0;
@@ -157,7 +158,7 @@ errno_t icmp_ping_send(uint16_t ident, inetping_sdu_t *sdu)
 
 	memcpy(rdata + sizeof(icmp_echo_t), sdu->data, sdu->size);
 
-	uint16_t checksum = inet_checksum_calc(INET_CHECKSUM_INIT, rdata, rsize);
+	uint16_t checksum = compute_ocsum(rdata, rsize);
 	request->checksum = host2uint16_t_be(checksum);
 
 	inet_dgram_t dgram;
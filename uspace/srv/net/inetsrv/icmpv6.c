@@ -34,6 +34,7 @@
  * @brief
  */
 
+#include <adt/checksum.h>
 #include <byteorder.h>
 #include <errno.h>
 #include <io/log.h>
@@ -92,11 +93,12 @@ static errno_t icmpv6_recv_echo_request(inet_dgram_t *dgram)
 	memset(phdr.zeroes, 0, 3);
 	phdr.next = IP_PROTO_ICMPV6;
 
-	uint16_t cs_phdr =
-	    inet_checksum_calc(INET_CHECKSUM_INIT, &phdr,
-	    sizeof(icmpv6_phdr_t));
+	ocsum_t cs;
+	ocsum_init(&cs);
+	ocsum_add(&cs, &phdr, sizeof(icmpv6_phdr_t));
+	ocsum_add(&cs, reply, size);
 
-	uint16_t cs_all = inet_checksum_calc(cs_phdr, reply, size);
+	uint16_t cs_all = ocsum_get(&cs);
 
 	reply->checksum = host2uint16_t_be(cs_all);
 
@@ -193,11 +195,12 @@ errno_t icmpv6_ping_send(uint16_t ident, inetping_sdu_t *sdu)
 	memset(phdr.zeroes, 0, 3);
 	phdr.next = IP_PROTO_ICMPV6;
 
-	uint16_t cs_phdr =
-	    inet_checksum_calc(INET_CHECKSUM_INIT, &phdr,
-	    sizeof(icmpv6_phdr_t));
+	ocsum_t cs;
+	ocsum_init(&cs);
+	ocsum_add(&cs, &phdr, sizeof(icmpv6_phdr_t));
+	ocsum_add(&cs, rdata, rsize);
 
-	uint16_t cs_all = inet_checksum_calc(cs_phdr, rdata, rsize);
+	uint16_t cs_all = ocsum_get(&cs);
 
 	request->checksum = host2uint16_t_be(cs_all);
 
@@ -34,6 +34,7 @@
  * @brief
  */
 
+#include <assert.h>
 #include <async.h>
 #include <errno.h>
 #include <macros.h>
@@ -51,6 +52,29 @@
 #include "inetcfg.h"
 #include "sroute.h"
 
+static errno_t inetcfg_batch_begin(void)
+{
+	++cfg->batches;
+	return EOK;
+}
+
+static errno_t inetcfg_batch_end(void)
+{
+	errno_t rc;
+
+	assert(cfg->batches > 0);
+	if (--cfg->batches > 0 || !cfg->dirty)
+		return EOK;
+
+	rc = inet_cfg_sync(cfg);
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Error saving configuration.");
+		return rc;
+	}
+
+	return EOK;
+}
+
 static errno_t inetcfg_addr_create_static(char *name, inet_naddr_t *naddr,
     sysarg_t link_id, sysarg_t *addr_id)
 {
@@ -247,7 +271,13 @@ static errno_t inetcfg_sroute_create(char *name, inet_naddr_t *dest,
 	sroute->dest = *dest;
 	sroute->router = *router;
 	sroute->name = str_dup(name);
-	inet_sroute_add(sroute);
+
+	rc = inet_sroute_add(sroute);
+	if (rc != EOK) {
+		inet_sroute_delete(sroute);
+		*sroute_id = 0;
+		return rc;
+	}
 
 	*sroute_id = sroute->id;
 
@@ -616,6 +646,34 @@ static void inetcfg_link_get_srv(ipc_call_t *call)
 	async_answer_1(call, retval, linfo.def_mtu);
 }
 
+static void inetcfg_batch_begin_srv(ipc_call_t *call, unsigned *nbatches)
+{
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "inetcfg_batch_begin_srv()");
+
+	rc = inetcfg_batch_begin();
+	if (rc == EOK)
+		++*nbatches;
+	async_answer_0(call, rc);
+}
+
+static void inetcfg_batch_end_srv(ipc_call_t *call, unsigned *nbatches)
+{
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "inetcfg_batch_end_srv()");
+
+	if (*nbatches == 0) {
+		async_answer_0(call, EINVAL);
+		return;
+	}
+
+	--*nbatches;
+	rc = inetcfg_batch_end();
+	async_answer_0(call, rc);
+}
+
 static void inetcfg_link_remove_srv(ipc_call_t *call)
 {
 	sysarg_t link_id;
@@ -796,6 +854,9 @@ static void inetcfg_sroute_get_id_srv(ipc_call_t *call)
 
 void inet_cfg_conn(ipc_call_t *icall, void *arg)
 {
+	/* Batches opened by this client */
+	unsigned nbatches = 0;
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_cfg_conn()");
 
 	/* Accept the connection */
@@ -809,6 +870,11 @@ void inet_cfg_conn(ipc_call_t *icall, void *arg)
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "method %d", (int)method);
 		if (!method) {
 			/* The other side has hung up */
+			while (nbatches > 0) {
+				--nbatches;
+				(void) inetcfg_batch_end();
+			}
+
 			async_answer_0(&call, EOK);
 			return;
 		}
@@ -826,6 +892,12 @@ void inet_cfg_conn(ipc_call_t *icall, void *arg)
 		case INETCFG_ADDR_GET_ID:
 			inetcfg_addr_get_id_srv(&call);
 			break;
+		case INETCFG_BATCH_BEGIN:
+			inetcfg_batch_begin_srv(&call, &nbatches);
+			break;
+		case INETCFG_BATCH_END:
+			inetcfg_batch_end_srv(&call, &nbatches);
+			break;
 		case INETCFG_GET_ADDR_LIST:
 			inetcfg_get_addr_list_srv(&call);
 			break;
@@ -993,6 +1065,14 @@ errno_t inet_cfg_open(const char *cfg_path, inet_cfg_t **rcfg)
 errno_t inet_cfg_sync(inet_cfg_t *cfg)
 {
 	log_msg(LOG_DEFAULT, LVL_NOTE, "inet_cfg_sync(cfg=%p)", cfg);
+
+	/* Saving is deferred until the last batch is closed */
+	if (cfg->batches > 0) {
+		cfg->dirty = true;
+		return EOK;
+	}
+
+	cfg->dirty = false;
 	return inet_cfg_save(cfg->cfg_path);
 }
 
@@ -57,6 +57,7 @@
 #include "inetcfg.h"
 #include "inetping.h"
 #include "inet_link.h"
+#include "ntrans.h"
 #include "reass.h"
 #include "sroute.h"
 
@@ -82,9 +83,11 @@ static const char *inet_cfg_path = "/w/cfg/inetsrv.sif";
 
 static FIBRIL_MUTEX_INITIALIZE(client_list_lock);
 static LIST_INITIALIZE(client_list);
+static inet_reass_t *reass;
 inet_cfg_t *cfg;
 
 static void inet_default_conn(ipc_call_t *, void *);
+static errno_t inet_reass_deliver(void *, inet_dgram_t *, uint8_t);
 
 static errno_t inet_init(void)
 {
@@ -94,6 +97,14 @@ static errno_t inet_init(void)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_init()");
 
+	rc = ntrans_init();
+	if (rc != EOK)
+		return rc;
+
+	rc = inet_reass_create(inet_reass_deliver, NULL, &reass);
+	if (rc != EOK)
+		return rc;
+
 	rc = inet_link_discovery_start();
 	if (rc != EOK)
 		return rc;
@@ -525,6 +536,13 @@ errno_t inet_recv_dgram_local(inet_dgram_t *dgram, uint8_t proto)
 	return inet_ev_recv(client, dgram);
 }
 
+/** Deliver datagram put together by reassembly. */
+static errno_t inet_reass_deliver(void *arg, inet_dgram_t *dgram,
+    uint8_t proto)
+{
+	return inet_recv_dgram_local(dgram, proto);
+}
+
 errno_t inet_recv_packet(inet_packet_t *packet)
 {
 	inet_addrobj_t *addr;
@@ -550,7 +568,7 @@ errno_t inet_recv_packet(inet_packet_t *packet)
 			return inet_recv_dgram_local(&dgram, packet->proto);
 		} else {
 			/* It is a fragment, queue it for reassembly */
-			inet_reass_queue_packet(packet);
+			return inet_reass_queue_packet(reass, packet);
 		}
 	}
 
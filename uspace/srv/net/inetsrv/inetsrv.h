@@ -174,6 +174,10 @@ typedef struct {
 typedef struct {
 	/** Configuration file path */
 	char *cfg_path;
+	/** Number of open configuration batches */
+	unsigned batches;
+	/** Configuration changed while a batch was open */
+	bool dirty;
 } inet_cfg_t;
 
 extern inet_cfg_t *cfg;
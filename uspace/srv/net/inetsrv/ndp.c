@@ -161,24 +161,26 @@ errno_t ndp_translate(addr128_t src_addr, addr128_t ip_addr, eth_addr_t *mac_add
 		return EOK;
 	}
 
-	errno_t rc = ntrans_lookup(ip_addr, mac_addr);
-	if (rc == EOK)
-		return EOK;
-
-	ndp_packet_t packet;
-
-	packet.opcode = ICMPV6_NEIGHBOUR_SOLICITATION;
-	packet.sender_hw_addr = ilink->mac;
-	addr128(src_addr, packet.sender_proto_addr);
-	addr128(ip_addr, packet.solicited_ip);
-	eth_addr_solicited_node(ip_addr, &packet.target_hw_addr);
-	ndp_solicited_node_ip(ip_addr, packet.target_proto_addr);
+	bool solicit;
+	errno_t rc = ntrans_lookup(ip_addr, mac_addr, &solicit);
+	if (solicit) {
+		ndp_packet_t packet;
+
+		packet.opcode = ICMPV6_NEIGHBOUR_SOLICITATION;
+		packet.sender_hw_addr = ilink->mac;
+		addr128(src_addr, packet.sender_proto_addr);
+		addr128(ip_addr, packet.solicited_ip);
+		eth_addr_solicited_node(ip_addr, &packet.target_hw_addr);
+		ndp_solicited_node_ip(ip_addr, packet.target_proto_addr);
+
+		errno_t send_rc = ndp_send_packet(ilink, &packet);
+		if (rc != EOK && send_rc != EOK)
+			return send_rc;
+	}
 
-	rc = ndp_send_packet(ilink, &packet);
-	if (rc != EOK)
+	if (rc != EAGAIN)
 		return rc;
 
-	(void) ntrans_wait_timeout(NDP_REQUEST_TIMEOUT);
-
-	return ntrans_lookup(ip_addr, mac_addr);
+	/* Resolution in progress, wait for the advertisement */
+	return ntrans_wait_timeout(ip_addr, NDP_REQUEST_TIMEOUT, mac_addr);
 }
@@ -35,37 +35,29 @@
  * @brief
  */
 
-#include <adt/list.h>
 #include <errno.h>
-#include <fibril_synch.h>
+#include <inet/addr.h>
 #include <inet/eth_addr.h>
 #include <inet/iplink_srv.h>
+#include <inet/ncache.h>
 #include <stdlib.h>
 #include "ntrans.h"
 
-/** Address translation list (of inet_ntrans_t) */
-static FIBRIL_MUTEX_INITIALIZE(ntrans_list_lock);
-static LIST_INITIALIZE(ntrans_list);
-static FIBRIL_CONDVAR_INITIALIZE(ntrans_cv);
+/** Address translation table */
+static ncache_t *ntrans_cache;
 
-/** Look for address in translation table
+/** Initialize translation table
  *
- * @param ip_addr IPv6 address
+ * @return EOK on success
+ * @return ENOMEM if not enough memory
  *
- * @return inet_ntrans_t with the address on success
- * @return NULL if nothing found
  */
-static inet_ntrans_t *ntrans_find(addr128_t ip_addr)
+errno_t ntrans_init(void)
 {
-	list_foreach(ntrans_list, ntrans_list, inet_ntrans_t, ntrans) {
-		if (addr128_compare(ntrans->ip_addr, ip_addr))
-			return ntrans;
-	}
-
-	return NULL;
+	return ncache_create(&ntrans_cache);
 }
 
-/** Add entry to translation table
+/** Add or confirm entry in translation table
  *
  * @param ip_addr  IPv6 address of the new entry
  * @param mac_addr MAC address of the new entry
@@ -76,28 +68,10 @@ static inet_ntrans_t *ntrans_find(addr128_t ip_addr)
  */
 errno_t ntrans_add(addr128_t ip_addr, eth_addr_t *mac_addr)
 {
-	inet_ntrans_t *ntrans;
-	inet_ntrans_t *prev;
-
-	ntrans = calloc(1, sizeof(inet_ntrans_t));
-	if (ntrans == NULL)
-		return ENOMEM;
+	inet_addr_t addr;
 
-	addr128(ip_addr, ntrans->ip_addr);
-	ntrans->mac_addr = *mac_addr;
-
-	fibril_mutex_lock(&ntrans_list_lock);
-	prev = ntrans_find(ip_addr);
-	if (prev != NULL) {
-		list_remove(&prev->ntrans_list);
-		free(prev);
-	}
-
-	list_append(&ntrans->ntrans_list, &ntrans_list);
-	fibril_mutex_unlock(&ntrans_list_lock);
-	fibril_condvar_broadcast(&ntrans_cv);
-
-	return EOK;
+	inet_addr_set6(ip_addr, &addr);
+	return ncache_update(ntrans_cache, &addr, mac_addr, NULL);
 }
 
 /** Remove entry from translation table
@@ -110,61 +84,54 @@ errno_t ntrans_add(addr128_t ip_addr, eth_addr_t *mac_addr)
  */
 errno_t ntrans_remove(addr128_t ip_addr)
 {
-	inet_ntrans_t *ntrans;
-
-	fibril_mutex_lock(&ntrans_list_lock);
-	ntrans = ntrans_find(ip_addr);
-	if (ntrans == NULL) {
-		fibril_mutex_unlock(&ntrans_list_lock);
-		return ENOENT;
-	}
+	inet_addr_t addr;
 
-	list_remove(&ntrans->ntrans_list);
-	fibril_mutex_unlock(&ntrans_list_lock);
-	free(ntrans);
-
-	return EOK;
+	inet_addr_set6(ip_addr, &addr);
+	return ncache_remove(ntrans_cache, &addr);
 }
 
 /** Translate IPv6 address to MAC address using the translation table
+ *
+ * If the address is not known, resolution is started and @a solicit
+ * is set: the caller should send a neighbor solicitation. It is also
+ * set if a stale entry should be refreshed.
  *
  * @param ip_addr  IPv6 address to be translated
  * @param mac_addr MAC address to be assigned
+ * @param solicit  Place to store @c true if a neighbor solicitation
+ *                 should be sent
  *
  * @return EOK on success
- * @return ENOENT when no such address found
+ * @return EAGAIN when resolution is in progress
+ * @return ENOENT when resolution failed recently
+ * @return ENOMEM if not enough memory
  *
  */
-errno_t ntrans_lookup(addr128_t ip_addr, eth_addr_t *mac_addr)
+errno_t ntrans_lookup(addr128_t ip_addr, eth_addr_t *mac_addr, bool *solicit)
 {
-	fibril_mutex_lock(&ntrans_list_lock);
-	inet_ntrans_t *ntrans = ntrans_find(ip_addr);
-	if (ntrans == NULL) {
-		fibril_mutex_unlock(&ntrans_list_lock);
-		return ENOENT;
-	}
+	inet_addr_t addr;
 
-	fibril_mutex_unlock(&ntrans_list_lock);
-	*mac_addr = ntrans->mac_addr;
-	return EOK;
+	inet_addr_set6(ip_addr, &addr);
+	return ncache_resolve(ntrans_cache, &addr, mac_addr, solicit);
 }
 
-/** Wait on translation table CV for some time
+/** Wait for resolution of address
  *
- * @param timeout Timeout in microseconds
+ * @param ip_addr  IPv6 address to be translated
+ * @param timeout  Timeout in microseconds
+ * @param mac_addr MAC address to be assigned
  *
- * @return EOK if woken up by another fibril
- * @return ETIMEOUT if timed out
+ * @return EOK on success
+ * @return ENOENT if the address was not resolved
  *
  */
-errno_t ntrans_wait_timeout(usec_t timeout)
+errno_t ntrans_wait_timeout(addr128_t ip_addr, usec_t timeout,
+    eth_addr_t *mac_addr)
 {
-	fibril_mutex_lock(&ntrans_list_lock);
-	errno_t rc = fibril_condvar_wait_timeout(&ntrans_cv, &ntrans_list_lock,
-	    timeout);
-	fibril_mutex_unlock(&ntrans_list_lock);
+	inet_addr_t addr;
 
-	return rc;
+	inet_addr_set6(ip_addr, &addr);
+	return ncache_wait(ntrans_cache, &addr, timeout, mac_addr);
 }
 
 /** @}
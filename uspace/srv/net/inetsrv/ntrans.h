@@ -41,18 +41,13 @@
 #include <inet/addr.h>
 #include <inet/eth_addr.h>
 #include <inet/iplink_srv.h>
+#include <stdbool.h>
 
-/** Address translation table element */
-typedef struct {
-	link_t ntrans_list;
-	addr128_t ip_addr;
-	eth_addr_t mac_addr;
-} inet_ntrans_t;
-
+extern errno_t ntrans_init(void);
 extern errno_t ntrans_add(addr128_t, eth_addr_t *);
 extern errno_t ntrans_remove(addr128_t);
-extern errno_t ntrans_lookup(addr128_t, eth_addr_t *);
-extern errno_t ntrans_wait_timeout(usec_t);
+extern errno_t ntrans_lookup(addr128_t, eth_addr_t *, bool *);
+extern errno_t ntrans_wait_timeout(addr128_t, usec_t, eth_addr_t *);
 
 #endif
 
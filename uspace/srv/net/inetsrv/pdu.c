@@ -34,6 +34,7 @@
  * @brief
  */
 
+#include <adt/checksum.h>
 #include <align.h>
 #include <bitops.h>
 #include <byteorder.h>
@@ -48,42 +49,6 @@
 #include "inet_std.h"
 #include "pdu.h"
 
-/** One's complement addition.
- *
- * Result is a + b + carry.
- */
-static uint16_t inet_ocadd16(uint16_t a, uint16_t b)
-{
-	uint32_t s;
-
-	s = (uint32_t)a + (uint32_t)b;
-	return (s & 0xffff) + (s >> 16);
-}
-
-uint16_t inet_checksum_calc(uint16_t ivalue, void *data, size_t size)
-{
-	uint16_t sum;
-	uint16_t w;
-	size_t words, i;
-	uint8_t *bdata;
-
-	sum = ~ivalue;
-	words = size / 2;
-	bdata = (uint8_t *)data;
-
-	for (i = 0; i < words; i++) {
-		w = ((uint16_t)bdata[2 * i] << 8) | bdata[2 * i + 1];
-		sum = inet_ocadd16(sum, w);
-	}
-
-	if (size % 2 != 0) {
-		w = ((uint16_t)bdata[2 * words] << 8);
-		sum = inet_ocadd16(sum, w);
-	}
-
-	return ~sum;
-}
-
 /** Encode IPv4 PDU.
  *
  * Encode internet packet into PDU (serialized form). Will encode a
@@ -162,8 +127,7 @@ errno_t inet_pdu_encode(inet_packet_t *packet, addr32_t src, addr32_t dest,
 	hdr->dest_addr = host2uint32_t_be(dest);
 
 	/* Compute checksum */
-	uint16_t chksum = inet_checksum_calc(INET_CHECKSUM_INIT,
-	    (void *) hdr, hdr_size);
+	uint16_t chksum = compute_ocsum(hdr, hdr_size);
 	hdr->chksum = host2uint16_t_be(chksum);
 
 	/* Copy payload */
@@ -514,12 +478,12 @@ errno_t ndp_pdu_encode(ndp_packet_t *ndp, inet_dgram_t *dgram)
 	memset(phdr.zeroes, 0, 3);
 	phdr.next = IP_PROTO_ICMPV6;
 
-	uint16_t cs_phdr =
-	    inet_checksum_calc(INET_CHECKSUM_INIT, &phdr,
-	    sizeof(icmpv6_phdr_t));
+	ocsum_t cs;
+	ocsum_init(&cs);
+	ocsum_add(&cs, &phdr, sizeof(icmpv6_phdr_t));
+	ocsum_add(&cs, dgram->data, dgram->size);
 
-	uint16_t cs_all = inet_checksum_calc(cs_phdr, dgram->data,
-	    dgram->size);
+	uint16_t cs_all = ocsum_get(&cs);
 
 	icmpv6->checksum = host2uint16_t_be(cs_all);
 
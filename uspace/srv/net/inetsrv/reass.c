@@ -32,330 +32,659 @@
 /**
  * @file
  * @brief Datagram reassembly.
+ *
+ * Datagrams being reassembled are hashed by (source address, destination
+ * address, protocol, identification). The fragments of each datagram are
+ * kept in an ordered dictionary by offset. They never overlap: only the
+ * parts of an incoming fragment that fill gaps are stored, so duplicate
+ * data costs no memory and completeness is a matter of comparing
+ * the number of bytes received with the datagram size.
+ *
+ * Datagrams that are not completed within a timeout are dropped. Memory
+ * used by all datagrams being reassembled is limited. When the limit
+ * would be exceeded, the oldest datagrams are dropped.
  */
 
+#include <adt/hash.h>
+#include <adt/hash_table.h>
+#include <adt/list.h>
+#include <adt/odict.h>
 #include <errno.h>
 #include <fibril_synch.h>
 #include <io/log.h>
 #include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include "inetsrv.h"
 #include "inet_std.h"
 #include "reass.h"
 
-/** Datagram being reassembled.
+/** Maximum size of reassembled datagram */
+#define REASS_DGRAM_MAX \
+	(FRAG_OFFS_UNIT * (1 << (FF_FRAGOFF_h - FF_FRAGOFF_l + 1)))
+
+/** Datagram identification.
  *
- * Uniquely identified by (source address, destination address, protocol,
- * identification) per RFC 791 sec. 2.3 / Fragmentation.
+ * Uniquely identifies a datagram per RFC 791 sec. 2.3 / Fragmentation.
  */
 typedef struct {
-	link_t map_link;
-	/** List of fragments, @c reass_frag_t */
-	list_t frags;
+	inet_addr_t src;
+	inet_addr_t dest;
+	uint8_t proto;
+	uint32_t ident;
+} reass_key_t;
+
+/** Datagram being reassembled. */
+typedef struct {
+	/** Link in inet_reass_t.dgrams */
+	ht_link_t lmap;
+	/** Link in inet_reass_t.lru */
+	link_t llru;
+	/** Datagram identification */
+	reass_key_t key;
+	/** Fragments ordered by offset (of reass_frag_t) */
+	odict_t frags;
+	/** Number of data bytes received */
+	size_t covered;
+	/** Datagram size, valid if @c have_last */
+	size_t total;
+	/** Last fragment has been received */
+	bool have_last;
+	/** Link the first fragment came from */
+	service_id_t link_id;
+	/** Type of service */
+	uint8_t tos;
+	/** Time when the datagram is dropped (usec) */
+	usec_t expires;
+	/** Memory used by the datagram (bytes) */
+	size_t mem;
 } reass_dgram_t;
 
-/** One datagram fragment */
+/** Data of a datagram between two offsets */
 typedef struct {
-	link_t dgram_link;
-	inet_packet_t packet;
+	/** Link in reass_dgram_t.frags */
+	odlink_t ldgram;
+	/** Offset in datagram */
+	size_t offs;
+	/** Size of data */
+	size_t size;
+	/** Data */
+	uint8_t data[];
 } reass_frag_t;
 
-/** Datagram map, list of reass_dgram_t */
-static LIST_INITIALIZE(reass_dgram_map);
-/** Protects access to @c reass_dgram_map */
-static FIBRIL_MUTEX_INITIALIZE(reass_dgram_map_lock);
-
-static reass_dgram_t *reass_dgram_new(void);
-static reass_dgram_t *reass_dgram_get(inet_packet_t *);
-static errno_t reass_dgram_insert_frag(reass_dgram_t *, inet_packet_t *);
-static bool reass_dgram_complete(reass_dgram_t *);
-static void reass_dgram_remove(reass_dgram_t *);
-static errno_t reass_dgram_deliver(reass_dgram_t *);
 static void reass_dgram_destroy(reass_dgram_t *);
 
-/** Queue packet for datagram reassembly.
+static size_t reass_addr_hash(const inet_addr_t *addr)
+{
+	size_t hash = 0;
+	size_t i;
+
+	switch (addr->version) {
+	case ip_v4:
+		return addr->addr;
+	case ip_v6:
+		for (i = 0; i < 16; i += 4) {
+			hash = hash_combine(hash, ((uint32_t) addr->addr6[i] << 24) |
+			    ((uint32_t) addr->addr6[i + 1] << 16) |
+			    ((uint32_t) addr->addr6[i + 2] << 8) |
+			    addr->addr6[i + 3]);
+		}
+		return hash;
+	default:
+		return 0;
+	}
+}
+
+static size_t reass_key_hash_fn(const reass_key_t *key)
+{
+	size_t hash;
+
+	hash = reass_addr_hash(&key->src);
+	hash = hash_combine(hash, reass_addr_hash(&key->dest));
+	hash = hash_combine(hash, key->proto);
+	hash = hash_combine(hash, key->ident);
+	return hash_mix(hash);
+}
+
+static size_t reass_hash(const ht_link_t *item)
+{
+	reass_dgram_t *rdg = hash_table_get_inst(item, reass_dgram_t, lmap);
+
+	return reass_key_hash_fn(&rdg->key);
+}
+
+static size_t reass_key_hash(const void *key)
+{
+	return reass_key_hash_fn((const reass_key_t *) key);
+}
+
+static bool reass_key_equal_fn(const reass_key_t *a, const reass_key_t *b)
+{
+	return a->proto == b->proto && a->ident == b->ident &&
+	    inet_addr_compare(&a->src, &b->src) &&
+	    inet_addr_compare(&a->dest, &b->dest);
+}
+
+static bool reass_key_equal(const void *key, size_t hash,
+    const ht_link_t *item)
+{
+	reass_dgram_t *rdg = hash_table_get_inst(item, reass_dgram_t, lmap);
+
+	return reass_key_equal_fn((const reass_key_t *) key, &rdg->key);
+}
+
+static bool reass_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	reass_dgram_t *rdg1 = hash_table_get_inst(item1, reass_dgram_t, lmap);
+	reass_dgram_t *rdg2 = hash_table_get_inst(item2, reass_dgram_t, lmap);
+
+	return reass_key_equal_fn(&rdg1->key, &rdg2->key);
+}
+
+static const hash_table_ops_t reass_ops = {
+	.hash = reass_hash,
+	.key_hash = reass_key_hash,
+	.key_equal = reass_key_equal,
+	.equal = reass_equal,
+	.remove_callback = NULL
+};
+
+/** Get key function for fragment dictionary */
+static void *reass_frag_getkey(odlink_t *odlink)
+{
+	return &odict_get_instance(odlink, reass_frag_t, ldgram)->offs;
+}
+
+/** Compare function for fragment dictionary */
+static int reass_frag_cmp(void *a, void *b)
+{
+	size_t oa = *(size_t *) a;
+	size_t ob = *(size_t *) b;
+
+	if (oa < ob)
+		return -1;
+	if (oa > ob)
+		return 1;
+	return 0;
+}
+
+/** Return current uptime in microseconds. */
+static usec_t reass_uptime(void)
+{
+	struct timespec ts;
+
+	getuptime(&ts);
+	return SEC2USEC(ts.tv_sec) + NSEC2USEC(ts.tv_nsec);
+}
+
+static void reass_timer(void *arg)
+{
+	inet_reass_t *reass = (inet_reass_t *) arg;
+
+	inet_reass_expire(reass);
+	fibril_timer_set(reass->timer, REASS_EXPIRE_INTERVAL, reass_timer,
+	    reass);
+}
+
+/** Create datagram reassembly table.
  *
- * @param packet	Packet
- * @return		EOK on success or ENOMEM.
+ * @param deliver Function called to deliver a reassembled datagram
+ * @param arg Argument to @a deliver
+ * @param rreass Place to store pointer to new reassembly table
+ * @return EOK on success, ENOMEM if out of memory
  */
-errno_t inet_reass_queue_packet(inet_packet_t *packet)
+errno_t inet_reass_create(inet_reass_deliver_t deliver, void *arg,
+    inet_reass_t **rreass)
 {
-	reass_dgram_t *rdg;
-	errno_t rc;
+	inet_reass_t *reass;
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_reass_queue_packet()");
+	reass = calloc(1, sizeof(inet_reass_t));
+	if (reass == NULL)
+		return ENOMEM;
 
-	fibril_mutex_lock(&reass_dgram_map_lock);
+	fibril_mutex_initialize(&reass->lock);
+	list_initialize(&reass->lru);
 
-	/* Get existing or new datagram */
-	rdg = reass_dgram_get(packet);
-	if (rdg == NULL) {
-		/* Only happens when we are out of memory */
-		fibril_mutex_unlock(&reass_dgram_map_lock);
-		log_msg(LOG_DEFAULT, LVL_DEBUG, "Allocation failed, packet dropped.");
+	if (!hash_table_create(&reass->dgrams, 0, 0, &reass_ops)) {
+		free(reass);
 		return ENOMEM;
 	}
 
-	/* Insert fragment into the datagram */
-	rc = reass_dgram_insert_frag(rdg, packet);
-	if (rc != EOK)
+	reass->timer = fibril_timer_create(NULL);
+	if (reass->timer == NULL) {
+		hash_table_destroy(&reass->dgrams);
+		free(reass);
 		return ENOMEM;
+	}
 
-	/* Check if datagram is complete */
-	if (reass_dgram_complete(rdg)) {
-		/* Remove it from the map */
-		reass_dgram_remove(rdg);
-		fibril_mutex_unlock(&reass_dgram_map_lock);
+	reass->mem_max = REASS_MEM_MAX;
+	reass->timeout = REASS_TIMEOUT;
+	reass->uptime = reass_uptime;
+	reass->deliver = deliver;
+	reass->arg = arg;
 
-		/* Deliver complete datagram */
-		rc = reass_dgram_deliver(rdg);
-		reass_dgram_destroy(rdg);
-		return rc;
-	}
+	fibril_timer_set(reass->timer, REASS_EXPIRE_INTERVAL, reass_timer,
+	    reass);
 
-	fibril_mutex_unlock(&reass_dgram_map_lock);
+	*rreass = reass;
 	return EOK;
 }
 
-/** Get datagram reassembly structure for packet.
+/** Remove datagram from reassembly table.
  *
- * @param packet	Packet
- * @return		Datagram reassembly structure matching @a packet
+ * @param reass Reassembly table
+ * @param rdg Datagram
  */
-static reass_dgram_t *reass_dgram_get(inet_packet_t *packet)
+static void reass_dgram_remove(inet_reass_t *reass, reass_dgram_t *rdg)
 {
-	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
+	assert(fibril_mutex_is_locked(&reass->lock));
+
+	hash_table_remove_item(&reass->dgrams, &rdg->lmap);
+	list_remove(&rdg->llru);
+	reass->mem -= rdg->mem;
+}
 
-	list_foreach(reass_dgram_map, map_link, reass_dgram_t, rdg) {
-		link_t *f1_link = list_first(&rdg->frags);
-		assert(f1_link != NULL);
+/** Destroy datagram reassembly table.
+ *
+ * Datagrams that are being reassembled are dropped.
+ *
+ * @param reass Reassembly table
+ */
+void inet_reass_destroy(inet_reass_t *reass)
+{
+	reass_dgram_t *rdg;
 
-		reass_frag_t *f1 = list_get_instance(f1_link, reass_frag_t,
-		    dgram_link);
+	if (reass == NULL)
+		return;
 
-		if ((inet_addr_compare(&f1->packet.src, &packet->src)) &&
-		    (inet_addr_compare(&f1->packet.dest, &packet->dest)) &&
-		    (f1->packet.proto == packet->proto) &&
-		    (f1->packet.ident == packet->ident)) {
-			/* Match */
-			return rdg;
-		}
+	(void) fibril_timer_clear(reass->timer);
+	fibril_timer_destroy(reass->timer);
+
+	fibril_mutex_lock(&reass->lock);
+	while (!list_empty(&reass->lru)) {
+		rdg = list_get_instance(list_first(&reass->lru),
+		    reass_dgram_t, llru);
+		reass_dgram_remove(reass, rdg);
+		reass_dgram_destroy(rdg);
 	}
+	fibril_mutex_unlock(&reass->lock);
 
-	/* No existing reassembly structure. Create a new one. */
-	return reass_dgram_new();
+	hash_table_destroy(&reass->dgrams);
+	free(reass);
 }
 
-/** Create new datagram reassembly structure.
+/** Drop datagrams that timed out.
+ *
+ * Datagrams expire in the order they were created, so only the head
+ * of the LRU list needs to be examined.
  *
- * @return New datagram reassembly structure.
+ * @param reass Reassembly table
+ * @param now Current time (usec)
  */
-static reass_dgram_t *reass_dgram_new(void)
+static void reass_expire_locked(inet_reass_t *reass, usec_t now)
 {
 	reass_dgram_t *rdg;
+	link_t *link;
 
-	rdg = calloc(1, sizeof(reass_dgram_t));
-	if (rdg == NULL)
-		return NULL;
+	assert(fibril_mutex_is_locked(&reass->lock));
 
-	list_append(&rdg->map_link, &reass_dgram_map);
-	list_initialize(&rdg->frags);
+	while ((link = list_first(&reass->lru)) != NULL) {
+		rdg = list_get_instance(link, reass_dgram_t, llru);
+		if (rdg->expires > now)
+			break;
 
-	return rdg;
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Reassembly timed out, "
+		    "datagram dropped.");
+		reass_dgram_remove(reass, rdg);
+		reass_dgram_destroy(rdg);
+		++reass->stats.timeouts;
+	}
 }
 
-static reass_frag_t *reass_frag_new(void)
+/** Drop datagrams that timed out.
+ *
+ * @param reass Reassembly table
+ */
+void inet_reass_expire(inet_reass_t *reass)
 {
-	reass_frag_t *frag;
+	usec_t now;
 
-	frag = calloc(1, sizeof(reass_frag_t));
-	if (frag == NULL)
-		return NULL;
-
-	link_initialize(&frag->dgram_link);
+	now = reass->uptime();
 
-	return frag;
+	fibril_mutex_lock(&reass->lock);
+	reass_expire_locked(reass, now);
+	fibril_mutex_unlock(&reass->lock);
 }
 
-static errno_t reass_dgram_insert_frag(reass_dgram_t *rdg, inet_packet_t *packet)
+/** Make room for new data within the memory budget.
+ *
+ * Drops the oldest datagrams other than @a keep.
+ *
+ * @param reass Reassembly table
+ * @param keep Datagram that must not be dropped or @c NULL
+ * @param size Number of bytes needed
+ * @return EOK on success, ELIMIT if not enough memory can be freed
+ */
+static errno_t reass_reserve(inet_reass_t *reass, reass_dgram_t *keep,
+    size_t size)
 {
-	reass_frag_t *frag;
-	void *data_copy;
+	reass_dgram_t *rdg;
 	link_t *link;
 
-	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
+	assert(fibril_mutex_is_locked(&reass->lock));
 
-	frag = reass_frag_new();
+	link = list_first(&reass->lru);
+	while (reass->mem + size > reass->mem_max) {
+		if (link == NULL)
+			return ELIMIT;
 
-	/* Clone the packet */
+		rdg = list_get_instance(link, reass_dgram_t, llru);
+		link = list_next(link, &reass->lru);
 
-	data_copy = malloc(packet->size);
-	if (data_copy == NULL) {
-		free(frag);
-		return ENOMEM;
+		if (rdg == keep)
+			continue;
+
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Reassembly memory exhausted, "
+		    "datagram dropped.");
+		reass_dgram_remove(reass, rdg);
+		reass_dgram_destroy(rdg);
+		++reass->stats.evicted;
 	}
 
-	memcpy(data_copy, packet->data, packet->size);
+	return EOK;
+}
 
-	frag->packet = *packet;
-	frag->packet.data = data_copy;
+/** Get datagram reassembly structure for packet.
+ *
+ * Creates a new one if there is none yet.
+ *
+ * @param reass Reassembly table
+ * @param packet Packet
+ * @param now Current time (usec)
+ * @param rrdg Place to store datagram reassembly structure
+ * @return EOK on success, ENOMEM if out of memory, ELIMIT if
+ *         over memory budget
+ */
+static errno_t reass_dgram_get(inet_reass_t *reass, inet_packet_t *packet,
+    usec_t now, reass_dgram_t **rrdg)
+{
+	reass_dgram_t *rdg;
+	reass_key_t key;
+	ht_link_t *link;
+	errno_t rc;
 
-	/*
-	 * XXX Make resource-consuming attacks harder, eliminate any duplicate
-	 * data immediately. Possibly eliminate redundant packet headers.
-	 */
+	assert(fibril_mutex_is_locked(&reass->lock));
 
-	/*
-	 * Insert into the list, which is sorted by offs member ascending.
-	 */
+	memset(&key, 0, sizeof(key));
+	key.src = packet->src;
+	key.dest = packet->dest;
+	key.proto = packet->proto;
+	key.ident = packet->ident;
 
-	link = list_first(&rdg->frags);
-	while (link != NULL) {
-		reass_frag_t *qf = list_get_instance(link, reass_frag_t,
-		    dgram_link);
+	link = hash_table_find(&reass->dgrams, &key);
+	if (link != NULL) {
+		*rrdg = hash_table_get_inst(link, reass_dgram_t, lmap);
+		return EOK;
+	}
 
-		if (qf->packet.offs >= packet->offs)
-			break;
+	rc = reass_reserve(reass, NULL, sizeof(reass_dgram_t));
+	if (rc != EOK)
+		return rc;
 
-		link = list_next(link, &rdg->frags);
-	}
+	rdg = calloc(1, sizeof(reass_dgram_t));
+	if (rdg == NULL)
+		return ENOMEM;
+
+	rdg->key = key;
+	odict_initialize(&rdg->frags, reass_frag_getkey, reass_frag_cmp);
+	rdg->link_id = packet->link_id;
+	rdg->tos = packet->tos;
+	rdg->expires = now + reass->timeout;
+	rdg->mem = sizeof(reass_dgram_t);
 
-	if (link != NULL)
-		list_insert_after(&frag->dgram_link, link);
-	else
-		list_append(&frag->dgram_link, &rdg->frags);
+	hash_table_insert(&reass->dgrams, &rdg->lmap);
+	list_append(&rdg->llru, &reass->lru);
+	reass->mem += rdg->mem;
 
+	*rrdg = rdg;
 	return EOK;
 }
 
-/** Check if datagram is complete.
+/** Add data to datagram.
  *
- * @param rdg		Datagram reassembly structure
- * @return		@c true if complete, @c false if not
+ * @param reass Reassembly table
+ * @param rdg Datagram
+ * @param offs Offset in datagram
+ * @param data Data
+ * @param size Size of data
+ * @return EOK on success, ENOMEM if out of memory, ELIMIT if over
+ *         memory budget
  */
-static bool reass_dgram_complete(reass_dgram_t *rdg)
+static errno_t reass_frag_add(inet_reass_t *reass, reass_dgram_t *rdg,
+    size_t offs, const uint8_t *data, size_t size)
 {
-	reass_frag_t *frag, *prev;
-	link_t *link;
+	reass_frag_t *frag;
+	size_t fsize;
+	errno_t rc;
 
-	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
-	assert(!list_empty(&rdg->frags));
+	fsize = sizeof(reass_frag_t) + size;
 
-	link = list_first(&rdg->frags);
-	assert(link != NULL);
+	rc = reass_reserve(reass, rdg, fsize);
+	if (rc != EOK)
+		return rc;
 
-	frag = list_get_instance(link, reass_frag_t,
-	    dgram_link);
+	frag = malloc(fsize);
+	if (frag == NULL)
+		return ENOMEM;
 
-	/* First fragment must be at offset zero */
-	if (frag->packet.offs != 0)
-		return false;
+	odlink_initialize(&frag->ldgram);
+	frag->offs = offs;
+	frag->size = size;
+	memcpy(frag->data, data, size);
 
-	prev = frag;
+	odict_insert(&frag->ldgram, &rdg->frags, NULL);
+	rdg->covered += size;
+	rdg->mem += fsize;
+	reass->mem += fsize;
+	return EOK;
+}
 
-	while (true) {
-		link = list_next(link, &rdg->frags);
-		if (link == NULL)
+/** Insert fragment into datagram.
+ *
+ * Only the parts of the fragment not received yet are stored.
+ *
+ * @param reass Reassembly table
+ * @param rdg Datagram
+ * @param packet Fragment
+ * @return EOK on success, EINVAL if the fragment does not match
+ *         the datagram size, ENOMEM if out of memory, ELIMIT if over
+ *         memory budget
+ */
+static errno_t reass_dgram_insert_frag(inet_reass_t *reass,
+    reass_dgram_t *rdg, inet_packet_t *packet)
+{
+	const uint8_t *data = (const uint8_t *) packet->data;
+	size_t start = packet->offs;
+	size_t end = packet->offs + packet->size;
+	reass_frag_t *frag;
+	odlink_t *link;
+	size_t pos;
+	size_t gap_end;
+	errno_t rc;
+
+	assert(fibril_mutex_is_locked(&reass->lock));
+
+	/* The datagram size must be consistent among all fragments */
+	if (!packet->mf) {
+		if (rdg->have_last && rdg->total != end)
+			return EINVAL;
+
+		link = odict_last(&rdg->frags);
+		if (link != NULL) {
+			frag = odict_get_instance(link, reass_frag_t, ldgram);
+			if (frag->offs + frag->size > end)
+				return EINVAL;
+		}
+	} else if (rdg->have_last && end > rdg->total) {
+		return EINVAL;
+	}
+
+	/* Find the fragment that may overlap the beginning */
+	link = odict_find_leq(&rdg->frags, &start, NULL);
+	if (link == NULL)
+		link = odict_first(&rdg->frags);
+
+	/* Store the parts that fill gaps between existing fragments */
+	pos = start;
+	while (pos < end) {
+		frag = link != NULL ?
+		    odict_get_instance(link, reass_frag_t, ldgram) : NULL;
+
+		if (frag != NULL && frag->offs + frag->size <= pos) {
+			link = odict_next(link, &rdg->frags);
+			continue;
+		}
+
+		gap_end = frag != NULL ? min(end, frag->offs) : end;
+		if (gap_end > pos) {
+			rc = reass_frag_add(reass, rdg, pos, data + (pos - start),
+			    gap_end - pos);
+			if (rc != EOK)
+				return rc;
+		}
+
+		if (frag == NULL)
 			break;
 
-		/* Each next fragment must follow immediately or overlap */
-		frag = list_get_instance(link, reass_frag_t, dgram_link);
-		if (frag->packet.offs > prev->packet.offs + prev->packet.size)
-			return false;
+		pos = max(pos, frag->offs + frag->size);
+		link = odict_next(link, &rdg->frags);
+	}
 
-		/* No more fragments - datagram is complete */
-		if (!frag->packet.mf)
-			return true;
+	if (!packet->mf) {
+		rdg->have_last = true;
+		rdg->total = end;
+	}
 
-		prev = frag;
+	if (start == 0) {
+		rdg->link_id = packet->link_id;
+		rdg->tos = packet->tos;
 	}
 
-	return false;
+	return EOK;
 }
 
-/** Remove datagram from reassembly map.
+/** Check if datagram is complete.
  *
  * @param rdg		Datagram reassembly structure
+ * @return		@c true if complete, @c false if not
  */
-static void reass_dgram_remove(reass_dgram_t *rdg)
+static bool reass_dgram_complete(reass_dgram_t *rdg)
 {
-	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
-	list_remove(&rdg->map_link);
+	return rdg->have_last && rdg->covered == rdg->total;
 }
 
 /** Deliver complete datagram.
  *
+ * @param reass		Reassembly table
  * @param rdg		Datagram reassembly structure.
  */
-static errno_t reass_dgram_deliver(reass_dgram_t *rdg)
+static errno_t reass_dgram_deliver(inet_reass_t *reass, reass_dgram_t *rdg)
 {
-	size_t dgram_size;
-	size_t fragoff_limit;
 	inet_dgram_t dgram;
-	uint8_t proto;
 	reass_frag_t *frag;
+	odlink_t *link;
 	errno_t rc;
 
-	/*
-	 * Potentially there could be something beyond the first packet
-	 * that has !MF. Make sure we ignore that.
-	 */
-	frag = NULL;
-	list_foreach(rdg->frags, dgram_link, reass_frag_t, cfrag) {
-		if (!cfrag->packet.mf) {
-			frag = cfrag;
-			break;
-		}
+	dgram.data = malloc(max(rdg->total, 1));
+	if (dgram.data == NULL)
+		return ENOMEM;
+
+	/* XXX What if different fragments came from different link? */
+	dgram.iplink = rdg->link_id;
+	dgram.size = rdg->total;
+	dgram.src = rdg->key.src;
+	dgram.dest = rdg->key.dest;
+	dgram.tos = rdg->tos;
+
+	/* Pull together data from individual fragments */
+	link = odict_first(&rdg->frags);
+	while (link != NULL) {
+		frag = odict_get_instance(link, reass_frag_t, ldgram);
+		memcpy((uint8_t *) dgram.data + frag->offs, frag->data,
+		    frag->size);
+		link = odict_next(link, &rdg->frags);
 	}
 
-	assert(frag != NULL);
-	assert(!frag->packet.mf);
+	rc = reass->deliver(reass->arg, &dgram, rdg->key.proto);
+	free(dgram.data);
+	return rc;
+}
 
-	dgram_size = frag->packet.offs + frag->packet.size;
+/** Queue packet for datagram reassembly.
+ *
+ * @param reass		Reassembly table
+ * @param packet	Packet
+ * @return		EOK on success, ENOMEM if out of memory, ELIMIT if
+ *			the datagram is too large or memory budget is
+ *			exhausted, EINVAL if fragments are inconsistent
+ */
+errno_t inet_reass_queue_packet(inet_reass_t *reass, inet_packet_t *packet)
+{
+	reass_dgram_t *rdg;
+	usec_t now;
+	errno_t rc;
 
-	/* Upper bound for fragment offset field */
-	fragoff_limit = 1 << (FF_FRAGOFF_h - FF_FRAGOFF_l + 1);
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_reass_queue_packet()");
 
 	/* Verify that total size of datagram is within reasonable bounds */
-	if (dgram_size > FRAG_OFFS_UNIT * fragoff_limit)
+	if (packet->offs + packet->size > REASS_DGRAM_MAX)
 		return ELIMIT;
 
-	dgram.data = calloc(dgram_size, 1);
-	if (dgram.data == NULL)
-		return ENOMEM;
-
-	/* XXX What if different fragments came from different link? */
-	dgram.iplink = frag->packet.link_id;
-	dgram.size = dgram_size;
-	dgram.src = frag->packet.src;
-	dgram.dest = frag->packet.dest;
-	dgram.tos = frag->packet.tos;
-	proto = frag->packet.proto;
-
-	/* Pull together data from individual fragments */
+	now = reass->uptime();
 
-	size_t doffs = 0;
+	fibril_mutex_lock(&reass->lock);
 
-	list_foreach(rdg->frags, dgram_link, reass_frag_t, cfrag) {
-		size_t cb, ce;
+	reass_expire_locked(reass, now);
 
-		cb = max(doffs, cfrag->packet.offs);
-		ce = min(dgram_size, cfrag->packet.offs + cfrag->packet.size);
+	/* Get existing or new datagram */
+	rc = reass_dgram_get(reass, packet, now, &rdg);
+	if (rc != EOK) {
+		fibril_mutex_unlock(&reass->lock);
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Allocation failed, packet dropped.");
+		return rc;
+	}
 
-		if (ce > cb) {
-			memcpy(dgram.data + cb,
-			    cfrag->packet.data + cb - cfrag->packet.offs,
-			    ce - cb);
+	/* Insert fragment into the datagram */
+	rc = reass_dgram_insert_frag(reass, rdg, packet);
+	if (rc != EOK) {
+		if (rc == EINVAL || odict_empty(&rdg->frags)) {
+			if (rc == EINVAL)
+				++reass->stats.invalid;
+			reass_dgram_remove(reass, rdg);
+			reass_dgram_destroy(rdg);
 		}
 
-		if (!cfrag->packet.mf)
-			break;
+		fibril_mutex_unlock(&reass->lock);
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Fragment dropped.");
+		return rc;
 	}
 
-	rc = inet_recv_dgram_local(&dgram, proto);
-	free(dgram.data);
+	/* Check if datagram is complete */
+	if (!reass_dgram_complete(rdg)) {
+		fibril_mutex_unlock(&reass->lock);
+		return EOK;
+	}
+
+	/* Remove it from the table */
+	reass_dgram_remove(reass, rdg);
+	++reass->stats.delivered;
+	fibril_mutex_unlock(&reass->lock);
+
+	/* Deliver complete datagram */
+	rc = reass_dgram_deliver(reass, rdg);
+	reass_dgram_destroy(rdg);
 	return rc;
 }
 
@@ -365,16 +694,14 @@ static errno_t reass_dgram_deliver(reass_dgram_t *rdg)
  */
 static void reass_dgram_destroy(reass_dgram_t *rdg)
 {
-	while (!list_empty(&rdg->frags)) {
-		link_t *flink = list_first(&rdg->frags);
-		reass_frag_t *frag = list_get_instance(flink, reass_frag_t,
-		    dgram_link);
-
-		list_remove(&frag->dgram_link);
-		free(frag->packet.data);
-		free(frag);
+	odlink_t *link;
+
+	while ((link = odict_first(&rdg->frags)) != NULL) {
+		odict_remove(link);
+		free(odict_get_instance(link, reass_frag_t, ldgram));
 	}
 
+	odict_finalize(&rdg->frags);
 	free(rdg);
 }
 
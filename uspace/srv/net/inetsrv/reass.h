@@ -31,15 +31,72 @@
  */
 /**
  * @file
- * @brief
+ * @brief Datagram reassembly.
  */
 
 #ifndef INET_REASS_H_
 #define INET_REASS_H_
 
+#include <adt/hash_table.h>
+#include <adt/list.h>
+#include <fibril_synch.h>
+#include <stdint.h>
+#include <time.h>
 #include "inetsrv.h"
 
-extern errno_t inet_reass_queue_packet(inet_packet_t *);
+/** Time to wait for all fragments of a datagram (usec) */
+#define REASS_TIMEOUT  (30 * 1000 * 1000)
+/** Interval of dropping timed out datagrams (usec) */
+#define REASS_EXPIRE_INTERVAL  (1000 * 1000)
+/** Maximum memory used by datagrams being reassembled (bytes) */
+#define REASS_MEM_MAX  (4 * 1024 * 1024)
+
+/** Reassembled datagram delivery callback */
+typedef errno_t (*inet_reass_deliver_t)(void *, inet_dgram_t *, uint8_t);
+
+/** Reassembly statistics */
+typedef struct {
+	/** Datagrams reassembled and delivered */
+	uint64_t delivered;
+	/** Datagrams dropped because they were not completed in time */
+	uint64_t timeouts;
+	/** Datagrams dropped to stay within the memory budget */
+	uint64_t evicted;
+	/** Datagrams dropped because of inconsistent fragments */
+	uint64_t invalid;
+} inet_reass_stats_t;
+
+/** Datagram reassembly table */
+typedef struct {
+	/** Protects the table */
+	fibril_mutex_t lock;
+	/** Datagrams being reassembled (of reass_dgram_t) */
+	hash_table_t dgrams;
+	/** The same datagrams, oldest first */
+	list_t lru;
+	/** Memory used by datagrams being reassembled (bytes) */
+	size_t mem;
+	/** Memory budget (bytes) */
+	size_t mem_max;
+	/** Time to wait for all fragments (usec) */
+	usec_t timeout;
+	/** Return current time (usec) */
+	usec_t (*uptime)(void);
+	/** Timer dropping timed out datagrams */
+	fibril_timer_t *timer;
+	/** Delivery callback */
+	inet_reass_deliver_t deliver;
+	/** Delivery callback argument */
+	void *arg;
+	/** Statistics */
+	inet_reass_stats_t stats;
+} inet_reass_t;
+
+extern errno_t inet_reass_create(inet_reass_deliver_t, void *,
+    inet_reass_t **);
+extern void inet_reass_destroy(inet_reass_t *);
+extern errno_t inet_reass_queue_packet(inet_reass_t *, inet_packet_t *);
+extern void inet_reass_expire(inet_reass_t *);
 
 #endif
 
@@ -0,0 +1,393 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup inet
+ * @{
+ */
+/**
+ * @file
+ * @brief Longest-prefix match trie
+ *
+ * Binary trie with path compression: every node stores the full prefix it
+ * represents and nodes with a single child and no value are elided, so
+ * a lookup visits at most one node per distinct prefix length on the path
+ * to the destination rather than one node per bit.
+ *
+ * Lookups do not take any lock. Writers publish a new node only after it
+ * is fully initialized and never modify the prefix of a reachable node.
+ * Unlinked nodes are put on a retired list and freed by a writer once it
+ * observes that no lookup is in progress.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <macros.h>
+#include <stdlib.h>
+#include <str.h>
+#include "rtrie.h"
+
+/** Get bit @a i of @a key (bit 0 is the most significant bit). */
+static inline unsigned rtrie_bit(const uint8_t *key, unsigned i)
+{
+	return (key[i / 8] >> (7 - i % 8)) & 1;
+}
+
+/** Get number of leading bits @a a and @a b have in common.
+ *
+ * @param a First key
+ * @param b Second key
+ * @param maxbits Maximum number of bits to compare
+ * @return Length of common prefix, at most @a maxbits
+ */
+static unsigned rtrie_common(const uint8_t *a, const uint8_t *b,
+    unsigned maxbits)
+{
+	unsigned i;
+	uint8_t x;
+
+	for (i = 0; i < maxbits; i += 8) {
+		x = a[i / 8] ^ b[i / 8];
+		if (x != 0) {
+			while ((x & 0x80) == 0) {
+				x <<= 1;
+				++i;
+			}
+
+			return min(i, maxbits);
+		}
+	}
+
+	return maxbits;
+}
+
+/** Create trie node.
+ *
+ * @param key Key
+ * @param plen Prefix length in bits
+ * @param value Value or @c NULL
+ * @return New node or @c NULL if out of memory
+ */
+static rtrie_node_t *rtrie_node_create(const uint8_t *key, uint8_t plen,
+    void *value)
+{
+	rtrie_node_t *node;
+	unsigned nbytes;
+
+	node = calloc(1, sizeof(rtrie_node_t));
+	if (node == NULL)
+		return NULL;
+
+	nbytes = (plen + 7) / 8;
+	memcpy(node->key, key, nbytes);
+	if (plen % 8 != 0)
+		node->key[nbytes - 1] &= 0xff << (8 - plen % 8);
+
+	node->plen = plen;
+	atomic_init(&node->child[0], NULL);
+	atomic_init(&node->child[1], NULL);
+	atomic_init(&node->value, value);
+	return node;
+}
+
+/** Free retired nodes if no lookup is in progress.
+ *
+ * A lookup that starts after the readers count has been seen as zero
+ * also sees all unlinking stores made before, so it cannot reach any
+ * of the retired nodes.
+ */
+static void rtrie_reclaim(rtrie_t *trie)
+{
+	rtrie_node_t *node;
+
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&trie->readers, memory_order_relaxed) != 0)
+		return;
+
+	while (trie->retired != NULL) {
+		node = trie->retired;
+		trie->retired = node->retired;
+		free(node);
+	}
+}
+
+/** Put unlinked node on the retired list. */
+static void rtrie_retire(rtrie_t *trie, rtrie_node_t *node)
+{
+	node->retired = trie->retired;
+	trie->retired = node;
+}
+
+/** Find node with exactly the given prefix.
+ *
+ * @param trie Trie
+ * @param key Key
+ * @param plen Prefix length in bits
+ * @param rslot Place to store pointer to the link to the node
+ * @param rpslot Place to store pointer to the link to the parent node
+ *               (@c NULL if the node is the root)
+ * @return Node or @c NULL if there is none
+ */
+static rtrie_node_t *rtrie_find(rtrie_t *trie, const uint8_t *key,
+    uint8_t plen, rtrie_node_t *_Atomic **rslot,
+    rtrie_node_t *_Atomic **rpslot)
+{
+	rtrie_node_t *_Atomic *pslot = NULL;
+	rtrie_node_t *_Atomic *slot = &trie->root;
+	rtrie_node_t *node;
+
+	while (true) {
+		node = atomic_load_explicit(slot, memory_order_relaxed);
+		if (node == NULL || node->plen > plen ||
+		    rtrie_common(node->key, key, node->plen) != node->plen)
+			return NULL;
+
+		if (node->plen == plen)
+			break;
+
+		pslot = slot;
+		slot = &node->child[rtrie_bit(key, node->plen)];
+	}
+
+	if (rslot != NULL)
+		*rslot = slot;
+	if (rpslot != NULL)
+		*rpslot = pslot;
+	return node;
+}
+
+/** Insert prefix into trie.
+ *
+ * Must be serialized with other modifications of the trie.
+ *
+ * @param trie Trie
+ * @param key Key (only the first @a plen bits are used)
+ * @param plen Prefix length in bits
+ * @param value Value (not @c NULL)
+ * @return EOK on success, EEXIST if the prefix is already present,
+ *         ENOMEM if out of memory
+ */
+errno_t rtrie_insert(rtrie_t *trie, const uint8_t *key, uint8_t plen,
+    void *value)
+{
+	rtrie_node_t *_Atomic *slot = &trie->root;
+	rtrie_node_t *node;
+	rtrie_node_t *nnode;
+	rtrie_node_t *branch;
+	unsigned common;
+
+	assert(value != NULL);
+	assert(plen <= trie->klen);
+
+	while (true) {
+		node = atomic_load_explicit(slot, memory_order_relaxed);
+		if (node == NULL) {
+			nnode = rtrie_node_create(key, plen, value);
+			if (nnode == NULL)
+				return ENOMEM;
+
+			atomic_store_explicit(slot, nnode, memory_order_release);
+			return EOK;
+		}
+
+		common = rtrie_common(node->key, key, min(node->plen, plen));
+		if (common < node->plen)
+			break;
+
+		if (node->plen == plen) {
+			if (atomic_load_explicit(&node->value,
+			    memory_order_relaxed) != NULL)
+				return EEXIST;
+
+			atomic_store_explicit(&node->value, value,
+			    memory_order_release);
+			return EOK;
+		}
+
+		slot = &node->child[rtrie_bit(key, node->plen)];
+	}
+
+	/* Prefix of @a node diverges from the key at bit @c common */
+	nnode = rtrie_node_create(key, plen, value);
+	if (nnode == NULL)
+		return ENOMEM;
+
+	if (common == plen) {
+		/* New prefix covers @a node */
+		atomic_init(&nnode->child[rtrie_bit(node->key, plen)], node);
+		atomic_store_explicit(slot, nnode, memory_order_release);
+		return EOK;
+	}
+
+	/* Insert branching node above both */
+	branch = rtrie_node_create(key, common, NULL);
+	if (branch == NULL) {
+		free(nnode);
+		return ENOMEM;
+	}
+
+	atomic_init(&branch->child[rtrie_bit(key, common)], nnode);
+	atomic_init(&branch->child[rtrie_bit(node->key, common)], node);
+	atomic_store_explicit(slot, branch, memory_order_release);
+	return EOK;
+}
+
+/** Get value stored with exactly the given prefix.
+ *
+ * Must be serialized with modifications of the trie.
+ *
+ * @param trie Trie
+ * @param key Key
+ * @param plen Prefix length in bits
+ * @return Value or @c NULL if the prefix is not present
+ */
+void *rtrie_get(rtrie_t *trie, const uint8_t *key, uint8_t plen)
+{
+	rtrie_node_t *node;
+
+	node = rtrie_find(trie, key, plen, NULL, NULL);
+	if (node == NULL)
+		return NULL;
+
+	return atomic_load_explicit(&node->value, memory_order_relaxed);
+}
+
+/** Replace value stored with a prefix that is present in the trie.
+ *
+ * Must be serialized with other modifications of the trie.
+ *
+ * @param trie Trie
+ * @param key Key
+ * @param plen Prefix length in bits
+ * @param value New value (not @c NULL)
+ */
+void rtrie_set(rtrie_t *trie, const uint8_t *key, uint8_t plen, void *value)
+{
+	rtrie_node_t *node;
+
+	assert(value != NULL);
+
+	node = rtrie_find(trie, key, plen, NULL, NULL);
+	assert(node != NULL);
+
+	atomic_store_explicit(&node->value, value, memory_order_release);
+}
+
+/** Remove prefix from trie.
+ *
+ * Must be serialized with other modifications of the trie.
+ *
+ * @param trie Trie
+ * @param key Key
+ * @param plen Prefix length in bits
+ */
+void rtrie_remove(rtrie_t *trie, const uint8_t *key, uint8_t plen)
+{
+	rtrie_node_t *_Atomic *slot;
+	rtrie_node_t *_Atomic *pslot;
+	rtrie_node_t *node;
+	rtrie_node_t *parent;
+	rtrie_node_t *c0, *c1;
+
+	node = rtrie_find(trie, key, plen, &slot, &pslot);
+	if (node == NULL)
+		return;
+
+	atomic_store_explicit(&node->value, NULL, memory_order_release);
+
+	c0 = atomic_load_explicit(&node->child[0], memory_order_relaxed);
+	c1 = atomic_load_explicit(&node->child[1], memory_order_relaxed);
+
+	/* Node with two children stays as a branching node */
+	if (c0 != NULL && c1 != NULL)
+		return;
+
+	atomic_store_explicit(slot, c0 != NULL ? c0 : c1,
+	    memory_order_release);
+	rtrie_retire(trie, node);
+
+	/*
+	 * If a leaf was removed, its parent may now be a branching node
+	 * with a single child. Replace it with that child.
+	 */
+	if (c0 == NULL && c1 == NULL && pslot != NULL) {
+		parent = atomic_load_explicit(pslot, memory_order_relaxed);
+		if (atomic_load_explicit(&parent->value,
+		    memory_order_relaxed) == NULL) {
+			c0 = atomic_load_explicit(&parent->child[0],
+			    memory_order_relaxed);
+			c1 = atomic_load_explicit(&parent->child[1],
+			    memory_order_relaxed);
+			atomic_store_explicit(pslot, c0 != NULL ? c0 : c1,
+			    memory_order_release);
+			rtrie_retire(trie, parent);
+		}
+	}
+
+	rtrie_reclaim(trie);
+}
+
+/** Find value stored with the longest prefix matching a key.
+ *
+ * Can be called concurrently with modifications of the trie.
+ *
+ * @param trie Trie
+ * @param key Key of @c klen bits
+ * @return Value or @c NULL if no prefix matches
+ */
+void *rtrie_lookup(rtrie_t *trie, const uint8_t *key)
+{
+	rtrie_node_t *node;
+	void *best = NULL;
+	void *value;
+
+	atomic_fetch_add_explicit(&trie->readers, 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+
+	node = atomic_load_explicit(&trie->root, memory_order_acquire);
+	while (node != NULL &&
+	    rtrie_common(node->key, key, node->plen) == node->plen) {
+		value = atomic_load_explicit(&node->value,
+		    memory_order_acquire);
+		if (value != NULL)
+			best = value;
+
+		if (node->plen >= trie->klen)
+			break;
+
+		node = atomic_load_explicit(
+		    &node->child[rtrie_bit(key, node->plen)],
+		    memory_order_acquire);
+	}
+
+	atomic_fetch_sub_explicit(&trie->readers, 1, memory_order_release);
+	return best;
+}
+
+/** @}
+ */
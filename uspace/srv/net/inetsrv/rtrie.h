@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup inet
+ * @{
+ */
+/**
+ * @file
+ * @brief Longest-prefix match trie
+ */
+
+#ifndef INET_RTRIE_H_
+#define INET_RTRIE_H_
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Maximum key length (bytes) */
+#define RTRIE_KEY_SIZE  16
+
+/** Trie node */
+typedef struct rtrie_node {
+	/** Children for next bit 0 and 1 */
+	struct rtrie_node *_Atomic child[2];
+	/** Value or @c NULL if this is only a branching node */
+	void *_Atomic value;
+	/** Next node on the retired list */
+	struct rtrie_node *retired;
+	/** Prefix length in bits */
+	uint8_t plen;
+	/** Prefix (bits beyond @c plen are zero) */
+	uint8_t key[RTRIE_KEY_SIZE];
+} rtrie_node_t;
+
+/** Path-compressed binary trie for longest-prefix match.
+ *
+ * Modifications must be serialized by the caller. Lookups may run
+ * concurrently with them without any locking. Nodes are only ever
+ * published fully initialized and unlinked nodes are freed once no
+ * lookup is in progress.
+ */
+typedef struct {
+	/** Root node */
+	rtrie_node_t *_Atomic root;
+	/** Number of lookups in progress */
+	atomic_uint readers;
+	/** Unlinked nodes waiting to be freed */
+	rtrie_node_t *retired;
+	/** Key length in bits */
+	uint8_t klen;
+} rtrie_t;
+
+/** Initializer for a trie with keys of @a nbits bits */
+#define RTRIE_INITIALIZER(nbits) \
+	{ \
+		.root = NULL, \
+		.readers = 0, \
+		.retired = NULL, \
+		.klen = (nbits) \
+	}
+
+extern errno_t rtrie_insert(rtrie_t *, const uint8_t *, uint8_t, void *);
+extern void *rtrie_get(rtrie_t *, const uint8_t *, uint8_t);
+extern void rtrie_set(rtrie_t *, const uint8_t *, uint8_t, void *);
+extern void rtrie_remove(rtrie_t *, const uint8_t *, uint8_t);
+extern void *rtrie_lookup(rtrie_t *, const uint8_t *);
+
+#endif
+
+/** @}
+ */
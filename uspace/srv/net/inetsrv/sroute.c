@@ -46,11 +46,68 @@
 #include "sroute.h"
 #include "inetsrv.h"
 #include "inet_link.h"
+#include "rtrie.h"
 
 static FIBRIL_MUTEX_INITIALIZE(sroute_list_lock);
 static LIST_INITIALIZE(sroute_list);
 static sysarg_t sroute_id = 0;
 
+/*
+ * Longest-prefix match tries for IPv4 and IPv6 destinations. Modified
+ * with sroute_list_lock held, looked up without any lock. If several
+ * routes have the same destination, the trie holds the oldest one.
+ */
+static rtrie_t sroute_trie4 = RTRIE_INITIALIZER(32);
+static rtrie_t sroute_trie6 = RTRIE_INITIALIZER(128);
+
+/** Get routing trie and trie key for address.
+ *
+ * @param addr Address
+ * @param key Place to store key
+ * @return Trie for the address family of @a addr or @c NULL
+ */
+static rtrie_t *inet_sroute_key(inet_addr_t *addr, uint8_t *key)
+{
+	addr32_t v4;
+	addr128_t v6;
+
+	switch (inet_addr_get(addr, &v4, &v6)) {
+	case ip_v4:
+		key[0] = v4 >> 24;
+		key[1] = (v4 >> 16) & 0xff;
+		key[2] = (v4 >> 8) & 0xff;
+		key[3] = v4 & 0xff;
+		return &sroute_trie4;
+	case ip_v6:
+		memcpy(key, v6, sizeof(addr128_t));
+		return &sroute_trie6;
+	default:
+		return NULL;
+	}
+}
+
+/** Get routing trie, trie key and prefix length for route destination.
+ *
+ * @param sroute Static route
+ * @param key Place to store key
+ * @param plen Place to store prefix length
+ * @return Trie or @c NULL if the destination is not valid
+ */
+static rtrie_t *inet_sroute_dest_key(inet_sroute_t *sroute, uint8_t *key,
+    uint8_t *plen)
+{
+	inet_addr_t addr;
+	rtrie_t *trie;
+
+	inet_naddr_addr(&sroute->dest, &addr);
+	trie = inet_sroute_key(&addr, key);
+	if (trie == NULL || sroute->dest.prefix > trie->klen)
+		return NULL;
+
+	*plen = sroute->dest.prefix;
+	return trie;
+}
+
 inet_sroute_t *inet_sroute_new(void)
 {
 	inet_sroute_t *sroute = calloc(1, sizeof(inet_sroute_t));
@@ -76,61 +133,90 @@ void inet_sroute_delete(inet_sroute_t *sroute)
 	free(sroute);
 }
 
-void inet_sroute_add(inet_sroute_t *sroute)
+/** Add static route.
+ *
+ * @param sroute Static route
+ * @return EOK on success, EINVAL if the destination is not valid,
+ *         ENOMEM if out of memory
+ */
+errno_t inet_sroute_add(inet_sroute_t *sroute)
 {
+	uint8_t key[RTRIE_KEY_SIZE];
+	uint8_t plen;
+	rtrie_t *trie;
+	errno_t rc;
+
+	trie = inet_sroute_dest_key(sroute, key, &plen);
+	if (trie == NULL)
+		return EINVAL;
+
 	fibril_mutex_lock(&sroute_list_lock);
+
+	rc = rtrie_insert(trie, key, plen, sroute);
+	if (rc != EOK && rc != EEXIST) {
+		fibril_mutex_unlock(&sroute_list_lock);
+		return rc;
+	}
+
 	list_append(&sroute->sroute_list, &sroute_list);
 	fibril_mutex_unlock(&sroute_list_lock);
+	return EOK;
 }
 
 void inet_sroute_remove(inet_sroute_t *sroute)
 {
+	uint8_t key[RTRIE_KEY_SIZE];
+	uint8_t plen;
+	inet_addr_t addr;
+	inet_sroute_t *next = NULL;
+	rtrie_t *trie;
+
 	fibril_mutex_lock(&sroute_list_lock);
 	list_remove(&sroute->sroute_list);
+
+	trie = inet_sroute_dest_key(sroute, key, &plen);
+	if (trie != NULL && rtrie_get(trie, key, plen) == sroute) {
+		/* Let the next oldest route to the same destination take over */
+		inet_naddr_addr(&sroute->dest, &addr);
+		list_foreach(sroute_list, sroute_list, inet_sroute_t, sr) {
+			if (sr->dest.prefix == plen &&
+			    inet_naddr_compare_mask(&sr->dest, &addr)) {
+				next = sr;
+				break;
+			}
+		}
+
+		if (next != NULL)
+			rtrie_set(trie, key, plen, next);
+		else
+			rtrie_remove(trie, key, plen);
+	}
+
 	fibril_mutex_unlock(&sroute_list_lock);
 }
 
 /** Find static route object matching address @a addr.
+ *
+ * Finds the route with the longest matching destination prefix.
+ * Does not take sroute_list_lock.
  *
  * @param addr	Address
  */
 inet_sroute_t *inet_sroute_find(inet_addr_t *addr)
 {
-	ip_ver_t addr_ver = inet_addr_get(addr, NULL, NULL);
-
-	inet_sroute_t *best = NULL;
-	uint8_t best_bits = 0;
-
-	fibril_mutex_lock(&sroute_list_lock);
-
-	list_foreach(sroute_list, sroute_list, inet_sroute_t, sroute) {
-		uint8_t dest_bits;
-		ip_ver_t dest_ver = inet_naddr_get(&sroute->dest, NULL, NULL,
-		    &dest_bits);
-
-		/* Skip comparison with different address family */
-		if (addr_ver != dest_ver)
-			continue;
-
-		/* Look for the most specific route */
-		if ((best != NULL) && (best_bits >= dest_bits))
-			continue;
-
-		if (inet_naddr_compare_mask(&sroute->dest, addr)) {
-			log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_sroute_find: found candidate %p",
-			    sroute);
+	uint8_t key[RTRIE_KEY_SIZE];
+	inet_sroute_t *sroute;
+	rtrie_t *trie;
 
-			best = sroute;
-			best_bits = dest_bits;
-		}
-	}
+	trie = inet_sroute_key(addr, key);
+	if (trie == NULL)
+		return NULL;
 
-	if (best == NULL)
+	sroute = rtrie_lookup(trie, key);
+	if (sroute == NULL)
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_sroute_find: Not found");
 
-	fibril_mutex_unlock(&sroute_list_lock);
-
-	return best;
+	return sroute;
 }
 
 /** Find static route with a specific name.
@@ -271,7 +357,12 @@ static errno_t inet_sroute_load(sif_node_t *nroute)
 		return ENOMEM;
 	}
 
-	inet_sroute_add(sroute);
+	rc = inet_sroute_add(sroute);
+	if (rc != EOK) {
+		inet_sroute_delete(sroute);
+		return rc;
+	}
+
 	return EOK;
 }
 
@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <io/log.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdlib.h>
+
+#include "../inetsrv.h"
+#include "../reass.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(reass);
+
+/** Size of datagrams used by the tests */
+#define TEST_DGRAM_SIZE  4096
+
+static usec_t test_now;
+static size_t test_ndelivered;
+static uint8_t test_proto;
+static uint8_t test_data[TEST_DGRAM_SIZE];
+static size_t test_size;
+
+static usec_t test_uptime(void)
+{
+	return test_now;
+}
+
+static errno_t test_deliver(void *arg, inet_dgram_t *dgram, uint8_t proto)
+{
+	PCUT_ASSERT_TRUE(dgram->size <= TEST_DGRAM_SIZE);
+
+	++test_ndelivered;
+	test_proto = proto;
+	test_size = dgram->size;
+	memcpy(test_data, dgram->data, dgram->size);
+	return EOK;
+}
+
+/** Fill datagram with a recognizable pattern. */
+static void test_pattern(uint8_t *data, size_t size, uint32_t ident)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++)
+		data[i] = (uint8_t) (i * 7 + ident);
+}
+
+/** Queue part of a datagram as a fragment.
+ *
+ * @param reass Reassembly table
+ * @param ident Datagram identification
+ * @param data Entire datagram
+ * @param offs Fragment offset
+ * @param size Fragment size
+ * @param mf More fragments
+ */
+static errno_t test_queue(inet_reass_t *reass, uint32_t ident, uint8_t *data,
+    size_t offs, size_t size, bool mf)
+{
+	inet_packet_t packet;
+
+	memset(&packet, 0, sizeof(packet));
+	inet_addr(&packet.src, 10, 0, 0, 1);
+	inet_addr(&packet.dest, 10, 0, 0, 2);
+	packet.proto = 17;
+	packet.ident = ident;
+	packet.mf = mf;
+	packet.offs = offs;
+	packet.data = data + offs;
+	packet.size = size;
+
+	return inet_reass_queue_packet(reass, &packet);
+}
+
+static inet_reass_t *test_reass_create(void)
+{
+	inet_reass_t *reass;
+	errno_t rc;
+
+	rc = inet_reass_create(test_deliver, NULL, &reass);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	reass->uptime = test_uptime;
+	return reass;
+}
+
+PCUT_TEST_BEFORE
+{
+	errno_t rc;
+
+	/* We will be calling functions that perform logging */
+	rc = log_init("test-inetsrv");
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	test_now = 1000;
+	test_ndelivered = 0;
+	test_size = 0;
+	memset(test_data, 0, sizeof(test_data));
+}
+
+/** Fragments arriving in order are reassembled */
+PCUT_TEST(in_order)
+{
+	inet_reass_t *reass;
+	uint8_t data[1600];
+	errno_t rc;
+
+	reass = test_reass_create();
+	test_pattern(data, sizeof(data), 1);
+
+	rc = test_queue(reass, 1, data, 0, 800, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, test_ndelivered);
+
+	rc = test_queue(reass, 1, data, 800, 800, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(1, test_ndelivered);
+	PCUT_ASSERT_INT_EQUALS(17, test_proto);
+	PCUT_ASSERT_INT_EQUALS(sizeof(data), test_size);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(data, test_data, sizeof(data)));
+	PCUT_ASSERT_INT_EQUALS(0, reass->mem);
+
+	inet_reass_destroy(reass);
+}
+
+/** Out of order, duplicate and overlapping fragments are reassembled */
+PCUT_TEST(overlap)
+{
+	inet_reass_t *reass;
+	uint8_t data[1024];
+	errno_t rc;
+
+	reass = test_reass_create();
+	test_pattern(data, sizeof(data), 2);
+
+	rc = test_queue(reass, 2, data, 512, 512, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = test_queue(reass, 2, data, 128, 128, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = test_queue(reass, 2, data, 128, 128, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = test_queue(reass, 2, data, 64, 640, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, test_ndelivered);
+
+	rc = test_queue(reass, 2, data, 0, 256, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(1, test_ndelivered);
+	PCUT_ASSERT_INT_EQUALS(sizeof(data), test_size);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(data, test_data, sizeof(data)));
+	PCUT_ASSERT_INT_EQUALS(0, reass->mem);
+
+	inet_reass_destroy(reass);
+}
+
+/** Fragments of different datagrams are kept apart */
+PCUT_TEST(interleaved)
+{
+	inet_reass_t *reass;
+	uint8_t data1[512];
+	uint8_t data2[512];
+	errno_t rc;
+
+	reass = test_reass_create();
+	test_pattern(data1, sizeof(data1), 3);
+	test_pattern(data2, sizeof(data2), 4);
+
+	rc = test_queue(reass, 3, data1, 0, 256, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = test_queue(reass, 4, data2, 256, 256, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = test_queue(reass, 4, data2, 0, 256, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(1, test_ndelivered);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(data2, test_data, sizeof(data2)));
+
+	rc = test_queue(reass, 3, data1, 256, 256, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(2, test_ndelivered);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(data1, test_data, sizeof(data1)));
+
+	inet_reass_destroy(reass);
+}
+
+/** Datagram with inconsistent size is dropped */
+PCUT_TEST(invalid)
+{
+	inet_reass_t *reass;
+	uint8_t data[1024];
+	errno_t rc;
+
+	reass = test_reass_create();
+	test_pattern(data, sizeof(data), 5);
+
+	rc = test_queue(reass, 5, data, 0, 512, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(1, test_ndelivered);
+
+	rc = test_queue(reass, 6, data, 512, 512, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = test_queue(reass, 6, data, 0, 256, false);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+	PCUT_ASSERT_INT_EQUALS(1, reass->stats.invalid);
+	PCUT_ASSERT_INT_EQUALS(0, reass->mem);
+
+	rc = test_queue(reass, 7, data, 0, 512, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(2, test_ndelivered);
+	rc = test_queue(reass, 8, data, 256, 256, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = test_queue(reass, 8, data, 0, 1024, true);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+	PCUT_ASSERT_INT_EQUALS(2, reass->stats.invalid);
+	PCUT_ASSERT_INT_EQUALS(0, reass->mem);
+
+	inet_reass_destroy(reass);
+}
+
+/** Incomplete datagram times out */
+PCUT_TEST(timeout)
+{
+	inet_reass_t *reass;
+	uint8_t data[1024];
+	errno_t rc;
+
+	reass = test_reass_create();
+	test_pattern(data, sizeof(data), 9);
+
+	rc = test_queue(reass, 9, data, 0, 512, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_TRUE(reass->mem > 0);
+
+	test_now += reass->timeout - 1;
+	inet_reass_expire(reass);
+	PCUT_ASSERT_INT_EQUALS(0, reass->stats.timeouts);
+
+	test_now += 1;
+	inet_reass_expire(reass);
+	PCUT_ASSERT_INT_EQUALS(1, reass->stats.timeouts);
+	PCUT_ASSERT_INT_EQUALS(0, reass->mem);
+
+	/* The rest of the datagram starts a new one */
+	rc = test_queue(reass, 9, data, 512, 512, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, test_ndelivered);
+
+	inet_reass_destroy(reass);
+}
+
+/** Fragment flood stays within the memory budget */
+PCUT_TEST(flood)
+{
+	inet_reass_t *reass;
+	uint8_t data[1024];
+	uint32_t ident;
+	errno_t rc;
+
+	reass = test_reass_create();
+	reass->mem_max = 16 * 1024;
+	test_pattern(data, sizeof(data), 10);
+
+	/* Many datagrams that are never completed */
+	for (ident = 100; ident < 1100; ident++) {
+		rc = test_queue(reass, ident, data, 0, 512, true);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		PCUT_ASSERT_TRUE(reass->mem <= reass->mem_max);
+	}
+
+	PCUT_ASSERT_TRUE(reass->stats.evicted > 0);
+
+	/* A complete datagram still gets through */
+	rc = test_queue(reass, 10, data, 512, 512, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = test_queue(reass, 10, data, 0, 512, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(1, test_ndelivered);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(data, test_data, sizeof(data)));
+
+	/* Datagram that does not fit at all is refused */
+	reass->mem_max = 1024;
+	rc = test_queue(reass, 11, data, 0, 1024, true);
+	PCUT_ASSERT_ERRNO_VAL(ELIMIT, rc);
+	PCUT_ASSERT_INT_EQUALS(0, reass->mem);
+
+	inet_reass_destroy(reass);
+}
+
+/** Many datagrams with shuffled fragments are all reassembled */
+PCUT_TEST(throughput)
+{
+	inet_reass_t *reass;
+	uint8_t *data;
+	size_t order[8];
+	size_t fsize;
+	size_t i, j, k;
+	uint32_t ident;
+	errno_t rc;
+
+	reass = test_reass_create();
+
+	data = malloc(TEST_DGRAM_SIZE);
+	PCUT_ASSERT_NOT_NULL(data);
+
+	fsize = TEST_DGRAM_SIZE / 8;
+
+	for (ident = 0; ident < 1000; ident++) {
+		test_pattern(data, TEST_DGRAM_SIZE, ident);
+
+		for (i = 0; i < 8; i++)
+			order[i] = (i * 5 + ident) % 8;
+
+		for (i = 0; i < 8; i++) {
+			k = order[i];
+			rc = test_queue(reass, ident, data, k * fsize, fsize,
+			    k != 7);
+			PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		}
+
+		PCUT_ASSERT_INT_EQUALS(ident + 1, test_ndelivered);
+		for (j = 0; j < TEST_DGRAM_SIZE; j++)
+			PCUT_ASSERT_INT_EQUALS(data[j], test_data[j]);
+	}
+
+	PCUT_ASSERT_INT_EQUALS(1000, reass->stats.delivered);
+	PCUT_ASSERT_INT_EQUALS(0, reass->mem);
+
+	free(data);
+	inet_reass_destroy(reass);
+}
+
+PCUT_EXPORT(reass);
@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+
+#include "../rtrie.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(rtrie);
+
+static int val_a, val_b, val_c, val_d, val_e;
+
+/** Fill in IPv4 key. */
+static void key4(uint8_t *key, uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+{
+	key[0] = a;
+	key[1] = b;
+	key[2] = c;
+	key[3] = d;
+}
+
+/** Look up IPv4 address. */
+static void *lookup4(rtrie_t *trie, uint8_t a, uint8_t b, uint8_t c,
+    uint8_t d)
+{
+	uint8_t key[4];
+
+	key4(key, a, b, c, d);
+	return rtrie_lookup(trie, key);
+}
+
+/** Empty trie does not match anything */
+PCUT_TEST(empty)
+{
+	rtrie_t trie = RTRIE_INITIALIZER(32);
+	uint8_t key[4];
+
+	key4(key, 10, 0, 0, 1);
+	PCUT_ASSERT_NULL(rtrie_lookup(&trie, key));
+	PCUT_ASSERT_NULL(rtrie_get(&trie, key, 32));
+	PCUT_ASSERT_NULL(rtrie_get(&trie, key, 0));
+
+	/* Removing a prefix that is not present does nothing */
+	rtrie_remove(&trie, key, 8);
+	PCUT_ASSERT_NULL(trie.root);
+}
+
+/** Inserted prefix can be retrieved, duplicate is rejected */
+PCUT_TEST(insert_get)
+{
+	rtrie_t trie = RTRIE_INITIALIZER(32);
+	uint8_t key[4];
+	errno_t rc;
+
+	key4(key, 10, 0, 0, 0);
+	rc = rtrie_insert(&trie, key, 8, &val_a);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_EQUALS(&val_a, rtrie_get(&trie, key, 8));
+	PCUT_ASSERT_NULL(rtrie_get(&trie, key, 16));
+	PCUT_ASSERT_NULL(rtrie_get(&trie, key, 7));
+
+	/* Bits beyond the prefix length are ignored */
+	key4(key, 10, 1, 2, 3);
+	PCUT_ASSERT_EQUALS(&val_a, rtrie_get(&trie, key, 8));
+
+	rc = rtrie_insert(&trie, key, 8, &val_b);
+	PCUT_ASSERT_ERRNO_VAL(EEXIST, rc);
+	PCUT_ASSERT_EQUALS(&val_a, rtrie_get(&trie, key, 8));
+
+	rtrie_remove(&trie, key, 8);
+	PCUT_ASSERT_NULL(rtrie_get(&trie, key, 8));
+	PCUT_ASSERT_NULL(trie.root);
+	PCUT_ASSERT_NULL(trie.retired);
+}
+
+/** Value of a present prefix can be replaced */
+PCUT_TEST(replace)
+{
+	rtrie_t trie = RTRIE_INITIALIZER(32);
+	uint8_t key[4];
+	errno_t rc;
+
+	key4(key, 192, 168, 0, 0);
+	rc = rtrie_insert(&trie, key, 16, &val_a);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rtrie_set(&trie, key, 16, &val_b);
+	PCUT_ASSERT_EQUALS(&val_b, rtrie_get(&trie, key, 16));
+	PCUT_ASSERT_EQUALS(&val_b, lookup4(&trie, 192, 168, 10, 1));
+
+	rtrie_remove(&trie, key, 16);
+	PCUT_ASSERT_NULL(trie.root);
+}
+
+/** Default route matches any address */
+PCUT_TEST(default_route)
+{
+	rtrie_t trie = RTRIE_INITIALIZER(32);
+	uint8_t key[4];
+	errno_t rc;
+
+	key4(key, 0, 0, 0, 0);
+	rc = rtrie_insert(&trie, key, 0, &val_a);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_EQUALS(&val_a, lookup4(&trie, 0, 0, 0, 0));
+	PCUT_ASSERT_EQUALS(&val_a, lookup4(&trie, 10, 0, 0, 1));
+	PCUT_ASSERT_EQUALS(&val_a, lookup4(&trie, 255, 255, 255, 255));
+
+	rtrie_remove(&trie, key, 0);
+	PCUT_ASSERT_NULL(lookup4(&trie, 10, 0, 0, 1));
+	PCUT_ASSERT_NULL(trie.root);
+}
+
+/** Host route matches only a single address */
+PCUT_TEST(host_route)
+{
+	rtrie_t trie = RTRIE_INITIALIZER(32);
+	uint8_t key[4];
+	errno_t rc;
+
+	key4(key, 192, 168, 1, 1);
+	rc = rtrie_insert(&trie, key, 32, &val_a);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_EQUALS(&val_a, lookup4(&trie, 192, 168, 1, 1));
+	PCUT_ASSERT_NULL(lookup4(&trie, 192, 168, 1, 0));
+	PCUT_ASSERT_NULL(lookup4(&trie, 192, 168, 1, 2));
+	PCUT_ASSERT_NULL(lookup4(&trie, 64, 168, 1, 1));
+
+	rtrie_remove(&trie, key, 32);
+	PCUT_ASSERT_NULL(trie.root);
+}
+
+/** Lookup returns the value with the longest matching prefix */
+PCUT_TEST(longest_match)
+{
+	rtrie_t trie = RTRIE_INITIALIZER(32);
+	uint8_t key[4];
+	errno_t rc;
+
+	/* Insert longer prefixes first so that they get covered later */
+	key4(key, 10, 1, 2, 3);
+	rc = rtrie_insert(&trie, key, 32, &val_e);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = rtrie_insert(&trie, key, 16, &val_c);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = rtrie_insert(&trie, key, 24, &val_d);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = rtrie_insert(&trie, key, 8, &val_b);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = rtrie_insert(&trie, key, 0, &val_a);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_EQUALS(&val_e, lookup4(&trie, 10, 1, 2, 3));
+	PCUT_ASSERT_EQUALS(&val_d, lookup4(&trie, 10, 1, 2, 4));
+	PCUT_ASSERT_EQUALS(&val_c, lookup4(&trie, 10, 1, 3, 1));
+	PCUT_ASSERT_EQUALS(&val_b, lookup4(&trie, 10, 2, 0, 0));
+	PCUT_ASSERT_EQUALS(&val_a, lookup4(&trie, 11, 0, 0, 0));
+
+	/* Removing a prefix exposes the next shorter one */
+	rtrie_remove(&trie, key, 24);
+	PCUT_ASSERT_EQUALS(&val_e, lookup4(&trie, 10, 1, 2, 3));
+	PCUT_ASSERT_EQUALS(&val_c, lookup4(&trie, 10, 1, 2, 4));
+
+	rtrie_remove(&trie, key, 8);
+	PCUT_ASSERT_EQUALS(&val_c, lookup4(&trie, 10, 1, 2, 4));
+	PCUT_ASSERT_EQUALS(&val_a, lookup4(&trie, 10, 2, 0, 0));
+
+	rtrie_remove(&trie, key, 0);
+	rtrie_remove(&trie, key, 16);
+	rtrie_remove(&trie, key, 32);
+	PCUT_ASSERT_NULL(trie.root);
+	PCUT_ASSERT_NULL(trie.retired);
+}
+
+/** Prefixes not aligned to bytes */
+PCUT_TEST(unaligned)
+{
+	rtrie_t trie = RTRIE_INITIALIZER(32);
+	uint8_t key[4];
+	errno_t rc;
+
+	key4(key, 0, 0, 0, 0);
+	rc = rtrie_insert(&trie, key, 1, &val_a);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	key4(key, 128, 0, 0, 0);
+	rc = rtrie_insert(&trie, key, 1, &val_b);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	key4(key, 172, 16, 0, 0);
+	rc = rtrie_insert(&trie, key, 12, &val_c);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_EQUALS(&val_a, lookup4(&trie, 127, 255, 255, 255));
+	PCUT_ASSERT_EQUALS(&val_b, lookup4(&trie, 128, 0, 0, 0));
+	PCUT_ASSERT_EQUALS(&val_c, lookup4(&trie, 172, 31, 255, 255));
+	PCUT_ASSERT_EQUALS(&val_b, lookup4(&trie, 172, 32, 0, 0));
+
+	rtrie_remove(&trie, key, 12);
+	key4(key, 0, 0, 0, 0);
+	rtrie_remove(&trie, key, 1);
+	key4(key, 128, 0, 0, 0);
+	rtrie_remove(&trie, key, 1);
+	PCUT_ASSERT_NULL(trie.root);
+}
+
+/** Removing a leaf collapses the branching node above it */
+PCUT_TEST(remove_collapse)
+{
+	rtrie_t trie = RTRIE_INITIALIZER(32);
+	uint8_t key1[4];
+	uint8_t key2[4];
+	errno_t rc;
+
+	/* Sibling prefixes need a branching node at /23 */
+	key4(key1, 10, 0, 0, 0);
+	rc = rtrie_insert(&trie, key1, 24, &val_a);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	key4(key2, 10, 0, 1, 0);
+	rc = rtrie_insert(&trie, key2, 24, &val_b);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_NOT_NULL(trie.root);
+	PCUT_ASSERT_INT_EQUALS(23, trie.root->plen);
+	PCUT_ASSERT_NULL(trie.root->value);
+
+	rtrie_remove(&trie, key1, 24);
+	PCUT_ASSERT_NULL(lookup4(&trie, 10, 0, 0, 1));
+	PCUT_ASSERT_EQUALS(&val_b, lookup4(&trie, 10, 0, 1, 1));
+
+	/* The branching node has been replaced by the remaining leaf */
+	PCUT_ASSERT_NOT_NULL(trie.root);
+	PCUT_ASSERT_INT_EQUALS(24, trie.root->plen);
+	PCUT_ASSERT_NULL(trie.retired);
+
+	/* Node with a single child is replaced by the child */
+	rc = rtrie_insert(&trie, key1, 8, &val_c);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(8, trie.root->plen);
+	rtrie_remove(&trie, key1, 8);
+	PCUT_ASSERT_INT_EQUALS(24, trie.root->plen);
+	PCUT_ASSERT_NULL(lookup4(&trie, 10, 2, 0, 0));
+	PCUT_ASSERT_EQUALS(&val_b, lookup4(&trie, 10, 0, 1, 1));
+
+	rtrie_remove(&trie, key2, 24);
+	PCUT_ASSERT_NULL(trie.root);
+	PCUT_ASSERT_NULL(trie.retired);
+}
+
+/** IPv6 prefixes including /0 and /128 */
+PCUT_TEST(ipv6)
+{
+	rtrie_t trie = RTRIE_INITIALIZER(128);
+	uint8_t net[16] = {
+		0x20, 0x01, 0x0d, 0xb8
+	};
+	uint8_t host[16] = {
+		0x20, 0x01, 0x0d, 0xb8, [15] = 0x01
+	};
+	uint8_t other[16] = {
+		0x20, 0x01, 0x0d, 0xb8, [15] = 0x02
+	};
+	uint8_t outside[16] = {
+		0xfe, 0x80, [15] = 0x01
+	};
+	errno_t rc;
+
+	rc = rtrie_insert(&trie, host, 128, &val_c);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = rtrie_insert(&trie, net, 32, &val_b);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_EQUALS(&val_c, rtrie_lookup(&trie, host));
+	PCUT_ASSERT_EQUALS(&val_b, rtrie_lookup(&trie, other));
+	PCUT_ASSERT_NULL(rtrie_lookup(&trie, outside));
+
+	rc = rtrie_insert(&trie, outside, 0, &val_a);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_EQUALS(&val_a, rtrie_lookup(&trie, outside));
+	PCUT_ASSERT_EQUALS(&val_c, rtrie_lookup(&trie, host));
+
+	rtrie_remove(&trie, host, 128);
+	PCUT_ASSERT_EQUALS(&val_b, rtrie_lookup(&trie, host));
+
+	rtrie_remove(&trie, net, 32);
+	rtrie_remove(&trie, net, 0);
+	PCUT_ASSERT_NULL(rtrie_lookup(&trie, host));
+	PCUT_ASSERT_NULL(trie.root);
+	PCUT_ASSERT_NULL(trie.retired);
+}
+
+PCUT_EXPORT(rtrie);
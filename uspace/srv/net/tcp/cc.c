@@ -0,0 +1,524 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tcp
+ * @{
+ */
+
+/**
+ * @file Congestion control and retransmission timeout
+ *
+ * Slow start, congestion avoidance, fast retransmit and fast recovery
+ * follow RFC 5681 with the NewReno modification (RFC 6582). Window growth
+ * in congestion avoidance and the reaction to loss are delegated to the
+ * congestion control algorithm, which is either NewReno or CUBIC
+ * (RFC 9438). The retransmission timeout is computed per RFC 6298.
+ */
+
+#include <io/log.h>
+#include <macros.h>
+#include <mem.h>
+#include <str.h>
+
+#include "cc.h"
+#include "tqueue.h"
+
+/** Upper bound of the congestion window (bytes) */
+#define TCP_CWND_MAX  (UINT32_MAX / 2)
+
+/** Clock granularity used in the RTO computation (usec) */
+#define TCP_RTT_GRANULARITY  1000
+
+/** CUBIC multiplicative decrease factor (in tenths) */
+#define CUBIC_BETA_10  7
+
+/** Longest time span the cubic function is evaluated at (msec) */
+#define CUBIC_T_MAX  100000
+
+static void newreno_ack(tcp_conn_t *, uint32_t);
+static uint32_t newreno_loss(tcp_conn_t *);
+static void cubic_ack(tcp_conn_t *, uint32_t);
+static uint32_t cubic_loss(tcp_conn_t *);
+
+tcp_cc_ops_t tcp_cc_newreno = {
+	.name = "newreno",
+	.ack = newreno_ack,
+	.loss = newreno_loss
+};
+
+tcp_cc_ops_t tcp_cc_cubic = {
+	.name = "cubic",
+	.ack = cubic_ack,
+	.loss = cubic_loss
+};
+
+static tcp_cc_ops_t *tcp_cc_algs[] = {
+	&tcp_cc_newreno,
+	&tcp_cc_cubic
+};
+
+/** Algorithm used for new connections */
+static tcp_cc_ops_t *tcp_cc_default = &tcp_cc_cubic;
+
+/** Current uptime in microseconds. */
+static usec_t tcp_cc_now(void)
+{
+	struct timespec ts;
+
+	getuptime(&ts);
+	return SEC2USEC(ts.tv_sec) + NSEC2USEC(ts.tv_nsec);
+}
+
+/** Number of bytes in flight. */
+static uint32_t tcp_cc_flight(tcp_conn_t *conn)
+{
+	return conn->snd_nxt - conn->snd_una;
+}
+
+/** Initial window (RFC 3390).
+ *
+ * @param smss Sender maximum segment size
+ * @return Initial congestion window
+ */
+static uint32_t tcp_cc_iw(uint32_t smss)
+{
+	return min(4 * smss, max(2 * smss, 4380));
+}
+
+/** Select congestion control algorithm for new connections.
+ *
+ * @param name Algorithm name
+ * @return EOK on success, ENOENT if there is no such algorithm
+ */
+errno_t tcp_cc_select(const char *name)
+{
+	for (size_t i = 0; i < sizeof(tcp_cc_algs) / sizeof(tcp_cc_algs[0]);
+	    i++) {
+		if (str_cmp(tcp_cc_algs[i]->name, name) == 0) {
+			tcp_cc_default = tcp_cc_algs[i];
+			return EOK;
+		}
+	}
+
+	return ENOENT;
+}
+
+/** Initialize congestion control state of a connection.
+ *
+ * @param conn Connection
+ */
+void tcp_cc_init(tcp_conn_t *conn)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	memset(cc, 0, sizeof(tcp_cc_t));
+	cc->ops = tcp_cc_default;
+
+	cc->cwnd = tcp_cc_iw(conn->smss);
+	cc->ssthresh = TCP_CWND_MAX;
+	cc->una = conn->snd_una;
+	cc->recover = conn->snd_una;
+
+	memset(&conn->rtt, 0, sizeof(tcp_rtt_t));
+	conn->rtt.rto = TCP_RTO_INIT;
+}
+
+/** Set sender maximum segment size.
+ *
+ * Called once the MSS has been negotiated, before any data is sent.
+ *
+ * @param conn Connection
+ * @param smss Sender maximum segment size
+ */
+void tcp_cc_mss_set(tcp_conn_t *conn, uint32_t smss)
+{
+	conn->smss = smss;
+	conn->cc.cwnd = tcp_cc_iw(smss);
+}
+
+/** Get the number of bytes that may be outstanding.
+ *
+ * @param conn Connection
+ * @return Smaller of the send window and the congestion window
+ */
+uint32_t tcp_cc_wnd(tcp_conn_t *conn)
+{
+	return min(conn->snd_wnd, conn->cc.cwnd);
+}
+
+/** Enter loss recovery.
+ *
+ * @param conn Connection
+ */
+static void tcp_cc_loss(tcp_conn_t *conn)
+{
+	conn->cc.ssthresh = conn->cc.ops->loss(conn);
+	conn->cc.bytes_acked = 0;
+	conn->cc.recover = conn->snd_nxt;
+	conn->cc.recovery = true;
+}
+
+/** New data has been acknowledged.
+ *
+ * Should be called after SND.UNA has advanced and acknowledged segments
+ * have been removed from the retransmission queue, before new data
+ * is transmitted.
+ *
+ * @param conn Connection
+ */
+void tcp_cc_ack_received(tcp_conn_t *conn)
+{
+	tcp_cc_t *cc = &conn->cc;
+	uint32_t acked;
+
+	acked = conn->snd_una - cc->una;
+	if ((int32_t) acked <= 0)
+		return;
+
+	cc->una = conn->snd_una;
+	cc->dupacks = 0;
+
+	if (conn->ts_ok && conn->rtt.tsecr != 0) {
+		/* Take RTT sample from timestamp echo (RFC 7323) */
+		tcp_rtt_sample(conn, (usec_t) (tcp_rtt_ts_now() -
+		    conn->rtt.tsecr) * 1000);
+		conn->rtt.tsecr = 0;
+	} else if (conn->rtt.timing &&
+	    (int32_t) (conn->snd_una - conn->rtt.seq) >= 0) {
+		/* Take RTT sample if the timed segment has been acknowledged */
+		conn->rtt.timing = false;
+		tcp_rtt_sample(conn, tcp_cc_now() - conn->rtt.start);
+	}
+
+	if (cc->recovery) {
+		if ((int32_t) (conn->snd_una - cc->recover) >= 0) {
+			/* Full acknowledgement, leave recovery (RFC 6582) */
+			cc->recovery = false;
+			cc->cwnd = min(cc->ssthresh,
+			    max(tcp_cc_flight(conn), conn->smss) + conn->smss);
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: recovery done, "
+			    "cwnd=%" PRIu32, conn->name, cc->cwnd);
+			return;
+		}
+
+		/* Partial acknowledgement, the next segment was lost too */
+		tcp_tqueue_retransmit(conn);
+
+		if (cc->cwnd > cc->ssthresh) {
+			/* Fast recovery, deflate the window */
+			cc->cwnd -= min(acked, cc->cwnd - conn->smss);
+			if (acked >= conn->smss)
+				cc->cwnd += conn->smss;
+			return;
+		}
+
+		/* Recovery after timeout continues in slow start */
+	}
+
+	if (cc->cwnd < cc->ssthresh) {
+		/* Slow start */
+		cc->cwnd += min(acked, conn->smss);
+	} else {
+		/* Congestion avoidance */
+		cc->ops->ack(conn, acked);
+	}
+
+	if (cc->cwnd > TCP_CWND_MAX)
+		cc->cwnd = TCP_CWND_MAX;
+}
+
+/** Duplicate ACK has been received.
+ *
+ * @param conn Connection
+ */
+void tcp_cc_dupack(tcp_conn_t *conn)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	cc->dupacks++;
+
+	if (cc->recovery) {
+		/* Inflate the window by the segment that has left */
+		if (cc->cwnd > cc->ssthresh)
+			cc->cwnd = min(cc->cwnd + conn->smss, TCP_CWND_MAX);
+
+		/* Repair the next hole reported by SACK */
+		if (conn->sack_ok)
+			tcp_tqueue_retransmit(conn);
+		return;
+	}
+
+	if (cc->dupacks != TCP_DUPACK_THRESH)
+		return;
+
+	/* Do not react to losses detected before the last recovery */
+	if ((int32_t) (conn->snd_una - cc->recover) <= 0)
+		return;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: fast retransmit, cwnd=%" PRIu32,
+	    conn->name, cc->cwnd);
+
+	tcp_cc_loss(conn);
+	cc->fast_retransmits++;
+	tcp_tqueue_scoreboard_reset(conn, false);
+	tcp_tqueue_retransmit(conn);
+
+	/* Fast recovery */
+	cc->cwnd = cc->ssthresh + TCP_DUPACK_THRESH * conn->smss;
+}
+
+/** Retransmission timer has expired.
+ *
+ * Called before the first unacknowledged segment is retransmitted.
+ *
+ * @param conn Connection
+ */
+void tcp_cc_timeout(tcp_conn_t *conn)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	cc->timeouts++;
+
+	/* Only the first timeout of a segment reduces the threshold */
+	if (conn->rtt.backoff == 0)
+		tcp_cc_loss(conn);
+	else
+		cc->recover = conn->snd_nxt;
+
+	/* Recovery after timeout proceeds in slow start */
+	cc->recovery = true;
+	cc->cwnd = conn->smss;
+	cc->dupacks = 0;
+
+	/* Back off the timer */
+	conn->rtt.backoff++;
+	conn->rtt.rto = min(2 * conn->rtt.rto, TCP_RTO_MAX);
+}
+
+/** NewReno congestion avoidance, one segment per window of data.
+ *
+ * @param conn Connection
+ * @param acked Number of bytes acknowledged
+ */
+static void newreno_ack(tcp_conn_t *conn, uint32_t acked)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	cc->bytes_acked += acked;
+	if (cc->bytes_acked >= cc->cwnd) {
+		cc->bytes_acked -= cc->cwnd;
+		cc->cwnd += conn->smss;
+	}
+}
+
+/** NewReno reaction to loss.
+ *
+ * @param conn Connection
+ * @return New slow start threshold
+ */
+static uint32_t newreno_loss(tcp_conn_t *conn)
+{
+	return max(tcp_cc_flight(conn) / 2, 2 * conn->smss);
+}
+
+/** Integer cube root.
+ *
+ * @param x Argument
+ * @return Largest integer r such that r^3 <= x
+ */
+static uint64_t cubic_cbrt(uint64_t x)
+{
+	uint64_t r = 0;
+
+	for (int s = 63; s >= 0; s -= 3) {
+		r <<= 1;
+		uint64_t b = 3 * r * (r + 1) + 1;
+		if ((x >> s) >= b) {
+			x -= b << s;
+			r++;
+		}
+	}
+
+	return r;
+}
+
+/** CUBIC congestion avoidance.
+ *
+ * @param conn Connection
+ * @param acked Number of bytes acknowledged
+ */
+static void cubic_ack(tcp_conn_t *conn, uint32_t acked)
+{
+	tcp_cc_t *cc = &conn->cc;
+	usec_t now = tcp_cc_now();
+	uint64_t target;
+	int64_t t;
+
+	if (!cc->epoch_valid) {
+		/* Start of a new congestion avoidance epoch */
+		cc->epoch = now;
+		cc->epoch_valid = true;
+		cc->w_est = cc->cwnd;
+		cc->w_est_acked = 0;
+
+		if (cc->cwnd < cc->w_max) {
+			/* K = cbrt((W_max - cwnd) / C) with C = 0.4 */
+			cc->k = cubic_cbrt((uint64_t) (cc->w_max - cc->cwnd) *
+			    2500000000ULL / conn->smss);
+			cc->w_origin = cc->w_max;
+		} else {
+			cc->k = 0;
+			cc->w_origin = cc->cwnd;
+		}
+	}
+
+	/* Evaluate W_cubic(t + RTT) */
+	t = (int64_t) ((now - cc->epoch + conn->rtt.srtt) / 1000) -
+	    (int64_t) cc->k;
+	if (t > CUBIC_T_MAX)
+		t = CUBIC_T_MAX;
+	if (t < -CUBIC_T_MAX)
+		t = -CUBIC_T_MAX;
+
+	/* C * t^3 in bytes, with t in msec and C = 0.4 segments/s^3 */
+	int64_t off = (t * t * t / 1000) * 4 * conn->smss / 10000000;
+	if (off < 0 && (uint64_t) -off >= cc->w_origin)
+		target = 0;
+	else
+		target = cc->w_origin + off;
+
+	/* Limit growth to 1.5 * cwnd per RTT */
+	if (target > cc->cwnd + cc->cwnd / 2)
+		target = cc->cwnd + cc->cwnd / 2;
+
+	/* Reno-friendly estimate grows by 3(1-beta)/(1+beta) per RTT */
+	cc->w_est_acked += acked;
+	while (cc->w_est_acked >= cc->cwnd / 9 * 17) {
+		cc->w_est_acked -= cc->cwnd / 9 * 17;
+		cc->w_est += conn->smss;
+	}
+
+	if (cc->w_est > target)
+		target = cc->w_est;
+
+	if (target > cc->cwnd)
+		cc->cwnd += (target - cc->cwnd) * acked / cc->cwnd;
+}
+
+/** CUBIC reaction to loss.
+ *
+ * @param conn Connection
+ * @return New slow start threshold
+ */
+static uint32_t cubic_loss(tcp_conn_t *conn)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	/* Fast convergence */
+	if (cc->cwnd < cc->w_max)
+		cc->w_max = cc->cwnd / 20 * (10 + CUBIC_BETA_10);
+	else
+		cc->w_max = cc->cwnd;
+
+	cc->epoch_valid = false;
+	return max(cc->cwnd / 10 * CUBIC_BETA_10, 2 * conn->smss);
+}
+
+/** A segment is being sent, possibly start timing it.
+ *
+ * @param conn Connection
+ * @param seq Sequence number following the segment
+ */
+void tcp_rtt_seg_sent(tcp_conn_t *conn, uint32_t seq)
+{
+	if (conn->rtt.timing)
+		return;
+
+	conn->rtt.timing = true;
+	conn->rtt.seq = seq;
+	conn->rtt.start = tcp_cc_now();
+}
+
+/** A segment is being retransmitted.
+ *
+ * Acknowledgements would be ambiguous, stop timing (Karn's algorithm).
+ *
+ * @param conn Connection
+ */
+void tcp_rtt_seg_retransmitted(tcp_conn_t *conn)
+{
+	conn->rtt.timing = false;
+	conn->cc.retransmits++;
+}
+
+/** Current value of the timestamp clock.
+ *
+ * @return Uptime in milliseconds
+ */
+uint32_t tcp_rtt_ts_now(void)
+{
+	return (uint32_t) (tcp_cc_now() / 1000);
+}
+
+/** Update RTT estimate and retransmission timeout (RFC 6298).
+ *
+ * @param conn Connection
+ * @param r Round-trip time measurement (usec)
+ */
+void tcp_rtt_sample(tcp_conn_t *conn, usec_t r)
+{
+	tcp_rtt_t *rtt = &conn->rtt;
+
+	if (!rtt->valid) {
+		rtt->srtt = r;
+		rtt->rttvar = r / 2;
+		rtt->valid = true;
+	} else {
+		usec_t delta = rtt->srtt > r ? rtt->srtt - r : r - rtt->srtt;
+
+		rtt->rttvar = (3 * rtt->rttvar + delta) / 4;
+		rtt->srtt = (7 * rtt->srtt + r) / 8;
+	}
+
+	rtt->rto = rtt->srtt + max(TCP_RTT_GRANULARITY, 4 * rtt->rttvar);
+	if (rtt->rto < TCP_RTO_MIN)
+		rtt->rto = TCP_RTO_MIN;
+	if (rtt->rto > TCP_RTO_MAX)
+		rtt->rto = TCP_RTO_MAX;
+
+	rtt->backoff = 0;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "%s: RTT sample %" PRIu64 " us, "
+	    "SRTT=%" PRIu64 ", RTTVAR=%" PRIu64 ", RTO=%" PRIu64, conn->name,
+	    (uint64_t) r, (uint64_t) rtt->srtt, (uint64_t) rtt->rttvar,
+	    (uint64_t) rtt->rto);
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tcp
+ * @{
+ */
+/** @file Congestion control and retransmission timeout
+ */
+
+#ifndef CC_H
+#define CC_H
+
+#include <errno.h>
+#include <time.h>
+#include "tcp_type.h"
+
+/** Sender maximum segment size used until one is negotiated */
+#define TCP_SMSS_DEFAULT  1460
+/** Maximum segment size assumed if the peer sends no MSS option */
+#define TCP_MSS_DEFAULT  536
+/** Smallest peer maximum segment size accepted */
+#define TCP_MSS_MIN  64
+/** Space taken by the timestamp option in each segment */
+#define TCP_TS_OPT_SPACE  12
+
+/** Initial retransmission timeout (usec) */
+#define TCP_RTO_INIT  (1000 * 1000)
+/** Minimum retransmission timeout (usec) */
+#define TCP_RTO_MIN  (200 * 1000)
+/** Maximum retransmission timeout (usec) */
+#define TCP_RTO_MAX  (60 * 1000 * 1000)
+
+/** Number of duplicate ACKs that trigger fast retransmit */
+#define TCP_DUPACK_THRESH  3
+
+extern tcp_cc_ops_t tcp_cc_newreno;
+extern tcp_cc_ops_t tcp_cc_cubic;
+
+extern errno_t tcp_cc_select(const char *);
+extern void tcp_cc_init(tcp_conn_t *);
+extern void tcp_cc_mss_set(tcp_conn_t *, uint32_t);
+extern uint32_t tcp_cc_wnd(tcp_conn_t *);
+extern void tcp_cc_ack_received(tcp_conn_t *);
+extern void tcp_cc_dupack(tcp_conn_t *);
+extern void tcp_cc_timeout(tcp_conn_t *);
+
+extern void tcp_rtt_seg_sent(tcp_conn_t *, uint32_t);
+extern void tcp_rtt_seg_retransmitted(tcp_conn_t *);
+extern void tcp_rtt_sample(tcp_conn_t *, usec_t);
+extern uint32_t tcp_rtt_ts_now(void);
+
+#endif
+
+/** @}
+ */
@@ -42,9 +42,12 @@
 #include <nettl/amap.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <time.h>
+#include "cc.h"
 #include "conn.h"
 #include "inet.h"
 #include "iqueue.h"
+#include "ncsim.h"
 #include "pdu.h"
 #include "rqueue.h"
 #include "segment.h"
@@ -53,8 +56,8 @@
 #include "tqueue.h"
 #include "ucall.h"
 
-#define RCV_BUF_SIZE 4096/*2*/
-#define SND_BUF_SIZE 4096
+#define RCV_BUF_SIZE (128 * 1024)
+#define SND_BUF_SIZE (128 * 1024)
 
 #define MAX_SEGMENT_LIFETIME	(15*1000*1000) //(2*60*1000*1000)
 #define TIME_WAIT_TIMEOUT	(2*MAX_SEGMENT_LIFETIME)
@@ -66,7 +69,8 @@ static FIBRIL_MUTEX_INITIALIZE(conn_list_lock);
 /** Connection association map */
 static amap_t *amap;
 /** Taken after tcp_conn_t lock */
-static FIBRIL_MUTEX_INITIALIZE(amap_lock);
+/** Protects the connection map. Lookups only need read access. */
+static FIBRIL_RWLOCK_INITIALIZE(amap_lock);
 
 /** Internal loopback configuration */
 tcp_lb_t tcp_conn_lb = tcp_lb_none;
@@ -152,6 +156,19 @@ tcp_conn_t *tcp_conn_new(inet_ep2_t *epp)
 	/* Set up receive window. */
 	conn->rcv_wnd = conn->rcv_buf_size;
 
+	/* Offer window scaling, timestamps and SACK */
+	conn->ws_ok = true;
+	conn->snd_wscale = 0;
+	conn->rcv_wscale = 0;
+	while ((conn->rcv_buf_size >> conn->rcv_wscale) > UINT16_MAX)
+		conn->rcv_wscale++;
+	conn->ts_ok = true;
+	conn->sack_ok = true;
+
+	/* Set up congestion control */
+	conn->smss = TCP_SMSS_DEFAULT;
+	tcp_cc_init(conn);
+
 	/* Initialize incoming segment queue */
 	tcp_iqueue_init(&conn->incoming, conn);
 
@@ -217,6 +234,16 @@ static void tcp_conn_free(tcp_conn_t *conn)
 	assert(conn->mapped == false);
 	tcp_tqueue_fini(&conn->retransmit);
 
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: %" PRIu64 " bytes out, %" PRIu64
+	    " bytes in, %" PRIu64 " segments/MB, %" PRIu64 " ACKs/MB, %" PRIu64
+	    " us/MB", conn->name, conn->stats.bytes_out, conn->stats.bytes_in,
+	    tcp_xfer_stats_per_mb(conn->stats.segs_out + conn->stats.segs_in,
+	    conn->stats.bytes_out + conn->stats.bytes_in),
+	    tcp_xfer_stats_per_mb(conn->stats.acks_out,
+	    conn->stats.bytes_in),
+	    tcp_xfer_stats_per_mb(conn->stats.proc_nsec / 1000,
+	    conn->stats.bytes_out + conn->stats.bytes_in));
+
 	fibril_mutex_lock(&conn_list_lock);
 	list_remove(&conn->link);
 	fibril_mutex_unlock(&conn_list_lock);
@@ -230,6 +257,36 @@ static void tcp_conn_free(tcp_conn_t *conn)
 	free(conn);
 }
 
+/** Account time spent processing on behalf of connection.
+ *
+ * As segment processing and user calls do not block while doing the
+ * actual work, this approximates the CPU time spent on the connection.
+ *
+ * @param conn		Connection
+ * @param start		Time when processing started
+ */
+void tcp_conn_stats_proc(tcp_conn_t *conn, struct timespec *start)
+{
+	struct timespec now;
+
+	getuptime(&now);
+	conn->stats.proc_nsec += ts_sub_diff(&now, start);
+}
+
+/** Scale transfer statistics counter to one megabyte of data.
+ *
+ * @param cnt		Counter value
+ * @param bytes		Number of bytes transferred
+ * @return		Counter value per MiB transferred
+ */
+uint64_t tcp_xfer_stats_per_mb(uint64_t cnt, uint64_t bytes)
+{
+	if (bytes == 0)
+		return 0;
+
+	return cnt * 1024 * 1024 / bytes;
+}
+
 /** Add reference to connection.
  *
  * Increase connection reference count by one.
@@ -310,20 +367,20 @@ errno_t tcp_conn_add(tcp_conn_t *conn)
 	errno_t rc;
 
 	tcp_conn_addref(conn);
-	fibril_mutex_lock(&amap_lock);
+	fibril_rwlock_write_lock(&amap_lock);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_add: conn=%p", conn);
 
 	rc = amap_insert(amap, &conn->ident, conn, af_allow_system, &aepp);
 	if (rc != EOK) {
 		tcp_conn_delref(conn);
-		fibril_mutex_unlock(&amap_lock);
+		fibril_rwlock_write_unlock(&amap_lock);
 		return rc;
 	}
 
 	conn->ident = aepp;
 	conn->mapped = true;
-	fibril_mutex_unlock(&amap_lock);
+	fibril_rwlock_write_unlock(&amap_lock);
 
 	return EOK;
 }
@@ -337,10 +394,10 @@ static void tcp_conn_remove(tcp_conn_t *conn)
 	if (!conn->mapped)
 		return;
 
-	fibril_mutex_lock(&amap_lock);
+	fibril_rwlock_write_lock(&amap_lock);
 	amap_remove(amap, &conn->ident);
 	conn->mapped = false;
-	fibril_mutex_unlock(&amap_lock);
+	fibril_rwlock_write_unlock(&amap_lock);
 	tcp_conn_delref(conn);
 }
 
@@ -432,19 +489,19 @@ tcp_conn_t *tcp_conn_find_ref(inet_ep2_t *epp)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_find_ref(%p)", epp);
 
-	fibril_mutex_lock(&amap_lock);
+	fibril_rwlock_read_lock(&amap_lock);
 
 	rc = amap_find_match(amap, epp, &arg);
 	if (rc != EOK) {
 		assert(rc == ENOENT);
-		fibril_mutex_unlock(&amap_lock);
+		fibril_rwlock_read_unlock(&amap_lock);
 		return NULL;
 	}
 
 	conn = (tcp_conn_t *)arg;
 	tcp_conn_addref(conn);
 
-	fibril_mutex_unlock(&amap_lock);
+	fibril_rwlock_read_unlock(&amap_lock);
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_find_ref: got conn=%p",
 	    conn);
 	return conn;
@@ -511,6 +568,50 @@ bool tcp_conn_got_syn(tcp_conn_t *conn)
 	assert(false);
 }
 
+/** Process options of received SYN segment.
+ *
+ * Window scaling, timestamps and SACK are only used if both sides
+ * offer them in their SYN segments.
+ *
+ * @param conn		Connection
+ * @param seg		SYN segment
+ */
+static void tcp_conn_syn_opts(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	tcp_seg_opts_t *opts = &seg->opts;
+	uint32_t mss;
+
+	if (conn->ws_ok && (opts->present & TCP_SOPT_WSCALE) != 0) {
+		conn->snd_wscale = opts->wscale;
+	} else {
+		conn->ws_ok = false;
+		conn->snd_wscale = 0;
+		conn->rcv_wscale = 0;
+	}
+
+	if (conn->ts_ok && (opts->present & TCP_SOPT_TS) != 0)
+		conn->ts_recent = opts->tsval;
+	else
+		conn->ts_ok = false;
+
+	if ((opts->present & TCP_SOPT_SACK_PERM) == 0)
+		conn->sack_ok = false;
+
+	mss = (opts->present & TCP_SOPT_MSS) != 0 ? opts->mss :
+	    TCP_MSS_DEFAULT;
+	mss = max(min(mss, TCP_SMSS_DEFAULT), TCP_MSS_MIN);
+
+	/* Leave room for the timestamp option */
+	if (conn->ts_ok)
+		mss -= TCP_TS_OPT_SPACE;
+
+	tcp_cc_mss_set(conn, mss);
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: SMSS=%" PRIu32 ", wscale=%u/%u, "
+	    "ts=%d, sack=%d", conn->name, conn->smss, conn->snd_wscale,
+	    conn->rcv_wscale, conn->ts_ok, conn->sack_ok);
+}
+
 /** Segment arrived in Listen state.
  *
  * @param conn		Connection
@@ -540,6 +641,7 @@ static void tcp_conn_sa_listen(tcp_conn_t *conn, tcp_segment_t *seg)
 
 	conn->rcv_nxt = seg->seq + 1;
 	conn->irs = seg->seq;
+	tcp_conn_syn_opts(conn, seg);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "rcv_nxt=%u", conn->rcv_nxt);
 
@@ -614,6 +716,7 @@ static void tcp_conn_sa_syn_sent(tcp_conn_t *conn, tcp_segment_t *seg)
 
 	conn->rcv_nxt = seg->seq + 1;
 	conn->irs = seg->seq;
+	tcp_conn_syn_opts(conn, seg);
 
 	if ((seg->ctrl & CTL_ACK) != 0) {
 		conn->snd_una = seg->ack;
@@ -662,9 +765,24 @@ static void tcp_conn_sa_syn_sent(tcp_conn_t *conn, tcp_segment_t *seg)
 static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 {
 	tcp_segment_t *pseg;
+	uint32_t rcv_nxt;
+	uint32_t seg_seq;
+	bool has_text;
+	bool had_gap;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_sa_seq(%p, %p)", conn, seg);
 
+	/* Protection against wrapped sequence numbers (RFC 7323) */
+	if (conn->ts_ok && (seg->opts.present & TCP_SOPT_TS) != 0 &&
+	    (seg->ctrl & CTL_RST) == 0 &&
+	    (int32_t) (seg->opts.tsval - conn->ts_recent) < 0) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Replying ACK to segment with "
+		    "old timestamp.");
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+		tcp_segment_delete(seg);
+		return;
+	}
+
 	/* Discard unacceptable segments ("old duplicates") */
 	if (!seq_no_segment_acceptable(conn, seg)) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "Replying ACK to unacceptable segment.");
@@ -673,6 +791,16 @@ static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 		return;
 	}
 
+	/* Remember timestamp to echo (RFC 7323 section 4.3) */
+	if (conn->ts_ok && (seg->opts.present & TCP_SOPT_TS) != 0 &&
+	    (int32_t) (seg->seq - conn->last_ack_sent) <= 0)
+		conn->ts_recent = seg->opts.tsval;
+
+	rcv_nxt = conn->rcv_nxt;
+	has_text = seg->len > 0;
+	seg_seq = seg->seq;
+	had_gap = !list_empty(&conn->incoming.list);
+
 	/* Queue for processing */
 	tcp_iqueue_insert_seg(&conn->incoming, seg);
 
@@ -684,6 +812,19 @@ static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 	 */
 	while (tcp_iqueue_get_ready_seg(&conn->incoming, &pseg) == EOK)
 		tcp_conn_seg_process(conn, pseg);
+
+	/*
+	 * Segment arrived out of order. Send a duplicate ACK immediately
+	 * so that the sender can detect the loss (RFC 5681 section 4.2).
+	 */
+	if (has_text && conn->rcv_nxt == rcv_nxt) {
+		conn->sack_last = seg_seq;
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+	}
+
+	/* Segment filled a gap, do not delay the acknowledgement */
+	if (had_gap && conn->rcv_nxt != rcv_nxt)
+		tcp_tqueue_ack_flush(conn);
 }
 
 /** Process segment RST field.
@@ -802,6 +943,17 @@ static cproc_t tcp_conn_seg_proc_ack_sr(tcp_conn_t *conn, tcp_segment_t *seg)
 	return cp_continue;
 }
 
+/** Get send window advertised by segment.
+ *
+ * @param conn		Connection
+ * @param seg		Segment without SYN
+ * @return		SEG.WND scaled by the window scale of the peer
+ */
+static uint32_t tcp_conn_seg_wnd(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	return seg->wnd << conn->snd_wscale;
+}
+
 /** Process segment ACK field in Established state.
  *
  * @param conn		Connection
@@ -828,14 +980,29 @@ static cproc_t tcp_conn_seg_proc_ack_est(tcp_conn_t *conn, tcp_segment_t *seg)
 			return cp_done;
 		} else {
 			log_msg(LOG_DEFAULT, LVL_DEBUG, "Ignoring duplicate ACK.");
+			if (conn->sack_ok)
+				tcp_tqueue_sack_received(conn, &seg->opts);
+			if (seg->ack == conn->snd_una && seg->len == 0 &&
+			    tcp_conn_seg_wnd(conn, seg) == conn->snd_wnd &&
+			    conn->snd_nxt != conn->snd_una) {
+				/* Duplicate ACK signalling possible loss */
+				tcp_cc_dupack(conn);
+			}
 		}
 	} else {
 		/* Update SND.UNA */
 		conn->snd_una = seg->ack;
+
+		if (conn->sack_ok)
+			tcp_tqueue_sack_received(conn, &seg->opts);
+
+		/* Timestamp echo can be used to measure RTT */
+		if (conn->ts_ok && (seg->opts.present & TCP_SOPT_TS) != 0)
+			conn->rtt.tsecr = seg->opts.tsecr;
 	}
 
 	if (seq_no_new_wnd_update(conn, seg)) {
-		conn->snd_wnd = seg->wnd;
+		conn->snd_wnd = tcp_conn_seg_wnd(conn, seg);
 		conn->snd_wl1 = seg->seq;
 		conn->snd_wl2 = seg->ack;
 
@@ -1078,10 +1245,11 @@ static cproc_t tcp_conn_seg_proc_text(tcp_conn_t *conn, tcp_segment_t *seg)
 
 	/* Update receive window. XXX Not an efficient strategy. */
 	conn->rcv_wnd -= xfer_size;
+	conn->stats.bytes_in += xfer_size;
 
 	/* Send ACK */
 	if (xfer_size > 0)
-		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+		tcp_tqueue_ack_delayed(conn);
 
 	if (xfer_size < seg->len) {
 		/* Trim part of segment which we just received */
@@ -1220,7 +1388,44 @@ static void tcp_conn_seg_process(tcp_conn_t *conn, tcp_segment_t *seg)
 	}
 }
 
+/** Determine if connection identity still matches endpoint pair.
+ *
+ * Unspecified parts of the connection identity match anything.
+ *
+ * @param conn		Connection
+ * @param epp		Endpoint pair
+ * @return		@c true if @a epp matches identity of @a conn
+ */
+static bool tcp_conn_ident_match(tcp_conn_t *conn, inet_ep2_t *epp)
+{
+	inet_ep2_t *ident = &conn->ident;
+
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	if (!inet_addr_is_any(&ident->remote.addr) &&
+	    !inet_addr_compare(&ident->remote.addr, &epp->remote.addr))
+		return false;
+
+	if (ident->remote.port != inet_port_any &&
+	    ident->remote.port != epp->remote.port)
+		return false;
+
+	if (!inet_addr_is_any(&ident->local.addr) &&
+	    !inet_addr_compare(&ident->local.addr, &epp->local.addr))
+		return false;
+
+	if (ident->local.port != inet_port_any &&
+	    ident->local.port != epp->local.port)
+		return false;
+
+	return true;
+}
+
 /** Segment arrived on a connection.
+ *
+ * @a conn was looked up by @a epp without holding the connection lock.
+ * If the connection identity changed in the meantime (e.g. a listening
+ * connection was bound to another peer), the lookup is repeated.
  *
  * @param conn		Connection
  * @param epp		Endpoint pair on which segment was received
@@ -1231,6 +1436,8 @@ void tcp_conn_segment_arrived(tcp_conn_t *conn, inet_ep2_t *epp,
 {
 	inet_ep2_t aepp;
 	inet_ep2_t oldepp;
+	struct timespec start;
+	tcp_conn_t *nconn;
 	errno_t rc;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_conn_segment_arrived(%p)",
@@ -1238,6 +1445,27 @@ void tcp_conn_segment_arrived(tcp_conn_t *conn, inet_ep2_t *epp,
 
 	tcp_conn_lock(conn);
 
+	if (!tcp_conn_ident_match(conn, epp)) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Connection identity "
+		    "changed, repeating lookup.", conn->name);
+		tcp_conn_unlock(conn);
+
+		nconn = tcp_conn_find_ref(epp);
+		if (nconn == NULL) {
+			log_msg(LOG_DEFAULT, LVL_WARN, "No connection found.");
+			tcp_unexpected_segment(epp, seg);
+			return;
+		}
+
+		/* The caller drops its reference to @a conn */
+		tcp_conn_segment_arrived(nconn, epp, seg);
+		tcp_conn_delref(nconn);
+		return;
+	}
+
+	getuptime(&start);
+	conn->stats.segs_in++;
+
 	if (conn->cstate == st_closed) {
 		log_msg(LOG_DEFAULT, LVL_WARN, "Connection is closed.");
 		tcp_unexpected_segment(epp, seg);
@@ -1254,7 +1482,7 @@ void tcp_conn_segment_arrived(tcp_conn_t *conn, inet_ep2_t *epp,
 		oldepp = conn->ident;
 
 		/* Need to remove and re-insert connection with new identity */
-		fibril_mutex_lock(&amap_lock);
+		fibril_rwlock_write_lock(&amap_lock);
 
 		if (inet_addr_is_any(&conn->ident.remote.addr))
 			conn->ident.remote.addr = epp->remote.addr;
@@ -1270,13 +1498,13 @@ void tcp_conn_segment_arrived(tcp_conn_t *conn, inet_ep2_t *epp,
 			assert(rc != EEXIST);
 			assert(rc == ENOMEM);
 			log_msg(LOG_DEFAULT, LVL_ERROR, "Out of memory.");
-			fibril_mutex_unlock(&amap_lock);
+			fibril_rwlock_write_unlock(&amap_lock);
 			tcp_conn_unlock(conn);
 			return;
 		}
 
 		amap_remove(amap, &oldepp);
-		fibril_mutex_unlock(&amap_lock);
+		fibril_rwlock_write_unlock(&amap_lock);
 
 		conn->name = (char *) "a";
 	}
@@ -1304,6 +1532,7 @@ void tcp_conn_segment_arrived(tcp_conn_t *conn, inet_ep2_t *epp,
 		assert(false);
 	}
 
+	tcp_conn_stats_proc(conn, &start);
 	tcp_conn_unlock(conn);
 }
 
@@ -1411,9 +1640,6 @@ static void tcp_transmit_segment(inet_ep2_t *epp, tcp_segment_t *seg)
 
 	if (tcp_conn_lb == tcp_lb_segment) {
 		/* Loop back segment */
-#if 0
-		tcp_ncsim_bounce_seg(sp, seg);
-#endif
 
 		/* Reverse the identification */
 		tcp_ep2_flipped(epp, &rident);
@@ -1424,6 +1650,18 @@ static void tcp_transmit_segment(inet_ep2_t *epp, tcp_segment_t *seg)
 		return;
 	}
 
+	if (tcp_conn_lb == tcp_lb_ncsim) {
+		/* Loop back segment through network condition simulator */
+		dseg = tcp_segment_dup(seg);
+		if (dseg == NULL) {
+			log_msg(LOG_DEFAULT, LVL_WARN, "Not enough memory. Segment dropped.");
+			return;
+		}
+
+		tcp_ncsim_bounce_seg(epp, dseg);
+		return;
+	}
+
 	if (tcp_pdu_encode(epp, seg, &pdu) != EOK) {
 		log_msg(LOG_DEFAULT, LVL_WARN, "Not enough memory. Segment dropped.");
 		return;
@@ -37,6 +37,7 @@
 
 #include <inet/endpoint.h>
 #include <stdbool.h>
+#include <time.h>
 #include "tcp_type.h"
 
 extern errno_t tcp_conns_init(void);
@@ -50,6 +51,8 @@ extern void tcp_conn_fin_sent(tcp_conn_t *);
 extern tcp_conn_t *tcp_conn_find_ref(inet_ep2_t *);
 extern void tcp_conn_addref(tcp_conn_t *);
 extern void tcp_conn_delref(tcp_conn_t *);
+extern void tcp_conn_stats_proc(tcp_conn_t *, struct timespec *);
+extern uint64_t tcp_xfer_stats_per_mb(uint64_t, uint64_t);
 extern void tcp_conn_lock(tcp_conn_t *);
 extern void tcp_conn_unlock(tcp_conn_t *);
 extern bool tcp_conn_got_syn(tcp_conn_t *);
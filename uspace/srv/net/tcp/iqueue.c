@@ -186,6 +186,73 @@ errno_t tcp_iqueue_get_ready_seg(tcp_iqueue_t *iqueue, tcp_segment_t **seg)
 	return EOK;
 }
 
+/** Describe out-of-order data held in incoming queue as SACK blocks.
+ *
+ * Following RFC 2018 the first block is the one containing the most
+ * recently received segment, the remaining blocks follow in order of
+ * sequence numbers.
+ *
+ * @param iqueue	Incoming queue
+ * @param opts		Segment options to fill in
+ * @param max		Maximum number of blocks
+ */
+void tcp_iqueue_sack_blocks(tcp_iqueue_t *iqueue, tcp_seg_opts_t *opts,
+    unsigned max)
+{
+	tcp_conn_t *conn = iqueue->conn;
+	tcp_sack_block_t blk[TCP_SACK_BLOCKS_MAX + 1];
+	unsigned nblk = 0;
+	unsigned first = 0;
+	uint32_t seq, end;
+	unsigned i;
+
+	assert(max <= TCP_SACK_BLOCKS_MAX);
+
+	list_foreach(iqueue->list, link, tcp_iqueue_entry_t, iqe) {
+		seq = iqe->seg->seq;
+		end = seq + iqe->seg->len;
+
+		/* Only data above RCV.NXT */
+		if ((int32_t) (seq - conn->rcv_nxt) <= 0)
+			continue;
+
+		if (nblk > 0 && (int32_t) (seq - blk[nblk - 1].end) <= 0) {
+			/* Extend current block */
+			if ((int32_t) (end - blk[nblk - 1].end) > 0)
+				blk[nblk - 1].end = end;
+			continue;
+		}
+
+		if (nblk == TCP_SACK_BLOCKS_MAX + 1)
+			break;
+
+		blk[nblk].start = seq;
+		blk[nblk].end = end;
+		nblk++;
+	}
+
+	opts->sack_cnt = 0;
+	if (nblk == 0 || max == 0)
+		return;
+
+	/* Find the block containing the last out-of-order segment */
+	for (i = 0; i < nblk; i++) {
+		if ((int32_t) (conn->sack_last - blk[i].start) >= 0 &&
+		    (int32_t) (conn->sack_last - blk[i].end) < 0) {
+			first = i;
+			break;
+		}
+	}
+
+	opts->sack[opts->sack_cnt++] = blk[first];
+	for (i = 0; i < nblk && opts->sack_cnt < max; i++) {
+		if (i != first)
+			opts->sack[opts->sack_cnt++] = blk[i];
+	}
+
+	opts->present |= TCP_SOPT_SACK;
+}
+
 /**
  * @}
  */
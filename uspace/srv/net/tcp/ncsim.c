@@ -34,8 +34,8 @@
  * @file Network condition simulator
  *
  * Simulate network conditions for testing the reliability implementation:
- *    - variable latency
- *    - frame drop
+ *    - variable latency (with reordering)
+ *    - deterministic segment drop
  */
 
 #include <adt/list.h>
@@ -43,8 +43,10 @@
 #include <errno.h>
 #include <inet/endpoint.h>
 #include <io/log.h>
+#include <mem.h>
 #include <stdlib.h>
 #include <fibril.h>
+#include <time.h>
 #include "conn.h"
 #include "ncsim.h"
 #include "rqueue.h"
@@ -54,68 +56,125 @@
 static list_t sim_queue;
 static fibril_mutex_t sim_queue_lock;
 static fibril_condvar_t sim_queue_cv;
+static bool fibril_active;
+static bool sim_quit;
 
-/** Initialize segment receive queue. */
+/** Simulated conditions */
+static tcp_ncsim_cfg_t sim_cfg;
+/** Number of data segments seen */
+static unsigned sim_data_cnt;
+
+/** Initialize network condition simulator. */
 void tcp_ncsim_init(void)
 {
 	list_initialize(&sim_queue);
 	fibril_mutex_initialize(&sim_queue_lock);
 	fibril_condvar_initialize(&sim_queue_cv);
+	fibril_active = false;
+	sim_quit = false;
+	memset(&sim_cfg, 0, sizeof(sim_cfg));
+	sim_data_cnt = 0;
+}
+
+/** Finalize network condition simulator.
+ *
+ * Stops the handler fibril. Segments still in flight are dropped.
+ */
+void tcp_ncsim_fini(void)
+{
+	fibril_mutex_lock(&sim_queue_lock);
+	sim_quit = true;
+	fibril_condvar_broadcast(&sim_queue_cv);
+	while (fibril_active)
+		fibril_condvar_wait(&sim_queue_cv, &sim_queue_lock);
+	fibril_mutex_unlock(&sim_queue_lock);
+}
+
+/** Configure simulated network conditions.
+ *
+ * @param cfg	Configuration
+ */
+void tcp_ncsim_config(const tcp_ncsim_cfg_t *cfg)
+{
+	fibril_mutex_lock(&sim_queue_lock);
+	sim_cfg = *cfg;
+	sim_data_cnt = 0;
+	fibril_mutex_unlock(&sim_queue_lock);
+}
+
+/** Current uptime in microseconds. */
+static usec_t tcp_ncsim_now(void)
+{
+	struct timespec ts;
+
+	getuptime(&ts);
+	return SEC2USEC(ts.tv_sec) + NSEC2USEC(ts.tv_nsec);
 }
 
 /** Bounce segment through simulator into receive queue.
+ *
+ * Every n-th data segment is dropped if configured so. Other segments
+ * are delivered after a delay chosen uniformly from the configured range.
  *
  * @param epp	Endpoint pair, oriented for transmission
- * @param seg	Segment
+ * @param seg	Segment (ownership transferred to simulator)
  */
 void tcp_ncsim_bounce_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 {
 	tcp_squeue_entry_t *sqe;
-	tcp_squeue_entry_t *old_qe;
 	inet_ep2_t rident;
-	link_t *link;
+	usec_t delay;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_ncsim_bounce_seg()");
 	tcp_ep2_flipped(epp, &rident);
-	tcp_rqueue_insert_seg(&rident, seg);
-	return;
 
-	if (0 /* rand() % 4 == 3 */) {
-		/* Drop segment */
-		log_msg(LOG_DEFAULT, LVL_ERROR, "NCSim dropping segment");
-		tcp_segment_delete(seg);
+	fibril_mutex_lock(&sim_queue_lock);
+
+	if (sim_cfg.drop_nth != 0 && seg->len > 0 &&
+	    (seg->ctrl & CTL_SYN) == 0) {
+		if (++sim_data_cnt % sim_cfg.drop_nth == 0) {
+			/* Drop segment */
+			fibril_mutex_unlock(&sim_queue_lock);
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "NCSim dropping segment "
+			    "SEG.SEQ=%" PRIu32, seg->seq);
+			tcp_segment_delete(seg);
+			return;
+		}
+	}
+
+	delay = sim_cfg.delay_min;
+	if (sim_cfg.delay_max > sim_cfg.delay_min)
+		delay += rand() % (sim_cfg.delay_max - sim_cfg.delay_min + 1);
+
+	if (delay == 0) {
+		fibril_mutex_unlock(&sim_queue_lock);
+		tcp_rqueue_insert_seg(&rident, seg);
 		return;
 	}
 
 	sqe = calloc(1, sizeof(tcp_squeue_entry_t));
 	if (sqe == NULL) {
+		fibril_mutex_unlock(&sim_queue_lock);
 		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed allocating SQE.");
+		tcp_segment_delete(seg);
 		return;
 	}
 
-	sqe->delay = rand() % (1000 * 1000);
-	sqe->epp = *epp;
+	sqe->due = tcp_ncsim_now() + delay;
+	sqe->epp = rident;
 	sqe->seg = seg;
 
-	fibril_mutex_lock(&sim_queue_lock);
-
-	link = list_first(&sim_queue);
-	while (link != NULL && sqe->delay > 0) {
-		old_qe = list_get_instance(link, tcp_squeue_entry_t, link);
-		if (sqe->delay < old_qe->delay)
+	/* Keep the queue sorted by delivery time */
+	list_foreach_rev(sim_queue, link, tcp_squeue_entry_t, old_qe) {
+		if (old_qe->due <= sqe->due) {
+			list_insert_after(&sqe->link, &old_qe->link);
+			sqe = NULL;
 			break;
-
-		sqe->delay -= old_qe->delay;
-
-		link = link->next;
-		if (link == &sim_queue.head)
-			link = NULL;
+		}
 	}
 
-	if (link != NULL)
-		list_insert_after(&sqe->link, link);
-	else
-		list_append(&sqe->link, &sim_queue);
+	if (sqe != NULL)
+		list_prepend(&sqe->link, &sim_queue);
 
 	fibril_condvar_broadcast(&sim_queue_cv);
 	fibril_mutex_unlock(&sim_queue_lock);
@@ -126,36 +185,50 @@ static errno_t tcp_ncsim_fibril(void *arg)
 {
 	link_t *link;
 	tcp_squeue_entry_t *sqe;
-	inet_ep2_t rident;
-	errno_t rc;
+	usec_t now;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_ncsim_fibril()");
 
-	while (true) {
-		fibril_mutex_lock(&sim_queue_lock);
+	fibril_mutex_lock(&sim_queue_lock);
 
-		while (list_empty(&sim_queue))
+	while (!sim_quit) {
+		link = list_first(&sim_queue);
+		if (link == NULL) {
 			fibril_condvar_wait(&sim_queue_cv, &sim_queue_lock);
+			continue;
+		}
 
-		do {
-			link = list_first(&sim_queue);
-			sqe = list_get_instance(link, tcp_squeue_entry_t, link);
-
-			log_msg(LOG_DEFAULT, LVL_DEBUG, "NCSim - Sleep");
-			rc = fibril_condvar_wait_timeout(&sim_queue_cv,
-			    &sim_queue_lock, sqe->delay);
-		} while (rc != ETIMEOUT);
+		sqe = list_get_instance(link, tcp_squeue_entry_t, link);
+		now = tcp_ncsim_now();
+		if (sqe->due > now) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG2, "NCSim - Sleep");
+			(void) fibril_condvar_wait_timeout(&sim_queue_cv,
+			    &sim_queue_lock, sqe->due - now);
+			continue;
+		}
 
 		list_remove(link);
 		fibril_mutex_unlock(&sim_queue_lock);
 
-		log_msg(LOG_DEFAULT, LVL_DEBUG, "NCSim - End Sleep");
-		tcp_ep2_flipped(&sqe->epp, &rident);
-		tcp_rqueue_insert_seg(&rident, sqe->seg);
+		log_msg(LOG_DEFAULT, LVL_DEBUG2, "NCSim - Deliver");
+		tcp_rqueue_insert_seg(&sqe->epp, sqe->seg);
+		free(sqe);
+
+		fibril_mutex_lock(&sim_queue_lock);
+	}
+
+	/* Drop segments still in flight */
+	while ((link = list_first(&sim_queue)) != NULL) {
+		sqe = list_get_instance(link, tcp_squeue_entry_t, link);
+		list_remove(link);
+		tcp_segment_delete(sqe->seg);
 		free(sqe);
 	}
 
-	/* Not reached */
+	fibril_active = false;
+	fibril_condvar_broadcast(&sim_queue_cv);
+	fibril_mutex_unlock(&sim_queue_lock);
+
 	return 0;
 }
 
@@ -172,6 +245,11 @@ void tcp_ncsim_fibril_start(void)
 		return;
 	}
 
+	fibril_mutex_lock(&sim_queue_lock);
+	sim_quit = false;
+	fibril_active = true;
+	fibril_mutex_unlock(&sim_queue_lock);
+
 	fibril_add_ready(fid);
 }
 
@@ -34,10 +34,12 @@
  * @file TCP header encoding and decoding
  */
 
+#include <adt/checksum.h>
 #include <bitops.h>
 #include <byteorder.h>
 #include <errno.h>
 #include <inet/endpoint.h>
+#include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
 #include "pdu.h"
@@ -46,44 +48,6 @@
 #include "std.h"
 #include "tcp_type.h"
 
-#define TCP_CHECKSUM_INIT 0xffff
-
-/** One's complement addition.
- *
- * Result is a + b + carry.
- */
-static uint16_t tcp_ocadd16(uint16_t a, uint16_t b)
-{
-	uint32_t s;
-
-	s = (uint32_t)a + (uint32_t)b;
-	return (s & 0xffff) + (s >> 16);
-}
-
-static uint16_t tcp_checksum_calc(uint16_t ivalue, void *data, size_t size)
-{
-	uint16_t sum;
-	uint16_t w;
-	size_t words, i;
-	uint8_t *bdata;
-
-	sum = ~ivalue;
-	words = size / 2;
-	bdata = (uint8_t *)data;
-
-	for (i = 0; i < words; i++) {
-		w = ((uint16_t)bdata[2 * i] << 8) | bdata[2 * i + 1];
-		sum = tcp_ocadd16(sum, w);
-	}
-
-	if (size % 2 != 0) {
-		w = ((uint16_t)bdata[2 * words] << 8);
-		sum = tcp_ocadd16(sum, w);
-	}
-
-	return ~sum;
-}
-
 static void tcp_header_decode_flags(uint16_t doff_flags, tcp_control_t *rctl)
 {
 	tcp_control_t ctl;
@@ -125,7 +89,177 @@ static void tcp_header_encode_flags(tcp_control_t ctl, uint16_t doff_flags0,
 	*rdoff_flags = doff_flags;
 }
 
-static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg, tcp_header_t *hdr)
+/** Store 32-bit value in network byte order at unaligned address. */
+static void tcp_opt_put32(uint8_t *buf, uint32_t val)
+{
+	buf[0] = val >> 24;
+	buf[1] = (val >> 16) & 0xff;
+	buf[2] = (val >> 8) & 0xff;
+	buf[3] = val & 0xff;
+}
+
+/** Load 32-bit value in network byte order from unaligned address. */
+static uint32_t tcp_opt_get32(uint8_t *buf)
+{
+	return ((uint32_t) buf[0] << 24) | ((uint32_t) buf[1] << 16) |
+	    ((uint32_t) buf[2] << 8) | buf[3];
+}
+
+/** Encode TCP options.
+ *
+ * Options are laid out so that multi-byte fields are aligned
+ * (RFC 7323 appendix A) and padded to a multiple of four bytes.
+ *
+ * @param opts	Segment options
+ * @param buf	Buffer of at least TCP_OPTS_MAX_SIZE bytes
+ * @return	Size of encoded options in bytes
+ */
+static size_t tcp_opts_encode(tcp_seg_opts_t *opts, uint8_t *buf)
+{
+	size_t off = 0;
+	unsigned i;
+
+	if ((opts->present & TCP_SOPT_MSS) != 0) {
+		buf[off++] = OPT_MAX_SEG_SIZE;
+		buf[off++] = OPT_MAX_SEG_SIZE_LEN;
+		buf[off++] = opts->mss >> 8;
+		buf[off++] = opts->mss & 0xff;
+	}
+
+	if ((opts->present & TCP_SOPT_WSCALE) != 0) {
+		buf[off++] = OPT_NOP;
+		buf[off++] = OPT_WINDOW_SCALE;
+		buf[off++] = OPT_WINDOW_SCALE_LEN;
+		buf[off++] = opts->wscale;
+	}
+
+	if ((opts->present & TCP_SOPT_SACK_PERM) != 0) {
+		if ((opts->present & TCP_SOPT_TS) == 0) {
+			buf[off++] = OPT_NOP;
+			buf[off++] = OPT_NOP;
+		}
+		buf[off++] = OPT_SACK_PERMITTED;
+		buf[off++] = OPT_SACK_PERMITTED_LEN;
+	} else if ((opts->present & TCP_SOPT_TS) != 0) {
+		buf[off++] = OPT_NOP;
+		buf[off++] = OPT_NOP;
+	}
+
+	if ((opts->present & TCP_SOPT_TS) != 0) {
+		buf[off++] = OPT_TIMESTAMP;
+		buf[off++] = OPT_TIMESTAMP_LEN;
+		tcp_opt_put32(&buf[off], opts->tsval);
+		off += sizeof(uint32_t);
+		tcp_opt_put32(&buf[off], opts->tsecr);
+		off += sizeof(uint32_t);
+	}
+
+	if ((opts->present & TCP_SOPT_SACK) != 0 && opts->sack_cnt > 0) {
+		/* Drop blocks that do not fit */
+		while (off + 4 + 8 * opts->sack_cnt > TCP_OPTS_MAX_SIZE)
+			opts->sack_cnt--;
+
+		buf[off++] = OPT_NOP;
+		buf[off++] = OPT_NOP;
+		buf[off++] = OPT_SACK;
+		buf[off++] = OPT_SACK_LEN + 8 * opts->sack_cnt;
+		for (i = 0; i < opts->sack_cnt; i++) {
+			tcp_opt_put32(&buf[off], opts->sack[i].start);
+			off += sizeof(uint32_t);
+			tcp_opt_put32(&buf[off], opts->sack[i].end);
+			off += sizeof(uint32_t);
+		}
+	}
+
+	assert(off <= TCP_OPTS_MAX_SIZE);
+	assert(off % 4 == 0);
+	return off;
+}
+
+/** Decode TCP options.
+ *
+ * Malformed and unknown options are ignored.
+ *
+ * @param buf	Options
+ * @param size	Size of options in bytes
+ * @param opts	Place to store decoded options
+ */
+static void tcp_opts_decode(uint8_t *buf, size_t size, tcp_seg_opts_t *opts)
+{
+	size_t off = 0;
+	uint8_t kind;
+	uint8_t len;
+	unsigned i;
+
+	memset(opts, 0, sizeof(tcp_seg_opts_t));
+
+	while (off < size) {
+		kind = buf[off];
+		if (kind == OPT_END_LIST)
+			break;
+
+		if (kind == OPT_NOP) {
+			off++;
+			continue;
+		}
+
+		if (off + 1 >= size)
+			break;
+
+		len = buf[off + 1];
+		if (len < 2 || off + len > size)
+			break;
+
+		switch (kind) {
+		case OPT_MAX_SEG_SIZE:
+			if (len != OPT_MAX_SEG_SIZE_LEN)
+				break;
+			opts->present |= TCP_SOPT_MSS;
+			opts->mss = ((uint16_t) buf[off + 2] << 8) |
+			    buf[off + 3];
+			break;
+		case OPT_WINDOW_SCALE:
+			if (len != OPT_WINDOW_SCALE_LEN)
+				break;
+			opts->present |= TCP_SOPT_WSCALE;
+			opts->wscale = min(buf[off + 2], TCP_WSCALE_MAX);
+			break;
+		case OPT_SACK_PERMITTED:
+			if (len != OPT_SACK_PERMITTED_LEN)
+				break;
+			opts->present |= TCP_SOPT_SACK_PERM;
+			break;
+		case OPT_TIMESTAMP:
+			if (len != OPT_TIMESTAMP_LEN)
+				break;
+			opts->present |= TCP_SOPT_TS;
+			opts->tsval = tcp_opt_get32(&buf[off + 2]);
+			opts->tsecr = tcp_opt_get32(&buf[off + 6]);
+			break;
+		case OPT_SACK:
+			if ((len - OPT_SACK_LEN) % 8 != 0 ||
+			    len == OPT_SACK_LEN)
+				break;
+			opts->present |= TCP_SOPT_SACK;
+			opts->sack_cnt = min((len - OPT_SACK_LEN) / 8,
+			    TCP_SACK_BLOCKS_MAX);
+			for (i = 0; i < opts->sack_cnt; i++) {
+				opts->sack[i].start = tcp_opt_get32(
+				    &buf[off + 2 + 8 * i]);
+				opts->sack[i].end = tcp_opt_get32(
+				    &buf[off + 6 + 8 * i]);
+			}
+			break;
+		default:
+			break;
+		}
+
+		off += len;
+	}
+}
+
+static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg,
+    tcp_header_t *hdr, size_t hdr_size)
 {
 	uint16_t doff_flags;
 	uint16_t doff;
@@ -135,7 +269,7 @@ static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg, tcp_header_t *
 	hdr->seq = host2uint32_t_be(seg->seq);
 	hdr->ack = host2uint32_t_be(seg->ack);
 
-	doff = (sizeof(tcp_header_t) / sizeof(uint32_t)) << DF_DATA_OFFSET_l;
+	doff = (hdr_size / sizeof(uint32_t)) << DF_DATA_OFFSET_l;
 	tcp_header_encode_flags(seg->ctrl, doff, &doff_flags);
 
 	hdr->doff_flags = host2uint16_t_be(doff_flags);
@@ -194,14 +328,19 @@ static errno_t tcp_header_encode(inet_ep2_t *epp, tcp_segment_t *seg,
     void **header, size_t *size)
 {
 	tcp_header_t *hdr;
+	uint8_t opts[TCP_OPTS_MAX_SIZE];
+	size_t opts_size;
+
+	opts_size = tcp_opts_encode(&seg->opts, opts);
 
-	hdr = calloc(1, sizeof(tcp_header_t));
+	hdr = calloc(1, sizeof(tcp_header_t) + opts_size);
 	if (hdr == NULL)
 		return ENOMEM;
 
-	tcp_header_setup(epp, seg, hdr);
+	tcp_header_setup(epp, seg, hdr, sizeof(tcp_header_t) + opts_size);
+	memcpy((uint8_t *) hdr + sizeof(tcp_header_t), opts, opts_size);
 	*header = hdr;
-	*size = sizeof(tcp_header_t);
+	*size = sizeof(tcp_header_t) + opts_size;
 
 	return EOK;
 }
@@ -262,27 +401,27 @@ void tcp_pdu_delete(tcp_pdu_t *pdu)
 
 static uint16_t tcp_pdu_checksum_calc(tcp_pdu_t *pdu)
 {
-	uint16_t cs_phdr;
-	uint16_t cs_headers;
+	ocsum_t cs;
 	tcp_phdr_t phdr;
 	tcp_phdr6_t phdr6;
 
+	ocsum_init(&cs);
+
 	ip_ver_t ver = tcp_phdr_setup(pdu, &phdr, &phdr6);
 	switch (ver) {
 	case ip_v4:
-		cs_phdr = tcp_checksum_calc(TCP_CHECKSUM_INIT, (void *) &phdr,
-		    sizeof(tcp_phdr_t));
+		ocsum_add(&cs, &phdr, sizeof(tcp_phdr_t));
 		break;
 	case ip_v6:
-		cs_phdr = tcp_checksum_calc(TCP_CHECKSUM_INIT, (void *) &phdr6,
-		    sizeof(tcp_phdr6_t));
+		ocsum_add(&cs, &phdr6, sizeof(tcp_phdr6_t));
 		break;
 	default:
 		assert(false);
 	}
 
-	cs_headers = tcp_checksum_calc(cs_phdr, pdu->header, pdu->header_size);
-	return tcp_checksum_calc(cs_headers, pdu->text, pdu->text_size);
+	ocsum_add(&cs, pdu->header, pdu->header_size);
+	ocsum_add(&cs, pdu->text, pdu->text_size);
+	return ocsum_get(&cs);
 }
 
 static void tcp_pdu_set_checksum(tcp_pdu_t *pdu, uint16_t checksum)
@@ -306,6 +445,11 @@ errno_t tcp_pdu_decode(tcp_pdu_t *pdu, inet_ep2_t *epp, tcp_segment_t **seg)
 	tcp_header_decode(pdu->header, nseg);
 	nseg->len += seq_no_control_len(nseg->ctrl);
 
+	if (pdu->header_size > sizeof(tcp_header_t)) {
+		tcp_opts_decode((uint8_t *) pdu->header + sizeof(tcp_header_t),
+		    pdu->header_size - sizeof(tcp_header_t), &nseg->opts);
+	}
+
 	hdr = (tcp_header_t *)pdu->header;
 
 	epp->local.port = uint16_t_be2host(hdr->dest_port);
@@ -32,9 +32,16 @@
 
 /**
  * @file Global segment receive queue
+ *
+ * Incoming segments are distributed among several worker fibrils. The
+ * worker is selected by hashing the endpoint pair, so all segments of one
+ * connection are processed by the same worker in the order of arrival,
+ * while segments of unrelated connections can be processed concurrently
+ * (e.g. while another worker waits for IPC or for a connection lock).
  */
 
 #include <adt/prodcons.h>
+#include <assert.h>
 #include <errno.h>
 #include <io/log.h>
 #include <stdbool.h>
@@ -47,36 +54,99 @@
 #include "tcp_type.h"
 #include "ucall.h"
 
-static prodcons_t rqueue;
-static bool fibril_active;
+/** Receive queue worker */
+typedef struct {
+	/** Segments waiting for processing */
+	prodcons_t queue;
+	/** Entry telling the worker to quit */
+	tcp_rqueue_entry_t quit;
+} tcp_rqueue_worker_t;
+
+static tcp_rqueue_worker_t workers[TCP_RQUEUE_WORKERS_MAX];
+static unsigned nworkers = TCP_RQUEUE_WORKERS_DEFAULT;
+static unsigned active_workers;
 static fibril_mutex_t lock;
 static fibril_condvar_t cv;
 static tcp_rqueue_cb_t *rqueue_cb;
 
+/** Set number of receive queue workers.
+ *
+ * Must be called before tcp_rqueue_init().
+ *
+ * @param n	Number of workers (1 to TCP_RQUEUE_WORKERS_MAX)
+ * @return	EOK on success, EINVAL if @a n is out of range
+ */
+errno_t tcp_rqueue_set_workers(unsigned n)
+{
+	if (n < 1 || n > TCP_RQUEUE_WORKERS_MAX)
+		return EINVAL;
+
+	nworkers = n;
+	return EOK;
+}
+
 /** Initialize segment receive queue. */
 void tcp_rqueue_init(tcp_rqueue_cb_t *rcb)
 {
-	prodcons_initialize(&rqueue);
+	unsigned i;
+
+	for (i = 0; i < nworkers; i++)
+		prodcons_initialize(&workers[i].queue);
+
 	fibril_mutex_initialize(&lock);
 	fibril_condvar_initialize(&cv);
-	fibril_active = false;
+	active_workers = 0;
 	rqueue_cb = rcb;
 }
 
 /** Finalize segment receive queue. */
 void tcp_rqueue_fini(void)
 {
-	inet_ep2_t epp;
+	unsigned i;
 
-	inet_ep2_init(&epp);
-	tcp_rqueue_insert_seg(&epp, NULL);
+	/* Tell each worker to quit once it has processed its queue */
+	for (i = 0; i < nworkers; i++) {
+		workers[i].quit.seg = NULL;
+		prodcons_produce(&workers[i].queue, &workers[i].quit.link);
+	}
 
 	fibril_mutex_lock(&lock);
-	while (fibril_active)
+	while (active_workers > 0)
 		fibril_condvar_wait(&cv, &lock);
 	fibril_mutex_unlock(&lock);
 }
 
+/** Select worker for endpoint pair.
+ *
+ * @param epp	Endpoint pair
+ * @return	Worker index
+ */
+static unsigned tcp_rqueue_worker_idx(inet_ep2_t *epp)
+{
+	uint32_t hash;
+	unsigned i;
+
+	if (nworkers == 1)
+		return 0;
+
+	/* FNV-1a over ports and addresses */
+	hash = 2166136261u;
+	hash = (hash ^ epp->local.port) * 16777619u;
+	hash = (hash ^ epp->remote.port) * 16777619u;
+
+	if (epp->remote.addr.version == ip_v6) {
+		for (i = 0; i < 16; i++) {
+			hash = (hash ^ epp->remote.addr.addr6[i]) * 16777619u;
+			hash = (hash ^ epp->local.addr.addr6[i]) * 16777619u;
+		}
+	} else {
+		hash = (hash ^ epp->remote.addr.addr) * 16777619u;
+		hash = (hash ^ epp->local.addr.addr) * 16777619u;
+	}
+
+	return (hash ^ (hash >> 16)) % nworkers;
+}
+
 /** Insert segment into receive queue.
  *
  * @param epp	Endpoint pair, oriented for reception
@@ -88,8 +158,8 @@ void tcp_rqueue_insert_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "tcp_rqueue_insert_seg()");
 
-	if (seg != NULL)
-		tcp_segment_dump(seg);
+	assert(seg != NULL);
+	tcp_segment_dump(seg);
 
 	rqe = calloc(1, sizeof(tcp_rqueue_entry_t));
 	if (rqe == NULL) {
@@ -100,25 +170,28 @@ void tcp_rqueue_insert_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 	rqe->epp = *epp;
 	rqe->seg = seg;
 
-	prodcons_produce(&rqueue, &rqe->link);
+	prodcons_produce(&workers[tcp_rqueue_worker_idx(epp)].queue,
+	    &rqe->link);
 }
 
-/** Receive queue handler fibril. */
+/** Receive queue worker fibril.
+ *
+ * @param arg	Worker (tcp_rqueue_worker_t *)
+ */
 static errno_t tcp_rqueue_fibril(void *arg)
 {
+	tcp_rqueue_worker_t *worker = (tcp_rqueue_worker_t *) arg;
 	link_t *link;
 	tcp_rqueue_entry_t *rqe;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_rqueue_fibril()");
 
 	while (true) {
-		link = prodcons_consume(&rqueue);
+		link = prodcons_consume(&worker->queue);
 		rqe = list_get_instance(link, tcp_rqueue_entry_t, link);
 
-		if (rqe->seg == NULL) {
-			free(rqe);
+		if (rqe == &worker->quit)
 			break;
-		}
 
 		rqueue_cb->seg_received(&rqe->epp, rqe->seg);
 		free(rqe);
@@ -128,28 +201,35 @@ static errno_t tcp_rqueue_fibril(void *arg)
 
 	/* Finished */
 	fibril_mutex_lock(&lock);
-	fibril_active = false;
+	active_workers--;
 	fibril_mutex_unlock(&lock);
 	fibril_condvar_broadcast(&cv);
 
 	return 0;
 }
 
-/** Start receive queue handler fibril. */
+/** Start receive queue worker fibrils. */
 void tcp_rqueue_fibril_start(void)
 {
 	fid_t fid;
+	unsigned i;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_rqueue_fibril_start()");
 
-	fid = fibril_create(tcp_rqueue_fibril, NULL);
-	if (fid == 0) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed creating rqueue fibril.");
-		return;
-	}
+	for (i = 0; i < nworkers; i++) {
+		fid = fibril_create(tcp_rqueue_fibril, &workers[i]);
+		if (fid == 0) {
+			log_msg(LOG_DEFAULT, LVL_ERROR, "Failed creating "
+			    "rqueue fibril.");
+			return;
+		}
+
+		fibril_mutex_lock(&lock);
+		active_workers++;
+		fibril_mutex_unlock(&lock);
 
-	fibril_add_ready(fid);
-	fibril_active = true;
+		fibril_add_ready(fid);
+	}
 }
 
 /**
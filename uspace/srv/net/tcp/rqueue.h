@@ -35,9 +35,16 @@
 #ifndef RQUEUE_H
 #define RQUEUE_H
 
+#include <errno.h>
 #include <inet/endpoint.h>
 #include "tcp_type.h"
 
+/** Maximum number of receive queue workers */
+#define TCP_RQUEUE_WORKERS_MAX  16
+/** Default number of receive queue workers */
+#define TCP_RQUEUE_WORKERS_DEFAULT  4
+
+extern errno_t tcp_rqueue_set_workers(unsigned);
 extern void tcp_rqueue_init(tcp_rqueue_cb_t *);
 extern void tcp_rqueue_fibril_start(void);
 extern void tcp_rqueue_fini(void);
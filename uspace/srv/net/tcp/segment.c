@@ -74,6 +74,7 @@ tcp_segment_t *tcp_segment_dup(tcp_segment_t *seg)
 	scopy->len = seg->len;
 	scopy->wnd = seg->wnd;
 	scopy->up = seg->up;
+	scopy->opts = seg->opts;
 
 	tsize = tcp_segment_text_size(seg);
 	scopy->data = calloc(tsize, 1);
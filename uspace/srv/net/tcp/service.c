@@ -618,8 +618,34 @@ static errno_t tcp_conn_push_impl(tcp_client_t *client, sysarg_t conn_id)
 		return ENOENT;
 	}
 
-	(void) cconn;
-	/* XXX TODO */
+	(void) tcp_uc_push(cconn->conn);
+	return EOK;
+}
+
+/** Set connection no-delay option.
+ *
+ * Handle client request to enable or disable the Nagle algorithm
+ * (with parameters unmarshalled).
+ *
+ * @param client  TCP client
+ * @param conn_id Connection ID
+ * @param nodelay @c true to disable the Nagle algorithm
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t tcp_conn_set_nodelay_impl(tcp_client_t *client,
+    sysarg_t conn_id, bool nodelay)
+{
+	tcp_cconn_t *cconn;
+	errno_t rc;
+
+	rc = tcp_cconn_get(client, conn_id, &cconn);
+	if (rc != EOK) {
+		assert(rc == ENOENT);
+		return ENOENT;
+	}
+
+	tcp_uc_set_nodelay(cconn->conn, nodelay);
 	return EOK;
 }
 
@@ -916,6 +942,28 @@ static void tcp_conn_push_srv(tcp_client_t *client, ipc_call_t *icall)
 	async_answer_0(icall, rc);
 }
 
+/** Set connection no-delay option.
+ *
+ * Handle client request to enable or disable the Nagle algorithm.
+ *
+ * @param client TCP client
+ * @param icall  Async request data
+ *
+ */
+static void tcp_conn_set_nodelay_srv(tcp_client_t *client, ipc_call_t *icall)
+{
+	sysarg_t conn_id;
+	bool nodelay;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_set_nodelay_srv()");
+
+	conn_id = ipc_get_arg1(icall);
+	nodelay = ipc_get_arg2(icall) != 0;
+	rc = tcp_conn_set_nodelay_impl(client, conn_id, nodelay);
+	async_answer_0(icall, rc);
+}
+
 /** Reset connection.
  *
  * Handle client request to reset connection.
@@ -1223,6 +1271,9 @@ static void tcp_client_conn(ipc_call_t *icall, void *arg)
 		case TCP_CONN_RECV_WAIT:
 			tcp_conn_recv_wait_srv(&client, &call);
 			break;
+		case TCP_CONN_SET_NODELAY:
+			tcp_conn_set_nodelay_srv(&client, &call);
+			break;
 		default:
 			async_answer_0(&call, ENOTSUP);
 			break;
@@ -38,8 +38,11 @@
 #include <errno.h>
 #include <io/log.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
 #include <task.h>
 
+#include "cc.h"
 #include "conn.h"
 #include "inet.h"
 #include "ncsim.h"
@@ -89,12 +92,49 @@ static errno_t tcp_init(void)
 	return EOK;
 }
 
+static void print_syntax(void)
+{
+	printf(NAME ": Usage: " NAME " [--cc newreno|cubic] [--workers <n>]\n");
+	printf("  --cc       Congestion control algorithm\n");
+	printf("  --workers  Number of receive queue workers (1-%u)\n",
+	    TCP_RQUEUE_WORKERS_MAX);
+}
+
 int main(int argc, char **argv)
 {
+	char *endptr;
+	unsigned long n;
+	int i;
 	errno_t rc;
 
 	printf(NAME ": TCP (Transmission Control Protocol) network module\n");
 
+	i = 1;
+	while (i < argc) {
+		if (str_cmp(argv[i], "--cc") == 0 && i + 1 < argc) {
+			rc = tcp_cc_select(argv[i + 1]);
+			if (rc != EOK) {
+				printf(NAME ": Unknown congestion control "
+				    "algorithm '%s'.\n", argv[i + 1]);
+				return 1;
+			}
+			i += 2;
+		} else if (str_cmp(argv[i], "--workers") == 0 &&
+		    i + 1 < argc) {
+			n = strtoul(argv[i + 1], &endptr, 10);
+			if (*endptr != '\0' || n > TCP_RQUEUE_WORKERS_MAX ||
+			    tcp_rqueue_set_workers(n) != EOK) {
+				printf(NAME ": Invalid number of workers "
+				    "'%s'.\n", argv[i + 1]);
+				return 1;
+			}
+			i += 2;
+		} else {
+			print_syntax();
+			return 1;
+		}
+	}
+
 	rc = log_init(NAME);
 	if (rc != EOK) {
 		printf(NAME ": Failed to initialize log.\n");
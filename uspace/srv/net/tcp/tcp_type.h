@@ -43,6 +43,7 @@
 #include <refcount.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <time.h>
 #include <inet/addr.h>
 #include <inet/endpoint.h>
 
@@ -154,6 +155,49 @@ typedef struct {
 	tcp_cstate_t cstate;
 } tcp_conn_status_t;
 
+/** Maximum number of SACK blocks in one segment */
+#define TCP_SACK_BLOCKS_MAX 4
+
+/** Segment options present */
+typedef enum {
+	/** Maximum segment size */
+	TCP_SOPT_MSS = 0x1,
+	/** Window scale */
+	TCP_SOPT_WSCALE = 0x2,
+	/** SACK permitted */
+	TCP_SOPT_SACK_PERM = 0x4,
+	/** Timestamps */
+	TCP_SOPT_TS = 0x8,
+	/** SACK blocks */
+	TCP_SOPT_SACK = 0x10
+} tcp_sopt_t;
+
+/** SACK block (RFC 2018) */
+typedef struct {
+	/** First sequence number of the block */
+	uint32_t start;
+	/** Sequence number following the block */
+	uint32_t end;
+} tcp_sack_block_t;
+
+/** Segment options */
+typedef struct {
+	/** Options present (tcp_sopt_t bits) */
+	unsigned present;
+	/** Maximum segment size */
+	uint16_t mss;
+	/** Window scale shift count */
+	uint8_t wscale;
+	/** Timestamp value */
+	uint32_t tsval;
+	/** Timestamp echo reply */
+	uint32_t tsecr;
+	/** Number of SACK blocks */
+	unsigned sack_cnt;
+	/** SACK blocks */
+	tcp_sack_block_t sack[TCP_SACK_BLOCKS_MAX];
+} tcp_seg_opts_t;
+
 typedef struct {
 	/** SYN, FIN */
 	tcp_control_t ctrl;
@@ -168,6 +212,8 @@ typedef struct {
 	uint32_t wnd;
 	/** Segment urgent pointer */
 	uint32_t up;
+	/** Segment options */
+	tcp_seg_opts_t opts;
 
 	/** Segment data, may be moved when trimming segment */
 	void *data;
@@ -191,11 +237,22 @@ typedef struct {
 /** NCSim queue entry */
 typedef struct {
 	link_t link;
-	usec_t delay;
+	/** Uptime at which the segment should be delivered (usec) */
+	usec_t due;
 	inet_ep2_t epp;
 	tcp_segment_t *seg;
 } tcp_squeue_entry_t;
 
+/** NCSim configuration */
+typedef struct {
+	/** Drop every n-th data segment (0 = never) */
+	unsigned drop_nth;
+	/** Minimum one-way delay (usec) */
+	usec_t delay_min;
+	/** Maximum one-way delay (usec) */
+	usec_t delay_max;
+} tcp_ncsim_cfg_t;
+
 /** Incoming queue entry */
 typedef struct {
 	link_t link;
@@ -207,6 +264,10 @@ typedef struct {
 	link_t link;
 	tcp_conn_t *conn;
 	tcp_segment_t *seg;
+	/** Segment has been selectively acknowledged */
+	bool sacked;
+	/** Segment has been retransmitted during current recovery */
+	bool rexmit;
 } tcp_tqueue_entry_t;
 
 /** Retransmission queue callbacks */
@@ -223,10 +284,111 @@ typedef struct {
 	/** Retransmission timer */
 	fibril_timer_t *timer;
 
+	/** Delayed acknowledgement timer */
+	fibril_timer_t *dack_timer;
+	/** Number of received segments whose acknowledgement is delayed */
+	unsigned dack_segs;
+
 	/** Callbacks */
 	tcp_tqueue_cb_t *cb;
 } tcp_tqueue_t;
 
+/** Connection transfer statistics */
+typedef struct {
+	/** Segments transmitted, including retransmissions */
+	uint64_t segs_out;
+	/** Segments transmitted that carried only an acknowledgement */
+	uint64_t acks_out;
+	/** Acknowledgements that were delayed */
+	uint64_t acks_delayed;
+	/** New data bytes transmitted */
+	uint64_t bytes_out;
+	/** Segments received */
+	uint64_t segs_in;
+	/** Data bytes received */
+	uint64_t bytes_in;
+	/** Time spent processing segments and user calls (nsec) */
+	uint64_t proc_nsec;
+} tcp_xfer_stats_t;
+
+/** Congestion control algorithm */
+typedef struct {
+	/** Algorithm name */
+	const char *name;
+	/** Congestion window growth in congestion avoidance.
+	 *
+	 * Called for each ACK of new data outside slow start and recovery
+	 * with the number of bytes acknowledged.
+	 */
+	void (*ack)(tcp_conn_t *, uint32_t);
+	/** Loss detected, return new slow start threshold. */
+	uint32_t (*loss)(tcp_conn_t *);
+} tcp_cc_ops_t;
+
+/** Congestion control state */
+typedef struct {
+	/** Algorithm */
+	const tcp_cc_ops_t *ops;
+	/** Congestion window (bytes) */
+	uint32_t cwnd;
+	/** Slow start threshold (bytes) */
+	uint32_t ssthresh;
+	/** Bytes acknowledged towards the next congestion avoidance step */
+	uint32_t bytes_acked;
+	/** SND.UNA at the time of the last ACK processing */
+	uint32_t una;
+	/** Number of consecutive duplicate ACKs */
+	unsigned dupacks;
+	/** In fast recovery */
+	bool recovery;
+	/** SND.NXT when the last recovery started (RFC 6582 recover) */
+	uint32_t recover;
+
+	/** CUBIC: window just before the last reduction (bytes) */
+	uint32_t w_max;
+	/** CUBIC: window the cubic function is centered on (bytes) */
+	uint32_t w_origin;
+	/** CUBIC: Reno-friendly window estimate (bytes) */
+	uint32_t w_est;
+	/** CUBIC: bytes acked towards the next W_est increase */
+	uint32_t w_est_acked;
+	/** CUBIC: time to reach w_origin from the start of the epoch (msec) */
+	uint64_t k;
+	/** CUBIC: start of the current congestion avoidance epoch */
+	usec_t epoch;
+	/** CUBIC: @c epoch is valid */
+	bool epoch_valid;
+
+	/** Number of segments retransmitted */
+	unsigned retransmits;
+	/** Number of fast retransmits */
+	unsigned fast_retransmits;
+	/** Number of retransmission timeouts */
+	unsigned timeouts;
+} tcp_cc_t;
+
+/** Round-trip time estimator state (RFC 6298) */
+typedef struct {
+	/** Smoothed round-trip time (usec) */
+	usec_t srtt;
+	/** Round-trip time variation (usec) */
+	usec_t rttvar;
+	/** Retransmission timeout (usec) */
+	usec_t rto;
+	/** At least one RTT sample has been taken */
+	bool valid;
+	/** A segment is being timed */
+	bool timing;
+	/** Sequence number that needs to be acknowledged to take a sample */
+	uint32_t seq;
+	/** Time the timed segment was sent */
+	usec_t start;
+	/** Number of consecutive timer backoffs */
+	unsigned backoff;
+	/** Timestamp echoed by the last acceptable ACK, zero if none */
+	uint32_t tsecr;
+} tcp_rtt_t;
+
 /** Connection */
 struct tcp_conn {
 	char *name;
@@ -290,6 +452,10 @@ struct tcp_conn {
 	size_t snd_buf_used;
 	/** Send buffer contains FIN */
 	bool snd_buf_fin;
+	/** Send buffer contents should be pushed out without delay */
+	bool snd_buf_push;
+	/** Disable Nagle algorithm */
+	bool nodelay;
 	/** Send buffer CV. Broadcast when space is made available in buffer */
 	fibril_condvar_t snd_buf_cv;
 
@@ -307,15 +473,44 @@ struct tcp_conn {
 	uint32_t snd_wl2;
 	/** Initial send sequence number */
 	uint32_t iss;
+	/** Sender maximum segment size */
+	uint32_t smss;
+
+	/** Congestion control */
+	tcp_cc_t cc;
+	/** Round-trip time estimation */
+	tcp_rtt_t rtt;
+
+	/** Window scaling offered or negotiated (RFC 7323) */
+	bool ws_ok;
+	/** Shift count applied to received SEG.WND */
+	uint8_t snd_wscale;
+	/** Shift count applied to sent SEG.WND */
+	uint8_t rcv_wscale;
+	/** Timestamps offered or negotiated (RFC 7323) */
+	bool ts_ok;
+	/** TS.Recent */
+	uint32_t ts_recent;
+	/** Last.ACK.sent */
+	uint32_t last_ack_sent;
+	/** Selective acknowledgements offered or negotiated (RFC 2018) */
+	bool sack_ok;
+	/** Sequence number of the last out-of-order segment received */
+	uint32_t sack_last;
 
 	/** Receive next */
 	uint32_t rcv_nxt;
 	/** Receive window */
 	uint32_t rcv_wnd;
+	/** Right edge of the last advertised receive window */
+	uint32_t rcv_adv;
 	/** Receive urgent pointer */
 	uint32_t rcv_up;
 	/** Initial receive sequence number */
 	uint32_t irs;
+
+	/** Transfer statistics */
+	tcp_xfer_stats_t stats;
 };
 
 /** Continuation of processing.
@@ -386,7 +581,9 @@ typedef enum {
 	/** Segment loopback */
 	tcp_lb_segment,
 	/** PDU loopback */
-	tcp_lb_pdu
+	tcp_lb_pdu,
+	/** Segment loopback through network condition simulator */
+	tcp_lb_ncsim
 } tcp_lb_t;
 
 #endif
@@ -0,0 +1,435 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <errno.h>
+#include <inet/endpoint.h>
+#include <io/log.h>
+#include <pcut/pcut.h>
+
+#include "../cc.h"
+#include "../conn.h"
+#include "../segment.h"
+#include "../tqueue.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(cc);
+
+enum {
+	test_seg_max = 10,
+	test_smss = TCP_SMSS_DEFAULT
+};
+
+static int seg_cnt;
+static tcp_segment_t *trans_seg[test_seg_max];
+
+static void cc_test_transmit_seg(inet_ep2_t *, tcp_segment_t *);
+static tcp_conn_t *cc_test_conn_new(tcp_cc_ops_t *);
+static void cc_test_conn_delete(tcp_conn_t *);
+
+static tcp_tqueue_cb_t cc_test_cb = {
+	.transmit_seg = cc_test_transmit_seg
+};
+
+PCUT_TEST_BEFORE
+{
+	errno_t rc;
+
+	/* We will be calling functions that perform logging */
+	rc = log_init("test-tcp");
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = tcp_conns_init();
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+}
+
+PCUT_TEST_AFTER
+{
+	tcp_conns_fini();
+}
+
+/** Test initial congestion control state */
+PCUT_TEST(init)
+{
+	tcp_conn_t *conn;
+
+	conn = cc_test_conn_new(&tcp_cc_newreno);
+
+	PCUT_ASSERT_INT_EQUALS(test_smss, conn->smss);
+	PCUT_ASSERT_INT_EQUALS(3 * test_smss, conn->cc.cwnd);
+	PCUT_ASSERT_INT_EQUALS(TCP_RTO_INIT, conn->rtt.rto);
+	PCUT_ASSERT_FALSE(conn->cc.recovery);
+	PCUT_ASSERT_INT_EQUALS(3 * test_smss, tcp_cc_wnd(conn));
+
+	conn->snd_wnd = 100;
+	PCUT_ASSERT_INT_EQUALS(100, tcp_cc_wnd(conn));
+
+	cc_test_conn_delete(conn);
+}
+
+/** Test selecting algorithm by name */
+PCUT_TEST(select)
+{
+	tcp_conn_t *conn;
+	errno_t rc;
+
+	rc = tcp_cc_select("foo");
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, rc);
+
+	rc = tcp_cc_select("newreno");
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	conn = cc_test_conn_new(NULL);
+	PCUT_ASSERT_EQUALS(&tcp_cc_newreno, conn->cc.ops);
+	cc_test_conn_delete(conn);
+
+	rc = tcp_cc_select("cubic");
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	conn = cc_test_conn_new(NULL);
+	PCUT_ASSERT_EQUALS(&tcp_cc_cubic, conn->cc.ops);
+	cc_test_conn_delete(conn);
+}
+
+/** Test slow start and NewReno congestion avoidance */
+PCUT_TEST(newreno_growth)
+{
+	tcp_conn_t *conn;
+	uint32_t cwnd;
+
+	conn = cc_test_conn_new(&tcp_cc_newreno);
+
+	/* Slow start grows by at most SMSS per ACK */
+	cwnd = conn->cc.cwnd;
+	conn->snd_una += 2 * test_smss;
+	conn->snd_nxt = conn->snd_una;
+	tcp_cc_ack_received(conn);
+	PCUT_ASSERT_INT_EQUALS(cwnd + test_smss, conn->cc.cwnd);
+
+	conn->snd_una += 100;
+	conn->snd_nxt = conn->snd_una;
+	tcp_cc_ack_received(conn);
+	PCUT_ASSERT_INT_EQUALS(cwnd + test_smss + 100, conn->cc.cwnd);
+
+	/* Congestion avoidance grows by SMSS per window */
+	conn->cc.cwnd = 10 * test_smss;
+	conn->cc.ssthresh = 10 * test_smss;
+
+	conn->snd_una += 9 * test_smss;
+	conn->snd_nxt = conn->snd_una;
+	tcp_cc_ack_received(conn);
+	PCUT_ASSERT_INT_EQUALS(10 * test_smss, conn->cc.cwnd);
+
+	conn->snd_una += test_smss;
+	conn->snd_nxt = conn->snd_una;
+	tcp_cc_ack_received(conn);
+	PCUT_ASSERT_INT_EQUALS(11 * test_smss, conn->cc.cwnd);
+
+	cc_test_conn_delete(conn);
+}
+
+/** Test fast retransmit and fast recovery */
+PCUT_TEST(fast_retransmit)
+{
+	tcp_conn_t *conn;
+	int i;
+
+	conn = cc_test_conn_new(&tcp_cc_newreno);
+
+	tcp_conn_lock(conn);
+
+	/* Send three full-sized segments, the initial window */
+	conn->snd_buf_used = 5 * test_smss;
+	for (i = 0; i < 5 * test_smss; i++)
+		conn->snd_buf[i] = i;
+	tcp_tqueue_new_data(conn);
+
+	PCUT_ASSERT_INT_EQUALS(3, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(10 + 3 * test_smss, conn->snd_nxt);
+	PCUT_ASSERT_INT_EQUALS(test_smss, tcp_segment_text_size(trans_seg[1]));
+	PCUT_ASSERT_INT_EQUALS(10 + test_smss, trans_seg[1]->seq);
+
+	/* Two duplicate ACKs are not enough */
+	tcp_cc_dupack(conn);
+	tcp_cc_dupack(conn);
+	PCUT_ASSERT_INT_EQUALS(3, seg_cnt);
+	PCUT_ASSERT_FALSE(conn->cc.recovery);
+
+	/* Third duplicate ACK triggers fast retransmit */
+	tcp_cc_dupack(conn);
+	PCUT_ASSERT_INT_EQUALS(4, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(10, trans_seg[3]->seq);
+	PCUT_ASSERT_TRUE(conn->cc.recovery);
+	PCUT_ASSERT_INT_EQUALS(2 * test_smss, conn->cc.ssthresh);
+	PCUT_ASSERT_INT_EQUALS(5 * test_smss, conn->cc.cwnd);
+	PCUT_ASSERT_INT_EQUALS(1, conn->cc.fast_retransmits);
+
+	/* Further duplicate ACKs inflate the window */
+	tcp_cc_dupack(conn);
+	PCUT_ASSERT_INT_EQUALS(6 * test_smss, conn->cc.cwnd);
+
+	/* Full ACK ends recovery and lets the rest of the data out */
+	conn->snd_una = conn->snd_nxt;
+	tcp_tqueue_ack_received(conn);
+	PCUT_ASSERT_FALSE(conn->cc.recovery);
+	PCUT_ASSERT_INT_EQUALS(2 * test_smss, conn->cc.cwnd);
+	PCUT_ASSERT_INT_EQUALS(6, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(0, conn->snd_buf_used);
+
+	tcp_conn_unlock(conn);
+
+	cc_test_conn_delete(conn);
+}
+
+/** Test SACK-driven loss recovery */
+PCUT_TEST(sack_recovery)
+{
+	tcp_conn_t *conn;
+	tcp_seg_opts_t opts;
+	int i;
+
+	conn = cc_test_conn_new(&tcp_cc_newreno);
+	PCUT_ASSERT_TRUE(conn->sack_ok);
+
+	tcp_conn_lock(conn);
+
+	/* Send five full-sized segments */
+	conn->cc.cwnd = 5 * test_smss;
+	conn->snd_buf_used = 5 * test_smss;
+	for (i = 0; i < 5 * test_smss; i++)
+		conn->snd_buf[i] = i;
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_INT_EQUALS(5, seg_cnt);
+
+	/* First and third segment are lost */
+	opts.present = TCP_SOPT_SACK;
+	opts.sack_cnt = 2;
+	opts.sack[0].start = 10 + 3 * test_smss;
+	opts.sack[0].end = 10 + 5 * test_smss;
+	opts.sack[1].start = 10 + test_smss;
+	opts.sack[1].end = 10 + 2 * test_smss;
+
+	/* Blocks outside the window are ignored */
+	opts.sack[1].end = 10 + 6 * test_smss;
+	tcp_tqueue_sack_received(conn, &opts);
+	opts.sack[1].end = 10 + 2 * test_smss;
+
+	for (i = 0; i < TCP_DUPACK_THRESH; i++) {
+		tcp_tqueue_sack_received(conn, &opts);
+		tcp_cc_dupack(conn);
+	}
+
+	/* Fast retransmit repairs the first hole */
+	PCUT_ASSERT_INT_EQUALS(6, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(10, trans_seg[5]->seq);
+
+	/* Next duplicate ACK repairs the second hole */
+	tcp_tqueue_sack_received(conn, &opts);
+	tcp_cc_dupack(conn);
+	PCUT_ASSERT_INT_EQUALS(7, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(10 + 2 * test_smss, trans_seg[6]->seq);
+
+	/* No more holes */
+	tcp_tqueue_sack_received(conn, &opts);
+	tcp_cc_dupack(conn);
+	PCUT_ASSERT_INT_EQUALS(7, seg_cnt);
+
+	/* Timeout forgets SACK information */
+	tcp_tqueue_scoreboard_reset(conn, true);
+	tcp_tqueue_retransmit(conn);
+	PCUT_ASSERT_INT_EQUALS(8, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(10, trans_seg[7]->seq);
+
+	tcp_conn_unlock(conn);
+
+	cc_test_conn_delete(conn);
+}
+
+/** Test retransmission timeout */
+PCUT_TEST(timeout)
+{
+	tcp_conn_t *conn;
+
+	conn = cc_test_conn_new(&tcp_cc_newreno);
+
+	conn->cc.cwnd = 8 * test_smss;
+	conn->snd_nxt = conn->snd_una + 8 * test_smss;
+
+	tcp_cc_timeout(conn);
+	PCUT_ASSERT_INT_EQUALS(test_smss, conn->cc.cwnd);
+	PCUT_ASSERT_INT_EQUALS(4 * test_smss, conn->cc.ssthresh);
+	PCUT_ASSERT_INT_EQUALS(2 * TCP_RTO_INIT, conn->rtt.rto);
+
+	/* Repeated timeout backs off but does not lower ssthresh again */
+	tcp_cc_timeout(conn);
+	PCUT_ASSERT_INT_EQUALS(4 * test_smss, conn->cc.ssthresh);
+	PCUT_ASSERT_INT_EQUALS(4 * TCP_RTO_INIT, conn->rtt.rto);
+	PCUT_ASSERT_INT_EQUALS(2, conn->cc.timeouts);
+
+	/* RTT sample ends the backoff */
+	tcp_rtt_sample(conn, 100000);
+	PCUT_ASSERT_INT_EQUALS(0, conn->rtt.backoff);
+	PCUT_ASSERT_INT_EQUALS(300000, conn->rtt.rto);
+
+	cc_test_conn_delete(conn);
+}
+
+/** Test RTT estimator */
+PCUT_TEST(rtt_estimate)
+{
+	tcp_conn_t *conn;
+
+	conn = cc_test_conn_new(&tcp_cc_newreno);
+
+	/* First sample */
+	tcp_rtt_sample(conn, 400000);
+	PCUT_ASSERT_INT_EQUALS(400000, conn->rtt.srtt);
+	PCUT_ASSERT_INT_EQUALS(200000, conn->rtt.rttvar);
+	PCUT_ASSERT_INT_EQUALS(1200000, conn->rtt.rto);
+
+	/* Subsequent sample */
+	tcp_rtt_sample(conn, 800000);
+	PCUT_ASSERT_INT_EQUALS(450000, conn->rtt.srtt);
+	PCUT_ASSERT_INT_EQUALS(250000, conn->rtt.rttvar);
+	PCUT_ASSERT_INT_EQUALS(1450000, conn->rtt.rto);
+
+	cc_test_conn_delete(conn);
+
+	/* Small RTT is limited by minimum RTO */
+	conn = cc_test_conn_new(&tcp_cc_newreno);
+	tcp_rtt_sample(conn, 1000);
+	PCUT_ASSERT_INT_EQUALS(TCP_RTO_MIN, conn->rtt.rto);
+	cc_test_conn_delete(conn);
+}
+
+/** Test CUBIC reaction to loss and window growth */
+PCUT_TEST(cubic)
+{
+	tcp_conn_t *conn;
+	uint32_t cwnd;
+	int i;
+
+	conn = cc_test_conn_new(&tcp_cc_cubic);
+
+	conn->cc.cwnd = 100 * test_smss;
+	conn->snd_nxt = conn->snd_una + 100 * test_smss;
+
+	/* Multiplicative decrease by beta = 0.7 */
+	conn->cc.ssthresh = tcp_cc_cubic.loss(conn);
+	PCUT_ASSERT_INT_EQUALS(70 * test_smss, conn->cc.ssthresh);
+	PCUT_ASSERT_INT_EQUALS(100 * test_smss, conn->cc.w_max);
+
+	/* First ACK in congestion avoidance starts a new epoch */
+	conn->cc.cwnd = conn->cc.ssthresh;
+	conn->snd_una += test_smss;
+	conn->snd_nxt = conn->snd_una;
+	tcp_cc_ack_received(conn);
+	PCUT_ASSERT_TRUE(conn->cc.epoch_valid);
+	PCUT_ASSERT_TRUE(conn->cc.k > 0);
+	PCUT_ASSERT_INT_EQUALS(100 * test_smss, conn->cc.w_origin);
+
+	/* Move to the plateau, window grows towards W_max */
+	conn->cc.epoch -= conn->cc.k * 1000;
+	for (i = 0; i < 100; i++) {
+		cwnd = conn->cc.cwnd;
+		conn->snd_una += test_smss;
+		conn->snd_nxt = conn->snd_una;
+		tcp_cc_ack_received(conn);
+		PCUT_ASSERT_TRUE(conn->cc.cwnd >= cwnd);
+	}
+
+	PCUT_ASSERT_TRUE(conn->cc.cwnd > 80 * test_smss);
+	PCUT_ASSERT_TRUE(conn->cc.cwnd <= 100 * test_smss);
+
+	/* Fast convergence when loss occurs below W_max */
+	conn->cc.cwnd = 80 * test_smss;
+	conn->cc.ssthresh = tcp_cc_cubic.loss(conn);
+	PCUT_ASSERT_INT_EQUALS(68 * test_smss, conn->cc.w_max);
+	PCUT_ASSERT_INT_EQUALS(56 * test_smss, conn->cc.ssthresh);
+	PCUT_ASSERT_FALSE(conn->cc.epoch_valid);
+
+	cc_test_conn_delete(conn);
+}
+
+/** Create connection for testing.
+ *
+ * @param ops Congestion control algorithm or @c NULL for the default
+ * @return New connection
+ */
+static tcp_conn_t *cc_test_conn_new(tcp_cc_ops_t *ops)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	if (ops != NULL)
+		conn->cc.ops = ops;
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = 65535;
+	conn->cc.una = 10;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &cc_test_cb;
+	seg_cnt = 0;
+
+	return conn;
+}
+
+/** Destroy test connection and transmitted segments.
+ *
+ * @param conn Connection
+ */
+static void cc_test_conn_delete(tcp_conn_t *conn)
+{
+	int i;
+
+	tcp_conn_lock(conn);
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+
+	for (i = 0; i < seg_cnt; i++)
+		tcp_segment_delete(trans_seg[i]);
+	seg_cnt = 0;
+}
+
+static void cc_test_transmit_seg(inet_ep2_t *epp, tcp_segment_t *seg)
+{
+	if (seg_cnt < test_seg_max)
+		trans_seg[seg_cnt++] = tcp_segment_dup(seg);
+}
+
+PCUT_EXPORT(cc);
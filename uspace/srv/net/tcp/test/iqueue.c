@@ -175,4 +175,76 @@ PCUT_TEST(two_segments)
 	tcp_conn_delete(conn);
 }
 
+/** Test generating SACK blocks from out-of-order segments */
+PCUT_TEST(sack_blocks)
+{
+	tcp_conn_t *conn;
+	tcp_iqueue_t iqueue;
+	tcp_seg_opts_t opts;
+	inet_ep2_t epp;
+	tcp_segment_t *seg[4];
+	void *data;
+	size_t dsize;
+	int i;
+
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->rcv_nxt = 10;
+	conn->rcv_wnd = 100;
+
+	dsize = 5;
+	data = calloc(dsize, 1);
+	PCUT_ASSERT_NOT_NULL(data);
+
+	for (i = 0; i < 4; i++) {
+		seg[i] = tcp_segment_make_data(0, data, dsize);
+		PCUT_ASSERT_NOT_NULL(seg[i]);
+	}
+
+	tcp_iqueue_init(&iqueue, conn);
+
+	/* No out-of-order data, no blocks */
+	opts.present = 0;
+	tcp_iqueue_sack_blocks(&iqueue, &opts, TCP_SACK_BLOCKS_MAX);
+	PCUT_ASSERT_INT_EQUALS(0, opts.sack_cnt);
+	PCUT_ASSERT_INT_EQUALS(0, opts.present & TCP_SOPT_SACK);
+
+	/* Two adjacent segments form one block, the last one arrived */
+	seg[0]->seq = 20;
+	tcp_iqueue_insert_seg(&iqueue, seg[0]);
+	seg[1]->seq = 25;
+	tcp_iqueue_insert_seg(&iqueue, seg[1]);
+	seg[2]->seq = 40;
+	tcp_iqueue_insert_seg(&iqueue, seg[2]);
+	seg[3]->seq = 50;
+	tcp_iqueue_insert_seg(&iqueue, seg[3]);
+	conn->sack_last = 40;
+
+	tcp_iqueue_sack_blocks(&iqueue, &opts, TCP_SACK_BLOCKS_MAX);
+	PCUT_ASSERT_INT_EQUALS(TCP_SOPT_SACK, opts.present & TCP_SOPT_SACK);
+	PCUT_ASSERT_INT_EQUALS(3, opts.sack_cnt);
+	PCUT_ASSERT_INT_EQUALS(40, opts.sack[0].start);
+	PCUT_ASSERT_INT_EQUALS(45, opts.sack[0].end);
+	PCUT_ASSERT_INT_EQUALS(20, opts.sack[1].start);
+	PCUT_ASSERT_INT_EQUALS(30, opts.sack[1].end);
+	PCUT_ASSERT_INT_EQUALS(50, opts.sack[2].start);
+	PCUT_ASSERT_INT_EQUALS(55, opts.sack[2].end);
+
+	/* Number of blocks is limited */
+	tcp_iqueue_sack_blocks(&iqueue, &opts, 2);
+	PCUT_ASSERT_INT_EQUALS(2, opts.sack_cnt);
+	PCUT_ASSERT_INT_EQUALS(40, opts.sack[0].start);
+	PCUT_ASSERT_INT_EQUALS(20, opts.sack[1].start);
+
+	for (i = 0; i < 4; i++) {
+		tcp_iqueue_remove_seg(&iqueue, seg[i]);
+		tcp_segment_delete(seg[i]);
+	}
+
+	free(data);
+	tcp_conn_delete(conn);
+}
+
 PCUT_EXPORT(iqueue);
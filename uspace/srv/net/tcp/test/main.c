@@ -52,10 +52,30 @@ void test_seg_same(tcp_segment_t *a, tcp_segment_t *b)
 		PCUT_ASSERT_INT_EQUALS(0, memcmp(a->data, b->data,
 		    tcp_segment_text_size(a)));
 	}
+
+	PCUT_ASSERT_INT_EQUALS(a->opts.present, b->opts.present);
+	if ((a->opts.present & TCP_SOPT_MSS) != 0)
+		PCUT_ASSERT_INT_EQUALS(a->opts.mss, b->opts.mss);
+	if ((a->opts.present & TCP_SOPT_WSCALE) != 0)
+		PCUT_ASSERT_INT_EQUALS(a->opts.wscale, b->opts.wscale);
+	if ((a->opts.present & TCP_SOPT_TS) != 0) {
+		PCUT_ASSERT_INT_EQUALS(a->opts.tsval, b->opts.tsval);
+		PCUT_ASSERT_INT_EQUALS(a->opts.tsecr, b->opts.tsecr);
+	}
+	if ((a->opts.present & TCP_SOPT_SACK) != 0) {
+		PCUT_ASSERT_INT_EQUALS(a->opts.sack_cnt, b->opts.sack_cnt);
+		for (unsigned i = 0; i < a->opts.sack_cnt; i++) {
+			PCUT_ASSERT_INT_EQUALS(a->opts.sack[i].start,
+			    b->opts.sack[i].start);
+			PCUT_ASSERT_INT_EQUALS(a->opts.sack[i].end,
+			    b->opts.sack[i].end);
+		}
+	}
 }
 
 PCUT_INIT;
 
+PCUT_IMPORT(cc);
 PCUT_IMPORT(conn);
 PCUT_IMPORT(iqueue);
 PCUT_IMPORT(pdu);
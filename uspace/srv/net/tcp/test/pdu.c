@@ -35,6 +35,7 @@
 #include "main.h"
 #include "../pdu.h"
 #include "../segment.h"
+#include "../std.h"
 
 PCUT_INIT;
 
@@ -108,4 +109,117 @@ PCUT_TEST(encdec_data)
 	free(data);
 }
 
+/** Test encode/decode round trip for SYN PDU with options */
+PCUT_TEST(encdec_syn_opts)
+{
+	tcp_segment_t *seg, *dseg;
+	tcp_pdu_t *pdu;
+	inet_ep2_t epp, depp;
+	errno_t rc;
+
+	inet_ep2_init(&epp);
+	inet_addr(&epp.local.addr, 1, 2, 3, 4);
+	inet_addr(&epp.remote.addr, 5, 6, 7, 8);
+
+	seg = tcp_segment_make_ctrl(CTL_SYN);
+	PCUT_ASSERT_NOT_NULL(seg);
+
+	seg->seq = 20;
+	seg->wnd = 65535;
+	seg->opts.present = TCP_SOPT_MSS | TCP_SOPT_WSCALE |
+	    TCP_SOPT_SACK_PERM | TCP_SOPT_TS;
+	seg->opts.mss = 1460;
+	seg->opts.wscale = 7;
+	seg->opts.tsval = 0x12345678;
+	seg->opts.tsecr = 0;
+
+	rc = tcp_pdu_encode(&epp, seg, &pdu);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* MSS (4) + NOP, WS (4) + SACK permitted, TS (12) */
+	PCUT_ASSERT_INT_EQUALS(sizeof(tcp_header_t) + 20, pdu->header_size);
+
+	rc = tcp_pdu_decode(pdu, &depp, &dseg);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	test_seg_same(seg, dseg);
+	tcp_segment_delete(seg);
+	tcp_segment_delete(dseg);
+	tcp_pdu_delete(pdu);
+}
+
+/** Test encode/decode round trip for PDU with timestamps and SACK */
+PCUT_TEST(encdec_sack)
+{
+	tcp_segment_t *seg, *dseg;
+	tcp_pdu_t *pdu;
+	inet_ep2_t epp, depp;
+	errno_t rc;
+	unsigned i;
+
+	inet_ep2_init(&epp);
+	inet_addr(&epp.local.addr, 1, 2, 3, 4);
+	inet_addr(&epp.remote.addr, 5, 6, 7, 8);
+
+	seg = tcp_segment_make_ctrl(CTL_ACK);
+	PCUT_ASSERT_NOT_NULL(seg);
+
+	seg->seq = 20;
+	seg->ack = 1000;
+	seg->wnd = 100;
+	seg->opts.present = TCP_SOPT_TS | TCP_SOPT_SACK;
+	seg->opts.tsval = 100;
+	seg->opts.tsecr = 99;
+	seg->opts.sack_cnt = 3;
+	for (i = 0; i < 3; i++) {
+		seg->opts.sack[i].start = 2000 + 1000 * i;
+		seg->opts.sack[i].end = 2500 + 1000 * i;
+	}
+
+	rc = tcp_pdu_encode(&epp, seg, &pdu);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(sizeof(tcp_header_t) + 40, pdu->header_size);
+
+	rc = tcp_pdu_decode(pdu, &depp, &dseg);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	test_seg_same(seg, dseg);
+	tcp_segment_delete(seg);
+	tcp_segment_delete(dseg);
+	tcp_pdu_delete(pdu);
+}
+
+/** Test that malformed options are ignored */
+PCUT_TEST(decode_bad_opts)
+{
+	tcp_segment_t *dseg;
+	tcp_pdu_t *pdu;
+	inet_ep2_t depp;
+	uint8_t hdr[sizeof(tcp_header_t) + 8];
+	errno_t rc;
+
+	memset(hdr, 0, sizeof(hdr));
+	hdr[12] = (sizeof(hdr) / 4) << 4;
+
+	/* Window scale with wrong length, then option running past end */
+	hdr[20] = OPT_WINDOW_SCALE;
+	hdr[21] = 4;
+	hdr[22] = 3;
+	hdr[23] = 0;
+	hdr[24] = OPT_MAX_SEG_SIZE;
+	hdr[25] = 40;
+
+	pdu = tcp_pdu_create(hdr, sizeof(hdr), NULL, 0);
+	PCUT_ASSERT_NOT_NULL(pdu);
+	inet_addr(&pdu->src, 1, 2, 3, 4);
+	inet_addr(&pdu->dest, 5, 6, 7, 8);
+
+	rc = tcp_pdu_decode(pdu, &depp, &dseg);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, dseg->opts.present);
+
+	tcp_segment_delete(dseg);
+	tcp_pdu_delete(pdu);
+}
+
 PCUT_EXPORT(pdu);
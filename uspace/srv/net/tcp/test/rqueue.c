@@ -126,4 +126,51 @@ PCUT_TEST(multiple_segments)
 
 }
 
+/** Test segments of multiple connections */
+PCUT_TEST(multiple_conns)
+{
+	tcp_segment_t *seg[test_seg_max];
+	inet_ep2_t epp;
+	uint32_t last_seq[test_seg_max / 2];
+	int i, j;
+
+	tcp_rqueue_init(&rcb);
+	seg_cnt = 0;
+
+	tcp_rqueue_fibril_start();
+
+	/* Interleave two segments of each of several connections */
+	for (i = 0; i < test_seg_max; i++) {
+		seg[i] = tcp_segment_make_ctrl(CTL_ACK);
+		PCUT_ASSERT_NOT_NULL(seg[i]);
+		seg[i]->seq = i;
+
+		inet_ep2_init(&epp);
+		inet_addr(&epp.local.addr, 10, 0, 0, 1);
+		inet_addr(&epp.remote.addr, 10, 0, 0, 2);
+		epp.local.port = 80;
+		epp.remote.port = 1024 + i % (test_seg_max / 2);
+
+		tcp_rqueue_insert_seg(&epp, seg[i]);
+	}
+
+	tcp_rqueue_fini();
+
+	PCUT_ASSERT_INT_EQUALS(test_seg_max, seg_cnt);
+
+	/* Segments of each connection must be delivered in order */
+	for (j = 0; j < test_seg_max / 2; j++)
+		last_seq[j] = UINT32_MAX;
+
+	for (i = 0; i < test_seg_max; i++) {
+		j = recv_seg[i]->seq % (test_seg_max / 2);
+		if (last_seq[j] != UINT32_MAX)
+			PCUT_ASSERT_TRUE(recv_seg[i]->seq > last_seq[j]);
+		last_seq[j] = recv_seg[i]->seq;
+	}
+
+	for (i = 0; i < test_seg_max; i++)
+		tcp_segment_delete(seg[i]);
+}
+
 PCUT_EXPORT(rqueue);
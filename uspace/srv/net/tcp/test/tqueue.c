@@ -28,9 +28,11 @@
 
 //#include <inet/endpoint.h>
 #include <io/log.h>
+#include <mem.h>
 #include <pcut/pcut.h>
 
 #include "../conn.h"
+#include "../iqueue.h"
 #include "../segment.h"
 #include "../tqueue.h"
 
@@ -220,6 +222,9 @@ PCUT_TEST(ack_received)
 	conn->snd_nxt = 10;
 	conn->snd_wnd = 1024;
 
+	/* Send small segments without waiting for ACK */
+	conn->nodelay = true;
+
 	/* Redirect segment transmission */
 	conn->retransmit.cb = &tqueue_test_cb;
 	seg_cnt = 0;
@@ -257,6 +262,244 @@ PCUT_TEST(ack_received)
 	tcp_conn_delete(conn);
 }
 
+/** Test coalescing small writes with the Nagle algorithm */
+PCUT_TEST(new_data_nagle)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+	int i;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = 1024;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+
+	/* Nothing in flight, small segment goes out */
+	conn->snd_buf_used = 10;
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_INT_EQUALS(1, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(20, conn->snd_nxt);
+
+	/* Further small writes are held back */
+	for (i = 0; i < 3; i++) {
+		conn->snd_buf_used += 10;
+		tcp_tqueue_new_data(conn);
+	}
+
+	PCUT_ASSERT_INT_EQUALS(1, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(30, conn->snd_buf_used);
+
+	/* ACK releases them as a single segment */
+	conn->snd_una = 20;
+	tcp_tqueue_ack_received(conn);
+	PCUT_ASSERT_INT_EQUALS(2, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(30, tcp_segment_text_size(trans_seg[1]));
+	PCUT_ASSERT_INT_EQUALS(50, conn->snd_nxt);
+
+	/* Push overrides the delay */
+	conn->snd_buf_used = 10;
+	conn->snd_buf_push = true;
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_INT_EQUALS(3, seg_cnt);
+	PCUT_ASSERT_FALSE(conn->snd_buf_push);
+
+	/* So does disabling the algorithm */
+	conn->snd_buf_used = 10;
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_INT_EQUALS(3, seg_cnt);
+	conn->nodelay = true;
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_INT_EQUALS(4, seg_cnt);
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+
+	for (i = 0; i < seg_cnt; i++)
+		tcp_segment_delete(trans_seg[i]);
+}
+
+/** Test delayed acknowledgements */
+PCUT_TEST(ack_delayed)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+	int i;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = 1024;
+	conn->rcv_nxt = 100;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+
+	/* First segment is not acknowledged right away */
+	tcp_tqueue_ack_delayed(conn);
+	PCUT_ASSERT_INT_EQUALS(0, seg_cnt);
+
+	/* Second segment is */
+	conn->rcv_nxt = 200;
+	tcp_tqueue_ack_delayed(conn);
+	PCUT_ASSERT_INT_EQUALS(1, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(CTL_ACK, trans_seg[0]->ctrl);
+	PCUT_ASSERT_INT_EQUALS(200, trans_seg[0]->ack);
+
+	/* Nothing pending, nothing to flush */
+	tcp_tqueue_ack_flush(conn);
+	PCUT_ASSERT_INT_EQUALS(1, seg_cnt);
+
+	/* Pending acknowledgement can be flushed */
+	conn->rcv_nxt = 300;
+	tcp_tqueue_ack_delayed(conn);
+	tcp_tqueue_ack_flush(conn);
+	PCUT_ASSERT_INT_EQUALS(2, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(300, trans_seg[1]->ack);
+
+	/* Acknowledgement is piggybacked on data */
+	conn->rcv_nxt = 400;
+	tcp_tqueue_ack_delayed(conn);
+	conn->snd_buf_used = 10;
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_INT_EQUALS(3, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(400, trans_seg[2]->ack);
+	PCUT_ASSERT_INT_EQUALS(0, conn->retransmit.dack_segs);
+	tcp_tqueue_ack_flush(conn);
+	PCUT_ASSERT_INT_EQUALS(3, seg_cnt);
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+
+	for (i = 0; i < seg_cnt; i++)
+		tcp_segment_delete(trans_seg[i]);
+}
+
+/** Test receive window update */
+PCUT_TEST(wnd_update)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+	int i;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->rcv_nxt = 100;
+	conn->rcv_wnd = 1000;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+
+	tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+	PCUT_ASSERT_INT_EQUALS(1, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(1100, conn->rcv_adv);
+
+	/* Small increase is not worth advertising */
+	conn->rcv_wnd += 100;
+	tcp_tqueue_wnd_update(conn);
+	PCUT_ASSERT_INT_EQUALS(1, seg_cnt);
+
+	/* Full-sized segment is */
+	conn->rcv_wnd += conn->smss;
+	tcp_tqueue_wnd_update(conn);
+	PCUT_ASSERT_INT_EQUALS(2, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(1200 + conn->smss, conn->rcv_adv);
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+
+	for (i = 0; i < seg_cnt; i++)
+		tcp_segment_delete(trans_seg[i]);
+}
+
+/** Test that data segments leave room for the SACK option */
+PCUT_TEST(new_data_sack)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+	tcp_segment_t *oseg;
+	uint8_t data[10];
+	int i;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = 1024;
+	conn->rcv_nxt = 100;
+	conn->rcv_wnd = 1000;
+	conn->sack_ok = true;
+	conn->smss = 100;
+	conn->cc.cwnd = 1000;
+	conn->nodelay = true;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+
+	/* Out-of-order segment, to be reported in SACK option */
+	memset(data, 0, sizeof(data));
+	oseg = tcp_segment_make_data(0, data, sizeof(data));
+	PCUT_ASSERT_NOT_NULL(oseg);
+	oseg->seq = 200;
+	conn->sack_last = 200;
+	tcp_iqueue_insert_seg(&conn->incoming, oseg);
+
+	conn->snd_buf_used = 100;
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_INT_EQUALS(2, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(1, trans_seg[0]->opts.sack_cnt);
+	PCUT_ASSERT_INT_EQUALS(100 - 12,
+	    tcp_segment_text_size(trans_seg[0]));
+	PCUT_ASSERT_INT_EQUALS(12, tcp_segment_text_size(trans_seg[1]));
+
+	tcp_iqueue_remove_seg(&conn->incoming, oseg);
+	tcp_segment_delete(oseg);
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+
+	for (i = 0; i < seg_cnt; i++)
+		tcp_segment_delete(trans_seg[i]);
+}
+
 static void tqueue_test_transmit_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 {
 	trans_seg[seg_cnt++] = tcp_segment_dup(seg);
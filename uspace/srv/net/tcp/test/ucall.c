@@ -27,11 +27,15 @@
  */
 
 #include <errno.h>
+#include <fibril.h>
 #include <inet/endpoint.h>
 #include <io/log.h>
 #include <pcut/pcut.h>
+#include <stdlib.h>
+#include <time.h>
 
 #include "../conn.h"
+#include "../ncsim.h"
 #include "../rqueue.h"
 #include "../ucall.h"
 
@@ -42,6 +46,31 @@ PCUT_TEST_SUITE(ucall);
 static void test_cstate_change(tcp_conn_t *, void *, tcp_cstate_t);
 static void test_conns_establish(tcp_conn_t **, tcp_conn_t **);
 static void test_conns_tear_down(tcp_conn_t *, tcp_conn_t *);
+static void test_xfer(tcp_conn_t *, tcp_conn_t *, size_t, size_t, usec_t *);
+static void test_xfer_stats_log(const char *, tcp_conn_t *, tcp_conn_t *);
+static errno_t test_sender_fibril(void *);
+
+enum {
+	/** Amount of data transferred in bulk transfer test */
+	test_xfer_size = 64 * 1024,
+	/** Amount of data transferred in long fat pipe test */
+	test_xfer_lfp_size = 1024 * 1024,
+	/** Chunk size for sending and receiving */
+	test_xfer_chunk = 4096,
+	/** Amount of data transferred in small writes test */
+	test_xfer_small_size = 16 * 1024,
+	/** Chunk size for small writes test */
+	test_xfer_small_chunk = 64
+};
+
+/** Bulk transfer sender */
+typedef struct {
+	tcp_conn_t *conn;
+	size_t size;
+	size_t chunk;
+	tcp_error_t trc;
+	bool done;
+} test_sender_t;
 
 static tcp_rqueue_cb_t test_rqueue_cb = {
 	.seg_received = tcp_as_segment_arrived
@@ -71,12 +100,16 @@ PCUT_TEST_BEFORE
 	tcp_rqueue_init(&test_rqueue_cb);
 	tcp_rqueue_fibril_start();
 
+	tcp_ncsim_init();
+	tcp_ncsim_fibril_start();
+
 	/* Enable internal loopback */
 	tcp_conn_lb = tcp_lb_segment;
 }
 
 PCUT_TEST_AFTER
 {
+	tcp_ncsim_fini();
 	tcp_rqueue_fini();
 	tcp_conns_fini();
 }
@@ -235,6 +268,125 @@ PCUT_TEST(conn_est_close_simult)
 	test_conns_tear_down(cconn, sconn);
 }
 
+/** Test bulk transfer over a lossy link */
+PCUT_TEST(xfer_loss, PCUT_TEST_SET_TIMEOUT(60))
+{
+	tcp_conn_t *cconn, *sconn;
+	tcp_ncsim_cfg_t cfg;
+	usec_t usec;
+
+	test_conns_establish(&cconn, &sconn);
+
+	/* Drop every tenth data segment, 1 ms one-way delay */
+	cfg.drop_nth = 10;
+	cfg.delay_min = 1000;
+	cfg.delay_max = 1000;
+	tcp_ncsim_config(&cfg);
+	tcp_conn_lb = tcp_lb_ncsim;
+
+	test_xfer(cconn, sconn, test_xfer_size, test_xfer_chunk, &usec);
+
+	/* Losses must have been repaired by retransmission */
+	PCUT_ASSERT_TRUE(cconn->cc.retransmits > 0);
+
+	log_msg(LOG_DEFAULT, LVL_NOTE, "xfer_loss: %u bytes in %" PRIu64
+	    " us (%" PRIu64 " KiB/s), %u retransmits, %u fast retransmits, "
+	    "%u timeouts", (unsigned) test_xfer_size, (uint64_t) usec,
+	    (uint64_t) (usec != 0 ? (uint64_t) test_xfer_size * 1000000 /
+	    1024 / usec : 0), cconn->cc.retransmits,
+	    cconn->cc.fast_retransmits, cconn->cc.timeouts);
+	test_xfer_stats_log("xfer_loss", cconn, sconn);
+
+	tcp_conn_lb = tcp_lb_segment;
+	cfg.drop_nth = 0;
+	cfg.delay_min = 0;
+	cfg.delay_max = 0;
+	tcp_ncsim_config(&cfg);
+
+	test_conns_tear_down(cconn, sconn);
+}
+
+/** Test bulk transfer over a long fat pipe.
+ *
+ * With 10 ms one-way delay the bandwidth-delay product exceeds the
+ * largest unscaled window, so throughput depends on window scaling.
+ */
+PCUT_TEST(xfer_lfp, PCUT_TEST_SET_TIMEOUT(60))
+{
+	tcp_conn_t *cconn, *sconn;
+	tcp_ncsim_cfg_t cfg;
+	usec_t usec;
+
+	test_conns_establish(&cconn, &sconn);
+
+	/* Options must have been negotiated on both sides */
+	PCUT_ASSERT_TRUE(cconn->ws_ok);
+	PCUT_ASSERT_TRUE(cconn->ts_ok);
+	PCUT_ASSERT_TRUE(cconn->sack_ok);
+	PCUT_ASSERT_TRUE(sconn->ws_ok);
+	PCUT_ASSERT_TRUE(sconn->ts_ok);
+	PCUT_ASSERT_TRUE(sconn->sack_ok);
+	PCUT_ASSERT_INT_EQUALS(sconn->rcv_wscale, cconn->snd_wscale);
+
+	cfg.drop_nth = 0;
+	cfg.delay_min = 10000;
+	cfg.delay_max = 10000;
+	tcp_ncsim_config(&cfg);
+	tcp_conn_lb = tcp_lb_ncsim;
+
+	test_xfer(cconn, sconn, test_xfer_lfp_size, test_xfer_chunk, &usec);
+
+	/* Advertised window must not have been clamped to 64 KiB */
+	PCUT_ASSERT_TRUE(cconn->snd_wnd > 65535);
+
+	log_msg(LOG_DEFAULT, LVL_NOTE, "xfer_lfp: %u bytes in %" PRIu64
+	    " us (%" PRIu64 " KiB/s), srtt %" PRIu64 " us, snd_wnd %" PRIu32,
+	    (unsigned) test_xfer_lfp_size, (uint64_t) usec,
+	    (uint64_t) (usec != 0 ? (uint64_t) test_xfer_lfp_size * 1000000 /
+	    1024 / usec : 0), (uint64_t) cconn->rtt.srtt, cconn->snd_wnd);
+	test_xfer_stats_log("xfer_lfp", cconn, sconn);
+
+	tcp_conn_lb = tcp_lb_segment;
+	cfg.delay_min = 0;
+	cfg.delay_max = 0;
+	tcp_ncsim_config(&cfg);
+
+	test_conns_tear_down(cconn, sconn);
+}
+
+/** Test coalescing of small writes */
+PCUT_TEST(xfer_small, PCUT_TEST_SET_TIMEOUT(60))
+{
+	tcp_conn_t *cconn, *sconn;
+	uint64_t segs_nagle, segs_nodelay;
+	uint64_t acks_in;
+	usec_t usec;
+
+	test_conns_establish(&cconn, &sconn);
+
+	/* With Nagle algorithm */
+	test_xfer(cconn, sconn, test_xfer_small_size, test_xfer_small_chunk,
+	    &usec);
+	segs_nagle = cconn->stats.segs_out;
+	test_xfer_stats_log("xfer_small (Nagle)", cconn, sconn);
+
+	/* Delayed ACKs cover more than one segment */
+	acks_in = sconn->stats.segs_out;
+	PCUT_ASSERT_TRUE(acks_in < segs_nagle);
+
+	/* Without Nagle algorithm */
+	tcp_uc_set_nodelay(cconn, true);
+	test_xfer(cconn, sconn, test_xfer_small_size, test_xfer_small_chunk,
+	    &usec);
+	segs_nodelay = cconn->stats.segs_out - segs_nagle;
+	test_xfer_stats_log("xfer_small (no delay)", cconn, sconn);
+
+	/* Small writes must have been coalesced into fewer segments */
+	PCUT_ASSERT_TRUE(segs_nagle < segs_nodelay);
+
+	test_conns_tear_down(cconn, sconn);
+}
+
 static void test_cstate_change(tcp_conn_t *conn, void *arg,
     tcp_cstate_t old_state)
 {
@@ -314,4 +466,120 @@ static void test_conns_tear_down(tcp_conn_t *cconn, tcp_conn_t *sconn)
 	tcp_uc_delete(sconn);
 }
 
+/** Transfer test data pattern from @a cconn to @a sconn and verify it.
+ *
+ * @param cconn Sending connection
+ * @param sconn Receiving connection
+ * @param size Number of bytes to transfer (multiple of @a chunk)
+ * @param chunk Size of individual writes (at most test_xfer_chunk)
+ * @param rusec Place to store transfer duration
+ */
+static void test_xfer(tcp_conn_t *cconn, tcp_conn_t *sconn, size_t size,
+    size_t chunk, usec_t *rusec)
+{
+	test_sender_t sender;
+	struct timespec start, end;
+	uint8_t *buf;
+	size_t rcvd, total;
+	xflags_t xflags;
+	tcp_error_t trc;
+	fid_t fid;
+	size_t i;
+
+	buf = malloc(test_xfer_chunk);
+	PCUT_ASSERT_NOT_NULL(buf);
+
+	getuptime(&start);
+
+	sender.conn = cconn;
+	sender.size = size;
+	sender.chunk = chunk;
+	sender.trc = TCP_EOK;
+	sender.done = false;
+
+	fid = fibril_create(test_sender_fibril, &sender);
+	PCUT_ASSERT_TRUE(fid != 0);
+	fibril_add_ready(fid);
+
+	total = 0;
+	while (total < size) {
+		trc = tcp_uc_receive(sconn, buf, test_xfer_chunk, &rcvd,
+		    &xflags);
+		if (trc == TCP_EAGAIN) {
+			fibril_usleep(1000);
+			continue;
+		}
+
+		PCUT_ASSERT_INT_EQUALS(TCP_EOK, trc);
+
+		for (i = 0; i < rcvd; i++) {
+			PCUT_ASSERT_INT_EQUALS((total + i) % 251, buf[i]);
+		}
+
+		total += rcvd;
+	}
+
+	getuptime(&end);
+
+	while (!sender.done)
+		fibril_usleep(1000);
+
+	PCUT_ASSERT_INT_EQUALS(TCP_EOK, sender.trc);
+
+	*rusec = NSEC2USEC(ts_sub_diff(&end, &start));
+	free(buf);
+}
+
+/** Log transfer statistics of a test.
+ *
+ * @param name Test name
+ * @param cconn Sending connection
+ * @param sconn Receiving connection
+ */
+static void test_xfer_stats_log(const char *name, tcp_conn_t *cconn,
+    tcp_conn_t *sconn)
+{
+	log_msg(LOG_DEFAULT, LVL_NOTE, "%s: sender %" PRIu64 " segments/MB, "
+	    "%" PRIu64 " us/MB; receiver %" PRIu64 " ACKs/MB, %" PRIu64
+	    " us/MB", name,
+	    tcp_xfer_stats_per_mb(cconn->stats.segs_out,
+	    cconn->stats.bytes_out),
+	    tcp_xfer_stats_per_mb(cconn->stats.proc_nsec / 1000,
+	    cconn->stats.bytes_out),
+	    tcp_xfer_stats_per_mb(sconn->stats.acks_out,
+	    sconn->stats.bytes_in),
+	    tcp_xfer_stats_per_mb(sconn->stats.proc_nsec / 1000,
+	    sconn->stats.bytes_in));
+}
+
+/** Send test data pattern over connection. */
+static errno_t test_sender_fibril(void *arg)
+{
+	test_sender_t *sender = (test_sender_t *) arg;
+	uint8_t *buf;
+	size_t off;
+	size_t i;
+
+	buf = malloc(test_xfer_chunk);
+	if (buf == NULL) {
+		sender->trc = TCP_ENORES;
+		sender->done = true;
+		return ENOMEM;
+	}
+
+	for (off = 0; off < sender->size; off += sender->chunk) {
+		for (i = 0; i < sender->chunk; i++)
+			buf[i] = (off + i) % 251;
+
+		sender->trc = tcp_uc_send(sender->conn, buf, sender->chunk,
+		    0);
+		if (sender->trc != TCP_EOK)
+			break;
+	}
+
+	free(buf);
+	sender->done = true;
+	return EOK;
+}
+
 PCUT_EXPORT(ucall);
@@ -43,8 +43,10 @@
 #include <mem.h>
 #include <stdlib.h>
 
+#include "cc.h"
 #include "conn.h"
 #include "inet.h"
+#include "iqueue.h"
 #include "ncsim.h"
 #include "rqueue.h"
 #include "segment.h"
@@ -52,12 +54,13 @@
 #include "tqueue.h"
 #include "tcp_type.h"
 
-#define RETRANSMIT_TIMEOUT	(2*1000*1000)
-
 static void retransmit_timeout_func(void *);
+static void dack_timeout_func(void *);
 static void tcp_tqueue_timer_set(tcp_conn_t *);
 static void tcp_tqueue_timer_clear(tcp_conn_t *);
+static void tcp_tqueue_dack_timer_clear(tcp_conn_t *);
 static void tcp_tqueue_seg(tcp_conn_t *, tcp_segment_t *);
+static void tcp_tqueue_set_opts(tcp_conn_t *, tcp_segment_t *);
 static void tcp_conn_transmit_segment(tcp_conn_t *, tcp_segment_t *);
 static void tcp_prepare_transmit_segment(tcp_conn_t *, tcp_segment_t *);
 static void tcp_tqueue_send_immed(tcp_conn_t *, tcp_segment_t *);
@@ -71,6 +74,15 @@ errno_t tcp_tqueue_init(tcp_tqueue_t *tqueue, tcp_conn_t *conn,
 	if (tqueue->timer == NULL)
 		return ENOMEM;
 
+	tqueue->dack_timer = fibril_timer_create(&conn->lock);
+	if (tqueue->dack_timer == NULL) {
+		fibril_timer_destroy(tqueue->timer);
+		tqueue->timer = NULL;
+		return ENOMEM;
+	}
+
+	tqueue->dack_segs = 0;
+
 	list_initialize(&tqueue->list);
 
 	return EOK;
@@ -79,6 +91,8 @@ errno_t tcp_tqueue_init(tcp_tqueue_t *tqueue, tcp_conn_t *conn,
 void tcp_tqueue_clear(tcp_tqueue_t *tqueue)
 {
 	tcp_tqueue_timer_clear(tqueue->conn);
+	tcp_tqueue_dack_timer_clear(tqueue->conn);
+	tqueue->dack_segs = 0;
 }
 
 void tcp_tqueue_fini(tcp_tqueue_t *tqueue)
@@ -91,6 +105,11 @@ void tcp_tqueue_fini(tcp_tqueue_t *tqueue)
 		tqueue->timer = NULL;
 	}
 
+	if (tqueue->dack_timer != NULL) {
+		fibril_timer_destroy(tqueue->dack_timer);
+		tqueue->dack_timer = NULL;
+	}
+
 	while (!list_empty(&tqueue->list)) {
 		link = list_first(&tqueue->list);
 		tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
@@ -147,10 +166,20 @@ static void tcp_tqueue_seg(tcp_conn_t *conn, tcp_segment_t *seg)
 		tqe->seg = rt_seg;
 		rt_seg->seq = conn->snd_nxt;
 
+		if (list_empty(&conn->retransmit.list)) {
+			/* Nothing in flight, resynchronize congestion control */
+			conn->cc.una = conn->snd_una;
+
+			/* Set retransmission timer */
+			tcp_tqueue_timer_set(conn);
+		}
+
 		list_append(&tqe->link, &conn->retransmit.list);
 
-		/* Set retransmission timer */
-		tcp_tqueue_timer_set(conn);
+		/* Possibly start measuring round-trip time */
+		tcp_rtt_seg_sent(conn, conn->snd_nxt + seg->len);
+
+		conn->stats.bytes_out += tcp_segment_text_size(seg);
 	}
 
 	tcp_prepare_transmit_segment(conn, seg);
@@ -172,16 +201,47 @@ static void tcp_prepare_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
 	tcp_conn_transmit_segment(conn, seg);
 }
 
+/** Determine space taken by the SACK option in the next segment.
+ *
+ * @param conn	Connection
+ * @return	Size of SACK option in bytes
+ */
+static size_t tcp_tqueue_sack_space(tcp_conn_t *conn)
+{
+	tcp_seg_opts_t opts;
+
+	if (!conn->sack_ok)
+		return 0;
+
+	tcp_iqueue_sack_blocks(&conn->incoming, &opts, conn->ts_ok ?
+	    TCP_SACK_BLOCKS_MAX - 1 : TCP_SACK_BLOCKS_MAX);
+	if (opts.sack_cnt == 0)
+		return 0;
+
+	/* Two NOPs, kind, length and the blocks */
+	return 4 + 8 * opts.sack_cnt;
+}
+
 /** Transmit data from the send buffer.
+ *
+ * Data is split into segments of at most SMSS bytes, less the space taken
+ * by the SACK option, and sent for as long as both the send window and
+ * the congestion window allow.
+ *
+ * Unless disabled for the connection, the Nagle algorithm (RFC 896,
+ * RFC 1122 section 4.2.3.4) holds back a segment smaller than SMSS while
+ * there is unacknowledged data in flight. Small writes are thus coalesced
+ * in the send buffer and go out as full-sized segments.
  *
  * @param conn	Connection
  */
 void tcp_tqueue_new_data(tcp_conn_t *conn)
 {
+	uint32_t wnd;
+	uint32_t flight;
 	size_t avail_wnd;
-	size_t xfer_seqlen;
-	size_t snd_buf_seqlen;
 	size_t data_size;
+	size_t mss;
 	tcp_control_t ctrl;
 	bool send_fin;
 
@@ -189,52 +249,68 @@ void tcp_tqueue_new_data(tcp_conn_t *conn)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_new_data()", conn->name);
 
-	/* Number of free sequence numbers in send window */
-	avail_wnd = (conn->snd_una + conn->snd_wnd) - conn->snd_nxt;
-	snd_buf_seqlen = conn->snd_buf_used + (conn->snd_buf_fin ? 1 : 0);
+	/* Options must fit into the peer's MSS along with the data */
+	mss = conn->smss - tcp_tqueue_sack_space(conn);
 
-	xfer_seqlen = min(snd_buf_seqlen, avail_wnd);
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: snd_buf_seqlen = %zu, SND.WND = %" PRIu32 ", "
-	    "xfer_seqlen = %zu", conn->name, snd_buf_seqlen, conn->snd_wnd,
-	    xfer_seqlen);
+	while (true) {
+		/* Number of free sequence numbers in send/congestion window */
+		wnd = tcp_cc_wnd(conn);
+		flight = conn->snd_nxt - conn->snd_una;
+		if (flight >= wnd)
+			return;
 
-	if (xfer_seqlen == 0)
-		return;
+		avail_wnd = wnd - flight;
+		data_size = min(conn->snd_buf_used, min(avail_wnd, mss));
+		send_fin = conn->snd_buf_fin && data_size == conn->snd_buf_used &&
+		    data_size < avail_wnd;
 
-	/* XXX Do not always send immediately */
+		if (data_size < mss && flight > 0 && !conn->nodelay &&
+		    !conn->snd_buf_push && !conn->snd_buf_fin) {
+			/* Wait for ACK before sending a small segment */
+			return;
+		}
 
-	send_fin = conn->snd_buf_fin && xfer_seqlen == snd_buf_seqlen;
-	data_size = xfer_seqlen - (send_fin ? 1 : 0);
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: snd_buf_used = %zu, "
+		    "SND.WND = %" PRIu32 ", cwnd = %" PRIu32 ", "
+		    "data_size = %zu", conn->name, conn->snd_buf_used,
+		    conn->snd_wnd, conn->cc.cwnd, data_size);
 
-	if (send_fin) {
-		log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Sending out FIN.", conn->name);
-		/* We are sending out FIN */
-		ctrl = CTL_FIN;
-	} else {
-		ctrl = 0;
-	}
+		if (data_size == 0 && !send_fin)
+			return;
 
-	seg = tcp_segment_make_data(ctrl, conn->snd_buf, data_size);
-	if (seg == NULL) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failure.");
-		return;
-	}
+		if (send_fin) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Sending out FIN.",
+			    conn->name);
+			/* We are sending out FIN */
+			ctrl = CTL_FIN;
+		} else {
+			ctrl = 0;
+		}
+
+		seg = tcp_segment_make_data(ctrl, conn->snd_buf, data_size);
+		if (seg == NULL) {
+			log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failure.");
+			return;
+		}
 
-	/* Remove data from send buffer */
-	memmove(conn->snd_buf, conn->snd_buf + data_size,
-	    conn->snd_buf_used - data_size);
-	conn->snd_buf_used -= data_size;
+		/* Remove data from send buffer */
+		memmove(conn->snd_buf, conn->snd_buf + data_size,
+		    conn->snd_buf_used - data_size);
+		conn->snd_buf_used -= data_size;
+		if (conn->snd_buf_used == 0)
+			conn->snd_buf_push = false;
 
-	if (send_fin)
-		conn->snd_buf_fin = false;
+		if (send_fin)
+			conn->snd_buf_fin = false;
 
-	fibril_condvar_broadcast(&conn->snd_buf_cv);
+		fibril_condvar_broadcast(&conn->snd_buf_cv);
 
-	if (send_fin)
-		tcp_conn_fin_sent(conn);
+		if (send_fin)
+			tcp_conn_fin_sent(conn);
 
-	tcp_tqueue_seg(conn, seg);
-	tcp_segment_delete(seg);
+		tcp_tqueue_seg(conn, seg);
+		tcp_segment_delete(seg);
+	}
 }
 
 /** Remove ACKed segments from retransmission queue and possibly transmit
@@ -284,21 +360,91 @@ void tcp_tqueue_ack_received(tcp_conn_t *conn)
 	if (list_empty(&conn->retransmit.list))
 		tcp_tqueue_timer_clear(conn);
 
+	/* Update congestion window */
+	tcp_cc_ack_received(conn);
+
 	/* Possibly transmit more data */
 	tcp_tqueue_new_data(conn);
 }
 
+/** Fill in options of outgoing segment.
+ *
+ * @param conn	Connection
+ * @param seg	Segment
+ */
+static void tcp_tqueue_set_opts(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	tcp_seg_opts_t *opts = &seg->opts;
+	size_t text_size;
+	unsigned max;
+
+	memset(opts, 0, sizeof(tcp_seg_opts_t));
+
+	if ((seg->ctrl & CTL_SYN) != 0) {
+		opts->present |= TCP_SOPT_MSS;
+		opts->mss = TCP_SMSS_DEFAULT;
+
+		if (conn->ws_ok) {
+			opts->present |= TCP_SOPT_WSCALE;
+			opts->wscale = conn->rcv_wscale;
+		}
+
+		if (conn->sack_ok)
+			opts->present |= TCP_SOPT_SACK_PERM;
+	}
+
+	if (conn->ts_ok) {
+		opts->present |= TCP_SOPT_TS;
+		opts->tsval = tcp_rtt_ts_now();
+		if ((seg->ctrl & CTL_ACK) != 0)
+			opts->tsecr = conn->ts_recent;
+	}
+
+	if (conn->sack_ok && (seg->ctrl & (CTL_SYN | CTL_ACK)) == CTL_ACK) {
+		max = conn->ts_ok ? TCP_SACK_BLOCKS_MAX - 1 :
+		    TCP_SACK_BLOCKS_MAX;
+
+		/*
+		 * A retransmitted segment was sized for the SACK option
+		 * at the time of its first transmission. Send fewer blocks
+		 * rather than exceed the peer's MSS.
+		 */
+		text_size = tcp_segment_text_size(seg);
+		if (text_size > 0) {
+			if (text_size + 4 + 8 > conn->smss)
+				max = 0;
+			else
+				max = min(max, (conn->smss - text_size - 4) / 8);
+		}
+
+		tcp_iqueue_sack_blocks(&conn->incoming, opts, max);
+	}
+}
+
 static void tcp_conn_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_conn_transmit_segment(%p, %p)",
 	    conn->name, conn, seg);
 
-	seg->wnd = conn->rcv_wnd;
+	/* Window field is never scaled in SYN segments */
+	if ((seg->ctrl & CTL_SYN) != 0)
+		seg->wnd = min(conn->rcv_wnd, UINT16_MAX);
+	else
+		seg->wnd = min(conn->rcv_wnd >> conn->rcv_wscale, UINT16_MAX);
 
-	if ((seg->ctrl & CTL_ACK) != 0)
+	if ((seg->ctrl & CTL_ACK) != 0) {
 		seg->ack = conn->rcv_nxt;
-	else
+		conn->last_ack_sent = conn->rcv_nxt;
+		conn->rcv_adv = conn->rcv_nxt + conn->rcv_wnd;
+
+		/* Any delayed acknowledgement rides along with this segment */
+		conn->retransmit.dack_segs = 0;
+		tcp_tqueue_dack_timer_clear(conn);
+	} else {
 		seg->ack = 0;
+	}
+
+	tcp_tqueue_set_opts(conn, seg);
 
 	tcp_tqueue_send_immed(conn, seg);
 }
@@ -314,51 +460,229 @@ void tcp_tqueue_send_immed(tcp_conn_t *conn, tcp_segment_t *seg)
 
 	tcp_segment_dump(seg);
 
+	conn->stats.segs_out++;
+	if (seg->len == 0 && seg->ctrl == CTL_ACK)
+		conn->stats.acks_out++;
+
 	conn->retransmit.cb->transmit_seg(&conn->ident, seg);
 }
 
-static void retransmit_timeout_func(void *arg)
+/** Acknowledge received data, possibly with a delay.
+ *
+ * Following RFC 1122 section 4.2.3.2 and RFC 5681 section 4.2 the
+ * acknowledgement is delayed by at most TCP_DACK_TIMEOUT, but every
+ * TCP_DACK_SEGS-th segment is acknowledged immediately. If we send
+ * any segment in the meantime, the acknowledgement is piggybacked on it.
+ *
+ * @param conn	Connection
+ */
+void tcp_tqueue_ack_delayed(tcp_conn_t *conn)
 {
-	tcp_conn_t *conn = (tcp_conn_t *) arg;
-	tcp_tqueue_entry_t *tqe;
-	tcp_segment_t *rt_seg;
-	link_t *link;
+	assert(fibril_mutex_is_locked(&conn->lock));
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmit_timeout_func(%p)", conn->name, conn);
+	conn->retransmit.dack_segs++;
+	if (conn->retransmit.dack_segs >= TCP_DACK_SEGS) {
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+		return;
+	}
 
-	tcp_conn_lock(conn);
+	conn->stats.acks_delayed++;
 
-	if (conn->cstate == st_closed) {
-		log_msg(LOG_DEFAULT, LVL_DEBUG, "Connection already closed.");
-		tcp_conn_unlock(conn);
-		tcp_conn_delref(conn);
+	/* Timer is already running if an earlier segment is pending */
+	if (conn->retransmit.dack_segs > 1)
+		return;
+
+	tcp_conn_addref(conn);
+	fibril_timer_set_locked(conn->retransmit.dack_timer, TCP_DACK_TIMEOUT,
+	    dack_timeout_func, (void *) conn);
+}
+
+/** Send delayed acknowledgement now, if there is one.
+ *
+ * @param conn	Connection
+ */
+void tcp_tqueue_ack_flush(tcp_conn_t *conn)
+{
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	if (conn->retransmit.dack_segs > 0)
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+}
+
+/** Send window update after the user has consumed received data.
+ *
+ * The update is only needed once the peer has used up at least half
+ * of the advertised window. To avoid the silly window syndrome (RFC 1122
+ * section 4.2.3.3) it is then only sent if the right edge of the window
+ * moves by at least the smaller of one maximum-sized segment and half
+ * the receive buffer.
+ *
+ * @param conn	Connection
+ */
+void tcp_tqueue_wnd_update(tcp_conn_t *conn)
+{
+	uint32_t incr;
+
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	if ((int32_t) (conn->rcv_adv - conn->rcv_nxt) >
+	    (int32_t) (conn->rcv_buf_size / 2))
+		return;
+
+	incr = conn->rcv_nxt + conn->rcv_wnd - conn->rcv_adv;
+	if ((int32_t) incr < (int32_t) min(conn->rcv_buf_size / 2,
+	    TCP_SMSS_DEFAULT))
+		return;
+
+	tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+}
+
+/** Update scoreboard with SACK information from an incoming ACK.
+ *
+ * @param conn Connection
+ * @param opts Options of the incoming segment
+ */
+void tcp_tqueue_sack_received(tcp_conn_t *conn, tcp_seg_opts_t *opts)
+{
+	tcp_sack_block_t *blk;
+	uint32_t start, end;
+	unsigned i;
+
+	if ((opts->present & TCP_SOPT_SACK) == 0)
 		return;
+
+	for (i = 0; i < opts->sack_cnt; i++) {
+		blk = &opts->sack[i];
+
+		/* Ignore blocks below SND.UNA (D-SACK) or above SND.NXT */
+		if ((int32_t) (blk->end - conn->snd_una) <= 0 ||
+		    (int32_t) (blk->end - conn->snd_nxt) > 0)
+			continue;
+
+		list_foreach(conn->retransmit.list, link, tcp_tqueue_entry_t,
+		    tqe) {
+			start = tqe->seg->seq;
+			end = start + tqe->seg->len;
+
+			if ((int32_t) (start - blk->start) >= 0 &&
+			    (int32_t) (end - blk->end) <= 0)
+				tqe->sacked = true;
+		}
+	}
+}
+
+/** Reset scoreboard.
+ *
+ * @param conn Connection
+ * @param sacked @c true to also forget SACK information, which
+ *               the receiver is allowed to renege on
+ */
+void tcp_tqueue_scoreboard_reset(tcp_conn_t *conn, bool sacked)
+{
+	list_foreach(conn->retransmit.list, link, tcp_tqueue_entry_t, tqe) {
+		tqe->rexmit = false;
+		if (sacked)
+			tqe->sacked = false;
 	}
+}
+
+/** Retransmit the next lost segment.
+ *
+ * Without SACK information this is the first unacknowledged segment,
+ * unless it has already been retransmitted during this recovery.
+ * Otherwise it is the first segment below the highest SACKed one that
+ * has neither been SACKed nor retransmitted yet during this recovery.
+ *
+ * @param conn Connection
+ */
+void tcp_tqueue_retransmit(tcp_conn_t *conn)
+{
+	tcp_tqueue_entry_t *tqe;
+	tcp_tqueue_entry_t *hole;
+	tcp_segment_t *rt_seg;
+	link_t *link;
+	bool sacked;
+
+	assert(fibril_mutex_is_locked(&conn->lock));
 
 	link = list_first(&conn->retransmit.list);
 	if (link == NULL) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "Nothing to retransmit");
-		tcp_conn_unlock(conn);
-		tcp_conn_delref(conn);
 		return;
 	}
 
-	tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
+	/* Look for a hole in the scoreboard */
+	tqe = NULL;
+	hole = NULL;
+	sacked = false;
+	list_foreach(conn->retransmit.list, link, tcp_tqueue_entry_t, e) {
+		if (e->sacked) {
+			sacked = true;
+			if (hole != NULL) {
+				tqe = hole;
+				break;
+			}
+		} else if (!e->rexmit && hole == NULL) {
+			hole = e;
+		}
+	}
+
+	if (!sacked) {
+		/* No SACK information, retransmit the first segment once */
+		tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
+		if (tqe->rexmit)
+			tqe = NULL;
+	}
+
+	if (tqe == NULL) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "No hole to retransmit");
+		return;
+	}
 
 	rt_seg = tcp_segment_dup(tqe->seg);
 	if (rt_seg == NULL) {
 		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
-		tcp_conn_unlock(conn);
-		tcp_conn_delref(conn);
 		/* XXX Handle properly */
 		return;
 	}
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmitting segment", conn->name);
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmitting segment "
+	    "SEG.SEQ=%" PRIu32, conn->name, rt_seg->seq);
+	tqe->rexmit = true;
+	tcp_rtt_seg_retransmitted(conn);
 	tcp_conn_transmit_segment(tqe->conn, rt_seg);
+	tcp_segment_delete(rt_seg);
+}
+
+static void retransmit_timeout_func(void *arg)
+{
+	tcp_conn_t *conn = (tcp_conn_t *) arg;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmit_timeout_func(%p)", conn->name, conn);
+
+	tcp_conn_lock(conn);
+
+	if (conn->cstate == st_closed) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Connection already closed.");
+		tcp_conn_unlock(conn);
+		tcp_conn_delref(conn);
+		return;
+	}
+
+	if (list_empty(&conn->retransmit.list)) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Nothing to retransmit");
+		tcp_conn_unlock(conn);
+		tcp_conn_delref(conn);
+		return;
+	}
+
+	/* Collapse congestion window and back off the timer */
+	tcp_cc_timeout(conn);
+	tcp_tqueue_scoreboard_reset(conn, true);
+	tcp_tqueue_retransmit(conn);
 
 	/* Reset retransmission timer */
-	fibril_timer_set_locked(conn->retransmit.timer, RETRANSMIT_TIMEOUT,
+	fibril_timer_set_locked(conn->retransmit.timer, conn->rtt.rto,
 	    retransmit_timeout_func, (void *) conn);
 
 	tcp_conn_unlock(conn);
@@ -366,6 +690,23 @@ static void retransmit_timeout_func(void *arg)
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmit_timeout_func(%p) end", conn->name, conn);
 }
 
+/** Delayed acknowledgement timer expired */
+static void dack_timeout_func(void *arg)
+{
+	tcp_conn_t *conn = (tcp_conn_t *) arg;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: dack_timeout_func(%p)",
+	    conn->name, conn);
+
+	tcp_conn_lock(conn);
+
+	if (conn->cstate != st_closed)
+		tcp_tqueue_ack_flush(conn);
+
+	tcp_conn_unlock(conn);
+	tcp_conn_delref(conn);
+}
+
 /** Set or re-set retransmission timer */
 static void tcp_tqueue_timer_set(tcp_conn_t *conn)
 {
@@ -377,7 +718,7 @@ static void tcp_tqueue_timer_set(tcp_conn_t *conn)
 	tcp_tqueue_timer_clear(conn);
 
 	tcp_conn_addref(conn);
-	fibril_timer_set_locked(conn->retransmit.timer, RETRANSMIT_TIMEOUT,
+	fibril_timer_set_locked(conn->retransmit.timer, conn->rtt.rto,
 	    retransmit_timeout_func, (void *) conn);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: tcp_tqueue_timer_set() end", conn->name);
@@ -396,6 +737,16 @@ static void tcp_tqueue_timer_clear(tcp_conn_t *conn)
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: tcp_tqueue_timer_clear() end", conn->name);
 }
 
+/** Clear delayed acknowledgement timer */
+static void tcp_tqueue_dack_timer_clear(tcp_conn_t *conn)
+{
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	if (fibril_timer_clear_locked(conn->retransmit.dack_timer) ==
+	    fts_active)
+		tcp_conn_delref(conn);
+}
+
 /**
  * @}
  */
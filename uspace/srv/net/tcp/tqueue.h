@@ -39,6 +39,11 @@
 #include "std.h"
 #include "tcp_type.h"
 
+/** Maximum delay of an acknowledgement (usec) */
+#define TCP_DACK_TIMEOUT  (200 * 1000)
+/** Acknowledge at least every n-th received segment */
+#define TCP_DACK_SEGS  2
+
 extern errno_t tcp_tqueue_init(tcp_tqueue_t *, tcp_conn_t *,
     tcp_tqueue_cb_t *);
 extern void tcp_tqueue_clear(tcp_tqueue_t *);
@@ -46,6 +51,12 @@ extern void tcp_tqueue_fini(tcp_tqueue_t *);
 extern void tcp_tqueue_ctrl_seg(tcp_conn_t *, tcp_control_t);
 extern void tcp_tqueue_new_data(tcp_conn_t *);
 extern void tcp_tqueue_ack_received(tcp_conn_t *);
+extern void tcp_tqueue_retransmit(tcp_conn_t *);
+extern void tcp_tqueue_sack_received(tcp_conn_t *, tcp_seg_opts_t *);
+extern void tcp_tqueue_scoreboard_reset(tcp_conn_t *, bool);
+extern void tcp_tqueue_ack_delayed(tcp_conn_t *);
+extern void tcp_tqueue_ack_flush(tcp_conn_t *);
+extern void tcp_tqueue_wnd_update(tcp_conn_t *);
 
 #endif
 
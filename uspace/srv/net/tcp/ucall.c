@@ -39,6 +39,7 @@
 #include <io/log.h>
 #include <macros.h>
 #include <mem.h>
+#include <time.h>
 #include "conn.h"
 #include "tcp_type.h"
 #include "tqueue.h"
@@ -123,6 +124,7 @@ tcp_error_t tcp_uc_open(inet_ep2_t *epp, acpass_t acpass,
 tcp_error_t tcp_uc_send(tcp_conn_t *conn, void *data, size_t size,
     xflags_t flags)
 {
+	struct timespec start;
 	size_t buf_free;
 	size_t xfer_size;
 
@@ -159,6 +161,7 @@ tcp_error_t tcp_uc_send(tcp_conn_t *conn, void *data, size_t size,
 			return TCP_ERESET;
 		}
 
+		getuptime(&start);
 		xfer_size = min(size, buf_free);
 
 		/* Copy data to buffer */
@@ -167,7 +170,11 @@ tcp_error_t tcp_uc_send(tcp_conn_t *conn, void *data, size_t size,
 		conn->snd_buf_used += xfer_size;
 		size -= xfer_size;
 
+		if (size == 0 && (flags & XF_PUSH) != 0)
+			conn->snd_buf_push = true;
+
 		tcp_tqueue_new_data(conn);
+		tcp_conn_stats_proc(conn, &start);
 	}
 
 	tcp_tqueue_new_data(conn);
@@ -180,6 +187,7 @@ tcp_error_t tcp_uc_send(tcp_conn_t *conn, void *data, size_t size,
 tcp_error_t tcp_uc_receive(tcp_conn_t *conn, void *buf, size_t size,
     size_t *rcvd, xflags_t *xflags)
 {
+	struct timespec start;
 	size_t xfer_size;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_uc_receive()", conn->name);
@@ -215,6 +223,8 @@ tcp_error_t tcp_uc_receive(tcp_conn_t *conn, void *buf, size_t size,
 		}
 	}
 
+	getuptime(&start);
+
 	/* Copy data from receive buffer to user buffer */
 	xfer_size = min(size, conn->rcv_buf_used);
 	memcpy(buf, conn->rcv_buf, xfer_size);
@@ -229,8 +239,9 @@ tcp_error_t tcp_uc_receive(tcp_conn_t *conn, void *buf, size_t size,
 	/* TODO */
 	*xflags = 0;
 
-	/* Send new size of receive window */
-	tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+	/* Send new size of receive window if it has grown enough */
+	tcp_tqueue_wnd_update(conn);
+	tcp_conn_stats_proc(conn, &start);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_uc_receive() - returning %zu bytes",
 	    conn->name, xfer_size);
@@ -240,6 +251,31 @@ tcp_error_t tcp_uc_receive(tcp_conn_t *conn, void *buf, size_t size,
 	return TCP_EOK;
 }
 
+/** PUSH user call
+ *
+ * Send out all data in the send buffer without waiting for more data
+ * to coalesce.
+ */
+tcp_error_t tcp_uc_push(tcp_conn_t *conn)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_uc_push()", conn->name);
+
+	tcp_conn_lock(conn);
+
+	if (conn->cstate == st_closed) {
+		tcp_conn_unlock(conn);
+		return TCP_ENOTEXIST;
+	}
+
+	if (conn->snd_buf_used > 0) {
+		conn->snd_buf_push = true;
+		tcp_tqueue_new_data(conn);
+	}
+
+	tcp_conn_unlock(conn);
+	return TCP_EOK;
+}
+
 /** CLOSE user call */
 tcp_error_t tcp_uc_close(tcp_conn_t *conn)
 {
@@ -313,6 +349,26 @@ void tcp_uc_set_cb(tcp_conn_t *conn, tcp_cb_t *cb, void *arg)
 	conn->cb_arg = arg;
 }
 
+/** Enable or disable the Nagle algorithm on connection.
+ *
+ * @param conn		Connection
+ * @param nodelay	@c true to send small segments without delay
+ */
+void tcp_uc_set_nodelay(tcp_conn_t *conn, bool nodelay)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_uc_set_nodelay(%p, %d)",
+	    conn, (int) nodelay);
+
+	tcp_conn_lock(conn);
+	conn->nodelay = nodelay;
+
+	/* Flush data that has been held back */
+	if (nodelay && conn->cstate != st_closed)
+		tcp_tqueue_new_data(conn);
+
+	tcp_conn_unlock(conn);
+}
+
 void *tcp_uc_get_userptr(tcp_conn_t *conn)
 {
 	return conn->cb_arg;
@@ -34,14 +34,17 @@
  * @file HelenOS service implementation
  */
 
+#include <as.h>
 #include <async.h>
 #include <errno.h>
 #include <inet/endpoint.h>
+#include <inet/udp_ring.h>
 #include <io/log.h>
 #include <ipc/services.h>
 #include <ipc/udp.h>
 #include <loc.h>
 #include <macros.h>
+#include <mem.h>
 #include <stdlib.h>
 
 #include "assoc.h"
@@ -56,6 +59,7 @@
 #define MAX_MSG_SIZE DATA_XFER_LIMIT
 
 static void udp_recv_msg_cassoc(void *, inet_ep2_t *, udp_msg_t *);
+static void udp_rmsg_flush(udp_client_t *);
 
 /** Callbacks to tie us to association layer */
 static udp_assoc_cb_t udp_cassoc_cb = {
@@ -92,7 +96,11 @@ static void udp_recv_msg_cassoc(void *arg, inet_ep2_t *epp, udp_msg_t *msg)
 	udp_cassoc_t *cassoc = (udp_cassoc_t *) arg;
 
 	udp_cassoc_queue_msg(cassoc, epp, msg);
-	udp_ev_data(cassoc->client);
+
+	if (cassoc->client->shm != NULL)
+		udp_rmsg_flush(cassoc->client);
+	else
+		udp_ev_data(cassoc->client);
 }
 
 /** Create association.
@@ -414,6 +422,139 @@ static void udp_assoc_send_msg_srv(udp_client_t *client, ipc_call_t *icall)
 	free(data);
 }
 
+/** Send batch of messages via association.
+ *
+ * Handle client request to send messages from the shared transmit buffer.
+ *
+ * @param client UDP client
+ * @param icall  Async request data
+ *
+ */
+static void udp_assoc_send_batch_srv(udp_client_t *client, ipc_call_t *icall)
+{
+	udp_ring_msg_t msg;
+	sysarg_t assoc_id;
+	size_t len;
+	size_t off;
+	size_t nsent;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_assoc_send_batch_srv()");
+
+	assoc_id = ipc_get_arg1(icall);
+	len = ipc_get_arg2(icall);
+
+	if (client->shm == NULL || len > UDP_RING_TX_SIZE) {
+		async_answer_0(icall, EINVAL);
+		return;
+	}
+
+	off = 0;
+	nsent = 0;
+	rc = EOK;
+
+	while (off < len) {
+		if (len - off < sizeof(udp_ring_msg_t)) {
+			rc = EINVAL;
+			break;
+		}
+
+		/*
+		 * The buffer is writable by the client. Take a copy of
+		 * the header and use only the copy once it is validated.
+		 */
+		memcpy(&msg, &client->shm->tx[off], sizeof(udp_ring_msg_t));
+
+		if (msg.size > MAX_MSG_SIZE ||
+		    msg.esize % UDP_RING_ALIGN != 0 ||
+		    msg.esize < udp_ring_msg_esize(msg.size) ||
+		    msg.esize > len - off) {
+			rc = EINVAL;
+			break;
+		}
+
+		rc = udp_assoc_send_msg_impl(client, assoc_id, &msg.ep,
+		    &client->shm->tx[off + sizeof(udp_ring_msg_t)], msg.size);
+		if (rc != EOK)
+			break;
+
+		off += msg.esize;
+		++nsent;
+	}
+
+	if (nsent == 0 && rc != EOK) {
+		async_answer_0(icall, rc);
+		return;
+	}
+
+	async_answer_1(icall, EOK, nsent);
+}
+
+/** Create area shared with client.
+ *
+ * Handle client request to share memory area for passing messages.
+ *
+ * @param client UDP client
+ * @param icall  Async request data
+ *
+ */
+static void udp_shm_create_srv(udp_client_t *client, ipc_call_t *icall)
+{
+	ipc_call_t call;
+	size_t size;
+	unsigned int flags;
+	void *area;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_shm_create_srv()");
+
+	if (!async_share_out_receive(&call, &size, &flags)) {
+		async_answer_0(&call, EINVAL);
+		async_answer_0(icall, EINVAL);
+		return;
+	}
+
+	if (client->shm != NULL || size < sizeof(udp_shm_t) ||
+	    (flags & AS_AREA_WRITE) == 0) {
+		async_answer_0(&call, EINVAL);
+		async_answer_0(icall, EINVAL);
+		return;
+	}
+
+	rc = async_share_out_finalize(&call, &area);
+	if (rc != EOK || area == AS_MAP_FAILED) {
+		async_answer_0(icall, ENOMEM);
+		return;
+	}
+
+	client->shm = (udp_shm_t *) area;
+	async_answer_0(icall, EOK);
+
+	/* Move any messages received so far */
+	udp_rmsg_flush(client);
+}
+
+/** Resume passing received messages.
+ *
+ * Handle client request after it has freed space in the receive ring.
+ *
+ * @param client UDP client
+ * @param icall  Async request data
+ *
+ */
+static void udp_rmsg_resume_srv(udp_client_t *client, ipc_call_t *icall)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_rmsg_resume_srv()");
+
+	if (client->shm == NULL) {
+		async_answer_0(icall, EINVAL);
+		return;
+	}
+
+	async_answer_0(icall, EOK);
+	udp_rmsg_flush(client);
+}
+
 /** Get next received message.
  *
  * @param client UDP Client
@@ -430,6 +571,46 @@ static udp_crcv_queue_entry_t *udp_rmsg_get_next(udp_client_t *client)
 	return list_get_instance(link, udp_crcv_queue_entry_t, link);
 }
 
+/** Move received messages to shared receive ring.
+ *
+ * Messages that do not fit stay in the client receive queue until
+ * the client asks to resume.
+ *
+ * @param client UDP client
+ */
+static void udp_rmsg_flush(udp_client_t *client)
+{
+	udp_shm_t *shm = client->shm;
+	udp_crcv_queue_entry_t *enext;
+	bool added = false;
+
+	while ((enext = udp_rmsg_get_next(client)) != NULL) {
+		if (!udp_ring_put(shm, enext->cassoc->id, &enext->epp.remote,
+		    enext->msg->data, enext->msg->data_size)) {
+			/*
+			 * Ask client to resume once it has made space. Check
+			 * again in case it already did so in the meantime.
+			 */
+			atomic_store(&shm->rx_stalled, 1);
+			atomic_thread_fence(memory_order_seq_cst);
+
+			if (!udp_ring_put(shm, enext->cassoc->id,
+			    &enext->epp.remote, enext->msg->data,
+			    enext->msg->data_size))
+				break;
+		}
+
+		list_remove(&enext->link);
+		udp_msg_delete(enext->msg);
+		free(enext);
+		added = true;
+	}
+
+	/* Only notify client if it has not been notified yet */
+	if (added && atomic_exchange(&shm->rx_event, 1) == 0)
+		udp_ev_data(client);
+}
+
 /** Get info on first received message.
  *
  * Handle client request to get information on received message.
@@ -577,6 +758,7 @@ static void udp_client_conn(ipc_call_t *icall, void *arg)
 	client.sess = NULL;
 	list_initialize(&client.cassoc);
 	list_initialize(&client.crcv_queue);
+	client.shm = NULL;
 
 	while (true) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_client_conn: wait req");
@@ -617,6 +799,15 @@ static void udp_client_conn(ipc_call_t *icall, void *arg)
 		case UDP_RMSG_DISCARD:
 			udp_rmsg_discard_srv(&client, &call);
 			break;
+		case UDP_SHM_CREATE:
+			udp_shm_create_srv(&client, &call);
+			break;
+		case UDP_RMSG_RESUME:
+			udp_rmsg_resume_srv(&client, &call);
+			break;
+		case UDP_ASSOC_SEND_BATCH:
+			udp_assoc_send_batch_srv(&client, &call);
+			break;
 		default:
 			async_answer_0(&call, ENOTSUP);
 			break;
@@ -636,6 +827,9 @@ static void udp_client_conn(ipc_call_t *icall, void *arg)
 
 	if (client.sess != NULL)
 		async_hangup(client.sess);
+
+	if (client.shm != NULL)
+		as_area_destroy(client.shm);
 }
 
 /** Initialize UDP service.
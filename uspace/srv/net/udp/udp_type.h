@@ -40,6 +40,7 @@
 #include <fibril.h>
 #include <fibril_synch.h>
 #include <inet/endpoint.h>
+#include <inet/udp_ring.h>
 #include <ipc/loc.h>
 #include <refcount.h>
 #include <stdbool.h>
@@ -190,6 +191,8 @@ typedef struct udp_client {
 	list_t cassoc; /* of udp_cassoc_t */
 	/** Client receive queue */
 	list_t crcv_queue;
+	/** Area shared with client or @c NULL */
+	udp_shm_t *shm;
 } udp_client_t;
 
 #endif